@@ -0,0 +1,748 @@
+// alog.c — кольца потоков и поток журнала (см. alog.h)
+
+#define _GNU_SOURCE
+#include "alog.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ALOG_MAGIC "OXALOG1\n"
+#define OUT_BUF (64 * 1024)
+#define IDLE_MAX_MS 50
+
+enum { FMT_TEXT, FMT_JSON, FMT_BINARY };
+enum { RING_USED, RING_ORPHAN, RING_FREE };
+enum { TAG_STR = 1, TAG_SITE, TAG_REC };
+
+// Запись в кольце: заголовок, поля, байты строк подряд; размер кратен 8.
+// pad — хвост кольца перед переходом в начало
+typedef struct {
+    uint32_t size;
+    uint16_t n;
+    uint16_t pad;
+    uint64_t ts_ns;            // CLOCK_REALTIME
+    AlogSite *site;
+} RecHdr;
+
+typedef struct {
+    const char *key;
+    uint32_t type;
+    uint32_t len;              // ALOG_STR: байт в хвосте записи
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+    } v;
+} RecField;
+
+// Запись для форматирования: из кольца или из binary-потока
+typedef struct {
+    const char *key;
+    int type;
+    uint32_t len;
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+    } v;
+    const char *s;
+} ViewField;
+
+typedef struct {
+    int level;
+    const char *event;
+    uint64_t ts_ns;
+    size_t n;
+    ViewField f[ALOG_MAX_FIELDS + 1];
+} View;
+
+typedef struct Ring {
+    struct Ring *next;
+    int state;
+    uint64_t head;             // байт записано (пишет владелец)
+    uint64_t tail;             // байт прочитано (пишет поток журнала)
+    uint64_t dropped;
+    uint64_t dropped_seen;     // уже выведено в alog.dropped
+    size_t cap;                // степень двойки
+    unsigned char *buf;
+} Ring;
+
+int alog_min_level = ALOG_INFO;
+
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+static pthread_key_t ring_key;
+static __thread Ring *my_ring;
+static Ring *rings;            // только добавление; кольца вышедших потоков переиспользуются
+static size_t ring_cap = 256 * 1024;
+static int format = FMT_TEXT;
+static const char *log_path;
+static int out_fd = 2;
+static pthread_t writer;
+static int writer_running;
+static uint64_t dropped_total;
+
+static AlogSite dropped_site = { ALOG_WARN, "alog.dropped", __FILE__, __LINE__, 0, 0, 0, 0 };
+
+// ---- вывод ----
+
+typedef struct {
+    char *data;
+    size_t len, cap;
+} Out;
+
+static void out_reserve(Out *o, size_t n) {
+    if (o->len + n <= o->cap) return;
+    size_t cap = o->cap ? o->cap : OUT_BUF;
+    while (cap < o->len + n) cap *= 2;
+    char *p = realloc(o->data, cap);
+    if (!p) return;
+    o->data = p;
+    o->cap = cap;
+}
+
+static void out_put(Out *o, const void *s, size_t n) {
+    out_reserve(o, n);
+    if (o->len + n > o->cap) return;
+    memcpy(o->data + o->len, s, n);
+    o->len += n;
+}
+
+static void out_fmt(Out *o, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static void out_fmt(Out *o, const char *fmt, ...) {
+    out_reserve(o, 64);
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(o->data + o->len, o->cap - o->len, fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    if ((size_t)n >= o->cap - o->len) {
+        out_reserve(o, (size_t)n + 1);
+        va_start(ap, fmt);
+        n = vsnprintf(o->data + o->len, o->cap - o->len, fmt, ap);
+        va_end(ap);
+        if (n < 0 || (size_t)n >= o->cap - o->len) return;
+    }
+    o->len += (size_t)n;
+}
+
+static void out_varint(Out *o, uint64_t x) {
+    unsigned char b[10];
+    size_t n = 0;
+    while (x >= 0x80) {
+        b[n++] = (unsigned char)(x | 0x80);
+        x >>= 7;
+    }
+    b[n++] = (unsigned char)x;
+    out_put(o, b, n);
+}
+
+static void out_write(int fd, Out *o) {
+    size_t off = 0;
+    while (off < o->len) {
+        ssize_t n = write(fd, o->data + off, o->len - off);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;     // приёмник сломан — вывод теряется, процесс живёт
+        off += (size_t)n;
+    }
+    o->len = 0;
+}
+
+static const char *level_name(int level) {
+    static const char *names[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+    return level >= 0 && level <= ALOG_ERROR ? names[level] : "?";
+}
+
+// Строка в кавычках; json — \u00XX для управляющих, иначе \xXX
+static void out_quoted(Out *o, const char *s, size_t n, int json) {
+    out_reserve(o, n + 2);
+    out_put(o, "\"", 1);
+    size_t run = 0;
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = (unsigned char)s[i];
+        const char *esc = NULL;
+        char hex[8];
+        if (c == '"') esc = "\\\"";
+        else if (c == '\\') esc = "\\\\";
+        else if (c == '\n') esc = "\\n";
+        else if (c == '\t') esc = "\\t";
+        else if (c == '\r') esc = "\\r";
+        else if (c < 0x20 || c == 0x7f) {
+            snprintf(hex, sizeof(hex), json ? "\\u%04x" : "\\x%02x", c);
+            esc = hex;
+        }
+        if (!esc) continue;
+        out_put(o, s + run, i - run);
+        out_put(o, esc, strlen(esc));
+        run = i + 1;
+    }
+    out_put(o, s + run, n - run);
+    out_put(o, "\"", 1);
+}
+
+static void out_value(Out *o, const ViewField *f, int json) {
+    switch (f->type) {
+        case ALOG_INT: out_fmt(o, "%lld", (long long)f->v.i); break;
+        case ALOG_UINT: out_fmt(o, "%llu", (unsigned long long)f->v.u); break;
+        case ALOG_DOUBLE:
+            if (f->v.d == f->v.d && f->v.d - f->v.d == 0) out_fmt(o, "%.6g", f->v.d);
+            else out_put(o, json ? "null" : "nan", json ? 4 : 3);
+            break;
+        case ALOG_STR: out_quoted(o, f->s, f->len, json); break;
+        default: out_put(o, json ? "null" : "?", json ? 4 : 1);
+    }
+}
+
+// Секунда форматируется один раз
+typedef struct {
+    time_t sec;
+    char local[24];            // 2026-10-19 12:34:56
+    char utc[24];              // 2026-10-19T12:34:56
+} Clock;
+
+static void clock_at(Clock *c, uint64_t ts_ns) {
+    time_t sec = (time_t)(ts_ns / 1000000000ull);
+    if (sec == c->sec && c->local[0]) return;
+    struct tm tm;
+    c->sec = sec;
+    localtime_r(&sec, &tm);
+    strftime(c->local, sizeof(c->local), "%Y-%m-%d %H:%M:%S", &tm);
+    gmtime_r(&sec, &tm);
+    strftime(c->utc, sizeof(c->utc), "%Y-%m-%dT%H:%M:%S", &tm);
+}
+
+static void format_view(Out *o, Clock *c, const View *v, int json) {
+    clock_at(c, v->ts_ns);
+    unsigned ms = (unsigned)(v->ts_ns / 1000000ull % 1000ull);
+    if (json) {
+        out_fmt(o, "{\"ts\":\"%s.%03uZ\",\"level\":\"%s\",\"event\":", c->utc, ms, level_name(v->level));
+        out_quoted(o, v->event, strlen(v->event), 1);
+        for (size_t i = 0; i < v->n; i++) {
+            out_put(o, ",", 1);
+            out_quoted(o, v->f[i].key, strlen(v->f[i].key), 1);
+            out_put(o, ":", 1);
+            out_value(o, &v->f[i], 1);
+        }
+        out_put(o, "}\n", 2);
+        return;
+    }
+    out_fmt(o, "%s.%03u %-5s %s", c->local, ms, level_name(v->level), v->event);
+    for (size_t i = 0; i < v->n; i++) {
+        out_fmt(o, " %s=", v->f[i].key);
+        out_value(o, &v->f[i], 0);
+    }
+    out_put(o, "\n", 1);
+}
+
+// ---- binary: строки и места вызова — номерами ----
+
+typedef struct {
+    const void *ptr;
+    uint32_t id;
+} InternEnt;
+
+typedef struct {
+    InternEnt *tab;
+    size_t cap, n;
+    uint32_t next_id;
+    uint64_t last_ts;
+} Intern;
+
+static void intern_reset(Intern *in) {
+    free(in->tab);
+    memset(in, 0, sizeof(*in));
+}
+
+// id указателя; *fresh = 1, если он новый и его определение надо записать
+static uint32_t intern(Intern *in, const void *ptr, int *fresh) {
+    *fresh = 0;
+    if ((in->n + 1) * 2 > in->cap) {
+        size_t cap = in->cap ? in->cap * 2 : 256;
+        InternEnt *tab = calloc(cap, sizeof(InternEnt));
+        if (!tab) return 0;
+        for (size_t i = 0; i < in->cap; i++) {
+            if (!in->tab[i].ptr) continue;
+            size_t j = ((uintptr_t)in->tab[i].ptr >> 3) * 0x9e3779b97f4a7c15ull & (cap - 1);
+            while (tab[j].ptr) j = (j + 1) & (cap - 1);
+            tab[j] = in->tab[i];
+        }
+        free(in->tab);
+        in->tab = tab;
+        in->cap = cap;
+    }
+    size_t j = ((uintptr_t)ptr >> 3) * 0x9e3779b97f4a7c15ull & (in->cap - 1);
+    while (in->tab[j].ptr) {
+        if (in->tab[j].ptr == ptr) return in->tab[j].id;
+        j = (j + 1) & (in->cap - 1);
+    }
+    in->tab[j].ptr = ptr;
+    in->tab[j].id = ++in->next_id;
+    in->n++;
+    *fresh = 1;
+    return in->next_id;
+}
+
+static uint32_t intern_str(Out *o, Intern *in, const char *s) {
+    int fresh;
+    uint32_t id = intern(in, s, &fresh);
+    if (fresh) {
+        size_t n = strlen(s);
+        out_varint(o, TAG_STR);
+        out_varint(o, id);
+        out_varint(o, n);
+        out_put(o, s, n);
+    }
+    return id;
+}
+
+static void binary_view(Out *o, Intern *in, const AlogSite *site, const View *v) {
+    int fresh;
+    uint32_t sid = intern(in, site, &fresh);
+    if (fresh) {
+        uint32_t ev = intern_str(o, in, site->event), file = intern_str(o, in, site->file);
+        out_varint(o, TAG_SITE);
+        out_varint(o, sid);
+        out_varint(o, (uint64_t)site->level);
+        out_varint(o, ev);
+        out_varint(o, file);
+        out_varint(o, (uint64_t)site->line);
+    }
+    uint32_t keys[ALOG_MAX_FIELDS + 1];
+    for (size_t i = 0; i < v->n; i++) keys[i] = intern_str(o, in, v->f[i].key);
+    // потоки перемежаются — разница со знаком (zigzag)
+    int64_t dt = (int64_t)(v->ts_ns - in->last_ts);
+    in->last_ts = v->ts_ns;
+    out_varint(o, TAG_REC);
+    out_varint(o, sid);
+    out_varint(o, ((uint64_t)dt << 1) ^ (uint64_t)(dt >> 63));
+    out_varint(o, v->n);
+    for (size_t i = 0; i < v->n; i++) {
+        const ViewField *f = &v->f[i];
+        out_varint(o, keys[i]);
+        out_varint(o, (uint64_t)f->type);
+        if (f->type == ALOG_INT) out_varint(o, ((uint64_t)f->v.i << 1) ^ (uint64_t)(f->v.i >> 63));
+        else if (f->type == ALOG_UINT) out_varint(o, f->v.u);
+        else if (f->type == ALOG_DOUBLE) out_put(o, &f->v.d, sizeof(double));
+        else {
+            out_varint(o, f->len);
+            out_put(o, f->s, f->len);
+        }
+    }
+}
+
+// ---- поток журнала ----
+
+static Out out;
+static Clock clk;
+static Intern interned;
+
+static void emit(const AlogSite *site, const View *v) {
+    if (format == FMT_BINARY) binary_view(&out, &interned, site, v);
+    else format_view(&out, &clk, v, format == FMT_JSON);
+}
+
+static int drain_ring(Ring *r) {
+    uint64_t tail = r->tail;
+    uint64_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+    int any = tail != head;
+    while (tail != head) {
+        const unsigned char *p = r->buf + (tail & (r->cap - 1));
+        RecHdr h;
+        // от pad до конца кольца может быть всего 8 байт
+        memcpy(&h, p, sizeof(uint64_t));
+        if (h.pad) {
+            tail += h.size;
+            continue;
+        }
+        memcpy(&h, p, sizeof(h));
+        View v = { .level = h.site->level, .event = h.site->event, .ts_ns = h.ts_ns, .n = h.n };
+        const RecField *rf = (const RecField *)(p + sizeof(RecHdr));
+        const char *s = (const char *)(rf + h.n);
+        for (size_t i = 0; i < h.n; i++) {
+            ViewField *f = &v.f[i];
+            f->key = rf[i].key;
+            f->type = (int)rf[i].type;
+            f->len = rf[i].len;
+            if (f->type == ALOG_STR) {
+                f->s = s;
+                s += rf[i].len;
+            } else {
+                memcpy(&f->v, &rf[i].v, sizeof(f->v));
+            }
+        }
+        emit(h.site, &v);
+        tail += h.size;
+    }
+    uint64_t dropped = __atomic_load_n(&r->dropped, __ATOMIC_RELAXED);
+    if (dropped != r->dropped_seen) {
+        View v = { .level = ALOG_WARN, .event = dropped_site.event, .n = 1 };
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        v.ts_ns = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+        v.f[0] = (ViewField){ .key = "records", .type = ALOG_UINT, .v.u = dropped - r->dropped_seen };
+        emit(&dropped_site, &v);
+        r->dropped_seen = dropped;
+        any = 1;
+    }
+    // хвост двигается после форматирования: строки полей читаются из кольца
+    if (out.len) out_write(out_fd, &out);
+    __atomic_store_n(&r->tail, tail, __ATOMIC_RELEASE);
+    return any;
+}
+
+static void *writer_main(void *arg) {
+    (void)arg;
+    unsigned idle_ms = 1;
+    for (;;) {
+        int any = 0;
+        for (Ring *r = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); r; r = r->next) {
+            int st = __atomic_load_n(&r->state, __ATOMIC_ACQUIRE);
+            if (st == RING_FREE) continue;
+            any |= drain_ring(r);
+            // поток вышел и всё выведено — кольцо можно отдать новому
+            if (st == RING_ORPHAN && r->tail == __atomic_load_n(&r->head, __ATOMIC_ACQUIRE))
+                __atomic_store_n(&r->state, RING_FREE, __ATOMIC_RELEASE);
+        }
+        // писатели не будят поток журнала: под нагрузкой — без пауз,
+        // в простое опрос всё реже
+        if (any) {
+            idle_ms = 1;
+            continue;
+        }
+        struct timespec ts = { 0, (long)idle_ms * 1000000L };
+        if (idle_ms < IDLE_MAX_MS) idle_ms = idle_ms * 2 > IDLE_MAX_MS ? IDLE_MAX_MS : idle_ms * 2;
+        nanosleep(&ts, NULL);
+    }
+    return NULL;
+}
+
+static void open_output(int child) {
+    if (!log_path) return;
+    char path[4096];
+    if (child && format == FMT_BINARY) snprintf(path, sizeof(path), "%s.%d", log_path, (int)getpid());
+    else snprintf(path, sizeof(path), "%s", log_path);
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "alog: cannot open %s: %s\n", path, strerror(errno));
+        return;
+    }
+    if (out_fd > 2) close(out_fd);
+    out_fd = fd;
+}
+
+static void start_writer(void) {
+    if (format == FMT_BINARY) {
+        intern_reset(&interned);
+        out_put(&out, ALOG_MAGIC, sizeof(ALOG_MAGIC) - 1);
+        out_write(out_fd, &out);
+    }
+    // поток журнала не должен получать сигналы процесса
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    writer_running = pthread_create(&writer, NULL, writer_main, NULL) == 0;
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+}
+
+// Потоков родителя в ребёнке нет: их записи выведет родитель, кольца свободны
+static void after_fork_child(void) {
+    for (Ring *r = rings; r; r = r->next) {
+        r->tail = r->head;
+        r->dropped_seen = r->dropped;
+        if (r != my_ring && r->state == RING_USED) r->state = RING_FREE;
+    }
+    out.len = 0;
+    open_output(1);
+    start_writer();
+}
+
+static void ring_release(void *p) {
+    Ring *r = p;
+    __atomic_store_n(&r->state, RING_ORPHAN, __ATOMIC_RELEASE);
+}
+
+static void setup(void) {
+    const char *env = getenv("OXXYEN_LOG_LEVEL");
+    if (env) {
+        if (strcmp(env, "debug") == 0) alog_min_level = ALOG_DEBUG;
+        else if (strcmp(env, "warn") == 0) alog_min_level = ALOG_WARN;
+        else if (strcmp(env, "error") == 0) alog_min_level = ALOG_ERROR;
+        else alog_min_level = ALOG_INFO;
+    }
+    if ((env = getenv("OXXYEN_LOG_FORMAT"))) {
+        if (strcmp(env, "json") == 0) format = FMT_JSON;
+        else if (strcmp(env, "binary") == 0) format = FMT_BINARY;
+    }
+    if ((env = getenv("OXXYEN_LOG_RING_KB")) && atoi(env) > 0) {
+        size_t want = (size_t)atoi(env) * 1024, cap = 4096;
+        while (cap < want) cap *= 2;
+        ring_cap = cap;
+    }
+    if ((env = getenv("OXXYEN_LOG_FILE")) && *env) log_path = env;
+    open_output(0);
+    // binary на терминал бессмыслен — текст
+    if (format == FMT_BINARY && isatty(out_fd)) format = FMT_TEXT;
+    pthread_key_create(&ring_key, ring_release);
+    pthread_atfork(NULL, NULL, after_fork_child);
+    start_writer();
+    atexit(alog_flush);
+}
+
+void alog_init(void) {
+    pthread_once(&once, setup);
+}
+
+// Кольцо потока: свободное из вышедших потоков или новое
+static Ring *ring_get(void) {
+    if (my_ring) return my_ring;
+    pthread_once(&once, setup);
+    Ring *r;
+    for (r = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); r; r = r->next) {
+        int st = RING_FREE;
+        if (r->cap == ring_cap &&
+            __atomic_compare_exchange_n(&r->state, &st, RING_USED, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            break;
+    }
+    if (!r) {
+        r = calloc(1, sizeof(*r));
+        if (!r) return NULL;
+        r->cap = ring_cap;
+        r->buf = malloc(r->cap);
+        if (!r->buf) {
+            free(r);
+            return NULL;
+        }
+        r->next = __atomic_load_n(&rings, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&rings, &r->next, r, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {}
+    }
+    my_ring = r;
+    pthread_setspecific(ring_key, r);
+    return r;
+}
+
+// Лимит ALOG_RL: окно в секунду на место вызова; гонки между потоками
+// дают погрешность в пару записей, не больше
+static int rate_ok(AlogSite *s, uint64_t ts_ns, uint64_t *suppressed) {
+    uint64_t sec = ts_ns / 1000000000ull;
+    uint64_t w = __atomic_load_n(&s->window, __ATOMIC_RELAXED);
+    if (w != sec && __atomic_compare_exchange_n(&s->window, &w, sec, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        __atomic_store_n(&s->count, 0, __ATOMIC_RELAXED);
+    if (__atomic_fetch_add(&s->count, 1, __ATOMIC_RELAXED) >= s->per_sec) {
+        __atomic_fetch_add(&s->suppressed, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+    *suppressed = __atomic_load_n(&s->suppressed, __ATOMIC_RELAXED)
+        ? __atomic_exchange_n(&s->suppressed, 0, __ATOMIC_RELAXED) : 0;
+    return 1;
+}
+
+void alog_write(AlogSite *site, const AlogField *f, size_t n) {
+    Ring *r = ring_get();
+    if (!r) return;
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    uint64_t ts_ns = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+    uint64_t suppressed = 0;
+    if (site->per_sec && !rate_ok(site, ts_ns, &suppressed)) return;
+    if (n > ALOG_MAX_FIELDS) n = ALOG_MAX_FIELDS;
+
+    uint32_t lens[ALOG_MAX_FIELDS];
+    size_t size = sizeof(RecHdr) + (n + (suppressed != 0)) * sizeof(RecField);
+    for (size_t i = 0; i < n; i++) {
+        lens[i] = 0;
+        if (f[i].type != ALOG_STR) continue;
+        const char *s = f[i].v.s ? f[i].v.s : "(null)";
+        size_t len = strnlen(s, ALOG_MAX_STR);
+        // обрезка — по границе символа UTF-8
+        if (len == ALOG_MAX_STR)
+            while (len > 0 && ((unsigned char)s[len] & 0xC0) == 0x80) len--;
+        lens[i] = (uint32_t)len;
+        size += len;
+    }
+    size = (size + 7) & ~(size_t)7;
+
+    uint64_t head = r->head;
+    uint64_t tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+    size_t off = (size_t)(head & (r->cap - 1)), room = r->cap - off;
+    size_t need = room < size ? room + size : size;
+    if (size > r->cap / 2 || head + need - tail > r->cap) {
+        __atomic_fetch_add(&r->dropped, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&dropped_total, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    if (room < size) {
+        RecHdr pad = { .size = (uint32_t)room, .pad = 1 };
+        memcpy(r->buf + off, &pad, sizeof(uint64_t));
+        head += room;
+        off = 0;
+    }
+    unsigned char *p = r->buf + off;
+    RecHdr h = { .size = (uint32_t)size, .n = (uint16_t)(n + (suppressed != 0)), .ts_ns = ts_ns, .site = site };
+    memcpy(p, &h, sizeof(h));
+    RecField *rf = (RecField *)(p + sizeof(RecHdr));
+    char *s = (char *)(rf + h.n);
+    for (size_t i = 0; i < n; i++) {
+        rf[i].key = f[i].key;
+        rf[i].type = (uint32_t)f[i].type;
+        rf[i].len = lens[i];
+        if (f[i].type == ALOG_STR) {
+            memcpy(s, f[i].v.s ? f[i].v.s : "(null)", lens[i]);
+            s += lens[i];
+        } else {
+            memcpy(&rf[i].v, &f[i].v, sizeof(rf[i].v));
+        }
+    }
+    if (suppressed) rf[n] = (RecField){ .key = "suppressed", .type = ALOG_UINT, .v.u = suppressed };
+    __atomic_store_n(&r->head, head + size, __ATOMIC_RELEASE);
+}
+
+void alog_flush(void) {
+    if (!writer_running) return;
+    struct timespec t0, now;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (Ring *r = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); r; r = r->next) {
+        uint64_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        while (__atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) < head) {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if (now.tv_sec - t0.tv_sec >= 1) return;
+            struct timespec ts = { 0, 1000000L };
+            nanosleep(&ts, NULL);
+        }
+    }
+}
+
+uint64_t alog_dropped(void) {
+    return __atomic_load_n(&dropped_total, __ATOMIC_RELAXED);
+}
+
+// ---- чтение binary ----
+
+static int read_varint(FILE *in, uint64_t *x) {
+    *x = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = getc(in);
+        if (c == EOF) return -1;
+        *x |= (uint64_t)(c & 0x7f) << shift;
+        if (!(c & 0x80)) return 0;
+    }
+    return -1;
+}
+
+typedef struct {
+    uint32_t level, event, file, line;
+} SiteDef;
+
+// Таблица по id: id выдаются подряд с 1
+typedef struct {
+    void *items;
+    size_t n, size;
+} Table;
+
+static void *table_slot(Table *t, uint64_t id) {
+    if (id == 0 || id > (1u << 24)) return NULL;
+    if (id >= t->n) {
+        size_t n = t->n ? t->n : 256;
+        while (n <= id) n *= 2;
+        void *p = realloc(t->items, n * t->size);
+        if (!p) return NULL;
+        memset((char *)p + t->n * t->size, 0, (n - t->n) * t->size);
+        t->items = p;
+        t->n = n;
+    }
+    return (char *)t->items + id * t->size;
+}
+
+static const char *table_str(Table *strs, uint64_t id) {
+    char **p = id < strs->n ? (char **)table_slot(strs, id) : NULL;
+    return p && *p ? *p : "?";
+}
+
+int alog_decode(FILE *in, FILE *outf, int json) {
+    char magic[sizeof(ALOG_MAGIC) - 1];
+    if (fread(magic, 1, sizeof(magic), in) != sizeof(magic) || memcmp(magic, ALOG_MAGIC, sizeof(magic)) != 0)
+        return -1;
+    Table strs = { .size = sizeof(char *) }, sites = { .size = sizeof(SiteDef) };
+    Out o = {0};
+    Clock c = {0};
+    char *vals = malloc((size_t)(ALOG_MAX_FIELDS + 1) * ALOG_MAX_STR);
+    uint64_t ts = 0;
+    int rc = -1;
+    if (!vals) return -1;
+
+    for (;;) {
+        uint64_t tag, id, x;
+        if (read_varint(in, &tag) != 0) {
+            rc = feof(in) ? 0 : -1;
+            break;
+        }
+        if (tag == TAG_STR) {
+            char **slot;
+            if (read_varint(in, &id) != 0 || read_varint(in, &x) != 0 || x > (1u << 20) ||
+                !(slot = table_slot(&strs, id))) break;
+            char *s = malloc(x + 1);
+            if (!s || fread(s, 1, x, in) != x) {
+                free(s);
+                break;
+            }
+            s[x] = '\0';
+            free(*slot);
+            *slot = s;
+        } else if (tag == TAG_SITE) {
+            uint64_t level, ev, file, line;
+            SiteDef *sd;
+            if (read_varint(in, &id) != 0 || read_varint(in, &level) != 0 || read_varint(in, &ev) != 0 ||
+                read_varint(in, &file) != 0 || read_varint(in, &line) != 0 || !(sd = table_slot(&sites, id))) break;
+            *sd = (SiteDef){ (uint32_t)level, (uint32_t)ev, (uint32_t)file, (uint32_t)line };
+        } else if (tag == TAG_REC) {
+            uint64_t n;
+            if (read_varint(in, &id) != 0 || read_varint(in, &x) != 0 || read_varint(in, &n) != 0 ||
+                n > ALOG_MAX_FIELDS + 1) break;
+            SiteDef *sd = id < sites.n ? table_slot(&sites, id) : NULL;
+            if (!sd) break;
+            ts += (uint64_t)((int64_t)(x >> 1) ^ -(int64_t)(x & 1));
+            View v = { .level = (int)sd->level, .event = table_str(&strs, sd->event), .ts_ns = ts, .n = n };
+            int ok = 1;
+            for (size_t i = 0; i < n && ok; i++) {
+                ViewField *f = &v.f[i];
+                uint64_t key, type, val;
+                ok = read_varint(in, &key) == 0 && read_varint(in, &type) == 0;
+                if (!ok) break;
+                f->key = table_str(&strs, key);
+                f->type = (int)type;
+                if (type == ALOG_DOUBLE) {
+                    ok = fread(&f->v.d, sizeof(double), 1, in) == 1;
+                } else if (type == ALOG_STR) {
+                    ok = read_varint(in, &val) == 0 && val <= ALOG_MAX_STR;
+                    f->s = vals + i * ALOG_MAX_STR;
+                    f->len = (uint32_t)val;
+                    ok = ok && fread(vals + i * ALOG_MAX_STR, 1, val, in) == val;
+                } else {
+                    ok = read_varint(in, &val) == 0;
+                    if (type == ALOG_INT) f->v.i = (int64_t)(val >> 1) ^ -(int64_t)(val & 1);
+                    else f->v.u = val;
+                }
+            }
+            if (!ok) break;
+            format_view(&o, &c, &v, json);
+            if (o.len >= OUT_BUF) {
+                fwrite(o.data, 1, o.len, outf);
+                o.len = 0;
+            }
+        } else {
+            break;
+        }
+    }
+    if (o.len) fwrite(o.data, 1, o.len, outf);
+    for (size_t i = 1; i < strs.n; i++) free(((char **)strs.items)[i]);
+    free(strs.items);
+    free(sites.items);
+    free(o.data);
+    free(vals);
+    return rc;
+}
@@ -0,0 +1,98 @@
+// alog.h — асинхронный структурированный журнал
+//
+// Горячий путь не форматирует и не пишет: запись (уровень, событие и поля
+// ключ=значение) копируется в кольцо своего потока — писатель один,
+// читатель один, без блокировок и системных вызовов, — а поток журнала
+// форматирует записи и пишет их пачками. Медленный приёмник (journald за
+// трубой) задерживает только поток журнала: кольцо переполнилось — запись
+// теряется, счёт потерь выводится событием alog.dropped.
+// Порядок записей сохраняется внутри потока; записи разных потоков
+// перемежаются с точностью до прохода потока журнала (миллисекунды).
+//
+// Строковые поля копируются (не длиннее ALOG_MAX_STR байт). Имена событий и
+// ключей не копируются — только строковые литералы.
+//
+//   ALOG(ALOG_INFO, "message", AF_I("chat", id), AF_S("text", text));
+//   ALOG_RL(ALOG_WARN, 10, "skip", AF_S("url", url));   // ≤ 10 в секунду
+// ALOG_RL ограничивает частоту на место вызова; у первой записи после
+// пропусков — поле suppressed с их числом.
+//
+// Окружение:
+//   OXXYEN_LOG_LEVEL=debug|info|warn|error  — порог (info)
+//   OXXYEN_LOG_FORMAT=text|json|binary      — формат (text)
+//   OXXYEN_LOG_FILE=PATH                    — файл, дописывается (stderr)
+//   OXXYEN_LOG_RING_KB=N                    — кольцо потока (256)
+// binary — компактный поток для alogcat: строки (события, ключи, файлы)
+// пишутся один раз и дальше идут номерами, числа — varint, время — разница
+// с предыдущей записью. После fork дочерний процесс начинает свой поток:
+// в binary — в PATH.<pid>, в text/json — в тот же файл (O_APPEND).
+//
+// Поток журнала запускается при первой записи; alog_init только раньше
+// читает окружение (чтобы порог действовал с первой записи). При exit
+// записанное до него выводится (atexit → alog_flush).
+
+#ifndef ALOG_H
+#define ALOG_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define ALOG_MAX_STR 1024
+#define ALOG_MAX_FIELDS 16
+
+enum { ALOG_DEBUG, ALOG_INFO, ALOG_WARN, ALOG_ERROR };
+enum { ALOG_INT = 1, ALOG_UINT, ALOG_DOUBLE, ALOG_STR };
+
+// Место вызова: одно на макрос, статическое
+typedef struct {
+    int level;
+    const char *event;
+    const char *file;
+    int line;
+    uint32_t per_sec;          // ALOG_RL; 0 — без ограничения
+    uint32_t count;            // записей в текущей секунде
+    uint64_t window;
+    uint64_t suppressed;
+} AlogSite;
+
+typedef struct {
+    const char *key;
+    int type;
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+        const char *s;
+    } v;
+} AlogField;
+
+#define AF_I(k, x) { .key = (k), .type = ALOG_INT, .v.i = (int64_t)(x) }
+#define AF_U(k, x) { .key = (k), .type = ALOG_UINT, .v.u = (uint64_t)(x) }
+#define AF_F(k, x) { .key = (k), .type = ALOG_DOUBLE, .v.d = (double)(x) }
+#define AF_S(k, x) { .key = (k), .type = ALOG_STR, .v.s = (x) }
+
+extern int alog_min_level;
+
+#define ALOG(level, event, ...) ALOG_RL(level, 0, event, __VA_ARGS__)
+
+#define ALOG_RL(level, per_sec, event, ...) do {                                      \
+    if ((level) >= alog_min_level) {                                                  \
+        static AlogSite alog_site_ = { (level), (event), __FILE__, __LINE__, (per_sec), 0, 0, 0 }; \
+        const AlogField alog_f_[] = { { 0 }, __VA_ARGS__ };                            \
+        alog_write(&alog_site_, alog_f_ + 1, sizeof(alog_f_) / sizeof(alog_f_[0]) - 1); \
+    }                                                                                 \
+} while (0)
+
+void alog_init(void);
+void alog_write(AlogSite *site, const AlogField *f, size_t n);
+
+// Ждёт, пока поток журнала выведет всё записанное до вызова (не дольше 1 с)
+void alog_flush(void);
+
+// Записи, потерянные из-за полных колец, за всё время
+uint64_t alog_dropped(void);
+
+// Binary-поток → текст или JSON (alogcat); 0 или -1 (формат, обрыв)
+int alog_decode(FILE *in, FILE *out, int json);
+
+#endif // ALOG_H
@@ -0,0 +1,40 @@
+// alogcat.c — binary-журнал alog (OXXYEN_LOG_FORMAT=binary) в текст или JSON Lines
+// gcc -O2 -o alogcat alogcat.c alog.c -pthread
+// ./alogcat [--json] [FILE|-]...
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "alog.h"
+
+int main(int argc, char *argv[]) {
+    int json = 0, files = 0, rc = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = 1;
+            continue;
+        }
+        if (argv[i][0] == '-' && argv[i][1]) {
+            fprintf(stderr, "Usage: %s [--json] [FILE|-]...\n", argv[0]);
+            return 1;
+        }
+        files++;
+        FILE *f = strcmp(argv[i], "-") == 0 ? stdin : fopen(argv[i], "rb");
+        if (!f) {
+            fprintf(stderr, "Error: cannot open '%s': %s\n", argv[i], strerror(errno));
+            rc = 1;
+            continue;
+        }
+        if (alog_decode(f, stdout, json) != 0) {
+            fprintf(stderr, "Error: '%s' is not an alog binary log or is truncated\n", argv[i]);
+            rc = 1;
+        }
+        if (f != stdin) fclose(f);
+    }
+    if (!files && alog_decode(stdin, stdout, json) != 0) {
+        fprintf(stderr, "Error: stdin is not an alog binary log or is truncated\n");
+        rc = 1;
+    }
+    return rc;
+}
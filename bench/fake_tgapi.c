@@ -0,0 +1,861 @@
+// fake_tgapi.c — локальная подмена Telegram Bot API для нагрузочных тестов
+// gcc -O2 -o fake_tgapi fake_tgapi.c
+// ./fake_tgapi [--port N(8081)] [--bind ADDR(127.0.0.1)] [--log FILE]
+//
+// Один поток, epoll, HTTP/1.1 keep-alive. Понимает то, что шлют telebot
+// (main.c, stable.c) и tg_load: /bot<token>/<method> с параметрами в query,
+// x-www-form-urlencoded, multipart/form-data или JSON.
+//   getMe, getUpdates  — синтетические апдейты из очереди; timeout > 0 —
+//                        long polling (соединение ждёт апдейтов или таймаута)
+//   send*              — запоминаются с отметкой времени; ответ сопоставляется
+//                        с апдейтом того же чата (по reply_to_message_id, иначе
+//                        самый старый без ответа) → задержка апдейт→ответ
+//   остальные методы   — {"ok":true,"result":true}
+// Управление (tg_load):
+//   POST /_inject — JSONL: {"chat_id":N,"text":"...","first_name":"..."} на строку
+//   GET  /_stats  — JSON: счётчики, p50/p90/p99/p999 задержек, пропускная способность
+//   POST /_reset  — очистить очередь и статистику, отпустить ждущие getUpdates
+// --log: по строке на send*: t_us, метод, chat_id, reply_to, задержка_us (TSV)
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <strings.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#define MAX_EVENTS 256
+#define MAX_REQUEST (16 * 1024 * 1024)
+#define MAX_PARAM 4096
+#define DEFAULT_LIMIT 100
+#define MAX_POLL_TIMEOUT 50        // секунд, как у настоящего API
+
+// === Время и буферы ===
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+typedef struct {
+    char *data;
+    size_t len, cap;
+} Buf;
+
+static int buf_reserve(Buf *b, size_t extra) {
+    if (b->len + extra + 1 <= b->cap) return 0;
+    size_t cap = b->cap ? b->cap : 4096;
+    while (cap < b->len + extra + 1) cap *= 2;
+    char *p = realloc(b->data, cap);
+    if (!p) return -1;
+    b->data = p;
+    b->cap = cap;
+    return 0;
+}
+
+static int buf_append(Buf *b, const char *s, size_t n) {
+    if (buf_reserve(b, n) != 0) return -1;
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+    b->data[b->len] = '\0';
+    return 0;
+}
+
+static int buf_printf(Buf *b, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static int buf_printf(Buf *b, const char *fmt, ...) {
+    va_list ap;
+    for (;;) {
+        size_t room = b->cap > b->len ? b->cap - b->len : 0;
+        va_start(ap, fmt);
+        int n = vsnprintf(b->data ? b->data + b->len : NULL, room, fmt, ap);
+        va_end(ap);
+        if (n < 0) return -1;
+        if ((size_t)n < room) { b->len += (size_t)n; return 0; }
+        if (buf_reserve(b, (size_t)n) != 0) return -1;
+    }
+}
+
+// === Разбор параметров ===
+
+typedef struct {
+    char method[16];
+    char path[1024];
+    const char *query;         // после '?' в path или NULL
+    char content_type[256];
+    const char *body;
+    size_t body_len;
+    int keep_alive;
+} Request;
+
+static int hexv(int c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static size_t url_decode(const char *s, size_t n, char *out, size_t cap) {
+    size_t w = 0;
+    for (size_t i = 0; i < n && w + 1 < cap; i++) {
+        if (s[i] == '+') out[w++] = ' ';
+        else if (s[i] == '%' && i + 2 < n && hexv(s[i + 1]) >= 0 && hexv(s[i + 2]) >= 0) {
+            out[w++] = (char)(hexv(s[i + 1]) << 4 | hexv(s[i + 2]));
+            i += 2;
+        } else {
+            out[w++] = s[i];
+        }
+    }
+    out[w] = '\0';
+    return w;
+}
+
+static int form_param(const char *s, size_t n, const char *name, char *out, size_t cap) {
+    size_t nl = strlen(name);
+    for (size_t i = 0; i < n;) {
+        size_t end = i;
+        while (end < n && s[end] != '&') end++;
+        const char *eq = memchr(s + i, '=', end - i);
+        if (eq && (size_t)(eq - s - i) == nl && memcmp(s + i, name, nl) == 0) {
+            url_decode(eq + 1, (size_t)(s + end - eq - 1), out, cap);
+            return 0;
+        }
+        i = end + 1;
+    }
+    return -1;
+}
+
+static int multipart_param(const Request *r, const char *name, char *out, size_t cap) {
+    const char *b = strstr(r->content_type, "boundary=");
+    if (!b) return -1;
+    char boundary[128];
+    b += 9;
+    if (*b == '"') b++;
+    size_t bl = strcspn(b, "\";");
+    if (bl == 0 || bl + 2 >= sizeof(boundary)) return -1;
+    boundary[0] = '-';
+    boundary[1] = '-';
+    memcpy(boundary + 2, b, bl);
+    bl += 2;
+    boundary[bl] = '\0';
+
+    char needle[160];
+    snprintf(needle, sizeof(needle), "name=\"%s\"", name);
+    const char *p = r->body, *end = r->body + r->body_len;
+    while ((p = memmem(p, (size_t)(end - p), boundary, bl))) {
+        p += bl;
+        const char *hdr_end = memmem(p, (size_t)(end - p), "\r\n\r\n", 4);
+        if (!hdr_end) break;
+        if (memmem(p, (size_t)(hdr_end - p), needle, strlen(needle))) {
+            const char *v = hdr_end + 4;
+            const char *ve = memmem(v, (size_t)(end - v), boundary, bl);
+            if (!ve) ve = end;
+            if (ve - v >= 2 && ve[-2] == '\r' && ve[-1] == '\n') ve -= 2;
+            size_t n = (size_t)(ve - v) < cap - 1 ? (size_t)(ve - v) : cap - 1;
+            memcpy(out, v, n);
+            out[n] = '\0';
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Значение поля "key" в JSON без полного разбора: строки отдаются как есть
+// (ещё экранированными), числа и литералы — до разделителя
+static int json_field(const char *s, size_t n, const char *key, const char **val, size_t *vlen, int *is_str) {
+    size_t kl = strlen(key);
+    const char *end = s + n;
+    for (const char *p = s; (p = memmem(p, (size_t)(end - p), key, kl)); p += kl) {
+        if (p == s || p[-1] != '"' || p + kl >= end || p[kl] != '"') continue;
+        if (p - 1 > s && p[-2] == '\\') continue;
+        const char *q = p + kl + 1;
+        while (q < end && (*q == ' ' || *q == '\t' || *q == '\n' || *q == '\r')) q++;
+        if (q >= end || *q != ':') continue;
+        q++;
+        while (q < end && (*q == ' ' || *q == '\t' || *q == '\n' || *q == '\r')) q++;
+        if (q < end && *q == '"') {
+            const char *v = ++q;
+            while (q < end && *q != '"') q += *q == '\\' ? 2 : 1;
+            if (q > end) q = end;
+            *val = v;
+            *vlen = (size_t)(q - v);
+            if (is_str) *is_str = 1;
+            return 0;
+        }
+        const char *v = q;
+        while (q < end && *q != ',' && *q != '}' && *q != ']' && *q != ' ' && *q != '\n' && *q != '\r') q++;
+        *val = v;
+        *vlen = (size_t)(q - v);
+        if (is_str) *is_str = 0;
+        return 0;
+    }
+    return -1;
+}
+
+static int get_param(const Request *r, const char *name, char *out, size_t cap) {
+    if (r->query && form_param(r->query, strlen(r->query), name, out, cap) == 0) return 0;
+    if (!r->body_len) return -1;
+    if (strncasecmp(r->content_type, "multipart/form-data", 19) == 0) return multipart_param(r, name, out, cap);
+    if (strncasecmp(r->content_type, "application/json", 16) == 0) {
+        const char *v;
+        size_t n;
+        if (json_field(r->body, r->body_len, name, &v, &n, NULL) != 0) return -1;
+        if (n >= cap) n = cap - 1;
+        memcpy(out, v, n);
+        out[n] = '\0';
+        return 0;
+    }
+    return form_param(r->body, r->body_len, name, out, cap);
+}
+
+static long long param_ll(const Request *r, const char *name, long long def) {
+    char v[64];
+    return get_param(r, name, v, sizeof(v)) == 0 && v[0] ? strtoll(v, NULL, 10) : def;
+}
+
+// === Очередь апдейтов и ожидающие ответа сообщения ===
+
+typedef struct {
+    long long id;
+    uint64_t t_inject;
+    char *json;
+    size_t len;
+} Update;
+
+typedef struct {
+    long long msg_id;
+    uint64_t t;
+    uint32_t next;             // индекс в pool, UINT32_MAX — конец
+} Pending;
+
+typedef struct {
+    long long chat;
+    uint32_t head, tail;
+    int used;
+} ChatSlot;
+
+typedef struct {
+    uint32_t *v;
+    size_t n, cap;
+} Samples;
+
+static struct {
+    Update *updates;
+    size_t n_updates, cap_updates, head;   // head — первый неподтверждённый
+    long long next_update_id, next_message_id;
+    long long delivered_upto;              // последний отданный update_id
+
+    ChatSlot *chats;
+    size_t chats_cap, chats_used;
+    Pending *pool;
+    size_t pool_len, pool_cap;
+    uint32_t free_list;
+
+    Samples reply_lat, deliver_lat;
+    uint64_t injected, delivered, replies, matched, unmatched, pending;
+    uint64_t polls, empty_polls, requests;
+    uint64_t t_first_inject, t_last_reply;
+    FILE *log;
+} S = { .free_list = UINT32_MAX };
+
+static int samples_add(Samples *s, uint64_t us) {
+    if (s->n == s->cap) {
+        size_t cap = s->cap ? s->cap * 2 : 65536;
+        uint32_t *p = realloc(s->v, cap * sizeof(*p));
+        if (!p) return -1;
+        s->v = p;
+        s->cap = cap;
+    }
+    s->v[s->n++] = us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+    return 0;
+}
+
+static uint64_t mix(long long x) {
+    uint64_t z = (uint64_t)x + 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static ChatSlot *chat_slot(long long chat, int create) {
+    if (create && (S.chats_used + 1) * 2 > S.chats_cap) {
+        size_t cap = S.chats_cap ? S.chats_cap * 2 : 1024;
+        ChatSlot *t = calloc(cap, sizeof(*t));
+        if (!t) return NULL;
+        for (size_t i = 0; i < S.chats_cap; i++) {
+            if (!S.chats[i].used) continue;
+            size_t k = mix(S.chats[i].chat) & (cap - 1);
+            while (t[k].used) k = (k + 1) & (cap - 1);
+            t[k] = S.chats[i];
+        }
+        free(S.chats);
+        S.chats = t;
+        S.chats_cap = cap;
+    }
+    if (!S.chats_cap) return NULL;
+    size_t k = mix(chat) & (S.chats_cap - 1);
+    while (S.chats[k].used) {
+        if (S.chats[k].chat == chat) return &S.chats[k];
+        k = (k + 1) & (S.chats_cap - 1);
+    }
+    if (!create) return NULL;
+    S.chats[k] = (ChatSlot){ .chat = chat, .head = UINT32_MAX, .tail = UINT32_MAX, .used = 1 };
+    S.chats_used++;
+    return &S.chats[k];
+}
+
+static int pending_push(long long chat, long long msg_id, uint64_t t) {
+    ChatSlot *c = chat_slot(chat, 1);
+    if (!c) return -1;
+    uint32_t i;
+    if (S.free_list != UINT32_MAX) {
+        i = S.free_list;
+        S.free_list = S.pool[i].next;
+    } else {
+        if (S.pool_len == S.pool_cap) {
+            size_t cap = S.pool_cap ? S.pool_cap * 2 : 4096;
+            Pending *p = realloc(S.pool, cap * sizeof(*p));
+            if (!p) return -1;
+            S.pool = p;
+            S.pool_cap = cap;
+        }
+        i = (uint32_t)S.pool_len++;
+    }
+    S.pool[i] = (Pending){ msg_id, t, UINT32_MAX };
+    if (c->tail != UINT32_MAX) S.pool[c->tail].next = i;
+    else c->head = i;
+    c->tail = i;
+    S.pending++;
+    return 0;
+}
+
+// Время ожидающего сообщения: reply_to, если указан и найден, иначе самое старое
+static int pending_take(long long chat, long long reply_to, uint64_t *t) {
+    ChatSlot *c = chat_slot(chat, 0);
+    if (!c || c->head == UINT32_MAX) return -1;
+    uint32_t prev = UINT32_MAX, i = c->head;
+    if (reply_to > 0) {
+        while (i != UINT32_MAX && S.pool[i].msg_id != reply_to) { prev = i; i = S.pool[i].next; }
+        if (i == UINT32_MAX) { prev = UINT32_MAX; i = c->head; }
+    }
+    uint32_t next = S.pool[i].next;
+    if (prev == UINT32_MAX) c->head = next;
+    else S.pool[prev].next = next;
+    if (c->tail == i) c->tail = prev;
+    *t = S.pool[i].t;
+    S.pool[i].next = S.free_list;
+    S.free_list = i;
+    S.pending--;
+    return 0;
+}
+
+static void reset_state(void) {
+    for (size_t i = 0; i < S.n_updates; i++) free(S.updates[i].json);
+    S.n_updates = S.head = 0;
+    free(S.chats);
+    S.chats = NULL;
+    S.chats_cap = S.chats_used = 0;
+    S.pool_len = 0;
+    S.free_list = UINT32_MAX;
+    S.reply_lat.n = S.deliver_lat.n = 0;
+    S.injected = S.delivered = S.replies = S.matched = S.unmatched = S.pending = 0;
+    S.polls = S.empty_polls = S.requests = 0;
+    S.t_first_inject = S.t_last_reply = 0;
+    S.delivered_upto = S.next_update_id - 1;
+}
+
+// Подтверждённые апдейты (id < offset) больше не нужны
+static void confirm_updates(long long offset) {
+    while (S.head < S.n_updates && S.updates[S.head].id < offset) {
+        free(S.updates[S.head].json);
+        S.updates[S.head].json = NULL;
+        S.head++;
+    }
+    if (S.head > 4096 && S.head * 2 > S.n_updates) {
+        memmove(S.updates, S.updates + S.head, (S.n_updates - S.head) * sizeof(*S.updates));
+        S.n_updates -= S.head;
+        S.head = 0;
+    }
+}
+
+static int inject_line(const char *line, size_t len, uint64_t t) {
+    const char *v;
+    size_t n;
+    long long chat = 1;
+    if (json_field(line, len, "chat_id", &v, &n, NULL) == 0) chat = strtoll(v, NULL, 10);
+    const char *text = "", *name = "User";
+    size_t text_len = 0, name_len = 4;
+    if (json_field(line, len, "text", &v, &n, NULL) == 0) { text = v; text_len = n; }
+    if (json_field(line, len, "first_name", &v, &n, NULL) == 0) { name = v; name_len = n; }
+    long long user = chat;
+    if (json_field(line, len, "user_id", &v, &n, NULL) == 0) user = strtoll(v, NULL, 10);
+
+    if (S.n_updates == S.cap_updates) {
+        size_t cap = S.cap_updates ? S.cap_updates * 2 : 4096;
+        Update *u = realloc(S.updates, cap * sizeof(*u));
+        if (!u) return -1;
+        S.updates = u;
+        S.cap_updates = cap;
+    }
+    long long id = S.next_update_id++, msg_id = S.next_message_id++;
+    Buf b = {0};
+    // Строки text и first_name приходят уже экранированными — копируются как есть
+    if (buf_printf(&b, "{\"update_id\":%lld,\"message\":{\"message_id\":%lld,"
+                       "\"from\":{\"id\":%lld,\"is_bot\":false,\"first_name\":\"%.*s\"},"
+                       "\"chat\":{\"id\":%lld,\"first_name\":\"%.*s\",\"type\":\"private\"},"
+                       "\"date\":%lld,\"text\":\"%.*s\"}}",
+                   id, msg_id, user, (int)name_len, name, chat, (int)name_len, name,
+                   (long long)time(NULL), (int)text_len, text) != 0 ||
+        pending_push(chat, msg_id, t) != 0) {
+        free(b.data);
+        return -1;
+    }
+    S.updates[S.n_updates++] = (Update){ id, t, b.data, b.len };
+    if (!S.t_first_inject) S.t_first_inject = t;
+    S.injected++;
+    return 0;
+}
+
+// === Соединения ===
+
+typedef struct Conn {
+    int fd;
+    Buf in, out;
+    size_t out_off;
+    int want_write;
+    int close_after;
+    int sent_continue;
+    // long polling
+    int parked;
+    int dead;
+    uint64_t park_deadline;
+    long long park_offset;
+    int park_limit;
+    struct Conn *prev_parked, *next_parked;
+} Conn;
+
+static int epfd;
+static Conn *parked_head;
+static Conn *graveyard;        // закрытые за итерацию; освобождаются после разбора событий
+static volatile sig_atomic_t stop;
+
+static void on_signal(int sig) {
+    (void)sig;
+    stop = 1;
+}
+
+static void conn_update_events(Conn *c) {
+    int want = c->out.len > c->out_off;
+    if (want == c->want_write) return;
+    struct epoll_event ev = { .events = EPOLLIN | (want ? EPOLLOUT : 0), .data.ptr = c };
+    epoll_ctl(epfd, EPOLL_CTL_MOD, c->fd, &ev);
+    c->want_write = want;
+}
+
+static void unpark(Conn *c);
+
+// Соединение может быть в том же пакете событий epoll — память отдаётся позже
+static void conn_close(Conn *c) {
+    if (c->dead) return;
+    if (c->parked) unpark(c);
+    epoll_ctl(epfd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    c->dead = 1;
+    c->next_parked = graveyard;
+    graveyard = c;
+}
+
+static void free_graveyard(void) {
+    while (graveyard) {
+        Conn *c = graveyard;
+        graveyard = c->next_parked;
+        free(c->in.data);
+        free(c->out.data);
+        free(c);
+    }
+}
+
+static int conn_flush(Conn *c) {
+    while (c->out_off < c->out.len) {
+        ssize_t n = send(c->fd, c->out.data + c->out_off, c->out.len - c->out_off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        c->out_off += (size_t)n;
+    }
+    if (c->out_off == c->out.len) {
+        c->out.len = c->out_off = 0;
+        if (c->close_after) return -1;
+    }
+    conn_update_events(c);
+    return 0;
+}
+
+static void respond(Conn *c, int code, const char *body, size_t len) {
+    const char *reason = code == 200 ? "OK" : code == 404 ? "Not Found" : "Bad Request";
+    buf_printf(&c->out, "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %zu\r\n%s\r\n",
+               code, reason, len, c->close_after ? "Connection: close\r\n" : "");
+    buf_append(&c->out, body, len);
+}
+
+static void respond_str(Conn *c, const char *body) {
+    respond(c, 200, body, strlen(body));
+}
+
+static void send_updates(Conn *c, long long offset, int limit, uint64_t now) {
+    Buf b = {0};
+    buf_append(&b, "{\"ok\":true,\"result\":[", 21);
+    int count = 0;
+    for (size_t i = S.head; i < S.n_updates && count < limit; i++) {
+        Update *u = &S.updates[i];
+        if (u->id < offset) continue;
+        if (count++) buf_append(&b, ",", 1);
+        buf_append(&b, u->json, u->len);
+        if (u->id > S.delivered_upto) {
+            S.delivered_upto = u->id;
+            S.delivered++;
+            samples_add(&S.deliver_lat, now - u->t_inject);
+        }
+    }
+    buf_append(&b, "]}", 2);
+    if (count == 0) S.empty_polls++;
+    respond(c, 200, b.data, b.len);
+    free(b.data);
+}
+
+static int has_updates(long long offset) {
+    return S.n_updates > S.head && S.updates[S.n_updates - 1].id >= offset;
+}
+
+static void unpark(Conn *c) {
+    if (c->prev_parked) c->prev_parked->next_parked = c->next_parked;
+    else parked_head = c->next_parked;
+    if (c->next_parked) c->next_parked->prev_parked = c->prev_parked;
+    c->parked = 0;
+    c->prev_parked = c->next_parked = NULL;
+}
+
+static int handle_request(Conn *c, Request *r);
+
+// Разбирает все полные запросы из входного буфера; -1 — закрыть соединение
+static int conn_process(Conn *c) {
+    size_t pos = 0;
+    int rc = 0;
+    while (!c->parked && pos < c->in.len) {
+        char *start = c->in.data + pos;
+        size_t avail = c->in.len - pos;
+        char *hdr_end = memmem(start, avail, "\r\n\r\n", 4);
+        if (!hdr_end) {
+            if (avail > 64 * 1024) rc = -1;
+            break;
+        }
+        Request r;
+        memset(&r, 0, sizeof(r));
+        size_t content_length = 0;
+        int http10 = 0, expect = 0;
+        r.keep_alive = 1;
+        char *line_end = memmem(start, (size_t)(hdr_end - start) + 2, "\r\n", 2);
+        char path[sizeof(r.path)];
+        if (sscanf(start, "%15s %1023s", r.method, path) != 2) { rc = -1; break; }
+        http10 = memmem(start, (size_t)(line_end - start), "HTTP/1.0", 8) != NULL;
+        for (char *h = line_end + 2; h < hdr_end;) {
+            char *e = memmem(h, (size_t)(hdr_end + 2 - h), "\r\n", 2);
+            if (!e) break;
+            size_t hl = (size_t)(e - h);
+            if (hl > 15 && strncasecmp(h, "content-length:", 15) == 0) content_length = strtoull(h + 15, NULL, 10);
+            else if (hl > 13 && strncasecmp(h, "content-type:", 13) == 0) {
+                char *v = h + 13;
+                while (*v == ' ') v++;
+                size_t n = (size_t)(e - v) < sizeof(r.content_type) - 1 ? (size_t)(e - v) : sizeof(r.content_type) - 1;
+                memcpy(r.content_type, v, n);
+            } else if (hl > 11 && strncasecmp(h, "connection:", 11) == 0) {
+                if (memmem(h, hl, "close", 5)) r.keep_alive = 0;
+                else if (memmem(h, hl, "eep-alive", 9)) http10 = 0;
+            } else if (hl > 7 && strncasecmp(h, "expect:", 7) == 0 && memmem(h, hl, "100-continue", 12)) {
+                expect = 1;
+            }
+            h = e + 2;
+        }
+        if (http10) r.keep_alive = 0;
+        if (content_length > MAX_REQUEST) { rc = -1; break; }
+        size_t header_len = (size_t)(hdr_end + 4 - start);
+        if (avail < header_len + content_length) {
+            if (expect && !c->sent_continue) {
+                buf_append(&c->out, "HTTP/1.1 100 Continue\r\n\r\n", 25);
+                c->sent_continue = 1;
+            }
+            break;
+        }
+        c->sent_continue = 0;
+        memcpy(r.path, path, sizeof(path));
+        char *q = strchr(r.path, '?');
+        if (q) { *q = '\0'; r.query = q + 1; }
+        r.body = start + header_len;
+        r.body_len = content_length;
+        c->close_after = !r.keep_alive;
+        S.requests++;
+        if (handle_request(c, &r) != 0) { rc = -1; break; }
+        pos += header_len + content_length;
+        if (c->close_after) break;
+    }
+    if (pos) {
+        memmove(c->in.data, c->in.data + pos, c->in.len - pos);
+        c->in.len -= pos;
+    }
+    return rc;
+}
+
+static void wake_parked(int release_all) {
+    uint64_t now = now_us();
+    for (Conn *c = parked_head, *next; c; c = next) {
+        next = c->next_parked;
+        if (!release_all && !has_updates(c->park_offset) && now < c->park_deadline) continue;
+        unpark(c);
+        send_updates(c, c->park_offset, c->park_limit, now);
+        if (conn_flush(c) != 0 || conn_process(c) != 0 || conn_flush(c) != 0) conn_close(c);
+    }
+}
+
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void stats_json(Buf *b) {
+    double span = S.t_first_inject && S.t_last_reply > S.t_first_inject
+                ? (double)(S.t_last_reply - S.t_first_inject) / 1e6 : 0;
+    buf_printf(b, "{\"ok\":true,\"result\":{\"injected\":%llu,\"delivered\":%llu,\"replies\":%llu,"
+                  "\"matched\":%llu,\"unmatched\":%llu,\"pending\":%llu,\"polls\":%llu,\"empty_polls\":%llu,"
+                  "\"requests\":%llu,\"span_s\":%.3f,\"throughput\":%.1f",
+               (unsigned long long)S.injected, (unsigned long long)S.delivered, (unsigned long long)S.replies,
+               (unsigned long long)S.matched, (unsigned long long)S.unmatched, (unsigned long long)S.pending,
+               (unsigned long long)S.polls, (unsigned long long)S.empty_polls, (unsigned long long)S.requests,
+               span, span > 0 ? (double)S.matched / span : 0);
+    const struct { const char *name; Samples *s; } sets[] = {
+        { "latency_ms", &S.reply_lat }, { "delivery_ms", &S.deliver_lat },
+    };
+    for (size_t k = 0; k < 2; k++) {
+        Samples *s = sets[k].s;
+        uint32_t *v = s->n ? malloc(s->n * sizeof(*v)) : NULL;
+        double sum = 0;
+        if (v) {
+            memcpy(v, s->v, s->n * sizeof(*v));
+            qsort(v, s->n, sizeof(*v), cmp_u32);
+            for (size_t i = 0; i < s->n; i++) sum += v[i];
+        }
+#define PCT(p) (v ? v[(size_t)((double)(s->n - 1) * (p))] / 1000.0 : 0)
+        buf_printf(b, ",\"%s\":{\"n\":%zu,\"mean\":%.3f,\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"p999\":%.3f,\"max\":%.3f}",
+                   sets[k].name, s->n, s->n ? sum / (double)s->n / 1000.0 : 0,
+                   PCT(0.5), PCT(0.9), PCT(0.99), PCT(0.999), PCT(1.0));
+#undef PCT
+        free(v);
+    }
+    buf_printf(b, "}}");
+}
+
+static int handle_request(Conn *c, Request *r) {
+    uint64_t now = now_us();
+    char *p = r->path;
+
+    if (strcmp(p, "/_inject") == 0) {
+        size_t added = 0;
+        for (const char *s = r->body, *end = r->body + r->body_len; s < end;) {
+            const char *e = memchr(s, '\n', (size_t)(end - s));
+            if (!e) e = end;
+            if (e > s && inject_line(s, (size_t)(e - s), now) == 0) added++;
+            s = e + 1;
+        }
+        char body[64];
+        snprintf(body, sizeof(body), "{\"ok\":true,\"result\":%zu}", added);
+        respond_str(c, body);
+        wake_parked(0);
+        return 0;
+    }
+    if (strcmp(p, "/_stats") == 0) {
+        Buf b = {0};
+        stats_json(&b);
+        respond(c, 200, b.data, b.len);
+        free(b.data);
+        if (S.log) fflush(S.log);
+        return 0;
+    }
+    if (strcmp(p, "/_reset") == 0) {
+        reset_state();
+        respond_str(c, "{\"ok\":true,\"result\":true}");
+        wake_parked(1);
+        return 0;
+    }
+
+    // /bot<token>/<method>
+    char *m = strncmp(p, "/bot", 4) == 0 ? strchr(p + 4, '/') : NULL;
+    if (!m) {
+        const char *nf = "{\"ok\":false,\"error_code\":404,\"description\":\"Not Found\"}";
+        respond(c, 404, nf, strlen(nf));
+        return 0;
+    }
+    const char *method = m + 1;
+
+    if (strcasecmp(method, "getMe") == 0) {
+        respond_str(c, "{\"ok\":true,\"result\":{\"id\":100000001,\"is_bot\":true,\"first_name\":\"OXXYEN Bench\","
+                       "\"username\":\"oxxyen_bench_bot\",\"can_join_groups\":true}}");
+        return 0;
+    }
+    if (strcasecmp(method, "getUpdates") == 0) {
+        long long offset = param_ll(r, "offset", 0);
+        long long limit = param_ll(r, "limit", DEFAULT_LIMIT);
+        long long timeout = param_ll(r, "timeout", 0);
+        if (limit <= 0 || limit > DEFAULT_LIMIT) limit = DEFAULT_LIMIT;
+        if (timeout > MAX_POLL_TIMEOUT) timeout = MAX_POLL_TIMEOUT;
+        S.polls++;
+        if (offset > 0) confirm_updates(offset);
+        else offset = 0;
+        if (timeout > 0 && !has_updates(offset)) {
+            c->parked = 1;
+            c->park_deadline = now + (uint64_t)timeout * 1000000u;
+            c->park_offset = offset;
+            c->park_limit = (int)limit;
+            c->prev_parked = NULL;
+            c->next_parked = parked_head;
+            if (parked_head) parked_head->prev_parked = c;
+            parked_head = c;
+            return 0;
+        }
+        send_updates(c, offset, (int)limit, now);
+        return 0;
+    }
+    if (strncasecmp(method, "send", 4) == 0) {
+        long long chat = param_ll(r, "chat_id", 0);
+        long long reply_to = param_ll(r, "reply_to_message_id", 0);
+        uint64_t t0, lat = 0;
+        int matched = pending_take(chat, reply_to, &t0) == 0;
+        S.replies++;
+        if (matched) {
+            lat = now - t0;
+            S.matched++;
+            S.t_last_reply = now;
+            samples_add(&S.reply_lat, lat);
+        } else {
+            S.unmatched++;
+        }
+        if (S.log) {
+            fprintf(S.log, "%llu\t%s\t%lld\t%lld\t%lld\n", (unsigned long long)now, method, chat, reply_to,
+                    matched ? (long long)lat : -1LL);
+        }
+        Buf b = {0};
+        buf_printf(&b, "{\"ok\":true,\"result\":{\"message_id\":%lld,\"from\":{\"id\":100000001,\"is_bot\":true,"
+                       "\"first_name\":\"OXXYEN Bench\"},\"chat\":{\"id\":%lld,\"type\":\"private\"},\"date\":%lld%s}}",
+                   S.next_message_id++, chat, (long long)time(NULL),
+                   strcasecmp(method, "sendDice") == 0 ? ",\"dice\":{\"emoji\":\"\xf0\x9f\x8e\xb2\",\"value\":4}" : "");
+        respond(c, 200, b.data, b.len);
+        free(b.data);
+        return 0;
+    }
+    respond_str(c, "{\"ok\":true,\"result\":true}");
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int port = 8081;
+    const char *bind_addr = "127.0.0.1";
+    const char *log_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) port = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--bind") == 0 && i + 1 < argc) bind_addr = argv[++i];
+        else if (strcmp(argv[i], "--log") == 0 && i + 1 < argc) log_path = argv[++i];
+        else {
+            fprintf(stderr, "Usage: %s [--port N] [--bind ADDR] [--log FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (log_path && !(S.log = fopen(log_path, "a"))) {
+        fprintf(stderr, "Error: cannot open log '%s': %s\n", log_path, strerror(errno));
+        return 1;
+    }
+    S.next_update_id = 1;
+    S.next_message_id = 1;
+
+    int lfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int one = 1;
+    setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons((uint16_t)port) };
+    if (inet_pton(AF_INET, bind_addr, &addr.sin_addr) != 1 ||
+        bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(lfd, 1024) != 0) {
+        fprintf(stderr, "Error: cannot listen on %s:%d: %s\n", bind_addr, port, strerror(errno));
+        return 1;
+    }
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event lev = { .events = EPOLLIN, .data.ptr = NULL };
+    epoll_ctl(epfd, EPOLL_CTL_ADD, lfd, &lev);
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    printf("🧪 Fake Bot API on http://%s:%d (token is ignored)\n", bind_addr, port);
+    fflush(stdout);
+
+    struct epoll_event events[MAX_EVENTS];
+    while (!stop) {
+        // Ближайший таймаут long polling
+        int timeout = 1000;
+        uint64_t now = now_us();
+        for (Conn *c = parked_head; c; c = c->next_parked) {
+            int64_t left = c->park_deadline > now ? (int64_t)((c->park_deadline - now + 999) / 1000) : 0;
+            if (left < timeout) timeout = (int)left;
+        }
+        int n = epoll_wait(epfd, events, MAX_EVENTS, timeout);
+        if (n < 0 && errno != EINTR) break;
+        for (int i = 0; i < n; i++) {
+            Conn *c = events[i].data.ptr;
+            if (c && c->dead) continue;
+            if (!c) {
+                int fd;
+                while ((fd = accept4(lfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                    Conn *nc = calloc(1, sizeof(*nc));
+                    if (!nc) { close(fd); continue; }
+                    nc->fd = fd;
+                    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = nc };
+                    epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+                }
+                continue;
+            }
+            int dead = (events[i].events & (EPOLLERR | EPOLLHUP)) != 0;
+            if (!dead && (events[i].events & EPOLLIN)) {
+                for (;;) {
+                    if (buf_reserve(&c->in, 65536) != 0) { dead = 1; break; }
+                    ssize_t r = recv(c->fd, c->in.data + c->in.len, c->in.cap - c->in.len - 1, 0);
+                    if (r > 0) { c->in.len += (size_t)r; continue; }
+                    if (r == 0) dead = 1;
+                    else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) dead = 1;
+                    break;
+                }
+                // Ждущий long poll клиент, закрывший соединение, тоже уходит
+                if (!dead && conn_process(c) != 0) dead = 1;
+            }
+            if (!dead && conn_flush(c) != 0) dead = 1;
+            if (dead) conn_close(c);
+        }
+        wake_parked(0);
+        free_graveyard();
+    }
+
+    Buf b = {0};
+    stats_json(&b);
+    printf("%s\n", b.data ? b.data : "{}");
+    free(b.data);
+    if (S.log) fclose(S.log);
+    return 0;
+}
@@ -0,0 +1,528 @@
+// llm_bench.c — замер генерации bot.c: загрузка, TTFT, prefill/decode ток/с, пиковый RSS
+// gcc -O2 -o llm_bench llm_bench.c ../dataset/prompt_store.c ../dataset/json_escape.c -L../llama.cpp/build/bin -lllama -lm -pthread
+// ./llm_bench --model model.gguf [--threads 1,4,8] [--ctx 512,2048] [--batch 32,512]
+//             [--n-gen N(64)] [--reps N(3)] [--memory FILE(../memory.txt)] [--memory-prompts N(3)]
+//             [--prompts FILE] [--ngl N(0)] [--no-mmap] [--mlock] [--json FILE|-]
+//
+// Путь тот же, что в bot.c: шаблон Llama 3, жадный сэмплер, token_to_piece
+// для каждого токена. Промпт подаётся пачками по n_batch (prefill), затем
+// генерируется ровно --n-gen токенов без остановки на EOS, чтобы числа
+// разных прогонов были сравнимы.
+//
+// Набор промптов: встроенные (короткий, средний, длинный русский), самые
+// длинные русские instruction из memory.txt (через prompt_store) и строки
+// --prompts. Для каждой комбинации threads × n_ctx × n_batch и каждого
+// промпта — --reps повторов, в отчёт идёт медиана; перед комбинацией один
+// прогрев на первом промпте. Контекст создаётся заново на каждый прогон,
+// как в bot.c (и без зависимости от API очистки KV-кэша).
+//
+// Метрики:
+//   load_ms      — llama_model_load_from_file, один раз
+//   ctx_ms       — llama_init_from_model
+//   ttft_ms      — от начала prefill до первого выбранного токена
+//   prefill_tps  — токены промпта / время prefill
+//   decode_tps   — (n_gen - 1) / время после первого токена
+//   peak_rss_kb  — VmHWM; перед каждой комбинацией сбрасывается через
+//                  /proc/self/clear_refs (если ядро не даёт — пик процесса)
+// Промпты, которым не хватает n_ctx, помечаются "skipped".
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+#include "../llama.cpp/include/llama.h"
+#include "../dataset/json_escape.h"
+#include "../dataset/prompt_store.h"
+
+#define MAX_SWEEP 16
+#define MAX_PROMPTS 64
+#define MAX_REPS 32
+
+static const char *BUILTIN_PROMPTS[][2] = {
+    { "short_ru", "Привет! Как дела?" },
+    { "medium_en", "Explain how a stack canary protects a function return address and how an attacker might try to bypass it." },
+    { "long_ru",
+      "Представь, что ты опытный инженер по безопасности и проводишь разбор бинарника для младшего коллеги. "
+      "Подробно объясни, как определить, собран ли ELF-файл с защитой стека, позиционно-независимым кодом, "
+      "полным RELRO и неисполняемым стеком. Для каждой защиты расскажи, какие секции, флаги заголовка и "
+      "символы нужно проверить, какими утилитами это удобнее сделать (readelf, objdump, checksec), какие "
+      "ложные срабатывания встречаются на статически собранных и обфусцированных файлах, и как каждая из "
+      "защит влияет на эксплуатацию переполнения буфера. В конце дай короткий чек-лист из пяти пунктов, "
+      "который можно применять при первичном анализе неизвестного файла, и поясни, почему порядок проверок "
+      "именно такой." },
+};
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+// === RSS ===
+
+static long status_kb(const char *field) {
+    FILE *f = fopen("/proc/self/status", "r");
+    if (!f) return -1;
+    char line[256];
+    size_t n = strlen(field);
+    long kb = -1;
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, field, n) == 0 && line[n] == ':') {
+            kb = atol(line + n + 1);
+            break;
+        }
+    }
+    fclose(f);
+    return kb;
+}
+
+static int hwm_reset_ok;
+
+static void peak_rss_reset(void) {
+    FILE *f = fopen("/proc/self/clear_refs", "w");
+    if (!f) return;
+    hwm_reset_ok = fputs("5", f) >= 0;
+    if (fclose(f) != 0) hwm_reset_ok = 0;
+}
+
+static long peak_rss_kb(void) {
+    long kb = status_kb("VmHWM");
+    if (kb >= 0) return kb;
+    struct rusage ru;
+    return getrusage(RUSAGE_SELF, &ru) == 0 ? ru.ru_maxrss : -1;
+}
+
+// === Промпты ===
+
+typedef struct {
+    char *id;
+    char *text;
+} Prompt;
+
+static Prompt prompts[MAX_PROMPTS];
+static int n_prompts;
+
+static void add_prompt(const char *id, const char *text, size_t len) {
+    if (n_prompts >= MAX_PROMPTS) return;
+    Prompt *p = &prompts[n_prompts];
+    p->id = strdup(id);
+    p->text = strndup(text, len);
+    if (!p->id || !p->text) {
+        free(p->id);
+        free(p->text);
+        return;
+    }
+    n_prompts++;
+}
+
+// Доля кириллических букв среди букв: отбираем русские промпты
+static int is_russian(const char *s, size_t len) {
+    size_t cyr = 0, lat = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if ((c == 0xD0 || c == 0xD1) && i + 1 < len) {
+            cyr++;
+            i++;
+        } else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') {
+            lat++;
+        }
+    }
+    return cyr > 0 && cyr >= lat;
+}
+
+// Самые длинные русские instruction из memory.txt
+static int load_memory_prompts(const char *path, int want) {
+    PromptStore ps;
+    if (want <= 0 || prompt_store_open(&ps, path) != 0) return -1;
+    size_t best_i[MAX_PROMPTS];
+    size_t best_len[MAX_PROMPTS];
+    int n_best = 0;
+    if (want > MAX_PROMPTS) want = MAX_PROMPTS;
+    for (size_t i = 0; i < prompt_store_count(&ps); i++) {
+        const char *rec, *val;
+        size_t rec_len, val_len;
+        if (prompt_store_get(&ps, i, &rec, &rec_len) != 0) continue;
+        if (json_find_string(rec, rec_len, "instruction", &val, &val_len) != 0) continue;
+        if (!is_russian(val, val_len)) continue;
+        // вставка в отсортированный по убыванию длины список лучших
+        int pos = n_best;
+        while (pos > 0 && best_len[pos - 1] < val_len) pos--;
+        if (pos >= want) continue;
+        int last = n_best < want ? n_best : want - 1;
+        for (int k = last; k > pos; k--) {
+            best_i[k] = best_i[k - 1];
+            best_len[k] = best_len[k - 1];
+        }
+        best_i[pos] = i;
+        best_len[pos] = val_len;
+        if (n_best < want) n_best++;
+    }
+    StrBuf text = {0};
+    for (int k = 0; k < n_best; k++) {
+        const char *rec, *val;
+        size_t rec_len, val_len;
+        prompt_store_get(&ps, best_i[k], &rec, &rec_len);
+        json_find_string(rec, rec_len, "instruction", &val, &val_len);
+        strbuf_reset(&text);
+        if (json_unescape_append(&text, val, val_len) != 0 || !text.len) continue;
+        char id[64];
+        snprintf(id, sizeof(id), "memory_%zu", best_i[k]);
+        add_prompt(id, text.data, text.len);
+    }
+    strbuf_free(&text);
+    prompt_store_close(&ps);
+    return n_best;
+}
+
+static int load_prompt_file(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t n;
+    int k = 0;
+    while ((n = getline(&line, &cap, f)) > 0) {
+        while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r')) line[--n] = '\0';
+        if (n == 0) continue;
+        char id[32];
+        snprintf(id, sizeof(id), "file_%d", k++);
+        add_prompt(id, line, (size_t)n);
+    }
+    free(line);
+    fclose(f);
+    return 0;
+}
+
+// "1,4,8" → массив; 0 — ошибка
+static int parse_list(const char *s, int *out) {
+    int n = 0;
+    while (*s && n < MAX_SWEEP) {
+        char *end;
+        long v = strtol(s, &end, 10);
+        if (end == s || v <= 0) return 0;
+        out[n++] = (int)v;
+        s = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return 0;
+    }
+    return n;
+}
+
+// === Прогон ===
+
+typedef struct {
+    int skipped;
+    int prompt_tokens;
+    int gen_tokens;
+    int hit_eog;
+    double ctx_ms, ttft_ms, prefill_ms, decode_ms;
+} RunResult;
+
+// Токены промпта по шаблону bot.c и с теми же флагами токенизации; malloc или NULL
+static llama_token *tokenize_prompt(const struct llama_vocab *vocab, const char *text, int *n_out) {
+    StrBuf full = {0};
+    if (strbuf_append_str(&full, "<|begin_of_text|><|start_header_id|>user<|end_header_id|>\n\n") != 0 ||
+        strbuf_append_str(&full, text) != 0 ||
+        strbuf_append_str(&full, "<|eot_id|><|start_header_id|>assistant<|end_header_id|>\n\n") != 0) {
+        strbuf_free(&full);
+        return NULL;
+    }
+    int32_t cap = (int32_t)full.len + 16;
+    llama_token *tokens = malloc((size_t)cap * sizeof(*tokens));
+    int32_t n = tokens ? llama_tokenize(vocab, full.data, (int32_t)full.len, tokens, cap, false, true) : -1;
+    strbuf_free(&full);
+    if (n <= 0) {
+        free(tokens);
+        return NULL;
+    }
+    *n_out = n;
+    return tokens;
+}
+
+static int run_once(struct llama_model *model, const struct llama_vocab *vocab, llama_token *tokens, int n_tokens,
+                    int threads, int n_ctx, int n_batch, int n_gen, RunResult *r) {
+    memset(r, 0, sizeof(*r));
+    r->prompt_tokens = n_tokens;
+    if (n_tokens + n_gen > n_ctx) {
+        r->skipped = 1;
+        return 0;
+    }
+
+    struct llama_context_params cp = llama_context_default_params();
+    cp.n_ctx = (uint32_t)n_ctx;
+    cp.n_batch = (uint32_t)n_batch;
+    cp.n_ubatch = (uint32_t)n_batch;
+    cp.n_threads = threads;
+    cp.n_threads_batch = threads;
+
+    double t0 = now_ms();
+    struct llama_context *ctx = llama_init_from_model(model, cp);
+    if (!ctx) return -1;
+    double t1 = now_ms();
+    r->ctx_ms = t1 - t0;
+
+    struct llama_sampler *smpl = llama_sampler_init_greedy();
+    if (!smpl) {
+        llama_free(ctx);
+        return -1;
+    }
+
+    int ok = 1;
+    for (int pos = 0; pos < n_tokens && ok; pos += n_batch) {
+        int n = n_tokens - pos < n_batch ? n_tokens - pos : n_batch;
+        ok = llama_decode(ctx, llama_batch_get_one(tokens + pos, n)) == 0;
+    }
+    double t2 = now_ms();
+    r->prefill_ms = t2 - t1;
+
+    double t3 = t2;
+    char piece[256];
+    for (int i = 0; i < n_gen && ok; i++) {
+        llama_token tok = llama_sampler_sample(smpl, ctx, -1);
+        if (i == 0) {
+            t3 = now_ms();
+            r->ttft_ms = t3 - t1;
+        }
+        if (llama_vocab_is_eog(vocab, tok)) r->hit_eog = 1;
+        llama_token_to_piece(vocab, tok, piece, sizeof(piece), 0, false);
+        r->gen_tokens++;
+        if (i + 1 < n_gen) ok = llama_decode(ctx, llama_batch_get_one(&tok, 1)) == 0;
+    }
+    r->decode_ms = now_ms() - t3;
+
+    llama_sampler_free(smpl);
+    llama_free(ctx);
+    return ok ? 0 : -1;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double median(double *v, int n) {
+    if (n == 0) return 0;
+    qsort(v, (size_t)n, sizeof(*v), cmp_double);
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+static void json_str(StrBuf *b, const char *s) {
+    strbuf_append(b, "\"", 1);
+    json_escape_append(b, s, strlen(s));
+    strbuf_append(b, "\"", 1);
+}
+
+static void json_fmt(StrBuf *b, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static void json_fmt(StrBuf *b, const char *fmt, ...) {
+    char tmp[512];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(tmp, sizeof(tmp), fmt, ap);
+    va_end(ap);
+    if (n > 0) strbuf_append(b, tmp, (size_t)n < sizeof(tmp) ? (size_t)n : sizeof(tmp) - 1);
+}
+
+static void cpu_model(char *out, size_t size) {
+    snprintf(out, size, "unknown");
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    if (!f) return;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "model name", 10) == 0) {
+            char *p = strchr(line, ':');
+            if (p) {
+                p++;
+                while (*p == ' ') p++;
+                p[strcspn(p, "\n")] = '\0';
+                snprintf(out, size, "%s", p);
+            }
+            break;
+        }
+    }
+    fclose(f);
+}
+
+int main(int argc, char *argv[]) {
+    const char *model_path = NULL, *memory_path = "../memory.txt", *prompts_path = NULL, *json_path = NULL;
+    int threads[MAX_SWEEP] = {4}, ctxs[MAX_SWEEP] = {2048}, batches[MAX_SWEEP] = {512};
+    int n_threads = 1, n_ctxs = 1, n_batches = 1;
+    int n_gen = 64, reps = 3, memory_prompts = 3, ngl = 0, use_mmap = 1, use_mlock = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--model") == 0 && i + 1 < argc) model_path = argv[++i];
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) n_threads = parse_list(argv[++i], threads);
+        else if (strcmp(argv[i], "--ctx") == 0 && i + 1 < argc) n_ctxs = parse_list(argv[++i], ctxs);
+        else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) n_batches = parse_list(argv[++i], batches);
+        else if (strcmp(argv[i], "--n-gen") == 0 && i + 1 < argc) n_gen = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) reps = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--memory") == 0 && i + 1 < argc) memory_path = argv[++i];
+        else if (strcmp(argv[i], "--memory-prompts") == 0 && i + 1 < argc) memory_prompts = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--prompts") == 0 && i + 1 < argc) prompts_path = argv[++i];
+        else if (strcmp(argv[i], "--ngl") == 0 && i + 1 < argc) ngl = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--no-mmap") == 0) use_mmap = 0;
+        else if (strcmp(argv[i], "--mlock") == 0) use_mlock = 1;
+        else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) json_path = argv[++i];
+        else {
+            model_path = NULL;
+            break;
+        }
+    }
+    if (!model_path || !n_threads || !n_ctxs || !n_batches) {
+        fprintf(stderr, "Usage: %s --model model.gguf [--threads 1,4,8] [--ctx 512,2048] [--batch 32,512]\n"
+                        "          [--n-gen N] [--reps N] [--memory FILE] [--memory-prompts N] [--prompts FILE]\n"
+                        "          [--ngl N] [--no-mmap] [--mlock] [--json FILE|-]\n", argv[0]);
+        return 1;
+    }
+    // с --json - таблица уходит в stderr, чтобы stdout оставался чистым JSON
+    FILE *info = json_path && strcmp(json_path, "-") == 0 ? stderr : stdout;
+    if (n_gen < 1) n_gen = 1;
+    if (reps < 1) reps = 1;
+    if (reps > MAX_REPS) reps = MAX_REPS;
+
+    for (size_t i = 0; i < sizeof(BUILTIN_PROMPTS) / sizeof(BUILTIN_PROMPTS[0]); i++)
+        add_prompt(BUILTIN_PROMPTS[i][0], BUILTIN_PROMPTS[i][1], strlen(BUILTIN_PROMPTS[i][1]));
+    int from_memory = load_memory_prompts(memory_path, memory_prompts);
+    if (from_memory < 0 && memory_prompts > 0)
+        fprintf(stderr, "⚠️ %s: промпты из памяти не загружены\n", memory_path);
+    if (prompts_path && load_prompt_file(prompts_path) != 0) {
+        fprintf(stderr, "Error: cannot read prompts '%s'\n", prompts_path);
+        return 1;
+    }
+
+    // === Модель ===
+    llama_backend_init();
+    struct llama_model_params mp = llama_model_default_params();
+    mp.n_gpu_layers = ngl;
+    mp.use_mmap = use_mmap;
+    mp.use_mlock = use_mlock;
+    long rss_before = status_kb("VmRSS");
+    double t0 = now_ms();
+    struct llama_model *model = llama_model_load_from_file(model_path, mp);
+    double load_ms = now_ms() - t0;
+    if (!model) {
+        fprintf(stderr, "❌ Model load failed: %s\n", model_path);
+        llama_backend_free();
+        return 1;
+    }
+    long rss_loaded = status_kb("VmRSS");
+    const struct llama_vocab *vocab = llama_model_get_vocab(model);
+    char desc[256];
+    llama_model_desc(model, desc, sizeof(desc));
+    struct stat st;
+    long long file_size = stat(model_path, &st) == 0 ? (long long)st.st_size : -1;
+    fprintf(info, "📦 %s: %s, загрузка %.1f мс, RSS +%ld КБ\n", model_path, desc, load_ms,
+           rss_loaded >= 0 && rss_before >= 0 ? rss_loaded - rss_before : -1);
+
+    llama_token *ptok[MAX_PROMPTS] = {0};
+    int pn[MAX_PROMPTS] = {0};
+    for (int p = 0; p < n_prompts; p++) {
+        ptok[p] = tokenize_prompt(vocab, prompts[p].text, &pn[p]);
+        if (!ptok[p]) fprintf(stderr, "⚠️ %s: токенизация не удалась\n", prompts[p].id);
+    }
+
+    char cpu[256];
+    cpu_model(cpu, sizeof(cpu));
+    StrBuf js = {0};
+    json_fmt(&js, "{\"model\":");
+    json_str(&js, model_path);
+    json_fmt(&js, ",\"desc\":");
+    json_str(&js, desc);
+    json_fmt(&js, ",\"file_size\":%lld,\"model_size\":%llu,\"n_params\":%llu,\"load_ms\":%.3f,\"rss_load_kb\":%ld,"
+                  "\"system\":{\"cpu\":",
+             file_size, (unsigned long long)llama_model_size(model), (unsigned long long)llama_model_n_params(model),
+             load_ms, rss_loaded >= 0 && rss_before >= 0 ? rss_loaded - rss_before : -1);
+    json_str(&js, cpu);
+    json_fmt(&js, ",\"cpus\":%ld},\"n_gen\":%d,\"reps\":%d,\"ngl\":%d,\"mmap\":%s,\"mlock\":%s,\"prompts\":[",
+             sysconf(_SC_NPROCESSORS_ONLN), n_gen, reps, ngl, use_mmap ? "true" : "false", use_mlock ? "true" : "false");
+    for (int p = 0; p < n_prompts; p++) {
+        json_fmt(&js, "%s{\"id\":", p ? "," : "");
+        json_str(&js, prompts[p].id);
+        json_fmt(&js, ",\"bytes\":%zu,\"tokens\":%d}", strlen(prompts[p].text), pn[p]);
+    }
+    json_fmt(&js, "],\"results\":[");
+
+    int failed = 0, first = 1;
+    fprintf(info, "%7s %6s %6s  %-14s %6s %9s %9s %11s %10s %10s\n",
+           "threads", "n_ctx", "batch", "prompt", "tokens", "ctx_ms", "ttft_ms", "prefill_t/s", "decode_t/s", "peak_rss");
+    for (int ti = 0; ti < n_threads; ti++)
+    for (int ci = 0; ci < n_ctxs; ci++)
+    for (int bi = 0; bi < n_batches; bi++) {
+        int th = threads[ti], nc = ctxs[ci], nb = batches[bi];
+        peak_rss_reset();
+        // прогрев: первые страницы весов, буферы бэкенда
+        for (int p = 0; p < n_prompts; p++) {
+            RunResult w;
+            if (ptok[p] && run_once(model, vocab, ptok[p], pn[p], th, nc, nb, n_gen < 8 ? n_gen : 8, &w) == 0 && !w.skipped)
+                break;
+        }
+        for (int p = 0; p < n_prompts; p++) {
+            if (!ptok[p]) continue;
+            double ctx_v[MAX_REPS], ttft_v[MAX_REPS], pre_v[MAX_REPS], dec_v[MAX_REPS];
+            int n_ok = 0, skipped = 0, eog = 0, gen = 0;
+            for (int r = 0; r < reps; r++) {
+                RunResult rr;
+                if (run_once(model, vocab, ptok[p], pn[p], th, nc, nb, n_gen, &rr) != 0) {
+                    failed++;
+                    continue;
+                }
+                if (rr.skipped) {
+                    skipped = 1;
+                    break;
+                }
+                ctx_v[n_ok] = rr.ctx_ms;
+                ttft_v[n_ok] = rr.ttft_ms;
+                pre_v[n_ok] = rr.prefill_ms > 0 ? rr.prompt_tokens / (rr.prefill_ms / 1e3) : 0;
+                dec_v[n_ok] = rr.decode_ms > 0 && rr.gen_tokens > 1 ? (rr.gen_tokens - 1) / (rr.decode_ms / 1e3) : 0;
+                eog |= rr.hit_eog;
+                gen = rr.gen_tokens;
+                n_ok++;
+            }
+            long peak = peak_rss_kb();
+            json_fmt(&js, "%s{\"threads\":%d,\"n_ctx\":%d,\"n_batch\":%d,\"prompt\":", first ? "" : ",", th, nc, nb);
+            json_str(&js, prompts[p].id);
+            json_fmt(&js, ",\"prompt_tokens\":%d", pn[p]);
+            first = 0;
+            if (skipped || n_ok == 0) {
+                json_fmt(&js, ",\"skipped\":\"%s\"}", skipped ? "n_ctx" : "error");
+                fprintf(info, "%7d %6d %6d  %-14.14s %6d %s\n", th, nc, nb, prompts[p].id, pn[p],
+                       skipped ? "— не помещается в n_ctx" : "❌ ошибка");
+                continue;
+            }
+            double c = median(ctx_v, n_ok), t = median(ttft_v, n_ok), pr = median(pre_v, n_ok), d = median(dec_v, n_ok);
+            json_fmt(&js, ",\"gen_tokens\":%d,\"hit_eog\":%s,\"runs\":%d,\"ctx_ms\":%.3f,\"ttft_ms\":%.3f,"
+                          "\"prefill_tps\":%.2f,\"decode_tps\":%.2f,\"peak_rss_kb\":%ld,\"peak_rss_reset\":%s}",
+                     gen, eog ? "true" : "false", n_ok, c, t, pr, d, peak, hwm_reset_ok ? "true" : "false");
+            fprintf(info, "%7d %6d %6d  %-14.14s %6d %9.1f %9.1f %11.1f %10.1f %8ldMB\n",
+                   th, nc, nb, prompts[p].id, pn[p], c, t, pr, d, peak / 1024);
+        }
+    }
+    json_fmt(&js, "],\"failed_runs\":%d}\n", failed);
+
+    if (json_path) {
+        FILE *out = strcmp(json_path, "-") == 0 ? stdout : fopen(json_path, "w");
+        if (!out) {
+            perror("❌ json");
+            failed++;
+        } else {
+            fwrite(js.data, 1, js.len, out);
+            if (out != stdout) fclose(out);
+        }
+    }
+    fprintf(info, "✅ Готово: %d промптов × %d конфигураций, ошибок: %d\n",
+           n_prompts, n_threads * n_ctxs * n_batches, failed);
+
+    strbuf_free(&js);
+    for (int p = 0; p < n_prompts; p++) {
+        free(ptok[p]);
+        free(prompts[p].id);
+        free(prompts[p].text);
+    }
+    llama_model_free(model);
+    llama_backend_free();
+    return failed ? 1 : 0;
+}
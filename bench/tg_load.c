@@ -0,0 +1,675 @@
+// tg_load.c — генератор нагрузки для ботов через fake_tgapi
+// gcc -O2 -o tg_load tg_load.c ../shard.c -lcurl -pthread
+// ./tg_load [--server URL(http://127.0.0.1:8081)] [--rate N(100)] [--duration S(10)] [--count N]
+//           [--chats N(100)] [--texts FILE] [--replay FILE] [--speed X(1)] [--drain S(10)]
+//           [--bot none|serial|pool:N|shards:N] [--poll short:MS|long:S] [--json FILE|-]
+//           [--shard-kill S] [--shard-resize S:N]
+//
+// Сценарий: /_reset, затем апдейты впрыскиваются в fake_tgapi с заданной
+// частотой (или по отметкам времени из --replay), по окончании ждём ответов
+// не дольше --drain и печатаем отчёт сервера: пропускная способность,
+// p50/p99/p999 задержки апдейт→ответ и апдейт→выдача в getUpdates.
+//
+// Трафик:
+//   синтетический — --chats чатов, команды /start, /help, /dice и текст
+//                   (строки из --texts, например выгрузка memory.txt)
+//   --replay FILE — JSONL {"t":сек,"chat_id":N,"text":"...","first_name":"..."};
+//                   без "t" — равномерно с --rate; --speed ускоряет запись
+// Бот:
+//   none   — внешний: main.c/stable.c с LD_PRELOAD=tg_redirect.so (см. tg_redirect.c)
+//   serial — как цикл main.c: getUpdates, ответы по очереди в том же потоке
+//   pool:N — getUpdates в одном потоке, ответы — N рабочих потоков
+//   shards:N — getUpdates в одном потоке, ответы — N процессов shard.c
+//              (чат всегда у одного процесса, порядок в чате сохраняется);
+//              --shard-kill S убивает SIGKILL случайный шард каждые S секунд,
+//              --shard-resize S:N через S секунд меняет число шардов на N —
+//              ответы на все апдейты должны прийти и тогда
+//   --poll short:MS — timeout=0 и пауза MS между опросами (main.c: short:1000)
+//   --poll long:S   — long polling с timeout=S, без пауз
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <curl/curl.h>
+
+#include "../shard.h"
+
+#define INJECT_BATCH 1000
+#define MAX_TEXT 4096
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static void sleep_us(uint64_t us) {
+    struct timespec ts = { (time_t)(us / 1000000u), (long)(us % 1000000u) * 1000 };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+}
+
+typedef struct {
+    char *data;
+    size_t len, cap;
+} Buf;
+
+static int buf_append(Buf *b, const char *s, size_t n) {
+    if (b->len + n + 1 > b->cap) {
+        size_t cap = b->cap ? b->cap : 4096;
+        while (cap < b->len + n + 1) cap *= 2;
+        char *p = realloc(b->data, cap);
+        if (!p) return -1;
+        b->data = p;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+    b->data[b->len] = '\0';
+    return 0;
+}
+
+static size_t write_buf(void *data, size_t size, size_t nmemb, void *userp) {
+    return buf_append(userp, data, size * nmemb) == 0 ? size * nmemb : 0;
+}
+
+// === HTTP ===
+
+typedef struct {
+    CURL *curl;
+    Buf resp;
+    const char *base;          // http://host:port
+} Http;
+
+static int http_init(Http *h, const char *base) {
+    memset(h, 0, sizeof(*h));
+    h->base = base;
+    h->curl = curl_easy_init();
+    if (!h->curl) return -1;
+    curl_easy_setopt(h->curl, CURLOPT_WRITEFUNCTION, write_buf);
+    curl_easy_setopt(h->curl, CURLOPT_WRITEDATA, &h->resp);
+    curl_easy_setopt(h->curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(h->curl, CURLOPT_TCP_NODELAY, 1L);
+    return 0;
+}
+
+static void http_free(Http *h) {
+    if (h->curl) curl_easy_cleanup(h->curl);
+    free(h->resp.data);
+}
+
+// body == NULL — GET; mime — multipart (как у telebot); ответ в h->resp
+static int http_call(Http *h, const char *path, const char *body, size_t body_len, curl_mime *mime, long timeout_s) {
+    char url[1024];
+    snprintf(url, sizeof(url), "%s%s", h->base, path);
+    h->resp.len = 0;
+    curl_easy_setopt(h->curl, CURLOPT_URL, url);
+    curl_easy_setopt(h->curl, CURLOPT_TIMEOUT, timeout_s);
+    curl_easy_setopt(h->curl, CURLOPT_MIMEPOST, (curl_mime *)NULL);
+    if (mime) {
+        curl_easy_setopt(h->curl, CURLOPT_MIMEPOST, mime);
+    } else if (body) {
+        curl_easy_setopt(h->curl, CURLOPT_POSTFIELDS, body);
+        curl_easy_setopt(h->curl, CURLOPT_POSTFIELDSIZE, (long)body_len);
+    } else {
+        curl_easy_setopt(h->curl, CURLOPT_HTTPGET, 1L);
+    }
+    CURLcode rc = curl_easy_perform(h->curl);
+    long code = 0;
+    curl_easy_getinfo(h->curl, CURLINFO_RESPONSE_CODE, &code);
+    if (h->resp.data) h->resp.data[h->resp.len] = '\0';
+    return rc == CURLE_OK && code == 200 ? 0 : -1;
+}
+
+// Число по ключу "key": в ответе сервера (формат известен — полный разбор не нужен)
+static int json_number(const char *s, const char *key, double *out) {
+    char pat[64];
+    snprintf(pat, sizeof(pat), "\"%s\":", key);
+    const char *p = strstr(s, pat);
+    if (!p) return -1;
+    *out = strtod(p + strlen(pat), NULL);
+    return 0;
+}
+
+// === Трафик ===
+
+typedef struct {
+    double t;                  // секунды от начала; < 0 — по --rate
+    long long chat;
+    char *line;                // готовая строка JSONL для /_inject
+} Event;
+
+static char **texts;
+static size_t n_texts;
+
+static void json_escape_into(Buf *b, const char *s, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = (unsigned char)s[i];
+        char esc[8];
+        if (c == '"' || c == '\\') { esc[0] = '\\'; esc[1] = (char)c; buf_append(b, esc, 2); }
+        else if (c == '\n') buf_append(b, "\\n", 2);
+        else if (c == '\t') buf_append(b, "\\t", 2);
+        else if (c < 0x20) { snprintf(esc, sizeof(esc), "\\u%04x", c); buf_append(b, esc, 6); }
+        else buf_append(b, (const char *)&s[i], 1);
+    }
+}
+
+static int load_texts(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t n;
+    size_t alloc = 0;
+    while ((n = getline(&line, &cap, f)) > 0) {
+        while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r')) line[--n] = '\0';
+        if (n == 0) continue;
+        if (n > MAX_TEXT) {
+            // не рвём UTF-8 посередине символа
+            n = MAX_TEXT;
+            while (n > 0 && ((unsigned char)line[n] & 0xC0) == 0x80) n--;
+            line[n] = '\0';
+        }
+        if (n_texts == alloc) {
+            alloc = alloc ? alloc * 2 : 1024;
+            char **t = realloc(texts, alloc * sizeof(*t));
+            if (!t) break;
+            texts = t;
+        }
+        texts[n_texts++] = strdup(line);
+    }
+    free(line);
+    fclose(f);
+    return n_texts ? 0 : -1;
+}
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ull;
+
+static uint64_t rng(void) {
+    uint64_t z = (rng_state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// Синтетическое сообщение: команды бота и свободный текст
+static char *synthetic_line(long long chat) {
+    static const char *const commands[] = { "/start", "/help", "/dice", "hello" };
+    Buf b = {0};
+    char head[128];
+    snprintf(head, sizeof(head), "{\"chat_id\":%lld,\"first_name\":\"User%lld\",\"text\":\"", chat, chat);
+    buf_append(&b, head, strlen(head));
+    uint64_t r = rng() % 100;
+    const char *text = r < 10 ? commands[0] : r < 20 ? commands[1] : r < 35 ? commands[2]
+                     : n_texts ? texts[rng() % n_texts] : commands[3];
+    json_escape_into(&b, text, strlen(text));
+    buf_append(&b, "\"}", 2);
+    return b.data;
+}
+
+static double field_number(const char *line, const char *key, double def) {
+    double v;
+    return json_number(line, key, &v) == 0 ? v : def;
+}
+
+static Event *load_replay(const char *path, size_t *n_events) {
+    FILE *f = fopen(path, "r");
+    if (!f) return NULL;
+    Event *ev = NULL;
+    size_t n = 0, alloc = 0;
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    while ((len = getline(&line, &cap, f)) > 0) {
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) line[--len] = '\0';
+        if (len == 0 || !strstr(line, "\"text\"")) continue;
+        if (n == alloc) {
+            alloc = alloc ? alloc * 2 : 1024;
+            Event *e = realloc(ev, alloc * sizeof(*e));
+            if (!e) break;
+            ev = e;
+        }
+        ev[n].t = field_number(line, "t", -1);
+        ev[n].chat = (long long)field_number(line, "chat_id", 1);
+        ev[n].line = strdup(line);
+        n++;
+    }
+    free(line);
+    fclose(f);
+    *n_events = n;
+    return ev;
+}
+
+// === Встроенный бот ===
+
+typedef struct {
+    long long update_id, message_id, chat;
+    char text[64];             // команды короче; для ответа достаточно начала
+} Job;
+
+typedef struct {
+    const char *base;
+    int workers;               // 0 — serial
+    int long_poll;             // секунд; 0 — короткий опрос
+    int short_pause_ms;
+    volatile int stop;
+    ShardRouter *shards;
+    double shard_kill_s;       // 0 — не убивать
+    double resize_at_s;
+    int resize_to;
+
+    pthread_mutex_t mu;
+    pthread_cond_t cv;
+    Job *queue;
+    size_t q_head, q_len, q_cap;
+} Bot;
+
+static int bot_reply(Http *h, const Job *j) {
+    char chat[32], reply_to[32];
+    snprintf(chat, sizeof(chat), "%lld", j->chat);
+    snprintf(reply_to, sizeof(reply_to), "%lld", j->message_id);
+    const char *method = "sendMessage", *text, *mode = "";
+    if (strcmp(j->text, "/start") == 0) {
+        text = "👋 Привет!\n\nЯ — <b>OXXYEN Bot</b> 🧠\nБот, написанный полностью на чистом C.";
+        mode = "HTML";
+    } else if (strcmp(j->text, "/help") == 0) {
+        text = "📘 <b>Помощь</b>\n\nМои команды:\n  • /start\n  • /help\n  • /dice";
+        mode = "HTML";
+    } else if (strcmp(j->text, "/dice") == 0) {
+        method = "sendDice";
+        text = NULL;
+    } else {
+        text = "🤖 Неизвестная команда.\nВведите /help, чтобы узнать доступные.";
+    }
+    // Поля формы — как у telebot_send_message / telebot_send_dice
+    curl_mime *mime = curl_mime_init(h->curl);
+    curl_mimepart *part = curl_mime_addpart(mime);
+    curl_mime_name(part, "chat_id");
+    curl_mime_data(part, chat, CURL_ZERO_TERMINATED);
+    if (text) {
+        part = curl_mime_addpart(mime);
+        curl_mime_name(part, "text");
+        curl_mime_data(part, text, CURL_ZERO_TERMINATED);
+        part = curl_mime_addpart(mime);
+        curl_mime_name(part, "parse_mode");
+        curl_mime_data(part, mode, CURL_ZERO_TERMINATED);
+        part = curl_mime_addpart(mime);
+        curl_mime_name(part, "reply_to_message_id");
+        curl_mime_data(part, reply_to, CURL_ZERO_TERMINATED);
+    }
+    char path[64];
+    snprintf(path, sizeof(path), "/botBENCH/%s", method);
+    int rc = http_call(h, path, NULL, 0, mime, 10);
+    curl_mime_free(mime);
+    return rc;
+}
+
+// Апдейты из ответа getUpdates; формат ответа fake_tgapi известен
+static size_t parse_updates(const char *s, Job *jobs, size_t max) {
+    size_t n = 0;
+    for (const char *p = s; n < max && (p = strstr(p, "\"update_id\":")); n++) {
+        Job *j = &jobs[n];
+        memset(j, 0, sizeof(*j));
+        j->update_id = strtoll(p + 12, NULL, 10);
+        const char *m = strstr(p, "\"message_id\":");
+        const char *c = strstr(p, "\"chat\":{\"id\":");
+        const char *t = strstr(p, "\"text\":\"");
+        if (m) j->message_id = strtoll(m + 13, NULL, 10);
+        if (c) j->chat = strtoll(c + 13, NULL, 10);
+        if (t) {
+            t += 8;
+            size_t k = 0;
+            while (t[k] && t[k] != '"' && k + 1 < sizeof(j->text)) { j->text[k] = t[k]; k++; }
+            j->text[k] = '\0';
+        }
+        p += 12;
+    }
+    return n;
+}
+
+static void *bot_worker(void *arg) {
+    Bot *b = arg;
+    Http h;
+    if (http_init(&h, b->base) != 0) return NULL;
+    for (;;) {
+        pthread_mutex_lock(&b->mu);
+        while (b->q_len == 0 && !b->stop) pthread_cond_wait(&b->cv, &b->mu);
+        if (b->q_len == 0) { pthread_mutex_unlock(&b->mu); break; }
+        Job j = b->queue[b->q_head];
+        b->q_head = (b->q_head + 1) % b->q_cap;
+        b->q_len--;
+        pthread_mutex_unlock(&b->mu);
+        bot_reply(&h, &j);
+    }
+    http_free(&h);
+    return NULL;
+}
+
+static int bot_enqueue(Bot *b, const Job *j) {
+    pthread_mutex_lock(&b->mu);
+    if (b->q_len == b->q_cap) {
+        size_t cap = b->q_cap ? b->q_cap * 2 : 1024;
+        Job *q = malloc(cap * sizeof(*q));
+        if (!q) { pthread_mutex_unlock(&b->mu); return -1; }
+        for (size_t i = 0; i < b->q_len; i++) q[i] = b->queue[(b->q_head + i) % b->q_cap];
+        free(b->queue);
+        b->queue = q;
+        b->q_cap = cap;
+        b->q_head = 0;
+    }
+    b->queue[(b->q_head + b->q_len) % b->q_cap] = *j;
+    b->q_len++;
+    pthread_cond_signal(&b->cv);
+    pthread_mutex_unlock(&b->mu);
+    return 0;
+}
+
+static void *bot_poller(void *arg) {
+    Bot *b = arg;
+    Http h;
+    if (http_init(&h, b->base) != 0) return NULL;
+    Job jobs[100];
+    long long offset = 0;
+    while (!b->stop) {
+        char path[128];
+        snprintf(path, sizeof(path), "/botBENCH/getUpdates?offset=%lld&limit=100&timeout=%d", offset, b->long_poll);
+        if (http_call(&h, path, NULL, 0, NULL, b->long_poll + 10) != 0) {
+            sleep_us(100000);
+            continue;
+        }
+        size_t n = parse_updates(h.resp.data ? h.resp.data : "", jobs, 100);
+        for (size_t i = 0; i < n; i++) {
+            if (b->shards) {
+                ShardUpdate u = {
+                    .update_id = jobs[i].update_id,
+                    .chat_id = jobs[i].chat,
+                    .message_id = jobs[i].message_id,
+                    .text = jobs[i].text,
+                };
+                shard_dispatch(b->shards, &u);
+            }
+            else if (b->workers == 0) bot_reply(&h, &jobs[i]);
+            else bot_enqueue(b, &jobs[i]);
+            offset = jobs[i].update_id + 1;
+        }
+        if (!b->long_poll && b->short_pause_ms > 0) sleep_us((uint64_t)b->short_pause_ms * 1000u);
+    }
+    http_free(&h);
+    return NULL;
+}
+
+// Шард — отдельный процесс со своим соединением
+static Http shard_http;
+
+static int shard_init(int shard, void *ctx) {
+    (void)shard;
+    Bot *b = ctx;
+    return http_init(&shard_http, b->base);
+}
+
+static void shard_handle(int shard, const ShardUpdate *u, void *ctx) {
+    (void)shard;
+    (void)ctx;
+    Job j = { .update_id = u->update_id, .message_id = u->message_id, .chat = u->chat_id };
+    snprintf(j.text, sizeof(j.text), "%s", u->text);
+    bot_reply(&shard_http, &j);
+}
+
+// Отказы во время прогона: SIGKILL случайному шарду, смена числа шардов
+static void *shard_chaos(void *arg) {
+    Bot *b = arg;
+    uint64_t t0 = now_us(), next_kill = b->shard_kill_s > 0 ? (uint64_t)(b->shard_kill_s * 1e6) : UINT64_MAX;
+    int resized = b->resize_to <= 0;
+    unsigned seed = (unsigned)t0;   // rng() занят потоком впрыска
+    while (!b->stop) {
+        sleep_us(50000);
+        uint64_t t = now_us() - t0;
+        if (!resized && t >= (uint64_t)(b->resize_at_s * 1e6)) {
+            printf("🔀 Resizing to %d shards\n", b->resize_to);
+            fflush(stdout);
+            shard_resize(b->shards, b->resize_to);
+            resized = 1;
+        }
+        if (t >= next_kill) {
+            next_kill += (uint64_t)(b->shard_kill_s * 1e6);
+            for (int tries = 0; tries < SHARD_MAX_WORKERS; tries++) {
+                pid_t pid = shard_pid(b->shards, rand_r(&seed) % SHARD_MAX_WORKERS);
+                if (pid <= 0) continue;
+                kill(pid, SIGKILL);
+                break;
+            }
+        }
+    }
+    return NULL;
+}
+
+// === Основная функция ===
+
+int main(int argc, char *argv[]) {
+    const char *server = "http://127.0.0.1:8081";
+    double rate = 100, duration = 10, speed = 1, drain = 10;
+    long long count = 0;
+    int chats = 100;
+    const char *texts_path = NULL, *replay_path = NULL, *json_path = NULL;
+    const char *bot_mode = "none", *poll_mode = "long:25";
+    const char *shard_resize_arg = NULL;
+    double shard_kill = 0;
+    int shards = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--server") == 0 && i + 1 < argc) server = argv[++i];
+        else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) rate = atof(argv[++i]);
+        else if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) duration = atof(argv[++i]);
+        else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) count = atoll(argv[++i]);
+        else if (strcmp(argv[i], "--chats") == 0 && i + 1 < argc) chats = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--texts") == 0 && i + 1 < argc) texts_path = argv[++i];
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) replay_path = argv[++i];
+        else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) speed = atof(argv[++i]);
+        else if (strcmp(argv[i], "--drain") == 0 && i + 1 < argc) drain = atof(argv[++i]);
+        else if (strcmp(argv[i], "--bot") == 0 && i + 1 < argc) bot_mode = argv[++i];
+        else if (strcmp(argv[i], "--poll") == 0 && i + 1 < argc) poll_mode = argv[++i];
+        else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) json_path = argv[++i];
+        else if (strcmp(argv[i], "--shard-kill") == 0 && i + 1 < argc) shard_kill = atof(argv[++i]);
+        else if (strcmp(argv[i], "--shard-resize") == 0 && i + 1 < argc) shard_resize_arg = argv[++i];
+        else {
+            fprintf(stderr, "Usage: %s [--server URL] [--rate N] [--duration S] [--count N] [--chats N] [--texts FILE]\n"
+                            "          [--replay FILE] [--speed X] [--drain S] [--bot none|serial|pool:N|shards:N]\n"
+                            "          [--poll short:MS|long:S] [--json FILE|-] [--shard-kill S] [--shard-resize S:N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (chats < 1) chats = 1;
+    if (speed <= 0) speed = 1;
+
+    Bot bot = { .base = server };
+    int run_bot = strcmp(bot_mode, "none") != 0;
+    if (strncmp(bot_mode, "pool:", 5) == 0) bot.workers = atoi(bot_mode + 5);
+    else if (strncmp(bot_mode, "shards:", 7) == 0) shards = atoi(bot_mode + 7);
+    else if (run_bot && strcmp(bot_mode, "serial") != 0) {
+        fprintf(stderr, "Error: unknown bot mode '%s'\n", bot_mode);
+        return 1;
+    }
+    if (strncmp(poll_mode, "long:", 5) == 0) bot.long_poll = atoi(poll_mode + 5);
+    else if (strncmp(poll_mode, "short:", 6) == 0) bot.short_pause_ms = atoi(poll_mode + 6);
+    else {
+        fprintf(stderr, "Error: unknown poll mode '%s'\n", poll_mode);
+        return 1;
+    }
+    if (bot.long_poll < 0) bot.long_poll = 0;
+    bot.shard_kill_s = shard_kill;
+    if (shard_resize_arg && sscanf(shard_resize_arg, "%lf:%d", &bot.resize_at_s, &bot.resize_to) != 2) {
+        fprintf(stderr, "Error: --shard-resize expects S:N\n");
+        return 1;
+    }
+
+    if (texts_path && load_texts(texts_path) != 0) {
+        fprintf(stderr, "Error: cannot read texts '%s'\n", texts_path);
+        return 1;
+    }
+    Event *events = NULL;
+    size_t n_events = 0;
+    if (replay_path && !(events = load_replay(replay_path, &n_events))) {
+        fprintf(stderr, "Error: cannot read replay '%s': %s\n", replay_path, strerror(errno));
+        return 1;
+    }
+    if (!replay_path) n_events = count > 0 ? (size_t)count : (size_t)(rate * duration);
+    if (rate <= 0 && (!replay_path || (n_events && events[0].t < 0))) rate = 1e9;   // без пауз
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    Http ctl;
+    if (http_init(&ctl, server) != 0 || http_call(&ctl, "/_reset", "", 0, NULL, 10) != 0) {
+        fprintf(stderr, "Error: fake Bot API is not reachable at %s (run fake_tgapi)\n", server);
+        return 1;
+    }
+
+    pthread_mutex_init(&bot.mu, NULL);
+    pthread_cond_init(&bot.cv, NULL);
+    pthread_t poller, chaos, *workers = NULL;
+    int workers_started = 0, chaos_started = 0;
+    if (run_bot) {
+        if (shards > 0) {
+            // fork шардов — пока в процессе нет других потоков
+            ShardConfig sc = { .workers = shards, .init = shard_init, .handle = shard_handle, .ctx = &bot };
+            if (!(bot.shards = shard_start(&sc))) {
+                fprintf(stderr, "Error: cannot start %d shards\n", shards);
+                return 1;
+            }
+            if ((bot.shard_kill_s > 0 || bot.resize_to > 0) &&
+                pthread_create(&chaos, NULL, shard_chaos, &bot) == 0) chaos_started = 1;
+        }
+        else if (bot.workers > 0) {
+            workers = calloc((size_t)bot.workers, sizeof(*workers));
+            for (; workers && workers_started < bot.workers; workers_started++) {
+                if (pthread_create(&workers[workers_started], NULL, bot_worker, &bot) != 0) break;
+            }
+            if (workers_started == 0) bot.workers = 0;
+        }
+        if (pthread_create(&poller, NULL, bot_poller, &bot) != 0) {
+            fprintf(stderr, "Error: cannot start bot thread\n");
+            return 1;
+        }
+    }
+
+    printf("🚦 %zu updates → %s (bot: %s, poll: %s)\n", n_events, server, bot_mode, poll_mode);
+    fflush(stdout);
+
+    // Впрыск: всё, что «созрело» к текущему моменту, уходит одним POST
+    Buf batch = {0};
+    uint64_t t0 = now_us();
+    size_t sent = 0, errors = 0;
+    while (sent < n_events) {
+        uint64_t now = now_us();
+        double elapsed = (double)(now - t0) / 1e6;
+        size_t due = sent;
+        while (due < n_events && due - sent < INJECT_BATCH) {
+            double t = events && events[due].t >= 0 ? events[due].t / speed : (double)due / rate;
+            if (t > elapsed) break;
+            due++;
+        }
+        if (due == sent) {
+            double t = events && events[sent].t >= 0 ? events[sent].t / speed : (double)sent / rate;
+            double wait = t - elapsed;
+            sleep_us(wait > 0.001 ? (uint64_t)(wait * 1e6) : 200);
+            continue;
+        }
+        batch.len = 0;
+        for (size_t i = sent; i < due; i++) {
+            char *line = events ? events[i].line : synthetic_line(1000000 + (long long)(rng() % (uint64_t)chats));
+            buf_append(&batch, line, strlen(line));
+            buf_append(&batch, "\n", 1);
+            if (!events) free(line);
+        }
+        if (http_call(&ctl, "/_inject", batch.data, batch.len, NULL, 10) != 0) errors++;
+        sent = due;
+    }
+    uint64_t t_inject_end = now_us();
+
+    // Дожидаемся ответов
+    double pending = 0;
+    for (uint64_t deadline = now_us() + (uint64_t)(drain * 1e6);;) {
+        if (http_call(&ctl, "/_stats", NULL, 0, NULL, 10) == 0 &&
+            json_number(ctl.resp.data, "pending", &pending) == 0 && pending == 0) break;
+        if (now_us() >= deadline) break;
+        sleep_us(50000);
+    }
+    if (http_call(&ctl, "/_stats", NULL, 0, NULL, 10) != 0) {
+        fprintf(stderr, "Error: cannot read stats from %s\n", server);
+        return 1;
+    }
+    Buf stats = {0};
+    buf_append(&stats, ctl.resp.data, ctl.resp.len);
+
+    if (run_bot) {
+        bot.stop = 1;
+        http_call(&ctl, "/_reset", "", 0, NULL, 10);   // отпускает ждущий getUpdates
+        pthread_join(poller, NULL);
+        pthread_mutex_lock(&bot.mu);
+        pthread_cond_broadcast(&bot.cv);
+        pthread_mutex_unlock(&bot.mu);
+        for (int i = 0; i < workers_started; i++) pthread_join(workers[i], NULL);
+        if (chaos_started) pthread_join(chaos, NULL);
+    }
+    if (bot.shards) {
+        ShardStats ss;
+        shard_stats(bot.shards, &ss);
+        shard_stop(bot.shards, 1000);
+        printf("🧩 Shards: %d up, %llu deaths (%llu hung), %llu restarts, %llu redispatched, %llu dropped\n",
+               ss.workers, (unsigned long long)ss.deaths, (unsigned long long)ss.hung,
+               (unsigned long long)ss.restarts, (unsigned long long)ss.redispatched,
+               (unsigned long long)ss.dropped);
+    }
+
+    double inject_s = (double)(t_inject_end - t0) / 1e6;
+    double v[8] = {0};
+    const char *lat = strstr(stats.data, "\"latency_ms\"");
+    const char *del = strstr(stats.data, "\"delivery_ms\"");
+    json_number(stats.data, "matched", &v[0]);
+    json_number(stats.data, "throughput", &v[1]);
+    json_number(stats.data, "pending", &v[2]);
+    if (lat) {
+        json_number(lat, "p50", &v[3]);
+        json_number(lat, "p99", &v[4]);
+        json_number(lat, "p999", &v[5]);
+    }
+    if (del) json_number(del, "p99", &v[6]);
+
+    printf("📤 Injected %zu updates in %.2f s (%.0f/s)%s\n", sent, inject_s, inject_s > 0 ? (double)sent / inject_s : 0,
+           errors ? " — some batches failed" : "");
+    printf("📥 Replies: %.0f (%.0f without answer), %.1f replies/s\n", v[0], v[2], v[1]);
+    printf("⏱️  Update→reply latency: p50 %.2f ms, p99 %.2f ms, p999 %.2f ms (delivery p99 %.2f ms)\n",
+           v[3], v[4], v[5], v[6]);
+
+    if (json_path) {
+        FILE *f = strcmp(json_path, "-") == 0 ? stdout : fopen(json_path, "w");
+        if (!f) {
+            fprintf(stderr, "Error: cannot write '%s': %s\n", json_path, strerror(errno));
+            return 1;
+        }
+        // Ответ сервера вкладывается как есть: {"ok":true,"result":{...}}
+        const char *result = strstr(stats.data, "\"result\":");
+        const char *server_json = result ? result + 9 : "{}}";
+        Buf replay = {0};
+        if (replay_path) {
+            buf_append(&replay, "\"", 1);
+            json_escape_into(&replay, replay_path, strlen(replay_path));
+            buf_append(&replay, "\"", 1);
+        }
+        fprintf(f, "{\"config\":{\"bot\":\"%s\",\"poll\":\"%s\",\"rate\":%.1f,\"chats\":%d,\"replay\":%s},"
+                   "\"client\":{\"injected\":%zu,\"inject_s\":%.3f,\"inject_errors\":%zu},\"server\":%.*s}\n",
+                bot_mode, poll_mode, rate >= 1e9 ? 0 : rate, chats, replay.data ? replay.data : "null",
+                sent, inject_s, errors, (int)strlen(server_json) - 1, server_json);
+        free(replay.data);
+        if (f != stdout) fclose(f);
+    }
+
+    free(stats.data);
+    free(batch.data);
+    http_free(&ctl);
+    curl_global_cleanup();
+    return pending == 0 ? 0 : 2;
+}
@@ -0,0 +1,45 @@
+// tg_redirect.c — перенаправление запросов к api.telegram.org на fake_tgapi
+// gcc -O2 -shared -fPIC -o tg_redirect.so tg_redirect.c -ldl
+// TG_API_URL=http://127.0.0.1:8081 LD_PRELOAD=./tg_redirect.so ./main
+//
+// telebot зашивает адрес API в библиотеку, поэтому main.c и stable.c
+// не меняются: перехватывается curl_easy_setopt, и у CURLOPT_URL префикс
+// https://api.telegram.org заменяется на $TG_API_URL. Остальные опции
+// передаются настоящей libcurl без изменений.
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <curl/curl.h>
+
+#undef curl_easy_setopt
+
+#define TELEGRAM_API "https://api.telegram.org"
+#define DEFAULT_TARGET "http://127.0.0.1:8081"
+
+typedef CURLcode (*setopt_fn)(CURL *, CURLoption, ...);
+
+CURLcode curl_easy_setopt(CURL *curl, CURLoption option, ...) {
+    static setopt_fn real;
+    if (!real) real = (setopt_fn)dlsym(RTLD_NEXT, "curl_easy_setopt");
+    if (!real) return CURLE_FAILED_INIT;
+
+    // Все опции — одно машинное слово (long, указатель, curl_off_t на 64 битах)
+    va_list ap;
+    va_start(ap, option);
+    void *arg = va_arg(ap, void *);
+    va_end(ap);
+
+    if (option == CURLOPT_URL && arg && strncmp(arg, TELEGRAM_API, strlen(TELEGRAM_API)) == 0) {
+        const char *target = getenv("TG_API_URL");
+        if (!target || !*target) target = DEFAULT_TARGET;
+        // libcurl копирует строку URL, буфер на стеке достаточен
+        char url[4096];
+        snprintf(url, sizeof(url), "%s%s", target, (const char *)arg + strlen(TELEGRAM_API));
+        return real(curl, option, url);
+    }
+    return real(curl, option, arg);
+}
@@ -4,19 +4,123 @@
 #include <string.h>
 #include <unistd.h>
 #include <stdbool.h>
+#include <signal.h>
 
 #include "telebot/include/telebot.h"
 #include "llama.cpp/include/llama.h"
+#include "trace.h"
+#include "llm_load.h"
+#include "dataset/annindex.h"
+#include "dataset/embed.h"
+
+#define RAG_PASSAGE_BYTES 1000     // на один найденный фрагмент
+#define RAG_CONTEXT_BYTES 3200     // ~1000 токенов из n_ctx 2048
+
+// SIGTERM от очереди main (llm_sched.h): запрос вытеснен или просрочен.
+// Генерация проверяет флаг между шагами декодирования и выходит без ответа
+static volatile sig_atomic_t cancelled = 0;
+
+static void on_sigterm(int sig) {
+    (void)sig;
+    cancelled = 1;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s [options] <model.gguf> <chat_id> \"<prompt>\"\n"
+        "       %s [options] --warm-only <model.gguf>\n"
+        "  --populate        read the whole GGUF into page cache before load (MAP_POPULATE)\n"
+        "  --willneed        background readahead (MADV_WILLNEED)\n"
+        "  --hugepages       ask for transparent hugepages (MADV_HUGEPAGE)\n"
+        "  --hugetlbfs DIR   stage the GGUF into explicit hugepages on hugetlbfs\n"
+        "  --mlock           lock weights in RAM\n"
+        "  --warmup N        warmup decode of N tokens before the prompt (8; 0 = off)\n"
+        "  --warm-only       load, warm up and exit (prime caches after deploy)\n"
+        "  --rag INDEX       add passages from an ann_index file to the prompt\n"
+        "  --embed-model M   GGUF embedding model the index was built with\n"
+        "  --rag-k N         passages to add (3)\n",
+        prog, prog);
+}
+
+// Фрагменты корпуса, ближайшие к вопросу (dataset/annindex.h), в out как
+// нумерованный список; число добавленных или -1
+static int rag_context(const char *index_path, const char *embed_path, const char *question,
+                       int k, char *out, size_t out_size) {
+    AnnIndex idx;
+    if (annindex_open(&idx, index_path) != 0) {
+        fprintf(stderr, "⚠️ RAG index %s unavailable\n", index_path);
+        return -1;
+    }
+    Embedder *emb = embedder_open(embed_path, 0, 4);
+    float *vec = emb ? malloc((size_t)embedder_dim(emb) * sizeof(float)) : NULL;
+    AnnHit hits[16];
+    AnnScratch scratch = {0};
+    int added = -1;
+    if (k > 16) k = 16;
+    if (vec && (uint32_t)embedder_dim(emb) == idx.hdr->dim &&
+        embedder_embed(emb, question, strlen(question), vec, NULL) > 0) {
+        size_t n = annindex_search(&idx, &scratch, vec, (size_t)k, 0, hits);
+        size_t used = 0;
+        added = 0;
+        out[0] = '\0';
+        for (size_t i = 0; i < n; i++) {
+            const char *src, *text;
+            size_t src_len, text_len;
+            if (annindex_text(&idx, hits[i].id, &src, &src_len, &text, &text_len) != 0) continue;
+            if (text_len > RAG_PASSAGE_BYTES) {
+                text_len = RAG_PASSAGE_BYTES;
+                while (text_len > 0 && ((unsigned char)text[text_len] & 0xC0) == 0x80) text_len--;
+            }
+            int w = snprintf(out + used, out_size - used, "[%d] (%.*s) %.*s\n", added + 1,
+                             (int)src_len, src, (int)text_len, text);
+            if (w < 0 || (size_t)w >= out_size - used) {
+                out[used] = '\0';
+                break;
+            }
+            used += (size_t)w;
+            added++;
+        }
+    } else if (vec) {
+        fprintf(stderr, "⚠️ RAG: embedding failed or dim mismatch with %s\n", index_path);
+    }
+    free(vec);
+    ann_scratch_free(&scratch);
+    embedder_close(emb);
+    annindex_close(&idx);
+    return added;
+}
 
 int main(int argc, char **argv) {
-    if (argc != 4) {
-        fprintf(stderr, "Usage: %s <model.gguf> <chat_id> \"<prompt>\"\n", argv[0]);
+    LlmLoadOptions load_opt = { .warmup_tokens = 8, .n_ctx = 2048, .n_threads = 4 };
+    bool warm_only = false;
+    const char *rag_index = NULL, *embed_model = NULL;
+    int rag_k = 3;
+    int argi = 1;
+    for (; argi < argc && strncmp(argv[argi], "--", 2) == 0; argi++) {
+        const char *a = argv[argi];
+        if (strcmp(a, "--populate") == 0) load_opt.populate = 1;
+        else if (strcmp(a, "--willneed") == 0) load_opt.willneed = 1;
+        else if (strcmp(a, "--hugepages") == 0) load_opt.hugepages = 1;
+        else if (strcmp(a, "--mlock") == 0) load_opt.mlock = 1;
+        else if (strcmp(a, "--warm-only") == 0) warm_only = true;
+        else if (strcmp(a, "--hugetlbfs") == 0 && argi + 1 < argc) load_opt.hugetlbfs_dir = argv[++argi];
+        else if (strcmp(a, "--warmup") == 0 && argi + 1 < argc) load_opt.warmup_tokens = atoi(argv[++argi]);
+        else if (strcmp(a, "--rag") == 0 && argi + 1 < argc) rag_index = argv[++argi];
+        else if (strcmp(a, "--embed-model") == 0 && argi + 1 < argc) embed_model = argv[++argi];
+        else if (strcmp(a, "--rag-k") == 0 && argi + 1 < argc) rag_k = atoi(argv[++argi]);
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (argc - argi != (warm_only ? 1 : 3) || (rag_index && !embed_model)) {
+        usage(argv[0]);
         return 1;
     }
 
-    const char *model_path = argv[1];
-    long long int chat_id = atoll(argv[2]);
-    const char *prompt = argv[3];
+    const char *model_path = argv[argi];
+    long long int chat_id = warm_only ? 0 : atoll(argv[argi + 1]);
+    const char *prompt = warm_only ? "" : argv[argi + 2];
 
     bool ok = true;
     bool bot_created = false;
@@ -28,31 +132,49 @@ int main(int argc, char **argv) {
     llama_model *model = NULL;
     llama_context *ctx = NULL;
 
-    char full_prompt[4096] = {0};
+    char full_prompt[16384] = {0};
+    char rag_ctx[RAG_CONTEXT_BYTES] = {0};
+
+    // Трасса одного запуска (trace.h); OXXYEN_TRACE_ID связывает её с апдейтом бота
+    trace_init("oxxyen-llm");
+    const char *trace_env = getenv("OXXYEN_TRACE_ID");
+    uint64_t trace_id = trace_env ? strtoull(trace_env, NULL, 10) : trace_new_id();
+    uint64_t t_start = trace_now();
+    uint64_t t0 = t_start;
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_sigterm;
+    sigaction(SIGTERM, &sa, NULL);
 
     /* ========== INIT LLaMA ========== */
     llama_backend_init();
 
-    model = llama_model_load_from_file(model_path, llama_model_default_params());
-    if (!model) {
-        fprintf(stderr, "❌ Model load failed: %s\n", model_path);
+    // Фазы холодного старта (llm_load.h) ложатся в трассу задним числом
+    LlmLoadStats load_stats;
+    if (llm_load(model_path, &load_opt, &model, &ctx, &load_stats) != 0) {
         ok = false;
     } else {
         model_loaded = true;
+        ctx_created = true;
+        llm_load_report(stderr, &load_stats);
     }
-
-    if (ok) {
-        llama_context_params ctx_params = llama_context_default_params();
-        ctx_params.n_ctx = 2048;
-        ctx_params.n_threads = 4;
-
-        ctx = llama_init_from_model(model, ctx_params);
-        if (!ctx) {
-            fprintf(stderr, "❌ Context init failed\n");
-            ok = false;
-        } else {
-            ctx_created = true;
-        }
+    const struct { const char *name; double ms; } phases[] = {
+        { "model_stage", load_stats.stage_ms }, { "model_prefault", load_stats.prefault_ms },
+        { "model_load", load_stats.load_ms }, { "warmup", load_stats.warmup_ms },
+        { "ctx_init", load_stats.ctx_ms },
+    };
+    for (size_t i = 0; i < sizeof(phases) / sizeof(phases[0]); i++) {
+        uint64_t dur = (uint64_t)(phases[i].ms * 1e6);
+        trace_interval(trace_id, "llm", phases[i].name, t0, t0 + dur, 0);
+        t0 += dur;
+    }
+    if (warm_only) {
+        // Только прогрев page cache / hugetlbfs после деплоя, без Telegram
+        if (ctx_created) llama_free(ctx);
+        if (model_loaded) llama_model_free(model);
+        llama_backend_free();
+        return ok ? 0 : 1;
     }
 
     /* ========== TELEGRAM INIT ========== */
@@ -85,20 +207,37 @@ int main(int argc, char **argv) {
         }
     }
 
+    if (cancelled) ok = false;   // отменён, пока грузилась модель
+
+    /* ========== RETRIEVAL ========== */
+    int n_passages = 0;
+    if (ok && rag_index) {
+        t0 = trace_now();
+        n_passages = rag_context(rag_index, embed_model, prompt, rag_k, rag_ctx, sizeof(rag_ctx));
+        trace_span(trace_id, "llm", "rag", t0, n_passages);
+    }
+
     /* ========== BUILD PROMPT & TOKENIZE ========== */
     int32_t n_tokens = 0;
     const llama_vocab *vocab = model ? &model->vocab : NULL;
 
     if (ok) {
-        int prompt_len = snprintf(full_prompt, sizeof(full_prompt),
-            "<|begin_of_text|><|start_header_id|>user<|end_header_id|>\n\n%s<|eot_id|><|start_header_id|>assistant<|end_header_id|>\n\n",
-            prompt);
+        int prompt_len = n_passages > 0
+            ? snprintf(full_prompt, sizeof(full_prompt),
+                "<|begin_of_text|><|start_header_id|>user<|end_header_id|>\n\n"
+                "Справочные материалы:\n%s\nВопрос: %s<|eot_id|><|start_header_id|>assistant<|end_header_id|>\n\n",
+                rag_ctx, prompt)
+            : snprintf(full_prompt, sizeof(full_prompt),
+                "<|begin_of_text|><|start_header_id|>user<|end_header_id|>\n\n%s<|eot_id|><|start_header_id|>assistant<|end_header_id|>\n\n",
+                prompt);
         if (prompt_len <= 0 || (size_t)prompt_len >= sizeof(full_prompt)) {
             telebot_send_message(bot, chat_id, "❌ Prompt too long", "", false, false, 0, "");
             ok = false;
         } else {
-            // Токенизация через vocab
-            n_tokens = llama_tokenize(vocab, full_prompt, (int32_t)strlen(full_prompt), NULL, 0, true, false);
+            t0 = trace_now();
+            // Токенизация через vocab: <|begin_of_text|> уже в шаблоне (add_special=false),
+            // служебные токены шаблона разбираются как токены, а не как текст (parse_special)
+            n_tokens = llama_tokenize(vocab, full_prompt, (int32_t)strlen(full_prompt), NULL, 0, false, true);
             if (n_tokens <= 0) {
                 telebot_send_message(bot, chat_id, "❌ Tokenization failed", "", false, false, 0, "");
                 ok = false;
@@ -108,11 +247,12 @@ int main(int argc, char **argv) {
                     telebot_send_message(bot, chat_id, "❌ Out of memory", "", false, false, 0, "");
                     ok = false;
                 } else {
-                    int32_t actual_n = llama_tokenize(vocab, full_prompt, (int32_t)strlen(full_prompt), tokens, n_tokens, true, false);
+                    int32_t actual_n = llama_tokenize(vocab, full_prompt, (int32_t)strlen(full_prompt), tokens, n_tokens, false, true);
                     if (actual_n != n_tokens || actual_n <= 0) {
                         telebot_send_message(bot, chat_id, "❌ Tokenization mismatch", "", false, false, 0, "");
                         ok = false;
                     }
+                    trace_span(trace_id, "llm", "tokenize", t0, n_tokens);
                 }
             }
         }
@@ -131,7 +271,11 @@ int main(int argc, char **argv) {
             const int32_t max_tokens = 256;
 
             for (int32_t i = 0; i < max_tokens && ok; ++i) {
+                if (cancelled) break;
+                trace_poll();
+                t0 = trace_now();
                 llama_token new_token = llama_sampler_sample(smpl, ctx, -1);
+                trace_span(trace_id, "llm", "sample", t0, i);
                 if (new_token == eos_token) break;
 
                 char piece[64] = {0};
@@ -144,7 +288,10 @@ int main(int argc, char **argv) {
                 response[n_gen] = '\0';
 
                 struct llama_batch next = llama_batch_get_one(&new_token, 1);
-                if (llama_decode(ctx, next) != 0) {
+                t0 = trace_now();
+                int decode_rc = llama_decode(ctx, next);
+                trace_span(trace_id, "llm", "llama_decode", t0, i);
+                if (decode_rc != 0) {
                     ok = false;
                     break;
                 }
@@ -153,9 +300,17 @@ int main(int argc, char **argv) {
             llama_sampler_free(smpl);
 
             if (n_gen == 0) strcpy(response, "No response.");
-            if (bot_created) telebot_send_message(bot, chat_id, response, "", false, false, 0, "");
+            if (cancelled) {
+                fprintf(stderr, "⏹️ Generation cancelled after %d bytes\n", n_gen);
+                ok = false;
+            } else if (bot_created) {
+                t0 = trace_now();
+                telebot_send_message(bot, chat_id, response, "", false, false, 0, "");
+                trace_span(trace_id, "telegram", "send_message", t0, chat_id);
+            }
         }
     }
+    trace_request_end(trace_id, "generate", t_start, chat_id);
 
     /* ========== CLEANUP ========== */
     free(tokens);
@@ -1,5 +1,9 @@
 gcc -Itelebot/include \
     main.c \
+    trace.c \
+    llm_sched.c \
+    shard.c \
+    alog.c \
     admin/admin.c \
     admin/terminal_chat.c \
     telebot/src/telebot.c \
@@ -0,0 +1,384 @@
+// ann.c — индекс эмбеддингов корпуса для RAG в bot.c (см. annindex.h, embed.h)
+// gcc -O2 -o ann_index ann.c annindex.c embed.c json_escape.c -L../llama.cpp/build/bin -lllama -lm
+// ./ann_index --model embed.gguf [--index corpus.ann] [--ctx N] [--threads N] [--m M]
+//             [--ef-construction N] [--field NAME] input.jsonl...
+// ./ann_index --model embed.gguf [--index corpus.ann] --query "текст" [-k N] [--ef N]
+// ./ann_index [--index corpus.ann] --bench N [-k N] [--ef N] [--model embed.gguf [--field NAME] held-out.jsonl...]
+// Вставка дописывает в индекс записи, которых в нём ещё нет (по хэшу
+// текста), поэтому повторный запуск на выросшем датасете эмбеддит только
+// новое. Вход — чанки chunk_dataset ({"text","metadata":{"source"}}),
+// osdev_dataset.jsonl (поле content) или memory.txt (--field output).
+// --bench сверяет поиск с точным перебором (полнота recall@k, задержка
+// p50/p99) на двух наборах запросов. Узлы самого индекса — оценка сверху:
+// запрос совпадает с узлом графа, и вход в его окрестность почти гарантирован.
+// Отложенные запросы — тексты входных файлов, которых нет в индексе (нужна
+// --model); без них — середины пар случайных узлов, тоже не узлы графа.
+// Полнота сильно зависит от данных: на равномерно распределённых векторах
+// она намного ниже, чем на эмбеддингах текста, где соседи сгруппированы.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "annindex.h"
+#include "embed.h"
+#include "json_escape.h"
+
+#define ANN_DEFAULT_INDEX "corpus.ann"
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+// Текст записи: поле field, затем "text"/"content", в messages-записи — ответ ассистента
+static int find_text(const char *line, size_t len, const char *field, const char **val, size_t *val_len) {
+    if (field) return json_find_string(line, len, field, val, val_len);
+    if (json_find_assistant(line, len, val, val_len) == 0) return 0;
+    if (json_find_string(line, len, "text", val, val_len) == 0) return 0;
+    return json_find_string(line, len, "content", val, val_len);
+}
+
+typedef struct {
+    uint64_t records, added, duplicates, skipped, truncated, tokens;
+    double embed_ms, insert_ms;
+} AddStats;
+
+static int add_file(AnnIndex *idx, AnnScratch *s, Embedder *emb, const char *path, const char *field,
+                    float *vec, AddStats *st) {
+    int fd = open(path, O_RDONLY);
+    struct stat sb;
+    if (fd < 0 || fstat(fd, &sb) != 0) {
+        perror(path);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    size_t size = (size_t)sb.st_size;
+    const char *data = size ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : "";
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("mmap");
+        return -1;
+    }
+    if (size) madvise((void *)data, size, MADV_SEQUENTIAL);
+
+    StrBuf text = {0}, source = {0};
+    int rc = 0;
+    for (size_t pos = 0; pos < size;) {
+        const char *nl = memchr(data + pos, '\n', size - pos);
+        size_t end = nl ? (size_t)(nl - data) : size;
+        const char *line = data + pos;
+        size_t len = end - pos;
+        pos = end + 1;
+        if (len == 0) continue;
+        st->records++;
+
+        const char *val, *src;
+        size_t val_len, src_len;
+        strbuf_reset(&text);
+        strbuf_reset(&source);
+        if (find_text(line, len, field, &val, &val_len) != 0 ||
+            json_unescape_append(&text, val, val_len) != 0 || text.len == 0) {
+            st->skipped++;
+            continue;
+        }
+        if (json_find_string(line, len, "source", &src, &src_len) == 0 ||
+            json_find_string(line, len, "url", &src, &src_len) == 0)
+            json_unescape_append(&source, src, src_len);
+        if (annindex_contains(idx, text.data, text.len)) {
+            st->duplicates++;
+            continue;
+        }
+
+        double t0 = now_ms();
+        int truncated = 0;
+        int n = embedder_embed(emb, text.data, text.len, vec, &truncated);
+        double t1 = now_ms();
+        st->embed_ms += t1 - t0;
+        if (n < 0) {
+            st->skipped++;
+            continue;
+        }
+        st->tokens += (uint64_t)n;
+        st->truncated += (uint64_t)truncated;
+        int added = annindex_add(idx, s, vec, source.data ? source.data : "", source.len, text.data, text.len);
+        st->insert_ms += now_ms() - t1;
+        if (added < 0) {
+            fprintf(stderr, "❌ Index insert failed at %s record %llu\n", path, (unsigned long long)st->records);
+            rc = -1;
+            break;
+        }
+        if (added == 0) st->added++;
+        else st->duplicates++;
+        if (st->added && st->added % 1000 == 0 && added == 0)
+            fprintf(stderr, "… %llu added (%.1f ms/embed, %.2f ms/insert)\n", (unsigned long long)st->added,
+                    st->embed_ms / (double)st->added, st->insert_ms / (double)st->added);
+    }
+    strbuf_free(&text);
+    strbuf_free(&source);
+    if (size) munmap((void *)data, size);
+    return rc;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Один набор запросов q (n × dim, нормированы): полнота против точного перебора и задержка
+static void bench_set(const AnnIndex *idx, const char *label, const float *q, int n, size_t k, uint32_t ef,
+                      AnnHit *hits, AnnHit *exact, double *lat) {
+    AnnScratch s = {0};
+    uint32_t dim = idx->hdr->dim;
+    uint64_t found = 0, total = 0;
+    for (int i = 0; i < n; i++) {
+        const float *v = q + (size_t)i * dim;
+        double t0 = now_ms();
+        size_t got = annindex_search(idx, &s, v, k, ef, hits);
+        lat[i] = now_ms() - t0;
+        size_t m = annindex_search_exact(idx, v, k, exact);
+        for (size_t a = 0; a < m; a++)
+            for (size_t b = 0; b < got; b++)
+                if (exact[a].id == hits[b].id) { found++; break; }
+        total += m;
+    }
+    qsort(lat, (size_t)n, sizeof(double), cmp_double);
+    printf("🔎 %-9s %d queries, k=%zu, ef=%u: recall %.4f, p50 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+           label, n, k, ef ? ef : ANN_DEFAULT_EF_SEARCH, total ? (double)found / (double)total : 0,
+           lat[n / 2], lat[(size_t)n * 99 / 100], lat[n - 1]);
+    ann_scratch_free(&s);
+}
+
+// Отложенные запросы: эмбеддинги текстов из path, которых нет в индексе; в q
+// с позиции *n до max
+static int held_out_queries(const AnnIndex *idx, Embedder *emb, const char *path, const char *field,
+                            float *q, int *n, int max) {
+    int fd = open(path, O_RDONLY);
+    struct stat sb;
+    if (fd < 0 || fstat(fd, &sb) != 0) {
+        perror(path);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    size_t size = (size_t)sb.st_size;
+    const char *data = size ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : "";
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("mmap");
+        return -1;
+    }
+    StrBuf text = {0};
+    uint32_t dim = idx->hdr->dim;
+    for (size_t pos = 0; pos < size && *n < max;) {
+        const char *nl = memchr(data + pos, '\n', size - pos);
+        size_t end = nl ? (size_t)(nl - data) : size;
+        const char *line = data + pos, *val;
+        size_t len = end - pos, val_len;
+        pos = end + 1;
+        strbuf_reset(&text);
+        if (len == 0 || find_text(line, len, field, &val, &val_len) != 0 ||
+            json_unescape_append(&text, val, val_len) != 0 || text.len == 0 ||
+            annindex_contains(idx, text.data, text.len))
+            continue;
+        float *v = q + (size_t)*n * dim;
+        if (embedder_embed(emb, text.data, text.len, v, NULL) > 0 && ann_normalize(v, dim) == 0) (*n)++;
+    }
+    strbuf_free(&text);
+    if (size) munmap((void *)data, size);
+    return 0;
+}
+
+// emb и inputs — источник отложенных запросов, может не быть
+static int run_bench(const AnnIndex *idx, int n_queries, size_t k, uint32_t ef, Embedder *emb,
+                     const char **inputs, int n_inputs, const char *field) {
+    uint32_t count = annindex_count(idx);
+    if (count == 0) {
+        fprintf(stderr, "Index is empty\n");
+        return 1;
+    }
+    uint32_t dim = idx->hdr->dim;
+    AnnHit *hits = malloc(k * sizeof(AnnHit)), *exact = malloc(k * sizeof(AnnHit));
+    double *lat = malloc((size_t)n_queries * sizeof(double));
+    float *q = malloc((size_t)n_queries * dim * sizeof(float));
+    int rc = 1;
+    if (!hits || !exact || !lat || !q) goto out;
+    printf("📐 %u vectors × %u dim, M=%u, kernel %s\n", count, dim, idx->hdr->m, ann_dot_impl());
+
+    for (int i = 0; i < n_queries; i++) {
+        uint32_t id = (uint32_t)(((uint64_t)i * 2654435761u) % count);
+        memcpy(q + (size_t)i * dim, annindex_vector(idx, id), dim * sizeof(float));
+    }
+    bench_set(idx, "in-index", q, n_queries, k, ef, hits, exact, lat);
+
+    int n = 0;
+    const char *label = "held-out";
+    if (emb) {
+        for (int i = 0; i < n_inputs && n < n_queries; i++)
+            if (held_out_queries(idx, emb, inputs[i], field, q, &n, n_queries) != 0) goto out;
+        if (n < n_queries) fprintf(stderr, "⚠️ only %d held-out texts not in the index\n", n);
+    } else if (count > 1) {
+        label = "midpoint";
+        uint64_t x = 0x9E3779B97F4A7C15ull;
+        for (; n < n_queries; n++) {
+            x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+            uint32_t a = (uint32_t)(x % count), b = (uint32_t)((x >> 32) % (count - 1));
+            if (b >= a) b++;
+            const float *va = annindex_vector(idx, a), *vb = annindex_vector(idx, b);
+            float *v = q + (size_t)n * dim;
+            for (uint32_t d = 0; d < dim; d++) v[d] = va[d] + vb[d];
+            if (ann_normalize(v, dim) != 0) n--;     // противоположные векторы
+        }
+    }
+    if (n > 0) bench_set(idx, label, q, n, k, ef, hits, exact, lat);
+    rc = 0;
+out:
+    free(hits);
+    free(exact);
+    free(lat);
+    free(q);
+    return rc;
+}
+
+static int run_query(const char *index_path, Embedder *emb, const char *query, size_t k, uint32_t ef) {
+    AnnIndex idx;
+    if (annindex_open(&idx, index_path) != 0) {
+        fprintf(stderr, "❌ Cannot open index %s\n", index_path);
+        return 1;
+    }
+    if ((int)idx.hdr->dim != embedder_dim(emb)) {
+        fprintf(stderr, "❌ Index dim %u != model dim %d\n", idx.hdr->dim, embedder_dim(emb));
+        annindex_close(&idx);
+        return 1;
+    }
+    float *vec = malloc((size_t)embedder_dim(emb) * sizeof(float));
+    AnnHit *hits = malloc(k * sizeof(AnnHit));
+    AnnScratch s = {0};
+    int rc = 1;
+    double t0 = now_ms();
+    if (vec && hits && embedder_embed(emb, query, strlen(query), vec, NULL) > 0) {
+        double t1 = now_ms();
+        size_t n = annindex_search(&idx, &s, vec, k, ef, hits);
+        double t2 = now_ms();
+        printf("⏱️ embed %.2f ms, search %.3f ms\n", t1 - t0, t2 - t1);
+        for (size_t i = 0; i < n; i++) {
+            const char *src, *text;
+            size_t src_len, text_len;
+            if (annindex_text(&idx, hits[i].id, &src, &src_len, &text, &text_len) != 0) continue;
+            int shown = text_len > 200 ? 200 : (int)text_len;
+            while (shown > 0 && shown < (int)text_len && ((unsigned char)text[shown] & 0xC0) == 0x80) shown--;
+            printf("%zu. [%.4f] %.*s\n   %.*s%s\n", i + 1, hits[i].dist, (int)src_len, src, shown, text,
+                   shown < (int)text_len ? "…" : "");
+        }
+        rc = 0;
+    }
+    free(vec);
+    free(hits);
+    ann_scratch_free(&s);
+    annindex_close(&idx);
+    return rc;
+}
+
+int main(int argc, char *argv[]) {
+    const char *model_path = NULL, *index_path = ANN_DEFAULT_INDEX, *field = NULL, *query = NULL;
+    int n_ctx = 0, n_threads = 0, bench = 0;
+    uint32_t m = 0, ef_construction = 0, ef = 0;
+    size_t k = 5;
+    const char **inputs = calloc((size_t)argc, sizeof(char *));
+    int n_inputs = 0;
+    if (!inputs) return 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--model") == 0 && i + 1 < argc) model_path = argv[++i];
+        else if (strcmp(argv[i], "--index") == 0 && i + 1 < argc) index_path = argv[++i];
+        else if (strcmp(argv[i], "--ctx") == 0 && i + 1 < argc) n_ctx = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) n_threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--m") == 0 && i + 1 < argc) m = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--ef-construction") == 0 && i + 1 < argc) ef_construction = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--ef") == 0 && i + 1 < argc) ef = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--field") == 0 && i + 1 < argc) field = argv[++i];
+        else if (strcmp(argv[i], "--query") == 0 && i + 1 < argc) query = argv[++i];
+        else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) k = (size_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) bench = atoi(argv[++i]);
+        else inputs[n_inputs++] = argv[i];
+    }
+    if (k == 0) k = 1;
+
+    if (bench > 0 && !model_path) {
+        AnnIndex idx;
+        if (annindex_open(&idx, index_path) != 0) {
+            fprintf(stderr, "❌ Cannot open index %s\n", index_path);
+            return 1;
+        }
+        int rc = run_bench(&idx, bench, k, ef, NULL, NULL, 0, NULL);
+        annindex_close(&idx);
+        return rc;
+    }
+    if (!model_path || (!query && n_inputs == 0)) {
+        fprintf(stderr, "Usage: %s --model embed.gguf [--index FILE] [--ctx N] [--threads N] [--m M] "
+                        "[--ef-construction N] [--field NAME] input.jsonl...\n"
+                        "       %s --model embed.gguf [--index FILE] --query TEXT [-k N] [--ef N]\n"
+                        "       %s [--index FILE] --bench N [-k N] [--ef N] "
+                        "[--model embed.gguf [--field NAME] held-out.jsonl...]\n", argv[0], argv[0], argv[0]);
+        return 1;
+    }
+
+    llama_backend_init();
+    Embedder *emb = embedder_open(model_path, n_ctx, n_threads);
+    if (!emb) {
+        llama_backend_free();
+        return 1;
+    }
+    int rc = 0;
+    if (bench > 0) {
+        AnnIndex idx;
+        if (annindex_open(&idx, index_path) != 0) {
+            fprintf(stderr, "❌ Cannot open index %s\n", index_path);
+            rc = 1;
+        } else if ((int)idx.hdr->dim != embedder_dim(emb)) {
+            fprintf(stderr, "❌ Index dim %u != model dim %d\n", idx.hdr->dim, embedder_dim(emb));
+            annindex_close(&idx);
+            rc = 1;
+        } else {
+            rc = run_bench(&idx, bench, k, ef, emb, inputs, n_inputs, field);
+            annindex_close(&idx);
+        }
+    } else if (query) {
+        rc = run_query(index_path, emb, query, k, ef);
+    } else {
+        AnnIndex idx;
+        if (annindex_open_rw(&idx, index_path, (uint32_t)embedder_dim(emb), m, ef_construction) != 0) {
+            fprintf(stderr, "❌ Cannot open index %s for writing\n", index_path);
+            rc = 1;
+        } else {
+            AnnScratch s = {0};
+            AddStats st = {0};
+            float *vec = malloc((size_t)embedder_dim(emb) * sizeof(float));
+            double t0 = now_ms();
+            for (int i = 0; i < n_inputs && rc == 0 && vec; i++)
+                if (add_file(&idx, &s, emb, inputs[i], field, vec, &st) != 0) rc = 1;
+            if (!vec) rc = 1;
+            printf("✅ %s: +%llu chunks (%u total), %llu already indexed, %llu skipped, %llu truncated to context\n",
+                   index_path, (unsigned long long)st.added, annindex_count(&idx),
+                   (unsigned long long)st.duplicates, (unsigned long long)st.skipped,
+                   (unsigned long long)st.truncated);
+            if (st.added)
+                printf("⏱️ %.1f s: embed %.1f ms/chunk (%llu tokens), insert %.2f ms/chunk, kernel %s\n",
+                       (now_ms() - t0) / 1e3, st.embed_ms / (double)st.added, (unsigned long long)st.tokens,
+                       st.insert_ms / (double)st.added, ann_dot_impl());
+            free(vec);
+            ann_scratch_free(&s);
+            annindex_close(&idx);
+        }
+    }
+    embedder_close(emb);
+    llama_backend_free();
+    free(inputs);
+    return rc;
+}
@@ -0,0 +1,735 @@
+// annindex.c — HNSW поверх mmap-файла и SIMD-ядра расстояния (см. annindex.h)
+
+#define _GNU_SOURCE
+#include "annindex.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ANN_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define ANN_NEON 1
+#endif
+
+_Static_assert(sizeof(AnnHeader) == 128, "AnnHeader must stay 128 bytes");
+_Static_assert(sizeof(AnnNode) == 32, "AnnNode must stay 32 bytes");
+
+// === Ядра скалярного произведения ===
+
+static float dot_scalar(const float *a, const float *b, size_t n) {
+    float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    for (; i < n; i++) s0 += a[i] * b[i];
+    return (s0 + s1) + (s2 + s3);
+}
+
+#ifdef ANN_X86
+__attribute__((target("sse")))
+static float dot_sse(const float *a, const float *b, size_t n) {
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    float tmp[4];
+    _mm_storeu_ps(tmp, _mm_add_ps(acc0, acc1));
+    float s = (tmp[0] + tmp[1]) + (tmp[2] + tmp[3]);
+    for (; i < n; i++) s += a[i] * b[i];
+    return s;
+}
+
+__attribute__((target("avx2,fma")))
+static float dot_avx2(const float *a, const float *b, size_t n) {
+    // четыре аккумулятора закрывают задержку FMA
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+        acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16), acc2);
+        acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24), acc3);
+    }
+    for (; i + 8 <= n; i += 8)
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    __m256 acc = _mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3));
+    __m128 lo = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+    lo = _mm_add_ss(lo, _mm_shuffle_ps(lo, lo, 1));
+    float s = _mm_cvtss_f32(lo);
+    for (; i < n; i++) s += a[i] * b[i];
+    return s;
+}
+
+__attribute__((target("avx512f")))
+static float dot_avx512(const float *a, const float *b, size_t n) {
+    __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+    }
+    for (; i + 16 <= n; i += 16)
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+    if (i < n) {
+        // хвост — маскированной загрузкой, без скалярного цикла
+        __mmask16 m = (__mmask16)((1u << (n - i)) - 1);
+        acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, a + i), _mm512_maskz_loadu_ps(m, b + i), acc1);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+}
+#endif
+
+#ifdef ANN_NEON
+static float dot_neon(const float *a, const float *b, size_t n) {
+    float32x4_t acc0 = vdupq_n_f32(0), acc1 = vdupq_n_f32(0);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    float s = vaddvq_f32(vaddq_f32(acc0, acc1));
+    for (; i < n; i++) s += a[i] * b[i];
+    return s;
+}
+#endif
+
+typedef float (*DotFn)(const float *, const float *, size_t);
+
+static DotFn dot_fn = NULL;
+static const char *dot_name = "scalar";
+
+static DotFn get_dot(void) {
+    if (dot_fn) return dot_fn;
+    DotFn fn = dot_scalar;
+    const char *name = "scalar";
+#ifdef ANN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) { fn = dot_avx512; name = "avx512f"; }
+    else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) { fn = dot_avx2; name = "avx2"; }
+    else if (__builtin_cpu_supports("sse")) { fn = dot_sse; name = "sse"; }
+#elif defined(ANN_NEON)
+    fn = dot_neon;
+    name = "neon";
+#endif
+    dot_name = name;
+    dot_fn = fn;
+    return fn;
+}
+
+float ann_dot(const float *a, const float *b, size_t n) {
+    return get_dot()(a, b, n);
+}
+
+const char *ann_dot_impl(void) {
+    get_dot();
+    return dot_name;
+}
+
+int ann_normalize(float *v, size_t n) {
+    float norm = sqrtf(get_dot()(v, v, n));
+    if (!(norm > 0)) return -1;
+    float inv = 1.0f / norm;
+    for (size_t i = 0; i < n; i++) v[i] *= inv;
+    return 0;
+}
+
+// === Раскладка файла ===
+
+static uint64_t align_up(uint64_t x) {
+    return (x + ANN_ALIGN - 1) & ~(uint64_t)(ANN_ALIGN - 1);
+}
+
+static void layout(AnnHeader *h) {
+    h->vectors_off = align_up(sizeof(AnnHeader));
+    h->links0_off = align_up(h->vectors_off + (uint64_t)h->capacity * h->dim * sizeof(float));
+    h->nodes_off = align_up(h->links0_off + (uint64_t)h->capacity * (1 + 2 * h->m) * sizeof(uint32_t));
+    h->upper_off = align_up(h->nodes_off + (uint64_t)h->capacity * sizeof(AnnNode));
+}
+
+static size_t map_size_for(const AnnHeader *h) {
+    return (size_t)(h->upper_off + (uint64_t)h->upper_capacity * (1 + h->m) * sizeof(uint32_t));
+}
+
+static inline AnnNode *node_at(const AnnIndex *idx, uint32_t id) {
+    return (AnnNode *)(idx->map + idx->hdr->nodes_off) + id;
+}
+
+static inline float *vec_at(const AnnIndex *idx, uint32_t id) {
+    return (float *)(idx->map + idx->hdr->vectors_off) + (size_t)id * idx->hdr->dim;
+}
+
+// Список соседей: [0] — число, дальше id
+static inline uint32_t *links_at(const AnnIndex *idx, uint32_t id, int level) {
+    const AnnHeader *h = idx->hdr;
+    if (level == 0) return (uint32_t *)(idx->map + h->links0_off) + (size_t)id * (1 + 2 * h->m);
+    return (uint32_t *)(idx->map + h->upper_off) + (size_t)(node_at(idx, id)->upper + (uint32_t)level - 1) * (1 + h->m);
+}
+
+static inline uint32_t max_links(const AnnIndex *idx, int level) {
+    return level == 0 ? 2 * idx->hdr->m : idx->hdr->m;
+}
+
+static int check_header(const AnnHeader *h, size_t size) {
+    return memcmp(h->magic, ANNINDEX_MAGIC, sizeof(h->magic)) == 0 &&
+           h->version == ANNINDEX_VERSION && h->dim > 0 && h->m >= 2 && h->m <= ANN_MAX_M &&
+           h->count <= h->capacity && h->upper_count <= h->upper_capacity &&
+           size >= sizeof(AnnHeader) && map_size_for(h) == size ? 0 : -1;
+}
+
+static uint64_t text_hash(const char *s, size_t n) {
+    uint64_t h = 1469598103934665603ull;
+    for (size_t i = 0; i < n; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ull;
+    }
+    return h ? h : 1;          // 0 — пустой слот множества
+}
+
+// === Множество хэшей текстов (только запись) ===
+
+static int hashes_insert(AnnIndex *idx, uint64_t h) {
+    if (idx->hash_cap == 0) return -1;
+    size_t mask = idx->hash_cap - 1;
+    for (size_t pos = (size_t)h & mask;; pos = (pos + 1) & mask) {
+        if (idx->hashes[pos] == h) return 1;
+        if (idx->hashes[pos] == 0) {
+            idx->hashes[pos] = h;
+            return 0;
+        }
+    }
+}
+
+static int hashes_contains(const AnnIndex *idx, uint64_t h) {
+    size_t mask = idx->hash_cap - 1;
+    for (size_t pos = (size_t)h & mask;; pos = (pos + 1) & mask) {
+        if (idx->hashes[pos] == h) return 1;
+        if (idx->hashes[pos] == 0) return 0;
+    }
+}
+
+// Таблица заполнена не больше чем наполовину
+static int hashes_reserve(AnnIndex *idx, size_t n) {
+    if (n * 2 < idx->hash_cap) return 0;
+    size_t cap = idx->hash_cap ? idx->hash_cap : 1024;
+    while (n * 2 >= cap) cap *= 2;
+    uint64_t *old = idx->hashes;
+    size_t old_cap = idx->hash_cap;
+    idx->hashes = calloc(cap, sizeof(uint64_t));
+    if (!idx->hashes) {
+        idx->hashes = old;
+        return -1;
+    }
+    idx->hash_cap = cap;
+    for (size_t i = 0; i < old_cap; i++)
+        if (old[i]) hashes_insert(idx, old[i]);
+    free(old);
+    return 0;
+}
+
+// === Открытие ===
+
+static void unmap(AnnIndex *idx) {
+    if (idx->map) munmap(idx->map, idx->map_size);
+    if (idx->fd >= 0) close(idx->fd);
+    idx->map = NULL;
+    idx->hdr = NULL;
+    idx->fd = -1;
+}
+
+static int map_file(AnnIndex *idx, int writable) {
+    idx->fd = open(idx->path, writable ? O_RDWR : O_RDONLY);
+    if (idx->fd < 0) return -1;
+    struct stat st;
+    if (fstat(idx->fd, &st) != 0 || (size_t)st.st_size < sizeof(AnnHeader)) {
+        unmap(idx);
+        return -1;
+    }
+    idx->map_size = (size_t)st.st_size;
+    idx->map = mmap(NULL, idx->map_size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, idx->fd, 0);
+    if (idx->map == MAP_FAILED) {
+        idx->map = NULL;
+        unmap(idx);
+        return -1;
+    }
+    idx->hdr = (AnnHeader *)idx->map;
+    if (check_header(idx->hdr, idx->map_size) != 0) {
+        fprintf(stderr, "annindex: '%s' is not a valid index\n", idx->path);
+        unmap(idx);
+        return -1;
+    }
+    // обход графа — случайный доступ, readahead только мешает
+    madvise(idx->map, idx->map_size, MADV_RANDOM);
+    return 0;
+}
+
+// Новый файл под заголовок h (секции по его capacity); fd или -1
+static int create_file(const char *path, AnnHeader *h) {
+    layout(h);
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return -1;
+    if (ftruncate(fd, (off_t)map_size_for(h)) != 0 || pwrite(fd, h, sizeof(*h), 0) != (ssize_t)sizeof(*h)) {
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+    return fd;
+}
+
+static int init_paths(AnnIndex *idx, const char *path) {
+    memset(idx, 0, sizeof(*idx));
+    idx->fd = idx->lock_fd = idx->text_fd = -1;
+    idx->path = strdup(path);
+    return idx->path ? 0 : -1;
+}
+
+static char *suffixed(const char *path, const char *suffix) {
+    size_t len = strlen(path) + strlen(suffix) + 1;
+    char *p = malloc(len);
+    if (p) snprintf(p, len, "%s%s", path, suffix);
+    return p;
+}
+
+int annindex_open_rw(AnnIndex *idx, const char *path, uint32_t dim, uint32_t m, uint32_t ef_construction) {
+    if (init_paths(idx, path) != 0) return -1;
+    idx->lock_path = suffixed(path, ".lock");
+    char *text_path = suffixed(path, ANNINDEX_TEXT_SUFFIX);
+    if (!idx->lock_path || !text_path) goto fail;
+
+    // Писатель один: блокировка держится до annindex_close
+    idx->lock_fd = open(idx->lock_path, O_RDWR | O_CREAT, 0644);
+    if (idx->lock_fd < 0 || flock(idx->lock_fd, LOCK_EX | LOCK_NB) != 0) {
+        fprintf(stderr, "annindex: '%s' is locked by another writer\n", path);
+        goto fail;
+    }
+
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        if (!m) m = ANN_DEFAULT_M;
+        if (m < 2 || m > ANN_MAX_M || !dim) goto fail;
+        AnnHeader h = {0};
+        memcpy(h.magic, ANNINDEX_MAGIC, sizeof(h.magic));
+        h.version = ANNINDEX_VERSION;
+        h.dim = dim;
+        h.m = m;
+        h.ef_construction = ef_construction ? ef_construction : ANN_DEFAULT_EF_CONSTRUCTION;
+        h.capacity = ANN_INITIAL_CAPACITY;
+        // ожидаемо 1/(m-1) слотов на узел; с запасом
+        h.upper_capacity = ANN_INITIAL_CAPACITY / (m / 2) + 16;
+        h.max_level = -1;
+        int fd = create_file(path, &h);
+        if (fd < 0) goto fail;
+        close(fd);
+    }
+    if (map_file(idx, 1) != 0) goto fail;
+    if (dim && idx->hdr->dim != dim) {
+        fprintf(stderr, "annindex: '%s' has dim %u, embeddings have %u\n", path, idx->hdr->dim, dim);
+        goto fail;
+    }
+    if (ef_construction) idx->hdr->ef_construction = ef_construction;
+
+    // Тексты за text_size не покрыты узлами (сбой посреди вставки) — отрезаем
+    idx->text_fd = open(text_path, O_RDWR | O_CREAT, 0644);
+    if (idx->text_fd < 0 || ftruncate(idx->text_fd, (off_t)idx->hdr->text_size) != 0) goto fail;
+
+    if (hashes_reserve(idx, idx->hdr->count + 1) != 0) goto fail;
+    for (uint32_t i = 0; i < idx->hdr->count; i++) hashes_insert(idx, node_at(idx, i)->hash);
+    free(text_path);
+    return 0;
+fail:
+    free(text_path);
+    annindex_close(idx);
+    return -1;
+}
+
+int annindex_open(AnnIndex *idx, const char *path) {
+    if (init_paths(idx, path) != 0) return -1;
+    if (map_file(idx, 0) != 0) {
+        annindex_close(idx);
+        return -1;
+    }
+    char *text_path = suffixed(path, ANNINDEX_TEXT_SUFFIX);
+    int fd = text_path ? open(text_path, O_RDONLY) : -1;
+    free(text_path);
+    struct stat st;
+    if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0) {
+        void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (p != MAP_FAILED) {
+            idx->text = p;
+            idx->text_map_size = (size_t)st.st_size;
+        }
+    }
+    if (fd >= 0) close(fd);
+    return 0;
+}
+
+void annindex_close(AnnIndex *idx) {
+    if (idx->map && idx->lock_fd >= 0) msync(idx->map, idx->map_size, MS_SYNC);
+    unmap(idx);
+    if (idx->text) munmap((void *)idx->text, idx->text_map_size);
+    if (idx->text_fd >= 0) {
+        fdatasync(idx->text_fd);
+        close(idx->text_fd);
+    }
+    if (idx->lock_fd >= 0) close(idx->lock_fd);
+    free(idx->path);
+    free(idx->lock_path);
+    free(idx->hashes);
+    memset(idx, 0, sizeof(*idx));
+    idx->fd = idx->lock_fd = idx->text_fd = -1;
+}
+
+// Перестраивает файл с секциями не меньше need_nodes / need_upper и подменяет его
+static int grow(AnnIndex *idx, uint32_t need_nodes, uint32_t need_upper) {
+    const AnnHeader *old = idx->hdr;
+    AnnHeader h = *old;
+    while (h.capacity < need_nodes) h.capacity *= 2;
+    while (h.upper_capacity < need_upper) h.upper_capacity *= 2;
+
+    char *tmp_path = malloc(strlen(idx->path) + 32);
+    if (!tmp_path) return -1;
+    sprintf(tmp_path, "%s.tmp.%ld", idx->path, (long)getpid());
+    int fd = create_file(tmp_path, &h);
+    if (fd < 0) {
+        free(tmp_path);
+        return -1;
+    }
+    size_t size = map_size_for(&h);
+    unsigned char *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        unlink(tmp_path);
+        free(tmp_path);
+        return -1;
+    }
+    memcpy(map + h.vectors_off, idx->map + old->vectors_off, (size_t)old->count * old->dim * sizeof(float));
+    memcpy(map + h.links0_off, idx->map + old->links0_off, (size_t)old->count * (1 + 2 * old->m) * sizeof(uint32_t));
+    memcpy(map + h.nodes_off, idx->map + old->nodes_off, (size_t)old->count * sizeof(AnnNode));
+    memcpy(map + h.upper_off, idx->map + old->upper_off, (size_t)old->upper_count * (1 + old->m) * sizeof(uint32_t));
+    msync(map, size, MS_SYNC);
+    munmap(map, size);
+    close(fd);
+
+    if (rename(tmp_path, idx->path) != 0) {
+        unlink(tmp_path);
+        free(tmp_path);
+        return -1;
+    }
+    free(tmp_path);
+    unmap(idx);
+    return map_file(idx, 1);
+}
+
+// === Поиск по графу ===
+
+static int scratch_prepare(AnnScratch *s, uint32_t n, size_t ef) {
+    if (s->visited_cap < n) {
+        uint32_t cap = s->visited_cap ? s->visited_cap : 1024;
+        while (cap < n) cap *= 2;
+        uint32_t *v = calloc(cap, sizeof(uint32_t));
+        if (!v) return -1;
+        free(s->visited);
+        s->visited = v;
+        s->visited_cap = cap;
+        s->stamp = 0;
+    }
+    if (++s->stamp == 0) {
+        memset(s->visited, 0, (size_t)s->visited_cap * sizeof(uint32_t));
+        s->stamp = 1;
+    }
+    if (s->best_cap < ef + 1) {
+        AnnHit *p = realloc(s->best, (ef + 1) * sizeof(AnnHit));
+        if (!p) return -1;
+        s->best = p;
+        s->best_cap = ef + 1;
+    }
+    s->n_cand = s->n_best = 0;
+    return 0;
+}
+
+// Куча: max — в best (худший наверху), min — в cand (лучший наверху)
+static void heap_push(AnnHit *h, size_t *n, AnnHit x, int max) {
+    size_t i = (*n)++;
+    while (i > 0) {
+        size_t p = (i - 1) / 2;
+        if (max ? h[p].dist >= x.dist : h[p].dist <= x.dist) break;
+        h[i] = h[p];
+        i = p;
+    }
+    h[i] = x;
+}
+
+static AnnHit heap_pop(AnnHit *h, size_t *n, int max) {
+    AnnHit top = h[0];
+    AnnHit x = h[--(*n)];
+    size_t i = 0;
+    for (;;) {
+        size_t c = 2 * i + 1;
+        if (c >= *n) break;
+        if (c + 1 < *n && (max ? h[c + 1].dist > h[c].dist : h[c + 1].dist < h[c].dist)) c++;
+        if (max ? x.dist >= h[c].dist : x.dist <= h[c].dist) break;
+        h[i] = h[c];
+        i = c;
+    }
+    if (*n) h[i] = x;
+    return top;
+}
+
+static int cand_push(AnnScratch *s, AnnHit x) {
+    if (s->n_cand == s->cand_cap) {
+        size_t cap = s->cand_cap ? s->cand_cap * 2 : 256;
+        AnnHit *p = realloc(s->cand, cap * sizeof(AnnHit));
+        if (!p) return -1;
+        s->cand = p;
+        s->cand_cap = cap;
+    }
+    heap_push(s->cand, &s->n_cand, x, 0);
+    return 0;
+}
+
+static inline float dist_to(const AnnIndex *idx, DotFn dot, const float *q, uint32_t id) {
+    return 1.0f - dot(q, vec_at(idx, id), idx->hdr->dim);
+}
+
+// Жадный спуск по верхнему слою: ближайший к q узел
+static uint32_t greedy(const AnnIndex *idx, DotFn dot, const float *q, uint32_t ep, float *ep_dist, int level) {
+    uint32_t count = idx->hdr->count;
+    for (int changed = 1; changed;) {
+        changed = 0;
+        const uint32_t *l = links_at(idx, ep, level);
+        for (uint32_t i = 1; i <= l[0]; i++) {
+            if (l[i] >= count) continue;
+            float d = dist_to(idx, dot, q, l[i]);
+            if (d < *ep_dist) {
+                *ep_dist = d;
+                ep = l[i];
+                changed = 1;
+            }
+        }
+    }
+    return ep;
+}
+
+// Поиск на слое: до ef ближайших в s->best (max-куча); 0 или -1
+static int search_layer(const AnnIndex *idx, AnnScratch *s, DotFn dot, const float *q,
+                        uint32_t ep, float ep_dist, size_t ef, int level, uint32_t count) {
+    if (scratch_prepare(s, count + 1, ef) != 0) return -1;
+    AnnHit e = { ep, ep_dist };
+    s->visited[ep] = s->stamp;
+    if (cand_push(s, e) != 0) return -1;
+    heap_push(s->best, &s->n_best, e, 1);
+
+    while (s->n_cand) {
+        AnnHit c = heap_pop(s->cand, &s->n_cand, 0);
+        if (s->n_best >= ef && c.dist > s->best[0].dist) break;
+        const uint32_t *l = links_at(idx, c.id, level);
+        uint32_t n = l[0];
+        for (uint32_t i = 1; i <= n; i++) {
+            uint32_t id = l[i];
+            if (id >= count || s->visited[id] == s->stamp) continue;
+            s->visited[id] = s->stamp;
+            float d = dist_to(idx, dot, q, id);
+            if (s->n_best < ef || d < s->best[0].dist) {
+                AnnHit x = { id, d };
+                if (cand_push(s, x) != 0) return -1;
+                heap_push(s->best, &s->n_best, x, 1);
+                if (s->n_best > ef) heap_pop(s->best, &s->n_best, 1);
+            }
+        }
+    }
+    return 0;
+}
+
+static int hit_cmp(const void *a, const void *b) {
+    float x = ((const AnnHit *)a)->dist, y = ((const AnnHit *)b)->dist;
+    return x < y ? -1 : x > y;
+}
+
+size_t annindex_search(const AnnIndex *idx, AnnScratch *s, const float *q, size_t k, uint32_t ef, AnnHit *out) {
+    const AnnHeader *h = idx->hdr;
+    if (!h || h->max_level < 0 || k == 0) return 0;
+    DotFn dot = get_dot();
+    uint32_t count = h->count;
+    if (h->entry >= count) return 0;
+    size_t efs = ef ? ef : ANN_DEFAULT_EF_SEARCH;
+    if (efs < k) efs = k;
+
+    uint32_t ep = h->entry;
+    float ep_dist = dist_to(idx, dot, q, ep);
+    for (int level = h->max_level; level > 0; level--) ep = greedy(idx, dot, q, ep, &ep_dist, level);
+    if (search_layer(idx, s, dot, q, ep, ep_dist, efs, 0, count) != 0) return 0;
+
+    qsort(s->best, s->n_best, sizeof(AnnHit), hit_cmp);
+    size_t n = s->n_best < k ? s->n_best : k;
+    memcpy(out, s->best, n * sizeof(AnnHit));
+    return n;
+}
+
+size_t annindex_search_exact(const AnnIndex *idx, const float *q, size_t k, AnnHit *out) {
+    if (!idx->hdr || k == 0) return 0;
+    DotFn dot = get_dot();
+    size_t n = 0;
+    for (uint32_t id = 0; id < idx->hdr->count; id++) {
+        AnnHit x = { id, dist_to(idx, dot, q, id) };
+        if (n < k) heap_push(out, &n, x, 1);
+        else if (x.dist < out[0].dist) {
+            heap_pop(out, &n, 1);
+            heap_push(out, &n, x, 1);
+        }
+    }
+    qsort(out, n, sizeof(AnnHit), hit_cmp);
+    return n;
+}
+
+// === Вставка ===
+
+// Эвристика выбора соседей HNSW: кандидат берётся, только если он ближе к
+// базе, чем к уже выбранным, — связи расходятся по направлениям.
+// hits отсортированы по возрастанию dist; число выбранных в sel
+static uint32_t select_neighbors(const AnnIndex *idx, DotFn dot, const AnnHit *hits, size_t n,
+                                 uint32_t max, uint32_t *sel) {
+    uint32_t k = 0;
+    for (size_t i = 0; i < n && k < max; i++) {
+        const float *v = vec_at(idx, hits[i].id);
+        int good = 1;
+        for (uint32_t j = 0; j < k && good; j++)
+            if (1.0f - dot(v, vec_at(idx, sel[j]), idx->hdr->dim) < hits[i].dist) good = 0;
+        if (good) sel[k++] = hits[i].id;
+    }
+    return k;
+}
+
+// Обратная связь nb → id; переполненный список прореживается той же эвристикой
+static void link_back(AnnIndex *idx, DotFn dot, uint32_t nb, uint32_t id, int level) {
+    uint32_t *l = links_at(idx, nb, level);
+    uint32_t max = max_links(idx, level);
+    if (l[0] < max) {
+        l[l[0] + 1] = id;
+        __atomic_store_n(&l[0], l[0] + 1, __ATOMIC_RELEASE);
+        return;
+    }
+    AnnHit hits[2 * ANN_MAX_M + 1];
+    uint32_t sel[2 * ANN_MAX_M];
+    const float *v = vec_at(idx, nb);
+    size_t n = 0;
+    for (uint32_t i = 1; i <= l[0]; i++)
+        hits[n++] = (AnnHit){ l[i], 1.0f - dot(v, vec_at(idx, l[i]), idx->hdr->dim) };
+    hits[n++] = (AnnHit){ id, 1.0f - dot(v, vec_at(idx, id), idx->hdr->dim) };
+    qsort(hits, n, sizeof(AnnHit), hit_cmp);
+    uint32_t k = select_neighbors(idx, dot, hits, n, max, sel);
+    // читатель без блокировки видит либо старое число, либо новые id
+    __atomic_store_n(&l[0], 0, __ATOMIC_RELEASE);
+    memcpy(l + 1, sel, k * sizeof(uint32_t));
+    __atomic_store_n(&l[0], k, __ATOMIC_RELEASE);
+}
+
+// Уровень узла: -ln(U)/ln(m), U — от id, чтобы сборка была воспроизводимой
+static uint32_t random_level(uint32_t id, uint32_t m) {
+    uint64_t z = (uint64_t)id + 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    z ^= z >> 31;
+    double u = ((double)(z >> 11) + 1.0) / 9007199254740993.0;
+    int level = (int)(-log(u) / log((double)m));
+    return level > ANN_MAX_LEVEL ? ANN_MAX_LEVEL : (uint32_t)level;
+}
+
+int annindex_add(AnnIndex *idx, AnnScratch *s, const float *vec,
+                 const char *source, size_t source_len, const char *text, size_t text_len) {
+    if (idx->lock_fd < 0 || !idx->hdr || source_len > UINT32_MAX || text_len > UINT32_MAX) return -1;
+    uint64_t hash = text_hash(text, text_len);
+    if (hashes_contains(idx, hash)) return 1;
+
+    uint32_t id = idx->hdr->count;
+    uint32_t level = random_level(id, idx->hdr->m);
+    if (id == UINT32_MAX) return -1;
+    if (id + 1 > idx->hdr->capacity || idx->hdr->upper_count + level > idx->hdr->upper_capacity) {
+        if (grow(idx, id + 1, idx->hdr->upper_count + level) != 0) return -1;
+    }
+    if (hashes_reserve(idx, (size_t)id + 1) != 0) return -1;
+    AnnHeader *h = idx->hdr;
+
+    uint64_t off = h->text_size;
+    if (pwrite(idx->text_fd, source, source_len, (off_t)off) != (ssize_t)source_len ||
+        pwrite(idx->text_fd, text, text_len, (off_t)(off + source_len)) != (ssize_t)text_len) return -1;
+
+    float *v = vec_at(idx, id);
+    memcpy(v, vec, h->dim * sizeof(float));
+    if (ann_normalize(v, h->dim) != 0) return -1;
+    AnnNode *nd = node_at(idx, id);
+    nd->text_off = off;
+    nd->hash = hash;
+    nd->source_len = (uint32_t)source_len;
+    nd->text_len = (uint32_t)text_len;
+    nd->upper = h->upper_count;
+    nd->level = level;
+    h->upper_count += level;
+    for (int l = 0; l <= (int)level; l++) links_at(idx, id, l)[0] = 0;
+
+    if (h->max_level >= 0) {
+        DotFn dot = get_dot();
+        uint32_t ep = h->entry;
+        float ep_dist = dist_to(idx, dot, v, ep);
+        for (int l = h->max_level; l > (int)level; l--) ep = greedy(idx, dot, v, ep, &ep_dist, l);
+        uint32_t sel[2 * ANN_MAX_M];
+        for (int l = (int)level < h->max_level ? (int)level : h->max_level; l >= 0; l--) {
+            if (search_layer(idx, s, dot, v, ep, ep_dist, h->ef_construction, l, id) != 0) return -1;
+            qsort(s->best, s->n_best, sizeof(AnnHit), hit_cmp);
+            uint32_t k = select_neighbors(idx, dot, s->best, s->n_best, h->m, sel);
+            uint32_t *my = links_at(idx, id, l);
+            memcpy(my + 1, sel, k * sizeof(uint32_t));
+            my[0] = k;
+            for (uint32_t i = 0; i < k; i++) link_back(idx, dot, sel[i], id, l);
+            ep = s->best[0].id;
+            ep_dist = s->best[0].dist;
+        }
+    }
+    if ((int)level > h->max_level) {
+        h->entry = id;
+        h->max_level = (int32_t)level;
+    }
+    h->text_size = off + source_len + text_len;
+    __atomic_store_n(&h->count, id + 1, __ATOMIC_RELEASE);
+    hashes_insert(idx, hash);
+    return 0;
+}
+
+int annindex_contains(const AnnIndex *idx, const char *text, size_t text_len) {
+    return idx->hash_cap ? hashes_contains(idx, text_hash(text, text_len)) : 0;
+}
+
+int annindex_text(const AnnIndex *idx, uint32_t id, const char **source, size_t *source_len,
+                  const char **text, size_t *text_len) {
+    if (!idx->hdr || id >= idx->hdr->count || !idx->text) return -1;
+    const AnnNode *nd = node_at(idx, id);
+    if (nd->text_off + nd->source_len + nd->text_len > idx->text_map_size) return -1;
+    *source = idx->text + nd->text_off;
+    *source_len = nd->source_len;
+    *text = *source + nd->source_len;
+    *text_len = nd->text_len;
+    return 0;
+}
+
+void ann_scratch_free(AnnScratch *s) {
+    free(s->visited);
+    free(s->cand);
+    free(s->best);
+    memset(s, 0, sizeof(*s));
+}
@@ -0,0 +1,147 @@
+// annindex.h — HNSW-индекс эмбеддингов корпуса для RAG в bot.c
+//
+// Файл индекса отображается через mmap и читается без разбора:
+//   AnnHeader (128 байт)
+//   vectors — float × dim на узел, нормированы: расстояние = 1 − dot
+//   links0  — uint32 × (1 + 2M) на узел: число соседей слоя 0 и их id
+//   nodes   — AnnNode на узел: уровень, верхние слои, текст, хэш текста
+//   upper   — uint32 × (1 + M) на слот: соседи узла на слоях 1..level;
+//             слоты узла идут подряд с AnnNode.upper
+// Секции выровнены на ANN_ALIGN и рассчитаны на capacity узлов (upper —
+// на upper_capacity слотов). Вставка пишет в отображение на месте; когда
+// место кончается, файл перестраивается с вдвое большими секциями и
+// подменяется через rename, как у fpindex. Читатель, открывший индекс
+// только на чтение, видит файл целиком на момент открытия; id не меньше
+// count (узел не дописан) при обходе пропускаются.
+//
+// Тексты чанков лежат рядом в <index>.txt: source и text подряд без
+// разделителей, смещения и длины — в AnnNode. Хэш текста (FNV-1a) не
+// даёт вставить один чанк дважды, поэтому индекс можно дополнять тем же
+// растущим датасетом.
+//
+// Расстояние считается SIMD-ядрами (AVX-512F, AVX2+FMA, SSE на x86,
+// NEON на aarch64) с выбором по CPU при первом вызове, как в json_escape.c.
+
+#ifndef ANNINDEX_H
+#define ANNINDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ANNINDEX_MAGIC "OXANNIX1"
+#define ANNINDEX_VERSION 1
+#define ANNINDEX_TEXT_SUFFIX ".txt"
+#define ANN_ALIGN 64
+#define ANN_DEFAULT_M 16
+#define ANN_DEFAULT_EF_CONSTRUCTION 200
+#define ANN_DEFAULT_EF_SEARCH 64
+#define ANN_INITIAL_CAPACITY 1024
+#define ANN_MAX_LEVEL 16
+#define ANN_MAX_M 64
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t dim;
+    uint32_t m;                // соседей на верхних слоях; на слое 0 — 2m
+    uint32_t ef_construction;
+    uint32_t count;            // дописанных узлов
+    uint32_t capacity;
+    uint32_t upper_count;      // занятых слотов upper
+    uint32_t upper_capacity;
+    uint32_t entry;            // точка входа (узел верхнего уровня)
+    int32_t max_level;         // -1 — индекс пуст
+    uint64_t vectors_off;
+    uint64_t links0_off;
+    uint64_t nodes_off;
+    uint64_t upper_off;
+    uint64_t text_size;        // байт в <index>.txt, покрытых узлами
+    uint8_t reserved[40];
+} AnnHeader;
+
+typedef struct {
+    uint64_t text_off;         // в <index>.txt
+    uint64_t hash;             // FNV-1a текста
+    uint32_t source_len;
+    uint32_t text_len;         // текст идёт сразу за source
+    uint32_t upper;            // первый слот upper (level штук)
+    uint32_t level;
+} AnnNode;
+
+typedef struct {
+    char *path;
+    char *lock_path;
+    int fd;
+    int lock_fd;               // -1 — открыт только на чтение
+    int text_fd;
+    unsigned char *map;
+    size_t map_size;
+    AnnHeader *hdr;
+    const char *text;          // mmap <index>.txt (только чтение)
+    size_t text_map_size;
+    uint64_t *hashes;          // множество хэшей для пропуска дублей (запись)
+    size_t hash_cap;
+} AnnIndex;
+
+typedef struct {
+    uint32_t id;
+    float dist;
+} AnnHit;
+
+// Рабочие буферы поиска одного потока; нулевая инициализация допустима
+typedef struct {
+    uint32_t *visited;         // метка прохода на узел
+    uint32_t visited_cap;
+    uint32_t stamp;
+    AnnHit *cand, *best;       // кучи кандидатов и результатов
+    size_t cand_cap, best_cap;
+    size_t n_cand, n_best;
+} AnnScratch;
+
+// Создаёт индекс с dim и m (0 → ANN_DEFAULT_*) или открывает существующий
+// на дописывание; dim существующего должен совпасть. 0 или -1
+int annindex_open_rw(AnnIndex *idx, const char *path, uint32_t dim, uint32_t m, uint32_t ef_construction);
+
+// Только поиск: оба файла на чтение, без блокировки. 0 или -1
+int annindex_open(AnnIndex *idx, const char *path);
+
+void annindex_close(AnnIndex *idx);
+
+// Добавляет чанк с эмбеддингом vec (нормируется при записи).
+// 1 — такой текст уже есть, 0 — добавлен, -1 — ошибка
+int annindex_add(AnnIndex *idx, AnnScratch *s, const float *vec,
+                 const char *source, size_t source_len, const char *text, size_t text_len);
+
+// 1 — текст уже в индексе (проверка до дорогого эмбеддинга), 0 — нет
+int annindex_contains(const AnnIndex *idx, const char *text, size_t text_len);
+
+// k ближайших к нормированному q, по возрастанию расстояния; ef ≥ k
+// (0 → ANN_DEFAULT_EF_SEARCH). Число найденных
+size_t annindex_search(const AnnIndex *idx, AnnScratch *s, const float *q, size_t k, uint32_t ef, AnnHit *out);
+
+// Точный перебор для проверки полноты; число найденных
+size_t annindex_search_exact(const AnnIndex *idx, const float *q, size_t k, AnnHit *out);
+
+// Текст и источник узла (указатели в mmap <index>.txt, открытого
+// annindex_open); 0 или -1
+int annindex_text(const AnnIndex *idx, uint32_t id, const char **source, size_t *source_len,
+                  const char **text, size_t *text_len);
+
+static inline uint32_t annindex_count(const AnnIndex *idx) {
+    return idx->hdr ? idx->hdr->count : 0;
+}
+
+static inline const float *annindex_vector(const AnnIndex *idx, uint32_t id) {
+    return (const float *)(idx->map + idx->hdr->vectors_off) + (size_t)id * idx->hdr->dim;
+}
+
+// Скалярное произведение выбранным ядром; имя ядра — для отчётов
+float ann_dot(const float *a, const float *b, size_t n);
+const char *ann_dot_impl(void);
+
+// Нормирует v на месте; 0 или -1 для нулевого вектора
+int ann_normalize(float *v, size_t n);
+
+void ann_scratch_free(AnnScratch *s);
+
+#endif // ANNINDEX_H
@@ -0,0 +1,17 @@
+// corpus_sites.c — sites для офлайн-замера конвейера (см. pipeline_bench.sh)
+// Страницы лежат в bench/corpus и читаются через file:// относительно dataset/.
+// XPath — как у сайтов того же вида в config.h; зеркало урока повторяет
+// текст оригинала и должно отсеиваться дедупликацией.
+
+#include "corpus_sites.h"
+
+const SiteConfig SITES[] = {
+    {"file://bench/corpus/c_lesson_pointers.html", "//h1", "//div[@id='content']//p", "C"},
+    {"file://bench/corpus/man_fork.html", "//h1", "//div[@class='section']//p", "System"},
+    {"file://bench/corpus/tldp_processes.html", "//h1", "//div[@class='section']//p", "Linux"},
+    {"file://bench/corpus/net_sockets.html", "//h1", "//div[@class='refsect1']//p | //pre", "Networking"},
+    {"file://bench/corpus/ru_memory_mapping.html", "//h1", "//article//p | //article//pre", "System"},
+    {"file://bench/corpus/c_lesson_pointers_mirror.html", "//h1", "//div[@id='content']//p", "C"},
+};
+
+const size_t SITE_COUNT = sizeof(SITES) / sizeof(SITES[0]);
@@ -0,0 +1,16 @@
+// corpus_sites.h — тип записи sites для сборки замера (gcc -include bench/corpus_sites.h)
+// Раскладка полей как у записей config.h
+
+#ifndef CORPUS_SITES_H
+#define CORPUS_SITES_H
+
+#include <stddef.h>
+
+typedef struct {
+    const char *url;
+    const char *title_xpath;
+    const char *content_xpath;
+    const char *category;
+} SiteConfig;
+
+#endif // CORPUS_SITES_H
@@ -0,0 +1,138 @@
+// json_escape_bench.c — микробенчмарк экранирования JSON
+// gcc -O2 -o json_escape_bench bench/json_escape_bench.c json_escape.c
+// ./json_escape_bench [mb_per_case]
+//
+// Сравнивает прежние escape_json_string (dataset.c) и escape_json
+// (test/parser.c) с json_escape_append / json_escape_dup на трёх
+// типах текста: английская проза, C-код с кавычками, русский текст.
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../json_escape.h"
+
+// === Прежние реализации (как были до векторизации) ===
+
+static void legacy_escape_json_string(const char* input, char* output) {
+    const char* src = input;
+    char* dst = output;
+    while (*src) {
+        switch (*src) {
+            case '\"':  strcpy(dst, "\\\""); dst += 2; break;
+            case '\\':  strcpy(dst, "\\\\"); dst += 2; break;
+            case '\b':  strcpy(dst, "\\b");  dst += 2; break;
+            case '\f':  strcpy(dst, "\\f");  dst += 2; break;
+            case '\n':  strcpy(dst, "\\n");  dst += 2; break;
+            case '\r':  strcpy(dst, "\\r");  dst += 2; break;
+            case '\t':  strcpy(dst, "\\t");  dst += 2; break;
+            default:
+                if ((unsigned char)*src < 0x20) {
+                    sprintf(dst, "\\u%04x", (unsigned char)*src);
+                    dst += 6;
+                } else {
+                    *dst++ = *src;
+                }
+        }
+        src++;
+    }
+    *dst = '\0';
+}
+
+static char *legacy_escape_json(const char *input) {
+    if (!input) return strdup("");
+    size_t len = strlen(input);
+    char *escaped = malloc(len * 6 + 3);
+    if (!escaped) return NULL;
+    char *p = escaped;
+    for (const char *s = input; *s; s++) {
+        switch (*s) {
+            case '"':  p += sprintf(p, "\\\""); break;
+            case '\\': p += sprintf(p, "\\\\"); break;
+            case '\n': p += sprintf(p, "\\n");  break;
+            case '\r': p += sprintf(p, "\\r");  break;
+            case '\t': p += sprintf(p, "\\t");  break;
+            default:
+                if ((unsigned char)*s < 0x20) {
+                    p += sprintf(p, "\\u%04x", (unsigned char)*s);
+                } else {
+                    *p++ = *s;
+                }
+        }
+    }
+    *p = '\0';
+    return escaped;
+}
+
+// === Данные ===
+
+#define RECORD_SIZE (16 * 1024)
+
+static const char *SAMPLES[] = {
+    "The kernel maps each process into its own virtual address space and switches page tables on every context switch. ",
+    "if (fd < 0) {\n\tperror(\"open\");\n\treturn \"\\\\n\";\n}\n",
+    "Системный вызов fork() создаёт копию процесса; дочерний процесс получает 0, родитель — PID потомка. ",
+};
+static const char *CASE_NAMES[] = { "prose", "c-code", "russian" };
+
+static char *make_record(const char *sample) {
+    char *rec = malloc(RECORD_SIZE + 1);
+    size_t n = strlen(sample), off = 0;
+    while (off + n <= RECORD_SIZE) { memcpy(rec + off, sample, n); off += n; }
+    rec[off] = '\0';
+    return rec;
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// === Main ===
+
+int main(int argc, char *argv[]) {
+    size_t mb = argc >= 2 ? (size_t)atol(argv[1]) : 256;
+    printf("json_escape impl: %s, %zu MB per case\n\n", json_escape_impl(), mb);
+    printf("%-8s %14s %14s %14s %14s\n", "case", "legacy_ds MB/s", "legacy_p MB/s", "append MB/s", "dup MB/s");
+
+    char *legacy_out = malloc(RECORD_SIZE * 6 + 3);
+    StrBuf buf = {0};
+    volatile size_t sink = 0;
+
+    for (size_t c = 0; c < sizeof(SAMPLES) / sizeof(SAMPLES[0]); c++) {
+        char *rec = make_record(SAMPLES[c]);
+        size_t len = strlen(rec);
+        size_t iters = mb * 1024 * 1024 / len;
+
+        // Проверка эквивалентности с реализацией из dataset.c
+        legacy_escape_json_string(rec, legacy_out);
+        strbuf_reset(&buf);
+        json_escape_append(&buf, rec, len);
+        if (strcmp(legacy_out, buf.data) != 0 || json_escaped_size(rec, len) != buf.len) {
+            fprintf(stderr, "❌ mismatch on case '%s'\n", CASE_NAMES[c]);
+            return 1;
+        }
+
+        double t0 = now_sec();
+        for (size_t i = 0; i < iters; i++) { legacy_escape_json_string(rec, legacy_out); sink += legacy_out[0]; }
+        double t1 = now_sec();
+        for (size_t i = 0; i < iters; i++) { char *e = legacy_escape_json(rec); sink += e[0]; free(e); }
+        double t2 = now_sec();
+        for (size_t i = 0; i < iters; i++) { strbuf_reset(&buf); json_escape_append(&buf, rec, len); sink += buf.len; }
+        double t3 = now_sec();
+        for (size_t i = 0; i < iters; i++) { char *e = json_escape_dup(rec); sink += e[0]; free(e); }
+        double t4 = now_sec();
+
+        double total = (double)iters * len / (1024.0 * 1024.0);
+        printf("%-8s %14.1f %14.1f %14.1f %14.1f\n", CASE_NAMES[c],
+               total / (t1 - t0), total / (t2 - t1), total / (t3 - t2), total / (t4 - t3));
+        free(rec);
+    }
+
+    strbuf_free(&buf);
+    free(legacy_out);
+    return sink == 0;
+}
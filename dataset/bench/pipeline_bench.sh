@@ -0,0 +1,41 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Офлайн-замер конвейера dataset.c на сохранённых страницах bench/corpus
+# Usage (из dataset/):
+#   bench/pipeline_bench.sh [runs] [out_dir]
+# runs: число прогонов (по умолчанию 5); out_dir: куда сложить run-N.json (bench_out)
+#
+# Собирает build_osdev_dataset с таблицей sites из bench/corpus_sites.c ($CFLAGS
+# добавляются к -O2), затем каждый прогон идёт с чистым индексом дедупликации,
+# пустым data_dir и без сети: страницы читаются через file://. Время по стадиям
+# (metrics.h) каждого прогона — в out_dir/run-N.json, сводная таблица — на stdout.
+
+RUNS="${1:-5}"
+OUT_DIR="${2:-bench_out}"
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+DATASET_DIR="$(dirname "$SCRIPT_DIR")"
+cd "$DATASET_DIR"
+
+mkdir -p "$OUT_DIR"
+WORK="$(mktemp -d)"
+trap 'rm -rf "$WORK"' EXIT
+
+BIN="$WORK/build_osdev_dataset"
+# shellcheck disable=SC2086
+gcc -O2 ${CFLAGS:-} -include bench/corpus_sites.h -I/usr/include/libxml2 -o "$BIN" \
+    dataset.c bench/corpus_sites.c fpindex.c fetch_cache.c json_escape.c ds_writer.c ingest.c normalize.c \
+    url.c robots.c crawl.c pars.c relevance.c prompt_store.c pdf.c extract.c metrics.c langid.c ../alog.c \
+    -lcurl -lxml2 -lssl -lcrypto -lz -pthread -lm
+
+mkdir -p "$WORK/data"
+for i in $(seq 1 "$RUNS"); do
+  rm -f "$WORK/dedup.fpi" "$WORK/out.jsonl"
+  OSDEV_DEDUP_INDEX="$WORK/dedup.fpi" OSDEV_FETCH_CACHE="$WORK/cache" \
+    "$BIN" --offline --ignore-robots --metrics "$OUT_DIR/run-$i.json" "$WORK/data" "$WORK/out.jsonl" \
+    > "$WORK/log.txt"
+  echo "— прогон $i/$RUNS"
+  sed -n '/^⏱️/,$p' "$WORK/log.txt"
+done
+
+echo "✅ $RUNS прогонов, метрики в $OUT_DIR/run-*.json"
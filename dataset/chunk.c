@@ -0,0 +1,247 @@
+// chunk.c — разбиение JSONL-датасета на чанки по токенам модели
+// gcc -O2 -o chunk_dataset chunk.c chunker.c json_escape.c ds_writer.c -L../llama.cpp/build/bin -lllama -lz -pthread
+// ./chunk_dataset --model model.gguf [--tokens N] [--overlap N] [--bos] [--field NAME]
+//                 [--jobs N] [--compress gzip|zstd] [--shard-records N] [--shard-bytes N]
+//                 input.jsonl [output.jsonl]
+// Текст берётся из поля --field (по умолчанию "content"; для записей
+// {"messages":[...]} — из ответа ассистента). Каждый чанк — отдельная запись
+// {"text":..., "metadata":{"source","category","chunk","tokens"}}.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "chunker.h"
+#include "json_escape.h"
+#include "ds_writer.h"
+
+typedef struct {
+    const Chunker *chunker;
+    const char *field;
+    const char *data;          // mmap входного файла
+    size_t *lines;             // начала строк; lines[count] — конец данных
+    size_t count;
+    size_t next;               // атомарный счётчик строк
+    DsWriter *out;
+    pthread_mutex_t out_lock;
+    uint64_t documents;
+    uint64_t chunks;
+    uint64_t tokens;
+    uint64_t skipped;
+    int failed;
+} ChunkShared;
+
+typedef struct {
+    ChunkShared *sh;
+    StrBuf rec;
+    const char *source;
+    size_t source_len;
+    const char *category;
+    size_t category_len;
+} ChunkJob;
+
+// Текст документа: ответ ассистента в messages-записи (реплики — в любом
+// порядке ключей, json_escape.h) или поле field
+static int find_text(const char *line, size_t len, const char *field, const char **val, size_t *val_len) {
+    if (json_find_assistant(line, len, val, val_len) == 0) return 0;
+    return json_find_string(line, len, field, val, val_len);
+}
+
+static int emit_chunk(void *ud, const char *text, size_t len, int n_tokens, size_t index) {
+    ChunkJob *job = (ChunkJob *)ud;
+    ChunkShared *sh = job->sh;
+    StrBuf *b = &job->rec;
+    char num[64];
+    int rc = 0;
+
+    // source и category уже экранированы — копируем как есть
+    strbuf_reset(b);
+    rc |= strbuf_append_str(b, "{\"text\":\"");
+    rc |= json_escape_append(b, text, len);
+    rc |= strbuf_append_str(b, "\",\"metadata\":{\"source\":\"");
+    rc |= strbuf_append(b, job->source, job->source_len);
+    rc |= strbuf_append_str(b, "\",\"category\":\"");
+    rc |= strbuf_append(b, job->category, job->category_len);
+    snprintf(num, sizeof(num), "\",\"chunk\":%zu,\"tokens\":%d}}\n", index, n_tokens);
+    rc |= strbuf_append_str(b, num);
+    if (rc != 0) return -1;
+
+    pthread_mutex_lock(&sh->out_lock);
+    rc = ds_writer_write(sh->out, b->data, b->len);
+    if (rc == 0) {
+        sh->chunks++;
+        sh->tokens += (uint64_t)n_tokens;
+    }
+    pthread_mutex_unlock(&sh->out_lock);
+    return rc;
+}
+
+static void *worker(void *arg) {
+    ChunkShared *sh = (ChunkShared *)arg;
+    ChunkScratch scratch = {0};
+    StrBuf text = {0};
+    ChunkJob job = { .sh = sh };
+
+    for (;;) {
+        size_t i = __atomic_fetch_add(&sh->next, 1, __ATOMIC_RELAXED);
+        if (i >= sh->count || __atomic_load_n(&sh->failed, __ATOMIC_RELAXED)) break;
+        const char *line = sh->data + sh->lines[i];
+        size_t len = sh->lines[i + 1] - sh->lines[i];
+
+        const char *val;
+        size_t val_len;
+        strbuf_reset(&text);
+        if (find_text(line, len, sh->field, &val, &val_len) != 0 ||
+            json_unescape_append(&text, val, val_len) != 0 || text.len == 0) {
+            __atomic_fetch_add(&sh->skipped, 1, __ATOMIC_RELAXED);
+            continue;
+        }
+        job.source = job.category = "";
+        job.source_len = job.category_len = 0;
+        if (json_find_string(line, len, "source", &job.source, &job.source_len) != 0)
+            json_find_string(line, len, "url", &job.source, &job.source_len);
+        json_find_string(line, len, "category", &job.category, &job.category_len);
+
+        if (chunker_split(sh->chunker, text.data, text.len, &scratch, emit_chunk, &job) < 0) {
+            fprintf(stderr, "⚠️  Chunking failed at line %zu\n", i + 1);
+            __atomic_store_n(&sh->failed, 1, __ATOMIC_RELAXED);
+            break;
+        }
+        __atomic_fetch_add(&sh->documents, 1, __ATOMIC_RELAXED);
+    }
+    chunk_scratch_free(&scratch);
+    strbuf_free(&text);
+    strbuf_free(&job.rec);
+    return NULL;
+}
+
+// Индекс начал непустых строк
+static size_t *index_lines(const char *data, size_t size, size_t *count) {
+    size_t cap = 1024, n = 0;
+    size_t *lines = malloc((cap + 1) * sizeof(*lines));
+    if (!lines) return NULL;
+    for (size_t pos = 0; pos < size;) {
+        const char *nl = memchr(data + pos, '\n', size - pos);
+        size_t end = nl ? (size_t)(nl - data) : size;
+        if (end > pos) {
+            if (n == cap) {
+                cap *= 2;
+                size_t *p = realloc(lines, (cap + 1) * sizeof(*lines));
+                if (!p) { free(lines); return NULL; }
+                lines = p;
+            }
+            lines[n++] = pos;
+        }
+        pos = end + 1;
+    }
+    lines[n] = size;
+    *count = n;
+    return lines;
+}
+
+int main(int argc, char *argv[]) {
+    ChunkerConfig ccfg = { .overlap_tokens = -1 };
+    DsWriterConfig wcfg = { .compression = DSW_COMPRESS_NONE, .append = 1 };
+    const char *field = "content";
+    const char *input = NULL;
+    const char *output = "chunks.jsonl";
+    int jobs = 0;
+    int positional = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--model") == 0 && i + 1 < argc) ccfg.model_path = argv[++i];
+        else if (strcmp(argv[i], "--tokens") == 0 && i + 1 < argc) ccfg.chunk_tokens = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--overlap") == 0 && i + 1 < argc) ccfg.overlap_tokens = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--bos") == 0) ccfg.add_bos = 1;
+        else if (strcmp(argv[i], "--field") == 0 && i + 1 < argc) field = argv[++i];
+        else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) jobs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--compress") == 0 && i + 1 < argc) {
+            if (ds_compression_parse(argv[++i], &wcfg.compression) != 0) {
+                fprintf(stderr, "Error: unknown compression '%s'\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--shard-records") == 0 && i + 1 < argc) wcfg.shard_records = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--shard-bytes") == 0 && i + 1 < argc) wcfg.shard_bytes = strtoull(argv[++i], NULL, 10);
+        else if (positional == 0) { input = argv[i]; positional++; }
+        else if (positional == 1) { output = argv[i]; positional++; }
+    }
+    if (!ccfg.model_path || !input) {
+        fprintf(stderr, "Usage: %s --model model.gguf [--tokens N] [--overlap N] [--bos] [--field NAME] [--jobs N] "
+                        "[--compress gzip|zstd] [--shard-records N] [--shard-bytes N] input.jsonl [output.jsonl]\n", argv[0]);
+        return 1;
+    }
+
+    int fd = open(input, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror(input);
+        return 1;
+    }
+    size_t size = (size_t)st.st_size;
+    const char *data = size ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : "";
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    if (size) madvise((void *)data, size, MADV_SEQUENTIAL);
+
+    Chunker *chunker = chunker_open(&ccfg);
+    if (!chunker) return 1;
+
+    wcfg.path = output;
+    DsWriter *out = ds_writer_open(&wcfg);
+    if (!out) {
+        fprintf(stderr, "Error: cannot open %s\n", output);
+        chunker_close(chunker);
+        return 1;
+    }
+
+    ChunkShared sh;
+    memset(&sh, 0, sizeof(sh));
+    sh.chunker = chunker;
+    sh.field = field;
+    sh.data = data;
+    sh.out = out;
+    sh.lines = index_lines(data, size, &sh.count);
+    pthread_mutex_init(&sh.out_lock, NULL);
+    if (!sh.lines) {
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+
+    if (jobs <= 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        jobs = n > 0 ? (int)n : 1;
+    }
+    if ((size_t)jobs > sh.count) jobs = sh.count ? (int)sh.count : 1;
+    pthread_t *threads = calloc((size_t)jobs, sizeof(pthread_t));
+    int started = 0;
+    if (threads) {
+        for (; started < jobs; started++) {
+            if (pthread_create(&threads[started], NULL, worker, &sh) != 0) break;
+        }
+    }
+    if (started == 0) worker(&sh);
+    for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+    free(threads);
+
+    int rc = ds_writer_close(out) != 0 || sh.failed;
+    printf("✅ %llu documents → %llu chunks, %llu tokens (budget %d/chunk), skipped %llu\n",
+           (unsigned long long)sh.documents, (unsigned long long)sh.chunks,
+           (unsigned long long)sh.tokens, chunker_budget(chunker), (unsigned long long)sh.skipped);
+
+    pthread_mutex_destroy(&sh.out_lock);
+    free(sh.lines);
+    if (size) munmap((void *)data, size);
+    chunker_close(chunker);
+    return rc;
+}
@@ -0,0 +1,306 @@
+// chunker.c — чанки по токенам GGUF-словаря (см. chunker.h)
+
+#include "chunker.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+struct Chunker {
+    struct llama_model *model;
+    const struct llama_vocab *vocab;
+    int budget;                // токенов текста в чанке
+    int overlap;
+};
+
+// === Токены ===
+
+static int tokbuf_reserve(TokenBuf *b, size_t need) {
+    if (need <= b->cap) return 0;
+    size_t cap = b->cap ? b->cap : 1024;
+    while (cap < need) cap *= 2;
+    llama_token *p = realloc(b->data, cap * sizeof(*p));
+    if (!p) return -1;
+    b->data = p;
+    b->cap = cap;
+    return 0;
+}
+
+int chunker_tokenize(const Chunker *c, const char *text, size_t len, TokenBuf *out) {
+    if (len > INT32_MAX) return -1;
+    out->len = 0;
+    if (len == 0) return 0;
+    // Токенов не больше, чем байт; обычно хватает с первого раза
+    if (tokbuf_reserve(out, len / 2 + 16) != 0) return -1;
+    int32_t n = llama_tokenize(c->vocab, text, (int32_t)len, out->data, (int32_t)out->cap, false, false);
+    if (n < 0) {
+        if (n == INT32_MIN || tokbuf_reserve(out, (size_t)-n) != 0) return -1;
+        n = llama_tokenize(c->vocab, text, (int32_t)len, out->data, (int32_t)out->cap, false, false);
+        if (n < 0) return -1;
+    }
+    out->len = (size_t)n;
+    return n;
+}
+
+static int detokenize(const Chunker *c, const llama_token *tokens, size_t n, StrBuf *out) {
+    strbuf_reset(out);
+    size_t want = n * 8 + 16;
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (strbuf_reserve(out, want) != 0 || want > INT32_MAX) return -1;
+        int32_t r = llama_detokenize(c->vocab, tokens, (int32_t)n, out->data, (int32_t)want, false, false);
+        if (r >= 0) {
+            out->len = (size_t)r;
+            out->data[out->len] = '\0';
+            return 0;
+        }
+        want = (size_t)-(int64_t)r + 1;
+    }
+    return -1;
+}
+
+// === Сегменты ===
+
+static int push_segment(ChunkScratch *s, size_t off, size_t len, int n_tokens) {
+    if (s->n_segs == s->seg_cap) {
+        size_t cap = s->seg_cap ? s->seg_cap * 2 : 64;
+        ChunkSegment *p = realloc(s->segs, cap * sizeof(*p));
+        if (!p) return -1;
+        s->segs = p;
+        s->seg_cap = cap;
+    }
+    s->segs[s->n_segs++] = (ChunkSegment){ off, len, n_tokens };
+    return 0;
+}
+
+static inline int is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Следующая единица внутри слишком длинного сегмента: предложение (текст) или строка (код)
+static size_t next_unit(const char *text, size_t pos, size_t end, int is_code) {
+    for (size_t i = pos; i < end; i++) {
+        if (text[i] == '\n') return i + 1;
+        if (!is_code && (text[i] == '.' || text[i] == '!' || text[i] == '?') &&
+            i + 1 < end && is_space(text[i + 1])) return i + 1;
+    }
+    return end;
+}
+
+// Сегмент из разметки: считаем токены, длинный дробим на предложения/строки.
+// Единицы длиннее бюджета остаются как есть и режутся окнами при упаковке.
+static int add_piece(const Chunker *c, ChunkScratch *s, const char *text, size_t off, size_t len, int is_code) {
+    int n = chunker_tokenize(c, text + off, len, &s->tokens);
+    if (n < 0) return -1;
+    if (n <= c->budget) return push_segment(s, off, len, n);
+
+    size_t end = off + len;
+    size_t pos = off;
+    while (pos < end) {
+        while (pos < end && is_space(text[pos])) pos++;
+        if (pos >= end) break;
+        size_t stop = next_unit(text, pos, end, is_code);
+        size_t ulen = stop - pos;
+        while (ulen > 0 && is_space(text[pos + ulen - 1])) ulen--;
+        if (ulen > 0) {
+            int un = chunker_tokenize(c, text + pos, ulen, &s->tokens);
+            if (un < 0 || push_segment(s, pos, ulen, un) != 0) return -1;
+        }
+        pos = stop;
+    }
+    return 0;
+}
+
+static inline int is_fence(const char *line, size_t len) {
+    size_t i = 0;
+    while (i < len && (line[i] == ' ' || line[i] == '\t')) i++;
+    return len - i >= 3 && memcmp(line + i, "```", 3) == 0;
+}
+
+static inline int is_blank(const char *line, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (!is_space(line[i])) return 0;
+    }
+    return 1;
+}
+
+// Абзацы по пустым строкам; блок ``` ... ``` — один сегмент, даже с пустыми строками внутри
+static int segment(const Chunker *c, ChunkScratch *s, const char *text, size_t len) {
+    s->n_segs = 0;
+    size_t seg_start = SIZE_MAX, seg_end = 0;
+    int in_fence = 0;
+
+    for (size_t ls = 0; ls < len;) {
+        const char *nl = memchr(text + ls, '\n', len - ls);
+        size_t le = nl ? (size_t)(nl - text) : len;
+        size_t next = nl ? le + 1 : len;
+        const char *line = text + ls;
+        size_t line_len = le - ls;
+
+        if (in_fence) {
+            seg_end = le;
+            if (is_fence(line, line_len)) {
+                if (add_piece(c, s, text, seg_start, seg_end - seg_start, 1) != 0) return -1;
+                seg_start = SIZE_MAX;
+                in_fence = 0;
+            }
+        } else if (is_fence(line, line_len)) {
+            if (seg_start != SIZE_MAX && add_piece(c, s, text, seg_start, seg_end - seg_start, 0) != 0) return -1;
+            seg_start = ls;
+            seg_end = le;
+            in_fence = 1;
+        } else if (is_blank(line, line_len)) {
+            if (seg_start != SIZE_MAX && add_piece(c, s, text, seg_start, seg_end - seg_start, 0) != 0) return -1;
+            seg_start = SIZE_MAX;
+        } else {
+            if (seg_start == SIZE_MAX) seg_start = ls;
+            seg_end = le;
+        }
+        ls = next;
+    }
+    if (seg_start != SIZE_MAX && add_piece(c, s, text, seg_start, seg_end - seg_start, in_fence) != 0) return -1;
+    return 0;
+}
+
+// === Упаковка ===
+
+// Сегмент длиннее бюджета: окна по токенам с перекрытием
+static long split_windows(const Chunker *c, ChunkScratch *s, const char *text, const ChunkSegment *seg,
+                          ChunkEmitFn emit, void *ud, size_t *index) {
+    if (chunker_tokenize(c, text + seg->off, seg->len, &s->tokens) < 0) return -1;
+    size_t total = s->tokens.len;
+    size_t stride = (size_t)(c->budget - c->overlap);
+    long emitted = 0;
+    for (size_t start = 0; start < total;) {
+        size_t n = total - start < (size_t)c->budget ? total - start : (size_t)c->budget;
+        // Склейка на границе окна может дать другие токены — проверяем и ужимаем
+        int nt;
+        for (;;) {
+            if (detokenize(c, s->tokens.data + start, n, &s->text) != 0) return -1;
+            nt = chunker_tokenize(c, s->text.data, s->text.len, &s->check);
+            if (nt < 0) return -1;
+            if (nt <= c->budget || n <= 1) break;
+            n -= (size_t)(nt - c->budget) < n ? (size_t)(nt - c->budget) : n - 1;
+        }
+        if (emit(ud, s->text.data, s->text.len, nt, (*index)++) != 0) return -1;
+        emitted++;
+        if (start + n >= total) break;
+        start += n < stride ? n : stride;
+    }
+    return emitted;
+}
+
+long chunker_split(const Chunker *c, const char *text, size_t len,
+                   ChunkScratch *s, ChunkEmitFn emit, void *ud) {
+    if (segment(c, s, text, len) != 0) return -1;
+
+    const ChunkSegment *segs = s->segs;
+    size_t n = s->n_segs;
+    size_t index = 0;
+    long emitted = 0;
+    size_t i = 0, first_new = 0;
+
+    while (i < n) {
+        if (segs[i].n_tokens > c->budget) {
+            long r = split_windows(c, s, text, &segs[i], emit, ud, &index);
+            if (r < 0) return -1;
+            emitted += r;
+            first_new = i = i + 1;
+            continue;
+        }
+
+        // Жадно набираем сегменты; разделитель между ними — примерно один токен
+        size_t j = i;
+        long sum = segs[i].n_tokens;
+        while (j + 1 < n && segs[j + 1].n_tokens <= c->budget &&
+               sum + 1 + segs[j + 1].n_tokens <= c->budget) {
+            j++;
+            sum += 1 + segs[j].n_tokens;
+        }
+
+        // Перекрытие не должно давать чанк без нового текста
+        if (j < first_new && i < first_new) {
+            i = first_new;
+            continue;
+        }
+
+        // Точная длина — токенизацией итогового куска
+        size_t off, slice;
+        int nt;
+        for (;;) {
+            off = segs[i].off;
+            slice = segs[j].off + segs[j].len - off;
+            nt = chunker_tokenize(c, text + off, slice, &s->check);
+            if (nt < 0) return -1;
+            if (nt <= c->budget || j == i) break;
+            j--;
+        }
+        if (j < first_new && i < first_new) {
+            i = first_new;
+            continue;
+        }
+        if (emit(ud, text + off, slice, nt, index++) != 0) return -1;
+        emitted++;
+        if (j + 1 >= n) break;
+
+        // Следующий чанк начинается с хвоста текущего (целыми сегментами)
+        first_new = j + 1;
+        size_t k = j + 1;
+        long ov = 0;
+        while (k - 1 > i && ov + segs[k - 1].n_tokens <= c->overlap) {
+            k--;
+            ov += segs[k].n_tokens;
+        }
+        i = k;
+    }
+    return emitted;
+}
+
+void chunk_scratch_free(ChunkScratch *s) {
+    free(s->tokens.data);
+    free(s->check.data);
+    free(s->segs);
+    strbuf_free(&s->text);
+    memset(s, 0, sizeof(*s));
+}
+
+// === Словарь ===
+
+Chunker *chunker_open(const ChunkerConfig *cfg) {
+    Chunker *c = calloc(1, sizeof(*c));
+    if (!c) return NULL;
+
+    int chunk_tokens = cfg->chunk_tokens > 0 ? cfg->chunk_tokens : CHUNK_DEFAULT_TOKENS;
+    c->budget = chunk_tokens - (cfg->add_bos ? 1 : 0);
+    if (c->budget < 1) c->budget = 1;
+    c->overlap = cfg->overlap_tokens >= 0 ? cfg->overlap_tokens : CHUNK_DEFAULT_OVERLAP;
+    if (c->overlap > c->budget / 2) c->overlap = c->budget / 2;
+
+    llama_backend_init();
+    struct llama_model_params mp = llama_model_default_params();
+    mp.vocab_only = true;   // веса не нужны — только токенизатор
+    c->model = llama_model_load_from_file(cfg->model_path, mp);
+    if (!c->model) {
+        fprintf(stderr, "chunker: failed to load vocab from %s\n", cfg->model_path);
+        llama_backend_free();
+        free(c);
+        return NULL;
+    }
+    c->vocab = llama_model_get_vocab(c->model);
+    return c;
+}
+
+void chunker_close(Chunker *c) {
+    if (!c) return;
+    llama_model_free(c->model);
+    llama_backend_free();
+    free(c);
+}
+
+const struct llama_vocab *chunker_vocab(const Chunker *c) {
+    return c->vocab;
+}
+
+int chunker_budget(const Chunker *c) {
+    return c->budget;
+}
@@ -0,0 +1,75 @@
+// chunker.h — разбиение документов на чанки по токенам модели
+//
+// Документ режется не по байтам, а по токенам того же GGUF-словаря, что
+// загружает bot.c (модель открывается в режиме vocab_only — веса не
+// читаются). Границы чанков выбираются по структуре текста:
+//   1. абзацы (пустая строка) и блоки кода ``` целиком;
+//   2. абзац длиннее бюджета — по концам предложений;
+//   3. предложение длиннее бюджета — окнами по токенам.
+// Соседние чанки перекрываются целыми сегментами на overlap_tokens.
+// Длина каждого чанка проверяется повторной токенизацией, так что
+// результат гарантированно помещается в chunk_tokens.
+// Словарь только читается: один Chunker можно использовать из нескольких
+// потоков, если у каждого свой ChunkScratch.
+
+#ifndef CHUNKER_H
+#define CHUNKER_H
+
+#include <stddef.h>
+
+#include "../llama.cpp/include/llama.h"
+#include "json_escape.h"
+
+#define CHUNK_DEFAULT_TOKENS 2048
+#define CHUNK_DEFAULT_OVERLAP 128
+
+typedef struct {
+    const char *model_path;    // GGUF; читается только словарь
+    int chunk_tokens;          // 0 → CHUNK_DEFAULT_TOKENS
+    int overlap_tokens;        // < 0 → CHUNK_DEFAULT_OVERLAP
+    int add_bos;               // резервировать место под BOS в каждом чанке
+} ChunkerConfig;
+
+typedef struct {
+    llama_token *data;
+    size_t len;
+    size_t cap;
+} TokenBuf;
+
+typedef struct {
+    size_t off;
+    size_t len;
+    int n_tokens;
+} ChunkSegment;
+
+// Рабочие буферы одного потока; нулевая инициализация допустима
+typedef struct {
+    TokenBuf tokens;
+    TokenBuf check;            // повторная токенизация при проверке длины
+    ChunkSegment *segs;
+    size_t n_segs;
+    size_t seg_cap;
+    StrBuf text;               // текст окна при разрезании по токенам
+} ChunkScratch;
+
+typedef struct Chunker Chunker;
+
+// Вызывается на каждый чанк; ненулевой возврат прерывает разбиение
+typedef int (*ChunkEmitFn)(void *ud, const char *text, size_t len, int n_tokens, size_t index);
+
+Chunker *chunker_open(const ChunkerConfig *cfg);
+void chunker_close(Chunker *chunker);
+
+const struct llama_vocab *chunker_vocab(const Chunker *chunker);
+int chunker_budget(const Chunker *chunker);   // токенов текста в чанке (без BOS)
+
+// Токенизирует text в out (без спецтокенов); число токенов или -1
+int chunker_tokenize(const Chunker *chunker, const char *text, size_t len, TokenBuf *out);
+
+// Разбивает документ и отдаёт чанки по порядку; число чанков или -1
+long chunker_split(const Chunker *chunker, const char *text, size_t len,
+                   ChunkScratch *scratch, ChunkEmitFn emit, void *ud);
+
+void chunk_scratch_free(ChunkScratch *scratch);
+
+#endif // CHUNKER_H
@@ -17,7 +17,7 @@ extern const datasetConfigs SITES[] = {
     {"https://en.cppreference.com/w/c", "//h1", "//div[@id='toc']//following::p | //div[@class='t-navbar']//following::p", "C"},
 
     // === C Standard & References ===
-    {"https://www.open-std.org/jtc1/sc22/wg14/www/docs/n1570.pdf", "", "", "C"}, // ISO C11 draft (PDF — требует отдельной обработки)
+    {"https://www.open-std.org/jtc1/sc22/wg14/www/docs/n1570.pdf", "", "", "C"}, // ISO C11 draft (PDF: текст извлекает pdf.c, XPath не нужен)
     {"https://port70.net/~nsz/c/c11/n1570.html", "//title", "//body//p | //pre", "C"}, // HTML-версия C11
 
     // === Practical C & System Programming ===
@@ -0,0 +1,748 @@
+// crawl.c — обход сайта в ширину (см. crawl.h)
+
+#define _GNU_SOURCE
+#include "crawl.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <libxml/HTMLparser.h>
+#include <libxml/tree.h>
+
+#include "url.h"
+#include "json_escape.h"
+#include "normalize.h"
+#include "../alog.h"
+
+#define CRAWL_MAX_HOST 256
+#define CRAWL_WAIT_SLICE_NS (200 * 1000000LL)   // как часто спящие потоки проверяют остановку
+
+static volatile sig_atomic_t stop_requested = 0;
+
+void crawl_request_stop(void) {
+    stop_requested = 1;
+}
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// === Очередь-кольцо ===
+
+typedef struct {
+    char **items;
+    size_t head;
+    size_t len;
+    size_t cap;
+} UrlQueue;
+
+static int queue_push(UrlQueue *q, char *url) {
+    if (q->len == q->cap) {
+        size_t cap = q->cap ? q->cap * 2 : 64;
+        char **items = malloc(cap * sizeof(*items));
+        if (!items) return -1;
+        // Разворачиваем кольцо в начало нового массива
+        for (size_t i = 0; i < q->len; i++) items[i] = q->items[(q->head + i) % q->cap];
+        free(q->items);
+        q->items = items;
+        q->head = 0;
+        q->cap = cap;
+    }
+    q->items[(q->head + q->len) % q->cap] = url;
+    q->len++;
+    return 0;
+}
+
+static char *queue_pop(UrlQueue *q) {
+    if (q->len == 0) return NULL;
+    char *url = q->items[q->head];
+    q->head = (q->head + 1) % q->cap;
+    q->len--;
+    return url;
+}
+
+static inline const char *queue_at(const UrlQueue *q, size_t i) {
+    return q->items[(q->head + i) % q->cap];
+}
+
+static void queue_free(UrlQueue *q) {
+    for (size_t i = 0; i < q->len; i++) free(q->items[(q->head + i) % q->cap]);
+    free(q->items);
+    memset(q, 0, sizeof(*q));
+}
+
+// === Посещённые: открытая адресация по 64-битному хэшу ===
+
+typedef struct {
+    uint64_t *slots;           // 0 — пусто
+    size_t cap;                // степень двойки
+    size_t count;
+} VisitedSet;
+
+static int visited_insert_raw(uint64_t *slots, size_t cap, uint64_t h) {
+    size_t mask = cap - 1;
+    for (size_t i = (size_t)h & mask;; i = (i + 1) & mask) {
+        if (slots[i] == h) return 0;
+        if (slots[i] == 0) { slots[i] = h; return 1; }
+    }
+}
+
+// 1 — новый, 0 — уже был, -1 — нет памяти
+static int visited_add(VisitedSet *v, uint64_t h) {
+    if (h == 0) h = 1;
+    if ((v->count + 1) * 10 > v->cap * 7) {
+        size_t cap = v->cap ? v->cap * 2 : 4096;
+        uint64_t *slots = calloc(cap, sizeof(*slots));
+        if (!slots) return -1;
+        for (size_t i = 0; i < v->cap; i++) {
+            if (v->slots[i]) visited_insert_raw(slots, cap, v->slots[i]);
+        }
+        free(v->slots);
+        v->slots = slots;
+        v->cap = cap;
+    }
+    int added = visited_insert_raw(v->slots, v->cap, h);
+    v->count += (size_t)added;
+    return added;
+}
+
+// === Хосты ===
+
+typedef struct {
+    char name[CRAWL_MAX_HOST];
+    UrlQueue queue;
+    int in_flight;
+    int max_in_flight;         // host_concurrency, 1 при Crawl-delay
+    int64_t next_ns;           // раньше этого момента новый запрос не начинаем
+    int64_t delay_ns;          // max(delay_ms, Crawl-delay)
+    int robots_known;          // Crawl-delay уже учтён
+} Host;
+
+typedef struct {
+    const CrawlConfig *cfg;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+
+    Host **hosts;
+    size_t n_hosts;
+    size_t hosts_cap;
+    uint32_t *host_index;      // открытая адресация: 0 — пусто, иначе индекс + 1
+    size_t host_index_cap;
+    size_t cursor;             // круговой обход хостов
+
+    VisitedSet visited;
+    size_t queued;
+    int in_flight;
+    char **inflight_urls;      // по слоту на поток — попадают в сохранённую очередь
+    uint64_t pages_total;      // с учётом прошлых запусков
+    size_t since_checkpoint;
+    int64_t delay_ns;
+
+    pthread_mutex_t out_lock;  // дедупликация + запись
+    CrawlStats stats;
+} Crawler;
+
+static Host *host_find(Crawler *cr, const char *name) {
+    if (!cr->host_index_cap) return NULL;
+    size_t mask = cr->host_index_cap - 1;
+    for (size_t i = (size_t)url_hash(name, strlen(name)) & mask;; i = (i + 1) & mask) {
+        uint32_t e = cr->host_index[i];
+        if (e == 0) return NULL;
+        if (strcmp(cr->hosts[e - 1]->name, name) == 0) return cr->hosts[e - 1];
+    }
+}
+
+static Host *host_add(Crawler *cr, const char *name) {
+    if ((cr->n_hosts + 1) * 2 > cr->host_index_cap) {
+        size_t cap = cr->host_index_cap ? cr->host_index_cap * 2 : 64;
+        uint32_t *index = calloc(cap, sizeof(*index));
+        if (!index) return NULL;
+        for (size_t h = 0; h < cr->n_hosts; h++) {
+            size_t i = (size_t)url_hash(cr->hosts[h]->name, strlen(cr->hosts[h]->name)) & (cap - 1);
+            while (index[i]) i = (i + 1) & (cap - 1);
+            index[i] = (uint32_t)(h + 1);
+        }
+        free(cr->host_index);
+        cr->host_index = index;
+        cr->host_index_cap = cap;
+    }
+    if (cr->n_hosts == cr->hosts_cap) {
+        size_t cap = cr->hosts_cap ? cr->hosts_cap * 2 : 16;
+        Host **hosts = realloc(cr->hosts, cap * sizeof(*hosts));
+        if (!hosts) return NULL;
+        cr->hosts = hosts;
+        cr->hosts_cap = cap;
+    }
+    Host *h = calloc(1, sizeof(*h));
+    if (!h) return NULL;
+    snprintf(h->name, sizeof(h->name), "%s", name);
+    h->max_in_flight = cr->cfg->host_concurrency;
+    h->delay_ns = cr->delay_ns;
+    size_t i = (size_t)url_hash(name, strlen(name)) & (cr->host_index_cap - 1);
+    while (cr->host_index[i]) i = (i + 1) & (cr->host_index_cap - 1);
+    cr->host_index[i] = (uint32_t)(cr->n_hosts + 1);
+    cr->hosts[cr->n_hosts++] = h;
+    return h;
+}
+
+// === Фронтир ===
+
+// Адрес не ведёт на страницу или на служебный вид MediaWiki
+static int skip_url(const char *url) {
+    static const char *const SKIP_PARTS[] = { "action=", "oldid=", "printable=", "diff=" };
+    static const char *const SKIP_EXT[] = {
+        ".png", ".jpg", ".jpeg", ".gif", ".svg", ".ico", ".css", ".js",
+        ".zip", ".gz", ".xz", ".tar", ".iso", ".img", ".bin", ".exe",
+    };
+    for (size_t i = 0; i < sizeof(SKIP_PARTS) / sizeof(SKIP_PARTS[0]); i++) {
+        if (strstr(url, SKIP_PARTS[i])) return 1;
+    }
+    const char *path = url_path(url);
+    size_t path_len = strcspn(path, "?");
+    for (size_t i = 0; i < sizeof(SKIP_EXT) / sizeof(SKIP_EXT[0]); i++) {
+        size_t n = strlen(SKIP_EXT[i]);
+        if (path_len >= n && strncasecmp(path + path_len - n, SKIP_EXT[i], n) == 0) return 1;
+    }
+    return 0;
+}
+
+// Под lock. check_visited = 0 — адрес из сохранённой очереди (уже учтён)
+static int enqueue_locked(Crawler *cr, const char *url, int check_visited) {
+    char host_name[CRAWL_MAX_HOST];
+    if (url_host(url, host_name, sizeof(host_name)) != 0) return 0;
+    Host *h = host_find(cr, host_name);
+    if (!h && check_visited && !cr->cfg->any_host) return 0;   // чужой хост
+    if (check_visited) {
+        if (skip_url(url)) return 0;
+        int added = visited_add(&cr->visited, url_hash(url, strlen(url)));
+        if (added <= 0) return added;
+        // robots.txt хоста уже загружен — запрещённое в очередь не попадает;
+        // иначе адрес проверит поток перед загрузкой
+        if (cr->cfg->robots && robots_check(cr->cfg->robots, url, 0, NULL) == 0) {
+            cr->stats.robots_blocked++;
+            return 0;
+        }
+    }
+    if (!h && !(h = host_add(cr, host_name))) return -1;
+    char *copy = strdup(url);
+    if (!copy || queue_push(&h->queue, copy) != 0) {
+        free(copy);
+        return -1;
+    }
+    cr->queued++;
+    cr->stats.enqueued++;
+    return 1;
+}
+
+// === Сохранение состояния ===
+// "OXCRAWL1 <visited> <queued> <pages>\n", затем visited × uint64 и адреса очереди по строкам
+
+// Перед сохранением: посещённые страницы отмечаются только тогда, когда их
+// записи на диске, а отпечатки — в индексе. Порядок замков — lock, затем out_lock
+static int sync_output(Crawler *cr) {
+    pthread_mutex_lock(&cr->out_lock);
+    int rc = ds_writer_sync(cr->cfg->out);
+    if (rc == 0 && cr->cfg->dedup) rc = fpindex_commit(cr->cfg->dedup);
+    pthread_mutex_unlock(&cr->out_lock);
+    return rc;
+}
+
+static int save_state_locked(Crawler *cr) {
+    const char *path = cr->cfg->state_path;
+    if (!path) return 0;
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *f = fopen(tmp, "wb");
+    if (!f) return -1;
+
+    size_t pending = cr->queued;
+    for (int i = 0; i < cr->cfg->jobs; i++) pending += cr->inflight_urls[i] != NULL;
+    fprintf(f, "%s %zu %zu %llu\n", CRAWL_STATE_MAGIC, cr->visited.count, pending,
+            (unsigned long long)cr->pages_total);
+    for (size_t i = 0; i < cr->visited.cap; i++) {
+        if (cr->visited.slots[i]) fwrite(&cr->visited.slots[i], sizeof(uint64_t), 1, f);
+    }
+    // Недокачанные страницы — первыми: после возобновления их скачают заново
+    for (int i = 0; i < cr->cfg->jobs; i++) {
+        if (cr->inflight_urls[i]) fprintf(f, "%s\n", cr->inflight_urls[i]);
+    }
+    for (size_t h = 0; h < cr->n_hosts; h++) {
+        const UrlQueue *q = &cr->hosts[h]->queue;
+        for (size_t i = 0; i < q->len; i++) fprintf(f, "%s\n", queue_at(q, i));
+    }
+    if (fflush(f) != 0 || fsync(fileno(f)) != 0 || ferror(f)) {
+        fclose(f);
+        unlink(tmp);
+        return -1;
+    }
+    if (fclose(f) != 0 || rename(tmp, path) != 0) {
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+// 1 — состояние загружено, 0 — файла нет, -1 — ошибка
+static int load_state(Crawler *cr) {
+    const char *path = cr->cfg->state_path;
+    if (!path) return 0;
+    FILE *f = fopen(path, "rb");
+    if (!f) return errno == ENOENT ? 0 : -1;
+
+    char magic[16];
+    size_t n_visited, n_queued;
+    unsigned long long pages;
+    int rc = -1;
+    if (fscanf(f, "%15s %zu %zu %llu", magic, &n_visited, &n_queued, &pages) != 4 ||
+        strcmp(magic, CRAWL_STATE_MAGIC) != 0 || fgetc(f) != '\n') {
+        fprintf(stderr, "⚠️  crawl: %s is not a crawl state file\n", path);
+        goto out;
+    }
+    for (size_t i = 0; i < n_visited; i++) {
+        uint64_t h;
+        if (fread(&h, sizeof(h), 1, f) != 1 || visited_add(&cr->visited, h) < 0) goto out;
+    }
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    while ((len = getline(&line, &cap, f)) > 0) {
+        if (line[len - 1] == '\n') line[--len] = '\0';
+        if (len > 0 && enqueue_locked(cr, line, 0) < 0) break;
+    }
+    free(line);
+    cr->pages_total = pages;
+    cr->stats.enqueued = 0;
+    rc = 1;
+out:
+    fclose(f);
+    return rc;
+}
+
+// === Планировщик ===
+
+// Следующий адрес для потока slot; NULL — работа закончена
+static char *next_url(Crawler *cr, int slot, Host **host_out) {
+    const CrawlConfig *cfg = cr->cfg;
+    pthread_mutex_lock(&cr->lock);
+    char *url = NULL;
+    for (;;) {
+        if (stop_requested) break;
+        if (cfg->max_pages && cr->pages_total >= cfg->max_pages) break;
+        if (cr->queued == 0 && cr->in_flight == 0) break;
+
+        int64_t now = now_ns();
+        int64_t wake = now + CRAWL_WAIT_SLICE_NS;
+        for (size_t k = 0; k < cr->n_hosts; k++) {
+            size_t idx = (cr->cursor + k) % cr->n_hosts;
+            Host *h = cr->hosts[idx];
+            if (h->queue.len == 0 || h->in_flight >= h->max_in_flight) continue;
+            if (h->next_ns > now) {
+                if (h->next_ns < wake) wake = h->next_ns;
+                continue;
+            }
+            url = queue_pop(&h->queue);
+            cr->queued--;
+            h->in_flight++;
+            h->next_ns = now + h->delay_ns;
+            cr->in_flight++;
+            cr->pages_total++;
+            cr->cursor = idx + 1;
+            cr->inflight_urls[slot] = url;
+            *host_out = h;
+            break;
+        }
+        if (url) break;
+
+        struct timespec ts = { .tv_sec = wake / 1000000000LL, .tv_nsec = wake % 1000000000LL };
+        pthread_cond_timedwait(&cr->cond, &cr->lock, &ts);
+    }
+    pthread_mutex_unlock(&cr->lock);
+    return url;
+}
+
+// Проверка robots.txt перед загрузкой (первый поток хоста качает robots.txt,
+// остальные ждут его). 0 — адрес запрещён: он снимается без загрузки и не
+// считается в max_pages
+static int robots_admit(Crawler *cr, int slot, Host *h, char *url) {
+    int delay_ms;
+    int allowed = robots_check(cr->cfg->robots, url, 1, &delay_ms);
+    pthread_mutex_lock(&cr->lock);
+    if (!h->robots_known) {
+        h->robots_known = 1;
+        int64_t delay_ns = (int64_t)delay_ms * 1000000LL;
+        if (delay_ms >= 0) h->max_in_flight = 1;
+        if (delay_ns > h->delay_ns) {
+            h->next_ns += delay_ns - h->delay_ns;
+            h->delay_ns = delay_ns;
+        }
+    }
+    if (!allowed) {
+        h->in_flight--;
+        cr->in_flight--;
+        cr->pages_total--;
+        cr->inflight_urls[slot] = NULL;
+        cr->stats.robots_blocked++;
+        free(url);
+        pthread_cond_broadcast(&cr->cond);
+    }
+    pthread_mutex_unlock(&cr->lock);
+    return allowed;
+}
+
+// Страница обработана: ссылки — в очередь, url освобождается
+static void finish_url(Crawler *cr, int slot, Host *h, char *url, const StrBuf *links, size_t n_links) {
+    pthread_mutex_lock(&cr->lock);
+    h->in_flight--;
+    cr->in_flight--;
+    cr->inflight_urls[slot] = NULL;
+    free(url);
+    const char *p = links->data;
+    for (size_t i = 0; i < n_links; i++) {
+        size_t len = strlen(p);
+        enqueue_locked(cr, p, 1);
+        p += len + 1;
+    }
+    cr->stats.links += n_links;
+    if (++cr->since_checkpoint >= cr->cfg->checkpoint_every) {
+        cr->since_checkpoint = 0;
+        if (sync_output(cr) != 0 || save_state_locked(cr) != 0)
+            fprintf(stderr, "⚠️  crawl: cannot save state: %s\n", strerror(errno));
+    }
+    pthread_cond_broadcast(&cr->cond);
+    pthread_mutex_unlock(&cr->lock);
+}
+
+// === Разбор страницы ===
+
+typedef struct {
+    const char *url;
+    StrBuf pre;                // <pre>-блоки, через "\n\n"
+    StrBuf code;               // <code> вне <pre>
+    StrBuf links;              // канонические адреса через '\0'
+    size_t n_links;
+} PageScan;
+
+static int has_class(xmlNode *node, const char *const *classes, size_t n) {
+    xmlChar *cls = xmlGetProp(node, (const xmlChar *)"class");
+    if (!cls) return 0;
+    int found = 0;
+    for (char *save = NULL, *tok = strtok_r((char *)cls, " \t\n", &save); tok && !found;
+         tok = strtok_r(NULL, " \t\n", &save)) {
+        for (size_t i = 0; i < n; i++) {
+            if (strcmp(tok, classes[i]) == 0) { found = 1; break; }
+        }
+    }
+    xmlFree(cls);
+    return found;
+}
+
+static xmlNode *find_by_id(xmlNode *node, const char *id) {
+    for (; node; node = node->next) {
+        if (node->type != XML_ELEMENT_NODE) continue;
+        xmlChar *v = xmlGetProp(node, (const xmlChar *)"id");
+        int match = v && strcmp((const char *)v, id) == 0;
+        xmlFree(v);
+        if (match) return node;
+        xmlNode *r = find_by_id(node->children, id);
+        if (r) return r;
+    }
+    return NULL;
+}
+
+static xmlNode *find_element(xmlNode *node, const char *name, const char *cls) {
+    for (; node; node = node->next) {
+        if (node->type != XML_ELEMENT_NODE) continue;
+        if (strcasecmp((const char *)node->name, name) == 0 && (!cls || has_class(node, &cls, 1))) return node;
+        xmlNode *r = find_element(node->children, name, cls);
+        if (r) return r;
+    }
+    return NULL;
+}
+
+// Сноски [1] и комментарии // ... [edit] до конца строки — как clean_code в бывшем dataset.py
+static void clean_code(StrBuf *out, const char *code) {
+    size_t start = out->len;
+    for (const char *p = code; *p;) {
+        if (*p == '[') {
+            const char *q = p + 1;
+            while (*q >= '0' && *q <= '9') q++;
+            if (q > p + 1 && *q == ']') { p = q + 1; continue; }
+        }
+        if (p[0] == '/' && p[1] == '/') {
+            const char *eol = strchr(p, '\n');
+            const char *lb = memchr(p, '[', eol ? (size_t)(eol - p) : 0);
+            if (eol && lb && memchr(lb, ']', (size_t)(eol - lb))) { p = eol; continue; }
+        }
+        strbuf_append(out, p, 1);
+        p++;
+    }
+    // strip()
+    size_t s = start;
+    while (s < out->len && (out->data[s] == ' ' || out->data[s] == '\n' || out->data[s] == '\t' || out->data[s] == '\r')) s++;
+    memmove(out->data + start, out->data + s, out->len - s);
+    out->len -= s - start;
+    while (out->len > start && (out->data[out->len - 1] == ' ' || out->data[out->len - 1] == '\n' ||
+                                out->data[out->len - 1] == '\t' || out->data[out->len - 1] == '\r')) out->len--;
+    if (out->data) out->data[out->len] = '\0';
+}
+
+static void add_code(StrBuf *dst, const char *code) {
+    if (strlen(code) <= 30) return;
+    if (dst->len) strbuf_append_str(dst, "\n\n");
+    clean_code(dst, code);
+}
+
+static void scan_content(xmlNode *node, PageScan *ps) {
+    static const char *const SKIP_CLASSES[] = { "mw-editsection", "thumb", "navbox", "infobox", "printfooter" };
+    for (; node; node = node->next) {
+        if (node->type != XML_ELEMENT_NODE) continue;
+        if (has_class(node, SKIP_CLASSES, sizeof(SKIP_CLASSES) / sizeof(SKIP_CLASSES[0]))) continue;
+        const char *name = (const char *)node->name;
+
+        if (strcasecmp(name, "pre") == 0 || strcasecmp(name, "code") == 0) {
+            int is_pre = name[0] == 'p' || name[0] == 'P';
+            char *text = (char *)xmlNodeGetContent(node);
+            if (text) {
+                size_t len = strlen(text);
+                int keep = is_pre
+                    ? len > 20 && (strchr(text, '{') || strcasestr(text, "asm") || strstr(text, "__attribute__"))
+                    : len > 50 && (strstr(text, "void") || strstr(text, "uint") || strcasestr(text, "asm"));
+                if (keep) add_code(is_pre ? &ps->pre : &ps->code, text);
+                xmlFree(text);
+            }
+            continue;   // внутри <pre>/<code> ни ссылок, ни вложенного кода не ищем
+        }
+        if (strcasecmp(name, "a") == 0) {
+            xmlChar *href = xmlGetProp(node, (const xmlChar *)"href");
+            char abs[URL_MAX];
+            if (href && url_resolve(ps->url, (const char *)href, abs, sizeof(abs)) == 0) {
+                strbuf_append(&ps->links, abs, strlen(abs) + 1);
+                ps->n_links++;
+            }
+            xmlFree(href);
+        }
+        scan_content(node->children, ps);
+    }
+}
+
+static char *node_text(xmlNode *node) {
+    if (!node) return NULL;
+    char *text = (char *)xmlNodeGetContent(node);
+    if (!text) return NULL;
+    size_t n = text_normalize(text, strlen(text), NULL, NULL);
+    if (n == 0) { xmlFree(text); return NULL; }
+    char *copy = strdup(text);
+    xmlFree(text);
+    return copy;
+}
+
+static int build_record(StrBuf *b, const char *title, const StrBuf *code, const char *url, const char *category) {
+    char prompt[1024];
+    snprintf(prompt, sizeof(prompt),
+             "Explain how to implement %s when writing an operating system in C for x86_64. "
+             "Provide a complete, working code example without standard library dependencies.", title);
+    char head[1024];
+    int head_len = snprintf(head, sizeof(head),
+                            "Here is a correct implementation for %s in C (x86_64 bare-metal):\n\n```c\n", title);
+    if (head_len < 0 || (size_t)head_len >= sizeof(head)) head_len = (int)strlen(head);
+
+    int rc = 0;
+    strbuf_reset(b);
+    rc |= strbuf_append_str(b, "{\"messages\":[{\"role\":\"user\",\"content\":\"");
+    rc |= json_escape_append(b, prompt, strlen(prompt));
+    rc |= strbuf_append_str(b, "\"},{\"role\":\"assistant\",\"content\":\"");
+    rc |= json_escape_append(b, head, (size_t)head_len);
+    rc |= json_escape_append(b, code->data, code->len);
+    rc |= strbuf_append_str(b, "\\n```\"}],\"metadata\":{\"source\":\"");
+    rc |= json_escape_append(b, url, strlen(url));
+    rc |= strbuf_append_str(b, "\",\"category\":\"");
+    rc |= json_escape_append(b, category, strlen(category));
+    rc |= strbuf_append_str(b, "\"}}\n");
+    return rc;
+}
+
+// Страница → запись (если на ней есть код) и список ссылок
+static void process_page(Crawler *cr, const char *url, const FetchResult *page, PageScan *ps, StrBuf *rec, StrBuf *key) {
+    const CrawlConfig *cfg = cr->cfg;
+    htmlDocPtr doc = htmlReadMemory(page->body, (int)page->size, url, NULL,
+                                    HTML_PARSE_RECOVER | HTML_PARSE_NOERROR | HTML_PARSE_NOWARNING | HTML_PARSE_NONET);
+    if (!doc) return;
+    xmlNode *root = xmlDocGetRootElement(doc);
+
+    char *title = node_text(find_element(root, "h1", "firstHeading"));
+    if (!title) title = node_text(find_element(root, "title", NULL));
+    xmlNode *content = find_by_id(root, "mw-content-text");
+    if (!content) content = find_element(root, "body", NULL);
+    if (content) scan_content(content->children, ps);
+    xmlFreeDoc(doc);
+
+    // Полный код: сначала <pre>, потом <code>, как в бывшем dataset.py
+    StrBuf *code = &ps->pre;
+    if (ps->code.len) {
+        if (code->len) strbuf_append_str(code, "\n\n");
+        strbuf_append(code, ps->code.data, ps->code.len);
+    }
+    if (code->len >= 100) {
+        const char *t = title ? title : "Unknown";
+        // Ключ дедупликации — текст ответа, как в бывшем dataset.py
+        strbuf_reset(key);
+        strbuf_append_str(key, "Here is a correct implementation for ");
+        strbuf_append_str(key, t);
+        strbuf_append_str(key, " in C (x86_64 bare-metal):\n\n```c\n");
+        strbuf_append(key, code->data, code->len);
+        strbuf_append_str(key, "\n```");
+        if (build_record(rec, t, code, url, cfg->category) == 0) {
+            unsigned char fp[FPINDEX_FP_SIZE];
+            if (cfg->dedup) fpindex_fingerprint(key->data, key->len, fp);
+            pthread_mutex_lock(&cr->out_lock);
+            if (cfg->dedup && fpindex_seen_fp(cfg->dedup, fp) == 1) {
+                cr->stats.duplicates++;
+            } else if (ds_writer_write(cfg->out, rec->data, rec->len) == 0) {
+                cr->stats.records++;
+                if (cfg->dedup) fpindex_stage_fp(cfg->dedup, fp);
+            }
+            pthread_mutex_unlock(&cr->out_lock);
+        }
+    }
+    free(title);
+}
+
+static void *worker(void *arg) {
+    Crawler *cr = ((void **)arg)[0];
+    int slot = (int)(intptr_t)((void **)arg)[1];
+    PageScan ps = {0};
+    StrBuf rec = {0}, key = {0};
+    Host *h;
+    char *url;
+
+    while ((url = next_url(cr, slot, &h)) != NULL) {
+        strbuf_reset(&ps.pre);
+        strbuf_reset(&ps.code);
+        strbuf_reset(&ps.links);
+        ps.n_links = 0;
+        ps.url = url;
+        if (cr->cfg->robots && !robots_admit(cr, slot, h, url)) continue;
+
+        FetchResult page;
+        if (fetch_cache_get(cr->cfg->cache, url, &page) != 0) {
+            ALOG_RL(ALOG_WARN, 20, "skip", AF_S("reason", "fetch failed"), AF_S("url", url));
+            __atomic_fetch_add(&cr->stats.failed, 1, __ATOMIC_RELAXED);
+        } else {
+            __atomic_fetch_add(&cr->stats.pages, 1, __ATOMIC_RELAXED);
+            if (!page.content_type[0] || strcasestr(page.content_type, "html")) {
+                process_page(cr, url, &page, &ps, &rec, &key);
+            }
+            fetch_result_free(&page);
+        }
+        finish_url(cr, slot, h, url, &ps.links, ps.n_links);
+    }
+    strbuf_free(&ps.pre);
+    strbuf_free(&ps.code);
+    strbuf_free(&ps.links);
+    strbuf_free(&rec);
+    strbuf_free(&key);
+    return NULL;
+}
+
+// === API ===
+
+int crawl_run(const CrawlConfig *cfg_in, CrawlStats *stats) {
+    CrawlConfig cfg = *cfg_in;
+    if (cfg.jobs <= 0) cfg.jobs = CRAWL_DEFAULT_JOBS;
+    if (cfg.host_concurrency <= 0) cfg.host_concurrency = CRAWL_DEFAULT_HOST_CONCURRENCY;
+    if (cfg.delay_ms < 0) cfg.delay_ms = CRAWL_DEFAULT_DELAY_MS;
+    if (!cfg.checkpoint_every) cfg.checkpoint_every = CRAWL_DEFAULT_CHECKPOINT;
+    if (!cfg.category) cfg.category = "OSDev";
+
+    Crawler cr;
+    memset(&cr, 0, sizeof(cr));
+    cr.cfg = &cfg;
+    cr.delay_ns = (int64_t)cfg.delay_ms * 1000000LL;
+    cr.inflight_urls = calloc((size_t)cfg.jobs, sizeof(char *));
+    if (!cr.inflight_urls) return -1;
+    pthread_mutex_init(&cr.lock, NULL);
+    pthread_mutex_init(&cr.out_lock, NULL);
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_cond_init(&cr.cond, &ca);
+    pthread_condattr_destroy(&ca);
+
+    // Хосты затравки — единственные разрешённые (если не any_host)
+    for (size_t i = 0; i < cfg.n_seeds; i++) {
+        char canon[URL_MAX], host_name[CRAWL_MAX_HOST];
+        if (url_canonicalize(cfg.seeds[i], canon, sizeof(canon)) != 0 ||
+            url_host(canon, host_name, sizeof(host_name)) != 0) {
+            fprintf(stderr, "⚠️  crawl: bad seed URL %s\n", cfg.seeds[i]);
+            continue;
+        }
+        if (!host_find(&cr, host_name)) host_add(&cr, host_name);
+    }
+    int resumed = load_state(&cr);
+    if (resumed < 0) fprintf(stderr, "⚠️  crawl: state %s ignored\n", cfg.state_path);
+    for (size_t i = 0; i < cfg.n_seeds; i++) {
+        char canon[URL_MAX];
+        if (url_canonicalize(cfg.seeds[i], canon, sizeof(canon)) == 0) enqueue_locked(&cr, canon, 1);
+    }
+    if (resumed > 0) {
+        printf("   resuming: %zu known URLs, %zu queued, %llu pages done\n",
+               cr.visited.count, cr.queued, (unsigned long long)cr.pages_total);
+    }
+
+    pthread_t *threads = calloc((size_t)cfg.jobs, sizeof(pthread_t));
+    void *(*args)[2] = calloc((size_t)cfg.jobs, sizeof(*args));
+    int started = 0;
+    if (threads && args) {
+        for (; started < cfg.jobs; started++) {
+            args[started][0] = &cr;
+            args[started][1] = (void *)(intptr_t)started;
+            if (pthread_create(&threads[started], NULL, worker, args[started]) != 0) break;
+        }
+    }
+    if (started == 0 && args) {
+        args[0][0] = &cr;
+        args[0][1] = (void *)0;
+        worker(args[0]);
+    }
+    for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+    free(threads);
+    free(args);
+
+    // Очередь опустела — обход закончен, и состояние больше не нужно: иначе
+    // следующий запуск с тем же файлом найдёт все затравки посещёнными и не
+    // скачает ничего. Повторный обход с нуля дешёвый: неизменные страницы
+    // отдаёт кэш (304), известные записи отсекает индекс дедупликации
+    int rc = 0;
+    if (!stop_requested && cr.queued == 0 && cr.in_flight == 0) {
+        if (cfg.state_path && unlink(cfg.state_path) == 0) {
+            printf("   crawl complete: state %s removed\n", cfg.state_path);
+        }
+    } else if ((rc = sync_output(&cr)) != 0 || (rc = save_state_locked(&cr)) != 0) {
+        fprintf(stderr, "⚠️  crawl: cannot save state: %s\n", strerror(errno));
+    }
+
+    cr.stats.queued = cr.queued;
+    cr.stats.visited = cr.visited.count;
+    if (stats) *stats = cr.stats;
+
+    for (size_t h = 0; h < cr.n_hosts; h++) {
+        queue_free(&cr.hosts[h]->queue);
+        free(cr.hosts[h]);
+    }
+    free(cr.hosts);
+    free(cr.host_index);
+    free(cr.visited.slots);
+    free(cr.inflight_urls);
+    pthread_cond_destroy(&cr.cond);
+    pthread_mutex_destroy(&cr.lock);
+    pthread_mutex_destroy(&cr.out_lock);
+    return rc;
+}
@@ -0,0 +1,70 @@
+// crawl.h — обход сайта в ширину (заменяет parser_data/dataset.py)
+//
+// Фронтир — по очереди-кольцу на каждый хост (push/pop за O(1)) и
+// круговой обход хостов. Каждый адрес приводится к канонической форме
+// (url.h) и попадает в множество посещённых по 64-битному хэшу ещё при
+// постановке в очередь, так что дублей в очереди нет. Ссылки собираются
+// тем же проходом по дереву libxml, что и код со страницы. Пул потоков
+// скачивает страницы параллельно, но не больше host_concurrency
+// одновременно на хост и не чаще одного запроса в delay_ms. robots.txt
+// (robots.h) проверяется до загрузки; Crawl-delay хоста, если он больше
+// delay_ms, заменяет его и ограничивает хост одним запросом за раз.
+//
+// Состояние (посещённые + очередь) сохраняется в state_path каждые
+// checkpoint_every страниц и при остановке; следующий запуск с тем же
+// файлом продолжает обход с места остановки. Когда очередь опустела, обход
+// закончен и файл удаляется: следующий запуск обходит сайт заново.
+
+#ifndef CRAWL_H
+#define CRAWL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "fpindex.h"
+#include "fetch_cache.h"
+#include "ds_writer.h"
+#include "robots.h"
+
+#define CRAWL_DEFAULT_JOBS 8           // загрузка упирается в сеть, а не в CPU
+#define CRAWL_DEFAULT_DELAY_MS 500
+#define CRAWL_DEFAULT_HOST_CONCURRENCY 2
+#define CRAWL_DEFAULT_CHECKPOINT 100
+#define CRAWL_STATE_MAGIC "OXCRAWL1"
+
+typedef struct {
+    const char *const *seeds;
+    size_t n_seeds;
+    const char *state_path;    // NULL — без сохранения состояния
+    size_t max_pages;          // 0 — без ограничения (учитываются и прошлые запуски)
+    int jobs;                  // 0 → CRAWL_DEFAULT_JOBS
+    int host_concurrency;      // 0 → CRAWL_DEFAULT_HOST_CONCURRENCY
+    int delay_ms;              // < 0 → CRAWL_DEFAULT_DELAY_MS
+    int any_host;              // 0 — только хосты из seeds
+    size_t checkpoint_every;   // 0 → CRAWL_DEFAULT_CHECKPOINT
+    const char *category;      // metadata.category
+    FetchCache *cache;
+    DsWriter *out;
+    FpIndex *dedup;            // NULL → без дедупликации
+    RobotsCache *robots;       // NULL → robots.txt не учитывается
+} CrawlConfig;
+
+typedef struct {
+    uint64_t pages;            // скачано за этот запуск
+    uint64_t failed;
+    uint64_t records;
+    uint64_t duplicates;
+    uint64_t links;            // ссылок найдено
+    uint64_t enqueued;         // из них новых
+    uint64_t robots_blocked;   // отброшено по robots.txt
+    uint64_t queued;           // осталось в очереди
+    uint64_t visited;          // всего известных адресов
+} CrawlStats;
+
+int crawl_run(const CrawlConfig *cfg, CrawlStats *stats);
+
+// Мягкая остановка (безопасно из обработчика сигнала): текущие страницы
+// дорабатываются, состояние сохраняется
+void crawl_request_stop(void);
+
+#endif // CRAWL_H
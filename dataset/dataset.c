@@ -1,6 +1,28 @@
 // build_osdev_dataset.c
-// gcc -o build_osdev_dataset build_osdev_dataset.c -lcurl -lxml2 -lssl -lcrypto -pthread
-// ./build_osdev_dataset [data_dir] [output.jsonl]
+// gcc -o build_osdev_dataset build_osdev_dataset.c fpindex.c fetch_cache.c json_escape.c ds_writer.c ingest.c normalize.c url.c robots.c crawl.c pars.c relevance.c prompt_store.c pdf.c extract.c metrics.c langid.c ../alog.c -lcurl -lxml2 -lssl -lcrypto -lz -pthread -lm
+//     (+ -DHAVE_ZSTD -lzstd для --compress zstd)
+// ./build_osdev_dataset [--offline] [--compress gzip|zstd] [--shard-records N] [--shard-bytes N] [--direct]
+//                       [--jobs N] [--tree DIR[:CATEGORY]]... [--prompts FILE[:CATEGORY]]
+//                       [--crawl URL]... [--crawl-osdev] [--crawl-state FILE] [--max-pages N]
+//                       [--host-concurrency N] [--delay-ms N] [--crawl-any-host] [--ignore-robots]
+//                       [--lang LIST] [--lang-quota SPEC] [--metrics FILE] [data_dir] [output.jsonl]
+// ./build_osdev_dataset pars [--jobs N] [--strip-tags] [--offline] [--ignore-robots]
+//                            [--lang LIST] [--lang-quota SPEC] [urls.txt] [prompts.jsonl]
+// --crawl: обход в ширину от URL (вместо parser_data/dataset.py); Ctrl+C сохраняет
+// фронтир в --crawl-state (по умолчанию osdev_crawl.state), повторный запуск продолжает
+// pars: пары {"instruction","output"} по ключевым словам из списка URL (вместо pars.sh,
+// вывод тот же; --strip-tags — очистка тегов как в pars.sh без lynx/w3m, для сверки diff)
+// robots.txt (включая Crawl-delay) соблюдается и для sites, и для --crawl; --ignore-robots — нет
+// --prompts: хранилище промптов regex_adder (memory.txt + memory.txt.idx, см. prompt_store.h)
+// Язык записей из sites и --prompts определяется после нормализации (langid.h) и пишется
+// в metadata.lang; --lang en,ru — только эти языки (und — не определён), --lang-quota
+// ru:5000,en:20000 — не больше N записей языка. pars фильтрует так же, но формат строки
+// не меняет. Код (manual, --tree, --crawl) не размечается и не фильтруется
+// С --shard-* вывод режется на <output>-NNNNN.jsonl[.gz|.zst] + <output>.manifest.json
+// Кэш загрузок: $OSDEV_FETCH_CACHE (по умолчанию .fetch_cache), --offline или OSDEV_OFFLINE=1 — только из кэша
+// Индекс дедупликации: $OSDEV_DEDUP_INDEX (по умолчанию osdev_dedup.fpi)
+// В конце печатается время по стадиям (metrics.h), --metrics FILE — то же в JSON;
+// офлайн-замер на сохранённых страницах — bench/pipeline_bench.sh
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -8,15 +30,31 @@
 #include <dirent.h>
 #include <sys/stat.h>
 #include <errno.h>
+#include <signal.h>
 #include <libxml/HTMLparser.h>
 #include <libxml/xpath.h>
 #include <curl/curl.h>
 
+#include "fpindex.h"
+#include "fetch_cache.h"
+#include "json_escape.h"
+#include "ds_writer.h"
+#include "ingest.h"
+#include "normalize.h"
+#include "robots.h"
+#include "crawl.h"
+#include "pars.h"
+#include "prompt_store.h"
+#include "pdf.h"
+#include "extract.h"
+#include "metrics.h"
+#include "langid.h"
+#include "../alog.h"
+
 // === Настройки ===
 #define MAX_PATH 1024
 #define MAX_CONTENT (1024 * 1024)  // 1 MB
-#define ESCAPE_BUF_SIZE (MAX_CONTENT * 6)
-#define MAX_HASHES 10000
+#define MAX_DOCUMENT (32 * 1024 * 1024)  // PDF из sites: стандарты C — десятки MB
 #define MAX_SOURCE_LEN 512
 
 // === Внешние ===
@@ -24,25 +62,13 @@ extern const SiteConfig SITES[];
 extern const size_t SITE_COUNT;
 
 // === Глобальные ===
-static char *seen_hashes[MAX_HASHES] = {0};
-static size_t hash_count = 0;
-
-// === Структуры ===
-typedef struct {
-    char *memory;
-    size_t size;
-} CurlWriteBuffer;
+static FpIndex dedup_index;
+static FetchCache fetch_cache;
+static RobotsCache* robots;  // NULL — --ignore-robots
+static LangFilter lang_filter;
 
 // === Вспомогательные функции ===
 
-void trim_newlines(char *str) {
-    size_t len = strlen(str);
-    while (len > 0 && (str[len - 1] == '\n' || str[len - 1] == '\r')) {
-        str[--len] = '\0';
-    }
-    while (*str == '\n' || *str == '\r') str++;
-}
-
 int ends_with(const char* str, const char* suffix) {
     if (!str || !suffix) return 0;
     size_t len_str = strlen(str);
@@ -56,50 +82,83 @@ int file_exists(const char* path) {
     return (stat(path, &buffer) == 0);
 }
 
-// === SHA256 (упрощённо) ===
-// Предполагается, что compute_sha256() реализован в protocol.h
-// Если нет — можно использовать OpenSSL или встроенный SHA-256 (код ниже опущён для краткости)
-
-// === JSON escaping ===
-void escape_json_string(const char* input, char* output) {
-    const char* src = input;
-    char* dst = output;
-    while (*src) {
-        switch (*src) {
-            case '\"':  strcpy(dst, "\\\""); dst += 2; break;
-            case '\\':  strcpy(dst, "\\\\"); dst += 2; break;
-            case '\b':  strcpy(dst, "\\b");  dst += 2; break;
-            case '\f':  strcpy(dst, "\\f");  dst += 2; break;
-            case '\n':  strcpy(dst, "\\n");  dst += 2; break;
-            case '\r':  strcpy(dst, "\\r");  dst += 2; break;
-            case '\t':  strcpy(dst, "\\t");  dst += 2; break;
-            default:
-                if ((unsigned char)*src < 0x20) {
-                    sprintf(dst, "\\u%04x", (unsigned char)*src);
-                    dst += 6;
-                } else {
-                    *dst++ = *src;
-                }
-        }
-        src++;
+// === Запись записи ===
+// Вся строка собирается в переиспользуемом буфере и уходит в DsWriter целиком.
+// Место в квоте языка уже взято admit_record; отпечаток content (fp от
+// admit_record) откладывается только после записи, а в файл индекса уходит
+// вместе с sync_output. 0 — записана, -1 — ошибка
+static StrBuf record_buf;
+
+int write_record(DsWriter* out, const char* prompt, const char* content, const char* source, const char* category,
+                 LangId lang, const unsigned char fp[FPINDEX_FP_SIZE]) {
+    uint64_t t0 = metrics_ticks();
+    StrBuf* b = &record_buf;
+    strbuf_reset(b);
+    int rc = 0;
+    rc |= strbuf_append_str(b, "{\"messages\":[{\"role\":\"user\",\"content\":\"");
+    rc |= json_escape_append(b, prompt, strlen(prompt));
+    rc |= strbuf_append_str(b, "\"},{\"role\":\"assistant\",\"content\":\"");
+    rc |= json_escape_append(b, content, strlen(content));
+    rc |= strbuf_append_str(b, "\"}],\"metadata\":{\"source\":\"");
+    rc |= json_escape_append(b, source, strlen(source));
+    rc |= strbuf_append_str(b, "\",\"category\":\"");
+    rc |= json_escape_append(b, category, strlen(category));
+    rc |= strbuf_append_str(b, "\",\"lang\":\"");
+    rc |= strbuf_append_str(b, langid_name(lang));
+    rc |= strbuf_append_str(b, "\"}}\n");
+    metrics_record(MET_SERIALIZE, t0, b->len, rc != 0);
+    if (rc == 0) {
+        t0 = metrics_ticks();
+        rc = ds_writer_write(out, b->data, b->len);
+        metrics_record(MET_WRITE, t0, b->len, rc != 0);
     }
-    *dst = '\0';
+    if (rc != 0) {
+        langid_filter_refund(&lang_filter, lang);
+        return -1;
+    }
+    if (fpindex_stage_fp(&dedup_index, fp) != 0)
+        fprintf(stderr, "⚠️  Cannot add to dedup index: %s\n", strerror(errno));
+    return 0;
 }
 
-int is_duplicate(const char *content) {
-    if (!content || !*content) return 1;
-    char *hash = compute_sha256(content);
-    if (!hash) return 0;
-    for (size_t i = 0; i < hash_count; i++) {
-        if (seen_hashes[i] && strcmp(seen_hashes[i], hash) == 0) {
-            free(hash);
-            return 1;
-        }
+// Записи — на диск, затем их отпечатки — в индекс (fpindex.h). Между
+// этапами сборки и в конце: упавший прогон теряет только несинхронизированное
+static int sync_output(DsWriter* out) {
+    if (ds_writer_sync(out) != 0 || fpindex_commit(&dedup_index) != 0) {
+        fprintf(stderr, "⚠️  Cannot sync output and dedup index: %s\n", strerror(errno));
+        return -1;
     }
-    if (hash_count < MAX_HASHES) {
-        seen_hashes[hash_count++] = hash;
-    } else {
-        free(hash);
+    return 0;
+}
+
+// Язык по нормализованному тексту (первые LANGID_MAX_SCAN байт)
+static LangId detect_lang(const char* text, size_t len) {
+    uint64_t t0 = metrics_ticks();
+    size_t scanned = len < LANGID_MAX_SCAN ? len : LANGID_MAX_SCAN;
+    LangId lang = langid_detect(text, len, NULL);
+    metrics_record(MET_LANGID, t0, scanned, lang == LANG_UND);
+    return lang;
+}
+
+// Дедупликация через общий с другими сборщиками индекс (fpindex.h); только
+// проверка — отпечаток в fp, откладывает его write_record
+int is_duplicate(const char *content, unsigned char fp[FPINDEX_FP_SIZE]) {
+    if (!content || !*content) return 1;
+    uint64_t t0 = metrics_ticks();
+    size_t len = strlen(content);
+    fpindex_fingerprint(content, len, fp);
+    int dup = fpindex_seen_fp(&dedup_index, fp) == 1;
+    metrics_record(MET_DEDUP, t0, len, dup);
+    return dup;
+}
+
+// Квота языка, затем дедупликация: запись сверх квоты не попадает в индекс
+// и достанется следующему прогону. 0 — писать, 1 — дубликат, 2 — квота исчерпана
+static int admit_record(const char *content, LangId lang, unsigned char fp[FPINDEX_FP_SIZE]) {
+    if (!langid_filter_take(&lang_filter, lang)) return 2;
+    if (is_duplicate(content, fp)) {
+        langid_filter_refund(&lang_filter, lang);
+        return 1;
     }
     return 0;
 }
@@ -108,10 +167,14 @@ int is_duplicate(const char *content) {
 char* extract_html_content(const char* html, const char* xpath_expr) {
     if (!html || !xpath_expr || !*xpath_expr) return NULL;
 
-    htmlDocPtr doc = htmlReadMemory(html, strlen(html), NULL, NULL,
+    uint64_t t0 = metrics_ticks();
+    size_t html_len = strlen(html);
+    htmlDocPtr doc = htmlReadMemory(html, (int)html_len, NULL, NULL,
                                     HTML_PARSE_RECOVER | HTML_PARSE_NOERROR | HTML_PARSE_NOWARNING);
+    metrics_record(MET_HTML_PARSE, t0, html_len, !doc);
     if (!doc) return NULL;
 
+    t0 = metrics_ticks();
     xmlXPathContextPtr context = xmlXPathNewContext(doc);
     if (!context) {
         xmlFreeDoc(doc);
@@ -120,6 +183,8 @@ char* extract_html_content(const char* html, const char* xpath_expr) {
 
     xmlXPathObjectPtr result = xmlXPathEvalExpression((xmlChar*)xpath_expr, context);
     if (!result || !result->nodesetval) {
+        metrics_record(MET_XPATH, t0, 0, 1);
+        if (result) xmlXPathFreeObject(result);
         xmlXPathFreeContext(context);
         xmlFreeDoc(doc);
         return NULL;
@@ -134,6 +199,7 @@ char* extract_html_content(const char* html, const char* xpath_expr) {
     }
 
     char* output = strdup((char*)xmlBufferContent(buffer));
+    metrics_record(MET_XPATH, t0, output ? strlen(output) : 0, !output);
     xmlBufferFree(buffer);
     xmlXPathFreeObject(result);
     xmlXPathFreeContext(context);
@@ -143,163 +209,497 @@ char* extract_html_content(const char* html, const char* xpath_expr) {
 }
 
 // === Скачивание URL ===
-size_t curl_write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
-    size_t realsize = size * nmemb;
-    CurlWriteBuffer *buf = (CurlWriteBuffer *)userp;
-    char *ptr = realloc(buf->memory, buf->size + realsize + 1);
-    if (!ptr) return 0;
-    buf->memory = ptr;
-    memcpy(&(buf->memory[buf->size]), contents, realsize);
-    buf->size += realsize;
-    buf->memory[buf->size] = 0;
-    return realsize;
-}
-
-int download_url(const char* url, char* buffer, size_t size) {
+// file:// читается напрямую, остальное — через кэш с условными запросами.
+// Буфер — по размеру файла (не больше MAX_DOCUMENT); файл без размера (канал,
+// /proc) или подросший после fstat читается с удвоением буфера
+int download_url(const char* url, FetchResult* res) {
     if (strncmp(url, "file://", 7) == 0) {
+        memset(res, 0, sizeof(*res));
         FILE* f = fopen(url + 7, "rb");
         if (!f) return -1;
-        size_t n = fread(buffer, 1, size - 1, f);
+        struct stat st;
+        size_t cap = fstat(fileno(f), &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0
+                         ? (size_t)st.st_size + 1 : 64 * 1024;   // +1: конец файла виден сразу
+        if (cap > MAX_DOCUMENT - 1) cap = MAX_DOCUMENT - 1;
+        res->body = malloc(cap + 1);
+        if (!res->body) { fclose(f); return -1; }
+        for (;;) {
+            res->size += fread(res->body + res->size, 1, cap - res->size, f);
+            if (res->size < cap || cap == MAX_DOCUMENT - 1) break;
+            size_t grown = cap * 2 < MAX_DOCUMENT - 1 ? cap * 2 : MAX_DOCUMENT - 1;
+            char* body = realloc(res->body, grown + 1);
+            if (!body) break;
+            res->body = body;
+            cap = grown;
+        }
         fclose(f);
-        buffer[n] = '\0';
+        res->body[res->size] = '\0';
+        res->status = FETCH_FRESH;
         return 0;
     }
+    return fetch_cache_get(&fetch_cache, url, res);
+}
 
-    CURL *curl = curl_easy_init();
-    if (!curl) return -1;
-
-    CurlWriteBuffer chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
+// Текст документа по его типу (extract.h); NULL — нечего извлекать
+static char* extract_document(const char* url, const SiteConfig* site, DocKind kind, const FetchResult* page,
+                              int jobs, char** title) {
+    *title = NULL;
+    switch (kind) {
+        case DOC_HTML:
+            *title = site->title_xpath[0] ? extract_html_content(page->body, site->title_xpath) : NULL;
+            return site->content_xpath[0] ? extract_html_content(page->body, site->content_xpath) : NULL;
+        case DOC_PDF: {
+            PdfStats ps;
+            char* text = pdf_extract_text(page->body, page->size, jobs, title, &ps);
+            if (!text) {
+                ALOG_RL(ALOG_WARN, 20, "skip", AF_S("reason", "unreadable PDF"), AF_S("url", url));
+                return NULL;
+            }
+            ALOG(ALOG_INFO, "pdf", AF_S("url", url), AF_U("pages", ps.pages), AF_U("kb", ps.bytes / 1024),
+                 AF_U("pages_failed", ps.pages_failed));
+            return text;
+        }
+        case DOC_MAN:
+            return man_to_text(page->body, page->size, title);
+        case DOC_TEXT:
+            return plain_to_text(page->body, page->size, title);
+        default:
+            ALOG_RL(ALOG_WARN, 20, "skip", AF_S("reason", "unknown content type"),
+                    AF_S("content_type", page->content_type), AF_S("url", url));
+            return NULL;
+    }
+}
 
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, "osdev-dataset-builder/1.0");
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+// Длинный документ (стандарт C — тысячи абзацев) режется на записи
+// не длиннее MAX_CONTENT по последней границе абзаца во второй половине окна
+static size_t part_end(const char* content, size_t pos, size_t len) {
+    if (len - pos <= MAX_CONTENT) return len;
+    const char* lo = content + pos + MAX_CONTENT / 2;
+    const char* hi = content + pos + MAX_CONTENT;
+    const char* cut = NULL;
+    for (const char* p = lo; p + 1 < hi && (p = memchr(p, '\n', (size_t)(hi - p - 1))); p++) {
+        if (p[1] == '\n') cut = p;
+    }
+    if (cut) return (size_t)(cut - content);
+    // Абзаца нет — режем по границе символа UTF-8
+    while (hi > lo && ((unsigned char)*hi & 0xC0) == 0x80) hi--;
+    return (size_t)(hi - content);
+}
 
-    CURLcode res = curl_easy_perform(curl);
-    curl_easy_cleanup(curl);
+static size_t skip_breaks(const char* content, size_t pos, size_t len) {
+    while (pos < len && (content[pos] == '\n' || content[pos] == ' ')) pos++;
+    return pos;
+}
 
-    if (res != CURLE_OK || chunk.size == 0 || chunk.size >= size) {
-        free(chunk.memory);
-        return -1;
+static void write_document(DsWriter* out, const char* url, const char* category, const char* title,
+                           char* content, size_t len, LangId lang, int *record_count) {
+    size_t parts = 0;
+    for (size_t pos = 0; pos < len; parts++) pos = skip_breaks(content, part_end(content, pos, len), len);
+
+    size_t pos = 0;
+    for (size_t part = 1; pos < len; part++) {
+        size_t end = part_end(content, pos, len);
+        char saved = content[end];
+        content[end] = '\0';
+        char* text = content + pos;
+        unsigned char fp[FPINDEX_FP_SIZE];
+        if (end - pos >= 50 && admit_record(text, lang, fp) == 0) {
+            char prompt[2048];
+            char suffix[64] = "";
+            if (parts > 1) snprintf(suffix, sizeof(suffix), " (part %zu/%zu)", part, parts);
+            if (title) {
+                snprintf(prompt, sizeof(prompt), "Explain this %s concept in detail for an OS developer:\n\n%s%s", category, title, suffix);
+            } else {
+                snprintf(prompt, sizeof(prompt), "Explain this %s technical content for an OS developer.%s", category, suffix);
+            }
+            if (write_record(out, prompt, text, url, category, lang, fp) == 0) {
+                (*record_count)++;
+            }
+        }
+        content[end] = saved;
+        pos = skip_breaks(content, end, len);
     }
-
-    strncpy(buffer, chunk.memory, size - 1);
-    buffer[size - 1] = '\0';
-    free(chunk.memory);
-    return 0;
 }
 
 // === Генерация из sites ===
-void process_sites(FILE* out, int *record_count) {
+// Тип документа определяется по ответу: HTML извлекается по XPath из config.h,
+// PDF (страницы параллельно, jobs потоков), текст и man-страницы — целиком
+void process_sites(DsWriter* out, int jobs, int *record_count) {
     for (size_t i = 0; i < SITE_COUNT; i++) {
-        const char* url = SITES[i].url;
-        const char* title_xpath = SITES[i].title_xpath;
-        const char* content_xpath = SITES[i].content_xpath;
-        const char* category = SITES[i].category;
-
-        char raw_html[MAX_CONTENT];
-        if (download_url(url, raw_html, sizeof(raw_html)) != 0) {
-            fprintf(stderr, "⚠️  Skip (download failed): %s\n", url);
+        const SiteConfig* site = &SITES[i];
+        const char* url = site->url;
+        const char* category = site->category;
+
+        if (robots && robots_check(robots, url, 1, NULL) == 0) {
+            ALOG_RL(ALOG_WARN, 20, "skip", AF_S("reason", "robots.txt"), AF_S("url", url));
             continue;
         }
 
-        char* title = title_xpath[0] ? extract_html_content(raw_html, title_xpath) : NULL;
-        char* content = content_xpath[0] ? extract_html_content(raw_html, content_xpath) : NULL;
-
-        if (!content || strlen(content) < 50) {
+        FetchResult page;
+        uint64_t t0 = metrics_ticks();
+        int rc = download_url(url, &page);
+        metrics_record(MET_DOWNLOAD, t0, rc == 0 ? page.size : 0, rc != 0);
+        if (rc != 0) {
+            ALOG_RL(ALOG_WARN, 20, "skip", AF_S("reason", fetch_cache.offline ? "not cached" : "download failed"),
+                    AF_S("url", url));
+            continue;
+        }
+        DocKind kind = doc_sniff(url, page.content_type, page.body, page.size);
+
+        // Страница не менялась — берём прошлый результат извлечения
+        char extract_key[2 * MAX_SOURCE_LEN];
+        if (kind == DOC_HTML) snprintf(extract_key, sizeof(extract_key), "%s\x1f%s", site->title_xpath, site->content_xpath);
+        else snprintf(extract_key, sizeof(extract_key), "%s", doc_kind_name(kind));
+        char* title = NULL;
+        char* content = NULL;
+        if (page.status == FETCH_FRESH ||
+            fetch_cache_load_extract(&fetch_cache, url, extract_key, &title, &content) != 0) {
+            t0 = metrics_ticks();
+            content = extract_document(url, site, kind, &page, jobs, &title);
+            // HTML считается внутри по стадиям html_parse и xpath
+            if (kind != DOC_HTML) metrics_record(MET_EXTRACT, t0, page.size, !content);
+            if (content && strncmp(url, "file://", 7) != 0) {
+                fetch_cache_store_extract(&fetch_cache, url, extract_key, title, content);
+            }
+        }
+        fetch_result_free(&page);
+
+        // Нормализация: пробелы, управляющие символы, битый UTF-8 — за один проход
+        NormStats stats = {0};
+        if (content) {
+            NormOptions opt = { .max_bytes = 0, .keep_paragraphs = 1 };
+            size_t len = strlen(content);
+            t0 = metrics_ticks();
+            text_normalize(content, len, &opt, &stats);
+            metrics_record(MET_NORMALIZE, t0, len, stats.bytes < 50);
+        }
+        if (!content || stats.bytes < 50) {
             free(title); free(content);
             continue;
         }
-
-        // Нормализация
-        trim_newlines(content);
-        if (is_duplicate(content)) {
+        // Язык — один на документ: части длинного документа не переопределяются
+        LangId lang = detect_lang(content, stats.bytes);
+        if (!langid_filter_admit(&lang_filter, lang)) {
+            ALOG_RL(ALOG_WARN, 20, "skip", AF_S("reason", "language"), AF_S("lang", langid_name(lang)),
+                    AF_S("url", url));
             free(title); free(content);
             continue;
         }
-
-        char prompt[2048];
         if (title) {
-            snprintf(prompt, sizeof(prompt), "Explain this %s concept in detail for an OS developer:\n\n%s", category, title);
-            free(title);
-        } else {
-            snprintf(prompt, sizeof(prompt), "Explain this %s technical content for an OS developer.", category);
+            NormOptions opt = { .max_bytes = MAX_SOURCE_LEN, .keep_paragraphs = 0 };
+            text_normalize(title, strlen(title), &opt, NULL);
+            if (!title[0]) { free(title); title = NULL; }
         }
 
-        char esc_prompt[ESCAPE_BUF_SIZE];
-        char esc_content[ESCAPE_BUF_SIZE];
-        escape_json_string(prompt, esc_prompt);
-        escape_json_string(content, esc_content);
-
-        fprintf(out, "{\"messages\":[{\"role\":\"user\",\"content\":\"%s\"},{\"role\":\"assistant\",\"content\":\"%s\"}],\"metadata\":{\"source\":\"%s\",\"category\":\"%s\"}}\n",
-                esc_prompt, esc_content, url, category);
-
-        (*record_count)++;
+        write_document(out, url, category, title, content, stats.bytes, lang, record_count);
+        free(title);
         free(content);
     }
 }
 
 // === Генерация из manual/ ===
-void process_manual_dir(const char* data_dir, FILE* out, int *record_count) {
+// Пары *_prompt.txt / *_example.c ищутся рекурсивно и обрабатываются пулом потоков
+void process_manual_dir(const char* data_dir, DsWriter* out, int jobs, int *record_count) {
     char manual_dir[MAX_PATH];
     snprintf(manual_dir, sizeof(manual_dir), "%s/manual", data_dir);
 
-    DIR* dir = opendir(manual_dir);
-    if (!dir) return;
+    IngestConfig cfg = {
+        .root = manual_dir, .mode = INGEST_PAIRS,
+        .category = "C_OSDEV", .source = "manual",
+        .jobs = jobs, .max_file_size = MAX_CONTENT,
+        .out = out, .dedup = &dedup_index,
+    };
+    IngestStats stats;
+    ingest_run(&cfg, &stats);
+    *record_count += (int)stats.records;
+}
 
-    struct dirent* entry;
-    while ((entry = readdir(dir)) != NULL) {
-        if (strncmp(entry->d_name, ".", 1) == 0) continue;
-        if (!ends_with(entry->d_name, "_prompt.txt")) continue;
+// === Генерация из хранилища промптов ===
+// spec: FILE или FILE:CATEGORY; записи {"instruction","output"} читаются прямо из mmap
+void process_prompt_store(const char* spec, DsWriter* out, int *record_count) {
+    char path[MAX_PATH];
+    snprintf(path, sizeof(path), "%s", spec);
+    const char* category = "Manual";
+    char* colon = strrchr(path, ':');
+    if (colon) { *colon = '\0'; category = colon + 1; }
+
+    PromptStore store;
+    if (prompt_store_open(&store, path) != 0) {
+        fprintf(stderr, "⚠️  Skip %s: %s\n", path,
+                errno == EINVAL ? "old multi-line format, run regex_adder/compact.js" : strerror(errno));
+        return;
+    }
+    StrBuf instruction = {0}, output = {0};
+    size_t records = 0, duplicates = 0, broken = 0, filtered = 0;
+    for (size_t i = 0; i < prompt_store_count(&store); i++) {
+        const char *line, *ins, *outp;
+        size_t line_len, ins_len, out_len;
+        prompt_store_get(&store, i, &line, &line_len);
+        strbuf_reset(&instruction);
+        strbuf_reset(&output);
+        if (json_find_string(line, line_len, "instruction", &ins, &ins_len) != 0 ||
+            json_find_string(line, line_len, "output", &outp, &out_len) != 0 ||
+            json_unescape_append(&instruction, ins, ins_len) != 0 ||
+            json_unescape_append(&output, outp, out_len) != 0 ||
+            strbuf_append(&instruction, "", 1) != 0 || strbuf_append(&output, "", 1) != 0) {
+            broken++;
+            continue;
+        }
+        // Язык разговора — по вопросу; короткий вопрос — по ответу
+        LangId lang = detect_lang(instruction.data, instruction.len - 1);
+        if (lang == LANG_UND) lang = detect_lang(output.data, output.len - 1);
+        if (!langid_filter_admit(&lang_filter, lang)) { filtered++; continue; }
+        unsigned char fp[FPINDEX_FP_SIZE];
+        int admit = admit_record(output.data, lang, fp);
+        if (admit == 1) { duplicates++; continue; }
+        if (admit == 2) { filtered++; continue; }
+        if (write_record(out, instruction.data, output.data, path, category, lang, fp) == 0) records++;
+    }
+    printf("   %s: %zu prompts, %zu records, %zu duplicates, %zu broken, %zu filtered by language\n", path,
+           prompt_store_count(&store), records, duplicates, broken, filtered);
+    strbuf_free(&instruction);
+    strbuf_free(&output);
+    prompt_store_close(&store);
+    *record_count += (int)records;
+}
 
-        char base_name[MAX_PATH];
-        strncpy(base_name, entry->d_name, sizeof(base_name) - 1);
-        char* underscore = strstr(base_name, "_prompt.txt");
-        if (!underscore) continue;
-        *underscore = '\0';
+// === Генерация из локального дерева исходников ===
+// spec: DIR или DIR:CATEGORY (например, локальный checkout linux/samples)
+void process_source_tree(const char* spec, DsWriter* out, int jobs, int *record_count) {
+    char root[MAX_PATH];
+    snprintf(root, sizeof(root), "%s", spec);
+    const char* category = "C";
+    char* colon = strrchr(root, ':');
+    if (colon) { *colon = '\0'; category = colon + 1; }
+
+    IngestConfig cfg = {
+        .root = root, .mode = INGEST_TREE, .category = category,
+        .jobs = jobs, .max_file_size = MAX_CONTENT,
+        .out = out, .dedup = &dedup_index,
+    };
+    IngestStats stats;
+    ingest_run(&cfg, &stats);
+    printf("   %s: %llu files, %llu records, %llu duplicates, %llu skipped, %.1f MB read\n", root,
+           (unsigned long long)stats.files_seen, (unsigned long long)stats.records,
+           (unsigned long long)stats.duplicates, (unsigned long long)stats.skipped,
+           stats.bytes_read / (1024.0 * 1024.0));
+    *record_count += (int)stats.records;
+}
 
-        char prompt_path[MAX_PATH];
-        char example_path[MAX_PATH];
-        snprintf(prompt_path, sizeof(prompt_path), "%s/%s", manual_dir, entry->d_name);
-        snprintf(example_path, sizeof(example_path), "%s/%s_example.c", manual_dir, base_name);
+// === Обход сайтов ===
+static const char* const OSDEV_SEEDS[] = {
+    "https://wiki.osdev.org/Main_Page",
+    "https://wiki.osdev.org/Category:Kernel_Development",
+    "https://wiki.osdev.org/Category:x86-64",
+    "https://wiki.osdev.org/Category:Boot_Sequence",
+    "https://wiki.osdev.org/Category:Memory_Management",
+    "https://wiki.osdev.org/Category:Interrupts",
+    "https://wiki.osdev.org/Category:Hardware",
+};
+
+static void on_sigint(int sig) {
+    (void)sig;
+    crawl_request_stop();
+}
 
-        if (!file_exists(example_path)) continue;
+void process_crawl(CrawlConfig* cfg, DsWriter* out, int *record_count) {
+    cfg->cache = &fetch_cache;
+    cfg->out = out;
+    cfg->dedup = &dedup_index;
+    cfg->robots = robots;
+
+    struct sigaction sa, old;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_sigint;
+    sigaction(SIGINT, &sa, &old);
+    CrawlStats stats;
+    int rc = crawl_run(cfg, &stats);
+    sigaction(SIGINT, &old, NULL);
+
+    printf("   %llu pages (%llu failed), %llu records, %llu duplicates, %llu new links, "
+           "%llu blocked by robots.txt; %llu queued / %llu known URLs%s\n",
+           (unsigned long long)stats.pages, (unsigned long long)stats.failed,
+           (unsigned long long)stats.records, (unsigned long long)stats.duplicates,
+           (unsigned long long)stats.enqueued, (unsigned long long)stats.robots_blocked,
+           (unsigned long long)stats.queued,
+           (unsigned long long)stats.visited, rc == 0 && stats.queued ? " (resume with the same --crawl-state)" : "");
+    *record_count += (int)stats.records;
+}
 
-        char prompt_content[MAX_CONTENT];
-        char example_content[MAX_CONTENT];
-        if (read_file_content(prompt_path, prompt_content, sizeof(prompt_content)) != 0) continue;
-        if (read_file_content(example_path, example_content, sizeof(example_content)) != 0) continue;
+// === Фильтр по языку ===
+// --lang / --lang-quota → lang_filter; 0 или -1 (сообщение уже выведено)
+static int setup_lang_filter(const char* allow, const char* quota) {
+    if (langid_filter_parse(&lang_filter, allow, quota) == 0) return 0;
+    fprintf(stderr, "Error: bad --lang '%s' or --lang-quota '%s' (languages: en ru uk de fr es und)\n",
+            allow ? allow : "", quota ? quota : "");
+    return -1;
+}
 
-        if (is_duplicate(example_content)) continue;
+static void print_lang_summary(void) {
+    char summary[512];
+    langid_filter_summary(&lang_filter, summary, sizeof(summary));
+    if (summary[0]) printf("🗣️  Languages: %s\n", summary);
+}
 
-        char esc_prompt[ESCAPE_BUF_SIZE];
-        char esc_example[ESCAPE_BUF_SIZE];
-        escape_json_string(prompt_content, esc_prompt);
-        escape_json_string(example_content, esc_example);
+// === Режим pars ===
+// argv[0] == "pars"; общий кэш загрузок и индекс дедупликации с основным режимом
+int run_pars(int argc, char* argv[]) {
+    ParsConfig cfg = { .urls_path = "urls.txt", .html = PARS_HTML_LIBXML };
+    const char* output_path = "prompts.jsonl";
+    int offline = -1;
+    int ignore_robots = 0;
+    int positional = 0;
+    const char* lang_allow = NULL;
+    const char* lang_quota = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--offline") == 0) offline = 1;
+        else if (strcmp(argv[i], "--ignore-robots") == 0) ignore_robots = 1;
+        else if (strcmp(argv[i], "--strip-tags") == 0) cfg.html = PARS_HTML_STRIP_TAGS;
+        else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) cfg.jobs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--lang") == 0 && i + 1 < argc) lang_allow = argv[++i];
+        else if (strcmp(argv[i], "--lang-quota") == 0 && i + 1 < argc) lang_quota = argv[++i];
+        else if (positional == 0) { cfg.urls_path = argv[i]; positional++; }
+        else if (positional == 1) { output_path = argv[i]; positional++; }
+    }
+    if (setup_lang_filter(lang_allow, lang_quota) != 0) return 1;
 
-        fprintf(out, "{\"messages\":[{\"role\":\"user\",\"content\":\"%s\"},{\"role\":\"assistant\",\"content\":\"%s\"}],\"metadata\":{\"source\":\"manual\",\"category\":\"C_OSDEV\"}}\n",
-                esc_prompt, esc_example);
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    if (fetch_cache_init(&fetch_cache, NULL, offline) != 0) {
+        fprintf(stderr, "Error: cannot open fetch cache: %s\n", strerror(errno));
+        return 1;
+    }
+    fetch_cache.max_size = MAX_CONTENT - 1;
+    if (!ignore_robots && !(robots = robots_cache_new(&fetch_cache))) {
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+    if (fpindex_open(&dedup_index, NULL) != 0) {
+        fprintf(stderr, "Error: cannot open dedup index '%s': %s\n", fpindex_default_path(), strerror(errno));
+        return 1;
+    }
+    DsWriterConfig wcfg = { .path = output_path, .append = 1 };
+    DsWriter* out = ds_writer_open(&wcfg);
+    if (!out) {
+        fprintf(stderr, "Error: cannot create output file '%s': %s\n", output_path, strerror(errno));
+        return 1;
+    }
 
-        (*record_count)++;
+    cfg.cache = &fetch_cache;
+    cfg.robots = robots;
+    cfg.out = out;
+    cfg.dedup = &dedup_index;
+    cfg.lang = &lang_filter;
+    ParsStats stats;
+    int rc = pars_run(&cfg, &stats);
+    if (rc != 0) {
+        if (errno == ENOMEM) fprintf(stderr, "Error: pars: out of memory\n");
+        else fprintf(stderr, "Error: cannot read URL list '%s': %s\n", cfg.urls_path, strerror(errno));
     }
-    closedir(dir);
+    if (ds_writer_close(out) != 0) {
+        fprintf(stderr, "Error: failed to write '%s': %s\n", output_path, strerror(errno));
+        rc = -1;
+    } else if (fpindex_commit(&dedup_index) != 0) {
+        fprintf(stderr, "Error: cannot update dedup index '%s': %s\n", fpindex_default_path(), strerror(errno));
+        rc = -1;
+    }
+    curl_global_cleanup();
+
+    printf("✅ %llu URLs (%llu failed, %llu blocked by robots.txt): %llu paragraphs, %llu matched, "
+           "%llu records, %llu duplicates → '%s'\n",
+           (unsigned long long)stats.urls, (unsigned long long)stats.failed,
+           (unsigned long long)stats.robots_blocked, (unsigned long long)stats.paragraphs,
+           (unsigned long long)stats.matched, (unsigned long long)stats.records,
+           (unsigned long long)stats.duplicates, output_path);
+    print_lang_summary();
+    fpindex_close(&dedup_index);
+    robots_cache_free(robots);
+    fetch_cache_free(&fetch_cache);
+    return rc == 0 ? 0 : 1;
 }
 
 // === Основная функция ===
 int main(int argc, char* argv[]) {
+    if (argc > 1 && strcmp(argv[1], "pars") == 0) return run_pars(argc - 1, argv + 1);
+
     const char* data_dir = "data";
     const char* output_path = "osdev_dataset.jsonl";
 
-    if (argc >= 2) data_dir = argv[1];
-    if (argc >= 3) output_path = argv[2];
+    int offline = -1;
+    int ignore_robots = 0;
+    int positional = 0;
+    DsWriterConfig wcfg = { .append = 1 };
+    int jobs = 0;
+    const char* trees[64];
+    int tree_count = 0;
+    const char* prompts = NULL;
+    const char* seeds[64];
+    size_t seed_count = 0;
+    CrawlConfig ccfg = { .state_path = "osdev_crawl.state", .delay_ms = -1 };
+    const char* metrics_path = NULL;
+    const char* lang_allow = NULL;
+    const char* lang_quota = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--offline") == 0) offline = 1;
+        else if (strcmp(argv[i], "--direct") == 0) wcfg.direct_io = 1;
+        else if (strcmp(argv[i], "--compress") == 0 && i + 1 < argc) {
+            if (ds_compression_parse(argv[++i], &wcfg.compression) != 0) {
+                fprintf(stderr, "Error: unknown compression '%s'\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--shard-records") == 0 && i + 1 < argc) wcfg.shard_records = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--shard-bytes") == 0 && i + 1 < argc) wcfg.shard_bytes = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) jobs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--tree") == 0 && i + 1 < argc) {
+            if (tree_count < (int)(sizeof(trees) / sizeof(trees[0]))) trees[tree_count++] = argv[++i];
+            else i++;
+        }
+        else if (strcmp(argv[i], "--prompts") == 0 && i + 1 < argc) prompts = argv[++i];
+        else if (strcmp(argv[i], "--crawl") == 0 && i + 1 < argc) {
+            if (seed_count < sizeof(seeds) / sizeof(seeds[0])) seeds[seed_count++] = argv[++i];
+            else i++;
+        }
+        else if (strcmp(argv[i], "--crawl-osdev") == 0) {
+            for (size_t k = 0; k < sizeof(OSDEV_SEEDS) / sizeof(OSDEV_SEEDS[0]) && seed_count < sizeof(seeds) / sizeof(seeds[0]); k++)
+                seeds[seed_count++] = OSDEV_SEEDS[k];
+        }
+        else if (strcmp(argv[i], "--crawl-state") == 0 && i + 1 < argc) ccfg.state_path = argv[++i];
+        else if (strcmp(argv[i], "--max-pages") == 0 && i + 1 < argc) ccfg.max_pages = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--host-concurrency") == 0 && i + 1 < argc) ccfg.host_concurrency = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--delay-ms") == 0 && i + 1 < argc) ccfg.delay_ms = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--crawl-any-host") == 0) ccfg.any_host = 1;
+        else if (strcmp(argv[i], "--ignore-robots") == 0) ignore_robots = 1;
+        else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) metrics_path = argv[++i];
+        else if (strcmp(argv[i], "--lang") == 0 && i + 1 < argc) lang_allow = argv[++i];
+        else if (strcmp(argv[i], "--lang-quota") == 0 && i + 1 < argc) lang_quota = argv[++i];
+        else if (positional == 0) { data_dir = argv[i]; positional++; }
+        else if (positional == 1) { output_path = argv[i]; positional++; }
+    }
+    if (setup_lang_filter(lang_allow, lang_quota) != 0) return 1;
 
+    metrics_init();
     curl_global_init(CURL_GLOBAL_DEFAULT);
 
-    FILE* out = fopen(output_path, "w");
+    if (fetch_cache_init(&fetch_cache, NULL, offline) != 0) {
+        fprintf(stderr, "Error: cannot open fetch cache: %s\n", strerror(errno));
+        return 1;
+    }
+    fetch_cache.max_size = MAX_CONTENT - 1;
+    if (!ignore_robots && !(robots = robots_cache_new(&fetch_cache))) {
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+
+    if (fpindex_open(&dedup_index, NULL) != 0) {
+        fprintf(stderr, "Error: cannot open dedup index '%s': %s\n", fpindex_default_path(), strerror(errno));
+        return 1;
+    }
+    uint64_t known_before = fpindex_count(&dedup_index);
+
+    // Дописываем: всё, что уже есть в индексе, лежит в предыдущих прогонах
+    // (шарды продолжают нумерацию по манифесту)
+    wcfg.path = output_path;
+    DsWriter* out = ds_writer_open(&wcfg);
     if (!out) {
         fprintf(stderr, "Error: cannot create output file '%s': %s\n", output_path, strerror(errno));
         return 1;
@@ -309,16 +709,61 @@ int main(int argc, char* argv[]) {
 
     // 1. Обработка сайтов из config.h
     printf("🌐 Downloading and parsing %zu sites...\n", SITE_COUNT);
-    process_sites(out, &record_count);
+    fetch_cache.max_size = MAX_DOCUMENT - 1;
+    process_sites(out, jobs, &record_count);
+    fetch_cache.max_size = MAX_CONTENT - 1;
+    sync_output(out);
 
     // 2. Обработка ручных примеров
     printf("📂 Processing manual examples...\n");
-    process_manual_dir(data_dir, out, &record_count);
+    process_manual_dir(data_dir, out, jobs, &record_count);
+    if (prompts) process_prompt_store(prompts, out, &record_count);
+    sync_output(out);
+
+    // 3. Локальные деревья исходников
+    if (tree_count > 0) printf("🌲 Ingesting %d source tree(s)...\n", tree_count);
+    for (int i = 0; i < tree_count; i++) {
+        process_source_tree(trees[i], out, jobs, &record_count);
+        sync_output(out);
+    }
 
-    fclose(out);
+    // 4. Обход сайтов в ширину
+    if (seed_count > 0) {
+        printf("🕸️  Crawling from %zu seed URL(s)...\n", seed_count);
+        ccfg.seeds = seeds;
+        ccfg.n_seeds = seed_count;
+        process_crawl(&ccfg, out, &record_count);
+    }
+
+    uint64_t bytes_written = ds_writer_bytes(out);
+    if (ds_writer_close(out) != 0) {
+        fprintf(stderr, "Error: failed to write '%s': %s\n", output_path, strerror(errno));
+        return 1;
+    }
+    if (fpindex_commit(&dedup_index) != 0) {
+        fprintf(stderr, "Error: cannot update dedup index '%s': %s\n", fpindex_default_path(), strerror(errno));
+        return 1;
+    }
     curl_global_cleanup();
 
     printf("✅ Dataset written to '%s'\n", output_path);
-    printf("📊 Total records: %d\n", record_count);
-    return 0;
+    printf("📊 Total records: %d (%llu bytes)\n", record_count, (unsigned long long)bytes_written);
+    printf("🧮 Dedup index: %llu fingerprints (+%llu this run)\n",
+           (unsigned long long)fpindex_count(&dedup_index),
+           (unsigned long long)(fpindex_count(&dedup_index) - known_before));
+    printf("🗄️  Fetch cache: %zu hits, %zu misses, %zu bytes downloaded%s\n",
+           fetch_cache.hits, fetch_cache.misses, fetch_cache.bytes_downloaded,
+           fetch_cache.offline ? " (offline)" : "");
+    print_lang_summary();
+    metrics_print(stdout);
+    int rc = 0;
+    if (metrics_path && metrics_dump_json(metrics_path) != 0) {
+        fprintf(stderr, "Error: cannot write metrics '%s': %s\n", metrics_path, strerror(errno));
+        rc = 1;
+    }
+    fpindex_close(&dedup_index);
+    robots_cache_free(robots);
+    fetch_cache_free(&fetch_cache);
+    strbuf_free(&record_buf);
+    return rc;
 }
\ No newline at end of file
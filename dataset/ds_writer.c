@@ -0,0 +1,438 @@
+// ds_writer.c — буферизованный JSONL-писатель (см. ds_writer.h)
+
+#define _GNU_SOURCE
+#include "ds_writer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#define DSW_ALIGN 4096
+
+struct DsWriter {
+    DsWriterConfig cfg;
+    char *prefix;              // путь без расширения (для шардов и манифеста)
+    const char *ext;
+    int sharded;
+
+    int fd;
+    int direct;
+    unsigned char *buf;        // несжатые записи
+    size_t buf_len;
+    size_t buf_cap;
+    unsigned char *zout;       // выход компрессора
+    size_t zout_cap;
+
+    z_stream zs;
+    int z_active;
+#ifdef HAVE_ZSTD
+    ZSTD_CStream *zc;
+#endif
+
+    DsShardInfo cur;
+    DsShardInfo *shards;
+    size_t shard_count;
+    size_t shard_cap;
+
+    uint64_t total_records;
+    uint64_t total_bytes;
+    int failed;
+};
+
+// === Вспомогательные функции ===
+
+static const char *compression_name(DsCompression c) {
+    switch (c) {
+        case DSW_COMPRESS_GZIP: return "gzip";
+        case DSW_COMPRESS_ZSTD: return "zstd";
+        default: return "none";
+    }
+}
+
+int ds_compression_parse(const char *name, DsCompression *out) {
+    if (!name || strcmp(name, "none") == 0) { *out = DSW_COMPRESS_NONE; return 0; }
+    if (strcmp(name, "gzip") == 0 || strcmp(name, "gz") == 0) { *out = DSW_COMPRESS_GZIP; return 0; }
+    if (strcmp(name, "zstd") == 0 || strcmp(name, "zst") == 0) { *out = DSW_COMPRESS_ZSTD; return 0; }
+    return -1;
+}
+
+static char *strip_suffixes(const char *path) {
+    char *p = strdup(path);
+    if (!p) return NULL;
+    static const char *suffixes[] = { ".gz", ".zst", ".jsonl" };
+    for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); i++) {
+        size_t lp = strlen(p), ls = strlen(suffixes[i]);
+        if (lp > ls && strcmp(p + lp - ls, suffixes[i]) == 0) p[lp - ls] = '\0';
+    }
+    return p;
+}
+
+static const char *base_name(const char *path) {
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+static int write_all(DsWriter *w, const void *data, size_t len) {
+    const unsigned char *p = data;
+    while (len > 0) {
+        ssize_t n = write(w->fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            w->failed = 1;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+        w->cur.stored_bytes += (uint64_t)n;
+    }
+    return 0;
+}
+
+// === Компрессия ===
+
+static int codec_begin(DsWriter *w) {
+    switch (w->cfg.compression) {
+        case DSW_COMPRESS_GZIP: {
+            memset(&w->zs, 0, sizeof(w->zs));
+            int level = w->cfg.level ? w->cfg.level : Z_DEFAULT_COMPRESSION;
+            // 15 + 16 — zlib пишет gzip-заголовок
+            if (deflateInit2(&w->zs, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) return -1;
+            w->z_active = 1;
+            return 0;
+        }
+        case DSW_COMPRESS_ZSTD:
+#ifdef HAVE_ZSTD
+            w->zc = ZSTD_createCStream();
+            if (!w->zc) return -1;
+            if (ZSTD_isError(ZSTD_initCStream(w->zc, w->cfg.level ? w->cfg.level : 3))) return -1;
+            return 0;
+#else
+            fprintf(stderr, "ds_writer: built without zstd (rebuild with -DHAVE_ZSTD -lzstd)\n");
+            return -1;
+#endif
+        default:
+            return 0;
+    }
+}
+
+enum { FEED_CONTINUE, FEED_SYNC, FEED_FINISH };
+
+// Прогоняет len байт из buf через кодек; FEED_SYNC — вытолкнуть всё сжатое
+// без закрытия потока, FEED_FINISH — завершить поток
+static int codec_feed(DsWriter *w, const unsigned char *data, size_t len, int mode) {
+    int finish = mode == FEED_FINISH;
+    if (w->cfg.compression == DSW_COMPRESS_GZIP) {
+        w->zs.next_in = (Bytef *)data;
+        w->zs.avail_in = (uInt)len;
+        int flush = finish ? Z_FINISH : mode == FEED_SYNC ? Z_SYNC_FLUSH : Z_NO_FLUSH;
+        int rc;
+        do {
+            w->zs.next_out = w->zout;
+            w->zs.avail_out = (uInt)w->zout_cap;
+            rc = deflate(&w->zs, flush);
+            if (rc == Z_STREAM_ERROR) return -1;
+            if (write_all(w, w->zout, w->zout_cap - w->zs.avail_out) != 0) return -1;
+        } while (w->zs.avail_out == 0 || (finish && rc != Z_STREAM_END));
+        return 0;
+    }
+#ifdef HAVE_ZSTD
+    if (w->cfg.compression == DSW_COMPRESS_ZSTD) {
+        ZSTD_inBuffer in = { data, len, 0 };
+        ZSTD_EndDirective directive = finish ? ZSTD_e_end : mode == FEED_SYNC ? ZSTD_e_flush : ZSTD_e_continue;
+        size_t remaining;
+        do {
+            ZSTD_outBuffer out = { w->zout, w->zout_cap, 0 };
+            remaining = ZSTD_compressStream2(w->zc, &out, &in, directive);
+            if (ZSTD_isError(remaining)) return -1;
+            if (write_all(w, w->zout, out.pos) != 0) return -1;
+        } while (mode != FEED_CONTINUE ? remaining != 0 : in.pos < in.size);
+        return 0;
+    }
+#endif
+    return -1;
+}
+
+static void codec_end(DsWriter *w) {
+    if (w->z_active) {
+        deflateEnd(&w->zs);
+        w->z_active = 0;
+    }
+#ifdef HAVE_ZSTD
+    if (w->zc) {
+        ZSTD_freeCStream(w->zc);
+        w->zc = NULL;
+    }
+#endif
+}
+
+// === Сброс буфера ===
+
+static int flush_buffer(DsWriter *w, int final) {
+    if (w->cfg.compression != DSW_COMPRESS_NONE) {
+        int rc = codec_feed(w, w->buf, w->buf_len, final ? FEED_FINISH : FEED_CONTINUE);
+        w->buf_len = 0;
+        return rc;
+    }
+
+    size_t len = w->buf_len;
+    if (w->direct) {
+        // O_DIRECT принимает только кратные блоку записи; хвост дописываем без него
+        size_t aligned = len & ~(size_t)(DSW_ALIGN - 1);
+        if (aligned && write_all(w, w->buf, aligned) != 0) return -1;
+        size_t rest = len - aligned;
+        if (rest && final) {
+            int flags = fcntl(w->fd, F_GETFL);
+            fcntl(w->fd, F_SETFL, flags & ~O_DIRECT);
+            w->direct = 0;
+            if (write_all(w, w->buf + aligned, rest) != 0) return -1;
+            rest = 0;
+        }
+        memmove(w->buf, w->buf + aligned, rest);
+        w->buf_len = rest;
+        return 0;
+    }
+
+    if (len && write_all(w, w->buf, len) != 0) return -1;
+    w->buf_len = 0;
+    return 0;
+}
+
+// === Шарды и манифест ===
+
+// 0 или -1, если путь не влез: обрезанное имя попало бы в манифест
+static int shard_path(const DsWriter *w, size_t index, char *out, size_t size) {
+    int n = w->sharded ? snprintf(out, size, "%s-%05zu%s", w->prefix, index, w->ext)
+                       : snprintf(out, size, "%s", w->cfg.path);
+    return n >= 0 && (size_t)n < size ? 0 : -1;
+}
+
+// current — ещё открытый шард (после ds_writer_sync) или NULL
+static int write_manifest(DsWriter *w, const DsShardInfo *current) {
+    char path[DSW_MAX_PATH], tmp[DSW_MAX_PATH + 8];
+    int n = snprintf(path, sizeof(path), "%s.manifest.json", w->prefix);
+    if (n < 0 || (size_t)n >= sizeof(path)) return -1;
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *f = fopen(tmp, "w");
+    if (!f) return -1;
+
+    size_t count = w->shard_count + (current != NULL);
+    uint64_t records = 0, bytes = 0;
+    for (size_t i = 0; i < count; i++) {
+        const DsShardInfo *s = i < w->shard_count ? &w->shards[i] : current;
+        records += s->records;
+        bytes += s->bytes;
+    }
+    fprintf(f, "{\n  \"format\": \"jsonl\",\n  \"compression\": \"%s\",\n", compression_name(w->cfg.compression));
+    fprintf(f, "  \"records\": %llu,\n  \"bytes\": %llu,\n  \"shards\": [\n",
+            (unsigned long long)records, (unsigned long long)bytes);
+    // Одна строка на шард — так манифест легко дочитать при следующем запуске
+    for (size_t i = 0; i < count; i++) {
+        const DsShardInfo *s = i < w->shard_count ? &w->shards[i] : current;
+        fprintf(f, "    {\"file\": \"%s\", \"records\": %llu, \"bytes\": %llu, \"stored_bytes\": %llu}%s\n",
+                s->name, (unsigned long long)s->records, (unsigned long long)s->bytes,
+                (unsigned long long)s->stored_bytes, i + 1 < count ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    if (fclose(f) != 0) { unlink(tmp); return -1; }
+    return rename(tmp, path);
+}
+
+static int push_shard(DsWriter *w, const DsShardInfo *info) {
+    if (w->shard_count == w->shard_cap) {
+        size_t cap = w->shard_cap ? w->shard_cap * 2 : 16;
+        DsShardInfo *p = realloc(w->shards, cap * sizeof(*p));
+        if (!p) return -1;
+        w->shards = p;
+        w->shard_cap = cap;
+    }
+    w->shards[w->shard_count++] = *info;
+    return 0;
+}
+
+static void load_manifest(DsWriter *w) {
+    char path[DSW_MAX_PATH];
+    int n = snprintf(path, sizeof(path), "%s.manifest.json", w->prefix);
+    if (n < 0 || (size_t)n >= sizeof(path)) return;
+    FILE *f = fopen(path, "r");
+    if (!f) return;
+    char line[DSW_MAX_PATH + 128];
+    while (fgets(line, sizeof(line), f)) {
+        DsShardInfo s = {0};
+        unsigned long long r, b, sb;
+        // %1023 — DSW_MAX_PATH - 1
+        if (sscanf(line, " {\"file\": \"%1023[^\"]\", \"records\": %llu, \"bytes\": %llu, \"stored_bytes\": %llu}",
+                   s.name, &r, &b, &sb) == 4) {
+            s.records = r;
+            s.bytes = b;
+            s.stored_bytes = sb;
+            if (push_shard(w, &s) != 0) break;
+        }
+    }
+    fclose(f);
+}
+
+static int open_shard(DsWriter *w) {
+    char path[DSW_MAX_PATH];
+    if (shard_path(w, w->shard_count, path, sizeof(path)) != 0) return -1;
+    if (w->sharded && w->shard_count >= DSW_MAX_SHARDS) return -1;
+
+    int flags = O_WRONLY | O_CREAT | (w->cfg.append && !w->sharded ? O_APPEND : O_TRUNC);
+    w->direct = 0;
+    w->fd = -1;
+    if (w->cfg.direct_io && w->cfg.compression == DSW_COMPRESS_NONE) {
+        struct stat st;
+        int aligned_tail = !(w->cfg.append && !w->sharded) ||
+                           stat(path, &st) != 0 || st.st_size % DSW_ALIGN == 0;
+        if (aligned_tail) {
+            w->fd = open(path, flags | O_DIRECT, 0644);
+            if (w->fd >= 0) w->direct = 1;  // tmpfs и др. дают EINVAL — тогда обычный open
+        }
+    }
+    if (w->fd < 0) w->fd = open(path, flags, 0644);
+    if (w->fd < 0) return -1;
+
+    memset(&w->cur, 0, sizeof(w->cur));
+    snprintf(w->cur.name, sizeof(w->cur.name), "%s", base_name(path));
+    return codec_begin(w);
+}
+
+static int close_shard(DsWriter *w) {
+    if (w->fd < 0) return 0;
+    int rc = flush_buffer(w, 1);
+    // Закрытый шард целиком на диске: после него пишутся манифест и отпечатки
+    if (rc == 0 && w->cur.records && fdatasync(w->fd) != 0) rc = -1;
+    codec_end(w);
+    if (close(w->fd) != 0) rc = -1;
+    w->fd = -1;
+    if (w->sharded && w->cur.records == 0) {
+        // Пустой шард (ничего не записали) в манифест не попадает
+        char path[DSW_MAX_PATH];
+        if (shard_path(w, w->shard_count, path, sizeof(path)) == 0) unlink(path);
+    } else if (w->sharded) {
+        if (push_shard(w, &w->cur) != 0) rc = -1;
+        if (write_manifest(w, NULL) != 0) rc = -1;
+    }
+    return rc;
+}
+
+// === API ===
+
+DsWriter *ds_writer_open(const DsWriterConfig *cfg) {
+    DsWriter *w = calloc(1, sizeof(*w));
+    if (!w) return NULL;
+    w->cfg = *cfg;
+    w->fd = -1;
+    w->sharded = cfg->shard_records || cfg->shard_bytes;
+    w->prefix = strip_suffixes(cfg->path);
+    switch (cfg->compression) {
+        case DSW_COMPRESS_GZIP: w->ext = ".jsonl.gz"; break;
+        case DSW_COMPRESS_ZSTD: w->ext = ".jsonl.zst"; break;
+        default: w->ext = ".jsonl"; break;
+    }
+
+    size_t cap = cfg->buffer_size ? cfg->buffer_size : DSW_DEFAULT_BUFFER;
+    cap = (cap + DSW_ALIGN - 1) & ~(size_t)(DSW_ALIGN - 1);
+    void *buf = NULL;
+    if (!w->prefix || posix_memalign(&buf, DSW_ALIGN, cap) != 0) {
+        free(w->prefix);
+        free(w);
+        return NULL;
+    }
+    w->buf = buf;
+    w->buf_cap = cap;
+    if (cfg->compression != DSW_COMPRESS_NONE) {
+        w->zout_cap = cap;
+        w->zout = malloc(w->zout_cap);
+    }
+
+    if (w->sharded) load_manifest(w);
+    if ((cfg->compression != DSW_COMPRESS_NONE && !w->zout) || open_shard(w) != 0) {
+        codec_end(w);
+        if (w->fd >= 0) close(w->fd);
+        free(w->zout);
+        free(w->buf);
+        free(w->shards);
+        free(w->prefix);
+        free(w);
+        return NULL;
+    }
+    return w;
+}
+
+int ds_writer_write(DsWriter *w, const char *line, size_t len) {
+    if (w->failed) return -1;
+    int newline = len == 0 || line[len - 1] != '\n';
+    uint64_t rec_bytes = len + (size_t)newline;
+
+    // Переход на следующий шард, если текущий заполнен
+    if (w->sharded && w->cur.records > 0 &&
+        ((w->cfg.shard_records && w->cur.records >= w->cfg.shard_records) ||
+         (w->cfg.shard_bytes && w->cur.bytes + rec_bytes > w->cfg.shard_bytes))) {
+        if (close_shard(w) != 0 || open_shard(w) != 0) { w->failed = 1; return -1; }
+    }
+
+    while (len > 0) {
+        size_t n = w->buf_cap - w->buf_len;
+        if (n > len) n = len;
+        memcpy(w->buf + w->buf_len, line, n);
+        w->buf_len += n;
+        line += n;
+        len -= n;
+        if (w->buf_len == w->buf_cap && flush_buffer(w, 0) != 0) return -1;
+    }
+    if (newline) {
+        if (w->buf_len == w->buf_cap && flush_buffer(w, 0) != 0) return -1;
+        w->buf[w->buf_len++] = '\n';
+    }
+
+    w->cur.records++;
+    w->cur.bytes += rec_bytes;
+    w->total_records++;
+    w->total_bytes += rec_bytes;
+    return 0;
+}
+
+int ds_writer_sync(DsWriter *w) {
+    if (w->failed) return -1;
+    if (w->cur.records == 0) return 0;
+    int rc;
+    if (w->cfg.compression != DSW_COMPRESS_NONE) {
+        rc = codec_feed(w, w->buf, w->buf_len, FEED_SYNC);
+        w->buf_len = 0;
+    } else {
+        rc = flush_buffer(w, 1);   // хвост, не кратный блоку, — уже без O_DIRECT
+    }
+    if (rc == 0 && fdatasync(w->fd) != 0) rc = -1;
+    // Открытый шард — в манифест, иначе следующий запуск начал бы его заново
+    if (rc == 0 && w->sharded && write_manifest(w, &w->cur) != 0) rc = -1;
+    if (rc != 0) w->failed = 1;
+    return rc;
+}
+
+int ds_writer_close(DsWriter *w) {
+    if (!w) return 0;
+    int rc = close_shard(w);
+    if (w->failed) rc = -1;
+    free(w->zout);
+    free(w->buf);
+    free(w->shards);
+    free(w->prefix);
+    free(w);
+    return rc;
+}
+
+uint64_t ds_writer_records(const DsWriter *w) {
+    return w->total_records;
+}
+
+uint64_t ds_writer_bytes(const DsWriter *w) {
+    return w->total_bytes;
+}
@@ -0,0 +1,63 @@
+// ds_writer.h — буферизованный JSONL-писатель с сжатием и шардированием
+//
+// Записи копятся в большом буфере и уходят на диск крупными write(2).
+// Опционально: потоковое сжатие gzip (zlib) или zstd (при сборке с
+// -DHAVE_ZSTD -lzstd), O_DIRECT для несжатого вывода, нарезка на шарды
+// по числу записей или байтам. При шардировании рядом пишется манифест
+// <prefix>.manifest.json; повторный запуск продолжает нумерацию шардов.
+
+#ifndef DS_WRITER_H
+#define DS_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DSW_DEFAULT_BUFFER (4u * 1024 * 1024)
+#define DSW_MAX_SHARDS 65536
+#define DSW_MAX_PATH 1024         // путь шарда или манифеста вместе с '\0'
+
+typedef enum {
+    DSW_COMPRESS_NONE = 0,
+    DSW_COMPRESS_GZIP,
+    DSW_COMPRESS_ZSTD
+} DsCompression;
+
+typedef struct {
+    const char *path;          // итоговый файл (без шардов) или префикс шардов
+    DsCompression compression;
+    int level;                 // 0 → уровень по умолчанию для кодека
+    uint64_t shard_records;    // 0 → без ограничения
+    uint64_t shard_bytes;      // по несжатым байтам, 0 → без ограничения
+    size_t buffer_size;        // 0 → DSW_DEFAULT_BUFFER
+    int direct_io;             // O_DIRECT для несжатого вывода
+    int append;                // без шардов: дописывать в существующий файл
+} DsWriterConfig;
+
+typedef struct {
+    char name[DSW_MAX_PATH];
+    uint64_t records;
+    uint64_t bytes;            // несжатые
+    uint64_t stored_bytes;     // на диске
+} DsShardInfo;
+
+typedef struct DsWriter DsWriter;
+
+DsWriter *ds_writer_open(const DsWriterConfig *cfg);
+// line — одна JSON-запись, перевод строки добавляется, если его нет
+int ds_writer_write(DsWriter *w, const char *line, size_t len);
+// Всё записанное до вызова — на диске (fdatasync): после этого можно
+// сохранять то, что ссылается на записи, — отпечатки (fpindex_commit),
+// состояние обхода. Сжатый поток сбрасывается без закрытия, O_DIRECT после
+// первого неровного хвоста выключается, открытый шард вносится в манифест
+// (упавший процесс оставит его недописанным, но учтённым). 0 или -1
+int ds_writer_sync(DsWriter *w);
+// Сбрасывает буферы, закрывает шард, пишет манифест. 0 или -1.
+int ds_writer_close(DsWriter *w);
+
+uint64_t ds_writer_records(const DsWriter *w);
+uint64_t ds_writer_bytes(const DsWriter *w);
+
+// "gzip" / "zstd" / "none" → DsCompression; -1 если не распознано
+int ds_compression_parse(const char *name, DsCompression *out);
+
+#endif // DS_WRITER_H
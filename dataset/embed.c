@@ -0,0 +1,121 @@
+// embed.c — эмбеддинги через llama (см. embed.h)
+
+#include "embed.h"
+#include "annindex.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+struct Embedder {
+    struct llama_model *model;
+    struct llama_context *ctx;
+    const struct llama_vocab *vocab;
+    struct llama_batch batch;
+    llama_token *tokens;
+    int n_ctx;
+    int dim;
+    int encoder_only;          // BERT-подобные: llama_encode вместо decode
+};
+
+Embedder *embedder_open(const char *model_path, int n_ctx, int n_threads) {
+    Embedder *e = calloc(1, sizeof(*e));
+    if (!e) return NULL;
+    e->model = llama_model_load_from_file(model_path, llama_model_default_params());
+    if (!e->model) {
+        fprintf(stderr, "embed: failed to load %s\n", model_path);
+        free(e);
+        return NULL;
+    }
+    e->vocab = llama_model_get_vocab(e->model);
+    e->dim = llama_model_n_embd(e->model);
+    e->encoder_only = llama_model_has_encoder(e->model) && !llama_model_has_decoder(e->model);
+
+    if (n_ctx <= 0) n_ctx = EMBED_DEFAULT_CTX;
+    int train_ctx = llama_model_n_ctx_train(e->model);
+    if (train_ctx > 0 && n_ctx > train_ctx) n_ctx = train_ctx;
+    e->n_ctx = n_ctx;
+
+    struct llama_context_params cp = llama_context_default_params();
+    cp.embeddings = true;
+    cp.n_ctx = (uint32_t)n_ctx;
+    // у неказуальных моделей весь текст должен попасть в один ubatch
+    cp.n_batch = (uint32_t)n_ctx;
+    cp.n_ubatch = (uint32_t)n_ctx;
+    cp.n_seq_max = 1;
+    if (n_threads > 0) {
+        cp.n_threads = n_threads;
+        cp.n_threads_batch = n_threads;
+    }
+    e->ctx = llama_init_from_model(e->model, cp);
+    e->tokens = malloc((size_t)n_ctx * sizeof(llama_token));
+    if (!e->ctx || !e->tokens) {
+        fprintf(stderr, "embed: context init failed\n");
+        embedder_close(e);
+        return NULL;
+    }
+    if (llama_pooling_type(e->ctx) == LLAMA_POOLING_TYPE_NONE)
+        fprintf(stderr, "embed: model has no pooling, using the last token\n");
+    e->batch = llama_batch_init(n_ctx, 0, 1);
+    return e;
+}
+
+void embedder_close(Embedder *e) {
+    if (!e) return;
+    if (e->batch.token) llama_batch_free(e->batch);
+    if (e->ctx) llama_free(e->ctx);
+    if (e->model) llama_model_free(e->model);
+    free(e->tokens);
+    free(e);
+}
+
+int embedder_dim(const Embedder *e) {
+    return e->dim;
+}
+
+int embedder_embed(Embedder *e, const char *text, size_t len, float *out, int *truncated) {
+    if (truncated) *truncated = 0;
+    if (len > INT32_MAX) return -1;
+    int32_t n = llama_tokenize(e->vocab, text, (int32_t)len, e->tokens, e->n_ctx, true, false);
+    if (n < 0) {
+        // не поместилось: токенизируем целиком и берём начало
+        if (n == INT32_MIN) return -1;
+        llama_token *all = malloc((size_t)-n * sizeof(llama_token));
+        if (!all) return -1;
+        int32_t m = llama_tokenize(e->vocab, text, (int32_t)len, all, -n, true, false);
+        if (m < 0) {
+            free(all);
+            return -1;
+        }
+        n = e->n_ctx;
+        memcpy(e->tokens, all, (size_t)n * sizeof(llama_token));
+        // EOS/SEP в конце оригинала — часть формата ввода модели
+        if (m > n && llama_vocab_get_add_eos(e->vocab)) e->tokens[n - 1] = all[m - 1];
+        free(all);
+        if (truncated) *truncated = 1;
+    }
+    if (n == 0) return -1;
+
+    struct llama_batch *b = &e->batch;
+    b->n_tokens = n;
+    for (int32_t i = 0; i < n; i++) {
+        b->token[i] = e->tokens[i];
+        b->pos[i] = i;
+        b->n_seq_id[i] = 1;
+        b->seq_id[i][0] = 0;
+        b->logits[i] = 1;
+    }
+    // прошлый текст не должен остаться в KV-кэше
+    llama_memory_t mem = llama_get_memory(e->ctx);
+    if (mem) llama_memory_clear(mem, true);
+    int rc = e->encoder_only ? llama_encode(e->ctx, *b) : llama_decode(e->ctx, *b);
+    if (rc != 0) return -1;
+
+    const float *emb = llama_pooling_type(e->ctx) == LLAMA_POOLING_TYPE_NONE
+        ? llama_get_embeddings_ith(e->ctx, n - 1)
+        : llama_get_embeddings_seq(e->ctx, 0);
+    if (!emb) return -1;
+    memcpy(out, emb, (size_t)e->dim * sizeof(float));
+    return ann_normalize(out, (size_t)e->dim) == 0 ? n : -1;
+}
@@ -0,0 +1,31 @@
+// embed.h — эмбеддинги текста GGUF-моделью эмбеддингов (bge, e5, nomic, …)
+//
+// Один контекст llama в режиме embeddings; пулинг — тот, что записан в
+// модели (mean/cls/last). Текст длиннее контекста обрезается по токенам:
+// чанки для индекса лучше резать chunk_dataset тем же словарём и с
+// --tokens не больше контекста. Вектор на выходе нормирован.
+// llama_backend_init вызывает владелец процесса (bot.c, ann.c).
+// Не потокобезопасен: контекст один.
+
+#ifndef EMBED_H
+#define EMBED_H
+
+#include <stddef.h>
+
+#include "../llama.cpp/include/llama.h"
+
+#define EMBED_DEFAULT_CTX 512
+
+typedef struct Embedder Embedder;
+
+// n_ctx 0 → EMBED_DEFAULT_CTX (но не больше обучающего контекста модели)
+Embedder *embedder_open(const char *model_path, int n_ctx, int n_threads);
+void embedder_close(Embedder *e);
+
+int embedder_dim(const Embedder *e);
+
+// out — embedder_dim() чисел; число использованных токенов или -1.
+// *truncated = 1, если текст не поместился в контекст
+int embedder_embed(Embedder *e, const char *text, size_t len, float *out, int *truncated);
+
+#endif // EMBED_H
@@ -0,0 +1,421 @@
+// extract.c — определение типа документа и текст из man/plain (см. extract.h)
+
+#define _GNU_SOURCE
+#include "extract.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+
+#include "json_escape.h"
+#include "pdf.h"
+
+#define SNIFF_BYTES 4096
+#define TITLE_MAX 200
+
+static int has_prefix_ci(const char *s, const char *prefix) {
+    return strncasecmp(s, prefix, strlen(prefix)) == 0;
+}
+
+// Расширение последнего сегмента пути без query и fragment
+static void url_extension(const char *url, char *ext, size_t cap) {
+    ext[0] = '\0';
+    if (!url) return;
+    size_t end = strcspn(url, "?#");
+    const char *seg = url;
+    for (size_t i = 0; i < end; i++) if (url[i] == '/') seg = url + i + 1;
+    const char *dot = NULL;
+    for (const char *p = seg; p < url + end; p++) if (*p == '.') dot = p;
+    if (!dot || (size_t)(url + end - dot - 1) >= cap) return;
+    size_t n = (size_t)(url + end - dot - 1);
+    for (size_t i = 0; i < n; i++) ext[i] = (char)tolower((unsigned char)dot[1 + i]);
+    ext[n] = '\0';
+}
+
+// Признаки troff: макросы man/mdoc в начале строк
+static int looks_like_troff(const char *body, size_t n) {
+    static const char *const macros[] = { ".TH ", ".SH ", ".Dd ", ".Dt ", ".Sh ", "'\\\"", ".\\\"" };
+    int hits = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (i > 0 && body[i - 1] != '\n') continue;
+        for (size_t k = 0; k < sizeof(macros) / sizeof(macros[0]); k++) {
+            size_t ml = strlen(macros[k]);
+            if (i + ml <= n && memcmp(body + i, macros[k], ml) == 0) hits++;
+        }
+    }
+    return hits >= 2;
+}
+
+static int looks_like_text(const char *body, size_t n) {
+    size_t bad = 0;
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = (unsigned char)body[i];
+        if (c == 0) return 0;
+        if (c < 0x20 && c != '\n' && c != '\r' && c != '\t' && c != '\f' && c != '\b') bad++;
+    }
+    return bad * 100 <= n;
+}
+
+DocKind doc_sniff(const char *url, const char *content_type, const char *body, size_t size) {
+    size_t n = size < SNIFF_BYTES ? size : SNIFF_BYTES;
+    if (!body || size == 0) return DOC_UNKNOWN;
+    if (pdf_sniff(body, size)) return DOC_PDF;
+    if (n >= 2 && (unsigned char)body[0] == 0x1f && (unsigned char)body[1] == 0x8b) return DOC_UNKNOWN;
+
+    const char *ct = content_type ? content_type : "";
+    while (*ct == ' ') ct++;
+    if (has_prefix_ci(ct, "application/pdf")) return DOC_PDF;
+    if (has_prefix_ci(ct, "text/html") || has_prefix_ci(ct, "application/xhtml")) return DOC_HTML;
+    if (has_prefix_ci(ct, "text/troff") || has_prefix_ci(ct, "application/x-troff")) return DOC_MAN;
+
+    char ext[16];
+    url_extension(url, ext, sizeof(ext));
+    if (strcmp(ext, "pdf") == 0) return DOC_PDF;   // тело без сигнатуры — пусть pdf.c откажет
+    if (strcmp(ext, "html") == 0 || strcmp(ext, "htm") == 0 || strcmp(ext, "xhtml") == 0) return DOC_HTML;
+    if (!looks_like_text(body, n)) return DOC_UNKNOWN;
+    if (looks_like_troff(body, n) ||
+        (ext[0] >= '1' && ext[0] <= '9' && (ext[1] == '\0' || isalpha((unsigned char)ext[1])) && body[0] == '.')) {
+        return DOC_MAN;
+    }
+    if (has_prefix_ci(ct, "text/plain") || strcmp(ext, "txt") == 0 || strcmp(ext, "md") == 0) return DOC_TEXT;
+
+    size_t i = 0;
+    while (i < n && isspace((unsigned char)body[i])) i++;
+    if (i < n && body[i] == '<') return DOC_HTML;
+    return DOC_TEXT;
+}
+
+const char *doc_kind_name(DocKind kind) {
+    switch (kind) {
+        case DOC_HTML: return "html";
+        case DOC_PDF: return "pdf";
+        case DOC_TEXT: return "text";
+        case DOC_MAN: return "man";
+        default: return "unknown";
+    }
+}
+
+// === Общее ===
+
+// Забой из отформатированных страниц: "X\bX" (жирный) и "_\bX" (подчёркнутый) → "X"
+static void strip_overstrike(StrBuf *b) {
+    size_t w = 0;
+    for (size_t r = 0; r < b->len; r++) {
+        if (b->data[r] == '\b') {
+            if (w > 0) {
+                // Многобайтный UTF-8 символ перед забоем удаляется целиком
+                do w--; while (w > 0 && ((unsigned char)b->data[w] & 0xC0) == 0x80);
+            }
+            continue;
+        }
+        b->data[w++] = b->data[r];
+    }
+    b->len = w;
+}
+
+static char *first_line_title(const char *text, size_t len) {
+    const char *p = text, *end = text + len;
+    while (p < end) {
+        const char *eol = memchr(p, '\n', (size_t)(end - p));
+        if (!eol) eol = end;
+        const char *s = p, *e = eol;
+        while (s < e && isspace((unsigned char)*s)) s++;
+        while (e > s && isspace((unsigned char)e[-1])) e--;
+        if (e > s) {
+            size_t n = (size_t)(e - s) < TITLE_MAX ? (size_t)(e - s) : TITLE_MAX;
+            return strndup(s, n);
+        }
+        p = eol + 1;
+    }
+    return NULL;
+}
+
+static char *finish(StrBuf *b) {
+    if (strbuf_append(b, "", 1) != 0) {
+        strbuf_free(b);
+        return NULL;
+    }
+    return b->data;
+}
+
+char *plain_to_text(const char *body, size_t size, char **title) {
+    StrBuf b = {0};
+    if (title) *title = NULL;
+    if (strbuf_append(&b, body, size) != 0) return NULL;
+    for (size_t i = 0; i < b.len; i++) if (b.data[i] == '\0') b.data[i] = ' ';
+    strip_overstrike(&b);
+    if (title) *title = first_line_title(b.data, b.len);
+    return finish(&b);
+}
+
+// === troff ===
+
+// Именованные символы \(xx и \[xx], встречающиеся в man-страницах
+static const struct { const char *name; const char *text; } SPECIALS[] = {
+    {"em", "\xe2\x80\x94"}, {"en", "\xe2\x80\x93"}, {"hy", "-"}, {"mi", "-"}, {"bu", "\xe2\x80\xa2"},
+    {"co", "\xc2\xa9"}, {"rg", "\xc2\xae"}, {"tm", "\xe2\x84\xa2"}, {"aq", "'"}, {"dq", "\""},
+    {"lq", "\xe2\x80\x9c"}, {"rq", "\xe2\x80\x9d"}, {"oq", "\xe2\x80\x98"}, {"cq", "\xe2\x80\x99"},
+    {"ha", "^"}, {"ti", "~"}, {"rs", "\\"}, {"sl", "/"}, {"ba", "|"}, {"or", "|"}, {"at", "@"},
+    {"sh", "#"}, {"Do", "$"}, {"lB", "["}, {"rB", "]"}, {"lC", "{"}, {"rC", "}"}, {"la", "<"},
+    {"ra", ">"}, {"<=", "\xe2\x89\xa4"}, {">=", "\xe2\x89\xa5"}, {"!=", "\xe2\x89\xa0"}, {"==", "=="},
+    {"->", "\xe2\x86\x92"}, {"<-", "\xe2\x86\x90"}, {"mu", "\xc3\x97"}, {"de", "\xc2\xb0"},
+    {"aa", "\xc2\xb4"}, {"ga", "`"}, {"ua", "\xe2\x86\x91"}, {"da", "\xe2\x86\x93"},
+    {"Fo", "\xc2\xab"}, {"Fc", "\xc2\xbb"}, {"pl", "+"}, {"eq", "="}, {"sc", "\xc2\xa7"},
+};
+
+static int put_special(StrBuf *b, const char *name, size_t len) {
+    for (size_t i = 0; i < sizeof(SPECIALS) / sizeof(SPECIALS[0]); i++) {
+        if (strlen(SPECIALS[i].name) == len && memcmp(SPECIALS[i].name, name, len) == 0)
+            return strbuf_append_str(b, SPECIALS[i].text);
+    }
+    return 0;
+}
+
+// Имя после \( / \[ / \*( / \f( и т.п.: одна буква, "(xx" или "[имя]";
+// возвращает позицию после имени
+static size_t escape_name(const char *s, size_t i, size_t len, const char **name, size_t *name_len) {
+    *name = s + i;
+    *name_len = 0;
+    if (i >= len) return i;
+    if (s[i] == '(') {
+        *name = s + i + 1;
+        *name_len = i + 3 <= len ? 2 : len - i - 1;
+        return i + 1 + *name_len;
+    }
+    if (s[i] == '[') {
+        const char *close = memchr(s + i, ']', len - i);
+        if (!close) return len;
+        *name = s + i + 1;
+        *name_len = (size_t)(close - s - i - 1);
+        return (size_t)(close - s) + 1;
+    }
+    *name_len = 1;
+    return i + 1;
+}
+
+// Строка текста с раскрытыми escape-последовательностями; шрифты и размеры выбрасываются
+static int put_troff_text(StrBuf *b, const char *s, size_t len) {
+    int rc = 0;
+    for (size_t i = 0; i < len && rc == 0;) {
+        if (s[i] != '\\') {
+            size_t j = i;
+            while (j < len && s[j] != '\\') j++;
+            rc = strbuf_append(b, s + i, j - i);
+            i = j;
+            continue;
+        }
+        if (++i >= len) break;
+        char c = s[i++];
+        const char *name;
+        size_t nl;
+        switch (c) {
+            case '"': case '#': return 0;  // комментарий до конца строки
+            case '-': rc = strbuf_append(b, "-", 1); break;
+            case 'e': case '\\': rc = strbuf_append(b, "\\", 1); break;
+            case ' ': case '0': case '~': rc = strbuf_append(b, " ", 1); break;
+            case 't': rc = strbuf_append(b, "\t", 1); break;
+            case '\'': rc = strbuf_append(b, "'", 1); break;
+            case '`': rc = strbuf_append(b, "`", 1); break;
+            case '.': rc = strbuf_append(b, ".", 1); break;
+            case '(': case '[':
+                i = escape_name(s, i - 1, len, &name, &nl);
+                rc = put_special(b, name, nl);
+                break;
+            case '*':
+                i = escape_name(s, i, len, &name, &nl);
+                if (nl == 1 && name[0] == 'R') rc = strbuf_append_str(b, "\xc2\xae");
+                else if (nl == 2 && (memcmp(name, "lq", 2) == 0 || memcmp(name, "rq", 2) == 0)) rc = put_special(b, name, nl);
+                break;
+            case 'f': case 'n': case 'F': case 'm': case 'g': case 'k': case 'M': case 'Y': case 'V':
+                i = escape_name(s, i, len, &name, &nl);
+                break;
+            case 's':
+                if (i < len && (s[i] == '+' || s[i] == '-')) i++;
+                if (i < len && (s[i] == '(' || s[i] == '[')) i = escape_name(s, i, len, &name, &nl);
+                else while (i < len && isdigit((unsigned char)s[i])) i++;
+                break;
+            case 'h': case 'v': case 'w': case 'o': case 'l': case 'L': case 'D': case 'x': case 'X': case 'b':
+            case 'A': case 'B': case 'C': case 'N': case 'R': case 'Z':
+                // \h'…' и подобные: аргумент в кавычках
+                if (i < len) {
+                    char q = s[i];
+                    const char *close = i + 1 < len ? memchr(s + i + 1, q, len - i - 1) : NULL;
+                    i = close ? (size_t)(close - s) + 1 : len;
+                }
+                break;
+            default:
+                // \& \| \^ \% \c \/ \, \: \) \{ \} — без видимого текста
+                break;
+        }
+    }
+    return rc;
+}
+
+// Аргументы макроса: через пробелы, "в кавычках" — один аргумент ("" внутри — кавычка)
+static size_t split_args(const char *s, size_t len, const char **argv, size_t *argl, size_t max, char *quoted) {
+    size_t n = 0, i = 0;
+    while (n < max) {
+        while (i < len && (s[i] == ' ' || s[i] == '\t')) i++;
+        if (i >= len) break;
+        if (s[i] == '"') {
+            size_t start = ++i;
+            while (i < len && !(s[i] == '"' && !(i + 1 < len && s[i + 1] == '"'))) i += s[i] == '"' ? 2 : 1;
+            argv[n] = s + start;
+            argl[n] = (i < len ? i : len) - start;
+            quoted[n++] = 1;
+            if (i < len) i++;
+        } else {
+            size_t start = i;
+            while (i < len && s[i] != ' ' && s[i] != '\t') i++;
+            argv[n] = s + start;
+            argl[n] = i - start;
+            quoted[n++] = 0;
+        }
+    }
+    return n;
+}
+
+static int put_arg(StrBuf *b, const char *a, size_t len, char quoted) {
+    if (!quoted) return put_troff_text(b, a, len);
+    // "" внутри кавычек — одна кавычка
+    int rc = 0;
+    for (size_t i = 0; i < len && rc == 0;) {
+        size_t j = i;
+        while (j < len && a[j] != '"') j++;
+        rc = put_troff_text(b, a + i, j - i);
+        if (j < len && rc == 0) { rc = strbuf_append(b, "\"", 1); j += 2; }
+        i = j;
+    }
+    return rc;
+}
+
+// mdoc: слова-макросы внутри строки (Fl, Ar, Nm…) сами текста не дают
+static int is_mdoc_macro(const char *a, size_t len) {
+    return (len == 2 || len == 3) && isupper((unsigned char)a[0]) && islower((unsigned char)a[1]) &&
+           (len == 2 || islower((unsigned char)a[2]));
+}
+
+static void paragraph(StrBuf *b) {
+    while (b->len > 0 && (b->data[b->len - 1] == ' ' || b->data[b->len - 1] == '\n')) b->len--;
+    if (b->len > 0) strbuf_append(b, "\n\n", 2);
+}
+
+static void line_break(StrBuf *b) {
+    if (b->len > 0 && b->data[b->len - 1] != '\n') strbuf_append(b, "\n", 1);
+}
+
+#define MAN_MAX_ARGS 16
+
+char *man_to_text(const char *body, size_t size, char **title) {
+    StrBuf b = {0};
+    const char *p = body, *end = body + size;
+    const char *skip_until = NULL;   // .de / .ig — до ".." (или указанного терминатора)
+    if (title) *title = NULL;
+
+    while (p < end) {
+        const char *eol = memchr(p, '\n', (size_t)(end - p));
+        if (!eol) eol = end;
+        const char *line = p;
+        size_t len = (size_t)(eol - p);
+        p = eol + 1;
+        if (len > 0 && line[len - 1] == '\r') len--;
+
+        if (skip_until) {
+            size_t sl = strlen(skip_until);
+            if (len >= sl && memcmp(line, skip_until, sl) == 0) skip_until = NULL;
+            continue;
+        }
+        if (len == 0) {
+            paragraph(&b);
+            continue;
+        }
+        if (line[0] != '.' && line[0] != '\'') {
+            put_troff_text(&b, line, len);
+            strbuf_append(&b, "\n", 1);
+            continue;
+        }
+
+        // Запрос: .XX аргументы
+        size_t i = 1;
+        while (i < len && (line[i] == ' ' || line[i] == '\t')) i++;
+        size_t ms = i;
+        while (i < len && line[i] != ' ' && line[i] != '\t') i++;
+        const char *m = line + ms;
+        size_t ml = i - ms;
+        const char *argv[MAN_MAX_ARGS];
+        size_t argl[MAN_MAX_ARGS];
+        char quoted[MAN_MAX_ARGS];
+        size_t argc = split_args(line + i, len - i, argv, argl, MAN_MAX_ARGS, quoted);
+#define IS(s) (ml == sizeof(s) - 1 && memcmp(m, s, ml) == 0)
+
+        if (ml == 0 || (ml >= 2 && m[0] == '\\' && m[1] == '"')) {
+            continue;
+        } else if (IS("TH") || IS("Dt")) {
+            if (title && !*title && argc >= 1) {
+                StrBuf t = {0};
+                put_arg(&t, argv[0], argl[0], quoted[0]);
+                if (argc >= 2) {
+                    strbuf_append(&t, "(", 1);
+                    put_arg(&t, argv[1], argl[1], quoted[1]);
+                    strbuf_append(&t, ")", 1);
+                }
+                *title = finish(&t);
+            }
+        } else if (IS("SH") || IS("SS") || IS("Sh") || IS("Ss")) {
+            paragraph(&b);
+            for (size_t k = 0; k < argc; k++) {
+                if (k) strbuf_append(&b, " ", 1);
+                put_arg(&b, argv[k], argl[k], quoted[k]);
+            }
+            paragraph(&b);
+        } else if (IS("PP") || IS("P") || IS("LP") || IS("sp") || IS("Pp") || IS("HP") ||
+                   IS("TP") || IS("Bl") || IS("El") || IS("Bd") || IS("Ed")) {
+            paragraph(&b);
+        } else if (IS("IP") || IS("It")) {
+            // Метка пункта списка — отдельной строкой
+            paragraph(&b);
+            if (argc > 0 && !(IS("IP") && argl[0] == 0)) {
+                for (size_t k = 0; k < (IS("IP") ? 1 : argc); k++) {
+                    if (IS("It") && is_mdoc_macro(argv[k], argl[k]) && !quoted[k]) continue;
+                    if (b.len && b.data[b.len - 1] != '\n' && b.data[b.len - 1] != ' ') strbuf_append(&b, " ", 1);
+                    put_arg(&b, argv[k], argl[k], quoted[k]);
+                }
+                line_break(&b);
+            }
+        } else if (IS("br")) {
+            line_break(&b);
+        } else if (IS("B") || IS("I") || IS("SM") || IS("SB")) {
+            for (size_t k = 0; k < argc; k++) {
+                if (k) strbuf_append(&b, " ", 1);
+                put_arg(&b, argv[k], argl[k], quoted[k]);
+            }
+            strbuf_append(&b, "\n", 1);
+        } else if (ml == 2 && strchr("BIR", m[0]) && strchr("BIR", m[1]) && m[0] != m[1]) {
+            // Чередование шрифтов: аргументы склеиваются без пробелов
+            for (size_t k = 0; k < argc; k++) put_arg(&b, argv[k], argl[k], quoted[k]);
+            strbuf_append(&b, "\n", 1);
+        } else if (IS("de") || IS("de1") || IS("am") || IS("ig")) {
+            skip_until = "..";
+        } else if (IS("Nm") || IS("Nd") || IS("Fl") || IS("Ar") || IS("Xr") || IS("Fn") || IS("Ft") ||
+                   IS("Fa") || IS("Fd") || IS("In") || IS("Va") || IS("Dv") || IS("Er") || IS("Ev") ||
+                   IS("Pa") || IS("Em") || IS("Sy") || IS("Li") || IS("Ql") || IS("Dq") || IS("Sq") ||
+                   IS("Pq") || IS("Cm") || IS("Ic") || IS("Op") || IS("Ta")) {
+            // mdoc: аргументы — текст, вложенные макросы опускаются
+            if (IS("Nd")) strbuf_append_str(&b, "\xe2\x80\x94 ");
+            size_t first = b.len;
+            for (size_t k = 0; k < argc; k++) {
+                if (!quoted[k] && is_mdoc_macro(argv[k], argl[k])) continue;
+                if (b.len > first) strbuf_append(&b, " ", 1);
+                put_arg(&b, argv[k], argl[k], quoted[k]);
+            }
+            strbuf_append(&b, "\n", 1);
+        }
+        // Остальные запросы (.nf, .fi, .RS, .RE, .in, .ft, .ds, .if …) текста не дают
+#undef IS
+    }
+    strip_overstrike(&b);
+    char *text = finish(&b);
+    if (text && title && !*title) *title = first_line_title(text, strlen(text));
+    return text;
+}
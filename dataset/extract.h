@@ -0,0 +1,31 @@
+// extract.h — выбор извлекателя по типу документа
+//
+// Тип определяется по сигнатуре тела ("%PDF-", разметка), затем по
+// Content-Type ответа и расширению в URL. HTML разбирает libxml по XPath
+// из config.h (dataset.c), PDF — pdf.h, а простой текст и man-страницы
+// (troff или уже отформатированные, с забоем) переводятся в текст
+// напрямую и дальше идут в text_normalize.
+
+#ifndef EXTRACT_H
+#define EXTRACT_H
+
+#include <stddef.h>
+
+typedef enum {
+    DOC_UNKNOWN = 0,
+    DOC_HTML,
+    DOC_PDF,
+    DOC_TEXT,
+    DOC_MAN,
+} DocKind;
+
+// content_type может быть NULL или пустым (file://, старый кэш)
+DocKind doc_sniff(const char *url, const char *content_type, const char *body, size_t size);
+const char *doc_kind_name(DocKind kind);
+
+// malloc-строка текста или NULL; *title — malloc или NULL
+// (имя(раздел) из .TH / первая непустая строка)
+char *man_to_text(const char *body, size_t size, char **title);
+char *plain_to_text(const char *body, size_t size, char **title);
+
+#endif // EXTRACT_H
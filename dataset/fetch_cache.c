@@ -0,0 +1,346 @@
+// fetch_cache.c — кэш загрузок с ETag/Last-Modified (см. fetch_cache.h)
+
+#include "fetch_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <curl/curl.h>
+#include <openssl/sha.h>
+
+#define EXTRACT_MAGIC "OXEX1\n"
+#define NO_TITLE UINT64_MAX
+
+typedef struct {
+    char etag[FETCH_MAX_HEADER];
+    char last_modified[FETCH_MAX_HEADER];
+    char content_type[FETCH_MAX_HEADER];
+} CacheMeta;
+
+typedef struct {
+    char *memory;
+    size_t size;
+    size_t limit;
+} ResponseBuffer;
+
+// === Пути и файлы ===
+
+static void entry_path(const FetchCache *cache, const char *url, const char *ext,
+                       char *out, size_t out_size) {
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    SHA256((const unsigned char *)url, strlen(url), digest);
+    char hex[SHA256_DIGEST_LENGTH * 2 + 1];
+    for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) {
+        sprintf(hex + i * 2, "%02x", digest[i]);
+    }
+    snprintf(out, out_size, "%s/%s.%s", cache->dir, hex, ext);
+}
+
+static char *read_whole_file(const char *path, size_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    if (fseek(f, 0, SEEK_END) != 0) { fclose(f); return NULL; }
+    long len = ftell(f);
+    rewind(f);
+    if (len < 0) { fclose(f); return NULL; }
+    char *data = malloc((size_t)len + 1);
+    if (!data) { fclose(f); return NULL; }
+    size_t n = fread(data, 1, (size_t)len, f);
+    fclose(f);
+    data[n] = '\0';
+    if (size) *size = n;
+    return data;
+}
+
+// Запись через временный файл + rename, чтобы не оставлять половинчатых записей
+static int write_atomic(const char *path, const void *const *parts, const size_t *sizes, int n) {
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.tmp.%ld", path, (long)getpid());
+    FILE *f = fopen(tmp, "wb");
+    if (!f) return -1;
+    for (int i = 0; i < n; i++) {
+        if (sizes[i] && fwrite(parts[i], 1, sizes[i], f) != sizes[i]) {
+            fclose(f);
+            unlink(tmp);
+            return -1;
+        }
+    }
+    if (fclose(f) != 0 || rename(tmp, path) != 0) {
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+static int load_meta(const FetchCache *cache, const char *url, CacheMeta *meta) {
+    memset(meta, 0, sizeof(*meta));
+    char path[4096];
+    entry_path(cache, url, "meta", path, sizeof(path));
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    char line[FETCH_MAX_HEADER + 32];
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char *tab = strchr(line, '\t');
+        if (!tab) continue;
+        *tab++ = '\0';
+        if (strcmp(line, "etag") == 0) snprintf(meta->etag, sizeof(meta->etag), "%s", tab);
+        else if (strcmp(line, "last_modified") == 0) snprintf(meta->last_modified, sizeof(meta->last_modified), "%s", tab);
+        else if (strcmp(line, "content_type") == 0) snprintf(meta->content_type, sizeof(meta->content_type), "%s", tab);
+    }
+    fclose(f);
+    return 0;
+}
+
+static int store_entry(const FetchCache *cache, const char *url, const CacheMeta *meta,
+                       const char *body, size_t size) {
+    char path[4096];
+    entry_path(cache, url, "body", path, sizeof(path));
+    const void *body_parts[] = { body };
+    size_t body_sizes[] = { size };
+    if (write_atomic(path, body_parts, body_sizes, 1) != 0) return -1;
+
+    char text[FETCH_MAX_HEADER * 3 + 4096];
+    int len = snprintf(text, sizeof(text), "url\t%s\netag\t%s\nlast_modified\t%s\ncontent_type\t%s\n",
+                       url, meta->etag, meta->last_modified, meta->content_type);
+    if (len < 0 || (size_t)len >= sizeof(text)) return -1;
+    entry_path(cache, url, "meta", path, sizeof(path));
+    const void *meta_parts[] = { text };
+    size_t meta_sizes[] = { (size_t)len };
+    return write_atomic(path, meta_parts, meta_sizes, 1);
+}
+
+// === HTTP ===
+
+static size_t on_body(void *contents, size_t size, size_t nmemb, void *userp) {
+    size_t realsize = size * nmemb;
+    ResponseBuffer *buf = (ResponseBuffer *)userp;
+    if (buf->limit && buf->size + realsize > buf->limit) return 0;
+    char *ptr = realloc(buf->memory, buf->size + realsize + 1);
+    if (!ptr) return 0;
+    buf->memory = ptr;
+    memcpy(&(buf->memory[buf->size]), contents, realsize);
+    buf->size += realsize;
+    buf->memory[buf->size] = 0;
+    return realsize;
+}
+
+// whole: значение не обрезается — не влезло, остаётся пустым. Обрезанный
+// валидатор (ETag, Last-Modified) хуже отсутствующего: условный запрос с
+// ним не совпадёт и вернёт 200 там, где был бы 304
+static void copy_header_value(char *dst, size_t dst_size, const char *value, size_t len, int whole) {
+    while (len > 0 && (*value == ' ' || *value == '\t')) { value++; len--; }
+    while (len > 0 && (value[len - 1] == '\r' || value[len - 1] == '\n' || value[len - 1] == ' ')) len--;
+    if (len >= dst_size) {
+        if (whole) len = 0;
+        else len = dst_size - 1;
+    }
+    memcpy(dst, value, len);
+    dst[len] = '\0';
+}
+
+static size_t on_header(char *line, size_t size, size_t nitems, void *userp) {
+    size_t len = size * nitems;
+    CacheMeta *meta = (CacheMeta *)userp;
+    // Новый ответ в цепочке редиректов — забываем заголовки предыдущего
+    if (len >= 5 && strncmp(line, "HTTP/", 5) == 0) {
+        memset(meta, 0, sizeof(*meta));
+        return len;
+    }
+    static const struct { const char *name; size_t off; int whole; } wanted[] = {
+        { "etag:", offsetof(CacheMeta, etag), 1 },
+        { "last-modified:", offsetof(CacheMeta, last_modified), 1 },
+        { "content-type:", offsetof(CacheMeta, content_type), 0 },
+    };
+    for (size_t i = 0; i < sizeof(wanted) / sizeof(wanted[0]); i++) {
+        size_t n = strlen(wanted[i].name);
+        if (len > n && strncasecmp(line, wanted[i].name, n) == 0) {
+            copy_header_value((char *)meta + wanted[i].off, FETCH_MAX_HEADER, line + n, len - n, wanted[i].whole);
+            break;
+        }
+    }
+    return len;
+}
+
+static int perform(FetchCache *cache, const char *url, const CacheMeta *cond,
+                   ResponseBuffer *body, CacheMeta *meta, long *http_code) {
+    CURL *curl = curl_easy_init();
+    if (!curl) return -1;
+
+    struct curl_slist *headers = NULL;
+    // Не влезшее значение — без условного заголовка: лучше лишний 200, чем
+    // запрос с обрезанным валидатором
+    char line[sizeof("If-Modified-Since: ") + FETCH_MAX_HEADER];
+    int n;
+    if (cond && cond->etag[0] &&
+        (n = snprintf(line, sizeof(line), "If-None-Match: %s", cond->etag)) > 0 && (size_t)n < sizeof(line)) {
+        headers = curl_slist_append(headers, line);
+    }
+    if (cond && cond->last_modified[0] &&
+        (n = snprintf(line, sizeof(line), "If-Modified-Since: %s", cond->last_modified)) > 0 &&
+        (size_t)n < sizeof(line)) {
+        headers = curl_slist_append(headers, line);
+    }
+
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, on_body);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)body);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, on_header);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, (void *)meta);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, cache->user_agent);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, cache->timeout);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);  // таймауты без SIGALRM — можно из потоков
+    if (headers) curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+
+    CURLcode res = curl_easy_perform(curl);
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, http_code);
+    curl_slist_free_all(headers);
+    curl_easy_cleanup(curl);
+    return res == CURLE_OK ? 0 : -1;
+}
+
+// === API ===
+
+int fetch_cache_init(FetchCache *cache, const char *dir, int offline) {
+    memset(cache, 0, sizeof(*cache));
+    if (!dir) {
+        const char *env = getenv(FETCH_CACHE_ENV);
+        dir = (env && *env) ? env : FETCH_CACHE_DEFAULT_DIR;
+    }
+    if (offline < 0) {
+        const char *env = getenv(FETCH_OFFLINE_ENV);
+        offline = (env && *env && strcmp(env, "0") != 0);
+    }
+    cache->dir = strdup(dir);
+    if (!cache->dir) return -1;
+    cache->offline = offline;
+    cache->user_agent = "osdev-dataset-builder/1.0";
+    cache->timeout = 30L;
+    if (mkdir(cache->dir, 0755) != 0 && errno != EEXIST) return -1;
+    return 0;
+}
+
+void fetch_cache_free(FetchCache *cache) {
+    free(cache->dir);
+    cache->dir = NULL;
+}
+
+void fetch_result_free(FetchResult *res) {
+    free(res->body);
+    res->body = NULL;
+    res->size = 0;
+}
+
+int fetch_cache_get(FetchCache *cache, const char *url, FetchResult *res) {
+    memset(res, 0, sizeof(*res));
+    res->status = FETCH_ERROR;
+
+    char body_path[4096];
+    entry_path(cache, url, "body", body_path, sizeof(body_path));
+
+    CacheMeta cached;
+    int have_cached = load_meta(cache, url, &cached) == 0 && access(body_path, R_OK) == 0;
+
+    if (cache->offline) {
+        if (!have_cached) return -1;
+        res->body = read_whole_file(body_path, &res->size);
+        if (!res->body) return -1;
+        snprintf(res->content_type, sizeof(res->content_type), "%s", cached.content_type);
+        res->status = FETCH_CACHED;
+        __atomic_fetch_add(&cache->hits, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    ResponseBuffer buf = { .memory = NULL, .size = 0, .limit = cache->max_size };
+    CacheMeta meta;
+    memset(&meta, 0, sizeof(meta));
+    if (perform(cache, url, have_cached ? &cached : NULL, &buf, &meta, &res->http_code) != 0) {
+        free(buf.memory);
+        return -1;
+    }
+
+    if (res->http_code == 304 && have_cached) {
+        free(buf.memory);
+        res->body = read_whole_file(body_path, &res->size);
+        if (!res->body) return -1;
+        snprintf(res->content_type, sizeof(res->content_type), "%s", cached.content_type);
+        res->status = FETCH_NOT_MODIFIED;
+        __atomic_fetch_add(&cache->hits, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    if (res->http_code < 200 || res->http_code >= 300 || buf.size == 0) {
+        free(buf.memory);
+        return -1;
+    }
+
+    // Тело поменялось — старые результаты извлечения больше не годятся
+    char extract_path[4096];
+    entry_path(cache, url, "extract", extract_path, sizeof(extract_path));
+    unlink(extract_path);
+    if (store_entry(cache, url, &meta, buf.memory, buf.size) != 0) {
+        fprintf(stderr, "⚠️  fetch cache: cannot store %s\n", url);
+    }
+
+    res->body = buf.memory;
+    res->size = buf.size;
+    snprintf(res->content_type, sizeof(res->content_type), "%s", meta.content_type);
+    res->status = FETCH_FRESH;
+    __atomic_fetch_add(&cache->misses, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&cache->bytes_downloaded, buf.size, __ATOMIC_RELAXED);
+    return 0;
+}
+
+int fetch_cache_load_extract(FetchCache *cache, const char *url, const char *key,
+                             char **title, char **content) {
+    *title = NULL;
+    *content = NULL;
+    char path[4096];
+    entry_path(cache, url, "extract", path, sizeof(path));
+
+    size_t size = 0;
+    char *data = read_whole_file(path, &size);
+    if (!data) return -1;
+
+    size_t magic_len = strlen(EXTRACT_MAGIC);
+    uint64_t lens[3];
+    if (size < magic_len + sizeof(lens) || memcmp(data, EXTRACT_MAGIC, magic_len) != 0) goto bad;
+    memcpy(lens, data + magic_len, sizeof(lens));
+
+    size_t title_len = lens[1] == NO_TITLE ? 0 : (size_t)lens[1];
+    const char *p = data + magic_len + sizeof(lens);
+    if ((size_t)(p - data) + lens[0] + title_len + lens[2] != size) goto bad;
+    if (lens[0] != strlen(key) || memcmp(p, key, lens[0]) != 0) goto bad;
+    p += lens[0];
+
+    if (lens[1] != NO_TITLE) {
+        *title = strndup(p, title_len);
+        p += title_len;
+    }
+    *content = strndup(p, (size_t)lens[2]);
+    free(data);
+    if (!*content) { free(*title); *title = NULL; return -1; }
+    return 0;
+
+bad:
+    free(data);
+    return -1;
+}
+
+int fetch_cache_store_extract(FetchCache *cache, const char *url, const char *key,
+                              const char *title, const char *content) {
+    char path[4096];
+    entry_path(cache, url, "extract", path, sizeof(path));
+    uint64_t lens[3] = { strlen(key), title ? strlen(title) : NO_TITLE, strlen(content) };
+    const void *parts[] = { EXTRACT_MAGIC, lens, key, title ? title : "", content };
+    size_t sizes[] = { strlen(EXTRACT_MAGIC), sizeof(lens), (size_t)lens[0],
+                       title ? (size_t)lens[1] : 0, (size_t)lens[2] };
+    return write_atomic(path, parts, sizes, 5);
+}
@@ -0,0 +1,62 @@
+// fetch_cache.h — локальный кэш загрузок с условными HTTP-запросами
+//
+// Запись кэша адресуется SHA-256 от URL и лежит в cache_dir:
+//   <hex>.body    — последнее тело ответа
+//   <hex>.meta    — URL, ETag, Last-Modified, Content-Type
+//   <hex>.extract — результат извлечения (title/content) для данного набора XPath
+// Повторный запрос отправляет If-None-Match / If-Modified-Since; на 304
+// используется сохранённое тело. В offline-режиме сеть не трогается вовсе.
+
+#ifndef FETCH_CACHE_H
+#define FETCH_CACHE_H
+
+#include <stddef.h>
+
+#define FETCH_CACHE_DEFAULT_DIR ".fetch_cache"
+#define FETCH_CACHE_ENV "OSDEV_FETCH_CACHE"
+#define FETCH_OFFLINE_ENV "OSDEV_OFFLINE"
+#define FETCH_MAX_HEADER 512
+
+typedef enum {
+    FETCH_ERROR = -1,
+    FETCH_FRESH = 0,         // скачано заново (200)
+    FETCH_NOT_MODIFIED = 1,  // 304 — тело из кэша
+    FETCH_CACHED = 2         // offline — тело из кэша без запроса
+} FetchStatus;
+
+typedef struct {
+    char *dir;
+    int offline;
+    const char *user_agent;
+    long timeout;
+    size_t max_size;
+    // статистика за прогон (атомарные счётчики: fetch_cache_get можно звать из потоков)
+    size_t hits;
+    size_t misses;
+    size_t bytes_downloaded;
+} FetchCache;
+
+typedef struct {
+    char *body;
+    size_t size;
+    FetchStatus status;
+    long http_code;
+    char content_type[FETCH_MAX_HEADER];
+} FetchResult;
+
+// dir == NULL → $OSDEV_FETCH_CACHE или FETCH_CACHE_DEFAULT_DIR;
+// offline < 0 → берётся из $OSDEV_OFFLINE
+int fetch_cache_init(FetchCache *cache, const char *dir, int offline);
+void fetch_cache_free(FetchCache *cache);
+
+int fetch_cache_get(FetchCache *cache, const char *url, FetchResult *res);
+void fetch_result_free(FetchResult *res);
+
+// Результаты извлечения, привязанные к ключу (обычно склейка XPath-выражений).
+// load возвращает 0 и malloc-строки (title может быть NULL), -1 если нет записи.
+int fetch_cache_load_extract(FetchCache *cache, const char *url, const char *key,
+                             char **title, char **content);
+int fetch_cache_store_extract(FetchCache *cache, const char *url, const char *key,
+                              const char *title, const char *content);
+
+#endif // FETCH_CACHE_H
@@ -0,0 +1,310 @@
+// fpindex.c — персистентный mmap-индекс отпечатков (см. fpindex.h)
+
+#include "fpindex.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <openssl/sha.h>
+
+// Таблица растёт, когда заполнена больше чем на 70%
+#define FPINDEX_MAX_LOAD_NUM 7
+#define FPINDEX_MAX_LOAD_DEN 10
+
+// === Вспомогательные функции ===
+
+const char *fpindex_default_path(void) {
+    const char *env = getenv(FPINDEX_ENV);
+    return (env && *env) ? env : FPINDEX_DEFAULT_PATH;
+}
+
+void fpindex_fingerprint(const void *data, size_t len, unsigned char out[FPINDEX_FP_SIZE]) {
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    SHA256((const unsigned char *)data, len, digest);
+    memcpy(out, digest, FPINDEX_FP_SIZE);
+    // Нулевой слот означает "пусто" — нулевой отпечаток сдвигаем
+    static const unsigned char zero[FPINDEX_FP_SIZE] = {0};
+    if (memcmp(out, zero, FPINDEX_FP_SIZE) == 0) out[FPINDEX_FP_SIZE - 1] = 1;
+}
+
+static uint64_t fp_slot_hash(const unsigned char *fp) {
+    uint64_t h = 0;
+    for (int i = 7; i >= 0; i--) h = (h << 8) | fp[i];
+    return h;
+}
+
+static size_t map_size_for(uint64_t slot_count) {
+    return sizeof(FpIndexHeader) + (size_t)slot_count * FPINDEX_FP_SIZE;
+}
+
+// Линейное пробирование. Возвращает указатель на слот с fp или на пустой слот.
+static unsigned char *probe(unsigned char *slots, uint64_t slot_count, const unsigned char *fp, int *found) {
+    static const unsigned char zero[FPINDEX_FP_SIZE] = {0};
+    uint64_t mask = slot_count - 1;
+    uint64_t pos = fp_slot_hash(fp) & mask;
+    for (uint64_t n = 0; n < slot_count; n++) {
+        unsigned char *slot = slots + pos * FPINDEX_FP_SIZE;
+        if (memcmp(slot, fp, FPINDEX_FP_SIZE) == 0) { *found = 1; return slot; }
+        if (memcmp(slot, zero, FPINDEX_FP_SIZE) == 0) { *found = 0; return slot; }
+        pos = (pos + 1) & mask;
+    }
+    *found = 0;
+    return NULL;
+}
+
+static void unmap(FpIndex *idx) {
+    if (idx->map) munmap(idx->map, idx->map_size);
+    if (idx->fd >= 0) close(idx->fd);
+    idx->map = NULL;
+    idx->hdr = NULL;
+    idx->slots = NULL;
+    idx->fd = -1;
+}
+
+// Создаёт пустой индекс в fd (вызывается под эксклюзивной блокировкой)
+static int init_file(int fd, uint64_t slot_count) {
+    if (ftruncate(fd, (off_t)map_size_for(slot_count)) != 0) return -1;
+    FpIndexHeader hdr = {0};
+    memcpy(hdr.magic, FPINDEX_MAGIC, sizeof(hdr.magic));
+    hdr.version = FPINDEX_VERSION;
+    hdr.fp_size = FPINDEX_FP_SIZE;
+    hdr.slot_count = slot_count;
+    hdr.used = 0;
+    if (pwrite(fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr)) return -1;
+    return 0;
+}
+
+static int map_file(FpIndex *idx) {
+    idx->fd = open(idx->path, O_RDWR | O_CREAT, 0644);
+    if (idx->fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(idx->fd, &st) != 0) { unmap(idx); return -1; }
+    if (st.st_size == 0) {
+        if (init_file(idx->fd, FPINDEX_INITIAL_SLOTS) != 0) { unmap(idx); return -1; }
+        if (fstat(idx->fd, &st) != 0) { unmap(idx); return -1; }
+    }
+    if ((size_t)st.st_size < sizeof(FpIndexHeader)) { unmap(idx); return -1; }
+
+    idx->map_size = (size_t)st.st_size;
+    idx->map = mmap(NULL, idx->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, idx->fd, 0);
+    if (idx->map == MAP_FAILED) { idx->map = NULL; unmap(idx); return -1; }
+
+    idx->hdr = (FpIndexHeader *)idx->map;
+    idx->slots = idx->map + sizeof(FpIndexHeader);
+    idx->inode = (uint64_t)st.st_ino;
+
+    if (memcmp(idx->hdr->magic, FPINDEX_MAGIC, sizeof(idx->hdr->magic)) != 0 ||
+        idx->hdr->version != FPINDEX_VERSION ||
+        idx->hdr->fp_size != FPINDEX_FP_SIZE ||
+        map_size_for(idx->hdr->slot_count) != idx->map_size) {
+        fprintf(stderr, "fpindex: '%s' is not a valid index\n", idx->path);
+        unmap(idx);
+        return -1;
+    }
+    return 0;
+}
+
+// Другой процесс мог вырастить индекс (rename поверх) — переотображаем
+static int refresh(FpIndex *idx) {
+    struct stat st;
+    if (stat(idx->path, &st) == 0 && (uint64_t)st.st_ino == idx->inode &&
+        (size_t)st.st_size == idx->map_size) {
+        return 0;
+    }
+    unmap(idx);
+    return map_file(idx);
+}
+
+// Перестраивает таблицу вдвое большего размера и атомарно подменяет файл
+static int grow(FpIndex *idx) {
+    uint64_t new_slots = idx->hdr->slot_count * 2;
+    size_t tmp_len = strlen(idx->path) + 32;
+    char *tmp_path = malloc(tmp_len);
+    if (!tmp_path) return -1;
+    snprintf(tmp_path, tmp_len, "%s.tmp.%ld", idx->path, (long)getpid());
+
+    int fd = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) { free(tmp_path); return -1; }
+    if (init_file(fd, new_slots) != 0) goto fail;
+
+    size_t size = map_size_for(new_slots);
+    unsigned char *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) goto fail;
+
+    static const unsigned char zero[FPINDEX_FP_SIZE] = {0};
+    unsigned char *dst_slots = map + sizeof(FpIndexHeader);
+    uint64_t used = 0;
+    for (uint64_t i = 0; i < idx->hdr->slot_count; i++) {
+        const unsigned char *fp = idx->slots + i * FPINDEX_FP_SIZE;
+        if (memcmp(fp, zero, FPINDEX_FP_SIZE) == 0) continue;
+        int found;
+        unsigned char *slot = probe(dst_slots, new_slots, fp, &found);
+        if (slot && !found) { memcpy(slot, fp, FPINDEX_FP_SIZE); used++; }
+    }
+    ((FpIndexHeader *)map)->used = used;
+    msync(map, size, MS_SYNC);
+    munmap(map, size);
+    close(fd);
+
+    if (rename(tmp_path, idx->path) != 0) { unlink(tmp_path); free(tmp_path); return -1; }
+    free(tmp_path);
+    unmap(idx);
+    return map_file(idx);
+
+fail:
+    close(fd);
+    unlink(tmp_path);
+    free(tmp_path);
+    return -1;
+}
+
+// === API ===
+
+int fpindex_open(FpIndex *idx, const char *path) {
+    memset(idx, 0, sizeof(*idx));
+    idx->fd = -1;
+    idx->lock_fd = -1;
+    if (!path) path = fpindex_default_path();
+
+    idx->path = strdup(path);
+    size_t lock_len = strlen(path) + 6;
+    idx->lock_path = malloc(lock_len);
+    if (!idx->path || !idx->lock_path) { fpindex_close(idx); return -1; }
+    snprintf(idx->lock_path, lock_len, "%s.lock", path);
+
+    // Отдельный lock-файл переживает rename индекса при росте
+    idx->lock_fd = open(idx->lock_path, O_RDWR | O_CREAT, 0644);
+    if (idx->lock_fd < 0) { fpindex_close(idx); return -1; }
+
+    flock(idx->lock_fd, LOCK_EX);
+    int rc = map_file(idx);
+    flock(idx->lock_fd, LOCK_UN);
+    if (rc != 0) { fpindex_close(idx); return -1; }
+    return 0;
+}
+
+void fpindex_close(FpIndex *idx) {
+    if (idx->map) msync(idx->map, idx->map_size, MS_ASYNC);
+    unmap(idx);
+    free(idx->staged);
+    idx->staged = NULL;
+    idx->staged_slots = idx->staged_used = 0;
+    if (idx->lock_fd >= 0) close(idx->lock_fd);
+    free(idx->path);
+    free(idx->lock_path);
+    idx->path = NULL;
+    idx->lock_path = NULL;
+    idx->lock_fd = -1;
+}
+
+int fpindex_contains(FpIndex *idx, const void *data, size_t len) {
+    if (!idx->map) return -1;
+    unsigned char fp[FPINDEX_FP_SIZE];
+    fpindex_fingerprint(data, len, fp);
+
+    flock(idx->lock_fd, LOCK_SH);
+    int found = 0;
+    if (refresh(idx) != 0) { flock(idx->lock_fd, LOCK_UN); return -1; }
+    probe(idx->slots, idx->hdr->slot_count, fp, &found);
+    flock(idx->lock_fd, LOCK_UN);
+    return found;
+}
+
+int fpindex_check_and_add(FpIndex *idx, const void *data, size_t len) {
+    unsigned char fp[FPINDEX_FP_SIZE];
+    fpindex_fingerprint(data, len, fp);
+    return fpindex_check_and_add_fp(idx, fp);
+}
+
+int fpindex_check_and_add_fp(FpIndex *idx, const unsigned char fp[FPINDEX_FP_SIZE]) {
+    if (!idx->map) return -1;
+    flock(idx->lock_fd, LOCK_EX);
+    int rc = -1;
+    if (refresh(idx) != 0) goto out;
+
+    int found;
+    unsigned char *slot = probe(idx->slots, idx->hdr->slot_count, fp, &found);
+    if (found) { rc = 1; goto out; }
+
+    if ((idx->hdr->used + 1) * FPINDEX_MAX_LOAD_DEN > idx->hdr->slot_count * FPINDEX_MAX_LOAD_NUM) {
+        if (grow(idx) != 0) goto out;
+        slot = probe(idx->slots, idx->hdr->slot_count, fp, &found);
+    }
+    if (!slot) goto out;
+
+    memcpy(slot, fp, FPINDEX_FP_SIZE);
+    idx->hdr->used++;
+    rc = 0;
+
+out:
+    flock(idx->lock_fd, LOCK_UN);
+    return rc;
+}
+
+uint64_t fpindex_count(const FpIndex *idx) {
+    return idx->hdr ? idx->hdr->used : 0;
+}
+
+// === Отложенные отпечатки ===
+
+int fpindex_seen_fp(FpIndex *idx, const unsigned char fp[FPINDEX_FP_SIZE]) {
+    int found = 0;
+    if (idx->staged_used) {
+        probe(idx->staged, idx->staged_slots, fp, &found);
+        if (found) return 1;
+    }
+    if (!idx->map) return -1;
+    flock(idx->lock_fd, LOCK_SH);
+    if (refresh(idx) != 0) { flock(idx->lock_fd, LOCK_UN); return -1; }
+    probe(idx->slots, idx->hdr->slot_count, fp, &found);
+    flock(idx->lock_fd, LOCK_UN);
+    return found;
+}
+
+int fpindex_stage_fp(FpIndex *idx, const unsigned char fp[FPINDEX_FP_SIZE]) {
+    if ((idx->staged_used + 1) * FPINDEX_MAX_LOAD_DEN > idx->staged_slots * FPINDEX_MAX_LOAD_NUM) {
+        uint64_t slots = idx->staged_slots ? idx->staged_slots * 2 : 1024;
+        unsigned char *table = calloc(slots, FPINDEX_FP_SIZE);
+        if (!table) return -1;
+        static const unsigned char zero[FPINDEX_FP_SIZE] = {0};
+        int found;
+        for (uint64_t i = 0; i < idx->staged_slots; i++) {
+            const unsigned char *old = idx->staged + i * FPINDEX_FP_SIZE;
+            if (memcmp(old, zero, FPINDEX_FP_SIZE) != 0)
+                memcpy(probe(table, slots, old, &found), old, FPINDEX_FP_SIZE);
+        }
+        free(idx->staged);
+        idx->staged = table;
+        idx->staged_slots = slots;
+    }
+    int found;
+    unsigned char *slot = probe(idx->staged, idx->staged_slots, fp, &found);
+    if (!found) {
+        memcpy(slot, fp, FPINDEX_FP_SIZE);
+        idx->staged_used++;
+    }
+    return 0;
+}
+
+int fpindex_commit(FpIndex *idx) {
+    static const unsigned char zero[FPINDEX_FP_SIZE] = {0};
+    if (!idx->staged_used) return 0;
+    // При ошибке таблица остаётся целиком: уже перенесённые найдутся и в файле
+    for (uint64_t i = 0; i < idx->staged_slots; i++) {
+        const unsigned char *fp = idx->staged + i * FPINDEX_FP_SIZE;
+        if (memcmp(fp, zero, FPINDEX_FP_SIZE) != 0 && fpindex_check_and_add_fp(idx, fp) < 0) return -1;
+    }
+    memset(idx->staged, 0, idx->staged_slots * FPINDEX_FP_SIZE);
+    idx->staged_used = 0;
+    return 0;
+}
+
+uint64_t fpindex_staged(const FpIndex *idx) {
+    return idx->staged_used;
+}
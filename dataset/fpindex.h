@@ -0,0 +1,81 @@
+// fpindex.h — персистентный индекс отпечатков для дедупликации
+//
+// Файл индекса — открытая адресация по 128-битным отпечаткам (первые
+// 16 байт SHA-256 от содержимого). Таблица лежит на диске как есть и
+// отображается через mmap, поэтому старт не требует перехеширования.
+// Обновления только дописывают отпечаток в пустой слот — существующие
+// слоты никогда не меняются.
+//
+// Отображение общее (MAP_SHARED): добавленный отпечаток переживает падение
+// процесса сразу, а запись, ради которой он добавлен, может ещё лежать в
+// буфере писателя (ds_writer.h). Поэтому сборщики откладывают отпечатки
+// записанных записей (fpindex_stage_fp) и переносят их в файл
+// (fpindex_commit) только после ds_writer_sync или ds_writer_close.
+// Отложенная таблица своя у процесса и без замка — её трогают под тем же
+// мьютексом, что и писатель.
+//
+// Формат общий для dataset.c (вкл. crawl.c), test/parser.c, merge.c и
+// pars.sh (см. parser_data/fpindex.py).
+
+#ifndef FPINDEX_H
+#define FPINDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FPINDEX_MAGIC "OXFPIDX1"
+#define FPINDEX_VERSION 1
+#define FPINDEX_FP_SIZE 16
+#define FPINDEX_INITIAL_SLOTS (1u << 16)
+#define FPINDEX_DEFAULT_PATH "osdev_dedup.fpi"
+#define FPINDEX_ENV "OSDEV_DEDUP_INDEX"
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t fp_size;
+    uint64_t slot_count;   // всегда степень двойки
+    uint64_t used;
+    uint8_t reserved[32];
+} FpIndexHeader;
+
+typedef struct {
+    char *path;
+    char *lock_path;
+    int fd;
+    int lock_fd;
+    uint64_t inode;
+    unsigned char *map;
+    size_t map_size;
+    FpIndexHeader *hdr;
+    unsigned char *slots;
+    unsigned char *staged;     // отложенные отпечатки: та же таблица, в памяти
+    uint64_t staged_slots;
+    uint64_t staged_used;
+} FpIndex;
+
+// Путь к индексу: $OSDEV_DEDUP_INDEX или FPINDEX_DEFAULT_PATH
+const char *fpindex_default_path(void);
+
+int fpindex_open(FpIndex *idx, const char *path);
+// Отложенные и не перенесённые отпечатки отбрасываются
+void fpindex_close(FpIndex *idx);
+
+// 1 — отпечаток уже был, 0 — новый (и записан), -1 — ошибка
+int fpindex_check_and_add(FpIndex *idx, const void *data, size_t len);
+// То же по готовому отпечатку (когда он нужен вызывающему и для другого)
+int fpindex_check_and_add_fp(FpIndex *idx, const unsigned char fp[FPINDEX_FP_SIZE]);
+int fpindex_contains(FpIndex *idx, const void *data, size_t len);
+uint64_t fpindex_count(const FpIndex *idx);
+
+// 1 — отпечаток в индексе или отложен, 0 — нет, -1 — ошибка
+int fpindex_seen_fp(FpIndex *idx, const unsigned char fp[FPINDEX_FP_SIZE]);
+// Отложить отпечаток уже записанной записи; 0 или -1
+int fpindex_stage_fp(FpIndex *idx, const unsigned char fp[FPINDEX_FP_SIZE]);
+// Перенести отложенные в файл индекса — когда их записи уже на диске; 0 или -1
+int fpindex_commit(FpIndex *idx);
+uint64_t fpindex_staged(const FpIndex *idx);
+
+void fpindex_fingerprint(const void *data, size_t len, unsigned char out[FPINDEX_FP_SIZE]);
+
+#endif // FPINDEX_H
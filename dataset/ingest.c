@@ -0,0 +1,336 @@
+// ingest.c — параллельный сбор локального корпуса (см. ingest.h)
+
+#define _GNU_SOURCE
+#include "ingest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "json_escape.h"
+
+#define INGEST_MAX_PATH 4096
+#define BINARY_PROBE 8192
+
+typedef struct {
+    char *path;                // файл (tree) или *_prompt.txt (pairs)
+    char *pair;                // *_example.c (pairs)
+    const char *rel;           // путь относительно root (внутри path)
+} IngestJob;
+
+typedef struct {
+    IngestJob *items;
+    size_t count;
+    size_t cap;
+} JobList;
+
+typedef struct {
+    const IngestConfig *cfg;
+    JobList *jobs;
+    size_t next;               // атомарный счётчик заданий
+    pthread_mutex_t out_lock;  // дедупликация + запись
+    IngestStats stats;
+} IngestShared;
+
+typedef struct {
+    const char *data;
+    size_t size;
+} MappedFile;
+
+// === Определение языка ===
+
+static const struct { const char *suffix; const char *lang; } LANG_BY_SUFFIX[] = {
+    { ".c", "C" }, { ".h", "C" },
+    { ".cc", "C++" }, { ".cpp", "C++" }, { ".cxx", "C++" }, { ".hpp", "C++" }, { ".hh", "C++" },
+    { ".S", "Assembly" }, { ".s", "Assembly" }, { ".asm", "Assembly" }, { ".inc", "Assembly" },
+    { ".rs", "Rust" }, { ".go", "Go" }, { ".py", "Python" },
+    { ".sh", "Shell" }, { ".bash", "Shell" },
+    { ".ld", "LinkerScript" }, { ".lds", "LinkerScript" },
+    { ".mk", "Makefile" }, { ".cmake", "CMake" },
+    { ".dts", "DeviceTree" }, { ".dtsi", "DeviceTree" },
+    { ".rst", "Text" }, { ".md", "Text" }, { ".txt", "Text" },
+};
+
+static const struct { const char *name; const char *lang; } LANG_BY_NAME[] = {
+    { "Makefile", "Makefile" }, { "GNUmakefile", "Makefile" }, { "Kbuild", "Makefile" },
+    { "Kconfig", "Kconfig" }, { "CMakeLists.txt", "CMake" }, { "README", "Text" },
+};
+
+const char *ingest_detect_language(const char *path, const char *data, size_t len) {
+    const char *name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+
+    for (size_t i = 0; i < sizeof(LANG_BY_NAME) / sizeof(LANG_BY_NAME[0]); i++) {
+        if (strcmp(name, LANG_BY_NAME[i].name) == 0) return LANG_BY_NAME[i].lang;
+    }
+    if (strncmp(name, "Kconfig", 7) == 0) return "Kconfig";
+
+    const char *dot = strrchr(name, '.');
+    if (dot) {
+        for (size_t i = 0; i < sizeof(LANG_BY_SUFFIX) / sizeof(LANG_BY_SUFFIX[0]); i++) {
+            if (strcmp(dot, LANG_BY_SUFFIX[i].suffix) == 0) return LANG_BY_SUFFIX[i].lang;
+        }
+        return NULL;
+    }
+
+    // Без расширения — смотрим на шебанг
+    if (data && len > 2 && data[0] == '#' && data[1] == '!') {
+        size_t n = len < 128 ? len : 128;
+        const char *eol = memchr(data, '\n', n);
+        size_t line = eol ? (size_t)(eol - data) : n;
+        if (memmem(data, line, "python", 6)) return "Python";
+        if (memmem(data, line, "sh", 2)) return "Shell";
+        if (memmem(data, line, "perl", 4)) return "Perl";
+    }
+    return NULL;
+}
+
+// === Обход каталога ===
+
+static int ends_with_str(const char *str, const char *suffix) {
+    size_t ls = strlen(str), lx = strlen(suffix);
+    return ls >= lx && strcmp(str + ls - lx, suffix) == 0;
+}
+
+static int push_job(JobList *list, char *path, char *pair, size_t root_len) {
+    if (list->count == list->cap) {
+        size_t cap = list->cap ? list->cap * 2 : 256;
+        IngestJob *p = realloc(list->items, cap * sizeof(*p));
+        if (!p) return -1;
+        list->items = p;
+        list->cap = cap;
+    }
+    const char *rel = path + root_len;
+    while (*rel == '/') rel++;
+    list->items[list->count++] = (IngestJob){ path, pair, rel };
+    return 0;
+}
+
+static void collect(const IngestConfig *cfg, const char *dir, size_t root_len, JobList *list, IngestStats *stats) {
+    DIR *d = opendir(dir);
+    if (!d) return;
+
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        if (entry->d_name[0] == '.') continue;  // ., .., .git и прочие скрытые
+
+        char path[INGEST_MAX_PATH];
+        if (snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name) >= (int)sizeof(path)) continue;
+
+        unsigned char type = entry->d_type;
+        if (type == DT_UNKNOWN) {
+            struct stat st;
+            if (lstat(path, &st) != 0) continue;
+            type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_LNK;
+        }
+        if (type == DT_DIR) {
+            collect(cfg, path, root_len, list, stats);
+            continue;
+        }
+        if (type != DT_REG) continue;
+        stats->files_seen++;
+
+        if (cfg->mode == INGEST_PAIRS) {
+            if (!ends_with_str(entry->d_name, "_prompt.txt")) continue;
+            char pair[INGEST_MAX_PATH];
+            size_t base_len = strlen(path) - strlen("_prompt.txt");
+            snprintf(pair, sizeof(pair), "%.*s_example.c", (int)base_len, path);
+            if (access(pair, R_OK) != 0) { stats->skipped++; continue; }
+            char *p = strdup(path), *q = strdup(pair);
+            if (!p || !q || push_job(list, p, q, root_len) != 0) { free(p); free(q); }
+        } else {
+            char *p = strdup(path);
+            if (!p || push_job(list, p, NULL, root_len) != 0) free(p);
+        }
+    }
+    closedir(d);
+}
+
+// === mmap ===
+
+static int map_file(const char *path, size_t max_size, MappedFile *mf) {
+    mf->data = NULL;
+    mf->size = 0;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0 || (size_t)st.st_size > max_size) {
+        close(fd);
+        return -1;
+    }
+    void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return -1;
+    madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+    mf->data = p;
+    mf->size = (size_t)st.st_size;
+    return 0;
+}
+
+static void unmap_file(MappedFile *mf) {
+    if (mf->data) munmap((void *)mf->data, mf->size);
+    mf->data = NULL;
+}
+
+static int looks_binary(const MappedFile *mf) {
+    size_t n = mf->size < BINARY_PROBE ? mf->size : BINARY_PROBE;
+    return memchr(mf->data, '\0', n) != NULL;
+}
+
+// === Сборка записи ===
+
+static int build_record(StrBuf *b, const char *prompt, size_t prompt_len,
+                        const char *content, size_t content_len,
+                        const char *source, const char *category, const char *lang) {
+    strbuf_reset(b);
+    int rc = 0;
+    rc |= strbuf_append_str(b, "{\"messages\":[{\"role\":\"user\",\"content\":\"");
+    rc |= json_escape_append(b, prompt, prompt_len);
+    rc |= strbuf_append_str(b, "\"},{\"role\":\"assistant\",\"content\":\"");
+    rc |= json_escape_append(b, content, content_len);
+    rc |= strbuf_append_str(b, "\"}],\"metadata\":{\"source\":\"");
+    rc |= json_escape_append(b, source, strlen(source));
+    rc |= strbuf_append_str(b, "\",\"category\":\"");
+    rc |= json_escape_append(b, category, strlen(category));
+    rc |= strbuf_append_str(b, "\",\"language\":\"");
+    rc |= json_escape_append(b, lang, strlen(lang));
+    rc |= strbuf_append_str(b, "\"}}\n");
+    return rc;
+}
+
+// Под out_lock: проверка дубликата и запись; отпечаток откладывается только
+// за записанной записью (fpindex.h). 1 — записано, 0 — дубликат, -1 — ошибка
+static int emit(IngestShared *sh, const char *key, size_t key_len, const StrBuf *rec) {
+    unsigned char fp[FPINDEX_FP_SIZE];
+    if (sh->cfg->dedup) fpindex_fingerprint(key, key_len, fp);
+    pthread_mutex_lock(&sh->out_lock);
+    int rc = 1;
+    if (sh->cfg->dedup && fpindex_seen_fp(sh->cfg->dedup, fp) == 1) {
+        sh->stats.duplicates++;
+        rc = 0;
+    } else if (ds_writer_write(sh->cfg->out, rec->data, rec->len) != 0) {
+        rc = -1;
+    } else {
+        sh->stats.records++;
+        if (sh->cfg->dedup) fpindex_stage_fp(sh->cfg->dedup, fp);
+    }
+    pthread_mutex_unlock(&sh->out_lock);
+    return rc;
+}
+
+static void count_skip(IngestShared *sh, uint64_t bytes) {
+    __atomic_fetch_add(&sh->stats.skipped, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&sh->stats.bytes_read, bytes, __ATOMIC_RELAXED);
+}
+
+static void process_pair(IngestShared *sh, const IngestJob *job, StrBuf *rec) {
+    const IngestConfig *cfg = sh->cfg;
+    MappedFile prompt, example;
+    if (map_file(job->path, cfg->max_file_size, &prompt) != 0) { count_skip(sh, 0); return; }
+    if (map_file(job->pair, cfg->max_file_size, &example) != 0) {
+        unmap_file(&prompt);
+        count_skip(sh, prompt.size);
+        return;
+    }
+    __atomic_fetch_add(&sh->stats.bytes_read, prompt.size + example.size, __ATOMIC_RELAXED);
+
+    const char *source = cfg->source ? cfg->source : job->rel;
+    if (build_record(rec, prompt.data, prompt.size, example.data, example.size,
+                     source, cfg->category, "C") == 0) {
+        emit(sh, example.data, example.size, rec);
+    }
+    unmap_file(&prompt);
+    unmap_file(&example);
+}
+
+static void process_tree_file(IngestShared *sh, const IngestJob *job, StrBuf *rec) {
+    const IngestConfig *cfg = sh->cfg;
+    MappedFile file;
+    if (map_file(job->path, cfg->max_file_size, &file) != 0) { count_skip(sh, 0); return; }
+
+    const char *lang = ingest_detect_language(job->path, file.data, file.size);
+    if (!lang || looks_binary(&file)) {
+        unmap_file(&file);
+        count_skip(sh, file.size);
+        return;
+    }
+    __atomic_fetch_add(&sh->stats.bytes_read, file.size, __ATOMIC_RELAXED);
+
+    char prompt[INGEST_MAX_PATH + 256];
+    int prompt_len = snprintf(prompt, sizeof(prompt),
+                              "Explain what this %s file (%s) does and how it works, for an OS developer.",
+                              lang, job->rel);
+    if (prompt_len < 0 || (size_t)prompt_len >= sizeof(prompt)) prompt_len = (int)strlen(prompt);
+
+    const char *source = cfg->source ? cfg->source : job->rel;
+    if (build_record(rec, prompt, (size_t)prompt_len, file.data, file.size,
+                     source, cfg->category, lang) == 0) {
+        emit(sh, file.data, file.size, rec);
+    }
+    unmap_file(&file);
+}
+
+static void *worker(void *arg) {
+    IngestShared *sh = (IngestShared *)arg;
+    StrBuf rec = {0};
+    for (;;) {
+        size_t i = __atomic_fetch_add(&sh->next, 1, __ATOMIC_RELAXED);
+        if (i >= sh->jobs->count) break;
+        const IngestJob *job = &sh->jobs->items[i];
+        if (sh->cfg->mode == INGEST_PAIRS) process_pair(sh, job, &rec);
+        else process_tree_file(sh, job, &rec);
+    }
+    strbuf_free(&rec);
+    return NULL;
+}
+
+// === API ===
+
+int ingest_run(const IngestConfig *cfg_in, IngestStats *stats) {
+    IngestConfig cfg = *cfg_in;
+    if (!cfg.max_file_size) cfg.max_file_size = INGEST_DEFAULT_MAX_FILE;
+    if (cfg.jobs <= 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        cfg.jobs = n > 0 ? (int)n : 1;
+    }
+    if (!cfg.category) cfg.category = "C";
+
+    IngestShared sh;
+    memset(&sh, 0, sizeof(sh));
+    sh.cfg = &cfg;
+    pthread_mutex_init(&sh.out_lock, NULL);
+
+    JobList jobs = {0};
+    size_t root_len = strlen(cfg.root);
+    collect(&cfg, cfg.root, root_len, &jobs, &sh.stats);
+    sh.jobs = &jobs;
+
+    int n_threads = cfg.jobs;
+    if ((size_t)n_threads > jobs.count) n_threads = jobs.count ? (int)jobs.count : 1;
+    pthread_t *threads = calloc((size_t)n_threads, sizeof(pthread_t));
+    int started = 0;
+    if (threads) {
+        for (; started < n_threads; started++) {
+            if (pthread_create(&threads[started], NULL, worker, &sh) != 0) break;
+        }
+    }
+    if (started == 0) worker(&sh);  // не удалось создать потоки — работаем в текущем
+    for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+    free(threads);
+
+    for (size_t i = 0; i < jobs.count; i++) {
+        free(jobs.items[i].path);
+        free(jobs.items[i].pair);
+    }
+    free(jobs.items);
+    pthread_mutex_destroy(&sh.out_lock);
+
+    if (stats) *stats = sh.stats;
+    return 0;
+}
@@ -0,0 +1,51 @@
+// ingest.h — параллельный сбор локального корпуса
+//
+// Рекурсивно обходит каталог, отображает файлы через mmap (без копий в
+// стековые буферы) и раздаёт их пулу потоков. Два режима:
+//   INGEST_PAIRS — пары *_prompt.txt / *_example.c (бывший manual/)
+//   INGEST_TREE  — дерево исходников целиком (например, локальный checkout
+//                  linux/samples), язык определяется по каждому файлу
+// Дедупликация и запись сериализуются одним мьютексом, вся остальная
+// работа (чтение, экранирование, сборка записи) идёт параллельно.
+
+#ifndef INGEST_H
+#define INGEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "fpindex.h"
+#include "ds_writer.h"
+
+#define INGEST_DEFAULT_MAX_FILE (1024 * 1024)
+
+typedef enum {
+    INGEST_PAIRS = 0,
+    INGEST_TREE
+} IngestMode;
+
+typedef struct {
+    const char *root;
+    IngestMode mode;
+    const char *category;      // metadata.category
+    const char *source;        // metadata.source; NULL → относительный путь файла
+    int jobs;                  // 0 → число CPU
+    size_t max_file_size;      // 0 → INGEST_DEFAULT_MAX_FILE
+    DsWriter *out;
+    FpIndex *dedup;            // NULL → без дедупликации
+} IngestConfig;
+
+typedef struct {
+    uint64_t files_seen;
+    uint64_t records;
+    uint64_t duplicates;
+    uint64_t skipped;          // бинарные, пустые, слишком большие, без пары
+    uint64_t bytes_read;
+} IngestStats;
+
+int ingest_run(const IngestConfig *cfg, IngestStats *stats);
+
+// Язык по имени файла и первым байтам (шебанг); NULL — не исходник/текст
+const char *ingest_detect_language(const char *path, const char *data, size_t len);
+
+#endif // INGEST_H
@@ -0,0 +1,59 @@
+// json_escape.h — векторизованное экранирование JSON-строк
+//
+// Строка сканируется по 16 (SSE2) или 32 (AVX2) байта за раз в поисках
+// '"', '\\' и управляющих символов < 0x20; чистые участки копируются
+// одним memcpy. Вариант выбирается один раз в рантайме, на других
+// архитектурах работает скалярный код. Результат пишется в растущий
+// буфер StrBuf без фиксированных лимитов.
+
+#ifndef JSON_ESCAPE_H
+#define JSON_ESCAPE_H
+
+#include <stddef.h>
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} StrBuf;
+
+int strbuf_reserve(StrBuf *buf, size_t extra);
+int strbuf_append(StrBuf *buf, const char *data, size_t len);
+int strbuf_append_str(StrBuf *buf, const char *str);
+void strbuf_reset(StrBuf *buf);
+void strbuf_free(StrBuf *buf);
+
+// Точный размер экранированной строки (без кавычек и '\0')
+size_t json_escaped_size(const char *input, size_t len);
+
+// Дописывает экранированную строку в buf (без кавычек); 0 или -1 при нехватке памяти
+int json_escape_append(StrBuf *buf, const char *input, size_t len);
+
+// malloc-строка ровно нужного размера; NULL при ошибке
+char *json_escape_dup(const char *input);
+
+// === Обратное преобразование ===
+
+// Дописывает раскодированную строку (тело без кавычек, \uXXXX и суррогатные
+// пары → UTF-8) в buf; -1 при нехватке памяти или некорректной escape-последовательности
+int json_unescape_append(StrBuf *buf, const char *input, size_t len);
+
+// Первое строковое значение по ключу key (на любой глубине) в JSON-тексте.
+// *val указывает внутрь json на ещё экранированное тело; 0 — найдено, -1 — нет
+int json_find_string(const char *json, size_t len, const char *key, const char **val, size_t *val_len);
+
+// Реплики диалога: объекты внутри массивов (на любой глубине) с role и
+// content в любом порядке ключей — по порядку в fn, тела ещё экранированы.
+// Объект без них обходится как обычный контейнер. Ненулевой возврат fn
+// останавливает обход и возвращается; иначе 0
+typedef int (*JsonMessageFn)(void *ud, const char *role, size_t role_len, const char *content,
+                             size_t content_len);
+int json_each_message(const char *json, size_t len, JsonMessageFn fn, void *ud);
+
+// content первой реплики с role "assistant"; 0 — найдено, -1 — нет
+int json_find_assistant(const char *json, size_t len, const char **val, size_t *val_len);
+
+// Имя выбранной реализации: "avx2", "sse2" или "scalar"
+const char *json_escape_impl(void);
+
+#endif // JSON_ESCAPE_H
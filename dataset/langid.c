@@ -0,0 +1,310 @@
+// langid.c — определение языка по символьным n-граммам (см. langid.h)
+
+#include "langid.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "langid_samples.h"
+
+#define TABLE_BITS 14
+#define TABLE_SIZE (1u << TABLE_BITS)
+#define QSCALE 8                   // стоимость в 1/8 бита, не больше 255
+#define LANES 8                    // байт на ячейку: язык → байт lang - 1
+#define FLUSH_EVERY 128            // 2 стоимости ≤ 255 за шаг: 16-битные полосы не переполнятся
+
+// === Алфавит ===
+// 0 — граница слова (пробелы, цифры, знаки), дальше строчные буквы:
+//   1..26    a-z
+//   27..58   à..ÿ (U+00E0..U+00FF, на месте ÷ — ß)
+//   59       œ
+//   60..107  кириллица U+0430..U+045F (а-я, ѐ-џ: ё є і ї ў ...)
+//   108      ґ
+//   109      прочая латиница (Latin Extended)
+//   110      буква другой письменности (греческая, арабская, CJK ...)
+enum {
+    ID_LATIN1 = 27, ID_OE = 59, ID_CYR = 60, ID_GHE = 108, ID_LATIN_X = 109, ID_OTHER = 110
+};
+enum { SCRIPT_LATIN, SCRIPT_CYRILLIC, SCRIPT_OTHER };
+
+#define LANE(lang) (0xFFull << (8 * ((lang) - 1)))
+// Два свободных байта — счётчики n-грамм латиницы и кириллицы: в каждой
+// ячейке там 1, и сумма полосы после прохода — число n-грамм письменности
+#define COUNT_LATIN 6
+#define COUNT_CYRILLIC 7
+#define COUNT_LANES (1ull << (8 * COUNT_LATIN) | 1ull << (8 * COUNT_CYRILLIC))
+
+// Какие языки видят n-грамму, оканчивающуюся буквой этой письменности
+// (или границей после неё): русский текст с английскими терминами и
+// кодом сравнивается с ru и uk только по кириллическим n-граммам
+static const uint64_t SCRIPT_LANES[3] = {
+    [SCRIPT_LATIN] = LANE(LANG_EN) | LANE(LANG_DE) | LANE(LANG_FR) | LANE(LANG_ES) | 0xFFull << (8 * COUNT_LATIN),
+    [SCRIPT_CYRILLIC] = LANE(LANG_RU) | LANE(LANG_UK) | 0xFFull << (8 * COUNT_CYRILLIC),
+    [SCRIPT_OTHER] = 0,
+};
+
+static uint8_t fast_id[256];       // ASCII, затем U+0400..U+047F (ведущие байты D0, D1)
+static uint64_t id_lanes[128];     // id → SCRIPT_LANES его письменности
+static uint64_t cost[TABLE_SIZE];  // байт lang - 1 — стоимость языка lang
+static pthread_once_t table_once = PTHREAD_ONCE_INIT;
+
+static const char *const LANG_NAMES[LANG_COUNT] = { "und", "en", "ru", "uk", "de", "fr", "es" };
+
+static uint32_t codepoint_id(uint32_t cp) {
+    if (cp >= 0xC0 && cp <= 0xDE && cp != 0xD7) cp += 0x20;
+    if (cp == 0xDF) return ID_LATIN1 + (0xF7 - 0xE0);
+    if (cp >= 0xE0 && cp <= 0xFF) return cp == 0xF7 ? 0 : ID_LATIN1 + (cp - 0xE0);
+    if (cp == 0x152 || cp == 0x153) return ID_OE;
+    if (cp >= 0x400 && cp <= 0x40F) cp += 0x50;
+    else if (cp >= 0x410 && cp <= 0x42F) cp += 0x20;
+    if (cp >= 0x430 && cp <= 0x45F) return ID_CYR + (cp - 0x430);
+    if (cp == 0x490 || cp == 0x491) return ID_GHE;
+    if ((cp >= 0x100 && cp <= 0x24F) || (cp >= 0x1E00 && cp <= 0x1EFF)) return ID_LATIN_X;
+    if ((cp >= 0x370 && cp <= 0x3FF) || (cp >= 0x460 && cp <= 0x1FFF) ||
+        (cp >= 0x3040 && cp <= 0xD7FF)) return ID_OTHER;
+    return 0;
+}
+
+// Следующий символ алфавита; битый UTF-8 — граница, съедается один байт.
+// ASCII и двухбайтовая кириллица — по таблицам, остальное — через кодовую
+// точку; буквы других письменностей считаются здесь же, в редкой ветке
+static inline uint32_t next_id(const unsigned char *s, size_t len, size_t *pos, uint32_t *other) {
+    size_t i = *pos;
+    unsigned char c = s[i];
+    if (c < 0x80) {
+        *pos = i + 1;
+        return fast_id[c];
+    }
+    if ((c & 0xFE) == 0xD0 && i + 1 < len && (s[i + 1] & 0xC0) == 0x80) {
+        *pos = i + 2;
+        return fast_id[128 + (((c & 1) << 6) | (s[i + 1] & 0x3F))];
+    }
+    uint32_t cp;
+    size_t n;
+    if (c >= 0xC2 && c <= 0xDF) { cp = c & 0x1F; n = 2; }
+    else if (c >= 0xE0 && c <= 0xEF) { cp = c & 0x0F; n = 3; }
+    else if (c >= 0xF0 && c <= 0xF4) { cp = c & 0x07; n = 4; }
+    else { *pos = i + 1; return 0; }
+    if (i + n > len) { *pos = i + 1; return 0; }
+    for (size_t k = 1; k < n; k++) {
+        if ((s[i + k] & 0xC0) != 0x80) { *pos = i + 1; return 0; }
+        cp = (cp << 6) | (s[i + k] & 0x3F);
+    }
+    *pos = i + n;
+    uint32_t id = codepoint_id(cp);
+    *other += id == ID_OTHER;
+    return id;
+}
+
+// Последние три символа — key = (a << 14) | (b << 7) | c, id < 128.
+// Триграмма — key целиком, биграмма (b, c) — младшие 14 бит с меткой
+#define BIGRAM_TAG (1u << 21)
+
+static inline uint32_t slot_of(uint32_t key) {
+    return (key * 2654435761u) >> (32 - TABLE_BITS);
+}
+
+// === Построение таблицы ===
+// Частоты по образцам со сглаживанием Виттена–Белла: невиданной n-грамме
+// достаётся доля D / (N + D) массы, поровну на все пустые ячейки.
+// n-граммы из одних границ (знаки между словами) не считаются ни здесь,
+// ни при определении.
+
+static uint32_t counts[TABLE_SIZE];
+
+static void train(const char *sample, LangId lang) {
+    memset(counts, 0, sizeof(counts));
+    const unsigned char *s = (const unsigned char *)sample;
+    size_t len = strlen(sample), pos = 0;
+    uint32_t key = 0, other = 0;
+    uint64_t total = 0, distinct = 0;
+    while (pos < len) {
+        uint32_t id = next_id(s, len, &pos, &other);
+        int blank = id == 0 && (key & 0x7F) == 0;
+        key = ((key << 7) | id) & 0x1FFFFF;
+        if (blank) continue;
+        uint32_t slots[2] = { slot_of(BIGRAM_TAG | (key & 0x3FFF)), slot_of(key) };
+        for (int k = 0; k < 2; k++) {
+            if (counts[slots[k]]++ == 0) distinct++;
+            total++;
+        }
+    }
+    double seen_div = (double)(total + distinct);
+    double unseen_p = (double)distinct / (seen_div * (double)(TABLE_SIZE - distinct));
+    for (uint32_t i = 0; i < TABLE_SIZE; i++) {
+        double p = counts[i] ? counts[i] / seen_div : unseen_p;
+        long q = lround(-log2(p) * QSCALE);
+        if (q > 255) q = 255;
+        cost[i] |= (uint64_t)q << (8 * (lang - 1)) | COUNT_LANES;
+    }
+}
+
+static void build_table(void) {
+    for (uint32_t c = 0; c < 128; c++) {
+        if (c >= 'a' && c <= 'z') fast_id[c] = (uint8_t)(c - 'a' + 1);
+        else if (c >= 'A' && c <= 'Z') fast_id[c] = (uint8_t)(c - 'A' + 1);
+    }
+    for (uint32_t cp = 0x400; cp < 0x480; cp++) fast_id[128 + cp - 0x400] = (uint8_t)codepoint_id(cp);
+    for (uint32_t id = 1; id < 128; id++) {
+        id_lanes[id] = SCRIPT_LANES[id >= ID_CYR && id <= ID_GHE ? SCRIPT_CYRILLIC
+                                    : id == ID_OTHER ? SCRIPT_OTHER : SCRIPT_LATIN];
+    }
+    static const char *const samples[LANG_COUNT] = {
+        [LANG_EN] = LANGID_SAMPLE_EN, [LANG_RU] = LANGID_SAMPLE_RU, [LANG_UK] = LANGID_SAMPLE_UK,
+        [LANG_DE] = LANGID_SAMPLE_DE, [LANG_FR] = LANGID_SAMPLE_FR, [LANG_ES] = LANGID_SAMPLE_ES,
+    };
+    for (int lang = LANG_EN; lang < LANG_COUNT; lang++) train(samples[lang], (LangId)lang);
+}
+
+// === Определение ===
+
+#define LANE_MASK 0x00FF00FF00FF00FFull
+
+static inline void flush_lanes(uint32_t *sum, uint64_t lo, uint64_t hi) {
+    for (int k = 0; k < LANES / 2; k++) {
+        sum[2 * k] += (uint32_t)(lo >> (16 * k)) & 0xFFFF;
+        sum[2 * k + 1] += (uint32_t)(hi >> (16 * k)) & 0xFFFF;
+    }
+}
+
+LangId langid_detect(const char *text, size_t len, LangResult *res) {
+    pthread_once(&table_once, build_table);
+    if (len > LANGID_MAX_SCAN) len = LANGID_MAX_SCAN;
+    const unsigned char *s = (const unsigned char *)text;
+
+    // Стоимости всех языков складываются одним SWAR-сложением: чётные
+    // байты в 16-битные полосы lo, нечётные в hi; полосы сбрасываются в sum
+    // каждые FLUSH_EVERY байт (символов не больше). Письменность не выбирает
+    // ветку, а гасит чужие байты маской — в цикле нет ветвлений по тексту,
+    // кроме разбора UTF-8
+    uint32_t sum[LANES] = { 0 };
+    uint32_t key = 0, other = 0;
+    uint64_t lanes = SCRIPT_LANES[SCRIPT_LATIN];
+    size_t pos = 0;
+    while (pos < len) {
+        size_t end = len - pos > FLUSH_EVERY ? pos + FLUSH_EVERY : len;
+        uint64_t lo = 0, hi = 0;
+        while (pos < end) {
+            uint32_t id = next_id(s, len, &pos, &other);
+            // Маски — арифметикой: условный оператор gcc превращает в переход,
+            // который ошибается на каждой границе слова
+            uint64_t keep = 0 - (uint64_t)((id | (key & 0x7F)) != 0);    // не повтор границы
+            key = ((key << 7) | id) & 0x1FFFFF;
+            lanes = id_lanes[id] | (lanes & ((uint64_t)(id != 0) - 1));  // граница — письменность слова перед ней
+            uint64_t mask = keep & lanes;
+            uint64_t a = cost[slot_of(BIGRAM_TAG | (key & 0x3FFF))] & mask;
+            uint64_t b = cost[slot_of(key)] & mask;
+            lo += (a & LANE_MASK) + (b & LANE_MASK);
+            hi += ((a >> 8) & LANE_MASK) + ((b >> 8) & LANE_MASK);
+        }
+        flush_lanes(sum, lo, hi);
+    }
+
+    // Письменность (по числу n-грамм; символов примерно вдвое меньше),
+    // затем лучший язык внутри неё
+    LangResult r = { .lang = LANG_UND };
+    uint32_t latin = sum[COUNT_LATIN], cyrillic = sum[COUNT_CYRILLIC];
+    if (latin + cyrillic > 0 && other <= (latin + cyrillic) / 2) {
+        static const LangId LATIN[] = { LANG_EN, LANG_DE, LANG_FR, LANG_ES };
+        static const LangId CYRILLIC[] = { LANG_RU, LANG_UK };
+        int cyr = cyrillic * 3 >= latin + cyrillic;
+        const LangId *cand = cyr ? CYRILLIC : LATIN;
+        size_t n = cyr ? 2 : 4;
+        LangId best = cand[0];
+        uint32_t best_cost = UINT32_MAX, second_cost = UINT32_MAX;
+        for (size_t k = 0; k < n; k++) {
+            uint32_t c = sum[cand[k] - 1];
+            if (c < best_cost) { second_cost = best_cost; best_cost = c; best = cand[k]; }
+            else if (c < second_cost) second_cost = c;
+        }
+        r.ngrams = cyr ? cyrillic : latin;
+        r.margin = (double)(second_cost - best_cost) / QSCALE;
+        if (r.ngrams >= LANGID_MIN_NGRAMS && r.margin >= LANGID_MIN_MARGIN) r.lang = best;
+    }
+    if (res) *res = r;
+    return r.lang;
+}
+
+const char *langid_name(LangId lang) {
+    return (unsigned)lang < LANG_COUNT ? LANG_NAMES[lang] : "und";
+}
+
+int langid_parse(const char *name, size_t len) {
+    for (int i = 0; i < LANG_COUNT; i++) {
+        if (strlen(LANG_NAMES[i]) == len && strncmp(LANG_NAMES[i], name, len) == 0) return i;
+    }
+    return -1;
+}
+
+// === Фильтр ===
+
+int langid_filter_parse(LangFilter *f, const char *allow, const char *quota) {
+    memset(f, 0, sizeof(*f));
+    for (const char *p = allow; p && *p;) {
+        size_t n = strcspn(p, ",");
+        int lang = langid_parse(p, n);
+        if (lang < 0) return -1;
+        f->allow |= 1u << lang;
+        p += n + (p[n] == ',');
+    }
+    for (const char *p = quota; p && *p;) {
+        size_t n = strcspn(p, ",");
+        const char *colon = memchr(p, ':', n);
+        if (!colon) return -1;
+        int lang = langid_parse(p, (size_t)(colon - p));
+        if (lang < 0 || colon + 1 == p + n) return -1;
+        uint64_t v = 0;
+        for (const char *d = colon + 1; d < p + n; d++) {
+            if (*d < '0' || *d > '9') return -1;
+            v = v * 10 + (uint64_t)(*d - '0');
+        }
+        f->quota[lang] = v;
+        p += n + (p[n] == ',');
+    }
+    return 0;
+}
+
+int langid_filter_admit(LangFilter *f, LangId lang) {
+    if (!f->allow || (f->allow & (1u << lang))) return 1;
+    __atomic_fetch_add(&f->rejected[lang], 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+int langid_filter_take(LangFilter *f, LangId lang) {
+    uint64_t limit = f->quota[lang];
+    if (!limit) {
+        __atomic_fetch_add(&f->taken[lang], 1, __ATOMIC_RELAXED);
+        return 1;
+    }
+    uint64_t t = __atomic_load_n(&f->taken[lang], __ATOMIC_RELAXED);
+    do {
+        if (t >= limit) {
+            __atomic_fetch_add(&f->rejected[lang], 1, __ATOMIC_RELAXED);
+            return 0;
+        }
+    } while (!__atomic_compare_exchange_n(&f->taken[lang], &t, t + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    return 1;
+}
+
+void langid_filter_refund(LangFilter *f, LangId lang) {
+    __atomic_fetch_sub(&f->taken[lang], 1, __ATOMIC_RELAXED);
+}
+
+void langid_filter_summary(const LangFilter *f, char *buf, size_t size) {
+    size_t len = 0;
+    if (size) buf[0] = '\0';
+    for (int lang = LANG_EN; lang <= LANG_COUNT; lang++) {
+        int l = lang % LANG_COUNT;  // und — последним
+        uint64_t taken = __atomic_load_n(&f->taken[l], __ATOMIC_RELAXED);
+        uint64_t rejected = __atomic_load_n(&f->rejected[l], __ATOMIC_RELAXED);
+        if (!taken && !rejected) continue;
+        int n = rejected ? snprintf(buf + len, size - len, "%s%s %llu (+%llu dropped)", len ? ", " : "",
+                                    LANG_NAMES[l], (unsigned long long)taken, (unsigned long long)rejected)
+                         : snprintf(buf + len, size - len, "%s%s %llu", len ? ", " : "",
+                                    LANG_NAMES[l], (unsigned long long)taken);
+        if (n < 0 || (size_t)n >= size - len) break;
+        len += (size_t)n;
+    }
+}
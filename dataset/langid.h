@@ -0,0 +1,84 @@
+// langid.h — определение языка текста по символьным n-граммам
+//
+// Текст проходится один раз, без копий и выделений памяти: кодовые точки
+// UTF-8 сворачиваются в маленький алфавит (строчные латиница с
+// диакритикой и кириллица, всё прочее — граница слова), каждая биграмма и
+// триграмма хешируется в таблицу стоимостей, и по всем языкам сразу
+// накапливается −log2 P (восемь байт на ячейку, сложение SWAR по 16 бит).
+// Таблица строится один раз из образцов текста (langid_samples.h) при
+// первом вызове и дальше только читается — вызовы из разных потоков
+// безопасны.
+//
+// Письменность выбирается до сравнения: кириллицы не меньше трети n-грамм —
+// выбор между ru и uk, иначе между en, de, fr и es. Так русский текст с
+// английскими терминами и кодом не уходит в en. Смотрятся первые
+// LANGID_MAX_SCAN байт; мало букв, другая письменность или слишком
+// близкие оценки — LANG_UND.
+
+#ifndef LANGID_H
+#define LANGID_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define LANGID_MAX_SCAN (16 * 1024)
+#define LANGID_MIN_NGRAMS 24       // меньше n-грамм своей письменности — und
+#define LANGID_MIN_MARGIN 4.0      // бит между лучшим и вторым языком
+
+typedef enum {
+    LANG_UND = 0,
+    LANG_EN,
+    LANG_RU,
+    LANG_UK,
+    LANG_DE,
+    LANG_FR,
+    LANG_ES,
+    LANG_COUNT
+} LangId;
+
+typedef struct {
+    LangId lang;
+    double margin;             // бит между лучшим и вторым языком
+    uint32_t ngrams;           // n-грамм выбранной письменности
+} LangResult;
+
+// res может быть NULL
+LangId langid_detect(const char *text, size_t len, LangResult *res);
+
+// "en", "ru", ... ; "und" для LANG_UND
+const char *langid_name(LangId lang);
+// LANG_UND ("und") или -1, если код неизвестен
+int langid_parse(const char *name, size_t len);
+
+// === Фильтр и квоты ===
+// Разрешённые языки и предельное число записей на язык. Счётчики
+// атомарные: один фильтр можно разделить между потоками.
+// Порядок проверок: langid_filter_admit, затем langid_filter_take, и только
+// потом дедупликация — отброшенная по языку или квоте запись не попадает в
+// индекс и достанется прогону с другим списком или квотой. Дубликат
+// возвращает место в квоте через langid_filter_refund.
+
+typedef struct {
+    uint32_t allow;                // битовая маска (1 << LangId); 0 — все
+    uint64_t quota[LANG_COUNT];    // 0 — без ограничения
+    uint64_t taken[LANG_COUNT];
+    uint64_t rejected[LANG_COUNT]; // не разрешён язык или квота исчерпана
+} LangFilter;
+
+// allow: "en,ru,und"; quota: "ru:5000,en:20000". Любой может быть NULL.
+// 0 или -1 (неизвестный язык, битое число)
+int langid_filter_parse(LangFilter *f, const char *allow, const char *quota);
+
+// Разрешён ли язык: 1 или 0 (засчитывается в rejected)
+int langid_filter_admit(LangFilter *f, LangId lang);
+
+// Место в квоте языка: 1 — писать, 0 — квота исчерпана (засчитывается в rejected)
+int langid_filter_take(LangFilter *f, LangId lang);
+
+// Вернуть место, взятое langid_filter_take, — запись всё же не пишется
+void langid_filter_refund(LangFilter *f, LangId lang);
+
+// Сводка "en 120, ru 40 (quota: 17 dropped), und 3" для итоговой печати
+void langid_filter_summary(const LangFilter *f, char *buf, size_t size);
+
+#endif // LANGID_H
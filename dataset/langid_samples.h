@@ -0,0 +1,200 @@
+// langid_samples.h — образцы текста, из которых langid.c строит таблицу
+//
+// По несколько абзацев обычной и технической прозы на язык, близкой к
+// тому, что попадает в датасет (учебники, документация, ответы). Объёмы
+// примерно равны: от объёма зависит стоимость невиданных n-грамм.
+// Включается только в langid.c.
+
+#ifndef LANGID_SAMPLES_H
+#define LANGID_SAMPLES_H
+
+static const char LANGID_SAMPLE_EN[] =
+    "The kernel is the part of the operating system that is always resident in memory. "
+    "It manages the processor, the memory and the devices, and it decides which process "
+    "runs next. When a program needs a service from the kernel, such as reading a file or "
+    "creating a new thread, it makes a system call. The processor switches to a privileged "
+    "mode, the kernel checks the arguments, does the work and returns the result to the "
+    "caller.\n\n"
+    "A pointer is a variable that holds the address of another variable. In C you can take "
+    "the address of an object with the ampersand operator and follow a pointer with the "
+    "asterisk. Pointers make it possible to pass large structures to functions without "
+    "copying them, to build linked lists and trees, and to work with memory that was "
+    "allocated at run time. They are also the most common source of bugs: a pointer that "
+    "refers to freed memory, or one that was never initialized, can crash the program or "
+    "quietly corrupt its data.\n\n"
+    "Before you start writing your own boot loader, make sure you understand how the machine "
+    "gets from power on to the first instruction of your code. The firmware initializes the "
+    "hardware, finds a bootable device and loads the first sector into memory. From there it "
+    "is your job to switch the processor into protected mode, set up a stack and a global "
+    "descriptor table, and then jump into the kernel. Take your time, read the manuals, and "
+    "test every step in an emulator before you try it on real hardware.\n\n"
+    "We were walking home through the old part of the town when it started to rain. The "
+    "streets were empty, the shops had already closed, and only a few windows were still "
+    "lit. My brother said that he would rather get wet than wait under a roof for an hour, "
+    "so we kept going. By the time we reached the house we were soaked to the skin, but "
+    "nobody was angry. Mother made tea, and we sat in the kitchen talking about what we "
+    "would do during the summer holidays.\n\n"
+    "This function returns zero on success. If an error occurs, it returns minus one and "
+    "sets errno to indicate the error. The behaviour is undefined if the buffer is smaller "
+    "than the length given in the second argument. Note that the call may be interrupted by "
+    "a signal handler, in which case it should simply be restarted. Which of these cases "
+    "applies depends on the flags that were passed when the descriptor was opened.";
+
+static const char LANGID_SAMPLE_RU[] =
+    "Ядро — это часть операционной системы, которая всегда находится в памяти. Оно "
+    "управляет процессором, памятью и устройствами и решает, какой процесс будет выполняться "
+    "следующим. Когда программе нужна услуга ядра, например прочитать файл или создать новый "
+    "поток, она делает системный вызов. Процессор переходит в привилегированный режим, ядро "
+    "проверяет аргументы, выполняет работу и возвращает результат вызывающему.\n\n"
+    "Указатель — это переменная, в которой хранится адрес другой переменной. В языке C адрес "
+    "объекта можно получить оператором амперсанд, а разыменовать указатель — звёздочкой. "
+    "Указатели позволяют передавать большие структуры в функции без копирования, строить "
+    "связные списки и деревья и работать с памятью, выделенной во время выполнения. Они же "
+    "чаще всего становятся источником ошибок: указатель на уже освобождённую память или "
+    "неинициализированный указатель может обрушить программу или незаметно испортить данные.\n\n"
+    "Прежде чем писать собственный загрузчик, разберитесь, как машина проходит путь от "
+    "включения питания до первой инструкции вашего кода. Прошивка инициализирует "
+    "оборудование, находит загрузочное устройство и читает первый сектор в память. Дальше "
+    "ваша задача — перевести процессор в защищённый режим, подготовить стек и глобальную "
+    "таблицу дескрипторов, а затем передать управление ядру. Не торопитесь, читайте "
+    "документацию и проверяйте каждый шаг в эмуляторе, прежде чем запускать на настоящем "
+    "железе.\n\n"
+    "Мы шли домой через старую часть города, когда начался дождь. Улицы были пусты, магазины "
+    "уже закрылись, и лишь в нескольких окнах ещё горел свет. Брат сказал, что лучше "
+    "промокнуть, чем час ждать под крышей, и мы пошли дальше. Когда мы добрались до дома, "
+    "вымокли до нитки, но никто не сердился. Мама заварила чай, и мы сидели на кухне и "
+    "говорили о том, чем займёмся летом.\n\n"
+    "Эта функция возвращает ноль в случае успеха. При ошибке она возвращает минус единицу и "
+    "устанавливает errno. Поведение не определено, если буфер меньше длины, переданной во "
+    "втором аргументе. Учтите, что вызов может быть прерван обработчиком сигнала, и тогда его "
+    "нужно просто повторить. Какой из этих случаев возможен, зависит от флагов, с которыми "
+    "был открыт дескриптор. Как определить, скомпилирован ли бинарник с защитой стека? "
+    "Проверьте наличие символа в таблице символов.";
+
+static const char LANGID_SAMPLE_UK[] =
+    "Ядро — це частина операційної системи, яка завжди перебуває в пам'яті. Воно керує "
+    "процесором, пам'яттю та пристроями і вирішує, який процес виконуватиметься наступним. "
+    "Коли програмі потрібна послуга ядра, наприклад прочитати файл або створити новий потік, "
+    "вона робить системний виклик. Процесор переходить у привілейований режим, ядро перевіряє "
+    "аргументи, виконує роботу й повертає результат тому, хто викликав.\n\n"
+    "Вказівник — це змінна, у якій зберігається адреса іншої змінної. У мові C адресу об'єкта "
+    "можна отримати оператором амперсанд, а розіменувати вказівник — зірочкою. Вказівники "
+    "дають змогу передавати великі структури у функції без копіювання, будувати зв'язні "
+    "списки й дерева та працювати з пам'яттю, виділеною під час виконання. Вони ж найчастіше "
+    "стають джерелом помилок: вказівник на вже звільнену пам'ять чи неініціалізований "
+    "вказівник може зруйнувати програму або непомітно зіпсувати дані.\n\n"
+    "Перш ніж писати власний завантажувач, з'ясуйте, як машина проходить шлях від увімкнення "
+    "живлення до першої інструкції вашого коду. Мікропрограма ініціалізує обладнання, "
+    "знаходить завантажувальний пристрій і читає перший сектор у пам'ять. Далі ваше "
+    "завдання — перевести процесор у захищений режим, підготувати стек і глобальну таблицю "
+    "дескрипторів, а потім передати керування ядру. Не поспішайте, читайте документацію та "
+    "перевіряйте кожен крок в емуляторі, перш ніж запускати на справжньому залізі.\n\n"
+    "Ми йшли додому через стару частину міста, коли почався дощ. Вулиці були порожні, "
+    "крамниці вже зачинилися, і лише в кількох вікнах ще світилося. Брат сказав, що краще "
+    "змокнути, ніж годину чекати під дахом, і ми пішли далі. Коли ми дісталися до хати, то "
+    "змокли до нитки, але ніхто не сердився. Мама заварила чай, і ми сиділи на кухні й "
+    "говорили про те, чим займемося влітку. Їжак ґречно позіхнув.\n\n"
+    "Ця функція повертає нуль у разі успіху. У разі помилки вона повертає мінус одиницю та "
+    "встановлює errno. Поведінку не визначено, якщо буфер менший за довжину, передану в "
+    "другому аргументі. Зважте, що виклик може бути перервано обробником сигналу, і тоді його "
+    "треба просто повторити. Який із цих випадків можливий, залежить від прапорців, з якими "
+    "було відкрито дескриптор. Як визначити, чи скомпільовано двійковий файл із захистом стека?";
+
+static const char LANGID_SAMPLE_DE[] =
+    "Der Kernel ist der Teil des Betriebssystems, der sich immer im Speicher befindet. Er "
+    "verwaltet den Prozessor, den Speicher und die Geräte und entscheidet, welcher Prozess "
+    "als nächster läuft. Wenn ein Programm einen Dienst des Kernels braucht, zum Beispiel eine "
+    "Datei lesen oder einen neuen Thread erzeugen, führt es einen Systemaufruf aus. Der "
+    "Prozessor wechselt in einen privilegierten Modus, der Kernel prüft die Argumente, "
+    "erledigt die Arbeit und gibt das Ergebnis an den Aufrufer zurück.\n\n"
+    "Ein Zeiger ist eine Variable, die die Adresse einer anderen Variablen enthält. In C "
+    "erhält man die Adresse eines Objekts mit dem Operator und, und mit dem Stern folgt man "
+    "einem Zeiger. Zeiger erlauben es, große Strukturen ohne Kopie an Funktionen zu übergeben, "
+    "verkettete Listen und Bäume aufzubauen und mit Speicher zu arbeiten, der zur Laufzeit "
+    "angefordert wurde. Sie sind aber auch die häufigste Fehlerquelle: ein Zeiger auf bereits "
+    "freigegebenen Speicher oder ein nicht initialisierter Zeiger kann das Programm abstürzen "
+    "lassen oder unbemerkt seine Daten zerstören.\n\n"
+    "Bevor Sie einen eigenen Bootloader schreiben, sollten Sie verstehen, wie die Maschine vom "
+    "Einschalten bis zur ersten Anweisung Ihres Codes gelangt. Die Firmware initialisiert die "
+    "Hardware, sucht ein startfähiges Gerät und lädt den ersten Sektor in den Speicher. Danach "
+    "ist es Ihre Aufgabe, den Prozessor in den geschützten Modus zu schalten, einen Stapel und "
+    "eine globale Deskriptortabelle einzurichten und dann in den Kernel zu springen. Lassen "
+    "Sie sich Zeit, lesen Sie die Handbücher und testen Sie jeden Schritt im Emulator.\n\n"
+    "Wir gingen gerade durch die Altstadt nach Hause, als es zu regnen begann. Die Straßen "
+    "waren leer, die Geschäfte hatten schon geschlossen, und nur in wenigen Fenstern brannte "
+    "noch Licht. Mein Bruder sagte, er werde lieber nass, als eine Stunde unter einem Dach zu "
+    "warten, also gingen wir weiter. Als wir das Haus erreichten, waren wir bis auf die Haut "
+    "durchnässt, aber niemand war böse. Die Mutter kochte Tee, und wir saßen in der Küche.\n\n"
+    "Diese Funktion gibt bei Erfolg null zurück. Tritt ein Fehler auf, gibt sie minus eins "
+    "zurück und setzt errno entsprechend. Das Verhalten ist undefiniert, wenn der Puffer "
+    "kleiner ist als die im zweiten Argument angegebene Länge. Beachten Sie, dass der Aufruf "
+    "durch einen Signalhandler unterbrochen werden kann; in diesem Fall wird er einfach "
+    "wiederholt. Welcher Fall eintritt, hängt von den Flags ab, mit denen der Deskriptor "
+    "geöffnet wurde.";
+
+static const char LANGID_SAMPLE_FR[] =
+    "Le noyau est la partie du système d'exploitation qui reste toujours en mémoire. Il gère "
+    "le processeur, la mémoire et les périphériques, et il décide quel processus sera exécuté "
+    "ensuite. Lorsqu'un programme a besoin d'un service du noyau, par exemple lire un fichier "
+    "ou créer un nouveau fil d'exécution, il effectue un appel système. Le processeur passe "
+    "dans un mode privilégié, le noyau vérifie les arguments, fait le travail et renvoie le "
+    "résultat à l'appelant.\n\n"
+    "Un pointeur est une variable qui contient l'adresse d'une autre variable. En C, on obtient "
+    "l'adresse d'un objet avec l'opérateur esperluette et on suit un pointeur avec l'étoile. "
+    "Les pointeurs permettent de passer de grandes structures aux fonctions sans les copier, "
+    "de construire des listes chaînées et des arbres, et de travailler avec de la mémoire "
+    "allouée pendant l'exécution. Ce sont aussi la source d'erreurs la plus fréquente : un "
+    "pointeur vers une mémoire déjà libérée, ou qui n'a jamais été initialisé, peut faire "
+    "planter le programme ou corrompre ses données sans bruit.\n\n"
+    "Avant d'écrire votre propre chargeur d'amorçage, assurez-vous de comprendre comment la "
+    "machine passe de la mise sous tension à la première instruction de votre code. Le "
+    "micrologiciel initialise le matériel, trouve un périphérique amorçable et charge le "
+    "premier secteur en mémoire. Ensuite, c'est à vous de faire passer le processeur en mode "
+    "protégé, de préparer une pile et une table globale de descripteurs, puis de sauter dans "
+    "le noyau. Prenez votre temps, lisez les manuels et testez chaque étape dans un émulateur.\n\n"
+    "Nous rentrions à la maison par la vieille ville quand il a commencé à pleuvoir. Les rues "
+    "étaient vides, les magasins avaient déjà fermé, et seules quelques fenêtres étaient "
+    "encore éclairées. Mon frère a dit qu'il préférait être mouillé plutôt que d'attendre une "
+    "heure sous un toit, alors nous avons continué. En arrivant, nous étions trempés jusqu'aux "
+    "os, mais personne n'était fâché. Notre mère a fait du thé et nous sommes restés dans la "
+    "cuisine à parler des vacances d'été.\n\n"
+    "Cette fonction renvoie zéro en cas de succès. En cas d'erreur, elle renvoie moins un et "
+    "positionne errno pour indiquer l'erreur. Le comportement est indéfini si le tampon est "
+    "plus petit que la longueur donnée dans le deuxième argument. Notez que l'appel peut être "
+    "interrompu par un gestionnaire de signal ; dans ce cas il suffit de le relancer. Le cas "
+    "qui s'applique dépend des options passées à l'ouverture du descripteur.";
+
+static const char LANGID_SAMPLE_ES[] =
+    "El núcleo es la parte del sistema operativo que siempre está en memoria. Administra el "
+    "procesador, la memoria y los dispositivos, y decide qué proceso se ejecutará a "
+    "continuación. Cuando un programa necesita un servicio del núcleo, por ejemplo leer un "
+    "archivo o crear un nuevo hilo, hace una llamada al sistema. El procesador cambia a un "
+    "modo privilegiado, el núcleo comprueba los argumentos, hace el trabajo y devuelve el "
+    "resultado a quien lo llamó.\n\n"
+    "Un puntero es una variable que guarda la dirección de otra variable. En C se obtiene la "
+    "dirección de un objeto con el operador ampersand y se sigue un puntero con el asterisco. "
+    "Los punteros permiten pasar estructuras grandes a las funciones sin copiarlas, construir "
+    "listas enlazadas y árboles, y trabajar con memoria reservada en tiempo de ejecución. "
+    "También son la fuente de errores más común: un puntero a memoria ya liberada, o uno que "
+    "nunca se inicializó, puede hacer que el programa falle o que sus datos se corrompan sin "
+    "que nadie lo note.\n\n"
+    "Antes de escribir tu propio cargador de arranque, asegúrate de entender cómo la máquina "
+    "pasa del encendido a la primera instrucción de tu código. El firmware inicializa el "
+    "hardware, busca un dispositivo de arranque y carga el primer sector en la memoria. A "
+    "partir de ahí tu trabajo es pasar el procesador a modo protegido, preparar una pila y una "
+    "tabla global de descriptores, y luego saltar al núcleo. Tómate tu tiempo, lee los "
+    "manuales y prueba cada paso en un emulador antes de usar el equipo real.\n\n"
+    "Volvíamos a casa por la parte vieja de la ciudad cuando empezó a llover. Las calles "
+    "estaban vacías, las tiendas ya habían cerrado y solo unas pocas ventanas seguían "
+    "encendidas. Mi hermano dijo que prefería mojarse antes que esperar una hora bajo un "
+    "techo, así que seguimos caminando. Cuando llegamos estábamos empapados, pero nadie se "
+    "enfadó. Mamá preparó té y nos quedamos en la cocina hablando de lo que haríamos en las "
+    "vacaciones de verano. ¿Quién no ha soñado con el mar? ¡Qué niño tan pequeño!\n\n"
+    "Esta función devuelve cero si tiene éxito. Si ocurre un error, devuelve menos uno y "
+    "establece errno para indicar el error. El comportamiento no está definido si el búfer es "
+    "más pequeño que la longitud indicada en el segundo argumento. Ten en cuenta que la "
+    "llamada puede ser interrumpida por un manejador de señales; en ese caso basta con "
+    "repetirla. Cuál de estos casos se aplica depende de las opciones con las que se abrió el "
+    "descriptor.";
+
+#endif // LANGID_SAMPLES_H
@@ -0,0 +1,728 @@
+// merge.c — сборка всех источников в один обучающий датасет
+// gcc -O2 -o merge_dataset merge.c fpindex.c json_escape.c ds_writer.c -lssl -lcrypto -lz -pthread
+// ./merge_dataset [--train FILE] [--val FILE] [--val-ratio R] [--seed N] [--jobs N]
+//                 [--mem-mb N] [--tmp DIR] [--dedup-index FILE]
+//                 [--compress gzip|zstd] [--shard-records N] [--shard-bytes N]
+//                 input[:CATEGORY]...
+// Понимает все форматы сборщиков, по записи на строку или подряд/в JSON-массиве:
+//   {"messages":[...],"metadata":{...}}   — dataset.c (metadata может не быть);
+//   {"instruction","output"[,"input"]}    — pars.sh / pars, memory.txt;
+//   {"url","title","content",...}         — test/parser.c.
+// Всё приводится к схеме dataset.c: {"messages":[...],"metadata":{"source","category","lang"}}.
+// CATEGORY — категория для записей без своей (по умолчанию General), source — url
+// или имя входного файла, lang — из "lang" или "language" записи, иначе "und".
+//
+// Один проход: входы отображаются через mmap и разбираются без копирования (строки
+// без escape-последовательностей переносятся в вывод как есть). Перемешивание
+// внешней памятью: запись получает 64-битный ключ от отпечатка ответа ассистента
+// (со схлопнутыми пробелами) и --seed и уходит во временный файл своего диапазона
+// ключей; каждый файл затем сортируется в памяти, так что вывод — равномерная
+// перестановка корпуса любого размера. Файл больше --mem-mb/2 перед сортировкой
+// ещё раз делится на поддиапазоны. Дубликаты получают один ключ и после
+// сортировки стоят рядом: остаётся запись, первая по порядку входов (номер входа,
+// смещение), так что вывод не зависит от --jobs. Отпечатки оставленных записей
+// идут в отдельный fpindex (--dedup-index — сохранить его для следующих слияний:
+// непустой индекс значит, что его записи уже в train/val, и вывод дописывается).
+// Принадлежность к val зависит только от содержимого: при смене --seed или росте
+// корпуса запись не перебегает между train и val.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "fpindex.h"
+#include "json_escape.h"
+#include "ds_writer.h"
+
+#define MERGE_SEGMENT_BYTES (8u << 20)   // JSONL-вход режется на куски для потоков
+#define MERGE_MAX_BUCKETS 512
+#define MERGE_DEFAULT_CATEGORY "General"
+
+typedef enum { FMT_MESSAGES, FMT_INSTRUCTION, FMT_ARTICLE, FMT_COUNT } RecordFormat;
+
+typedef struct {
+    char path[4096];
+    const char *category;
+    const char *data;          // mmap
+    size_t size;
+    uint64_t objects;
+    uint64_t formats[FMT_COUNT];
+    uint64_t broken;
+    uint64_t duplicates;
+} MergeInput;
+
+typedef struct {
+    size_t input;
+    size_t start, end;
+} MergeSegment;
+
+// Временный файл диапазона ключей: SpillHeader + строка записи, подряд
+typedef struct {
+    FILE *f;
+    pthread_mutex_t lock;
+    uint64_t records;
+    uint64_t bytes;
+} MergeBucket;
+
+typedef struct {
+    uint64_t key;
+    unsigned char fp[FPINDEX_FP_SIZE];
+    uint64_t pos;              // смещение объекта во входе: кто из дубликатов остаётся
+    uint32_t input;
+    uint32_t len;
+    uint32_t val;              // 1 — запись идёт в val
+    uint32_t pad;
+} SpillHeader;
+
+typedef struct {
+    MergeInput *inputs;
+    MergeSegment *segments;
+    size_t segment_count;
+    size_t next;               // атомарный счётчик сегментов
+    MergeBucket *buckets;
+    size_t bucket_count;
+    uint64_t seed;
+    uint64_t val_threshold;    // val, если mix64(отпечаток) < порога
+    int val_all;
+    int failed;
+} MergeShared;
+
+typedef struct {
+    StrBuf rec;
+    StrBuf tmp;                // раскодированное значение
+    StrBuf text;               // ответ ассистента для отпечатка
+} MergeScratch;
+
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// === Разбор ===
+
+// Конец строки JSON: s указывает после открывающей кавычки; NULL — строка не закрыта
+static const char *string_close(const char *s, const char *end) {
+    while (s < end) {
+        const char *q = memchr(s, '"', (size_t)(end - s));
+        if (!q) return NULL;
+        const char *b = q;
+        while (b > s && b[-1] == '\\') b--;
+        if (((q - b) & 1) == 0) return q;
+        s = q + 1;
+    }
+    return NULL;
+}
+
+// Следующий объект верхнего уровня в [*pos, end): JSONL, объекты подряд
+// (в том числе многострочные) или элементы JSON-массива. 1 — найден,
+// 0 — конец, -1 — оборванный объект в конце
+static int next_object(const char *data, size_t end, size_t *pos, const char **obj, size_t *len) {
+    const char *p = data + *pos, *e = data + end;
+    p = memchr(p, '{', (size_t)(e - p));
+    if (!p) { *pos = end; return 0; }
+    const char *start = p;
+    int depth = 0;
+    for (; p < e; p++) {
+        char c = *p;
+        if (c == '"') {
+            p = string_close(p + 1, e);
+            if (!p) break;
+        } else if (c == '{' || c == '[') {
+            depth++;
+        } else if ((c == '}' || c == ']') && --depth == 0) {
+            *obj = start;
+            *len = (size_t)(p + 1 - start);
+            *pos = (size_t)(p + 1 - data);
+            return 1;
+        }
+    }
+    *pos = end;
+    return -1;
+}
+
+static int is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Текст с пробельными последовательностями, схлопнутыми в один пробел, и без краёв
+static int append_collapsed(StrBuf *b, const char *s, size_t len) {
+    if (strbuf_reserve(b, len + 1) != 0) return -1;
+    char *o = b->data + b->len;
+    int pending = b->len > 0;   // пробел перед следующим словом
+    for (size_t i = 0; i < len; i++) {
+        if (is_space(s[i])) { pending = o != b->data; continue; }
+        if (pending) *o++ = ' ';
+        pending = 0;
+        *o++ = s[i];
+    }
+    b->len = (size_t)(o - b->data);
+    return 0;
+}
+
+// Значение (тело строки JSON) в запись; при text != NULL раскодированное — ещё и туда.
+// Тело без '\\' уже в каноническом виде и копируется как есть
+static int append_value(MergeScratch *s, const char *val, size_t len, StrBuf *text) {
+    if (!memchr(val, '\\', len)) {
+        if (strbuf_append(&s->rec, val, len) != 0) return -1;
+        return text ? append_collapsed(text, val, len) : 0;
+    }
+    strbuf_reset(&s->tmp);
+    if (json_unescape_append(&s->tmp, val, len) != 0 ||
+        json_escape_append(&s->rec, s->tmp.data, s->tmp.len) != 0) return -1;
+    return text ? append_collapsed(text, s->tmp.data, s->tmp.len) : 0;
+}
+
+static int append_message(MergeScratch *s, int first, const char *role, size_t role_len,
+                          const char *content, size_t content_len, StrBuf *text) {
+    int rc = 0;
+    rc |= strbuf_append_str(&s->rec, first ? "{\"role\":\"" : ",{\"role\":\"");
+    rc |= append_value(s, role, role_len, NULL);
+    rc |= strbuf_append_str(&s->rec, "\",\"content\":\"");
+    rc |= append_value(s, content, content_len, text);
+    rc |= strbuf_append_str(&s->rec, "\"}");
+    return rc;
+}
+
+typedef struct {
+    MergeScratch *s;
+    int n;
+} MessageCopy;
+
+// Реплика messages-записи в s->rec; ответы ассистента — ещё и в s->text
+static int copy_message(void *ud, const char *role, size_t role_len, const char *content, size_t content_len) {
+    MessageCopy *m = ud;
+    int assistant = role_len == 9 && memcmp(role, "assistant", 9) == 0;
+    return append_message(m->s, m->n++ == 0, role, role_len, content, content_len,
+                          assistant ? &m->s->text : NULL) != 0 ? -1 : 0;
+}
+
+// Запись в схеме dataset.c в s->rec, ответ для отпечатка в s->text.
+// Формат записи или -1, если запись не распознана или битая
+static int convert(MergeScratch *s, const char *obj, size_t len, const MergeInput *in) {
+    const char *a, *b, *c;
+    size_t a_len, b_len, c_len;
+    const char *source = NULL, *category = NULL, *lang = NULL;
+    size_t source_len = 0, category_len = 0, lang_len = 0;
+    int fmt = -1, rc = 0;
+
+    strbuf_reset(&s->rec);
+    strbuf_reset(&s->text);
+    rc |= strbuf_append_str(&s->rec, "{\"messages\":[");
+
+    // Все реплики по порядку (ключи в любом порядке, как в chunk.c и ann.c);
+    // отпечаток — по ответам ассистента
+    MessageCopy copy = { s, 0 };
+    if (json_each_message(obj, len, copy_message, &copy) != 0) return -1;
+    if (copy.n > 0) {
+        fmt = FMT_MESSAGES;
+    } else if (json_find_string(obj, len, "instruction", &a, &a_len) == 0 &&
+               json_find_string(obj, len, "output", &b, &b_len) == 0) {
+        rc |= strbuf_append_str(&s->rec, "{\"role\":\"user\",\"content\":\"");
+        rc |= append_value(s, a, a_len, NULL);
+        // Alpaca-вход дописывается к инструкции
+        if (json_find_string(obj, len, "input", &c, &c_len) == 0 && c_len > 0) {
+            rc |= strbuf_append_str(&s->rec, "\\n\\n");
+            rc |= append_value(s, c, c_len, NULL);
+        }
+        rc |= strbuf_append_str(&s->rec, "\"}");
+        rc |= append_message(s, 0, "assistant", 9, b, b_len, &s->text);
+        fmt = FMT_INSTRUCTION;
+    } else if (json_find_string(obj, len, "content", &b, &b_len) == 0) {
+        // Статья parser.c: промпт как у dataset.c для сайтов
+        if (json_find_string(obj, len, "category", &category, &category_len) != 0) {
+            category = in->category;
+            category_len = strlen(category);
+        }
+        rc |= strbuf_append_str(&s->rec, "{\"role\":\"user\",\"content\":\"Explain this ");
+        rc |= append_value(s, category, category_len, NULL);
+        if (json_find_string(obj, len, "title", &a, &a_len) == 0 && a_len > 0) {
+            rc |= strbuf_append_str(&s->rec, " concept in detail for an OS developer:\\n\\n");
+            rc |= append_value(s, a, a_len, NULL);
+        } else {
+            rc |= strbuf_append_str(&s->rec, " technical content for an OS developer.");
+        }
+        rc |= strbuf_append_str(&s->rec, "\"}");
+        rc |= append_message(s, 0, "assistant", 9, b, b_len, &s->text);
+        json_find_string(obj, len, "url", &source, &source_len);
+        fmt = FMT_ARTICLE;
+    } else {
+        return -1;
+    }
+    if (rc != 0 || s->text.len == 0) return -1;
+
+    if (!source && json_find_string(obj, len, "source", &source, &source_len) != 0) source = NULL;
+    if (!category && json_find_string(obj, len, "category", &category, &category_len) != 0) {
+        category = in->category;
+        category_len = strlen(category);
+    }
+    rc |= strbuf_append_str(&s->rec, "],\"metadata\":{\"source\":\"");
+    if (source) rc |= append_value(s, source, source_len, NULL);
+    else rc |= json_escape_append(&s->rec, in->path, strlen(in->path));
+    rc |= strbuf_append_str(&s->rec, "\",\"category\":\"");
+    rc |= append_value(s, category, category_len, NULL);
+    // ingest.c и test/parser.c называют поле "language"
+    if (json_find_string(obj, len, "lang", &lang, &lang_len) != 0 &&
+        json_find_string(obj, len, "language", &lang, &lang_len) != 0) {
+        lang = "und";
+        lang_len = 3;
+    }
+    rc |= strbuf_append_str(&s->rec, "\",\"lang\":\"");
+    rc |= append_value(s, lang, lang_len, NULL);
+    rc |= strbuf_append_str(&s->rec, "\"}}\n");
+    return rc == 0 ? fmt : -1;
+}
+
+// === Первый проход: разбор, дедупликация, раскладка по диапазонам ключей ===
+
+// Номер поддиапазона ключа в [lo, lo + span) при делении на count частей
+static size_t range_slot(uint64_t key, uint64_t lo, unsigned __int128 span, size_t count) {
+    return (size_t)(((unsigned __int128)(key - lo) * count) / span);
+}
+
+#define FULL_SPAN ((unsigned __int128)1 << 64)
+
+static int spill(MergeShared *sh, const MergeScratch *s, const unsigned char *fp, size_t input, size_t pos) {
+    uint64_t lo, hi;
+    memcpy(&lo, fp, 8);
+    memcpy(&hi, fp + 8, 8);
+    SpillHeader h = {
+        .key = mix64(lo ^ sh->seed),
+        .pos = pos,
+        .input = (uint32_t)input,
+        .len = (uint32_t)s->rec.len,
+        .val = sh->val_all || mix64(hi) < sh->val_threshold,
+    };
+    memcpy(h.fp, fp, FPINDEX_FP_SIZE);
+    MergeBucket *b = &sh->buckets[range_slot(h.key, 0, FULL_SPAN, sh->bucket_count)];
+    pthread_mutex_lock(&b->lock);
+    int rc = fwrite(&h, sizeof(h), 1, b->f) == 1 &&
+             fwrite(s->rec.data, 1, s->rec.len, b->f) == s->rec.len ? 0 : -1;
+    if (rc == 0) {
+        b->records++;
+        b->bytes += sizeof(h) + s->rec.len;
+    }
+    pthread_mutex_unlock(&b->lock);
+    return rc;
+}
+
+static void *worker(void *arg) {
+    MergeShared *sh = (MergeShared *)arg;
+    MergeScratch s = {0};
+    unsigned char fp[FPINDEX_FP_SIZE];
+
+    for (;;) {
+        size_t i = __atomic_fetch_add(&sh->next, 1, __ATOMIC_RELAXED);
+        if (i >= sh->segment_count || __atomic_load_n(&sh->failed, __ATOMIC_RELAXED)) break;
+        MergeSegment *seg = &sh->segments[i];
+        MergeInput *in = &sh->inputs[seg->input];
+        size_t pos = seg->start;
+        const char *obj;
+        size_t len;
+        int found;
+
+        while ((found = next_object(in->data, seg->end, &pos, &obj, &len)) != 0) {
+            __atomic_fetch_add(&in->objects, 1, __ATOMIC_RELAXED);
+            int fmt = found > 0 ? convert(&s, obj, len, in) : -1;
+            if (fmt < 0 || s.rec.len > UINT32_MAX) {
+                __atomic_fetch_add(&in->broken, 1, __ATOMIC_RELAXED);
+                continue;
+            }
+            __atomic_fetch_add(&in->formats[fmt], 1, __ATOMIC_RELAXED);
+
+            // Дубликаты отсеиваются при записи диапазона, в порядке входов
+            fpindex_fingerprint(s.text.data, s.text.len, fp);
+            if (spill(sh, &s, fp, seg->input, (size_t)(obj - in->data)) != 0) {
+                fprintf(stderr, "⚠️  Spill failed: %s\n", strerror(errno));
+                __atomic_store_n(&sh->failed, 1, __ATOMIC_RELAXED);
+                break;
+            }
+        }
+    }
+    strbuf_free(&s.rec);
+    strbuf_free(&s.tmp);
+    strbuf_free(&s.text);
+    return NULL;
+}
+
+// Сегменты входа: JSONL режется по '\n' кусками ~MERGE_SEGMENT_BYTES,
+// массив и многострочные объекты (старый memory.txt) разбираются целиком
+static int add_segments(MergeShared *sh, size_t input, size_t *cap) {
+    const MergeInput *in = &sh->inputs[input];
+    size_t first = 0;
+    while (first < in->size && is_space(in->data[first])) first++;
+    int whole = first < in->size && (in->data[first] == '[' ||
+                (in->data[first] == '{' && first + 1 < in->size &&
+                 (in->data[first + 1] == '\n' || in->data[first + 1] == '\r')));
+
+    for (size_t pos = 0; pos < in->size;) {
+        size_t end = in->size;
+        if (!whole && in->size - pos > MERGE_SEGMENT_BYTES) {
+            const char *nl = memchr(in->data + pos + MERGE_SEGMENT_BYTES, '\n',
+                                    in->size - pos - MERGE_SEGMENT_BYTES);
+            if (nl) end = (size_t)(nl - in->data) + 1;
+        }
+        if (sh->segment_count == *cap) {
+            *cap = *cap ? *cap * 2 : 64;
+            MergeSegment *p = realloc(sh->segments, *cap * sizeof(*p));
+            if (!p) return -1;
+            sh->segments = p;
+        }
+        sh->segments[sh->segment_count++] = (MergeSegment){ input, pos, end };
+        pos = end;
+    }
+    return 0;
+}
+
+// === Второй проход: сортировка диапазонов и запись train/val ===
+
+typedef struct {
+    MergeInput *inputs;
+    FpIndex *dedup;
+    DsWriter *train, *val;
+    uint64_t n_train, n_val;
+    size_t budget;             // байт на диапазон, сортируемый в памяти
+    const char *tmp_dir;
+    unsigned split_seq;        // имена временных файлов поддиапазонов
+    size_t splits;
+} MergeEmit;
+
+typedef struct {
+    uint64_t key;
+    size_t off;
+} SpillEntry;
+
+// По ключу, при равных — по отпечатку, затем по порядку во входах:
+// дубликаты подряд, первым — тот, что раньше во входах
+static int cmp_entry(const void *a, const void *b, void *ctx) {
+    const SpillEntry *x = a, *y = b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    const char *data = ctx;
+    SpillHeader hx, hy;
+    memcpy(&hx, data + x->off, sizeof(hx));
+    memcpy(&hy, data + y->off, sizeof(hy));
+    int c = memcmp(hx.fp, hy.fp, FPINDEX_FP_SIZE);
+    if (c) return c;
+    if (hx.input != hy.input) return hx.input < hy.input ? -1 : 1;
+    return hx.pos < hy.pos ? -1 : hx.pos > hy.pos;
+}
+
+static int map_spill(const char *path, size_t bytes, char **data) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    *data = mmap(NULL, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    return *data == MAP_FAILED ? -1 : 0;
+}
+
+static int sort_and_write(MergeEmit *e, const char *path, uint64_t records, uint64_t bytes) {
+    char *data;
+    if (map_spill(path, bytes, &data) != 0) return -1;
+    SpillEntry *entries = malloc(records * sizeof(*entries));
+    if (!entries) { munmap(data, bytes); return -1; }
+
+    size_t n = 0;
+    for (size_t off = 0; off + sizeof(SpillHeader) <= bytes && n < records; n++) {
+        SpillHeader h;
+        memcpy(&h, data + off, sizeof(h));
+        entries[n] = (SpillEntry){ h.key, off };
+        off += sizeof(h) + h.len;
+    }
+    qsort_r(entries, n, sizeof(*entries), cmp_entry, data);
+
+    int rc = 0;
+    SpillHeader h, prev = { 0 };
+    for (size_t i = 0; i < n && rc == 0; i++) {
+        memcpy(&h, data + entries[i].off, sizeof(h));
+        MergeInput *in = &e->inputs[h.input];
+        int same = i > 0 && prev.key == h.key && memcmp(prev.fp, h.fp, FPINDEX_FP_SIZE) == 0;
+        prev = h;
+        if (same) { in->duplicates++; continue; }
+        // Уже было в прошлых слияниях с тем же --dedup-index; отпечаток
+        // откладывается до sync_outputs — в индексе только записанное на диск
+        int dup = fpindex_seen_fp(e->dedup, h.fp);
+        if (dup < 0) { rc = -1; break; }
+        if (dup == 1) { in->duplicates++; continue; }
+        rc = ds_writer_write(h.val ? e->val : e->train, data + entries[i].off + sizeof(h), h.len);
+        if (rc != 0) break;
+        (*(h.val ? &e->n_val : &e->n_train))++;
+        rc = fpindex_stage_fp(e->dedup, h.fp);
+    }
+    free(entries);
+    munmap(data, bytes);
+    return rc;
+}
+
+// Записи корзины — на диск, затем их отпечатки — в индекс: отложенных не
+// больше одной корзины, а упавшее слияние не оставит в индексе незаписанного
+static int sync_outputs(MergeEmit *e) {
+    if (ds_writer_sync(e->train) != 0 || ds_writer_sync(e->val) != 0) return -1;
+    return fpindex_commit(e->dedup);
+}
+
+// Диапазон ключей [lo, lo + span) из файла path. Больше бюджета — делится на
+// поддиапазоны во временных файлах и каждый выводится по порядку; деление,
+// которое ничего не уменьшило (все ключи одинаковые — один и тот же текст), не
+// повторяется, такой файл сортируется как есть
+static int emit_range(MergeEmit *e, const char *path, uint64_t records, uint64_t bytes,
+                      uint64_t lo, unsigned __int128 span, int may_split) {
+    if (records == 0) return 0;
+    if (!may_split || bytes <= e->budget || span < 2) return sort_and_write(e, path, records, bytes);
+
+    size_t count = bytes / e->budget + 1;
+    if (count > MERGE_MAX_BUCKETS) count = MERGE_MAX_BUCKETS;
+    if (count > span) count = (size_t)span;
+    MergeBucket *subs = calloc(count, sizeof(*subs));
+    char (*paths)[4200] = calloc(count, sizeof(*paths));
+    char *data = NULL;
+    int rc = subs && paths && map_spill(path, bytes, &data) == 0 ? 0 : -1;
+    if (rc == 0) madvise(data, bytes, MADV_SEQUENTIAL);
+    unsigned seq = e->split_seq++;
+    for (size_t j = 0; j < count && rc == 0; j++) {
+        snprintf(paths[j], sizeof(paths[j]), "%s/split-%u-%04zu", e->tmp_dir, seq, j);
+        subs[j].f = fopen(paths[j], "w+");
+        if (!subs[j].f) rc = -1;
+        else setvbuf(subs[j].f, NULL, _IOFBF, 1u << 20);
+    }
+    for (size_t off = 0; rc == 0 && off + sizeof(SpillHeader) <= bytes;) {
+        SpillHeader h;
+        memcpy(&h, data + off, sizeof(h));
+        size_t size = sizeof(h) + h.len;
+        MergeBucket *b = &subs[range_slot(h.key, lo, span, count)];
+        if (fwrite(data + off, 1, size, b->f) != size) rc = -1;
+        b->records++;
+        b->bytes += size;
+        off += size;
+    }
+    if (data && data != MAP_FAILED) munmap(data, bytes);
+    if (rc == 0) {
+        e->splits++;
+        unlink(path);     // содержимое — в поддиапазонах
+    }
+
+    for (size_t j = 0; subs && paths && j < count; j++) {
+        if (!subs[j].f) continue;
+        if (fflush(subs[j].f) != 0) rc = -1;
+        fclose(subs[j].f);
+        if (rc == 0) {
+            unsigned __int128 sub_lo = ((unsigned __int128)j * span + count - 1) / count;
+            unsigned __int128 sub_hi = ((unsigned __int128)(j + 1) * span + count - 1) / count;
+            rc = emit_range(e, paths[j], subs[j].records, subs[j].bytes, lo + (uint64_t)sub_lo,
+                            sub_hi - sub_lo, subs[j].bytes < bytes);
+        }
+        unlink(paths[j]);
+    }
+    free(subs);
+    free(paths);
+    return rc;
+}
+
+static int map_input(MergeInput *in) {
+    int fd = open(in->path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    in->size = (size_t)st.st_size;
+    in->data = in->size ? mmap(NULL, in->size, PROT_READ, MAP_PRIVATE, fd, 0) : "";
+    close(fd);
+    if (in->data == MAP_FAILED) return -1;
+    if (in->size) madvise((void *)in->data, in->size, MADV_SEQUENTIAL);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    DsWriterConfig wcfg = { .compression = DSW_COMPRESS_NONE };
+    const char *train_path = "train.jsonl";
+    const char *val_path = "val.jsonl";
+    const char *tmp_root = getenv("TMPDIR");
+    const char *dedup_path = NULL;
+    double val_ratio = 0.01;
+    uint64_t seed = 0;
+    size_t mem_mb = 1024;
+    int jobs = 0;
+    char **specs = calloc((size_t)argc, sizeof(char *));
+    size_t spec_count = 0;
+    if (!specs) return 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--train") == 0 && i + 1 < argc) train_path = argv[++i];
+        else if (strcmp(argv[i], "--val") == 0 && i + 1 < argc) val_path = argv[++i];
+        else if (strcmp(argv[i], "--val-ratio") == 0 && i + 1 < argc) val_ratio = atof(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) jobs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--mem-mb") == 0 && i + 1 < argc) mem_mb = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--tmp") == 0 && i + 1 < argc) tmp_root = argv[++i];
+        else if (strcmp(argv[i], "--dedup-index") == 0 && i + 1 < argc) dedup_path = argv[++i];
+        else if (strcmp(argv[i], "--compress") == 0 && i + 1 < argc) {
+            if (ds_compression_parse(argv[++i], &wcfg.compression) != 0) {
+                fprintf(stderr, "Error: unknown compression '%s'\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--shard-records") == 0 && i + 1 < argc) wcfg.shard_records = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--shard-bytes") == 0 && i + 1 < argc) wcfg.shard_bytes = strtoull(argv[++i], NULL, 10);
+        else specs[spec_count++] = argv[i];
+    }
+    if (spec_count == 0 || val_ratio < 0 || mem_mb == 0) {
+        fprintf(stderr, "Usage: %s [--train FILE] [--val FILE] [--val-ratio R] [--seed N] [--jobs N] "
+                        "[--mem-mb N] [--tmp DIR] [--dedup-index FILE] [--compress gzip|zstd] "
+                        "[--shard-records N] [--shard-bytes N] input[:CATEGORY]...\n", argv[0]);
+        return 1;
+    }
+    if (!tmp_root || !*tmp_root) tmp_root = "/tmp";
+
+    MergeShared sh;
+    memset(&sh, 0, sizeof(sh));
+    sh.seed = mix64(seed ^ 0x9e3779b97f4a7c15ULL);
+    sh.val_all = val_ratio >= 1.0;
+    sh.val_threshold = sh.val_all ? 0 : (uint64_t)(val_ratio * 18446744073709551616.0);
+    sh.inputs = calloc(spec_count, sizeof(*sh.inputs));
+    if (!sh.inputs) return 1;
+
+    // Входы: spec — FILE или FILE:CATEGORY
+    size_t total = 0, seg_cap = 0;
+    for (size_t i = 0; i < spec_count; i++) {
+        MergeInput *in = &sh.inputs[i];
+        snprintf(in->path, sizeof(in->path), "%s", specs[i]);
+        in->category = MERGE_DEFAULT_CATEGORY;
+        char *colon = strrchr(in->path, ':');
+        if (colon && !strchr(colon, '/')) { *colon = '\0'; in->category = colon + 1; }
+        if (map_input(in) != 0) {
+            fprintf(stderr, "⚠️  Skip %s: %s\n", in->path, strerror(errno));
+            in->data = NULL;
+            in->size = 0;
+            continue;
+        }
+        total += in->size;
+        if (add_segments(&sh, i, &seg_cap) != 0) {
+            fprintf(stderr, "Error: out of memory\n");
+            return 1;
+        }
+    }
+
+    // Временный каталог: диапазоны ключей и (без --dedup-index) индекс отпечатков
+    char tmp_dir[4096], path[4200];
+    snprintf(tmp_dir, sizeof(tmp_dir), "%s/merge-XXXXXX", tmp_root);
+    if (!mkdtemp(tmp_dir)) {
+        perror(tmp_dir);
+        return 1;
+    }
+    FpIndex dedup;
+    snprintf(path, sizeof(path), "%s/dedup.fpi", tmp_dir);
+    if (fpindex_open(&dedup, dedup_path ? dedup_path : path) != 0) {
+        fprintf(stderr, "Error: cannot open dedup index %s\n", dedup_path ? dedup_path : path);
+        rmdir(tmp_dir);
+        return 1;
+    }
+
+    // Диапазон целиком должен помещаться в половину бюджета памяти; не
+    // поместившиеся (больше MERGE_MAX_BUCKETS частей) делятся ещё раз в emit_range
+    size_t budget = mem_mb << 19;
+    sh.bucket_count = total / budget + 1;
+    if (sh.bucket_count > MERGE_MAX_BUCKETS) sh.bucket_count = MERGE_MAX_BUCKETS;
+    sh.buckets = calloc(sh.bucket_count, sizeof(*sh.buckets));
+    if (!sh.buckets) return 1;
+    for (size_t b = 0; b < sh.bucket_count; b++) {
+        snprintf(path, sizeof(path), "%s/bucket-%04zu", tmp_dir, b);
+        sh.buckets[b].f = fopen(path, "w+");
+        if (!sh.buckets[b].f) {
+            perror(path);
+            sh.failed = 1;
+            break;
+        }
+        setvbuf(sh.buckets[b].f, NULL, _IOFBF, 1u << 20);
+        pthread_mutex_init(&sh.buckets[b].lock, NULL);
+    }
+
+    if (!sh.failed) {
+        if (jobs <= 0) {
+            long n = sysconf(_SC_NPROCESSORS_ONLN);
+            jobs = n > 0 ? (int)n : 1;
+        }
+        if ((size_t)jobs > sh.segment_count) jobs = sh.segment_count ? (int)sh.segment_count : 1;
+        pthread_t *threads = calloc((size_t)jobs, sizeof(pthread_t));
+        int started = 0;
+        if (threads) {
+            for (; started < jobs; started++) {
+                if (pthread_create(&threads[started], NULL, worker, &sh) != 0) break;
+            }
+        }
+        if (started == 0) worker(&sh);
+        for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+        free(threads);
+    }
+
+    MergeEmit emit = { .inputs = sh.inputs, .dedup = &dedup, .budget = budget, .tmp_dir = tmp_dir };
+    // Новые записи — к прошлым слияниям: перезапись оставила бы в выводе только
+    // их, а остальные индекс больше не пропустит
+    wcfg.append = fpindex_count(&dedup) > 0;
+    if (!sh.failed) {
+        wcfg.path = train_path;
+        emit.train = ds_writer_open(&wcfg);
+        wcfg.path = val_path;
+        emit.val = emit.train ? ds_writer_open(&wcfg) : NULL;
+        if (!emit.train || !emit.val) {
+            fprintf(stderr, "Error: cannot open %s\n", emit.train ? val_path : train_path);
+            sh.failed = 1;
+        }
+    }
+    for (size_t b = 0; b < sh.bucket_count; b++) {
+        if (!sh.buckets[b].f) break;
+        snprintf(path, sizeof(path), "%s/bucket-%04zu", tmp_dir, b);
+        if (fflush(sh.buckets[b].f) != 0) sh.failed = 1;
+        fclose(sh.buckets[b].f);
+        unsigned __int128 lo = ((unsigned __int128)b * FULL_SPAN + sh.bucket_count - 1) / sh.bucket_count;
+        unsigned __int128 hi = ((unsigned __int128)(b + 1) * FULL_SPAN + sh.bucket_count - 1) / sh.bucket_count;
+        if (!sh.failed && (emit_range(&emit, path, sh.buckets[b].records, sh.buckets[b].bytes,
+                                      (uint64_t)lo, hi - lo, 1) != 0 || sync_outputs(&emit) != 0)) {
+            fprintf(stderr, "⚠️  Failed to write bucket %zu: %s\n", b, strerror(errno));
+            sh.failed = 1;
+        }
+        unlink(path);
+        pthread_mutex_destroy(&sh.buckets[b].lock);
+    }
+    if (emit.train && ds_writer_close(emit.train) != 0) sh.failed = 1;
+    if (emit.val && ds_writer_close(emit.val) != 0) sh.failed = 1;
+
+    uint64_t objects = 0, broken = 0, duplicates = 0;
+    for (size_t i = 0; i < spec_count; i++) {
+        MergeInput *in = &sh.inputs[i];
+        if (!in->data) continue;
+        printf("   %s: %llu objects (messages %llu, instruction %llu, article %llu), %llu duplicates, %llu broken\n",
+               in->path, (unsigned long long)in->objects, (unsigned long long)in->formats[FMT_MESSAGES],
+               (unsigned long long)in->formats[FMT_INSTRUCTION], (unsigned long long)in->formats[FMT_ARTICLE],
+               (unsigned long long)in->duplicates, (unsigned long long)in->broken);
+        objects += in->objects;
+        broken += in->broken;
+        duplicates += in->duplicates;
+        if (in->size) munmap((void *)in->data, in->size);
+    }
+    printf("✅ %llu objects → %llu train (%s), %llu val (%s); %llu duplicates, %llu broken, "
+           "%zu buckets (+%zu split)\n",
+           (unsigned long long)objects, (unsigned long long)emit.n_train, train_path,
+           (unsigned long long)emit.n_val, val_path, (unsigned long long)duplicates,
+           (unsigned long long)broken, sh.bucket_count, emit.splits);
+
+    fpindex_close(&dedup);
+    if (!dedup_path) {
+        snprintf(path, sizeof(path), "%s/dedup.fpi", tmp_dir);
+        unlink(path);
+        snprintf(path, sizeof(path), "%s/dedup.fpi.lock", tmp_dir);
+        unlink(path);
+    }
+    rmdir(tmp_dir);
+    free(sh.buckets);
+    free(sh.segments);
+    free(sh.inputs);
+    free(specs);
+    return sh.failed;
+}
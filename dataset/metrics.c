@@ -0,0 +1,149 @@
+// metrics.c — счётчики и гистограммы задержек по стадиям (см. metrics.h)
+
+#define _POSIX_C_SOURCE 200809L
+#include "metrics.h"
+
+#include <string.h>
+#include <time.h>
+
+#define MET_BUCKETS 256
+
+typedef struct {
+    uint64_t calls;
+    uint64_t dropped;
+    uint64_t bytes;
+    uint64_t ticks;
+    uint64_t max_ticks;
+    uint64_t hist[MET_BUCKETS];
+} StageMetrics;
+
+static StageMetrics stages[MET_STAGE_COUNT];
+static uint64_t start_ticks;
+static uint64_t start_ns;
+
+static const char *const STAGE_NAMES[MET_STAGE_COUNT] = {
+    "download", "html_parse", "xpath", "extract", "normalize", "langid", "dedup", "serialize", "write",
+};
+
+const char *metrics_stage_name(MetStage stage) {
+    return stage < MET_STAGE_COUNT ? STAGE_NAMES[stage] : "unknown";
+}
+
+static uint64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+void metrics_init(void) {
+    memset(stages, 0, sizeof(stages));
+    start_ns = mono_ns();
+    start_ticks = metrics_ticks();
+}
+
+// 0..3 — точные значения, дальше 4 корзины на степень двойки
+static unsigned bucket_of(uint64_t v) {
+    if (v < 4) return (unsigned)v;
+    unsigned msb = 63u - (unsigned)__builtin_clzll(v);
+    return (msb - 1) * 4 + (unsigned)((v >> (msb - 2)) & 3);
+}
+
+static uint64_t bucket_lo(unsigned b) {
+    if (b < 4) return b;
+    unsigned msb = b / 4 + 1;
+    return (uint64_t)(4 + b % 4) << (msb - 2);
+}
+
+static uint64_t bucket_width(unsigned b) {
+    return b < 4 ? 1 : (uint64_t)1 << (b / 4 - 1);
+}
+
+void metrics_record(MetStage stage, uint64_t t0, uint64_t bytes, int dropped) {
+    uint64_t dt = metrics_ticks() - t0;
+    StageMetrics *s = &stages[stage];
+    __atomic_fetch_add(&s->calls, 1, __ATOMIC_RELAXED);
+    if (dropped) __atomic_fetch_add(&s->dropped, 1, __ATOMIC_RELAXED);
+    if (bytes) __atomic_fetch_add(&s->bytes, bytes, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&s->ticks, dt, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&s->hist[bucket_of(dt)], 1, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&s->max_ticks, __ATOMIC_RELAXED);
+    while (dt > max && !__atomic_compare_exchange_n(&s->max_ticks, &max, dt, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+}
+
+// Тактов в наносекунде. Прогон короче 10 мс досчитывается ожиданием,
+// иначе погрешность калибровки сравнима с самими замерами
+static double ticks_per_ns(uint64_t *wall_ns) {
+    uint64_t ns = mono_ns() - start_ns;
+    *wall_ns = ns;
+    while (ns < 10000000u) ns = mono_ns() - start_ns;
+    uint64_t ticks = metrics_ticks() - start_ticks;
+    return ns ? (double)ticks / (double)ns : 1.0;
+}
+
+// Середина корзины, в которую попал квантиль q (не больше максимума)
+static uint64_t percentile(const StageMetrics *s, double q) {
+    if (!s->calls) return 0;
+    uint64_t rank = (uint64_t)(q * (double)(s->calls - 1)) + 1;
+    uint64_t seen = 0;
+    for (unsigned b = 0; b < MET_BUCKETS; b++) {
+        seen += s->hist[b];
+        if (seen >= rank) {
+            uint64_t v = bucket_lo(b) + bucket_width(b) / 2;
+            return v < s->max_ticks ? v : s->max_ticks;
+        }
+    }
+    return s->max_ticks;
+}
+
+void metrics_print(FILE *f) {
+    uint64_t wall_ns;
+    double tpn = ticks_per_ns(&wall_ns);
+    int header = 0;
+    for (int i = 0; i < MET_STAGE_COUNT; i++) {
+        const StageMetrics *s = &stages[i];
+        if (!s->calls) continue;
+        if (!header) {
+            fprintf(f, "⏱️  %-10s %8s %8s %10s %10s %9s %9s %9s %9s %9s\n", "stage", "calls", "dropped",
+                    "MB", "total_ms", "mean_us", "p50_us", "p90_us", "p99_us", "max_us");
+            header = 1;
+        }
+        double us = 1.0 / (tpn * 1e3);
+        fprintf(f, "    %-10s %8llu %8llu %10.2f %10.2f %9.1f %9.1f %9.1f %9.1f %9.1f\n", STAGE_NAMES[i],
+                (unsigned long long)s->calls, (unsigned long long)s->dropped, (double)s->bytes / (1024.0 * 1024.0),
+                (double)s->ticks * us / 1e3, (double)s->ticks * us / (double)s->calls,
+                (double)percentile(s, 0.5) * us, (double)percentile(s, 0.9) * us,
+                (double)percentile(s, 0.99) * us, (double)s->max_ticks * us);
+    }
+}
+
+int metrics_dump_json(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+    uint64_t wall_ns;
+    double tpn = ticks_per_ns(&wall_ns);
+    double us = 1.0 / (tpn * 1e3);
+    fprintf(f, "{\"wall_ms\":%.3f,\"ticks_per_ns\":%.6f,\"stages\":{", (double)wall_ns / 1e6, tpn);
+    int first = 1;
+    for (int i = 0; i < MET_STAGE_COUNT; i++) {
+        const StageMetrics *s = &stages[i];
+        if (!s->calls) continue;
+        fprintf(f, "%s\"%s\":{\"calls\":%llu,\"dropped\":%llu,\"bytes\":%llu,\"total_ms\":%.3f,\"mean_us\":%.3f,"
+                   "\"p50_us\":%.3f,\"p90_us\":%.3f,\"p99_us\":%.3f,\"max_us\":%.3f,\"hist\":[",
+                first ? "" : ",", STAGE_NAMES[i], (unsigned long long)s->calls, (unsigned long long)s->dropped,
+                (unsigned long long)s->bytes, (double)s->ticks * us / 1e3, (double)s->ticks * us / (double)s->calls,
+                (double)percentile(s, 0.5) * us, (double)percentile(s, 0.9) * us,
+                (double)percentile(s, 0.99) * us, (double)s->max_ticks * us);
+        // [верхняя граница корзины в мкс, число замеров]
+        int first_b = 1;
+        for (unsigned b = 0; b < MET_BUCKETS; b++) {
+            if (!s->hist[b]) continue;
+            fprintf(f, "%s[%.3f,%llu]", first_b ? "" : ",", (double)(bucket_lo(b) + bucket_width(b)) * us,
+                    (unsigned long long)s->hist[b]);
+            first_b = 0;
+        }
+        fprintf(f, "]}");
+        first = 0;
+    }
+    fprintf(f, "}}\n");
+    return fclose(f) == 0 ? 0 : -1;
+}
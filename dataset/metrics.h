@@ -0,0 +1,63 @@
+// metrics.h — счётчики и гистограммы задержек по стадиям конвейера
+//
+// На каждую стадию (скачивание, разбор HTML, XPath, извлечение,
+// нормализация, определение языка, дедупликация, сериализация, запись) —
+// число вызовов, отброшенных элементов, байт на входе и гистограмма
+// длительностей.
+// Время берётся из TSC (rdtsc, на других архитектурах — CLOCK_MONOTONIC
+// в нс) и переводится в секунды только при выводе: частота TSC
+// калибруется по CLOCK_MONOTONIC между metrics_init и сводкой.
+// Гистограмма лог-линейная: 4 поддиапазона на каждую степень двойки
+// тактов (погрешность перцентилей — до 25%). Все обновления —
+// relaxed-атомики, метрики можно писать из рабочих потоков.
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+typedef enum {
+    MET_DOWNLOAD = 0,
+    MET_HTML_PARSE,
+    MET_XPATH,
+    MET_EXTRACT,       // PDF, man, простой текст
+    MET_NORMALIZE,
+    MET_LANGID,        // langid_detect по нормализованному тексту
+    MET_DEDUP,
+    MET_SERIALIZE,     // сборка строки JSONL
+    MET_WRITE,         // ds_writer_write
+    MET_STAGE_COUNT
+} MetStage;
+
+static inline uint64_t metrics_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+void metrics_init(void);
+
+// Стадия началась в t0 (metrics_ticks()) и закончилась сейчас; bytes — объём
+// входа; dropped — элемент дальше не пошёл (ошибка загрузки, дубликат, пусто)
+void metrics_record(MetStage stage, uint64_t t0, uint64_t bytes, int dropped);
+
+const char *metrics_stage_name(MetStage stage);
+
+// Таблица по стадиям с вызовами (в конце прогона)
+void metrics_print(FILE *f);
+
+// JSON со сводкой и непустыми корзинами гистограмм; 0 или -1 (errno)
+int metrics_dump_json(const char *path);
+
+#endif // METRICS_H
@@ -0,0 +1,244 @@
+// normalize.c — однопроходная нормализация текста (см. normalize.h)
+
+#include "normalize.h"
+
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define NORMALIZE_SSE2 1
+#endif
+
+// Точка, до которой можно безопасно обрезать текст, и счётчики на этот момент
+typedef struct {
+    size_t w;
+    size_t chars;
+    size_t words;
+    size_t separators;
+} CutPoint;
+
+typedef struct {
+    char *out;
+    size_t w;
+    size_t chars;
+    size_t words;
+    size_t separators;         // абзацных разделителей "\n\n"
+    CutPoint sentence;         // после последнего завершённого предложения
+    CutPoint word;             // после последнего целого слова
+} NormState;
+
+static inline int is_sentence_end(char c) {
+    return c == '.' || c == '!' || c == '?';
+}
+
+static inline int last_is_space(const NormState *st) {
+    return st->w == 0 || st->out[st->w - 1] == ' ' || st->out[st->w - 1] == '\n';
+}
+
+static inline void save_cut(const NormState *st, CutPoint *cp, size_t at, size_t chars, size_t words) {
+    cp->w = at;
+    cp->chars = chars;
+    cp->words = words;
+    cp->separators = st->separators;
+}
+
+// Пробельный символ во входе: схлопываем в один ' '
+static inline void emit_space(NormState *st) {
+    if (last_is_space(st)) return;
+    if (is_sentence_end(st->out[st->w - 1])) save_cut(st, &st->sentence, st->w, st->chars, st->words);
+    save_cut(st, &st->word, st->w, st->chars, st->words);
+    st->out[st->w++] = ' ';
+    st->chars++;
+}
+
+// Вторая пустая строка подряд: уже записанный ' ' превращается в "\n\n".
+// Вход к этому моменту потребил минимум два байта пробелов, так что w+1 <= r.
+static inline void emit_paragraph(NormState *st) {
+    if (st->w == 0 || st->out[st->w - 1] != ' ') return;
+    st->out[st->w - 1] = '\n';
+    st->out[st->w++] = '\n';
+    st->chars++;
+    st->separators++;
+    st->sentence = st->word;  // конец абзаца — тоже конец предложения
+}
+
+// Видимый символ из n байт; 0 — не влез в бюджет
+static inline int emit_char(NormState *st, const char *src, size_t n, size_t max_bytes) {
+    if (max_bytes && st->w + n > max_bytes) return 0;
+    if (last_is_space(st)) st->words++;
+    memmove(st->out + st->w, src, n);
+    st->w += n;
+    st->chars++;
+    return 1;
+}
+
+static void truncate_at_cut(NormState *st, size_t max_bytes) {
+    const CutPoint *cp = NULL;
+    if (st->sentence.w > 0 && st->sentence.w >= max_bytes / 2) cp = &st->sentence;
+    else if (st->word.w > 0) cp = &st->word;
+    if (!cp) return;  // одно огромное слово — режем по границе символа как есть
+    st->w = cp->w;
+    st->chars = cp->chars;
+    st->words = cp->words;
+    st->separators = cp->separators;
+}
+
+// Длина корректной UTF-8 последовательности с ведущим байтом s[0], 0 — некорректна
+static inline size_t utf8_seq_len(const unsigned char *s, size_t avail) {
+    unsigned char c = s[0];
+    size_t n;
+    unsigned char lo = 0x80, hi = 0xBF;
+    if (c >= 0xC2 && c <= 0xDF) n = 2;
+    else if (c >= 0xE0 && c <= 0xEF) {
+        n = 3;
+        if (c == 0xE0) lo = 0xA0;
+        else if (c == 0xED) hi = 0x9F;  // суррогаты
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        n = 4;
+        if (c == 0xF0) lo = 0x90;
+        else if (c == 0xF4) hi = 0x8F;
+    } else {
+        return 0;
+    }
+    if (avail < n) return 0;
+    if (s[1] < lo || s[1] > hi) return 0;
+    for (size_t i = 2; i < n; i++) {
+        if (s[i] < 0x80 || s[i] > 0xBF) return 0;
+    }
+    return n;
+}
+
+#ifdef NORMALIZE_SSE2
+// Блок из 16 байт печатного ASCII без двойных пробелов: копируем целиком,
+// слова и точки обрезки считаем по битовым маскам. 0 — блок не подходит.
+static inline int fast_block(NormState *st, const char *src, size_t max_bytes) {
+    if (st->w == 0 || (max_bytes && st->w + 16 > max_bytes)) return 0;
+
+    __m128i v = _mm_loadu_si128((const __m128i *)src);
+    __m128i printable = _mm_andnot_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(0x7f)),
+                                         _mm_cmpgt_epi8(v, _mm_set1_epi8(0x1f)));
+    if (_mm_movemask_epi8(printable) != 0xFFFF) return 0;
+
+    uint32_t sp = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+    uint32_t carry = last_is_space(st) ? 1u : 0u;
+    uint32_t prev_sp = ((sp << 1) | carry) & 0xFFFF;
+    if (sp & prev_sp) return 0;  // двойной пробел — пусть разберёт скалярный путь
+
+    uint32_t nonsp = ~sp & 0xFFFF;
+    uint32_t starts = nonsp & prev_sp;
+    __m128i punct = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('.')),
+                                              _mm_cmpeq_epi8(v, _mm_set1_epi8('!'))),
+                                 _mm_cmpeq_epi8(v, _mm_set1_epi8('?')));
+    uint32_t pm = (uint32_t)_mm_movemask_epi8(punct);
+    uint32_t prev_punct = ((pm << 1) | (is_sentence_end(st->out[st->w - 1]) ? 1u : 0u)) & 0xFFFF;
+
+    if (sp) {
+        // Последний пробел блока — граница слова; если перед ним точка — и предложения
+        unsigned last = 31u - (unsigned)__builtin_clz(sp);
+        uint32_t before = (1u << last) - 1;
+        save_cut(st, &st->word, st->w + last, st->chars + last,
+                 st->words + (size_t)__builtin_popcount(starts & before));
+        uint32_t ends = sp & prev_punct;
+        if (ends) {
+            unsigned le = 31u - (unsigned)__builtin_clz(ends);
+            uint32_t b = (1u << le) - 1;
+            save_cut(st, &st->sentence, st->w + le, st->chars + le,
+                     st->words + (size_t)__builtin_popcount(starts & b));
+        }
+    }
+
+    memmove(st->out + st->w, src, 16);
+    st->w += 16;
+    st->chars += 16;
+    st->words += (size_t)__builtin_popcount(starts);
+    return 1;
+}
+#endif
+
+size_t text_normalize(char *buf, size_t len, const NormOptions *opt, NormStats *stats) {
+    NormOptions defaults = {0};
+    if (!opt) opt = &defaults;
+    NormStats local;
+    if (!stats) stats = &local;
+    memset(stats, 0, sizeof(*stats));
+
+    NormState st;
+    memset(&st, 0, sizeof(st));
+    st.out = buf;
+    const unsigned char *in = (const unsigned char *)buf;
+    size_t newlines = 0;  // переводов строки в текущей пробельной серии
+    size_t r = 0;
+
+    while (r < len) {
+#ifdef NORMALIZE_SSE2
+        if (r + 16 <= len && fast_block(&st, buf + r, opt->max_bytes)) {
+            r += 16;
+            newlines = 0;
+            continue;
+        }
+#endif
+        unsigned char c = in[r];
+
+        if (c < 0x80) {
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f') {
+                emit_space(&st);
+                r++;
+                continue;
+            }
+            if (c == '\n') {
+                emit_space(&st);
+                if (opt->keep_paragraphs && ++newlines == 2) emit_paragraph(&st);
+                r++;
+                continue;
+            }
+            if (c < 0x20 || c == 0x7f) {
+                stats->control_chars++;
+                r++;
+                continue;
+            }
+            newlines = 0;
+            if (!emit_char(&st, buf + r, 1, opt->max_bytes)) { stats->truncated = 1; break; }
+            r++;
+            continue;
+        }
+
+        size_t n = utf8_seq_len(in + r, len - r);
+        if (n == 0) {
+            stats->invalid_bytes++;
+            r++;
+            continue;
+        }
+        if (n == 2 && c == 0xC2) {
+            if (in[r + 1] == 0xA0) { emit_space(&st); r += 2; continue; }        // NBSP
+            if (in[r + 1] <= 0x9F) { stats->control_chars++; r += 2; continue; } // C1
+        }
+        if (n == 3 && c == 0xE2 && in[r + 1] == 0x80 && (in[r + 2] == 0xA8 || in[r + 2] == 0xA9)) {
+            emit_space(&st);  // U+2028 / U+2029
+            r += 3;
+            continue;
+        }
+        if (n == 3 && c == 0xEF && in[r + 1] == 0xBB && in[r + 2] == 0xBF) {
+            stats->control_chars++;  // BOM
+            r += 3;
+            continue;
+        }
+        newlines = 0;
+        if (!emit_char(&st, buf + r, n, opt->max_bytes)) { stats->truncated = 1; break; }
+        r += n;
+    }
+
+    if (stats->truncated) truncate_at_cut(&st, opt->max_bytes);
+    while (st.w > 0 && (buf[st.w - 1] == ' ' || buf[st.w - 1] == '\n')) {
+        if (buf[st.w - 1] == '\n' && buf[st.w - 2] == '\n') st.separators--;
+        st.w--;
+        st.chars--;
+    }
+    buf[st.w] = '\0';
+
+    stats->bytes = st.w;
+    stats->chars = st.chars;
+    stats->words = st.words;
+    stats->paragraphs = st.w ? st.separators + 1 : 0;
+    return st.w;
+}
@@ -0,0 +1,36 @@
+// normalize.h — однопроходная нормализация извлечённого текста
+//
+// За один проход, на месте (результат никогда не длиннее входа):
+//   - схлопывает пробельные последовательности (включая NBSP) в один
+//     пробел, а при keep_paragraphs — пустые строки в "\n\n";
+//   - выбрасывает управляющие символы (C0, DEL, C1);
+//   - выбрасывает байты, не образующие корректный UTF-8;
+//   - считает слова и символы (кодовые точки);
+//   - при заданном бюджете обрезает по концу предложения (или слова).
+// Участки печатного ASCII проверяются по 16 байт за раз (SSE2).
+
+#ifndef NORMALIZE_H
+#define NORMALIZE_H
+
+#include <stddef.h>
+
+typedef struct {
+    size_t max_bytes;          // 0 — без ограничения
+    int keep_paragraphs;       // сохранять границы абзацев как "\n\n"
+} NormOptions;
+
+typedef struct {
+    size_t bytes;              // длина результата
+    size_t chars;              // кодовых точек
+    size_t words;
+    size_t paragraphs;
+    size_t invalid_bytes;      // выброшено как некорректный UTF-8
+    size_t control_chars;      // выброшено управляющих символов
+    int truncated;
+} NormStats;
+
+// buf должен вмещать len + 1 байт: результат завершается '\0'.
+// opt == NULL — без бюджета и без абзацев. Возвращает новую длину.
+size_t text_normalize(char *buf, size_t len, const NormOptions *opt, NormStats *stats);
+
+#endif // NORMALIZE_H
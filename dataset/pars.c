@@ -0,0 +1,490 @@
+// pars.c — пары {"instruction","output"} из списка URL (см. pars.h)
+
+#define _GNU_SOURCE
+#include "pars.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <libxml/HTMLparser.h>
+
+#include "json_escape.h"
+#include "normalize.h"
+#include "relevance.h"
+#include "url.h"
+#include "../alog.h"
+
+// Те же слова, что KEYWORDS в pars.sh (grep -iF: подстрока без учёта регистра)
+static const RelevanceKeyword PARS_KEYWORDS[] = {
+    { "reverse", "RE", 1.0 }, { "reverse-engineering", "RE", 1.0 },
+    { "reverse engineering", "RE", 1.0 }, { "ELF", "RE", 1.0 },
+    { "stack canary", "RE", 1.0 }, { "stack_chk_fail", "RE", 1.0 },
+    { "stack protector", "RE", 1.0 }, { "canary", "RE", 1.0 },
+    { "Ghidra", "RE", 1.0 }, { "radare", "RE", 1.0 }, { "rizin", "RE", 1.0 },
+    { "IDA", "RE", 1.0 }, { "disassembly", "RE", 1.0 }, { "disassemble", "RE", 1.0 },
+    { "decompile", "RE", 1.0 }, { "binary analysis", "RE", 1.0 },
+    { "objdump", "RE", 1.0 }, { "strace", "RE", 1.0 }, { "ltrace", "RE", 1.0 },
+};
+
+static const char INSTRUCTION_PREFIX[] =
+    "Сформулируй вопрос/инструкцию для ИИ по следующему фрагменту: \"";
+
+typedef struct {
+    char **urls;
+    size_t count;
+} UrlList;
+
+typedef struct {
+    const ParsConfig *cfg;
+    const UrlList *list;
+    RelevanceEngine *keywords;
+    size_t next;               // атомарный счётчик заданий
+
+    // Готовые записи по адресам; сбрасываются на диск строго по порядку
+    pthread_mutex_t out_lock;
+    StrBuf *results;
+    unsigned char *done;
+    size_t next_commit;
+    ParsStats stats;
+} ParsShared;
+
+// [[:space:]] в C-локали
+static inline int is_space(unsigned char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+// Длина в символах, как ${#var} и length() в UTF-8 локали
+static size_t utf8_chars(const char *s, size_t len) {
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) n += ((unsigned char)s[i] & 0xC0) != 0x80;
+    return n;
+}
+
+// Байтовая длина первых max_chars символов
+static size_t utf8_prefix(const char *s, size_t len, size_t max_chars) {
+    size_t chars = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (((unsigned char)s[i] & 0xC0) != 0x80 && chars++ == max_chars) return i;
+    }
+    return len;
+}
+
+// Пробельные серии → один пробел (sed 's/\s+/ /g')
+static int append_collapsed(StrBuf *b, const char *s, size_t len) {
+    if (strbuf_reserve(b, len) != 0) return -1;
+    char *dst = b->data + b->len;
+    for (size_t i = 0; i < len; i++) {
+        if (is_space((unsigned char)s[i])) {
+            *dst++ = ' ';
+            while (i + 1 < len && is_space((unsigned char)s[i + 1])) i++;
+        } else {
+            *dst++ = s[i];
+        }
+    }
+    b->len = (size_t)(dst - b->data);
+    return 0;
+}
+
+// === Загрузка ===
+
+static char *read_file(const char *path, size_t *size) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+    struct stat st;
+    char *data = NULL;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && (data = malloc((size_t)st.st_size + 1))) {
+        size_t got = 0;
+        while (got < (size_t)st.st_size) {
+            ssize_t n = read(fd, data + got, (size_t)st.st_size - got);
+            if (n <= 0) break;
+            got += (size_t)n;
+        }
+        data[got] = '\0';
+        *size = got;
+    }
+    close(fd);
+    return data;
+}
+
+// Тело страницы или файла; 0 — есть, -1 — ошибка, 1 — запрещено robots.txt.
+// *is_html: 1 — HTML, 0 — другой текст (по Content-Type или расширению)
+static int load(ParsShared *sh, const char *url, char **body, size_t *size, int *is_html) {
+    const ParsConfig *cfg = sh->cfg;
+    int kind = -1;
+    if (strncmp(url, "http://", 7) != 0 && strncmp(url, "https://", 8) != 0) {
+        *body = read_file(url, size);
+        if (!*body) return -1;
+        const char *dot = strrchr(url, '.');
+        if (dot && (strcasecmp(dot, ".html") == 0 || strcasecmp(dot, ".htm") == 0 ||
+                    strcasecmp(dot, ".xhtml") == 0)) kind = 1;
+    } else {
+        char canon[URL_MAX];
+        if (cfg->robots && url_canonicalize(url, canon, sizeof(canon)) == 0 &&
+            robots_check(cfg->robots, canon, 1, NULL) == 0) {
+            return 1;
+        }
+        FetchResult res;
+        if (fetch_cache_get(cfg->cache, url, &res) != 0) return -1;
+        *body = res.body;
+        *size = res.size;
+        if (res.content_type[0]) kind = strcasestr(res.content_type, "html") != NULL;
+    }
+    if (kind < 0) {
+        // Тип неизвестен — смотрим на первый значащий символ
+        const char *p = *body;
+        while (p < *body + *size && is_space((unsigned char)*p)) p++;
+        kind = p < *body + *size && *p == '<';
+    }
+    *is_html = kind;
+    return 0;
+}
+
+// === HTML → текст ===
+
+static int skip_element(const char *name) {
+    static const char *const SKIP[] = { "script", "style", "noscript", "template", "head", "svg", "iframe" };
+    for (size_t i = 0; i < sizeof(SKIP) / sizeof(SKIP[0]); i++) {
+        if (strcasecmp(name, SKIP[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+static int is_block(const char *name) {
+    static const char *const BLOCK[] = {
+        "p", "div", "li", "ul", "ol", "dl", "dt", "dd", "pre", "blockquote", "table", "tr",
+        "h1", "h2", "h3", "h4", "h5", "h6", "section", "article", "header", "footer",
+        "main", "nav", "aside", "figure", "figcaption", "hr", "form", "address", "details",
+    };
+    for (size_t i = 0; i < sizeof(BLOCK) / sizeof(BLOCK[0]); i++) {
+        if (strcasecmp(name, BLOCK[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+// Блочные элементы отделяются пустой строкой, <br> — переводом строки;
+// пробелы схлопывает text_normalize
+static void html_text(xmlNode *node, StrBuf *out) {
+    for (xmlNode *n = node; n; n = n->next) {
+        if (n->type == XML_TEXT_NODE || n->type == XML_CDATA_SECTION_NODE) {
+            if (n->content) strbuf_append_str(out, (const char *)n->content);
+        } else if (n->type == XML_ELEMENT_NODE) {
+            const char *name = (const char *)n->name;
+            if (skip_element(name)) continue;
+            if (strcasecmp(name, "br") == 0) { strbuf_append(out, "\n", 1); continue; }
+            int block = is_block(name);
+            if (block) strbuf_append(out, "\n\n", 2);
+            html_text(n->children, out);
+            if (block) strbuf_append(out, "\n\n", 2);
+        }
+    }
+}
+
+static void html_to_text(const char *html, size_t len, StrBuf *out) {
+    htmlDocPtr doc = htmlReadMemory(html, (int)len, NULL, NULL,
+                                    HTML_PARSE_RECOVER | HTML_PARSE_NOERROR |
+                                    HTML_PARSE_NOWARNING | HTML_PARSE_NONET);
+    if (!doc) return;
+    html_text(xmlDocGetRootElement(doc), out);
+    xmlFreeDoc(doc);
+}
+
+// Запасной путь pars.sh: sed 's/<[^>]*>/ /g' построчно
+static void strip_tags(const char *s, size_t len, StrBuf *out) {
+    if (strbuf_reserve(out, len) != 0) return;
+    char *dst = out->data + out->len;
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] == '<') {
+            size_t j = i + 1;
+            while (j < len && s[j] != '>' && s[j] != '\n') j++;
+            if (j < len && s[j] == '>') {
+                *dst++ = ' ';
+                i = j;
+                continue;
+            }
+        }
+        *dst++ = s[i];
+    }
+    out->len = (size_t)(dst - out->data);
+}
+
+// === Абзацы ===
+
+// Одна запись (язык, ключ дедупликации, строка JSONL) в буфер результатов адреса
+static int append_result(StrBuf *res, LangId lang, const StrBuf *key, const StrBuf *rec) {
+    unsigned char l = (unsigned char)lang;
+    int rc = strbuf_append(res, (const char *)&l, 1);
+    rc |= strbuf_append(res, (const char *)&key->len, sizeof(key->len));
+    rc |= strbuf_append(res, key->data, key->len);
+    rc |= strbuf_append(res, (const char *)&rec->len, sizeof(rec->len));
+    rc |= strbuf_append(res, rec->data, rec->len);
+    return rc;
+}
+
+typedef struct {
+    StrBuf sentence;
+    StrBuf output;
+    StrBuf rec;
+    uint64_t paragraphs;
+    uint64_t matched;
+} ParaScratch;
+
+static void process_paragraph(ParsShared *sh, const char *p, size_t len, StrBuf *res, ParaScratch *ps) {
+    // p_trim
+    while (len > 0 && is_space((unsigned char)*p)) { p++; len--; }
+    while (len > 0 && is_space((unsigned char)p[len - 1])) len--;
+    if (utf8_chars(p, len) < PARS_MIN_PARAGRAPH_CHARS) return;
+    if (!relevance_has(sh->keywords, p, len, 1)) return;
+    ps->matched++;
+    LangId lang = LANG_UND;
+    if (sh->cfg->lang) {
+        lang = langid_detect(p, len, NULL);
+        if (!langid_filter_admit(sh->cfg->lang, lang)) return;
+    }
+
+    // Первая фраза: до первого [.?!] включительно, иначе 200 символов + "..."
+    strbuf_reset(&ps->sentence);
+    size_t cut = strcspn(p, ".?!");
+    int terminated = cut < len;
+    append_collapsed(&ps->sentence, p, terminated ? cut + 1 : len);
+    if (!terminated && utf8_chars(ps->sentence.data, ps->sentence.len) > PARS_MAX_SENTENCE_CHARS) {
+        ps->sentence.len = utf8_prefix(ps->sentence.data, ps->sentence.len, PARS_MAX_SENTENCE_CHARS);
+        strbuf_append(&ps->sentence, "...", 3);
+    }
+
+    // Ответ: абзац со схлопнутыми пробелами, первые 800 байт (cut -c1-800).
+    // Разрезанный UTF-8-символ отбрасывается целиком — на нём pars.sh падал
+    strbuf_reset(&ps->output);
+    append_collapsed(&ps->output, p, len);
+    if (ps->output.len > PARS_MAX_OUTPUT_BYTES) {
+        size_t n = PARS_MAX_OUTPUT_BYTES;
+        size_t lead = n;
+        while (lead > 0 && ((unsigned char)ps->output.data[lead - 1] & 0xC0) == 0x80) lead--;
+        if (lead > 0) {
+            unsigned char c = (unsigned char)ps->output.data[lead - 1];
+            size_t need = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+            if (n - (lead - 1) < need) n = lead - 1;
+        }
+        ps->output.len = n;
+    }
+    if (len > PARS_MAX_OUTPUT_BYTES) strbuf_append(&ps->output, "...", 3);
+
+    StrBuf *rec = &ps->rec;
+    strbuf_reset(rec);
+    int rc = strbuf_append_str(rec, "{\"instruction\": \"");
+    rc |= json_escape_append(rec, INSTRUCTION_PREFIX, sizeof(INSTRUCTION_PREFIX) - 1);
+    rc |= json_escape_append(rec, ps->sentence.data, ps->sentence.len);
+    rc |= strbuf_append_str(rec, "\\\"\", \"output\": \"");
+    rc |= json_escape_append(rec, ps->output.data, ps->output.len);
+    rc |= strbuf_append_str(rec, "\"}\n");
+    if (rc == 0) append_result(res, lang, &ps->output, rec);
+}
+
+// Абзацы как у awk RS="": разделитель — два и более перевода строки,
+// внутри абзаца переводы строк заменяются пробелами. text меняется на месте
+static void process_text(ParsShared *sh, char *text, size_t len, StrBuf *res, ParaScratch *ps) {
+    // sed 's/\r//g'; NUL в переменную bash не попадает
+    size_t w = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (text[i] != '\r' && text[i] != '\0') text[w++] = text[i];
+    }
+    len = w;
+    text[len] = '\0';
+
+    size_t i = 0;
+    for (;;) {
+        while (i < len && text[i] == '\n') i++;
+        if (i >= len) break;
+        size_t start = i;
+        char *sep = memmem(text + start, len - start, "\n\n", 2);
+        size_t end = sep ? (size_t)(sep - text) : len;
+        while (end > start && text[end - 1] == '\n') end--;
+        for (size_t k = start; k < end; k++) {
+            if (text[k] == '\n') text[k] = ' ';
+        }
+        char saved = text[end];
+        text[end] = '\0';   // для strcspn в process_paragraph
+        ps->paragraphs++;
+        process_paragraph(sh, text + start, end - start, res, ps);
+        text[end] = saved;
+        i = end;
+    }
+}
+
+// === Пул ===
+
+// Под out_lock: готовые по порядку адреса — дедупликация и запись
+static void commit_ready(ParsShared *sh) {
+    const ParsConfig *cfg = sh->cfg;
+    while (sh->next_commit < sh->list->count && sh->done[sh->next_commit]) {
+        StrBuf *res = &sh->results[sh->next_commit];
+        size_t pos = 0;
+        while (pos < res->len) {
+            LangId lang = (LangId)(unsigned char)res->data[pos++];
+            size_t key_len, rec_len;
+            memcpy(&key_len, res->data + pos, sizeof(key_len));
+            const char *key = res->data + pos + sizeof(key_len);
+            pos += sizeof(key_len) + key_len;
+            memcpy(&rec_len, res->data + pos, sizeof(rec_len));
+            const char *rec = res->data + pos + sizeof(rec_len);
+            pos += sizeof(rec_len) + rec_len;
+            // Квота — до индекса, отпечаток — после записи: запись сверх квоты
+            // или не записанная не помечается как виденная. В файл индекса
+            // отложенное уходит после ds_writer_close (fpindex.h)
+            if (cfg->lang && !langid_filter_take(cfg->lang, lang)) continue;
+            unsigned char fp[FPINDEX_FP_SIZE];
+            if (cfg->dedup) fpindex_fingerprint(key, key_len, fp);
+            if (cfg->dedup && fpindex_seen_fp(cfg->dedup, fp) == 1) {
+                sh->stats.duplicates++;
+                if (cfg->lang) langid_filter_refund(cfg->lang, lang);
+            } else if (ds_writer_write(cfg->out, rec, rec_len) == 0) {
+                sh->stats.records++;
+                if (cfg->dedup) fpindex_stage_fp(cfg->dedup, fp);
+            } else if (cfg->lang) {
+                langid_filter_refund(cfg->lang, lang);
+            }
+        }
+        strbuf_free(res);
+        sh->next_commit++;
+    }
+}
+
+static void *worker(void *arg) {
+    ParsShared *sh = (ParsShared *)arg;
+    ParaScratch ps = {0};
+    StrBuf text = {0};
+    for (;;) {
+        size_t i = __atomic_fetch_add(&sh->next, 1, __ATOMIC_RELAXED);
+        if (i >= sh->list->count) break;
+        const char *url = sh->list->urls[i];
+        StrBuf res = {0};
+
+        char *body = NULL;
+        size_t size = 0;
+        int is_html = 0;
+        int rc = load(sh, url, &body, &size, &is_html);
+        if (rc == 1) {
+            ALOG_RL(ALOG_WARN, 20, "skip", AF_S("reason", "robots.txt"), AF_S("url", url));
+            __atomic_fetch_add(&sh->stats.robots_blocked, 1, __ATOMIC_RELAXED);
+        } else if (rc != 0) {
+            ALOG_RL(ALOG_WARN, 20, "skip",
+                    AF_S("reason", strncmp(url, "http", 4) == 0 ? "download failed" : "no such file"),
+                    AF_S("url", url));
+            __atomic_fetch_add(&sh->stats.failed, 1, __ATOMIC_RELAXED);
+        } else {
+            strbuf_reset(&text);
+            if (sh->cfg->html == PARS_HTML_STRIP_TAGS) {
+                strip_tags(body, size, &text);
+            } else {
+                if (is_html) html_to_text(body, size, &text);
+                else strbuf_append(&text, body, size);
+                NormOptions opt = { .max_bytes = 0, .keep_paragraphs = 1 };
+                text.len = text_normalize(text.data, text.len, &opt, NULL);
+            }
+            if (strbuf_reserve(&text, 1) == 0) process_text(sh, text.data, text.len, &res, &ps);
+        }
+        free(body);
+
+        pthread_mutex_lock(&sh->out_lock);
+        sh->results[i] = res;
+        sh->done[i] = 1;
+        commit_ready(sh);
+        pthread_mutex_unlock(&sh->out_lock);
+    }
+    __atomic_fetch_add(&sh->stats.paragraphs, ps.paragraphs, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&sh->stats.matched, ps.matched, __ATOMIC_RELAXED);
+    strbuf_free(&ps.sentence);
+    strbuf_free(&ps.output);
+    strbuf_free(&ps.rec);
+    strbuf_free(&text);
+    return NULL;
+}
+
+// Строки списка без пробелов по краям; пустые пропускаются
+// 0 или -1 с errno: список не открылся, не дочитался или не поместился в память
+static int read_list(const char *path, UrlList *list) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    int rc = 0;
+    size_t cap = 0;
+    char *line = NULL;
+    size_t line_cap = 0;
+    ssize_t n;
+    while ((n = getline(&line, &line_cap, f)) != -1) {
+        char *s = line;
+        while (n > 0 && is_space((unsigned char)s[n - 1])) n--;
+        s[n] = '\0';
+        while (*s && is_space((unsigned char)*s)) s++;
+        if (!*s) continue;
+        if (list->count == cap) {
+            cap = cap ? cap * 2 : 64;
+            char **urls = realloc(list->urls, cap * sizeof(*urls));
+            if (!urls) { rc = -1; break; }
+            list->urls = urls;
+        }
+        if (!(list->urls[list->count] = strdup(s))) { rc = -1; break; }
+        list->count++;
+    }
+    if (rc == 0 && ferror(f)) rc = -1;
+    int saved = errno;
+    free(line);
+    fclose(f);
+    errno = saved;
+    return rc;
+}
+
+// === API ===
+
+int pars_run(const ParsConfig *cfg_in, ParsStats *stats) {
+    ParsConfig cfg = *cfg_in;
+    if (cfg.jobs <= 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        cfg.jobs = n > 0 ? (int)n : 1;
+    }
+
+    UrlList list = {0};
+    ParsShared sh;
+    memset(&sh, 0, sizeof(sh));
+    int rc = -1;
+    if (read_list(cfg.urls_path, &list) != 0) goto out;
+
+    sh.cfg = &cfg;
+    sh.list = &list;
+    sh.keywords = relevance_build(PARS_KEYWORDS, sizeof(PARS_KEYWORDS) / sizeof(PARS_KEYWORDS[0]));
+    sh.results = calloc(list.count ? list.count : 1, sizeof(*sh.results));
+    sh.done = calloc(list.count ? list.count : 1, 1);
+    if (!sh.keywords || !sh.results || !sh.done) { errno = ENOMEM; goto out; }
+    sh.stats.urls = list.count;
+    pthread_mutex_init(&sh.out_lock, NULL);
+
+    int n_threads = cfg.jobs;
+    if ((size_t)n_threads > list.count) n_threads = list.count ? (int)list.count : 1;
+    pthread_t *threads = calloc((size_t)n_threads, sizeof(pthread_t));
+    int started = 0;
+    if (threads) {
+        for (; started < n_threads; started++) {
+            if (pthread_create(&threads[started], NULL, worker, &sh) != 0) break;
+        }
+    }
+    if (started == 0) worker(&sh);  // не удалось создать потоки — работаем в текущем
+    for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+    free(threads);
+    pthread_mutex_destroy(&sh.out_lock);
+    rc = 0;
+
+out:;
+    int saved = errno;
+    if (stats) *stats = sh.stats;
+    relevance_free(sh.keywords);
+    free(sh.results);
+    free(sh.done);
+    for (size_t i = 0; i < list.count; i++) free(list.urls[i]);
+    free(list.urls);
+    errno = saved;
+    return rc;
+}
@@ -0,0 +1,67 @@
+// pars.h — пары {"instruction","output"} из списка URL (бывший pars.sh)
+//
+// Для каждого адреса из списка (http(s) или путь к локальному файлу):
+// текст страницы → абзацы → фильтр по ключевым словам → первая фраза в
+// инструкцию, сам абзац (до 800 байт) в ответ. Всё в одном процессе:
+// ключевые слова — один автомат (relevance.h), экранирование — json_escape.
+// Адреса обрабатываются пулом потоков, но записи выходят строго в порядке
+// списка, и дедупликация идёт в том же порядке — вывод не зависит от jobs.
+//
+// С фильтром по языку (lang) абзац, прошедший ключевые слова, проверяется
+// langid: чужой язык отбрасывается сразу, квота считается при записи — в
+// порядке списка, так что и с квотами вывод не зависит от jobs. Формат
+// строки от фильтра не меняется.
+//
+// Правила разбиения, обрезки и формат строки повторяют pars.sh байт в байт
+// (в том числе пробелы после ':' и ',' как у json.dumps). HTML→текст:
+//   PARS_HTML_LIBXML     — дерево libxml, блочные элементы дают абзацы;
+//   PARS_HTML_STRIP_TAGS — запасной путь pars.sh (sed 's/<[^>]*>/ /g'),
+//                          чтобы сверить вывод со скриптом через diff.
+
+#ifndef PARS_H
+#define PARS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "fpindex.h"
+#include "fetch_cache.h"
+#include "robots.h"
+#include "ds_writer.h"
+#include "langid.h"
+
+#define PARS_MIN_PARAGRAPH_CHARS 80
+#define PARS_MAX_OUTPUT_BYTES 800
+#define PARS_MAX_SENTENCE_CHARS 200
+
+typedef enum {
+    PARS_HTML_LIBXML = 0,
+    PARS_HTML_STRIP_TAGS
+} ParsHtmlMode;
+
+typedef struct {
+    const char *urls_path;
+    int jobs;                  // 0 → число CPU
+    ParsHtmlMode html;
+    FetchCache *cache;
+    RobotsCache *robots;       // NULL → robots.txt не учитывается
+    DsWriter *out;
+    FpIndex *dedup;            // NULL → без дедупликации
+    LangFilter *lang;          // NULL → без фильтра по языку
+} ParsConfig;
+
+typedef struct {
+    uint64_t urls;
+    uint64_t failed;           // не скачался / нет файла
+    uint64_t robots_blocked;
+    uint64_t paragraphs;
+    uint64_t matched;          // прошли длину и ключевые слова
+    uint64_t records;
+    uint64_t duplicates;
+} ParsStats;
+
+// 0 или -1 с errno: список адресов не прочитан (ENOENT, EACCES…) или нет
+// памяти (ENOMEM). Сбой записи виден в ds_writer_close
+int pars_run(const ParsConfig *cfg, ParsStats *stats);
+
+#endif // PARS_H
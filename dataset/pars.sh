@@ -5,9 +5,15 @@ set -euo pipefail
 #   ./collect_re_prompts.sh urls.txt output.jsonl
 # urls.txt: список URL или путей к локальным html файлов (по одному на строку)
 # output.jsonl: файл с JSON-объектами по одному на строку: {"instruction":"...","output":"..."}
+#
+# То же самое без процесса на каждый абзац: ./build_osdev_dataset pars urls.txt output.jsonl
+# (dataset.c, pars.c); с --strip-tags вывод совпадает с этим скриптом без lynx/w3m/html2text
 
 URLS_FILE="${1:-urls.txt}"
 OUT_FILE="${2:-prompts.jsonl}"
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+# Общий с dataset.c (и его --crawl) индекс дедупликации (см. fpindex.h)
+export OSDEV_DEDUP_INDEX="${OSDEV_DEDUP_INDEX:-osdev_dedup.fpi}"
 
 # Dependencies: curl or wget, python3, one of: lynx/w3m/html2text (for HTML->text)
 # Check deps
@@ -35,6 +41,8 @@ fi
 
 # Keywords to match (case-insensitive). Добавляйте по вкусу.
 KEYWORDS=("reverse" "reverse-engineering" "reverse engineering" "ELF" "stack canary" "stack_chk_fail" "stack protector" "canary" "Ghidra" "radare" "rizin" "IDA" "disassembly" "disassemble" "decompile" "binary analysis" "objdump" "strace" "ltrace")
+KEYWORD_ARGS=()
+for kw in "${KEYWORDS[@]}"; do KEYWORD_ARGS+=(-e "$kw"); done
 
 # function: check robots.txt (basic): if /robots.txt disallows path with User-agent: *
 check_robots() {
@@ -73,8 +81,8 @@ check_robots() {
   fi
 }
 
-# create/empty output
-: > "$OUT_FILE"
+# create output if missing (appending across runs — duplicates are filtered by the index)
+touch "$OUT_FILE"
 
 # helper: escape string to JSON using python
 json_escape() {
@@ -129,15 +137,8 @@ while IFS= read -r url || [ -n "$url" ]; do
     p_trim=$(echo "$p" | sed -E 's/^[[:space:]]+|[[:space:]]+$//g')
     [ "${#p_trim}" -lt 80 ] && continue
 
-    # check keywords
-    matched=0
-    for kw in "${KEYWORDS[@]}"; do
-      if echo "$p_trim" | grep -qi -- "$kw"; then
-        matched=1
-        break
-      fi
-    done
-    [ "$matched" -eq 0 ] && continue
+    # check keywords: one grep with all fixed patterns (single multi-pattern pass)
+    printf '%s' "$p_trim" | grep -qiF "${KEYWORD_ARGS[@]}" || continue
 
     # extract first sentence (naive): up to first . ? !
     first_sentence=$(echo "$p_trim" | sed -E 's/^[[:space:]]+//; s/[[:space:]]+$//; s/([.?!]).*/\1/; s/\s+/ /g' | awk '{
@@ -158,14 +159,20 @@ while IFS= read -r url || [ -n "$url" ]; do
 
     # write JSON object (one per line)
     # use python to ensure proper escaping and no ascii-escape
-    json_obj=$(printf '%s\n%s\n' "$instruction" "$output_text" | python3 - <<PY
+    # (заодно проверяем дубликаты по персистентному индексу)
+    # (программа — через -c: heredoc занял бы stdin, и запись читалась бы пустой)
+    json_obj=$(printf '%s\n%s\n' "$instruction" "$output_text" | python3 -c '
 import sys, json
+sys.path.insert(0, sys.argv[1])
+from fpindex import FpIndex
 ins = sys.stdin.readline().rstrip("\n")
 out = sys.stdin.read().rstrip("\n")
-obj = {"instruction": ins, "output": out}
-print(json.dumps(obj, ensure_ascii=False))
-PY
-)
+with FpIndex() as dedup:
+    if not dedup.check_and_add(out):
+        obj = {"instruction": ins, "output": out}
+        print(json.dumps(obj, ensure_ascii=False))
+' "$SCRIPT_DIR/parser_data")
+    [ -z "$json_obj" ] && continue
     printf '%s\n' "$json_obj" >> "$OUT_FILE"
   done
 
@@ -0,0 +1,181 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Python-доступ к персистентному индексу дедупликации (формат dataset/fpindex.h).
+
+Индекс — таблица с открытой адресацией по 128-битным отпечаткам
+(первые 16 байт SHA-256). Файл отображается через mmap, обновления
+дописывают отпечаток в пустой слот под flock на <index>.lock —
+так же, как это делает C-версия, поэтому сборщики можно запускать
+одновременно и по очереди.
+"""
+
+import fcntl
+import hashlib
+import mmap
+import os
+import struct
+
+MAGIC = b"OXFPIDX1"
+VERSION = 1
+FP_SIZE = 16
+INITIAL_SLOTS = 1 << 16
+DEFAULT_PATH = "osdev_dedup.fpi"
+ENV = "OSDEV_DEDUP_INDEX"
+
+# magic, version, fp_size, slot_count, used, reserved
+HEADER = struct.Struct("<8sIIQQ32s")
+EMPTY = bytes(FP_SIZE)
+
+
+def default_path():
+    return os.environ.get(ENV) or DEFAULT_PATH
+
+
+def fingerprint(data):
+    if isinstance(data, str):
+        data = data.encode("utf-8")
+    fp = bytearray(hashlib.sha256(data).digest()[:FP_SIZE])
+    if fp == EMPTY:
+        fp[-1] = 1
+    return bytes(fp)
+
+
+class FpIndex:
+    def __init__(self, path=None):
+        self.path = path or default_path()
+        self.lock = open(self.path + ".lock", "a+b")
+        self.f = None
+        self.mm = None
+        self.inode = None
+        with self._locked(fcntl.LOCK_EX):
+            self._map()
+
+    # --- низкоуровневое ---
+
+    def _locked(self, mode):
+        idx = self
+
+        class _Lock:
+            def __enter__(self):
+                fcntl.flock(idx.lock, mode)
+
+            def __exit__(self, *exc):
+                fcntl.flock(idx.lock, fcntl.LOCK_UN)
+
+        return _Lock()
+
+    @staticmethod
+    def _init_file(f, slots):
+        f.truncate(HEADER.size + slots * FP_SIZE)
+        f.seek(0)
+        f.write(HEADER.pack(MAGIC, VERSION, FP_SIZE, slots, 0, bytes(32)))
+        f.flush()
+
+    def _map(self):
+        self._unmap()
+        self.f = open(self.path, "r+b" if os.path.exists(self.path) else "w+b")
+        st = os.fstat(self.f.fileno())
+        if st.st_size == 0:
+            self._init_file(self.f, INITIAL_SLOTS)
+            st = os.fstat(self.f.fileno())
+        self.mm = mmap.mmap(self.f.fileno(), st.st_size)
+        self.inode = st.st_ino
+        magic, version, fp_size, slots, _, _ = HEADER.unpack_from(self.mm, 0)
+        if magic != MAGIC or version != VERSION or fp_size != FP_SIZE or \
+                HEADER.size + slots * FP_SIZE != st.st_size:
+            raise ValueError(f"fpindex: '{self.path}' is not a valid index")
+
+    def _unmap(self):
+        if self.mm is not None:
+            self.mm.close()
+        if self.f is not None:
+            self.f.close()
+        self.mm = self.f = None
+
+    def _refresh(self):
+        try:
+            st = os.stat(self.path)
+        except FileNotFoundError:
+            st = None
+        if st is None or st.st_ino != self.inode or st.st_size != len(self.mm):
+            self._map()
+
+    def _header(self):
+        return HEADER.unpack_from(self.mm, 0)
+
+    @staticmethod
+    def _probe(mm, slots, fp):
+        mask = slots - 1
+        pos = int.from_bytes(fp[:8], "little") & mask
+        for _ in range(slots):
+            off = HEADER.size + pos * FP_SIZE
+            slot = mm[off:off + FP_SIZE]
+            if slot == fp:
+                return off, True
+            if slot == EMPTY:
+                return off, False
+            pos = (pos + 1) & mask
+        return None, False
+
+    def _grow(self):
+        _, _, _, slots, _, _ = self._header()
+        new_slots = slots * 2
+        tmp = f"{self.path}.tmp.{os.getpid()}"
+        with open(tmp, "w+b") as f:
+            self._init_file(f, new_slots)
+            mm = mmap.mmap(f.fileno(), HEADER.size + new_slots * FP_SIZE)
+            used = 0
+            for i in range(slots):
+                off = HEADER.size + i * FP_SIZE
+                fp = self.mm[off:off + FP_SIZE]
+                if fp == EMPTY:
+                    continue
+                dst, found = self._probe(mm, new_slots, fp)
+                if dst is not None and not found:
+                    mm[dst:dst + FP_SIZE] = fp
+                    used += 1
+            struct.pack_into("<Q", mm, 24, used)
+            mm.flush()
+            mm.close()
+        os.rename(tmp, self.path)
+        self._map()
+
+    # --- API ---
+
+    def __len__(self):
+        return self._header()[4]
+
+    def contains(self, data):
+        fp = fingerprint(data)
+        with self._locked(fcntl.LOCK_SH):
+            self._refresh()
+            _, found = self._probe(self.mm, self._header()[3], fp)
+            return found
+
+    def check_and_add(self, data):
+        """True — запись уже была, False — новая (и записана в индекс)."""
+        fp = fingerprint(data)
+        with self._locked(fcntl.LOCK_EX):
+            self._refresh()
+            _, _, _, slots, used, _ = self._header()
+            off, found = self._probe(self.mm, slots, fp)
+            if found:
+                return True
+            if (used + 1) * 10 > slots * 7:
+                self._grow()
+                _, _, _, slots, used, _ = self._header()
+                off, _ = self._probe(self.mm, slots, fp)
+            self.mm[off:off + FP_SIZE] = fp
+            struct.pack_into("<Q", self.mm, 24, used + 1)
+            return False
+
+    def close(self):
+        self._unmap()
+        self.lock.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
@@ -0,0 +1,1497 @@
+// pdf.c — извлечение текста из PDF (см. pdf.h)
+
+#define _GNU_SOURCE
+#include "pdf.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <zlib.h>
+
+#include "json_escape.h"
+
+#define PDF_MAX_DEPTH 64
+#define PDF_MAX_OBJECTS (1u << 23)
+#define PDF_ARENA_BLOCK (64 * 1024)
+#define PDF_MAX_FILTERS 4
+#define PDF_MAX_STREAM (256u << 20)   // предел распакованного потока
+#define PDF_GSTATE_DEPTH 32
+
+// Пороги разбиения текста, в долях кегля
+#define PDF_PARAGRAPH_GAP 1.6
+#define PDF_LINE_GAP 0.5
+#define PDF_WORD_GAP 0.15
+
+// === Арена: объекты документа живут до конца разбора ===
+
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t used, cap;
+    _Alignas(16) unsigned char data[];
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock *head;
+} Arena;
+
+static void *arena_alloc(Arena *a, size_t n) {
+    n = (n + 15) & ~(size_t)15;
+    ArenaBlock *b = a->head;
+    if (!b || b->cap - b->used < n) {
+        size_t cap = n > PDF_ARENA_BLOCK ? n : PDF_ARENA_BLOCK;
+        b = malloc(sizeof(*b) + cap);
+        if (!b) return NULL;
+        b->next = a->head;
+        b->used = 0;
+        b->cap = cap;
+        a->head = b;
+    }
+    void *p = b->data + b->used;
+    b->used += n;
+    return p;
+}
+
+static void arena_free(Arena *a) {
+    while (a->head) {
+        ArenaBlock *next = a->head->next;
+        free(a->head);
+        a->head = next;
+    }
+}
+
+// Оставляет последний блок, чтобы операнды страницы не дёргали malloc
+static void arena_reset(Arena *a) {
+    if (!a->head) return;
+    ArenaBlock *keep = a->head;
+    a->head = keep->next;
+    arena_free(a);
+    keep->next = NULL;
+    keep->used = 0;
+    a->head = keep;
+}
+
+// === Объекты ===
+
+typedef enum {
+    PDF_NULL, PDF_BOOL, PDF_NUM, PDF_NAME, PDF_STRING,
+    PDF_ARRAY, PDF_DICT, PDF_REF, PDF_KEYWORD
+} PdfType;
+
+typedef struct PdfObj {
+    PdfType type;
+    double num;                // NUM, BOOL
+    const char *s;             // NAME (без '/'), STRING (раскодированная), KEYWORD
+    size_t len;
+    struct PdfObj **items;     // ARRAY; DICT — пары ключ/значение подряд
+    size_t n;
+    uint32_t ref;              // номер объекта для REF
+    const char *stream;        // DICT, за которым следует поток
+    size_t stream_len;
+    int mark;                  // обход дерева страниц
+    void *font;                // разобранный шрифт (кэш)
+} PdfObj;
+
+typedef struct {
+    const char *p, *end;
+} Lexer;
+
+static int is_ws(unsigned char c) {
+    return c == 0 || c == 9 || c == 10 || c == 12 || c == 13 || c == 32;
+}
+
+static int is_delim(unsigned char c) {
+    return c == '(' || c == ')' || c == '<' || c == '>' || c == '[' || c == ']' ||
+           c == '{' || c == '}' || c == '/' || c == '%';
+}
+
+static int is_regular(unsigned char c) {
+    return !is_ws(c) && !is_delim(c);
+}
+
+static int hex_value(unsigned char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static void skip_ws(Lexer *lx) {
+    while (lx->p < lx->end) {
+        unsigned char c = (unsigned char)*lx->p;
+        if (is_ws(c)) {
+            lx->p++;
+        } else if (c == '%') {
+            while (lx->p < lx->end && *lx->p != '\n' && *lx->p != '\r') lx->p++;
+        } else {
+            break;
+        }
+    }
+}
+
+static PdfObj *new_obj(Arena *a, PdfType type) {
+    PdfObj *o = arena_alloc(a, sizeof(*o));
+    if (o) {
+        memset(o, 0, sizeof(*o));
+        o->type = type;
+    }
+    return o;
+}
+
+static int keyword_is(const PdfObj *o, const char *kw) {
+    return o && o->type == PDF_KEYWORD && o->len == strlen(kw) && memcmp(o->s, kw, o->len) == 0;
+}
+
+static int name_is(const PdfObj *o, const char *name) {
+    return o && o->type == PDF_NAME && o->len == strlen(name) && memcmp(o->s, name, o->len) == 0;
+}
+
+static int parse_uint(Lexer *lx, uint64_t *out) {
+    if (lx->p >= lx->end || *lx->p < '0' || *lx->p > '9') return -1;
+    uint64_t v = 0;
+    while (lx->p < lx->end && *lx->p >= '0' && *lx->p <= '9') {
+        v = v * 10 + (uint64_t)(*lx->p - '0');
+        if (v > UINT32_MAX) v = UINT32_MAX;
+        lx->p++;
+    }
+    *out = v;
+    return 0;
+}
+
+static PdfObj *parse_number(Lexer *lx, Arena *a) {
+    int neg = 0, is_int = 1;
+    double v = 0, scale = 0.1;
+    while (lx->p < lx->end && (*lx->p == '+' || *lx->p == '-')) neg ^= *lx->p++ == '-';
+    for (; lx->p < lx->end; lx->p++) {
+        char c = *lx->p;
+        if (c >= '0' && c <= '9') {
+            if (is_int) v = v * 10 + (c - '0');
+            else { v += (c - '0') * scale; scale *= 0.1; }
+        } else if (c == '.' && is_int) {
+            is_int = 0;
+        } else {
+            break;
+        }
+    }
+    PdfObj *o = new_obj(a, PDF_NUM);
+    if (!o) return NULL;
+    o->num = neg ? -v : v;
+
+    // "N G R" — косвенная ссылка
+    if (is_int && !neg) {
+        Lexer save = *lx;
+        uint64_t gen;
+        skip_ws(lx);
+        if (parse_uint(lx, &gen) == 0) {
+            skip_ws(lx);
+            if (lx->p < lx->end && *lx->p == 'R' &&
+                (lx->p + 1 == lx->end || !is_regular((unsigned char)lx->p[1]))) {
+                lx->p++;
+                o->type = PDF_REF;
+                o->ref = v > UINT32_MAX ? UINT32_MAX : (uint32_t)v;
+                return o;
+            }
+        }
+        *lx = save;
+    }
+    return o;
+}
+
+static PdfObj *parse_literal(Lexer *lx, Arena *a) {
+    const char *start = ++lx->p;
+    int depth = 1;
+    const char *q = start;
+    for (; q < lx->end; q++) {
+        if (*q == '\\') { q++; continue; }
+        if (*q == '(') depth++;
+        else if (*q == ')' && --depth == 0) break;
+    }
+    if (q >= lx->end) return NULL;
+    PdfObj *o = new_obj(a, PDF_STRING);
+    char *out = o ? arena_alloc(a, (size_t)(q - start) + 1) : NULL;
+    if (!out) return NULL;
+    size_t n = 0;
+    for (const char *p = start; p < q; p++) {
+        if (*p != '\\') {
+            // Конец строки внутри литерала — всегда '\n'
+            if (*p == '\r') {
+                if (p + 1 < q && p[1] == '\n') p++;
+                out[n++] = '\n';
+            } else {
+                out[n++] = *p;
+            }
+            continue;
+        }
+        if (++p >= q) break;
+        switch (*p) {
+            case 'n': out[n++] = '\n'; break;
+            case 'r': out[n++] = '\r'; break;
+            case 't': out[n++] = '\t'; break;
+            case 'b': out[n++] = '\b'; break;
+            case 'f': out[n++] = '\f'; break;
+            case '\r': if (p + 1 < q && p[1] == '\n') p++; break;
+            case '\n': break;
+            default:
+                if (*p >= '0' && *p <= '7') {
+                    int v = 0;
+                    for (int k = 0; k < 3 && p < q && *p >= '0' && *p <= '7'; k++, p++) v = v * 8 + (*p - '0');
+                    p--;
+                    out[n++] = (char)v;
+                } else {
+                    out[n++] = *p;
+                }
+        }
+    }
+    out[n] = '\0';
+    o->s = out;
+    o->len = n;
+    lx->p = q + 1;
+    return o;
+}
+
+static PdfObj *parse_hex(Lexer *lx, Arena *a) {
+    const char *start = ++lx->p;
+    const char *q = memchr(start, '>', (size_t)(lx->end - start));
+    if (!q) return NULL;
+    PdfObj *o = new_obj(a, PDF_STRING);
+    char *out = o ? arena_alloc(a, (size_t)(q - start) / 2 + 2) : NULL;
+    if (!out) return NULL;
+    size_t n = 0;
+    int hi = -1;
+    for (const char *p = start; p < q; p++) {
+        int v = hex_value((unsigned char)*p);
+        if (v < 0) continue;
+        if (hi < 0) hi = v;
+        else { out[n++] = (char)(hi << 4 | v); hi = -1; }
+    }
+    if (hi >= 0) out[n++] = (char)(hi << 4);
+    out[n] = '\0';
+    o->s = out;
+    o->len = n;
+    lx->p = q + 1;
+    return o;
+}
+
+static PdfObj *parse_name(Lexer *lx, Arena *a) {
+    const char *start = ++lx->p;
+    while (lx->p < lx->end && is_regular((unsigned char)*lx->p)) lx->p++;
+    PdfObj *o = new_obj(a, PDF_NAME);
+    size_t len = (size_t)(lx->p - start);
+    if (!o) return NULL;
+    if (!memchr(start, '#', len)) {
+        o->s = start;
+        o->len = len;
+        return o;
+    }
+    char *out = arena_alloc(a, len + 1);
+    if (!out) return NULL;
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+        int h1, h2;
+        if (start[i] == '#' && i + 2 < len &&
+            (h1 = hex_value((unsigned char)start[i + 1])) >= 0 &&
+            (h2 = hex_value((unsigned char)start[i + 2])) >= 0) {
+            out[n++] = (char)(h1 << 4 | h2);
+            i += 2;
+        } else {
+            out[n++] = start[i];
+        }
+    }
+    out[n] = '\0';
+    o->s = out;
+    o->len = n;
+    return o;
+}
+
+static PdfObj *parse_obj(Lexer *lx, Arena *a, int depth);
+
+// Элементы массива или словаря до закрывающего ']' / '>>'
+static PdfObj *parse_container(Lexer *lx, Arena *a, int depth, PdfType type) {
+    PdfObj **tmp = NULL;
+    size_t n = 0, cap = 0;
+    PdfObj *o = NULL;
+    lx->p += type == PDF_DICT ? 2 : 1;
+    for (;;) {
+        skip_ws(lx);
+        if (lx->p >= lx->end) goto out;
+        if (type == PDF_ARRAY && *lx->p == ']') { lx->p++; break; }
+        if (type == PDF_DICT && *lx->p == '>' && lx->p + 1 < lx->end && lx->p[1] == '>') { lx->p += 2; break; }
+        PdfObj *item = parse_obj(lx, a, depth + 1);
+        if (!item) goto out;
+        if (n == cap) {
+            cap = cap ? cap * 2 : 8;
+            PdfObj **p = realloc(tmp, cap * sizeof(*p));
+            if (!p) goto out;
+            tmp = p;
+        }
+        tmp[n++] = item;
+    }
+    if (type == PDF_DICT && (n & 1)) n--;   // ключ без значения
+    o = new_obj(a, type);
+    if (o && n) {
+        o->items = arena_alloc(a, n * sizeof(*o->items));
+        if (!o->items) { o = NULL; goto out; }
+        memcpy(o->items, tmp, n * sizeof(*tmp));
+    }
+    if (o) o->n = n;
+out:
+    free(tmp);
+    return o;
+}
+
+static PdfObj *parse_obj(Lexer *lx, Arena *a, int depth) {
+    if (depth > PDF_MAX_DEPTH) return NULL;
+    skip_ws(lx);
+    if (lx->p >= lx->end) return NULL;
+    unsigned char c = (unsigned char)*lx->p;
+    switch (c) {
+        case '/': return parse_name(lx, a);
+        case '(': return parse_literal(lx, a);
+        case '[': return parse_container(lx, a, depth, PDF_ARRAY);
+        case '<':
+            if (lx->p + 1 < lx->end && lx->p[1] == '<') return parse_container(lx, a, depth, PDF_DICT);
+            return parse_hex(lx, a);
+        case ')': case '>': case ']':
+            return NULL;
+        case '{': case '}': {
+            PdfObj *o = new_obj(a, PDF_KEYWORD);
+            if (o) { o->s = lx->p; o->len = 1; lx->p++; }
+            return o;
+        }
+        default: break;
+    }
+    if ((c >= '0' && c <= '9') || c == '+' || c == '-' || c == '.') return parse_number(lx, a);
+
+    const char *start = lx->p;
+    while (lx->p < lx->end && is_regular((unsigned char)*lx->p)) lx->p++;
+    PdfObj *o = new_obj(a, PDF_KEYWORD);
+    if (!o) return NULL;
+    o->s = start;
+    o->len = (size_t)(lx->p - start);
+    if (keyword_is(o, "true") || keyword_is(o, "false")) {
+        o->type = PDF_BOOL;
+        o->num = o->len == 4;
+    } else if (keyword_is(o, "null")) {
+        o->type = PDF_NULL;
+    }
+    return o;
+}
+
+static PdfObj *dict_get(const PdfObj *d, const char *key) {
+    if (!d || d->type != PDF_DICT) return NULL;
+    for (size_t i = 0; i + 1 < d->n; i += 2) {
+        if (name_is(d->items[i], key)) return d->items[i + 1];
+    }
+    return NULL;
+}
+
+// === Документ ===
+
+typedef struct {
+    size_t off;                // "N G obj" в файле; 0 — объект в объектном потоке
+    uint32_t stm;              // объектный поток и смещение внутри распакованного
+    size_t stm_off;
+    PdfObj *obj;
+    int state;                 // 0 — не разобран, 1 — разбирается, 2 — готов
+    char *decoded;             // для объектного потока: распакованное тело
+    size_t decoded_len;
+} XEntry;
+
+typedef struct PdfFont PdfFont;
+
+typedef struct {
+    const char *data;
+    size_t size;
+    Arena arena;
+    XEntry *x;
+    size_t nx;
+    PdfObj *trailer;
+    PdfFont **fonts;
+    size_t n_fonts, fonts_cap;
+} PdfDoc;
+
+typedef enum { F_FLATE, F_ASCII85, F_ASCIIHEX } PdfFilter;
+
+typedef struct {
+    const char *data;
+    size_t len;
+    PdfFilter filters[PDF_MAX_FILTERS];
+    int n_filters;
+    int unsupported;
+} StreamRef;
+
+static PdfObj *pdf_get(PdfDoc *d, uint32_t num);
+
+static PdfObj *resolve(PdfDoc *d, PdfObj *o) {
+    for (int i = 0; o && o->type == PDF_REF && i < 8; i++) o = pdf_get(d, o->ref);
+    return o && o->type == PDF_REF ? NULL : o;
+}
+
+static int as_number(PdfDoc *d, PdfObj *o, double *out) {
+    o = resolve(d, o);
+    if (!o || o->type != PDF_NUM) return -1;
+    *out = o->num;
+    return 0;
+}
+
+static int grow_entries(PdfDoc *d, uint64_t num) {
+    if (num >= PDF_MAX_OBJECTS) return -1;
+    if (num < d->nx) return 0;
+    size_t nx = d->nx ? d->nx : 1024;
+    while (nx <= num) nx *= 2;
+    XEntry *x = realloc(d->x, nx * sizeof(*x));
+    if (!x) return -1;
+    memset(x + d->nx, 0, (nx - d->nx) * sizeof(*x));
+    d->x = x;
+    d->nx = nx;
+    return 0;
+}
+
+// Все "N G obj" подряд; у повторов (инкрементальные обновления) побеждает последний
+static size_t scan_objects(PdfDoc *d) {
+    const char *p = d->data, *end = d->data + d->size;
+    size_t found = 0;
+    while (p < end) {
+        const char *q = memmem(p, (size_t)(end - p), "obj", 3);
+        if (!q) break;
+        p = q + 3;
+        if (q + 3 < end && is_regular((unsigned char)q[3])) continue;
+        const char *s = q;
+        if (s == d->data || !is_ws((unsigned char)s[-1])) continue;
+        while (s > d->data && is_ws((unsigned char)s[-1])) s--;
+        const char *g = s;
+        while (g > d->data && g[-1] >= '0' && g[-1] <= '9') g--;
+        if (g == s || g == d->data || !is_ws((unsigned char)g[-1])) continue;
+        s = g;
+        while (s > d->data && is_ws((unsigned char)s[-1])) s--;
+        const char *n = s;
+        while (n > d->data && n[-1] >= '0' && n[-1] <= '9') n--;
+        if (n == s || (n > d->data && is_regular((unsigned char)n[-1]))) continue;
+
+        uint64_t num = 0;
+        for (const char *k = n; k < s; k++) num = num * 10 + (uint64_t)(*k - '0');
+        if (num == 0 || grow_entries(d, num) != 0) continue;
+        d->x[num].off = (size_t)(n - d->data);
+        d->x[num].stm = 0;
+        found++;
+        // Тело объекта (и его поток) пропускаем целиком
+        const char *eo = memmem(q + 3, (size_t)(end - q - 3), "endobj", 6);
+        if (eo) p = eo + 6;
+    }
+    return found;
+}
+
+static void stream_ref(PdfDoc *d, PdfObj *dict, StreamRef *sr) {
+    memset(sr, 0, sizeof(*sr));
+    sr->data = dict->stream;
+    sr->len = dict->stream_len;
+    PdfObj *f = resolve(d, dict_get(dict, "Filter"));
+    size_t count = f && f->type == PDF_ARRAY ? f->n : (f ? 1 : 0);
+    for (size_t i = 0; i < count; i++) {
+        PdfObj *name = f->type == PDF_ARRAY ? resolve(d, f->items[i]) : f;
+        if (sr->n_filters == PDF_MAX_FILTERS) { sr->unsupported = 1; break; }
+        if (name_is(name, "FlateDecode") || name_is(name, "Fl")) sr->filters[sr->n_filters++] = F_FLATE;
+        else if (name_is(name, "ASCII85Decode") || name_is(name, "A85")) sr->filters[sr->n_filters++] = F_ASCII85;
+        else if (name_is(name, "ASCIIHexDecode") || name_is(name, "AHx")) sr->filters[sr->n_filters++] = F_ASCIIHEX;
+        else sr->unsupported = 1;
+    }
+    // Предиктор PNG/TIFF встречается в xref-потоках, не в тексте
+    PdfObj *parms = resolve(d, dict_get(dict, "DecodeParms"));
+    double predictor;
+    if (parms && parms->type == PDF_DICT && as_number(d, dict_get(parms, "Predictor"), &predictor) == 0 &&
+        predictor > 1) sr->unsupported = 1;
+}
+
+static int inflate_into(const unsigned char *in, size_t len, StrBuf *out) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit(&zs) != Z_OK) return -1;
+    zs.next_in = (unsigned char *)in;
+    zs.avail_in = (uInt)(len > UINT32_MAX ? UINT32_MAX : len);
+    int rc;
+    do {
+        if (strbuf_reserve(out, len * 2 + 4096) != 0 || out->len > PDF_MAX_STREAM) { rc = Z_MEM_ERROR; break; }
+        size_t room = out->cap - out->len - 1;
+        zs.next_out = (unsigned char *)out->data + out->len;
+        zs.avail_out = (uInt)(room > UINT32_MAX ? UINT32_MAX : room);
+        rc = inflate(&zs, Z_NO_FLUSH);
+        out->len += (size_t)((char *)zs.next_out - (out->data + out->len));
+    } while (rc == Z_OK);
+    inflateEnd(&zs);
+    // Обрезанный поток — берём то, что успело распаковаться
+    return rc == Z_STREAM_END || (rc == Z_BUF_ERROR && out->len > 0) || (rc == Z_DATA_ERROR && out->len > 0) ? 0 : -1;
+}
+
+static int ascii85_into(const unsigned char *in, size_t len, StrBuf *out) {
+    if (strbuf_reserve(out, len + 8) != 0) return -1;
+    uint32_t acc = 0;
+    int n = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = in[i];
+        if (c == '~') break;
+        if (is_ws(c)) continue;
+        if (c == 'z' && n == 0) {
+            memset(out->data + out->len, 0, 4);
+            out->len += 4;
+            continue;
+        }
+        if (c < '!' || c > 'u') return -1;
+        acc = acc * 85 + (uint32_t)(c - '!');
+        if (++n == 5) {
+            for (int k = 3; k >= 0; k--) out->data[out->len++] = (char)(acc >> (8 * k));
+            acc = 0;
+            n = 0;
+        }
+    }
+    if (n > 1) {
+        for (int k = n; k < 5; k++) acc = acc * 85 + 84;
+        for (int k = 0; k < n - 1; k++) out->data[out->len++] = (char)(acc >> (24 - 8 * k));
+    }
+    return 0;
+}
+
+static int asciihex_into(const unsigned char *in, size_t len, StrBuf *out) {
+    if (strbuf_reserve(out, len / 2 + 2) != 0) return -1;
+    int hi = -1;
+    for (size_t i = 0; i < len && in[i] != '>'; i++) {
+        int v = hex_value(in[i]);
+        if (v < 0) continue;
+        if (hi < 0) hi = v;
+        else { out->data[out->len++] = (char)(hi << 4 | v); hi = -1; }
+    }
+    if (hi >= 0) out->data[out->len++] = (char)(hi << 4);
+    return 0;
+}
+
+// Тело потока после всех фильтров; tmp — рабочий буфер для цепочки
+static int decode_stream(const StreamRef *sr, StrBuf *out, StrBuf *tmp) {
+    strbuf_reset(out);
+    if (sr->unsupported || !sr->data) return -1;
+    if (sr->n_filters == 0) return strbuf_append(out, sr->data, sr->len);
+    const unsigned char *in = (const unsigned char *)sr->data;
+    size_t in_len = sr->len;
+    for (int i = 0; i < sr->n_filters; i++) {
+        StrBuf *dst = (sr->n_filters - i) % 2 ? out : tmp;
+        strbuf_reset(dst);
+        int rc = sr->filters[i] == F_FLATE ? inflate_into(in, in_len, dst)
+               : sr->filters[i] == F_ASCII85 ? ascii85_into(in, in_len, dst)
+               : asciihex_into(in, in_len, dst);
+        if (rc != 0) return -1;
+        in = (const unsigned char *)dst->data;
+        in_len = dst->len;
+    }
+    return 0;
+}
+
+// Данные потока после "stream": длина из /Length или поиск "endstream"
+static void attach_stream(PdfDoc *d, PdfObj *dict, Lexer *lx) {
+    skip_ws(lx);
+    if (lx->end - lx->p < 6 || memcmp(lx->p, "stream", 6) != 0) return;
+    const char *p = lx->p + 6;
+    if (p < lx->end && *p == '\r') p++;
+    if (p < lx->end && *p == '\n') p++;
+    size_t avail = (size_t)(lx->end - p);
+    double length;
+    if (as_number(d, dict_get(dict, "Length"), &length) == 0 && length >= 0 && length <= (double)avail) {
+        const char *e = p + (size_t)length;
+        const char *after = e;
+        while (after < lx->end && is_ws((unsigned char)*after)) after++;
+        if (lx->end - after >= 9 && memcmp(after, "endstream", 9) == 0) {
+            dict->stream = p;
+            dict->stream_len = (size_t)length;
+            return;
+        }
+    }
+    const char *e = memmem(p, avail, "endstream", 9);
+    if (!e) return;
+    if (e > p && e[-1] == '\n') e--;
+    if (e > p && e[-1] == '\r') e--;
+    dict->stream = p;
+    dict->stream_len = (size_t)(e - p);
+}
+
+static PdfObj *pdf_get(PdfDoc *d, uint32_t num) {
+    if (num >= d->nx) return NULL;
+    XEntry *e = &d->x[num];
+    if (e->state == 2) return e->obj;
+    if (e->state == 1) return NULL;   // цикл ссылок
+    e->state = 1;
+
+    PdfObj *obj = NULL;
+    if (e->off) {
+        Lexer lx = { d->data + e->off, d->data + d->size };
+        PdfObj *n = parse_obj(&lx, &d->arena, 0);
+        PdfObj *g = parse_obj(&lx, &d->arena, 0);
+        PdfObj *kw = parse_obj(&lx, &d->arena, 0);
+        if (n && g && keyword_is(kw, "obj")) {
+            obj = parse_obj(&lx, &d->arena, 0);
+            if (obj && obj->type == PDF_DICT) attach_stream(d, obj, &lx);
+        }
+    } else if (e->stm && e->stm < d->nx && d->x[e->stm].decoded) {
+        XEntry *host = &d->x[e->stm];
+        Lexer lx = { host->decoded + e->stm_off, host->decoded + host->decoded_len };
+        obj = parse_obj(&lx, &d->arena, 0);
+    }
+    e->obj = obj;
+    e->state = 2;
+    return obj;
+}
+
+// Объекты из объектных потоков (/Type /ObjStm), если их нет в теле файла
+static void expand_object_streams(PdfDoc *d) {
+    StrBuf out = {0}, tmp = {0};
+    size_t nx = d->nx;
+    for (size_t num = 1; num < nx; num++) {
+        if (!d->x[num].off) continue;
+        PdfObj *o = pdf_get(d, (uint32_t)num);
+        if (!o || !o->stream || !name_is(dict_get(o, "Type"), "ObjStm")) continue;
+        double count, first;
+        if (as_number(d, dict_get(o, "N"), &count) != 0 || as_number(d, dict_get(o, "First"), &first) != 0) continue;
+        StreamRef sr;
+        stream_ref(d, o, &sr);
+        if (decode_stream(&sr, &out, &tmp) != 0 || first < 0 || (size_t)first > out.len) continue;
+        char *buf = arena_alloc(&d->arena, out.len + 1);
+        if (!buf) break;
+        memcpy(buf, out.data, out.len);
+        buf[out.len] = '\0';
+        d->x[num].decoded = buf;
+        d->x[num].decoded_len = out.len;
+
+        Lexer lx = { buf, buf + (size_t)first };
+        for (double i = 0; i < count; i++) {
+            uint64_t obj_num, off;
+            skip_ws(&lx);
+            if (parse_uint(&lx, &obj_num) != 0) break;
+            skip_ws(&lx);
+            if (parse_uint(&lx, &off) != 0) break;
+            if (obj_num == 0 || (size_t)first + off >= out.len || grow_entries(d, obj_num) != 0) continue;
+            XEntry *e = &d->x[obj_num];
+            if (e->off || e->state) continue;
+            e->stm = (uint32_t)num;
+            e->stm_off = (size_t)first + (size_t)off;
+        }
+    }
+    strbuf_free(&out);
+    strbuf_free(&tmp);
+}
+
+// Корень: словарь trailer, иначе xref-поток (PDF 1.5), иначе любой /Catalog
+static PdfObj *find_root(PdfDoc *d) {
+    const char *p = d->data, *last = NULL;
+    while ((p = memmem(p, d->size - (size_t)(p - d->data), "trailer", 7))) last = p++;
+    if (last) {
+        Lexer lx = { last + 7, d->data + d->size };
+        PdfObj *t = parse_obj(&lx, &d->arena, 0);
+        if (t && t->type == PDF_DICT && dict_get(t, "Root")) {
+            d->trailer = t;
+            return resolve(d, dict_get(t, "Root"));
+        }
+    }
+    size_t best_off = 0;
+    PdfObj *catalog = NULL;
+    for (size_t num = 1; num < d->nx; num++) {
+        PdfObj *o = d->x[num].off || d->x[num].stm ? pdf_get(d, (uint32_t)num) : NULL;
+        if (!o || o->type != PDF_DICT) continue;
+        if (name_is(dict_get(o, "Type"), "XRef") && dict_get(o, "Root") && d->x[num].off >= best_off) {
+            best_off = d->x[num].off;
+            d->trailer = o;
+        } else if (!catalog && name_is(dict_get(o, "Type"), "Catalog")) {
+            catalog = o;
+        }
+    }
+    if (d->trailer) return resolve(d, dict_get(d->trailer, "Root"));
+    return catalog;
+}
+
+// === Текст: UTF-8 ===
+
+static int put_utf8(StrBuf *b, uint32_t cp) {
+    char u[4];
+    size_t n;
+    if (cp < 0x80) { u[0] = (char)cp; n = 1; }
+    else if (cp < 0x800) { u[0] = (char)(0xC0 | cp >> 6); u[1] = (char)(0x80 | (cp & 0x3F)); n = 2; }
+    else if (cp < 0x10000) {
+        if (cp >= 0xD800 && cp <= 0xDFFF) return 0;
+        u[0] = (char)(0xE0 | cp >> 12); u[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        u[2] = (char)(0x80 | (cp & 0x3F)); n = 3;
+    } else if (cp < 0x110000) {
+        u[0] = (char)(0xF0 | cp >> 18); u[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+        u[2] = (char)(0x80 | ((cp >> 6) & 0x3F)); u[3] = (char)(0x80 | (cp & 0x3F)); n = 4;
+    } else {
+        return 0;
+    }
+    return strbuf_append(b, u, n);
+}
+
+// Лигатуры — обычными буквами: в корпусе они не нужны
+static int put_char(StrBuf *b, uint32_t cp) {
+    static const char *const ligatures[] = { "ff", "fi", "fl", "ffi", "ffl", "ft", "st" };
+    if (cp >= 0xFB00 && cp <= 0xFB06) return strbuf_append_str(b, ligatures[cp - 0xFB00]);
+    if (cp < 0x20 || (cp >= 0x7F && cp < 0xA0)) return 0;
+    if (cp == 0xA0) cp = ' ';
+    return put_utf8(b, cp);
+}
+
+// Windows-1252 для 0x80..0x9F; остальное совпадает с Latin-1
+static const uint16_t CP1252_HIGH[32] = {
+    0x20AC, 0, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021, 0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0, 0x017D, 0,
+    0, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014, 0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0, 0x017E, 0x0178,
+};
+
+// Имена глифов из /Differences, которые встречаются в технических документах
+static const struct { const char *name; uint16_t cp; } GLYPHS[] = {
+    {"space", ' '}, {"exclam", '!'}, {"quotedbl", '"'}, {"numbersign", '#'}, {"dollar", '$'},
+    {"percent", '%'}, {"ampersand", '&'}, {"quoteright", 0x2019}, {"quotesingle", '\''},
+    {"parenleft", '('}, {"parenright", ')'}, {"asterisk", '*'}, {"plus", '+'}, {"comma", ','},
+    {"hyphen", '-'}, {"minus", '-'}, {"period", '.'}, {"slash", '/'}, {"zero", '0'}, {"one", '1'},
+    {"two", '2'}, {"three", '3'}, {"four", '4'}, {"five", '5'}, {"six", '6'}, {"seven", '7'},
+    {"eight", '8'}, {"nine", '9'}, {"colon", ':'}, {"semicolon", ';'}, {"less", '<'}, {"equal", '='},
+    {"greater", '>'}, {"question", '?'}, {"at", '@'}, {"bracketleft", '['}, {"backslash", '\\'},
+    {"bracketright", ']'}, {"asciicircum", '^'}, {"underscore", '_'}, {"quoteleft", 0x2018},
+    {"grave", '`'}, {"braceleft", '{'}, {"bar", '|'}, {"braceright", '}'}, {"asciitilde", '~'},
+    {"bullet", 0x2022}, {"endash", 0x2013}, {"emdash", 0x2014}, {"quotedblleft", 0x201C},
+    {"quotedblright", 0x201D}, {"quotesinglbase", 0x201A}, {"quotedblbase", 0x201E},
+    {"ellipsis", 0x2026}, {"dagger", 0x2020}, {"daggerdbl", 0x2021}, {"section", 0x00A7},
+    {"paragraph", 0x00B6}, {"copyright", 0x00A9}, {"registered", 0x00AE}, {"trademark", 0x2122},
+    {"degree", 0x00B0}, {"multiply", 0x00D7}, {"divide", 0x00F7}, {"periodcentered", 0x00B7},
+    {"dotlessi", 0x0131}, {"germandbls", 0x00DF}, {"lessequal", 0x2264}, {"greaterequal", 0x2265},
+    {"notequal", 0x2260}, {"plusminus", 0x00B1}, {"arrowright", 0x2192}, {"arrowleft", 0x2190},
+    {"logicalnot", 0x00AC}, {"infinity", 0x221E}, {"nbspace", 0x00A0}, {"guillemotleft", 0x00AB},
+    {"guillemotright", 0x00BB}, {"fi", 0xFB01}, {"fl", 0xFB02}, {"ff", 0xFB00}, {"ffi", 0xFB03},
+    {"ffl", 0xFB04}, {"eacute", 0x00E9}, {"egrave", 0x00E8}, {"aacute", 0x00E1}, {"agrave", 0x00E0},
+    {"udieresis", 0x00FC}, {"odieresis", 0x00F6}, {"adieresis", 0x00E4}, {"ccedilla", 0x00E7},
+    {"visiblespace", 0x2423}, {"circumflex", '^'}, {"tilde", '~'},
+};
+
+static uint32_t glyph_to_unicode(const char *name, size_t len) {
+    const char *dot = memchr(name, '.', len);   // "a.sc", "one.oldstyle"
+    if (dot && dot > name) len = (size_t)(dot - name);
+    if (len == 1) return (unsigned char)name[0];
+    if ((len == 7 && memcmp(name, "uni", 3) == 0) || ((len == 5 || len == 6 || len == 7) && name[0] == 'u' && name[1] != 'n')) {
+        uint32_t cp = 0;
+        for (size_t i = name[1] == 'n' ? 3 : 1; i < len; i++) {
+            int v = hex_value((unsigned char)name[i]);
+            if (v < 0) return 0;
+            cp = cp << 4 | (uint32_t)v;
+        }
+        return cp;
+    }
+    for (size_t i = 0; i < sizeof(GLYPHS) / sizeof(GLYPHS[0]); i++) {
+        if (strlen(GLYPHS[i].name) == len && memcmp(GLYPHS[i].name, name, len) == 0) return GLYPHS[i].cp;
+    }
+    return 0;
+}
+
+// === Шрифты ===
+
+typedef struct {
+    uint32_t lo, hi;
+    uint32_t dst;              // начало UTF-16 в pool
+    uint16_t dst_len;
+} CMapRange;
+
+typedef struct {
+    uint32_t lo, hi;
+    float width;
+} WidthRange;
+
+struct PdfFont {
+    int code_bytes;            // 1 — простой шрифт, 2 — Type0
+    uint32_t simple[256];      // код → Unicode без ToUnicode (0 — неизвестно)
+    float widths[256];         // ширины в 1/1000 кегля (простые шрифты)
+    float default_width;
+    CMapRange *ranges;         // ToUnicode, по возрастанию lo
+    size_t n_ranges, ranges_cap;
+    uint16_t *pool;
+    size_t pool_len, pool_cap;
+    WidthRange *wranges;       // /W шрифтов Type0
+    size_t n_wranges, wranges_cap;
+};
+
+static int font_add_range(PdfFont *f, uint32_t lo, uint32_t hi, const unsigned char *dst, size_t dst_bytes) {
+    size_t units = dst_bytes / 2;
+    if (units == 0 || units > 16 || hi < lo) return 0;
+    if (f->n_ranges == f->ranges_cap) {
+        size_t cap = f->ranges_cap ? f->ranges_cap * 2 : 64;
+        CMapRange *r = realloc(f->ranges, cap * sizeof(*r));
+        if (!r) return -1;
+        f->ranges = r;
+        f->ranges_cap = cap;
+    }
+    if (f->pool_len + units > f->pool_cap) {
+        size_t cap = f->pool_cap ? f->pool_cap * 2 : 256;
+        while (cap < f->pool_len + units) cap *= 2;
+        uint16_t *p = realloc(f->pool, cap * sizeof(*p));
+        if (!p) return -1;
+        f->pool = p;
+        f->pool_cap = cap;
+    }
+    CMapRange *r = &f->ranges[f->n_ranges++];
+    r->lo = lo;
+    r->hi = hi;
+    r->dst = (uint32_t)f->pool_len;
+    r->dst_len = (uint16_t)units;
+    for (size_t i = 0; i < units; i++) f->pool[f->pool_len++] = (uint16_t)(dst[2 * i] << 8 | dst[2 * i + 1]);
+    return 0;
+}
+
+static uint32_t code_of(const PdfObj *s) {
+    uint32_t v = 0;
+    for (size_t i = 0; i < s->len && i < 4; i++) v = v << 8 | (unsigned char)s->s[i];
+    return v;
+}
+
+static int cmp_range(const void *a, const void *b) {
+    uint32_t x = ((const CMapRange *)a)->lo, y = ((const CMapRange *)b)->lo;
+    return x < y ? -1 : x > y;
+}
+
+// bfchar / bfrange из CMap-потока ToUnicode
+static void parse_cmap(PdfFont *f, const char *data, size_t len) {
+    Arena a = {0};
+    Lexer lx = { data, data + len };
+    PdfObj *o;
+    int mode = 0;               // 1 — codespacerange, 2 — bfchar, 3 — bfrange
+    PdfObj *args[3];
+    int n_args = 0, max_code_len = 0;
+    while ((o = parse_obj(&lx, &a, 0)) || lx.p < lx.end) {
+        if (!o) { lx.p++; continue; }
+        if (o->type == PDF_KEYWORD) {
+            if (keyword_is(o, "begincodespacerange")) mode = 1;
+            else if (keyword_is(o, "beginbfchar")) mode = 2;
+            else if (keyword_is(o, "beginbfrange")) mode = 3;
+            else if (o->len > 3 && memcmp(o->s, "end", 3) == 0) mode = 0;
+            n_args = 0;
+            continue;
+        }
+        if (mode == 0) continue;
+        args[n_args++] = o;
+        int need = mode == 3 ? 3 : 2;
+        if (n_args < need) continue;
+        n_args = 0;
+        if (args[0]->type != PDF_STRING || args[1]->type != PDF_STRING) continue;
+        if (mode == 1) {
+            if ((int)args[0]->len > max_code_len) max_code_len = (int)args[0]->len;
+        } else if (mode == 2) {
+            uint32_t c = code_of(args[0]);
+            font_add_range(f, c, c, (const unsigned char *)args[1]->s, args[1]->len);
+        } else {
+            uint32_t lo = code_of(args[0]), hi = code_of(args[1]);
+            if (hi - lo > 0xFFFF) continue;
+            if (args[2]->type == PDF_STRING) {
+                font_add_range(f, lo, hi, (const unsigned char *)args[2]->s, args[2]->len);
+            } else if (args[2]->type == PDF_ARRAY) {
+                for (size_t i = 0; i < args[2]->n && lo + i <= hi; i++) {
+                    PdfObj *dst = args[2]->items[i];
+                    if (dst->type == PDF_STRING)
+                        font_add_range(f, lo + (uint32_t)i, lo + (uint32_t)i, (const unsigned char *)dst->s, dst->len);
+                }
+            }
+        }
+        arena_reset(&a);
+    }
+    arena_free(&a);
+    if (f->code_bytes == 2 && max_code_len == 1) f->code_bytes = 1;
+    if (f->n_ranges) qsort(f->ranges, f->n_ranges, sizeof(*f->ranges), cmp_range);
+}
+
+static void load_widths(PdfDoc *d, PdfFont *f, PdfObj *font) {
+    double first = 0, w;
+    PdfObj *widths = resolve(d, dict_get(font, "Widths"));
+    as_number(d, dict_get(font, "FirstChar"), &first);
+    PdfObj *desc = resolve(d, dict_get(font, "FontDescriptor"));
+    f->default_width = as_number(d, dict_get(desc, "MissingWidth"), &w) == 0 && w > 0 ? (float)w : 500;
+    for (int c = 0; c < 256; c++) f->widths[c] = f->default_width;
+    if (widths && widths->type == PDF_ARRAY) {
+        for (size_t i = 0; i < widths->n; i++) {
+            double code = first + (double)i;
+            if (code >= 0 && code < 256 && as_number(d, widths->items[i], &w) == 0) f->widths[(int)code] = (float)w;
+        }
+    }
+}
+
+static int add_wrange(PdfFont *f, uint32_t lo, uint32_t hi, double w) {
+    if (f->n_wranges == f->wranges_cap) {
+        size_t cap = f->wranges_cap ? f->wranges_cap * 2 : 64;
+        WidthRange *r = realloc(f->wranges, cap * sizeof(*r));
+        if (!r) return -1;
+        f->wranges = r;
+        f->wranges_cap = cap;
+    }
+    f->wranges[f->n_wranges++] = (WidthRange){ lo, hi, (float)w };
+    return 0;
+}
+
+// /W потомка Type0: [c [w1 w2 ...]] и [c_first c_last w]
+static void load_cid_widths(PdfDoc *d, PdfFont *f, PdfObj *font) {
+    PdfObj *desc = resolve(d, dict_get(font, "DescendantFonts"));
+    if (desc && desc->type == PDF_ARRAY && desc->n) desc = resolve(d, desc->items[0]);
+    double dw = 1000;
+    as_number(d, dict_get(desc, "DW"), &dw);
+    f->default_width = (float)dw;
+    PdfObj *w = resolve(d, dict_get(desc, "W"));
+    if (!w || w->type != PDF_ARRAY) return;
+    for (size_t i = 0; i < w->n;) {
+        double c1, c2, v;
+        if (as_number(d, w->items[i], &c1) != 0 || c1 < 0) break;
+        PdfObj *next = i + 1 < w->n ? resolve(d, w->items[i + 1]) : NULL;
+        if (next && next->type == PDF_ARRAY) {
+            for (size_t k = 0; k < next->n; k++) {
+                if (as_number(d, next->items[k], &v) == 0) add_wrange(f, (uint32_t)c1 + (uint32_t)k, (uint32_t)c1 + (uint32_t)k, v);
+            }
+            i += 2;
+        } else if (i + 2 < w->n && as_number(d, w->items[i + 1], &c2) == 0 && as_number(d, w->items[i + 2], &v) == 0) {
+            if (c2 >= c1) add_wrange(f, (uint32_t)c1, (uint32_t)c2, v);
+            i += 3;
+        } else {
+            break;
+        }
+    }
+}
+
+static void set_base_encoding(PdfFont *f, const PdfObj *name) {
+    for (int c = 0; c < 256; c++) {
+        f->simple[c] = c < 0x20 ? 0 : (c >= 0x80 && c < 0xA0) ? CP1252_HIGH[c - 0x80] : (uint32_t)c;
+    }
+    // StandardEncoding отличается от ASCII кавычками
+    if (!name_is(name, "WinAnsiEncoding") && !name_is(name, "MacRomanEncoding")) {
+        f->simple['\''] = 0x2019;
+        f->simple['`'] = 0x2018;
+    }
+}
+
+static PdfFont *load_font(PdfDoc *d, PdfObj *font) {
+    font = resolve(d, font);
+    if (!font || font->type != PDF_DICT) return NULL;
+    if (font->font) return font->font;
+    PdfFont *f = calloc(1, sizeof(*f));
+    if (!f) return NULL;
+    if (d->n_fonts == d->fonts_cap) {
+        size_t cap = d->fonts_cap ? d->fonts_cap * 2 : 16;
+        PdfFont **p = realloc(d->fonts, cap * sizeof(*p));
+        if (!p) { free(f); return NULL; }
+        d->fonts = p;
+        d->fonts_cap = cap;
+    }
+    d->fonts[d->n_fonts++] = f;
+    font->font = f;
+
+    int type0 = name_is(resolve(d, dict_get(font, "Subtype")), "Type0");
+    f->code_bytes = type0 ? 2 : 1;
+    PdfObj *enc = resolve(d, dict_get(font, "Encoding"));
+    set_base_encoding(f, enc && enc->type == PDF_DICT ? resolve(d, dict_get(enc, "BaseEncoding")) : enc);
+    PdfObj *diff = enc && enc->type == PDF_DICT ? resolve(d, dict_get(enc, "Differences")) : NULL;
+    if (diff && diff->type == PDF_ARRAY) {
+        double code = 0;
+        for (size_t i = 0; i < diff->n; i++) {
+            PdfObj *it = diff->items[i];
+            if (it->type == PDF_NUM) code = it->num;
+            else if (it->type == PDF_NAME && code >= 0 && code < 256) {
+                uint32_t cp = glyph_to_unicode(it->s, it->len);
+                if (cp) f->simple[(int)code] = cp;
+                code++;
+            }
+        }
+    }
+    if (type0) load_cid_widths(d, f, font);
+    else load_widths(d, f, font);
+
+    PdfObj *tu = resolve(d, dict_get(font, "ToUnicode"));
+    if (tu && tu->stream) {
+        StreamRef sr;
+        StrBuf out = {0}, tmp = {0};
+        stream_ref(d, tu, &sr);
+        if (decode_stream(&sr, &out, &tmp) == 0) parse_cmap(f, out.data, out.len);
+        strbuf_free(&out);
+        strbuf_free(&tmp);
+    }
+    return f;
+}
+
+static void font_free(PdfFont *f) {
+    free(f->ranges);
+    free(f->pool);
+    free(f->wranges);
+    free(f);
+}
+
+// Unicode кода: ToUnicode, затем кодировка простого шрифта
+static int font_put(const PdfFont *f, uint32_t code, StrBuf *out) {
+    size_t lo = 0, hi = f->n_ranges;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (f->ranges[mid].lo <= code) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo > 0 && code <= f->ranges[lo - 1].hi) {
+        const CMapRange *r = &f->ranges[lo - 1];
+        uint16_t units[16];
+        memcpy(units, f->pool + r->dst, r->dst_len * sizeof(uint16_t));
+        units[r->dst_len - 1] = (uint16_t)(units[r->dst_len - 1] + (code - r->lo));
+        for (size_t i = 0; i < r->dst_len; i++) {
+            uint32_t cp = units[i];
+            if (cp >= 0xD800 && cp < 0xDC00 && i + 1 < r->dst_len && units[i + 1] >= 0xDC00 && units[i + 1] < 0xE000) {
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (units[++i] - 0xDC00);
+            }
+            if (put_char(out, cp) != 0) return -1;
+        }
+        return 0;
+    }
+    if (f->code_bytes == 1 && f->simple[code & 0xFF]) return put_char(out, f->simple[code & 0xFF]);
+    return 0;
+}
+
+static float font_width(const PdfFont *f, uint32_t code) {
+    if (f->code_bytes == 1) return f->widths[code & 0xFF];
+    for (size_t i = 0; i < f->n_wranges; i++) {
+        if (code >= f->wranges[i].lo && code <= f->wranges[i].hi) return f->wranges[i].width;
+    }
+    return f->default_width;
+}
+
+// === Страницы ===
+
+typedef struct {
+    const char *name;
+    size_t len;
+    PdfFont *font;
+} FontRef;
+
+typedef struct {
+    StreamRef *streams;
+    size_t n_streams;
+    FontRef *fonts;
+    size_t n_fonts;
+} PageJob;
+
+typedef struct {
+    PageJob *items;
+    size_t n, cap;
+} PageList;
+
+static int add_page(PdfDoc *d, PageList *pl, PdfObj *page, PdfObj *resources) {
+    if (pl->n == pl->cap) {
+        size_t cap = pl->cap ? pl->cap * 2 : 64;
+        PageJob *p = realloc(pl->items, cap * sizeof(*p));
+        if (!p) return -1;
+        pl->items = p;
+        pl->cap = cap;
+    }
+    PageJob *job = &pl->items[pl->n++];
+    memset(job, 0, sizeof(*job));
+
+    PdfObj *contents = resolve(d, dict_get(page, "Contents"));
+    size_t count = contents && contents->type == PDF_ARRAY ? contents->n : (contents ? 1 : 0);
+    job->streams = arena_alloc(&d->arena, (count ? count : 1) * sizeof(*job->streams));
+    if (!job->streams) return -1;
+    for (size_t i = 0; i < count; i++) {
+        PdfObj *s = contents->type == PDF_ARRAY ? resolve(d, contents->items[i]) : contents;
+        if (s && s->stream) stream_ref(d, s, &job->streams[job->n_streams++]);
+    }
+
+    PdfObj *fonts = resolve(d, dict_get(resources, "Font"));
+    if (fonts && fonts->type == PDF_DICT && fonts->n) {
+        job->fonts = arena_alloc(&d->arena, fonts->n / 2 * sizeof(*job->fonts));
+        if (!job->fonts) return -1;
+        for (size_t i = 0; i + 1 < fonts->n; i += 2) {
+            PdfFont *f = load_font(d, fonts->items[i + 1]);
+            if (!f) continue;
+            job->fonts[job->n_fonts++] = (FontRef){ fonts->items[i]->s, fonts->items[i]->len, f };
+        }
+    }
+    return 0;
+}
+
+static int collect_pages(PdfDoc *d, PdfObj *node, PdfObj *resources, int depth, PageList *pl) {
+    node = resolve(d, node);
+    if (!node || node->type != PDF_DICT || node->mark || depth > PDF_MAX_DEPTH) return 0;
+    if (pl->n >= PDF_MAX_PAGES) return 0;
+    node->mark = 1;
+    PdfObj *res = resolve(d, dict_get(node, "Resources"));
+    if (res && res->type == PDF_DICT) resources = res;
+    PdfObj *kids = resolve(d, dict_get(node, "Kids"));
+    if (kids && kids->type == PDF_ARRAY) {
+        for (size_t i = 0; i < kids->n; i++) {
+            if (collect_pages(d, kids->items[i], resources, depth + 1, pl) != 0) return -1;
+        }
+        return 0;
+    }
+    if (name_is(dict_get(node, "Type"), "Page") || dict_get(node, "Contents")) {
+        return add_page(d, pl, node, resources);
+    }
+    return 0;
+}
+
+// === Исполнение текстовых операторов ===
+
+typedef struct {
+    const PageJob *page;
+    StrBuf *out;
+    const PdfFont *font;
+    double fs, tc, tw, th, tl;
+    double tm[6], tlm[6];
+    double ctm[6];
+    double gstack[PDF_GSTATE_DEPTH][6];
+    int gdepth;
+    double end_x, end_y;       // где кончился последний показанный текст (устройство)
+    int have_end;
+    int pending;               // 0 — ничего, 1 — пробел, 2 — строка, 3 — абзац
+} TextState;
+
+static void mat_set(double *m, double a, double b, double c, double d, double e, double f) {
+    m[0] = a; m[1] = b; m[2] = c; m[3] = d; m[4] = e; m[5] = f;
+}
+
+// r = m × n (строчная запись PDF)
+static void mat_mul(double *r, const double *m, const double *n) {
+    double t[6] = {
+        m[0] * n[0] + m[1] * n[2], m[0] * n[1] + m[1] * n[3],
+        m[2] * n[0] + m[3] * n[2], m[2] * n[1] + m[3] * n[3],
+        m[4] * n[0] + m[5] * n[2] + n[4], m[4] * n[1] + m[5] * n[3] + n[5],
+    };
+    memcpy(r, t, sizeof(t));
+}
+
+static void text_move(TextState *ts, double tx, double ty) {
+    double t[6];
+    mat_set(t, 1, 0, 0, 1, tx, ty);
+    mat_mul(ts->tlm, t, ts->tlm);
+    memcpy(ts->tm, ts->tlm, sizeof(ts->tm));
+}
+
+static void device_pos(const TextState *ts, double *x, double *y) {
+    double trm[6];
+    mat_mul(trm, ts->tm, ts->ctm);
+    *x = trm[4];
+    *y = trm[5];
+}
+
+static double device_size(const TextState *ts) {
+    double trm[6];
+    mat_mul(trm, ts->tm, ts->ctm);
+    double s = ts->fs * hypot(trm[2], trm[3]);
+    return s > 0.01 ? s : 10;
+}
+
+static int flush_break(TextState *ts) {
+    StrBuf *b = ts->out;
+    int kind = ts->pending;
+    ts->pending = 0;
+    if (kind == 0 || b->len == 0) return 0;
+    char last = b->data[b->len - 1];
+    if (kind == 1) return last == ' ' || last == '\n' ? 0 : strbuf_append(b, " ", 1);
+    // Перенос по дефису: дефис убирается, слово склеивается
+    if (kind == 2 && last == '-' && b->len > 1 &&
+        ((b->data[b->len - 2] | 0x20) >= 'a' && (b->data[b->len - 2] | 0x20) <= 'z')) {
+        b->len--;
+        return 0;
+    }
+    while (b->len > 0 && b->data[b->len - 1] == ' ') b->len--;
+    if (kind == 2) return strbuf_append(b, "\n", 1);
+    if (b->len >= 2 && b->data[b->len - 1] == '\n' && b->data[b->len - 2] == '\n') return 0;
+    return strbuf_append_str(b, b->len && b->data[b->len - 1] == '\n' ? "\n" : "\n\n");
+}
+
+static int show_string(TextState *ts, const PdfObj *s) {
+    double x, y, size = device_size(ts);
+    device_pos(ts, &x, &y);
+    if (ts->have_end) {
+        double dy = fabs(y - ts->end_y), gap = x - ts->end_x;
+        int kind = dy > PDF_PARAGRAPH_GAP * size ? 3
+                 : dy > PDF_LINE_GAP * size ? 2
+                 : (gap > PDF_WORD_GAP * size || gap < -size) ? 1 : 0;
+        if (kind > ts->pending) ts->pending = kind;
+    }
+
+    const PdfFont *f = ts->font;
+    int bytes = f ? f->code_bytes : 1;
+    const unsigned char *p = (const unsigned char *)s->s;
+    size_t n = s->len;
+    int emitted = 0;
+    for (size_t i = 0; i + (size_t)bytes <= n; i += (size_t)bytes) {
+        uint32_t code = bytes == 2 ? (uint32_t)(p[i] << 8 | p[i + 1]) : p[i];
+        if (!emitted) {
+            if (flush_break(ts) != 0) return -1;
+            emitted = 1;
+        }
+        if (f) {
+            if (font_put(f, code, ts->out) != 0) return -1;
+        } else if (put_char(ts->out, code >= 0x80 && code < 0xA0 ? CP1252_HIGH[code - 0x80] : code) != 0) {
+            return -1;
+        }
+        double w = f ? font_width(f, code) : 500;
+        double adv = (w / 1000.0 * ts->fs + ts->tc + (bytes == 1 && code == 32 ? ts->tw : 0)) * ts->th;
+        ts->tm[4] += adv * ts->tm[0];
+        ts->tm[5] += adv * ts->tm[1];
+    }
+    device_pos(ts, &ts->end_x, &ts->end_y);
+    ts->have_end = 1;
+    return 0;
+}
+
+static const PdfFont *find_font(const PageJob *page, const PdfObj *name) {
+    if (!name || name->type != PDF_NAME) return NULL;
+    for (size_t i = 0; i < page->n_fonts; i++) {
+        if (page->fonts[i].len == name->len && memcmp(page->fonts[i].name, name->s, name->len) == 0)
+            return page->fonts[i].font;
+    }
+    return NULL;
+}
+
+static double num_arg(PdfObj **args, int n, int i) {
+    return i >= 0 && i < n && args[i]->type == PDF_NUM ? args[i]->num : 0;
+}
+
+#define PDF_MAX_OPERANDS 16
+
+static int run_content(TextState *ts, const char *data, size_t len, Arena *a) {
+    Lexer lx = { data, data + len };
+    PdfObj *args[PDF_MAX_OPERANDS];
+    int n = 0;
+    while (lx.p < lx.end) {
+        PdfObj *o = parse_obj(&lx, a, 0);
+        if (!o) {
+            // Непарный разделитель — пропускаем байт
+            if (lx.p < lx.end) lx.p++;
+            continue;
+        }
+        if (o->type != PDF_KEYWORD) {
+            if (n == PDF_MAX_OPERANDS) {
+                memmove(args, args + 1, (PDF_MAX_OPERANDS - 1) * sizeof(*args));
+                n--;
+            }
+            args[n++] = o;
+            continue;
+        }
+        const char *op = o->s;
+        size_t ol = o->len;
+#define OP(s) (ol == sizeof(s) - 1 && memcmp(op, s, ol) == 0)
+        int rc = 0;
+        if (OP("BT")) {
+            mat_set(ts->tm, 1, 0, 0, 1, 0, 0);
+            mat_set(ts->tlm, 1, 0, 0, 1, 0, 0);
+        } else if (OP("Tf")) {
+            if (n >= 2) {
+                ts->font = find_font(ts->page, args[n - 2]);
+                ts->fs = num_arg(args, n, n - 1);
+            }
+        } else if (OP("Td")) {
+            text_move(ts, num_arg(args, n, n - 2), num_arg(args, n, n - 1));
+        } else if (OP("TD")) {
+            ts->tl = -num_arg(args, n, n - 1);
+            text_move(ts, num_arg(args, n, n - 2), num_arg(args, n, n - 1));
+        } else if (OP("Tm")) {
+            if (n >= 6) {
+                mat_set(ts->tm, num_arg(args, n, n - 6), num_arg(args, n, n - 5), num_arg(args, n, n - 4),
+                        num_arg(args, n, n - 3), num_arg(args, n, n - 2), num_arg(args, n, n - 1));
+                memcpy(ts->tlm, ts->tm, sizeof(ts->tm));
+            }
+        } else if (OP("T*")) {
+            text_move(ts, 0, -ts->tl);
+        } else if (OP("TL")) {
+            ts->tl = num_arg(args, n, n - 1);
+        } else if (OP("Tc")) {
+            ts->tc = num_arg(args, n, n - 1);
+        } else if (OP("Tw")) {
+            ts->tw = num_arg(args, n, n - 1);
+        } else if (OP("Tz")) {
+            ts->th = num_arg(args, n, n - 1) / 100.0;
+        } else if (OP("Tj")) {
+            if (n >= 1 && args[n - 1]->type == PDF_STRING) rc = show_string(ts, args[n - 1]);
+        } else if (OP("'")) {
+            text_move(ts, 0, -ts->tl);
+            if (n >= 1 && args[n - 1]->type == PDF_STRING) rc = show_string(ts, args[n - 1]);
+        } else if (OP("\"")) {
+            if (n >= 3) {
+                ts->tw = num_arg(args, n, n - 3);
+                ts->tc = num_arg(args, n, n - 2);
+            }
+            text_move(ts, 0, -ts->tl);
+            if (n >= 1 && args[n - 1]->type == PDF_STRING) rc = show_string(ts, args[n - 1]);
+        } else if (OP("TJ")) {
+            PdfObj *arr = n >= 1 ? args[n - 1] : NULL;
+            for (size_t i = 0; arr && arr->type == PDF_ARRAY && i < arr->n && rc == 0; i++) {
+                PdfObj *it = arr->items[i];
+                if (it->type == PDF_STRING) {
+                    rc = show_string(ts, it);
+                } else if (it->type == PDF_NUM) {
+                    double adv = -it->num / 1000.0 * ts->fs * ts->th;
+                    ts->tm[4] += adv * ts->tm[0];
+                    ts->tm[5] += adv * ts->tm[1];
+                }
+            }
+        } else if (OP("q")) {
+            if (ts->gdepth < PDF_GSTATE_DEPTH) memcpy(ts->gstack[ts->gdepth], ts->ctm, sizeof(ts->ctm));
+            ts->gdepth++;
+        } else if (OP("Q")) {
+            if (ts->gdepth > 0 && --ts->gdepth < PDF_GSTATE_DEPTH) memcpy(ts->ctm, ts->gstack[ts->gdepth], sizeof(ts->ctm));
+        } else if (OP("cm")) {
+            if (n >= 6) {
+                double m[6];
+                mat_set(m, num_arg(args, n, n - 6), num_arg(args, n, n - 5), num_arg(args, n, n - 4),
+                        num_arg(args, n, n - 3), num_arg(args, n, n - 2), num_arg(args, n, n - 1));
+                mat_mul(ts->ctm, m, ts->ctm);
+            }
+        } else if (OP("ID")) {
+            // Встроенное изображение: двоичные данные до "EI"
+            const char *p = lx.p;
+            while (p + 2 <= lx.end) {
+                const char *e = memmem(p, (size_t)(lx.end - p), "EI", 2);
+                if (!e) { p = lx.end; break; }
+                if (is_ws((unsigned char)e[-1]) && (e + 2 == lx.end || is_ws((unsigned char)e[2]))) { p = e + 2; break; }
+                p = e + 2;
+            }
+            lx.p = p;
+        }
+#undef OP
+        if (rc != 0) return -1;
+        n = 0;
+        arena_reset(a);
+    }
+    return 0;
+}
+
+typedef struct {
+    const PageList *pages;
+    StrBuf *texts;
+    size_t next;               // атомарный счётчик страниц
+    size_t failed;
+} PdfShared;
+
+static void *page_worker(void *arg) {
+    PdfShared *sh = arg;
+    StrBuf content = {0}, tmp = {0};
+    Arena a = {0};
+    for (;;) {
+        size_t i = __atomic_fetch_add(&sh->next, 1, __ATOMIC_RELAXED);
+        if (i >= sh->pages->n) break;
+        const PageJob *page = &sh->pages->items[i];
+        TextState ts;
+        memset(&ts, 0, sizeof(ts));
+        ts.page = page;
+        ts.out = &sh->texts[i];
+        ts.th = 1;
+        mat_set(ts.ctm, 1, 0, 0, 1, 0, 0);
+        mat_set(ts.tm, 1, 0, 0, 1, 0, 0);
+        mat_set(ts.tlm, 1, 0, 0, 1, 0, 0);
+        int ok = page->n_streams > 0;
+        // Потоки одной страницы — одна программа, разрезанная где угодно
+        StrBuf all = {0};
+        for (size_t k = 0; k < page->n_streams && ok; k++) {
+            ok = decode_stream(&page->streams[k], &content, &tmp) == 0 &&
+                 strbuf_append(&all, content.data, content.len) == 0 &&
+                 strbuf_append(&all, "\n", 1) == 0;
+        }
+        if (ok) ok = run_content(&ts, all.data, all.len, &a) == 0;
+        strbuf_free(&all);
+        if (!ok && page->n_streams > 0) __atomic_fetch_add(&sh->failed, 1, __ATOMIC_RELAXED);
+    }
+    strbuf_free(&content);
+    strbuf_free(&tmp);
+    arena_free(&a);
+    return NULL;
+}
+
+// /Title: UTF-16BE с BOM или PDFDocEncoding (≈ Latin-1)
+static char *decode_title(const PdfObj *s) {
+    if (!s || s->type != PDF_STRING || s->len == 0) return NULL;
+    StrBuf b = {0};
+    const unsigned char *p = (const unsigned char *)s->s;
+    if (s->len >= 2 && p[0] == 0xFE && p[1] == 0xFF) {
+        for (size_t i = 2; i + 1 < s->len; i += 2) {
+            uint32_t cp = (uint32_t)(p[i] << 8 | p[i + 1]);
+            if (cp >= 0xD800 && cp < 0xDC00 && i + 3 < s->len) {
+                uint32_t lo = (uint32_t)(p[i + 2] << 8 | p[i + 3]);
+                if (lo >= 0xDC00 && lo < 0xE000) { cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00); i += 2; }
+            }
+            put_char(&b, cp);
+        }
+    } else {
+        for (size_t i = 0; i < s->len; i++) put_char(&b, p[i]);
+    }
+    if (b.len == 0 || strbuf_append(&b, "", 1) != 0) {
+        strbuf_free(&b);
+        return NULL;
+    }
+    return b.data;
+}
+
+int pdf_sniff(const char *data, size_t size) {
+    // Заголовок обязан быть в первом килобайте
+    size_t n = size < 1024 ? size : 1024;
+    return n >= 5 && memmem(data, n, "%PDF-", 5) != NULL;
+}
+
+char *pdf_extract_text(const char *data, size_t size, int jobs, char **title, PdfStats *stats) {
+    PdfStats local;
+    if (!stats) stats = &local;
+    memset(stats, 0, sizeof(*stats));
+    if (title) *title = NULL;
+    if (!pdf_sniff(data, size)) return NULL;
+
+    PdfDoc d;
+    memset(&d, 0, sizeof(d));
+    d.data = data;
+    d.size = size;
+    PageList pl = {0};
+    StrBuf *texts = NULL;
+    char *result = NULL;
+
+    stats->objects = scan_objects(&d);
+    expand_object_streams(&d);
+    PdfObj *root = find_root(&d);
+    // Зашифрованные потоки без ключа не прочитать
+    if (!root || (d.trailer && dict_get(d.trailer, "Encrypt"))) goto out;
+    if (collect_pages(&d, dict_get(root, "Pages"), NULL, 0, &pl) != 0 || pl.n == 0) goto out;
+    if (title && d.trailer) *title = decode_title(resolve(&d, dict_get(resolve(&d, dict_get(d.trailer, "Info")), "Title")));
+
+    texts = calloc(pl.n, sizeof(*texts));
+    if (!texts) goto out;
+    PdfShared sh = { .pages = &pl, .texts = texts };
+    if (jobs <= 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        jobs = n > 0 ? (int)n : 1;
+    }
+    if ((size_t)jobs > pl.n) jobs = (int)pl.n;
+    pthread_t *threads = calloc((size_t)jobs, sizeof(pthread_t));
+    int started = 0;
+    if (threads) {
+        for (; started < jobs; started++) {
+            if (pthread_create(&threads[started], NULL, page_worker, &sh) != 0) break;
+        }
+    }
+    if (started == 0) page_worker(&sh);
+    for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+    free(threads);
+
+    StrBuf all = {0};
+    int rc = 0;
+    for (size_t i = 0; i < pl.n; i++) {
+        if (texts[i].len == 0) continue;
+        if (all.len) rc |= strbuf_append(&all, "\n\n", 2);
+        rc |= strbuf_append(&all, texts[i].data, texts[i].len);
+    }
+    rc |= strbuf_append(&all, "", 1);
+    if (rc == 0) {
+        result = all.data;
+        stats->bytes = all.len - 1;
+    } else {
+        strbuf_free(&all);
+    }
+    stats->pages = pl.n;
+    stats->pages_failed = sh.failed;
+
+out:
+    for (size_t i = 0; texts && i < pl.n; i++) strbuf_free(&texts[i]);
+    free(texts);
+    free(pl.items);
+    for (size_t i = 0; i < d.n_fonts; i++) font_free(d.fonts[i]);
+    free(d.fonts);
+    free(d.x);
+    arena_free(&d.arena);
+    if (!result && title) { free(*title); *title = NULL; }
+    return result;
+}
@@ -0,0 +1,33 @@
+// pdf.h — извлечение текста из PDF без внешних библиотек
+//
+// Объекты находятся сканированием тела файла (xref не нужен и может быть
+// битым), объектные потоки (PDF 1.5) раскрываются. Дерево страниц, шрифты
+// и их ToUnicode/Encoding разбираются один раз, затем страницы
+// обрабатываются пулом потоков: каждый распаковывает (zlib) свой поток
+// содержимого и исполняет текстовые операторы (Tj, TJ, ', ", Td, Tm, T*).
+// Строки разделяются по смещению базовой линии, абзацы — по увеличенному
+// интервалу, слова — по сдвигам Td/TJ. Формы XObject и изображения
+// пропускаются.
+
+#ifndef PDF_H
+#define PDF_H
+
+#include <stddef.h>
+
+#define PDF_MAX_PAGES 100000
+
+typedef struct {
+    size_t objects;
+    size_t pages;
+    size_t pages_failed;       // нераспознанный фильтр или битый поток
+    size_t bytes;              // длина текста
+} PdfStats;
+
+int pdf_sniff(const char *data, size_t size);
+
+// Текст страниц по порядку, между страницами — пустая строка. jobs: 0 —
+// по числу CPU. *title — /Title из /Info (malloc, UTF-8) или NULL.
+// malloc-строка или NULL, если документ не разобран
+char *pdf_extract_text(const char *data, size_t size, int jobs, char **title, PdfStats *stats);
+
+#endif // PDF_H
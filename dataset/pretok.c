@@ -0,0 +1,378 @@
+// pretok.c — предтокенизация JSONL-датасета в бинарный формат tokfile.h
+// gcc -O2 -o pretok_dataset pretok.c tokfile.c chunker.c json_escape.c -L../llama.cpp/build/bin -lllama -pthread
+// ./pretok_dataset --model model.gguf [--max-tokens N] [--jobs N] input.jsonl [output.tok]
+// ./pretok_dataset --stats output.tok [--seq N] [--split]
+// Вход — записи {"messages":[...],"metadata":{"source","category"}} (dataset.c,
+// merge_dataset). Диалог раскладывается по шаблону Llama 3, как промпт в bot.c:
+//   <|begin_of_text|> (<|start_header_id|>роль<|end_header_id|>\n\nтекст<|eot_id|>)...
+// Разметка шаблона токенизируется со спецтокенами, тексты реплик — без них
+// (текст пользователя не может подделать <|eot_id|>), поэтому границы ролей
+// и loss-маска точные. --max-tokens обрезает запись; записи без токенов
+// ассистента пропускаются. --stats проверяет файл и считает заполнение
+// последовательностей длины --seq при упаковке.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "chunker.h"
+#include "json_escape.h"
+#include "tokfile.h"
+
+#define PRETOK_BLOCK 1024          // записей между фиксациями в файл (порядок сохраняется)
+
+typedef struct {
+    TokenBuf tokens;
+    uint8_t *masks;
+    size_t masks_cap;
+    StrBuf source;
+    StrBuf category;
+    int ok;
+} PretokSlot;
+
+typedef struct {
+    const Chunker *chunker;
+    const char *data;
+    size_t *lines;
+    size_t block_start, block_end;
+    size_t next;               // атомарный счётчик строк блока
+    PretokSlot *slots;
+    TokenBuf start_header, end_header, eot;
+    llama_token bos;
+    size_t max_tokens;
+} PretokShared;
+
+typedef struct {
+    StrBuf text;
+    TokenBuf piece;
+} PretokScratch;
+
+static int role_id(const char *role, size_t len) {
+    if (len == 6 && memcmp(role, "system", 6) == 0) return TOK_ROLE_SYSTEM;
+    if (len == 4 && memcmp(role, "user", 4) == 0) return TOK_ROLE_USER;
+    if (len == 9 && memcmp(role, "assistant", 9) == 0) return TOK_ROLE_ASSISTANT;
+    return TOK_ROLE_OTHER;
+}
+
+static int slot_push(PretokSlot *s, const llama_token *tokens, size_t n, uint8_t mask) {
+    size_t need = s->tokens.len + n;
+    if (need > s->tokens.cap) {
+        size_t cap = s->tokens.cap ? s->tokens.cap : 256;
+        while (cap < need) cap *= 2;
+        llama_token *t = realloc(s->tokens.data, cap * sizeof(*t));
+        if (!t) return -1;
+        s->tokens.data = t;
+        s->tokens.cap = cap;
+    }
+    if (need > s->masks_cap) {
+        uint8_t *m = realloc(s->masks, s->tokens.cap);
+        if (!m) return -1;
+        s->masks = m;
+        s->masks_cap = s->tokens.cap;
+    }
+    memcpy(s->tokens.data + s->tokens.len, tokens, n * sizeof(*tokens));
+    memset(s->masks + s->tokens.len, mask, n);
+    s->tokens.len = need;
+    return 0;
+}
+
+// Тело JSON-строки → токены без спецтокенов
+static int push_text(const PretokShared *sh, PretokScratch *sc, PretokSlot *s,
+                     const char *val, size_t len, uint8_t mask) {
+    strbuf_reset(&sc->text);
+    if (json_unescape_append(&sc->text, val, len) != 0) return -1;
+    if (chunker_tokenize(sh->chunker, sc->text.data, sc->text.len, &sc->piece) < 0) return -1;
+    return slot_push(s, sc->piece.data, sc->piece.len, mask);
+}
+
+typedef struct {
+    const PretokShared *sh;
+    PretokScratch *sc;
+    PretokSlot *s;
+} PretokRecord;
+
+// Реплика по шаблону; ключи role и content — в любом порядке (json_escape.h)
+static int push_message(void *ud, const char *role, size_t role_len, const char *content, size_t content_len) {
+    PretokRecord *rec = ud;
+    const PretokShared *sh = rec->sh;
+    PretokSlot *s = rec->s;
+    uint8_t r = (uint8_t)role_id(role, role_len);
+    uint8_t loss = r == TOK_ROLE_ASSISTANT ? TOK_LOSS : 0;
+    if (slot_push(s, sh->start_header.data, sh->start_header.len, r) != 0 ||
+        push_text(sh, rec->sc, s, role, role_len, r) != 0 ||
+        slot_push(s, sh->end_header.data, sh->end_header.len, r) != 0 ||
+        push_text(sh, rec->sc, s, content, content_len, r | loss) != 0 ||
+        slot_push(s, sh->eot.data, sh->eot.len, r | loss) != 0) return -1;
+    return 0;
+}
+
+static int tokenize_record(const PretokShared *sh, PretokScratch *sc, PretokSlot *s,
+                           const char *line, size_t len) {
+    const char *val;
+    size_t val_len;
+    int has_loss = 0;
+
+    s->tokens.len = 0;
+    strbuf_reset(&s->source);
+    strbuf_reset(&s->category);
+    if (slot_push(s, &sh->bos, 1, TOK_ROLE_SYSTEM) != 0) return -1;
+    PretokRecord rec = { sh, sc, s };
+    if (json_each_message(line, len, push_message, &rec) != 0) return -1;
+    if (sh->max_tokens && s->tokens.len > sh->max_tokens) s->tokens.len = sh->max_tokens;
+    for (size_t i = 0; i < s->tokens.len && !has_loss; i++) has_loss = (s->masks[i] & TOK_LOSS) != 0;
+    if (!has_loss) return -1;
+
+    if (json_find_string(line, len, "source", &val, &val_len) == 0 &&
+        json_unescape_append(&s->source, val, val_len) != 0) return -1;
+    if (json_find_string(line, len, "category", &val, &val_len) == 0 &&
+        json_unescape_append(&s->category, val, val_len) != 0) return -1;
+    if (strbuf_append(&s->source, "", 1) != 0 || strbuf_append(&s->category, "", 1) != 0) return -1;
+    return 0;
+}
+
+static void *worker(void *arg) {
+    PretokShared *sh = (PretokShared *)arg;
+    PretokScratch sc = {0};
+    for (;;) {
+        size_t i = __atomic_fetch_add(&sh->next, 1, __ATOMIC_RELAXED);
+        if (i >= sh->block_end) break;
+        PretokSlot *s = &sh->slots[i - sh->block_start];
+        s->ok = tokenize_record(sh, &sc, s, sh->data + sh->lines[i], sh->lines[i + 1] - sh->lines[i]) == 0;
+    }
+    strbuf_free(&sc.text);
+    free(sc.piece.data);
+    return NULL;
+}
+
+// Индекс начал непустых строк
+static size_t *index_lines(const char *data, size_t size, size_t *count) {
+    size_t cap = 1024, n = 0;
+    size_t *lines = malloc((cap + 1) * sizeof(*lines));
+    if (!lines) return NULL;
+    for (size_t pos = 0; pos < size;) {
+        const char *nl = memchr(data + pos, '\n', size - pos);
+        size_t end = nl ? (size_t)(nl - data) : size;
+        if (end > pos) {
+            if (n == cap) {
+                cap *= 2;
+                size_t *p = realloc(lines, (cap + 1) * sizeof(*lines));
+                if (!p) { free(lines); return NULL; }
+                lines = p;
+            }
+            lines[n++] = pos;
+        }
+        pos = end + 1;
+    }
+    lines[n] = size;
+    *count = n;
+    return lines;
+}
+
+// FNV-1a по текстам всех токенов: файл читается только с тем же словарём
+static uint64_t vocab_hash(const struct llama_vocab *vocab, int32_t n_vocab) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (llama_token t = 0; t < n_vocab; t++) {
+        const char *s = llama_vocab_get_text(vocab, t);
+        for (; s && *s; s++) h = (h ^ (unsigned char)*s) * 0x100000001b3ULL;
+        h = (h ^ 0xff) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+// Разметка шаблона со спецтокенами
+static int tokenize_special(const struct llama_vocab *vocab, const char *text, TokenBuf *out) {
+    int32_t n = llama_tokenize(vocab, text, (int32_t)strlen(text), NULL, 0, false, true);
+    if (n >= 0) return -1;
+    out->data = malloc((size_t)-n * sizeof(llama_token));
+    if (!out->data) return -1;
+    out->cap = (size_t)-n;
+    n = llama_tokenize(vocab, text, (int32_t)strlen(text), out->data, (int32_t)out->cap, false, true);
+    if (n <= 0) return -1;
+    out->len = (size_t)n;
+    return 0;
+}
+
+static int run_stats(const char *path, size_t seq_len, int split) {
+    TokFile tf;
+    if (tokfile_open(&tf, path) != 0) {
+        perror(path);
+        return 1;
+    }
+    uint64_t loss = 0, roles[4] = {0};
+    for (uint64_t i = 0; i < tf.hdr->n_tokens; i++) {
+        loss += (tf.masks[i] & TOK_LOSS) != 0;
+        roles[tf.masks[i] & TOK_ROLE_MASK]++;
+    }
+    printf("%s: %llu records, %llu tokens (loss %llu; system %llu, user %llu, assistant %llu, other %llu), "
+           "%u strings, vocab %u\n", path,
+           (unsigned long long)tf.hdr->n_records, (unsigned long long)tf.hdr->n_tokens,
+           (unsigned long long)loss, (unsigned long long)roles[TOK_ROLE_SYSTEM],
+           (unsigned long long)roles[TOK_ROLE_USER], (unsigned long long)roles[TOK_ROLE_ASSISTANT],
+           (unsigned long long)roles[TOK_ROLE_OTHER], tf.hdr->n_strings, tf.hdr->n_vocab);
+
+    TokSequence seq = {
+        .tokens = malloc(seq_len * sizeof(int32_t)),
+        .loss = malloc(seq_len),
+        .positions = malloc(seq_len * sizeof(int32_t)),
+        .segments = malloc(seq_len * sizeof(uint32_t)),
+    };
+    if (!seq.tokens || !seq.loss || !seq.positions || !seq.segments) {
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+    TokPacker pk;
+    tokpack_init(&pk, &tf, NULL, seq_len, 0, split);
+    uint64_t sequences = 0, real = 0;
+    size_t n;
+    while ((n = tokpack_next(&pk, &seq)) > 0) {
+        sequences++;
+        real += n;
+    }
+    printf("packing %zu%s: %llu sequences, fill %.1f%%\n", seq_len, split ? " (split)" : "",
+           (unsigned long long)sequences, sequences ? 100.0 * (double)real / ((double)sequences * (double)seq_len) : 0.0);
+    free(seq.tokens);
+    free(seq.loss);
+    free(seq.positions);
+    free(seq.segments);
+    tokfile_close(&tf);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    ChunkerConfig ccfg = { .overlap_tokens = 0 };
+    const char *input = NULL;
+    const char *output = "dataset.tok";
+    const char *stats = NULL;
+    size_t seq_len = 2048;
+    int split = 0;
+    size_t max_tokens = 0;
+    int jobs = 0;
+    int positional = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--model") == 0 && i + 1 < argc) ccfg.model_path = argv[++i];
+        else if (strcmp(argv[i], "--max-tokens") == 0 && i + 1 < argc) max_tokens = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) jobs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc) stats = argv[++i];
+        else if (strcmp(argv[i], "--seq") == 0 && i + 1 < argc) seq_len = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--split") == 0) split = 1;
+        else if (positional == 0) { input = argv[i]; positional++; }
+        else if (positional == 1) { output = argv[i]; positional++; }
+    }
+    if (stats) return run_stats(stats, seq_len ? seq_len : 2048, split);
+    if (!ccfg.model_path || !input) {
+        fprintf(stderr, "Usage: %s --model model.gguf [--max-tokens N] [--jobs N] input.jsonl [output.tok]\n"
+                        "       %s --stats file.tok [--seq N] [--split]\n", argv[0], argv[0]);
+        return 1;
+    }
+
+    int fd = open(input, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror(input);
+        return 1;
+    }
+    size_t size = (size_t)st.st_size;
+    const char *data = size ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : "";
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    if (size) madvise((void *)data, size, MADV_SEQUENTIAL);
+
+    Chunker *chunker = chunker_open(&ccfg);
+    if (!chunker) return 1;
+    const struct llama_vocab *vocab = chunker_vocab(chunker);
+    int32_t n_vocab = llama_vocab_n_tokens(vocab);
+
+    PretokShared sh;
+    memset(&sh, 0, sizeof(sh));
+    sh.chunker = chunker;
+    sh.data = data;
+    sh.bos = llama_vocab_bos(vocab);
+    sh.max_tokens = max_tokens;
+    sh.lines = index_lines(data, size, &sh.next);
+    size_t count = sh.next;
+    sh.next = 0;
+    sh.slots = calloc(PRETOK_BLOCK, sizeof(*sh.slots));
+    if (!sh.lines || !sh.slots) {
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+    if (tokenize_special(vocab, "<|start_header_id|>", &sh.start_header) != 0 ||
+        tokenize_special(vocab, "<|end_header_id|>\n\n", &sh.end_header) != 0 ||
+        tokenize_special(vocab, "<|eot_id|>", &sh.eot) != 0 ||
+        sh.start_header.len != 1 || sh.eot.len != 1) {
+        fprintf(stderr, "Error: %s has no Llama 3 chat tokens\n", ccfg.model_path);
+        chunker_close(chunker);
+        return 1;
+    }
+
+    TokWriter *w = tokwriter_open(output, (uint32_t)n_vocab, vocab_hash(vocab, n_vocab));
+    if (!w) {
+        fprintf(stderr, "Error: cannot open %s\n", output);
+        chunker_close(chunker);
+        return 1;
+    }
+
+    if (jobs <= 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        jobs = n > 0 ? (int)n : 1;
+    }
+    pthread_t *threads = calloc((size_t)jobs, sizeof(pthread_t));
+    uint64_t skipped = 0;
+    int rc = 0;
+
+    // Блоками: потоки токенизируют записи блока, затем они пишутся по порядку
+    for (size_t start = 0; start < count && rc == 0; start += PRETOK_BLOCK) {
+        sh.block_start = sh.next = start;
+        sh.block_end = start + PRETOK_BLOCK < count ? start + PRETOK_BLOCK : count;
+        int started = 0;
+        if (threads) {
+            for (; started < jobs; started++) {
+                if (pthread_create(&threads[started], NULL, worker, &sh) != 0) break;
+            }
+        }
+        if (started == 0) worker(&sh);
+        for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+
+        for (size_t i = start; i < sh.block_end; i++) {
+            PretokSlot *s = &sh.slots[i - start];
+            if (!s->ok) { skipped++; continue; }
+            if (tokwriter_add(w, s->tokens.data, s->masks, s->tokens.len, s->source.data, s->category.data) != 0) {
+                fprintf(stderr, "Error: write failed at line %zu\n", i + 1);
+                rc = 1;
+                break;
+            }
+        }
+    }
+    free(threads);
+
+    uint64_t records = tokwriter_records(w), tokens = tokwriter_tokens(w);
+    if (rc == 0) rc = tokwriter_close(w) != 0;
+    else tokwriter_abort(w);
+    printf("%s %llu records → %llu tokens in %s, skipped %llu\n", rc == 0 ? "✅" : "❌",
+           (unsigned long long)records, (unsigned long long)tokens, output, (unsigned long long)skipped);
+
+    for (size_t i = 0; i < PRETOK_BLOCK; i++) {
+        free(sh.slots[i].tokens.data);
+        free(sh.slots[i].masks);
+        strbuf_free(&sh.slots[i].source);
+        strbuf_free(&sh.slots[i].category);
+    }
+    free(sh.slots);
+    free(sh.start_header.data);
+    free(sh.end_header.data);
+    free(sh.eot.data);
+    free(sh.lines);
+    if (size) munmap((void *)data, size);
+    chunker_close(chunker);
+    return rc;
+}
@@ -0,0 +1,152 @@
+// prompt_store.c — чтение хранилища промптов memory.txt (см. prompt_store.h)
+
+#include "prompt_store.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// 0 — отображён (пустой файл: *map = NULL), -1 — ошибка с errno
+static int map_file(const char *path, void **map, size_t *size) {
+    *map = NULL;
+    *size = 0;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    struct stat st;
+    int rc = -1;
+    if (fstat(fd, &st) == 0) {
+        if (st.st_size == 0) {
+            rc = 0;
+        } else {
+            void *m = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (m != MAP_FAILED) {
+                *map = m;
+                *size = (size_t)st.st_size;
+                rc = 0;
+            }
+        }
+    }
+    int saved = errno;
+    close(fd);
+    errno = saved;
+    return rc;
+}
+
+// Запись начинается сразу после '\n' и дописана до своего '\n'
+static int entry_valid(const PromptStore *ps, uint64_t off) {
+    if (off >= ps->log_size) return 0;
+    if (off > 0 && ps->log[off - 1] != '\n') return 0;
+    return memchr(ps->log + off, '\n', ps->log_size - (size_t)off) != NULL;
+}
+
+// Смещения строго растут: иначе индекс испорчен, и доверять нельзя ни одной
+// записи — хвост за концом лога отсекается уже по последней
+static int offsets_sorted(const uint64_t *offsets, size_t n) {
+    for (size_t i = 1; i < n; i++) {
+        if (offsets[i] <= offsets[i - 1]) return 0;
+    }
+    return 1;
+}
+
+// Полные строки лога начиная с from: индексированные (n штук) + найденные
+static int index_tail(PromptStore *ps, const uint64_t *indexed, size_t n, size_t from) {
+    size_t cap = n + 64;
+    uint64_t *out = malloc(cap * sizeof(*out));
+    if (!out) return -1;
+    if (n) memcpy(out, indexed, n * sizeof(*out));
+    size_t count = n;
+    while (from < ps->log_size) {
+        const char *nl = memchr(ps->log + from, '\n', ps->log_size - from);
+        if (!nl) break;   // недописанная строка
+        size_t end = (size_t)(nl - ps->log);
+        if (end > from) {
+            if (count == cap) {
+                cap *= 2;
+                uint64_t *p = realloc(out, cap * sizeof(*out));
+                if (!p) { free(out); return -1; }
+                out = p;
+            }
+            out[count++] = from;
+        }
+        from = end + 1;
+    }
+    ps->owned = out;
+    ps->offsets = out;
+    ps->count = count;
+    return 0;
+}
+
+int prompt_store_open(PromptStore *ps, const char *path) {
+    memset(ps, 0, sizeof(*ps));
+    void *log;
+    if (map_file(path, &log, &ps->log_size) != 0) {
+        // Нет файла — пустое хранилище; EACCES, EMFILE, сбой mmap — ошибка
+        if (errno == ENOENT) { errno = 0; return 0; }
+        return -1;
+    }
+    ps->log = log;
+    if (!ps->log) return 0;    // файл есть, но пуст
+
+    char index_path[4096];
+    snprintf(index_path, sizeof(index_path), "%s%s", path, PSTORE_INDEX_SUFFIX);
+    // Индекс — только ускорение: не открылся — полный проход по логу
+    if (map_file(index_path, &ps->index_map, &ps->index_map_size) != 0) ps->index_map = NULL;
+    const PStoreIndexHeader *hdr = ps->index_map;
+    if (hdr && ps->index_map_size >= sizeof(*hdr) &&
+        memcmp(hdr->magic, PSTORE_INDEX_MAGIC, 8) == 0 && hdr->version == PSTORE_INDEX_VERSION) {
+        const uint64_t *offsets = (const uint64_t *)((const char *)ps->index_map + sizeof(*hdr));
+        size_t n = (ps->index_map_size - sizeof(*hdr)) / sizeof(uint64_t);
+        if (!offsets_sorted(offsets, n)) n = 0;
+        // Все смещения до последнего верного — меньше размера лога
+        while (n > 0 && !entry_valid(ps, offsets[n - 1])) n--;
+        if (n > 0) {
+            const char *nl = memchr(ps->log + offsets[n - 1], '\n', ps->log_size - (size_t)offsets[n - 1]);
+            size_t end = (size_t)(nl - ps->log) + 1;
+            if (end == ps->log_size) {
+                ps->offsets = offsets;
+                ps->count = n;
+                return 0;
+            }
+            // Строки, дописанные после последней записи индекса
+            if (index_tail(ps, offsets, n, end) != 0) {
+                prompt_store_close(ps);
+                return -1;
+            }
+            return 0;
+        }
+    }
+
+    // Индекса нет (пуст, испорчен): полный проход. Старый формат — первая строка из одной '{'
+    if (ps->log[0] == '{' && ps->log_size > 1 && (ps->log[1] == '\n' || ps->log[1] == '\r')) {
+        prompt_store_close(ps);
+        errno = EINVAL;
+        return -1;
+    }
+    if (index_tail(ps, NULL, 0, 0) != 0) {
+        prompt_store_close(ps);
+        return -1;
+    }
+    return 0;
+}
+
+void prompt_store_close(PromptStore *ps) {
+    if (ps->log) munmap((void *)ps->log, ps->log_size);
+    if (ps->index_map) munmap(ps->index_map, ps->index_map_size);
+    free(ps->owned);
+    memset(ps, 0, sizeof(*ps));
+}
+
+int prompt_store_get(const PromptStore *ps, size_t i, const char **data, size_t *len) {
+    if (i >= ps->count) return -1;
+    size_t off = (size_t)ps->offsets[i];
+    const char *nl = memchr(ps->log + off, '\n', ps->log_size - off);
+    size_t end = nl ? (size_t)(nl - ps->log) : ps->log_size;
+    *data = ps->log + off;
+    *len = end - off;
+    return 0;
+}
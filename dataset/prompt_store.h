@@ -0,0 +1,50 @@
+// prompt_store.h — чтение хранилища промптов memory.txt
+//
+// Формат пишет regex_adder/prompt_store.js:
+//   memory.txt      — JSONL, по записи {"instruction","output"} на строку;
+//   memory.txt.idx  — заголовок PStoreIndexHeader + uint64 LE смещение
+//                     начала каждой записи.
+// Оба файла отображаются через mmap: число записей — из размера индекса,
+// запись i — указатель в лог без копирования. Проверяется только последняя
+// запись индекса; строки, дописанные после неё (сбой до записи индекса),
+// доиндексируются в памяти. Без индекса лог сканируется целиком.
+
+#ifndef PROMPT_STORE_H
+#define PROMPT_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define PSTORE_INDEX_MAGIC "OXPSIDX1"
+#define PSTORE_INDEX_VERSION 1
+#define PSTORE_INDEX_SUFFIX ".idx"
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint8_t reserved[20];
+} PStoreIndexHeader;
+
+typedef struct {
+    const char *log;
+    size_t log_size;
+    const uint64_t *offsets;   // count штук: из индекса или owned
+    size_t count;
+    uint64_t *owned;           // доиндексированное в памяти
+    void *index_map;
+    size_t index_map_size;
+} PromptStore;
+
+// 0 — открыто (пустое или отсутствующее хранилище — 0 записей); -1 — ошибка,
+// в том числе старый многострочный формат (errno = EINVAL, нужен compact.js)
+int prompt_store_open(PromptStore *ps, const char *path);
+void prompt_store_close(PromptStore *ps);
+
+static inline size_t prompt_store_count(const PromptStore *ps) {
+    return ps->count;
+}
+
+// Строка записи i без '\n' (указатель в mmap лога); 0 или -1 вне диапазона
+int prompt_store_get(const PromptStore *ps, size_t i, const char **data, size_t *len);
+
+#endif // PROMPT_STORE_H
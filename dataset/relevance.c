@@ -0,0 +1,246 @@
+// relevance.c — автомат Ахо–Корасик для тематической фильтрации (см. relevance.h)
+
+#include "relevance.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define NO_OUTPUT 0xffff
+
+struct RelevanceEngine {
+    uint8_t byte_class[256];   // байт → класс алфавита (0 — не встречается в словах)
+    uint32_t n_classes;
+    uint32_t n_states;
+    uint32_t *delta;           // [state * n_classes + class] → state (полный DFA)
+    uint16_t *out_first;       // первое слово, заканчивающееся в состоянии
+    uint16_t *out_next;        // следующее слово по суффиксной цепочке (по id слова)
+    uint8_t kw_category[REL_MAX_KEYWORDS];
+    double kw_weight[REL_MAX_KEYWORDS];
+    size_t n_keywords;
+    const char *categories[REL_MAX_CATEGORIES];
+    size_t n_categories;
+};
+
+// === Свёртка регистра ===
+// Работает побайтово: для кириллицы меняется и ведущий байт, поэтому
+// функция может выдать 1 или 2 байта. Возвращает число потреблённых байт.
+
+static inline size_t fold_utf8(const unsigned char *s, size_t len, unsigned char out[2], size_t *out_len) {
+    unsigned char c = s[0];
+    if (c >= 'A' && c <= 'Z') {
+        out[0] = (unsigned char)(c + 32);
+        *out_len = 1;
+        return 1;
+    }
+    if (c == 0xD0 && len >= 2) {
+        unsigned char n = s[1];
+        if (n >= 0x90 && n <= 0x9F) { out[0] = 0xD0; out[1] = (unsigned char)(n + 0x20); }      // А-П → а-п
+        else if (n >= 0xA0 && n <= 0xAF) { out[0] = 0xD1; out[1] = (unsigned char)(n - 0x20); } // Р-Я → р-я
+        else if (n >= 0x80 && n <= 0x8F) { out[0] = 0xD1; out[1] = (unsigned char)(n + 0x10); } // Ѐ-Џ (вкл. Ё) → ѐ-џ
+        else { out[0] = 0xD0; out[1] = n; }
+        *out_len = 2;
+        return 2;
+    }
+    out[0] = c;
+    *out_len = 1;
+    return 1;
+}
+
+// Свёрнутая копия слова (только при построении)
+static unsigned char *fold_keyword(const char *kw, size_t *len_out) {
+    size_t len = strlen(kw);
+    unsigned char *out = malloc(len + 1);
+    if (!out) return NULL;
+    size_t o = 0;
+    const unsigned char *s = (const unsigned char *)kw;
+    for (size_t i = 0; i < len;) {
+        unsigned char f[2];
+        size_t fl;
+        i += fold_utf8(s + i, len - i, f, &fl);
+        for (size_t k = 0; k < fl; k++) out[o++] = f[k];
+    }
+    out[o] = '\0';
+    *len_out = o;
+    return out;
+}
+
+// === Построение ===
+
+RelevanceEngine *relevance_build(const RelevanceKeyword *keywords, size_t count) {
+    if (count == 0 || count > REL_MAX_KEYWORDS) return NULL;
+    RelevanceEngine *e = calloc(1, sizeof(*e));
+    if (!e) return NULL;
+    e->n_keywords = count;
+
+    unsigned char *folded[REL_MAX_KEYWORDS] = {0};
+    size_t folded_len[REL_MAX_KEYWORDS];
+    size_t max_states = 1;
+    for (size_t i = 0; i < count; i++) {
+        folded[i] = fold_keyword(keywords[i].keyword, &folded_len[i]);
+        if (!folded[i] || folded_len[i] == 0) goto fail;
+        max_states += folded_len[i];
+
+        // Категории
+        size_t c = 0;
+        while (c < e->n_categories && strcmp(e->categories[c], keywords[i].category) != 0) c++;
+        if (c == e->n_categories) {
+            if (e->n_categories == REL_MAX_CATEGORIES) goto fail;
+            e->categories[e->n_categories++] = keywords[i].category;
+        }
+        e->kw_category[i] = (uint8_t)c;
+        e->kw_weight[i] = keywords[i].weight > 0 ? keywords[i].weight : 1.0;
+
+        for (size_t k = 0; k < folded_len[i]; k++) {
+            unsigned char b = folded[i][k];
+            if (!e->byte_class[b]) e->byte_class[b] = (uint8_t)++e->n_classes;
+        }
+    }
+    e->n_classes += 1;  // класс 0 — "прочие байты"
+    // ASCII-регистр сворачивается прямо таблицей классов; кириллица — в fold_utf8
+    for (int c = 'A'; c <= 'Z'; c++) e->byte_class[c] = e->byte_class[c + 32];
+
+    e->delta = calloc(max_states * e->n_classes, sizeof(uint32_t));
+    e->out_first = malloc(max_states * sizeof(uint16_t));
+    e->out_next = malloc(count * sizeof(uint16_t));
+    uint32_t *fail_link = calloc(max_states, sizeof(uint32_t));
+    uint32_t *queue = malloc(max_states * sizeof(uint32_t));
+    // Временный trie: 0 в delta означает "нет перехода" (корень не бывает целью в trie)
+    if (!e->delta || !e->out_first || !e->out_next || !fail_link || !queue) {
+        free(fail_link);
+        free(queue);
+        goto fail;
+    }
+    for (size_t s = 0; s < max_states; s++) e->out_first[s] = NO_OUTPUT;
+    for (size_t i = 0; i < count; i++) e->out_next[i] = NO_OUTPUT;
+
+    // 1. Trie
+    e->n_states = 1;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t s = 0;
+        for (size_t k = 0; k < folded_len[i]; k++) {
+            uint32_t *t = &e->delta[s * e->n_classes + e->byte_class[folded[i][k]]];
+            if (!*t) *t = e->n_states++;
+            s = *t;
+        }
+        // Одинаковые слова дважды: второе цепляем за первое
+        e->out_next[i] = e->out_first[s];
+        e->out_first[s] = (uint16_t)i;
+    }
+
+    // 2. BFS: суффиксные ссылки, достраивание DFA, слияние выходов
+    size_t head = 0, tail = 0;
+    for (uint32_t c = 0; c < e->n_classes; c++) {
+        uint32_t t = e->delta[c];
+        if (t) { fail_link[t] = 0; queue[tail++] = t; }
+    }
+    while (head < tail) {
+        uint32_t s = queue[head++];
+        // Выходы суффикса дописываем в конец цепочки s
+        uint32_t f = fail_link[s];
+        if (e->out_first[f] != NO_OUTPUT) {
+            if (e->out_first[s] == NO_OUTPUT) {
+                e->out_first[s] = e->out_first[f];
+            } else {
+                uint16_t k = e->out_first[s];
+                while (e->out_next[k] != NO_OUTPUT && e->out_next[k] != e->out_first[f]) k = e->out_next[k];
+                if (e->out_next[k] == NO_OUTPUT) e->out_next[k] = e->out_first[f];
+            }
+        }
+        for (uint32_t c = 0; c < e->n_classes; c++) {
+            uint32_t *t = &e->delta[s * e->n_classes + c];
+            if (*t) {
+                fail_link[*t] = e->delta[fail_link[s] * e->n_classes + c];
+                queue[tail++] = *t;
+            } else {
+                *t = e->delta[fail_link[s] * e->n_classes + c];
+            }
+        }
+    }
+    free(fail_link);
+    free(queue);
+
+    for (size_t i = 0; i < count; i++) free(folded[i]);
+    return e;
+
+fail:
+    for (size_t i = 0; i < count; i++) free(folded[i]);
+    relevance_free(e);
+    return NULL;
+}
+
+void relevance_free(RelevanceEngine *e) {
+    if (!e) return;
+    free(e->delta);
+    free(e->out_first);
+    free(e->out_next);
+    free(e);
+}
+
+// === Сканирование ===
+
+static inline uint32_t step(const RelevanceEngine *e, uint32_t s, unsigned char b) {
+    return e->delta[s * e->n_classes + e->byte_class[b]];
+}
+
+// Общий проход; stop_at > 0 — выйти, как только набралось столько разных слов
+static void scan(const RelevanceEngine *e, const char *text, size_t len, RelevanceResult *r, uint32_t stop_at) {
+    memset(r, 0, sizeof(*r));
+    r->top_category = -1;
+    const unsigned char *s = (const unsigned char *)text;
+    uint32_t state = 0;
+
+    for (size_t i = 0; i < len;) {
+        unsigned char c = s[i];
+        unsigned char f[2];
+        size_t fl;
+        if (c != 0xD0) {
+            // Быстрый путь: всё, кроме заглавной кириллицы, идёт в автомат как есть
+            f[0] = c;
+            fl = 1;
+            i++;
+        } else {
+            i += fold_utf8(s + i, len - i, f, &fl);
+        }
+        for (size_t k = 0; k < fl; k++) {
+            state = step(e, state, f[k]);
+            for (uint16_t kw = e->out_first[state]; kw != NO_OUTPUT; kw = e->out_next[kw]) {
+                if (r->keyword_hits[kw]++ == 0) r->distinct++;
+                r->category_hits[e->kw_category[kw]]++;
+                r->total++;
+            }
+        }
+        if (stop_at && r->distinct >= stop_at) return;
+    }
+}
+
+void relevance_scan(const RelevanceEngine *e, const char *text, size_t len, RelevanceResult *out) {
+    scan(e, text, len, out, 0);
+
+    double per_category[REL_MAX_CATEGORIES] = {0};
+    for (size_t kw = 0; kw < e->n_keywords; kw++) {
+        if (!out->keyword_hits[kw]) continue;
+        double v = e->kw_weight[kw] * log2(1.0 + out->keyword_hits[kw]);
+        out->score += v;
+        per_category[e->kw_category[kw]] += v;
+    }
+    double best = 0;
+    for (size_t c = 0; c < e->n_categories; c++) {
+        if (per_category[c] > best) { best = per_category[c]; out->top_category = (int)c; }
+    }
+}
+
+int relevance_has(const RelevanceEngine *e, const char *text, size_t len, uint32_t min_distinct) {
+    RelevanceResult r;
+    scan(e, text, len, &r, min_distinct);
+    return r.distinct >= min_distinct;
+}
+
+size_t relevance_category_count(const RelevanceEngine *e) {
+    return e->n_categories;
+}
+
+const char *relevance_category_name(const RelevanceEngine *e, int index) {
+    if (index < 0 || (size_t)index >= e->n_categories) return NULL;
+    return e->categories[index];
+}
@@ -0,0 +1,46 @@
+// relevance.h — тематический классификатор на одном автомате Ахо–Корасик
+//
+// Все ключевые слова компилируются в один DFA над байтами UTF-8 с
+// регистронезависимым сравнением (ASCII и кириллица, включая Ё).
+// Текст проходится один раз, без копий и выделений памяти; результат —
+// число вхождений по каждому слову и категории и взвешенная оценка.
+// Построенный автомат только читается, поэтому один экземпляр можно
+// использовать из нескольких потоков.
+
+#ifndef RELEVANCE_H
+#define RELEVANCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define REL_MAX_KEYWORDS 256
+#define REL_MAX_CATEGORIES 16
+
+typedef struct {
+    const char *keyword;       // UTF-8, регистр не важен
+    const char *category;
+    double weight;
+} RelevanceKeyword;
+
+typedef struct {
+    uint32_t keyword_hits[REL_MAX_KEYWORDS];
+    uint32_t category_hits[REL_MAX_CATEGORIES];
+    uint32_t distinct;         // сколько разных слов встретилось
+    uint32_t total;            // всего вхождений
+    double score;              // Σ weight · log2(1 + hits)
+    int top_category;          // индекс категории с наибольшим вкладом, -1 если нет
+} RelevanceResult;
+
+typedef struct RelevanceEngine RelevanceEngine;
+
+RelevanceEngine *relevance_build(const RelevanceKeyword *keywords, size_t count);
+void relevance_free(RelevanceEngine *engine);
+
+void relevance_scan(const RelevanceEngine *engine, const char *text, size_t len, RelevanceResult *out);
+// Быстрая проверка: встречаются ли хотя бы min_distinct разных слов (ранний выход)
+int relevance_has(const RelevanceEngine *engine, const char *text, size_t len, uint32_t min_distinct);
+
+size_t relevance_category_count(const RelevanceEngine *engine);
+const char *relevance_category_name(const RelevanceEngine *engine, int index);
+
+#endif // RELEVANCE_H
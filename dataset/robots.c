@@ -0,0 +1,515 @@
+// robots.c — разбор robots.txt и префиксное дерево правил (см. robots.h)
+
+#include "robots.h"
+#include "url.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <pthread.h>
+
+// === Дерево правил ===
+//
+// Узел — символ шаблона; '*' хранится отдельной ссылкой star, '$' — флагом
+// end_verdict у последнего узла. Вердикт узла: +1 Allow, -1 Disallow.
+// depth — длина шаблона в байтах (для правила "самое длинное побеждает").
+
+typedef struct {
+    int32_t child;        // первый потомок
+    int32_t sibling;      // следующий брат
+    int32_t star;         // потомок по '*'
+    uint32_t depth;
+    unsigned char label;
+    int8_t verdict;       // правило заканчивается здесь
+    int8_t end_verdict;   // то же с '$': только если путь кончился
+} RobotsNode;
+
+struct RobotsRules {
+    RobotsNode *nodes;
+    size_t n_nodes;
+    size_t cap;
+    int crawl_delay_ms;
+};
+
+static int32_t new_node(RobotsRules *r, unsigned char label, uint32_t depth) {
+    if (r->n_nodes == r->cap) {
+        size_t cap = r->cap ? r->cap * 2 : 64;
+        RobotsNode *p = realloc(r->nodes, cap * sizeof(*p));
+        if (!p) return -1;
+        r->nodes = p;
+        r->cap = cap;
+    }
+    RobotsNode *n = &r->nodes[r->n_nodes];
+    n->child = n->sibling = n->star = -1;
+    n->depth = depth;
+    n->label = label;
+    n->verdict = n->end_verdict = 0;
+    return (int32_t)r->n_nodes++;
+}
+
+static RobotsRules *rules_new(void) {
+    RobotsRules *r = calloc(1, sizeof(*r));
+    if (!r) return NULL;
+    r->crawl_delay_ms = -1;
+    if (new_node(r, 0, 0) < 0) { free(r); return NULL; }
+    return r;
+}
+
+static inline int hexval(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// При равной длине Allow побеждает — и при повторе того же шаблона
+static inline int8_t merge_verdict(int8_t old, int8_t v) {
+    return (old > 0 || v > 0) ? 1 : -1;
+}
+
+static inline int is_unreserved(unsigned char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           c == '-' || c == '.' || c == '_' || c == '~';
+}
+
+// %xx в шаблоне приводится к тому же виду, что и путь в канонической
+// форме адреса (url.c): незарезервированные символы раскодируются,
+// остальные — в верхнем регистре; "**" ≡ "*"
+static size_t normalize_pattern(const char *pat, size_t len, char *out, size_t out_size) {
+    static const char HEX[] = "0123456789ABCDEF";
+    size_t w = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (w + 3 >= out_size) return 0;
+        char c = pat[i];
+        if (c == '%' && i + 2 < len && hexval(pat[i + 1]) >= 0 && hexval(pat[i + 2]) >= 0) {
+            unsigned char v = (unsigned char)(hexval(pat[i + 1]) * 16 + hexval(pat[i + 2]));
+            if (is_unreserved(v)) out[w++] = (char)v;
+            else { out[w++] = '%'; out[w++] = HEX[v >> 4]; out[w++] = HEX[v & 15]; }
+            i += 2;
+        } else if (c == '*' && w > 0 && out[w - 1] == '*') {
+            continue;
+        } else {
+            out[w++] = c;
+        }
+    }
+    return w;
+}
+
+static int add_rule(RobotsRules *r, const char *raw, size_t raw_len, int allow) {
+    int anchored = raw_len > 0 && raw[raw_len - 1] == '$';
+    if (anchored) raw_len--;
+    char pat[URL_MAX];
+    size_t len = normalize_pattern(raw, raw_len, pat, sizeof(pat));
+    if (len == 0 && raw_len > 0) return 0;   // слишком длинный шаблон
+
+    int32_t node = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)pat[i];
+        int32_t next = -1;
+        if (c == '*') {
+            next = r->nodes[node].star;
+            if (next < 0) {
+                next = new_node(r, c, (uint32_t)i + 1);
+                if (next < 0) return -1;
+                r->nodes[node].star = next;
+            }
+        } else {
+            for (int32_t ch = r->nodes[node].child; ch >= 0; ch = r->nodes[ch].sibling) {
+                if (r->nodes[ch].label == c) { next = ch; break; }
+            }
+            if (next < 0) {
+                next = new_node(r, c, (uint32_t)i + 1);
+                if (next < 0) return -1;
+                r->nodes[next].sibling = r->nodes[node].child;
+                r->nodes[node].child = next;
+            }
+        }
+        node = next;
+    }
+
+    int8_t v = allow ? 1 : -1;
+    RobotsNode *n = &r->nodes[node];
+    if (anchored) n->end_verdict = n->end_verdict ? merge_verdict(n->end_verdict, v) : v;
+    else n->verdict = n->verdict ? merge_verdict(n->verdict, v) : v;
+    return 0;
+}
+
+typedef struct {
+    uint32_t depth;
+    int8_t verdict;
+} Match;
+
+static inline void consider(Match *m, uint32_t depth, int8_t v) {
+    if (depth > m->depth || (depth == m->depth && v > m->verdict)) {
+        m->depth = depth;
+        m->verdict = v;
+    }
+}
+
+// Сопоставление — проход по пути с множеством активных узлов (NFA): на
+// позиции pos активны узлы, до которых шаблон дочитан по первым pos байтам.
+// Узел '*' остаётся активным и на всех следующих позициях. Каждый узел
+// входит в множество не больше раза за позицию, так что время —
+// O(узлов × длина пути) при любом числе '*' в правилах (перебор с
+// возвратами на "/*a*a*a*a*b" экспоненциален, а правила приходят с чужого
+// сервера). mark[узел] — позиция + 1, на которой узел уже добавлен.
+
+#define MATCH_STACK_NODES 256
+
+static inline void activate(const RobotsRules *r, int32_t idx, uint32_t gen, uint32_t *mark,
+                            int32_t *set, size_t *n) {
+    // '*' может совпасть и с пустой строкой — узел по звезде активен сразу
+    while (idx >= 0 && mark[idx] != gen) {
+        mark[idx] = gen;
+        set[(*n)++] = idx;
+        idx = r->nodes[idx].star;
+    }
+}
+
+static Match match(const RobotsRules *r, const char *p, size_t len, int32_t *cur, int32_t *next, uint32_t *mark) {
+    Match m = { 0, 0 };
+    size_t n_cur = 0;
+    activate(r, 0, 1, mark, cur, &n_cur);
+    for (size_t pos = 0;; pos++) {
+        for (size_t i = 0; i < n_cur; i++) {
+            const RobotsNode *n = &r->nodes[cur[i]];
+            if (n->verdict) consider(&m, n->depth, n->verdict);
+            if (n->end_verdict && pos == len) consider(&m, n->depth, n->end_verdict);
+        }
+        if (pos == len || n_cur == 0) break;
+
+        uint32_t gen = (uint32_t)pos + 2;
+        unsigned char c = (unsigned char)p[pos];
+        size_t n_next = 0;
+        for (size_t i = 0; i < n_cur; i++) {
+            const RobotsNode *n = &r->nodes[cur[i]];
+            // Литерала '*' в дереве нет: такая метка только у узлов по звезде
+            if (n->label == '*') activate(r, cur[i], gen, mark, next, &n_next);
+            for (int32_t ch = n->child; ch >= 0; ch = r->nodes[ch].sibling) {
+                if (r->nodes[ch].label == c) {
+                    activate(r, ch, gen, mark, next, &n_next);
+                    break;
+                }
+            }
+        }
+        int32_t *t = cur;
+        cur = next;
+        next = t;
+        n_cur = n_next;
+    }
+    return m;
+}
+
+int robots_rules_allowed(const RobotsRules *rules, const char *path) {
+    if (!rules) return 1;
+    if (strcmp(path, "/robots.txt") == 0) return 1;
+    size_t len = strlen(path);
+    if (len >= UINT32_MAX - 2) return 1;
+
+    // Обычный robots.txt — десятки правил: хватает буферов на стеке
+    int32_t stack_sets[2 * MATCH_STACK_NODES];
+    uint32_t stack_mark[MATCH_STACK_NODES];
+    int32_t *sets = stack_sets;
+    uint32_t *mark = stack_mark;
+    void *heap = NULL;
+    if (rules->n_nodes > MATCH_STACK_NODES) {
+        heap = malloc(rules->n_nodes * (2 * sizeof(int32_t) + sizeof(uint32_t)));
+        if (!heap) return 1;
+        sets = heap;
+        mark = (uint32_t *)(sets + 2 * rules->n_nodes);
+    }
+    memset(mark, 0, rules->n_nodes * sizeof(uint32_t));
+    Match m = match(rules, path, len, sets, sets + rules->n_nodes, mark);
+    free(heap);
+    return m.verdict >= 0;
+}
+
+int robots_rules_crawl_delay_ms(const RobotsRules *rules) {
+    return rules ? rules->crawl_delay_ms : -1;
+}
+
+void robots_rules_free(RobotsRules *rules) {
+    if (!rules) return;
+    free(rules->nodes);
+    free(rules);
+}
+
+RobotsRules *robots_allow_all(void) {
+    return rules_new();
+}
+
+RobotsRules *robots_disallow_all(void) {
+    RobotsRules *r = rules_new();
+    if (r && add_rule(r, "/", 1, 0) != 0) { robots_rules_free(r); return NULL; }
+    return r;
+}
+
+// === Разбор ===
+
+// Правила копятся отдельно для "нашей" группы и для "*": какую брать,
+// ясно только в конце файла
+typedef struct {
+    const char *pat;
+    size_t len;
+    int allow;
+} RawRule;
+
+typedef struct {
+    RawRule *items;
+    size_t n;
+    size_t cap;
+    int delay_ms;
+    int seen;        // была хоть одна такая группа
+} RuleSet;
+
+static int ruleset_push(RuleSet *s, const char *pat, size_t len, int allow) {
+    if (s->n == s->cap) {
+        size_t cap = s->cap ? s->cap * 2 : 32;
+        RawRule *p = realloc(s->items, cap * sizeof(*p));
+        if (!p) return -1;
+        s->items = p;
+        s->cap = cap;
+    }
+    s->items[s->n++] = (RawRule){ pat, len, allow };
+    return 0;
+}
+
+static int parse_delay_ms(const char *v, size_t len) {
+    char buf[32];
+    if (len == 0 || len >= sizeof(buf)) return -1;
+    memcpy(buf, v, len);
+    buf[len] = '\0';
+    char *end;
+    double sec = strtod(buf, &end);
+    if (end == buf || sec < 0) return -1;
+    if (sec > 3600) sec = 3600;
+    return (int)(sec * 1000.0 + 0.5);
+}
+
+static inline int is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+RobotsRules *robots_parse(const char *txt, size_t len, const char *user_agent) {
+    // Имя продукта: "osdev-dataset-builder/1.0" → "osdev-dataset-builder"
+    size_t ua_len = user_agent ? strcspn(user_agent, "/ ") : 0;
+
+    RuleSet ours = { .delay_ms = -1 }, any = { .delay_ms = -1 };
+    int in_agents = 0;          // подряд идущие User-agent образуют одну группу
+    int group_ours = 0, group_any = 0;
+
+    // BOM в начале файла
+    if (len >= 3 && memcmp(txt, "\xEF\xBB\xBF", 3) == 0) { txt += 3; len -= 3; }
+
+    const char *p = txt, *end = txt + len;
+    while (p < end) {
+        const char *eol = memchr(p, '\n', (size_t)(end - p));
+        if (!eol) eol = end;
+        const char *line_end = eol;
+        const char *hash = memchr(p, '#', (size_t)(line_end - p));
+        if (hash) line_end = hash;
+
+        const char *k = p;
+        while (k < line_end && is_space(*k)) k++;
+        const char *colon = memchr(k, ':', (size_t)(line_end - k));
+        p = eol + 1;
+        if (!colon) continue;
+
+        const char *k_end = colon;
+        while (k_end > k && is_space(k_end[-1])) k_end--;
+        const char *v = colon + 1;
+        while (v < line_end && is_space(*v)) v++;
+        const char *v_end = line_end;
+        while (v_end > v && is_space(v_end[-1])) v_end--;
+        size_t klen = (size_t)(k_end - k), vlen = (size_t)(v_end - v);
+
+        if (klen == 10 && strncasecmp(k, "user-agent", 10) == 0) {
+            if (!in_agents) { group_ours = group_any = 0; in_agents = 1; }
+            if (vlen == 1 && v[0] == '*') {
+                group_any = 1;
+                any.seen = 1;
+            } else if (ua_len && vlen <= ua_len && strncasecmp(v, user_agent, vlen) == 0 && vlen > 0) {
+                group_ours = 1;
+                ours.seen = 1;
+            }
+            continue;
+        }
+        int allow = klen == 5 && strncasecmp(k, "allow", 5) == 0;
+        int disallow = klen == 8 && strncasecmp(k, "disallow", 8) == 0;
+        int delay = klen == 11 && strncasecmp(k, "crawl-delay", 11) == 0;
+        if (!allow && !disallow && !delay) continue;   // Sitemap и прочее
+        in_agents = 0;
+        if (!group_ours && !group_any) continue;
+
+        RuleSet *sets[2] = { group_ours ? &ours : NULL, group_any ? &any : NULL };
+        for (int i = 0; i < 2; i++) {
+            RuleSet *s = sets[i];
+            if (!s) continue;
+            if (delay) {
+                int ms = parse_delay_ms(v, vlen);
+                if (ms >= 0 && ms > s->delay_ms) s->delay_ms = ms;
+            } else if (vlen > 0 && (v[0] == '/' || v[0] == '*')) {
+                // Пустой Disallow ничего не запрещает; шаблон без '/' — мусор
+                if (ruleset_push(s, v, vlen, allow) != 0) goto fail;
+            }
+        }
+    }
+
+    RuleSet *use = ours.seen ? &ours : &any;
+    RobotsRules *r = rules_new();
+    if (!r) goto fail;
+    for (size_t i = 0; i < use->n; i++) {
+        if (add_rule(r, use->items[i].pat, use->items[i].len, use->items[i].allow) != 0) {
+            robots_rules_free(r);
+            goto fail;
+        }
+    }
+    r->crawl_delay_ms = use->delay_ms;
+    free(ours.items);
+    free(any.items);
+    return r;
+
+fail:
+    free(ours.items);
+    free(any.items);
+    return NULL;
+}
+
+// === Кэш по хостам ===
+//
+// Открытая адресация по хэшу "scheme://host". Запись создаётся первым
+// спросившим потоком, который и скачивает robots.txt без блокировки;
+// остальные ждут на условной переменной, а не качают его повторно.
+
+typedef struct {
+    char origin[300];       // "https://host[:port]"
+    uint64_t hash;
+    RobotsRules *rules;     // NULL при ready — без ограничений (не хватило памяти)
+    int ready;              // 0 — ещё грузится
+} RobotsEntry;
+
+struct RobotsCache {
+    FetchCache *fetch;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    RobotsEntry **slots;
+    size_t cap;             // степень двойки
+    size_t n;
+};
+
+RobotsCache *robots_cache_new(FetchCache *fetch) {
+    RobotsCache *c = calloc(1, sizeof(*c));
+    if (!c) return NULL;
+    c->fetch = fetch;
+    c->cap = 64;
+    c->slots = calloc(c->cap, sizeof(*c->slots));
+    if (!c->slots) { free(c); return NULL; }
+    pthread_mutex_init(&c->lock, NULL);
+    pthread_cond_init(&c->ready, NULL);
+    return c;
+}
+
+void robots_cache_free(RobotsCache *c) {
+    if (!c) return;
+    for (size_t i = 0; i < c->cap; i++) {
+        if (!c->slots[i]) continue;
+        robots_rules_free(c->slots[i]->rules);
+        free(c->slots[i]);
+    }
+    free(c->slots);
+    pthread_mutex_destroy(&c->lock);
+    pthread_cond_destroy(&c->ready);
+    free(c);
+}
+
+static RobotsEntry **find_slot(RobotsEntry **slots, size_t cap, const char *origin, uint64_t h) {
+    size_t i = (size_t)h & (cap - 1);
+    while (slots[i] && (slots[i]->hash != h || strcmp(slots[i]->origin, origin) != 0)) {
+        i = (i + 1) & (cap - 1);
+    }
+    return &slots[i];
+}
+
+static int grow(RobotsCache *c) {
+    size_t cap = c->cap * 2;
+    RobotsEntry **slots = calloc(cap, sizeof(*slots));
+    if (!slots) return -1;
+    for (size_t i = 0; i < c->cap; i++) {
+        RobotsEntry *e = c->slots[i];
+        if (e) *find_slot(slots, cap, e->origin, e->hash) = e;
+    }
+    free(c->slots);
+    c->slots = slots;
+    c->cap = cap;
+    return 0;
+}
+
+static RobotsRules *load_rules(RobotsCache *c, const char *origin) {
+    char url[sizeof(((RobotsEntry *)0)->origin) + 16];
+    snprintf(url, sizeof(url), "%s/robots.txt", origin);
+
+    FetchResult res;
+    if (fetch_cache_get(c->fetch, url, &res) == 0) {
+        RobotsRules *r = robots_parse(res.body, res.size, c->fetch->user_agent);
+        fetch_result_free(&res);
+        return r ? r : robots_allow_all();
+    }
+    // 2xx с пустым телом и 4xx — ограничений нет; offline без записи в кэше —
+    // страницы всё равно берутся только из кэша
+    if ((res.http_code >= 200 && res.http_code < 300) ||
+        (res.http_code >= 400 && res.http_code < 500) || c->fetch->offline) {
+        return robots_allow_all();
+    }
+    fprintf(stderr, "robots.txt недоступен (%s, HTTP %ld) — хост пропускается\n", url, res.http_code);
+    return robots_disallow_all();
+}
+
+int robots_check(RobotsCache *c, const char *url, int wait, int *crawl_delay_ms) {
+    if (crawl_delay_ms) *crawl_delay_ms = -1;
+    const char *sep = strstr(url, "://");
+    if (!sep) return 1;                          // не http(s) — не наше дело
+    size_t origin_len = (size_t)(sep + 3 - url) + strcspn(sep + 3, "/?#");
+    const char *path = url_path(url);
+
+    char origin[sizeof(((RobotsEntry *)0)->origin)];
+    if (origin_len >= sizeof(origin)) return 1;
+    memcpy(origin, url, origin_len);
+    origin[origin_len] = '\0';
+    uint64_t h = url_hash(origin, origin_len);
+
+    pthread_mutex_lock(&c->lock);
+    RobotsEntry **slot = find_slot(c->slots, c->cap, origin, h);
+    RobotsEntry *e = *slot;
+    if (!e) {
+        if (!wait) { pthread_mutex_unlock(&c->lock); return -1; }
+        if ((c->n + 1) * 2 > c->cap) {
+            if (grow(c) != 0) { pthread_mutex_unlock(&c->lock); return 1; }
+            slot = find_slot(c->slots, c->cap, origin, h);
+        }
+        e = calloc(1, sizeof(*e));
+        if (!e) { pthread_mutex_unlock(&c->lock); return 1; }
+        memcpy(e->origin, origin, origin_len + 1);
+        e->hash = h;
+        *slot = e;
+        c->n++;
+        pthread_mutex_unlock(&c->lock);
+
+        RobotsRules *r = load_rules(c, origin);
+
+        pthread_mutex_lock(&c->lock);
+        e->rules = r;
+        e->ready = 1;
+        pthread_cond_broadcast(&c->ready);
+    } else if (!e->ready) {
+        if (!wait) { pthread_mutex_unlock(&c->lock); return -1; }
+        while (!e->ready) pthread_cond_wait(&c->ready, &c->lock);
+    }
+    // Правила после публикации не меняются — сопоставление можно вести без блокировки
+    const RobotsRules *r = e->rules;
+    pthread_mutex_unlock(&c->lock);
+
+    if (crawl_delay_ms) *crawl_delay_ms = robots_rules_crawl_delay_ms(r);
+    return robots_rules_allowed(r, path);
+}
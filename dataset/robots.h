@@ -0,0 +1,51 @@
+// robots.h — robots.txt: разбор, сопоставление, кэш по хостам
+//
+// robots.txt каждого хоста скачивается один раз за прогон (через
+// fetch_cache, так что и между прогонами — условным запросом) и
+// компилируется в префиксное дерево правил. Проверка адреса — один
+// проход по пути с множеством активных узлов дерева: O(узлов × длина
+// пути) при любых '*' в правилах, память — на стеке (для больших файлов
+// правил — одно выделение на проверку).
+//
+// Семантика по RFC 9309:
+//   - группа выбирается по имени продукта из User-Agent, иначе "*";
+//     несколько подходящих групп объединяются;
+//   - побеждает самое длинное совпавшее правило, при равной длине — Allow;
+//   - '*' — любая последовательность, '$' в конце — конец пути;
+//   - 4xx при загрузке — всё разрешено, 5xx и недоступность — всё запрещено.
+// Crawl-delay отдаётся планировщику обхода.
+
+#ifndef ROBOTS_H
+#define ROBOTS_H
+
+#include <stddef.h>
+
+#include "fetch_cache.h"
+
+typedef struct RobotsRules RobotsRules;
+typedef struct RobotsCache RobotsCache;
+
+// === Одна политика ===
+
+// user_agent — полный UA ("name/1.0"); сравнивается имя продукта до '/'
+RobotsRules *robots_parse(const char *txt, size_t len, const char *user_agent);
+RobotsRules *robots_allow_all(void);
+RobotsRules *robots_disallow_all(void);
+void robots_rules_free(RobotsRules *rules);
+
+// path — путь с запросом ("/a/b?x=1"); 1 — можно, 0 — нельзя
+int robots_rules_allowed(const RobotsRules *rules, const char *path);
+// Crawl-delay в миллисекундах, -1 — не задан
+int robots_rules_crawl_delay_ms(const RobotsRules *rules);
+
+// === Кэш по хостам (потокобезопасный) ===
+
+RobotsCache *robots_cache_new(FetchCache *fetch);
+void robots_cache_free(RobotsCache *cache);
+
+// url — канонический http(s)-адрес. wait = 0: если robots.txt хоста ещё
+// не загружен, не ждать и вернуть -1. Иначе 1 — можно, 0 — запрещено.
+// crawl_delay_ms (может быть NULL) — Crawl-delay хоста или -1.
+int robots_check(RobotsCache *cache, const char *url, int wait, int *crawl_delay_ms);
+
+#endif // ROBOTS_H
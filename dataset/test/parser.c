@@ -5,14 +5,20 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <time.h>
 #include <unistd.h>
 #include <curl/curl.h>
-#include <ctype.h>
 #include <libxml/HTMLparser.h>
 #include <libxml/xpath.h>
 #include <libxml/tree.h>
-#include <openssl/sha.h>
+
+#include "../fpindex.h"
+#include "../json_escape.h"
+#include "../ds_writer.h"
+#include "../relevance.h"
+#include "../normalize.h"
+#include "../langid.h"
 
 // ! EXAMPLE FOR DATASET.C
 
@@ -25,13 +31,29 @@ typedef struct {
     const char *category;
 } SiteConfig;
 
-static const char *TOPIC_KEYWORDS[] = {
-    "pointer", "memory", "malloc", "free", "kernel", "system call",
-    "file", "process", "thread", "socket", "pipe", "fork", "exec",
-    "linux", "unix", "posix", "buffer", "stack", "heap", "segmentation",
-    "compiler", "linker", "assembly", "syscall", "descriptor"
+// keyword, category, weight — compiled into one Aho-Corasick automaton (../relevance.h)
+static const RelevanceKeyword TOPIC_KEYWORDS[] = {
+    {"pointer", "memory", 1.0}, {"memory", "memory", 0.5}, {"malloc", "memory", 1.5},
+    {"free", "memory", 0.5}, {"buffer", "memory", 0.5}, {"stack", "memory", 1.0},
+    {"heap", "memory", 1.0}, {"segmentation", "memory", 1.5},
+    {"kernel", "kernel", 1.5}, {"system call", "kernel", 2.0}, {"syscall", "kernel", 2.0},
+    {"file", "io", 0.5}, {"descriptor", "io", 1.5}, {"socket", "io", 1.5}, {"pipe", "io", 1.0},
+    {"process", "process", 1.0}, {"thread", "process", 1.0}, {"fork", "process", 1.5},
+    {"exec", "process", 1.0},
+    {"linux", "os", 0.5}, {"unix", "os", 0.5}, {"posix", "os", 1.0},
+    {"compiler", "toolchain", 1.0}, {"linker", "toolchain", 1.5}, {"assembly", "toolchain", 1.5},
+    // Russian sources (memory.txt, pars.sh prompts)
+    {"указател", "memory", 1.0}, {"памят", "memory", 0.5}, {"куч", "memory", 0.5},
+    {"ядр", "kernel", 1.5}, {"системный вызов", "kernel", 2.0}, {"прерыван", "kernel", 1.5},
+    {"процесс", "process", 1.0}, {"поток", "process", 0.5},
+    {"дескриптор", "io", 1.5}, {"сокет", "io", 1.5},
+    {"компилятор", "toolchain", 1.0}, {"компоновщик", "toolchain", 1.5}, {"ассемблер", "toolchain", 1.5},
 };
 static const size_t KEYWORD_COUNT = sizeof(TOPIC_KEYWORDS) / sizeof(TOPIC_KEYWORDS[0]);
+#define MIN_RELEVANCE_SCORE 2.0
+#define CONTENT_MAX_BYTES (256 * 1024)  // safety cap only: token-sized chunks are cut by chunk_dataset
+
+static RelevanceEngine *relevance_engine = NULL;
 
 // ==================== UTILS ====================
 
@@ -52,172 +74,103 @@ static size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, voi
     return realsize;
 }
 
-char *escape_json(const char *input) {
-    if (!input) return strdup("");
-    size_t len = strlen(input);
-    char *escaped = malloc(len * 6 + 3);
-    if (!escaped) return NULL;
-    char *p = escaped;
-    for (const char *s = input; *s; s++) {
-        switch (*s) {
-            case '"':  p += sprintf(p, "\\\""); break;
-            case '\\': p += sprintf(p, "\\\\"); break;
-            case '\n': p += sprintf(p, "\\n");  break;
-            case '\r': p += sprintf(p, "\\r");  break;
-            case '\t': p += sprintf(p, "\\t");  break;
-            default:
-                if ((unsigned char)*s < 0x20) {
-                    p += sprintf(p, "\\u%04x", (unsigned char)*s);
-                } else {
-                    *p++ = *s;
-                }
-        }
+int is_block_element(const char *name) {
+    static const char *const BLOCK[] = {
+        "p", "div", "li", "ul", "ol", "dl", "dt", "dd", "pre", "blockquote", "table", "tr",
+        "h1", "h2", "h3", "h4", "h5", "h6", "section", "article", "header", "main", "aside",
+        "figure", "figcaption", "hr",
+    };
+    for (size_t i = 0; i < sizeof(BLOCK) / sizeof(BLOCK[0]); i++) {
+        if (!strcasecmp(name, BLOCK[i])) return 1;
     }
-    *p = '\0';
-    return escaped;
+    return 0;
 }
 
+// Block elements are separated by a blank line and <br> by a newline, so the
+// normalizer can keep paragraph boundaries for the chunker (../chunker.h)
 void extract_text_recursive(xmlNode *node, xmlBufferPtr buf) {
     if (!node) return;
+    int block = 0;
     if (node->type == XML_ELEMENT_NODE) {
         const char *name = (const char *)node->name;
         if (name && (!strcmp(name, "script") || !strcmp(name, "style") || !strcmp(name, "nav") || !strcmp(name, "footer"))) {
             return;
         }
+        if (name && !strcasecmp(name, "br")) {
+            xmlBufferCCat(buf, "\n");
+            return;
+        }
+        block = name && is_block_element(name);
     }
     if (node->type == XML_TEXT_NODE || node->type == XML_CDATA_SECTION_NODE) {
         xmlNodeBufGetContent(buf, node);
     }
+    if (block) xmlBufferCCat(buf, "\n\n");
     for (xmlNode *child = node->children; child; child = child->next) {
         extract_text_recursive(child, buf);
     }
+    if (block) xmlBufferCCat(buf, "\n\n");
 }
 
-char *get_clean_text(xmlNode *node) {
+// Text of the subtree, normalized in one pass inside the libxml buffer
+// (whitespace, control chars, broken UTF-8, sentence-aware cut at CONTENT_MAX_BYTES);
+// keep_paragraphs leaves block boundaries as "\n\n" (article text), otherwise one line (titles)
+char *get_clean_text(xmlNode *node, int keep_paragraphs, NormStats *stats) {
     if (!node) return NULL;
     xmlBufferPtr buf = xmlBufferCreate();
     if (!buf) return NULL;
     extract_text_recursive(node, buf);
-    char *raw = (char *)xmlBufferContent(buf);
-    if (!raw || xmlBufferLength(buf) == 0) {
+    int len = xmlBufferLength(buf);
+    if (len <= 0) {
         xmlBufferFree(buf);
         return NULL;
     }
 
-    size_t len = strlen(raw);
-    char *clean = malloc(len + 1);
-    if (!clean) { xmlBufferFree(buf); return NULL; }
-   
-    char *content;
-    if(strlen(content) > 2500) {
-        char *trimmed = malloc(2501);
-        if(trimmed) {
-            strncpy(trimmed, content, 2500);
-            trimmed[2500] = '\0';
-            char *last_space = strrchr(trimmed, ' ');
-            if(last_space && last_space > trimmed + 2300) {
-                *last_space = '\0';
-            }
-            free(content);
-            content = trimmed;
-        }
-    }
-
-    char *p = clean;
-    int space = 1;
-    for (size_t i = 0; i < len; i++) {
-        if (raw[i] == ' ' || raw[i] == '\t' || raw[i] == '\n' || raw[i] == '\r') {
-            if (!space) { *p++ = ' '; space = 1; }
-        } else {
-            *p++ = raw[i]; space = 0;
-        }
-    }
-    *p = '\0';
+    // The buffer is always NUL-terminated, so it has the len + 1 bytes normalize needs
+    char *raw = (char *)xmlBufferContent(buf);
+    NormOptions opt = { .max_bytes = CONTENT_MAX_BYTES, .keep_paragraphs = keep_paragraphs };
+    size_t n = text_normalize(raw, (size_t)len, &opt, stats);
+    char *clean = malloc(n + 1);
+    if (clean) memcpy(clean, raw, n + 1);
     xmlBufferFree(buf);
     return clean;
 }
 
-size_t word_count(const char *text) {
-    if (!text) return 0;
-    size_t count = 0;
-    int in_word = 0;
-    for (const char *s = text; *s; s++) {
-        if (*s == ' ' || *s == '\t' || *s == '\n') {
-            in_word = 0;
-        } else if (!in_word) {
-            in_word = 1;
-            count++;
-        }
-    }
-    return count;
+// Single pass over the page, no copies; fills per-category hits and a weighted score
+int is_relevant_content(const char *text, size_t len, RelevanceResult *rel) {
+    if (!text || !relevance_engine) return 0;
+    relevance_scan(relevance_engine, text, len, rel);
+    return rel->distinct >= 2 && rel->score >= MIN_RELEVANCE_SCORE;
 }
 
-int is_relevant_content(const char *text) {
-    if (!text) return 0;
-    char *lower = strdup(text);
-    if (!lower) return 0;
-    for (char *p = lower; *p; p++) *p = tolower(*p);
+// Persistent dedup index shared with dataset.c / pars.sh / crawl.c
+static FpIndex dedup_index;
+static uint64_t parsed_unique = 0;
 
-    int matches = 0;
-    for (size_t i = 0; i < KEYWORD_COUNT; i++) {
-        if (strstr(lower, TOPIC_KEYWORDS[i])) matches++;
-        if (matches >= 2) break;
-    }
-    free(lower);
-    return matches >= 2;
-}
-
-char *compute_sha256(const char *str) {
-    unsigned char hash[SHA256_DIGEST_LENGTH];
-    SHA256((unsigned char*)str, strlen(str), hash);
-    char *output = malloc(65);
-    if (!output) return NULL;
-    for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) {
-        sprintf(output + (i * 2), "%02x", hash[i]);
-    }
-    output[64] = '\0';
-    return output;
-}
-
-// Simple hash store for deduplication (max 1000)
-#define MAX_HASHES 1000
-static char *seen_hashes[MAX_HASHES] = {0};
-static size_t hash_count = 0;
-
-int is_duplicate(const char *content) {
-    char *hash = compute_sha256(content);
-    if (!hash) return 0;
-    for (size_t i = 0; i < hash_count; i++) {
-        if (seen_hashes[i] && strcmp(seen_hashes[i], hash) == 0) {
-            free(hash);
-            return 1;
-        }
-    }
-    if (hash_count < MAX_HASHES) {
-        seen_hashes[hash_count++] = hash;
-    } else {
-        free(hash);
-    }
-    return 0;
+// Only checks: the fingerprint is staged after the record is written and
+// committed after ds_writer_close (see fpindex.h)
+int is_duplicate(const char *content, size_t len, unsigned char fp[FPINDEX_FP_SIZE]) {
+    fpindex_fingerprint(content, len, fp);
+    return fpindex_seen_fp(&dedup_index, fp) == 1;
 }
 
 // ==================== PARSING ====================
 
-char *try_extract_content(htmlDocPtr doc, const char *xpath_expr) {
+char *try_extract_content(htmlDocPtr doc, const char *xpath_expr, int keep_paragraphs, NormStats *stats) {
     if (!xpath_expr) return NULL;
     xmlXPathContextPtr ctx = xmlXPathNewContext(doc);
     if (!ctx) return NULL;
     xmlXPathObjectPtr obj = xmlXPathEvalExpression((xmlChar*)xpath_expr, ctx);
     char *result = NULL;
     if (obj && obj->nodesetval && obj->nodesetval->nodeNr > 0) {
-        result = get_clean_text(obj->nodesetval->nodeTab[0]);
+        result = get_clean_text(obj->nodesetval->nodeTab[0], keep_paragraphs, stats);
     }
     xmlXPathFreeObject(obj);
     xmlXPathFreeContext(ctx);
     return result;
 }
 
-int parse_site(const SiteConfig *cfg, FILE *json_file, int *first) {
+int parse_site(const SiteConfig *cfg, DsWriter *out) {
     CURL *curl = curl_easy_init();
     if (!curl) return -1;
 
@@ -244,16 +197,18 @@ int parse_site(const SiteConfig *cfg, FILE *json_file, int *first) {
 
     // Title
     char *title = NULL;
+    NormStats title_stats = {0};
     if (cfg->title_xpath) {
-        title = try_extract_content(doc, cfg->title_xpath);
+        title = try_extract_content(doc, cfg->title_xpath, 0, &title_stats);
     }
-    if (!title || strlen(title) < 5) {
+    if (!title || title_stats.bytes < 5) {
         free(title);
         title = strdup("Без названия");
     }
 
     // Content: multiple strategies
     char *content = NULL;
+    NormStats stats = {0};
     const char *fallback_xpaths[] = {
         "//article//p",
         "//main//p",
@@ -265,20 +220,20 @@ int parse_site(const SiteConfig *cfg, FILE *json_file, int *first) {
     size_t n_fallback = sizeof(fallback_xpaths) / sizeof(fallback_xpaths[0]);
 
     if (cfg->content_xpath) {
-        content = try_extract_content(doc, cfg->content_xpath);
+        content = try_extract_content(doc, cfg->content_xpath, 1, &stats);
     }
-    if (!content || strlen(content) < 300) {
-        for (size_t i = 0; i < n_fallback && (!content || strlen(content) < 300); i++) {
+    if (!content || stats.bytes < 300) {
+        for (size_t i = 0; i < n_fallback && (!content || stats.bytes < 300); i++) {
             free(content);
-            content = try_extract_content(doc, fallback_xpaths[i]);
+            content = try_extract_content(doc, fallback_xpaths[i], 1, &stats);
         }
     }
-    if (!content || strlen(content) < 300) {
+    if (!content || stats.bytes < 300) {
         xmlXPathContextPtr ctx = xmlXPathNewContext(doc);
         xmlXPathObjectPtr obj = xmlXPathEvalExpression((xmlChar*)"//body", ctx);
         if (obj && obj->nodesetval && obj->nodesetval->nodeNr > 0) {
             free(content);
-            content = get_clean_text(obj->nodesetval->nodeTab[0]);
+            content = get_clean_text(obj->nodesetval->nodeTab[0], 1, &stats);
         }
         xmlXPathFreeObject(obj);
         xmlXPathFreeContext(ctx);
@@ -286,47 +241,53 @@ int parse_site(const SiteConfig *cfg, FILE *json_file, int *first) {
 
     xmlFreeDoc(doc);
 
-    if (!content || strlen(content) < 300) {
+    if (!content || stats.bytes < 300) {
         free(title); free(content);
         return 0;
     }
 
-    if (word_count(content) < 50 || !is_relevant_content(content)) {
+    RelevanceResult rel;
+    if (stats.words < 50 || !is_relevant_content(content, stats.bytes, &rel)) {
         free(title); free(content);
         return 0;
     }
 
-    if (is_duplicate(content)) {
+    unsigned char fp[FPINDEX_FP_SIZE];
+    if (is_duplicate(content, stats.bytes, fp)) {
         free(title); free(content);
         return 0;
     }
 
-    // Output
-    char *esc_title = escape_json(title);
-    char *esc_content = escape_json(content);
-    char *esc_url = escape_json(cfg->url);
-    char *esc_cat = escape_json(cfg->category);
-
-    if (!esc_title || !esc_content || !esc_url || !esc_cat) {
-        free(title); free(content);
-        free(esc_title); free(esc_content); free(esc_url); free(esc_cat);
-        return -1;
-    }
-
-    if (!*first) fprintf(json_file, ",\n");
-    *first = 0;
-
-    fprintf(json_file, "  {\n");
-    fprintf(json_file, "    \"url\": \"%s\",\n", esc_url);
-    fprintf(json_file, "    \"title\": \"%s\",\n", esc_title);
-    fprintf(json_file, "    \"category\": \"%s\",\n", esc_cat);
-    fprintf(json_file, "    \"language\": \"en\",\n");
-    fprintf(json_file, "    \"word_count\": %zu,\n", word_count(content));
-    fprintf(json_file, "    \"content\": \"%s\"\n", esc_content);
-    fprintf(json_file, "  }");
+    // Output: one JSONL record per article
+    static StrBuf rec;
+    strbuf_reset(&rec);
+    char num[32];
+    snprintf(num, sizeof(num), "%zu", stats.words);
+    int rc = 0;
+    rc |= strbuf_append_str(&rec, "{\"url\":\"");
+    rc |= json_escape_append(&rec, cfg->url, strlen(cfg->url));
+    rc |= strbuf_append_str(&rec, "\",\"title\":\"");
+    rc |= json_escape_append(&rec, title, strlen(title));
+    rc |= strbuf_append_str(&rec, "\",\"category\":\"");
+    rc |= json_escape_append(&rec, cfg->category, strlen(cfg->category));
+    rc |= strbuf_append_str(&rec, "\",\"language\":\"");
+    rc |= strbuf_append_str(&rec, langid_name(langid_detect(content, stats.bytes, NULL)));
+    rc |= strbuf_append_str(&rec, "\",\"word_count\":");
+    rc |= strbuf_append_str(&rec, num);
+    const char *topic = relevance_category_name(relevance_engine, rel.top_category);
+    char score[32];
+    snprintf(score, sizeof(score), "%.2f", rel.score);
+    rc |= strbuf_append_str(&rec, ",\"topic\":\"");
+    rc |= strbuf_append_str(&rec, topic ? topic : "");
+    rc |= strbuf_append_str(&rec, "\",\"relevance\":");
+    rc |= strbuf_append_str(&rec, score);
+    rc |= strbuf_append_str(&rec, ",\"content\":\"");
+    rc |= json_escape_append(&rec, content, stats.bytes);
+    rc |= strbuf_append_str(&rec, "\"}\n");
 
     free(title); free(content);
-    free(esc_title); free(esc_content); free(esc_url); free(esc_cat);
+    if (rc != 0 || ds_writer_write(out, rec.data, rec.len) != 0) return -1;
+    if (fpindex_stage_fp(&dedup_index, fp) == 0) parsed_unique++;
     return 1;
 }
 
@@ -390,19 +351,27 @@ static const size_t SITE_COUNT = sizeof(SITES) / sizeof(SITES[0]);
 
 int main(void) {
     printf("parse web-site 2500!\n");
-    FILE *json_file = fopen("output.json", "w");
-    if (!json_file) {
-        perror("Не удалось создать output.json");
+    if (fpindex_open(&dedup_index, NULL) != 0) {
+        fprintf(stderr, "Не удалось открыть индекс дедупликации %s\n", fpindex_default_path());
+        return EXIT_FAILURE;
+    }
+    relevance_engine = relevance_build(TOPIC_KEYWORDS, KEYWORD_COUNT);
+    if (!relevance_engine) {
+        fprintf(stderr, "Не удалось построить классификатор релевантности\n");
+        return EXIT_FAILURE;
+    }
+    DsWriterConfig wcfg = { .path = "output.jsonl", .append = 1 };
+    DsWriter *out = ds_writer_open(&wcfg);
+    if (!out) {
+        perror("Не удалось создать output.jsonl");
         return EXIT_FAILURE;
     }
-    fprintf(json_file, "[\n");
-    int first = 1;
 
     curl_global_init(CURL_GLOBAL_DEFAULT);
 
     for (size_t i = 0; i < SITE_COUNT; i++) {
         printf("Парсинг [%zu/%zu]: %s\n", i + 1, SITE_COUNT, SITES[i].url);
-        int result = parse_site(&SITES[i], json_file, &first);
+        int result = parse_site(&SITES[i], out);
         if (result > 0) {
             printf("  ✅ Успешно\n");
         } else {
@@ -412,11 +381,15 @@ int main(void) {
         nanosleep(&ts, NULL);
     }
 
-    fprintf(json_file, "\n]\n");
-    fclose(json_file);
+    if (ds_writer_close(out) != 0) perror("Ошибка записи output.jsonl");
+    else if (fpindex_commit(&dedup_index) != 0) perror("Ошибка записи индекса дедупликации");
     curl_global_cleanup();
 
-    printf("\n✅ Парсинг завершён. Результат: output.json\n");
-    printf("ℹ️  Собрано до %zu уникальных статей по C, Linux и системному программированию.\n", hash_count);
+    printf("\n✅ Парсинг завершён. Результат: output.jsonl\n");
+    printf("ℹ️  Собрано до %llu уникальных статей по C, Linux и системному программированию.\n",
+           (unsigned long long)parsed_unique);
+    printf("🧮 В индексе дедупликации: %llu отпечатков\n", (unsigned long long)fpindex_count(&dedup_index));
+    fpindex_close(&dedup_index);
+    relevance_free(relevance_engine);
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,264 @@
+// robots_test.c — проверки разбора robots.txt и сопоставления правил (../robots.h)
+// gcc -O2 -o robots_test test/robots_test.c robots.c url.c fetch_cache.c -lcurl -lcrypto -pthread
+// ./robots_test — 0, если все проверки прошли
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../robots.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                                 \
+    do {                                                                 \
+        if (!(cond)) {                                                   \
+            failures++;                                                  \
+            fprintf(stderr, "❌ %s:%d: ", __FILE__, __LINE__);           \
+            fprintf(stderr, __VA_ARGS__);                                \
+            fputc('\n', stderr);                                         \
+        }                                                                \
+    } while (0)
+
+#define UA "osdev-dataset-builder/1.0"
+
+static RobotsRules *parse(const char *txt) {
+    return robots_parse(txt, strlen(txt), UA);
+}
+
+static void expect(const char *txt, const char *path, int allowed) {
+    RobotsRules *r = parse(txt);
+    CHECK(r, "robots_parse failed");
+    if (!r) return;
+    int got = robots_rules_allowed(r, path);
+    CHECK(got == allowed, "%s: expected %s, got %s\n--- robots.txt\n%s", path,
+          allowed ? "allow" : "disallow", got ? "allow" : "disallow", txt);
+    robots_rules_free(r);
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// === Разбор ===
+
+static void test_groups(void) {
+    // Своя группа выбирается по имени продукта, "*" тогда не действует
+    const char *txt =
+        "User-agent: *\n"
+        "Disallow: /\n"
+        "\n"
+        "User-agent: osdev-dataset-builder\n"
+        "Disallow: /private\n";
+    expect(txt, "/wiki/Paging", 1);
+    expect(txt, "/private/x", 0);
+
+    // Своей группы нет — действует "*"
+    expect("User-agent: googlebot\nDisallow: /\n\nUser-agent: *\nDisallow: /tmp\n", "/wiki", 1);
+    expect("User-agent: googlebot\nDisallow: /\n\nUser-agent: *\nDisallow: /tmp\n", "/tmp/a", 0);
+
+    // Подряд идущие User-agent — одна группа; несколько подходящих групп объединяются
+    const char *merged =
+        "User-agent: other\n"
+        "User-agent: OSDEV-Dataset-Builder\n"
+        "Disallow: /a\n"
+        "\n"
+        "User-agent: osdev-dataset-builder\n"
+        "Disallow: /b\n";
+    expect(merged, "/a/1", 0);
+    expect(merged, "/b/1", 0);
+    expect(merged, "/c/1", 1);
+
+    // Комментарии, BOM, CRLF, пробелы вокруг ':' и регистр ключей
+    expect("\xEF\xBB\xBFuser-AGENT : * # всем\r\nDISALLOW:/x # нет\r\n", "/x/y", 0);
+    // Пустой Disallow ничего не запрещает, шаблон без '/' игнорируется
+    expect("User-agent: *\nDisallow:\nDisallow: junk\n", "/junk", 1);
+    // Правила до первой группы ни к кому не относятся
+    expect("Disallow: /\nUser-agent: *\nAllow: /\n", "/a", 1);
+    // Пустой файл — всё можно
+    expect("", "/anything", 1);
+}
+
+static void test_crawl_delay(void) {
+    RobotsRules *r = parse("User-agent: *\nCrawl-delay: 1.5\nDisallow: /x\n");
+    CHECK(r && robots_rules_crawl_delay_ms(r) == 1500, "Crawl-delay 1.5 → 1500 ms");
+    robots_rules_free(r);
+
+    r = parse("User-agent: *\nDisallow: /x\n");
+    CHECK(r && robots_rules_crawl_delay_ms(r) == -1, "no Crawl-delay → -1");
+    robots_rules_free(r);
+
+    r = parse("User-agent: *\nCrawl-delay: soon\n");
+    CHECK(r && robots_rules_crawl_delay_ms(r) == -1, "bad Crawl-delay ignored");
+    robots_rules_free(r);
+}
+
+static void test_fixed_policies(void) {
+    RobotsRules *all = robots_allow_all(), *none = robots_disallow_all();
+    CHECK(robots_rules_allowed(all, "/a") == 1, "allow_all");
+    CHECK(robots_rules_allowed(none, "/a") == 0, "disallow_all");
+    CHECK(robots_rules_allowed(none, "/robots.txt") == 1, "/robots.txt is always allowed");
+    CHECK(robots_rules_allowed(NULL, "/a") == 1, "NULL rules allow everything");
+    robots_rules_free(all);
+    robots_rules_free(none);
+}
+
+// === Сопоставление ===
+
+static void test_matching(void) {
+    // Самое длинное правило побеждает, при равной длине — Allow (RFC 9309, 2.2.2)
+    const char *txt =
+        "User-agent: *\n"
+        "Disallow: /wiki/\n"
+        "Allow: /wiki/Main_Page\n"
+        "Disallow: /page\n"
+        "Allow: /page\n"
+        "Disallow: /*.php$\n"
+        "Disallow: /search*q=\n"
+        "Allow: /img/*.png$\n"
+        "Disallow: /img/\n"
+        "Disallow: /fish*\n";
+    expect(txt, "/wiki/Paging", 0);
+    expect(txt, "/wiki/Main_Page", 1);
+    expect(txt, "/wiki", 1);
+    expect(txt, "/page/1", 1);
+    expect(txt, "/index.php", 0);
+    expect(txt, "/index.php?x=1", 1);          // '$' — конец пути вместе с запросом
+    expect(txt, "/a/b/index.php", 0);
+    expect(txt, "/search/?lang=en&q=kernel", 0);
+    expect(txt, "/search/?lang=en", 1);
+    expect(txt, "/img/logo.png", 1);
+    expect(txt, "/img/logo.png.txt", 0);
+    expect(txt, "/img/logo.gif", 0);
+    expect(txt, "/fish", 0);                   // '*' совпадает и с пустой строкой
+    expect(txt, "/fishheads/yummy.html", 0);
+    expect(txt, "/Fish.asp", 1);               // регистр пути важен
+
+    // Несколько звёзд подряд — одна; "/*" запрещает всё
+    expect("User-agent: *\nDisallow: /a**b\n", "/axxb", 0);
+    expect("User-agent: *\nDisallow: /*\n", "/", 0);
+    expect("User-agent: *\nDisallow: /$\n", "/", 0);
+    expect("User-agent: *\nDisallow: /$\n", "/a", 1);
+
+    // %xx в шаблоне — в той же форме, что и канонический путь (url.c)
+    expect("User-agent: *\nDisallow: /%7Euser/\n", "/~user/home", 0);
+    expect("User-agent: *\nDisallow: /a%2fb\n", "/a%2Fb", 0);
+}
+
+// Эталон: перебор с возвратами по каждому правилу отдельно (только для коротких строк)
+static int wildcard(const char *pat, size_t pl, const char *s, size_t sl, int anchored) {
+    if (pl == 0) return !anchored || sl == 0;
+    if (pat[0] == '*') {
+        for (size_t k = 0; k <= sl; k++) {
+            if (wildcard(pat + 1, pl - 1, s + k, sl - k, anchored)) return 1;
+        }
+        return 0;
+    }
+    return sl > 0 && pat[0] == s[0] && wildcard(pat + 1, pl - 1, s + 1, sl - 1, anchored);
+}
+
+static void test_random_against_reference(void) {
+    static const char ALPHABET[] = "ab/*";
+    char txt[4096], pats[8][16], path[24];
+    int allow[8], anchored[8];
+    srand(42);
+    for (int iter = 0; iter < 20000; iter++) {
+        int n = 1 + rand() % 6;
+        size_t off = (size_t)snprintf(txt, sizeof(txt), "User-agent: *\n");
+        for (int i = 0; i < n; i++) {
+            size_t len = 1 + (size_t)(rand() % 8);
+            pats[i][0] = '/';
+            for (size_t k = 1; k < len; k++) pats[i][k] = ALPHABET[rand() % 4];
+            pats[i][len] = '\0';
+            // "**" парсер сворачивает в одну звезду — эталону это безразлично
+            allow[i] = rand() % 2;
+            anchored[i] = rand() % 4 == 0;
+            off += (size_t)snprintf(txt + off, sizeof(txt) - off, "%s: %s%s\n", allow[i] ? "Allow" : "Disallow",
+                                    pats[i], anchored[i] ? "$" : "");
+        }
+        size_t plen = 1 + (size_t)(rand() % 12);
+        path[0] = '/';
+        for (size_t k = 1; k < plen; k++) path[k] = ALPHABET[rand() % 3];
+        path[plen] = '\0';
+
+        int best_len = -1, verdict = 1;
+        for (int i = 0; i < n; i++) {
+            // Длина правила — после свёртки "**"
+            char norm[16];
+            size_t nl = 0;
+            for (size_t k = 0; pats[i][k]; k++) {
+                if (pats[i][k] == '*' && nl > 0 && norm[nl - 1] == '*') continue;
+                norm[nl++] = pats[i][k];
+            }
+            if (!wildcard(norm, nl, path, plen, anchored[i])) continue;
+            if ((int)nl > best_len || ((int)nl == best_len && allow[i])) {
+                verdict = (int)nl > best_len ? allow[i] : (verdict || allow[i]);
+                best_len = (int)nl;
+            }
+        }
+        RobotsRules *r = parse(txt);
+        int got = r ? robots_rules_allowed(r, path) : -1;
+        robots_rules_free(r);
+        CHECK(got == verdict, "random #%d: %s expected %d got %d\n%s", iter, path, verdict, got, txt);
+        if (failures > 10) return;
+    }
+}
+
+// Правило с множеством звёзд против длинного пути: перебор с возвратами
+// тратил на 61 байт десятки секунд
+static void test_pathological(void) {
+    RobotsRules *r = parse("User-agent: *\n"
+                           "Disallow: /*a*a*a*a*a*a*a*b\n"
+                           "Disallow: /*a*a*a*a*a*a*a*a*a*a*a*a*a*a*a*a*c$\n");
+    CHECK(r, "robots_parse failed");
+    if (!r) return;
+    static char path[8192];
+    path[0] = '/';
+    memset(path + 1, 'a', sizeof(path) - 2);
+    path[sizeof(path) - 1] = '\0';
+    double t0 = now_sec();
+    int got = robots_rules_allowed(r, path);
+    double dt = now_sec() - t0;
+    CHECK(got == 1, "pathological path must be allowed");
+    CHECK(dt < 0.5, "pathological match took %.3f s", dt);
+    path[sizeof(path) - 2] = 'b';
+    CHECK(robots_rules_allowed(r, path) == 0, "pathological path ending in b must be disallowed");
+    robots_rules_free(r);
+}
+
+// Много правил — буферы сопоставления уже не на стеке
+static void test_many_rules(void) {
+    size_t cap = 1 << 16, off = 0;
+    char *txt = malloc(cap);
+    off += (size_t)snprintf(txt + off, cap - off, "User-agent: *\n");
+    for (int i = 0; i < 1000; i++) off += (size_t)snprintf(txt + off, cap - off, "Disallow: /dir%d/*.html$\n", i);
+    RobotsRules *r = robots_parse(txt, off, UA);
+    CHECK(r, "robots_parse failed");
+    if (r) {
+        CHECK(robots_rules_allowed(r, "/dir999/a/b.html") == 0, "rule #999");
+        CHECK(robots_rules_allowed(r, "/dir999/a/b.htm") == 1, "rule #999 anchored");
+        CHECK(robots_rules_allowed(r, "/dir1000/a.html") == 1, "no rule #1000");
+    }
+    robots_rules_free(r);
+    free(txt);
+}
+
+int main(void) {
+    test_groups();
+    test_crawl_delay();
+    test_fixed_policies();
+    test_matching();
+    test_random_against_reference();
+    test_pathological();
+    test_many_rules();
+    if (failures) {
+        fprintf(stderr, "❌ %d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("✅ robots: all checks passed\n");
+    return 0;
+}
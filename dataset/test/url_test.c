@@ -0,0 +1,152 @@
+// url_test.c — проверки канонической формы и разрешения ссылок (../url.h)
+// gcc -O2 -o url_test test/url_test.c url.c
+// ./url_test — 0, если все проверки прошли
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <string.h>
+
+#include "../url.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                                 \
+    do {                                                                 \
+        if (!(cond)) {                                                   \
+            failures++;                                                  \
+            fprintf(stderr, "❌ %s:%d: ", __FILE__, __LINE__);           \
+            fprintf(stderr, __VA_ARGS__);                                \
+            fputc('\n', stderr);                                         \
+        }                                                                \
+    } while (0)
+
+// want NULL — адрес должен быть отвергнут
+static void canon(const char *url, const char *want) {
+    char out[URL_MAX];
+    int rc = url_canonicalize(url, out, sizeof(out));
+    if (!want) {
+        CHECK(rc != 0, "%s: expected rejection, got %s", url, out);
+        return;
+    }
+    CHECK(rc == 0 && strcmp(out, want) == 0, "%s: expected %s, got %s", url, want, rc == 0 ? out : "(error)");
+}
+
+static void resolve(const char *base, const char *href, const char *want) {
+    char out[URL_MAX];
+    int rc = url_resolve(base, href, out, sizeof(out));
+    if (!want) {
+        CHECK(rc != 0, "%s + %s: expected rejection, got %s", base, href, out);
+        return;
+    }
+    CHECK(rc == 0 && strcmp(out, want) == 0, "%s + \"%s\": expected %s, got %s", base, href, want,
+          rc == 0 ? out : "(error)");
+}
+
+// === Каноническая форма ===
+
+static void test_canonicalize(void) {
+    canon("HTTP://Wiki.OSDev.org:443/./Main_Page#top", "http://wiki.osdev.org:443/Main_Page");
+    canon("https://Wiki.OSDev.org:443/Main_Page", "https://wiki.osdev.org/Main_Page");
+    canon("http://example.com:80", "http://example.com/");
+    canon("http://user:pw@example.com/a", "http://example.com/a");
+    canon("http://example.com/a?", "http://example.com/a");
+    canon("http://example.com/a?x=1#frag", "http://example.com/a?x=1");
+    canon("  http://example.com/a b\n", "http://example.com/a%20b");
+    canon("http://example.com/%7euser/%2f%41", "http://example.com/~user/%2FA");
+    canon("http://example.com/\xD0\xAF", "http://example.com/%D0%AF");
+    canon("http://[::1]:8080/x", "http://[::1]:8080/x");
+
+    // Точечные сегменты: ".." убирает ровно один сегмент
+    canon("http://example.com/a/b/../c", "http://example.com/a/c");
+    canon("http://example.com/a/b/..", "http://example.com/a/");
+    canon("http://example.com/a/b/.", "http://example.com/a/b/");
+    canon("http://example.com/a/./b/../../c", "http://example.com/c");
+    canon("http://example.com/../../a", "http://example.com/a");
+    canon("http://example.com/a/..", "http://example.com/");
+    canon("http://example.com/a//b/../c", "http://example.com/a//c");
+
+    canon("ftp://example.com/", NULL);
+    canon("mailto:x@example.com", NULL);
+    canon("http:///path", NULL);
+    canon("http://example.com:8o/", NULL);
+}
+
+// === Разрешение: примеры RFC 3986, 5.4 ===
+
+static void test_rfc_examples(void) {
+    const char *base = "http://a/b/c/d;p?q";
+
+    // 5.4.1, обычные
+    resolve(base, "g:h", NULL);               // не http(s)
+    resolve(base, "g", "http://a/b/c/g");
+    resolve(base, "./g", "http://a/b/c/g");
+    resolve(base, "g/", "http://a/b/c/g/");
+    resolve(base, "/g", "http://a/g");
+    resolve(base, "//g", "http://g/");
+    resolve(base, "?y", "http://a/b/c/d;p?y");
+    resolve(base, "g?y", "http://a/b/c/g?y");
+    resolve(base, "#s", "http://a/b/c/d;p?q");   // фрагмент отбрасывается
+    resolve(base, "g#s", "http://a/b/c/g");
+    resolve(base, "g?y#s", "http://a/b/c/g?y");
+    resolve(base, ";x", "http://a/b/c/;x");
+    resolve(base, "g;x", "http://a/b/c/g;x");
+    resolve(base, "g;x?y#s", "http://a/b/c/g;x?y");
+    resolve(base, "", "http://a/b/c/d;p?q");
+    resolve(base, ".", "http://a/b/c/");
+    resolve(base, "./", "http://a/b/c/");
+    resolve(base, "..", "http://a/b/");
+    resolve(base, "../", "http://a/b/");
+    resolve(base, "../g", "http://a/b/g");
+    resolve(base, "../..", "http://a/");
+    resolve(base, "../../", "http://a/");
+    resolve(base, "../../g", "http://a/g");
+
+    // 5.4.2, необычные
+    resolve(base, "../../../g", "http://a/g");
+    resolve(base, "../../../../g", "http://a/g");
+    resolve(base, "/./g", "http://a/g");
+    resolve(base, "/../g", "http://a/g");
+    resolve(base, "g.", "http://a/b/c/g.");
+    resolve(base, ".g", "http://a/b/c/.g");
+    resolve(base, "g..", "http://a/b/c/g..");
+    resolve(base, "..g", "http://a/b/c/..g");
+    resolve(base, "./../g", "http://a/b/g");
+    resolve(base, "./g/.", "http://a/b/c/g/");
+    resolve(base, "g/./h", "http://a/b/c/g/h");
+    resolve(base, "g/../h", "http://a/b/c/h");
+    resolve(base, "g;x=1/./y", "http://a/b/c/g;x=1/y");
+    resolve(base, "g;x=1/../y", "http://a/b/c/y");
+    resolve(base, "g?y/./x", "http://a/b/c/g?y/./x");
+    resolve(base, "g?y/../x", "http://a/b/c/g?y/../x");
+    resolve(base, "g#s/./x", "http://a/b/c/g");
+    resolve(base, "g#s/../x", "http://a/b/c/g");
+}
+
+// Ссылки, какие встречаются при обходе
+static void test_crawl_links(void) {
+    resolve("https://wiki.osdev.org/a/b/page", "../x", "https://wiki.osdev.org/a/x");
+    resolve("https://wiki.osdev.org/a/b/page", "HTTPS://Other.org/p#q", "https://other.org/p");
+    resolve("https://wiki.osdev.org", "Paging", "https://wiki.osdev.org/Paging");
+    resolve("https://wiki.osdev.org/", "  ./Paging\n", "https://wiki.osdev.org/Paging");
+}
+
+static void test_helpers(void) {
+    char host[256];
+    CHECK(url_host("https://wiki.osdev.org:8443/a?b", host, sizeof(host)) == 0 &&
+          strcmp(host, "wiki.osdev.org:8443") == 0, "url_host: got %s", host);
+    CHECK(strcmp(url_path("https://wiki.osdev.org/a/b?x=1"), "/a/b?x=1") == 0, "url_path");
+    CHECK(url_hash("abc", 3) == url_hash("abc", 3) && url_hash("abc", 3) != url_hash("abd", 3), "url_hash");
+}
+
+int main(void) {
+    test_canonicalize();
+    test_rfc_examples();
+    test_crawl_links();
+    test_helpers();
+    if (failures) {
+        fprintf(stderr, "❌ %d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("✅ url: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,449 @@
+// tokfile.c — предтокенизированный датасет (см. tokfile.h)
+
+#define _GNU_SOURCE
+#include "tokfile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define TOKW_BUFFER (1u << 20)
+
+_Static_assert(sizeof(TokFileHeader) == 128, "TokFileHeader must stay 128 bytes");
+
+static uint64_t align_up(uint64_t x) {
+    return (x + TOK_ALIGN - 1) & ~(uint64_t)(TOK_ALIGN - 1);
+}
+
+// === Чтение ===
+
+static int section_ok(const TokFile *tf, uint64_t off, uint64_t count, size_t elem) {
+    if (off % TOK_ALIGN != 0 || off > tf->map_size) return 0;
+    return count <= (tf->map_size - off) / elem;
+}
+
+int tokfile_open(TokFile *tf, const char *path) {
+    memset(tf, 0, sizeof(*tf));
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0) { close(fd); return -1; }
+    if ((size_t)st.st_size < sizeof(TokFileHeader)) {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+    tf->map = map;
+    tf->map_size = (size_t)st.st_size;
+    tf->hdr = map;
+
+    const TokFileHeader *h = tf->hdr;
+    int ok = memcmp(h->magic, TOKFILE_MAGIC, 8) == 0 && h->version == TOKFILE_VERSION &&
+             h->token_size == sizeof(int32_t) &&
+             section_ok(tf, h->tokens_off, h->n_tokens, sizeof(int32_t)) &&
+             section_ok(tf, h->masks_off, h->n_tokens, 1) &&
+             h->n_records < UINT64_MAX &&
+             section_ok(tf, h->offsets_off, h->n_records + 1, sizeof(uint64_t)) &&
+             section_ok(tf, h->meta_off, h->n_records, sizeof(TokRecordMeta)) &&
+             section_ok(tf, h->strings_off, h->strings_size, 1) &&
+             (uint64_t)h->n_strings + 1 <= h->strings_size / sizeof(uint32_t);
+    if (ok) {
+        tf->tokens = (const int32_t *)(tf->map + h->tokens_off);
+        tf->masks = tf->map + h->masks_off;
+        tf->offsets = (const uint64_t *)(tf->map + h->offsets_off);
+        tf->meta = (const TokRecordMeta *)(tf->map + h->meta_off);
+        tf->string_offsets = (const uint32_t *)(tf->map + h->strings_off);
+        tf->string_data = (const char *)(tf->string_offsets + h->n_strings + 1);
+        size_t data_size = h->strings_size - (h->n_strings + 1) * sizeof(uint32_t);
+        ok = tf->offsets[h->n_records] == h->n_tokens &&
+             tf->string_offsets[h->n_strings] <= data_size &&
+             (data_size == 0 || tf->string_data[data_size - 1] == '\0');
+    }
+    if (!ok) {
+        tokfile_close(tf);
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+void tokfile_close(TokFile *tf) {
+    if (tf->map) munmap((void *)tf->map, tf->map_size);
+    memset(tf, 0, sizeof(*tf));
+}
+
+int tokfile_get(const TokFile *tf, uint64_t i, TokRecord *rec) {
+    if (i >= tokfile_count(tf)) return -1;
+    uint64_t start = tf->offsets[i], end = tf->offsets[i + 1];
+    if (start > end || end > tf->hdr->n_tokens) return -1;
+    rec->tokens = tf->tokens + start;
+    rec->masks = tf->masks + start;
+    rec->n_tokens = (size_t)(end - start);
+    rec->source = tokfile_string(tf, tf->meta[i].source);
+    rec->category = tokfile_string(tf, tf->meta[i].category);
+    return 0;
+}
+
+const char *tokfile_string(const TokFile *tf, uint32_t id) {
+    if (!tf->hdr || id >= tf->hdr->n_strings) return "";
+    return tf->string_data + tf->string_offsets[id];
+}
+
+uint64_t *tokfile_shuffle(uint64_t n, uint64_t seed) {
+    uint64_t *order = malloc((n ? n : 1) * sizeof(*order));
+    if (!order) return NULL;
+    for (uint64_t i = 0; i < n; i++) order[i] = i;
+    uint64_t s = seed ^ 0x9e3779b97f4a7c15ULL;
+    for (uint64_t i = n; i > 1; i--) {
+        // splitmix64
+        uint64_t z = (s += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        z ^= z >> 31;
+        uint64_t j = (uint64_t)(((unsigned __int128)z * i) >> 64);
+        uint64_t t = order[i - 1]; order[i - 1] = order[j]; order[j] = t;
+    }
+    return order;
+}
+
+// === Упаковка ===
+
+void tokpack_init(TokPacker *p, const TokFile *tf, const uint64_t *order,
+                  size_t seq_len, int32_t pad_token, int split) {
+    memset(p, 0, sizeof(*p));
+    p->tf = tf;
+    p->order = order;
+    p->seq_len = seq_len;
+    p->pad_token = pad_token;
+    p->split = split;
+}
+
+size_t tokpack_next(TokPacker *p, TokSequence *seq) {
+    uint64_t n = tokfile_count(p->tf);
+    size_t fill = 0;
+    uint32_t segment = 0;
+
+    while (fill < p->seq_len && p->next < n) {
+        TokRecord r;
+        uint64_t idx = p->order ? p->order[p->next] : p->next;
+        if (tokfile_get(p->tf, idx, &r) != 0 || r.n_tokens <= p->pos) {
+            p->next++;
+            p->pos = 0;
+            continue;
+        }
+        size_t avail = r.n_tokens - p->pos;
+        size_t room = p->seq_len - fill;
+        if (!p->split) {
+            if (avail > p->seq_len) avail = p->seq_len;
+            if (avail > room) break;   // fill > 0: запись уйдёт в следующую последовательность
+        }
+        size_t take = avail < room ? avail : room;
+        segment++;
+        memcpy(seq->tokens + fill, r.tokens + p->pos, take * sizeof(int32_t));
+        for (size_t k = 0; k < take; k++) {
+            seq->loss[fill + k] = (r.masks[p->pos + k] & TOK_LOSS) != 0;
+            seq->positions[fill + k] = (int32_t)(p->pos + k);
+            seq->segments[fill + k] = segment;
+        }
+        fill += take;
+        if (p->split && take < avail) {
+            p->pos += take;
+        } else {
+            p->next++;
+            p->pos = 0;
+        }
+    }
+
+    for (size_t k = fill; fill > 0 && k < p->seq_len; k++) {
+        seq->tokens[k] = p->pad_token;
+        seq->loss[k] = 0;
+        seq->positions[k] = 0;
+        seq->segments[k] = 0;
+    }
+    return fill;
+}
+
+// === Запись ===
+
+typedef struct {
+    int fd;
+    unsigned char *buf;
+    size_t len;
+    uint64_t written;
+} TokOut;
+
+struct TokWriter {
+    char *path;
+    char *tmp_path;
+    char *masks_path;          // маски копятся в отдельном файле и дописываются в конце
+    TokOut tokens;
+    TokOut masks;
+    TokFileHeader hdr;
+
+    uint64_t *offsets;
+    TokRecordMeta *meta;
+    size_t rec_cap;
+
+    // Таблица строк: открытая адресация id+1 по хэшу
+    char *strings;
+    size_t strings_len, strings_cap;
+    uint32_t *string_offsets;
+    uint32_t n_strings, string_offsets_cap;
+    uint32_t *slots;
+    uint32_t slot_count;
+    int failed;
+};
+
+static int out_flush(TokOut *o) {
+    size_t done = 0;
+    while (done < o->len) {
+        ssize_t n = write(o->fd, o->buf + done, o->len - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        done += (size_t)n;
+    }
+    o->written += o->len;
+    o->len = 0;
+    return 0;
+}
+
+static int out_write(TokOut *o, const void *data, size_t len) {
+    const unsigned char *p = data;
+    while (len > 0) {
+        size_t n = TOKW_BUFFER - o->len;
+        if (n > len) n = len;
+        memcpy(o->buf + o->len, p, n);
+        o->len += n;
+        p += n;
+        len -= n;
+        if (o->len == TOKW_BUFFER && out_flush(o) != 0) return -1;
+    }
+    return 0;
+}
+
+static int out_pad(TokOut *o) {
+    static const unsigned char zero[TOK_ALIGN];
+    uint64_t pos = o->written + o->len;
+    return out_write(o, zero, (size_t)(align_up(pos) - pos));
+}
+
+static char *path_with(const char *path, const char *suffix) {
+    size_t n = strlen(path) + strlen(suffix) + 1;
+    char *p = malloc(n);
+    if (p) snprintf(p, n, "%s%s", path, suffix);
+    return p;
+}
+
+TokWriter *tokwriter_open(const char *path, uint32_t n_vocab, uint64_t vocab_hash) {
+    TokWriter *w = calloc(1, sizeof(*w));
+    if (!w) return NULL;
+    w->tokens.fd = w->masks.fd = -1;
+    w->path = strdup(path);
+    w->tmp_path = path_with(path, ".tmp");
+    w->masks_path = path_with(path, ".masks.tmp");
+    w->tokens.buf = malloc(TOKW_BUFFER);
+    w->masks.buf = malloc(TOKW_BUFFER);
+    w->slot_count = 1024;
+    w->slots = calloc(w->slot_count, sizeof(*w->slots));
+    if (!w->path || !w->tmp_path || !w->masks_path || !w->tokens.buf || !w->masks.buf || !w->slots) {
+        tokwriter_abort(w);
+        return NULL;
+    }
+    w->tokens.fd = open(w->tmp_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    w->masks.fd = open(w->masks_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (w->tokens.fd < 0 || w->masks.fd < 0) {
+        tokwriter_abort(w);
+        return NULL;
+    }
+    memcpy(w->hdr.magic, TOKFILE_MAGIC, 8);
+    w->hdr.version = TOKFILE_VERSION;
+    w->hdr.token_size = sizeof(int32_t);
+    w->hdr.n_vocab = n_vocab;
+    w->hdr.vocab_hash = vocab_hash;
+    w->hdr.tokens_off = align_up(sizeof(TokFileHeader));
+    // Заголовок пишется последним; до тех пор на его месте нули
+    static const unsigned char zero[TOK_ALIGN * 4];
+    if (out_write(&w->tokens, zero, (size_t)w->hdr.tokens_off) != 0) {
+        tokwriter_abort(w);
+        return NULL;
+    }
+    return w;
+}
+
+static uint64_t str_hash(const char *s, size_t len) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++) h = (h ^ (unsigned char)s[i]) * 0x100000001b3ULL;
+    return h;
+}
+
+static int slots_grow(TokWriter *w) {
+    uint32_t count = w->slot_count * 2;
+    uint32_t *slots = calloc(count, sizeof(*slots));
+    if (!slots) return -1;
+    for (uint32_t id = 0; id < w->n_strings; id++) {
+        const char *s = w->strings + w->string_offsets[id];
+        uint32_t i = (uint32_t)str_hash(s, strlen(s)) & (count - 1);
+        while (slots[i]) i = (i + 1) & (count - 1);
+        slots[i] = id + 1;
+    }
+    free(w->slots);
+    w->slots = slots;
+    w->slot_count = count;
+    return 0;
+}
+
+// id строки в таблице (повторы не дублируются); UINT32_MAX при ошибке
+static uint32_t intern(TokWriter *w, const char *s) {
+    if (!s) s = "";
+    size_t len = strlen(s);
+    uint32_t mask = w->slot_count - 1;
+    uint32_t i = (uint32_t)str_hash(s, len) & mask;
+    for (; w->slots[i]; i = (i + 1) & mask) {
+        const char *t = w->strings + w->string_offsets[w->slots[i] - 1];
+        if (strcmp(s, t) == 0) return w->slots[i] - 1;
+    }
+    if (w->strings_len + len + 1 > UINT32_MAX || w->n_strings + 1 >= UINT32_MAX) return UINT32_MAX;
+    if (w->strings_len + len + 1 > w->strings_cap) {
+        size_t cap = w->strings_cap ? w->strings_cap * 2 : 4096;
+        while (cap < w->strings_len + len + 1) cap *= 2;
+        char *p = realloc(w->strings, cap);
+        if (!p) return UINT32_MAX;
+        w->strings = p;
+        w->strings_cap = cap;
+    }
+    if (w->n_strings + 2 > w->string_offsets_cap) {
+        uint32_t cap = w->string_offsets_cap ? w->string_offsets_cap * 2 : 256;
+        uint32_t *p = realloc(w->string_offsets, cap * sizeof(*p));
+        if (!p) return UINT32_MAX;
+        w->string_offsets = p;
+        w->string_offsets_cap = cap;
+    }
+    uint32_t id = w->n_strings++;
+    w->string_offsets[id] = (uint32_t)w->strings_len;
+    memcpy(w->strings + w->strings_len, s, len + 1);
+    w->strings_len += len + 1;
+    w->slots[i] = id + 1;
+    if ((uint64_t)w->n_strings * 10 > (uint64_t)w->slot_count * 7 && slots_grow(w) != 0) return UINT32_MAX;
+    return id;
+}
+
+int tokwriter_add(TokWriter *w, const int32_t *tokens, const uint8_t *masks, size_t n,
+                  const char *source, const char *category) {
+    if (w->failed) return -1;
+    if (w->hdr.n_records + 1 >= w->rec_cap) {
+        size_t cap = w->rec_cap ? w->rec_cap * 2 : 4096;
+        uint64_t *o = realloc(w->offsets, cap * sizeof(*o));
+        if (o) w->offsets = o;
+        TokRecordMeta *m = o ? realloc(w->meta, cap * sizeof(*m)) : NULL;
+        if (!m) { w->failed = 1; return -1; }
+        w->meta = m;
+        w->rec_cap = cap;
+    }
+    TokRecordMeta meta = { intern(w, source), intern(w, category) };
+    if (meta.source == UINT32_MAX || meta.category == UINT32_MAX ||
+        out_write(&w->tokens, tokens, n * sizeof(int32_t)) != 0 ||
+        out_write(&w->masks, masks, n) != 0) {
+        w->failed = 1;
+        return -1;
+    }
+    w->offsets[w->hdr.n_records] = w->hdr.n_tokens;
+    w->meta[w->hdr.n_records] = meta;
+    w->hdr.n_records++;
+    w->hdr.n_tokens += n;
+    return 0;
+}
+
+// Маски из временного файла — в хвост основного
+static int copy_masks(TokWriter *w) {
+    if (out_flush(&w->masks) != 0) return -1;
+    off_t in_off = 0;
+    uint64_t left = w->masks.written;
+    while (left > 0) {
+        ssize_t n = pread(w->masks.fd, w->masks.buf, left < TOKW_BUFFER ? (size_t)left : TOKW_BUFFER, in_off);
+        if (n <= 0) return -1;
+        if (out_write(&w->tokens, w->masks.buf, (size_t)n) != 0) return -1;
+        in_off += n;
+        left -= (uint64_t)n;
+    }
+    return 0;
+}
+
+int tokwriter_close(TokWriter *w) {
+    if (!w) return -1;
+    TokOut *o = &w->tokens;
+    TokFileHeader *h = &w->hdr;
+    int rc = w->failed ? -1 : 0;
+
+    if (rc == 0) {
+        rc |= out_pad(o);
+        h->masks_off = o->written + o->len;
+        rc |= copy_masks(w);
+        rc |= out_pad(o);
+        h->offsets_off = o->written + o->len;
+        if (w->offsets) w->offsets[h->n_records] = h->n_tokens;
+        rc |= out_write(o, w->offsets ? (const void *)w->offsets : (const void *)&h->n_tokens,
+                        (size_t)(h->n_records + 1) * sizeof(uint64_t));
+        rc |= out_pad(o);
+        h->meta_off = o->written + o->len;
+        if (h->n_records) rc |= out_write(o, w->meta, (size_t)h->n_records * sizeof(TokRecordMeta));
+        rc |= out_pad(o);
+        h->strings_off = o->written + o->len;
+        h->n_strings = w->n_strings;
+        uint32_t end = (uint32_t)w->strings_len;
+        if (w->n_strings) rc |= out_write(o, w->string_offsets, w->n_strings * sizeof(uint32_t));
+        rc |= out_write(o, &end, sizeof(end));
+        if (w->strings_len) rc |= out_write(o, w->strings, w->strings_len);
+        h->strings_size = o->written + o->len - h->strings_off;
+        rc |= out_pad(o);
+        rc |= out_flush(o);
+    }
+    if (rc == 0 && (pwrite(o->fd, h, sizeof(*h), 0) != (ssize_t)sizeof(*h) || fsync(o->fd) != 0)) rc = -1;
+    if (rc == 0 && rename(w->tmp_path, w->path) != 0) rc = -1;
+    if (rc != 0) unlink(w->tmp_path);
+
+    unlink(w->masks_path);
+    close(o->fd);
+    close(w->masks.fd);
+    o->fd = w->masks.fd = -1;
+    free(w->tmp_path);
+    w->tmp_path = NULL;
+    tokwriter_abort(w);
+    return rc;
+}
+
+void tokwriter_abort(TokWriter *w) {
+    if (!w) return;
+    if (w->tokens.fd >= 0) close(w->tokens.fd);
+    if (w->masks.fd >= 0) close(w->masks.fd);
+    if (w->tmp_path) unlink(w->tmp_path);
+    if (w->masks_path) unlink(w->masks_path);
+    free(w->path);
+    free(w->tmp_path);
+    free(w->masks_path);
+    free(w->tokens.buf);
+    free(w->masks.buf);
+    free(w->offsets);
+    free(w->meta);
+    free(w->strings);
+    free(w->string_offsets);
+    free(w->slots);
+    free(w);
+}
+
+uint64_t tokwriter_records(const TokWriter *w) {
+    return w->hdr.n_records;
+}
+
+uint64_t tokwriter_tokens(const TokWriter *w) {
+    return w->hdr.n_tokens;
+}
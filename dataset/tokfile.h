@@ -0,0 +1,137 @@
+// tokfile.h — предтокенизированный датасет для обучения
+//
+// Один файл, отображаемый через mmap без разбора и копирования:
+//   TokFileHeader (128 байт)
+//   tokens   — int32 (llama_token) всех записей подряд
+//   masks    — по байту на токен: роль (TOK_ROLE_*) | TOK_LOSS
+//   offsets  — uint64 × (n_records + 1): начало записи i в токенах
+//   meta     — TokRecordMeta × n_records: id строк source и category
+//   strings  — uint32 × (n_strings + 1) смещений + байты строк с '\0'
+// Секции выровнены на TOK_ALIGN. Токены получены словарём той модели,
+// что грузит bot.c (n_vocab и хэш словаря в заголовке); loss-маска
+// отмечает ответы ассистента вместе с их <|eot_id|>.
+// Пишет pretok.c (pretok_dataset); читатель — tokfile_open/tokfile_get
+// и упаковщик последовательностей tokpack_*.
+
+#ifndef TOKFILE_H
+#define TOKFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TOKFILE_MAGIC "OXTOKDS1"
+#define TOKFILE_VERSION 1
+#define TOK_ALIGN 64
+
+#define TOK_ROLE_SYSTEM 0
+#define TOK_ROLE_USER 1
+#define TOK_ROLE_ASSISTANT 2
+#define TOK_ROLE_OTHER 3           // tool и прочие роли
+#define TOK_ROLE_MASK 0x03
+#define TOK_LOSS 0x80
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t token_size;       // sizeof(llama_token)
+    uint64_t n_records;
+    uint64_t n_tokens;
+    uint32_t n_strings;
+    uint32_t n_vocab;
+    uint64_t vocab_hash;       // FNV-1a по текстам токенов словаря
+    uint64_t tokens_off;
+    uint64_t masks_off;
+    uint64_t offsets_off;
+    uint64_t meta_off;
+    uint64_t strings_off;
+    uint64_t strings_size;
+    uint8_t reserved[32];
+} TokFileHeader;
+
+typedef struct {
+    uint32_t source;
+    uint32_t category;
+} TokRecordMeta;
+
+typedef struct {
+    const TokFileHeader *hdr;
+    const unsigned char *map;
+    size_t map_size;
+    const int32_t *tokens;
+    const uint8_t *masks;
+    const uint64_t *offsets;
+    const TokRecordMeta *meta;
+    const uint32_t *string_offsets;
+    const char *string_data;
+} TokFile;
+
+typedef struct {
+    const int32_t *tokens;     // указатели внутрь mmap
+    const uint8_t *masks;
+    size_t n_tokens;
+    const char *source;
+    const char *category;
+} TokRecord;
+
+// === Чтение ===
+
+// 0 или -1 (errno: EINVAL — не тот формат или повреждённые секции)
+int tokfile_open(TokFile *tf, const char *path);
+void tokfile_close(TokFile *tf);
+
+static inline uint64_t tokfile_count(const TokFile *tf) {
+    return tf->hdr ? tf->hdr->n_records : 0;
+}
+
+// Запись i без копирования; 0 или -1 вне диапазона
+int tokfile_get(const TokFile *tf, uint64_t i, TokRecord *rec);
+const char *tokfile_string(const TokFile *tf, uint32_t id);
+
+// Перестановка 0..n-1 (Фишер — Йейтс) для порядка эпохи; malloc или NULL
+uint64_t *tokfile_shuffle(uint64_t n, uint64_t seed);
+
+// === Упаковка в последовательности фиксированной длины ===
+// Записи идут подряд в порядке order (NULL — по номерам). Без split запись
+// целиком переносится в следующую последовательность, если не помещается
+// в остаток (хвост добивается pad_token с нулевой маской), а длиннее
+// seq_len — обрезается. С split поток токенов режется ровно по seq_len.
+
+typedef struct {
+    const TokFile *tf;
+    const uint64_t *order;
+    size_t seq_len;
+    int32_t pad_token;
+    int split;
+
+    uint64_t next;             // следующая запись
+    size_t pos;                // уже отданные токены текущей записи (split)
+} TokPacker;
+
+typedef struct {
+    int32_t *tokens;           // seq_len
+    uint8_t *loss;             // 0/1 — считать ли loss на токене
+    int32_t *positions;        // позиция внутри своей записи (для RoPE)
+    uint32_t *segments;        // номер записи в последовательности с 1; 0 — паддинг
+} TokSequence;
+
+void tokpack_init(TokPacker *p, const TokFile *tf, const uint64_t *order,
+                  size_t seq_len, int32_t pad_token, int split);
+// Заполняет seq (буферы на seq_len элементов); число реальных токенов, 0 — записи кончились
+size_t tokpack_next(TokPacker *p, TokSequence *seq);
+
+// === Запись ===
+
+typedef struct TokWriter TokWriter;
+
+// Пишет во временный файл рядом с path, при закрытии — атомарный rename
+TokWriter *tokwriter_open(const char *path, uint32_t n_vocab, uint64_t vocab_hash);
+int tokwriter_add(TokWriter *w, const int32_t *tokens, const uint8_t *masks, size_t n,
+                  const char *source, const char *category);
+// 0 или -1; writer освобождается в любом случае
+int tokwriter_close(TokWriter *w);
+void tokwriter_abort(TokWriter *w);
+
+uint64_t tokwriter_records(const TokWriter *w);
+uint64_t tokwriter_tokens(const TokWriter *w);
+
+#endif // TOKFILE_H
@@ -0,0 +1,225 @@
+// url.c — каноническая форма URL (см. url.h)
+
+#include "url.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+
+typedef struct {
+    char *p;
+    size_t len;
+    size_t cap;
+    int overflow;
+} OutBuf;
+
+static inline void put(OutBuf *o, char c) {
+    if (o->len + 1 < o->cap) o->p[o->len++] = c;
+    else o->overflow = 1;
+}
+
+static inline void put_n(OutBuf *o, const char *s, size_t n) {
+    for (size_t i = 0; i < n; i++) put(o, s[i]);
+}
+
+static inline int hexval(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static inline int is_unreserved(unsigned char c) {
+    return isalnum(c) || c == '-' || c == '.' || c == '_' || c == '~';
+}
+
+// Путь или запрос с нормализацией %XX
+static void put_encoded(OutBuf *o, const char *s, size_t n) {
+    static const char HEX[] = "0123456789ABCDEF";
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c == '%' && i + 2 < n && hexval(s[i + 1]) >= 0 && hexval(s[i + 2]) >= 0) {
+            unsigned char v = (unsigned char)(hexval(s[i + 1]) * 16 + hexval(s[i + 2]));
+            if (is_unreserved(v)) put(o, (char)v);
+            else { put(o, '%'); put(o, HEX[v >> 4]); put(o, HEX[v & 15]); }
+            i += 2;
+        } else if (c <= 0x20 || c >= 0x7F || c == '"' || c == '<' || c == '>' || c == '`' ||
+                   c == '{' || c == '}' || c == '|' || c == '\\' || c == '^' || c == '%') {
+            put(o, '%'); put(o, HEX[c >> 4]); put(o, HEX[c & 15]);
+        } else {
+            put(o, (char)c);
+        }
+    }
+}
+
+// RFC 3986, 5.2.4: раскрытие "." и ".." на месте; path начинается с '/'
+static size_t remove_dot_segments(char *path, size_t len) {
+    size_t w = 0;
+    size_t i = 0;
+    while (i < len) {
+        // i указывает на '/'
+        size_t seg = i + 1;
+        size_t end = seg;
+        while (end < len && path[end] != '/') end++;
+        size_t seg_len = end - seg;
+        int last = end >= len;
+        if (seg_len == 1 && path[seg] == '.') {
+            if (last) path[w++] = '/';
+        } else if (seg_len == 2 && path[seg] == '.' && path[seg + 1] == '.') {
+            // Убирается только последний сегмент вывода вместе с его '/'
+            while (w > 0 && path[w - 1] != '/') w--;
+            if (w > 0) w--;
+            if (last) path[w++] = '/';
+        } else {
+            memmove(path + w, path + i, end - i);
+            w += end - i;
+        }
+        i = end;
+    }
+    if (w == 0) path[w++] = '/';
+    return w;
+}
+
+int url_canonicalize(const char *url, char *out, size_t out_size) {
+    while (*url == ' ' || *url == '\t' || *url == '\n' || *url == '\r') url++;
+    size_t n = strlen(url);
+    while (n > 0 && (url[n - 1] == ' ' || url[n - 1] == '\t' || url[n - 1] == '\n' || url[n - 1] == '\r')) n--;
+
+    int https;
+    size_t pos;
+    if (n >= 7 && strncasecmp(url, "http://", 7) == 0) { https = 0; pos = 7; }
+    else if (n >= 8 && strncasecmp(url, "https://", 8) == 0) { https = 1; pos = 8; }
+    else return -1;
+
+    // Авторитет: [userinfo@]host[:port]
+    size_t auth_end = pos;
+    while (auth_end < n && url[auth_end] != '/' && url[auth_end] != '?' && url[auth_end] != '#') auth_end++;
+    size_t host_start = pos;
+    for (size_t i = pos; i < auth_end; i++) {
+        if (url[i] == '@') host_start = i + 1;
+    }
+    size_t host_end = auth_end;
+    size_t port_start = 0;
+    // ':' после ']' (IPv6) или без скобок
+    for (size_t i = auth_end; i > host_start; i--) {
+        if (url[i - 1] == ']') break;
+        if (url[i - 1] == ':') { host_end = i - 1; port_start = i; break; }
+    }
+    if (host_end == host_start) return -1;
+
+    OutBuf o = { out, 0, out_size, 0 };
+    put_n(&o, https ? "https://" : "http://", https ? 8 : 7);
+    for (size_t i = host_start; i < host_end; i++) put(&o, (char)tolower((unsigned char)url[i]));
+    if (port_start) {
+        size_t plen = auth_end - port_start;
+        for (size_t i = port_start; i < auth_end; i++) {
+            if (!isdigit((unsigned char)url[i])) return -1;
+        }
+        int is_default = (plen == 2 && !https && memcmp(url + port_start, "80", 2) == 0) ||
+                         (plen == 3 && https && memcmp(url + port_start, "443", 3) == 0);
+        if (plen > 0 && !is_default) {
+            put(&o, ':');
+            put_n(&o, url + port_start, plen);
+        }
+    }
+
+    // Путь
+    size_t path_start = auth_end;
+    size_t path_end = path_start;
+    while (path_end < n && url[path_end] != '?' && url[path_end] != '#') path_end++;
+    size_t path_out = o.len;
+    if (path_end == path_start || url[path_start] != '/') put(&o, '/');
+    put_encoded(&o, url + path_start, path_end - path_start);
+    if (o.overflow) return -1;
+    o.len = path_out + remove_dot_segments(o.p + path_out, o.len - path_out);
+
+    // Запрос (фрагмент отбрасывается)
+    if (path_end < n && url[path_end] == '?') {
+        size_t q_end = path_end + 1;
+        while (q_end < n && url[q_end] != '#') q_end++;
+        if (q_end > path_end + 1) {
+            put(&o, '?');
+            put_encoded(&o, url + path_end + 1, q_end - path_end - 1);
+        }
+    }
+    if (o.overflow) return -1;
+    out[o.len] = '\0';
+    return 0;
+}
+
+// Длина "scheme:" у абсолютной ссылки, 0 — относительная
+static size_t scheme_len(const char *s) {
+    if (!isalpha((unsigned char)s[0])) return 0;
+    size_t i = 1;
+    while (isalnum((unsigned char)s[i]) || s[i] == '+' || s[i] == '-' || s[i] == '.') i++;
+    return s[i] == ':' ? i + 1 : 0;
+}
+
+int url_resolve(const char *base, const char *href, char *out, size_t out_size) {
+    while (*href == ' ' || *href == '\t' || *href == '\n' || *href == '\r') href++;
+    if (*href == '\0' || *href == '#') return url_canonicalize(base, out, out_size);
+    if (scheme_len(href)) return url_canonicalize(href, out, out_size);
+
+    char buf[URL_MAX * 2];
+    const char *rest = strstr(base, "://");
+    if (!rest) return -1;
+    size_t origin_len = (size_t)(rest + 3 - base);
+    while (base[origin_len] && base[origin_len] != '/' && base[origin_len] != '?') origin_len++;
+    int len;
+
+    if (href[0] == '/' && href[1] == '/') {
+        len = snprintf(buf, sizeof(buf), "%.*s%s", (int)(rest + 1 - base), base, href);
+    } else if (href[0] == '/') {
+        len = snprintf(buf, sizeof(buf), "%.*s%s", (int)origin_len, base, href);
+    } else if (href[0] == '?') {
+        size_t path_end = strcspn(base, "?#");
+        len = snprintf(buf, sizeof(buf), "%.*s%s", (int)path_end, base, href);
+    } else {
+        // Каталог базового пути: всё до последнего '/' перед запросом
+        size_t path_end = strcspn(base, "?#");
+        size_t dir_end = path_end;
+        while (dir_end > origin_len && base[dir_end - 1] != '/') dir_end--;
+        if (dir_end <= origin_len) {
+            len = snprintf(buf, sizeof(buf), "%.*s/%s", (int)origin_len, base, href);
+        } else {
+            len = snprintf(buf, sizeof(buf), "%.*s%s", (int)dir_end, base, href);
+        }
+    }
+    if (len < 0 || (size_t)len >= sizeof(buf)) return -1;
+    return url_canonicalize(buf, out, out_size);
+}
+
+int url_host(const char *url, char *host, size_t host_size) {
+    const char *p = strstr(url, "://");
+    if (!p) return -1;
+    p += 3;
+    size_t n = strcspn(p, "/?#");
+    if (n == 0 || n >= host_size) return -1;
+    memcpy(host, p, n);
+    host[n] = '\0';
+    return 0;
+}
+
+const char *url_path(const char *url) {
+    const char *p = strstr(url, "://");
+    if (!p) return url;
+    p += 3;
+    p += strcspn(p, "/?#");
+    return *p ? p : "/";
+}
+
+// FNV-1a с финальным перемешиванием (splitmix64) — равномернее в младших битах
+uint64_t url_hash(const char *s, size_t len) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 0x100000001b3ULL;
+    }
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
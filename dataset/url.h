@@ -0,0 +1,36 @@
+// url.h — каноническая форма URL для обхода сайтов
+//
+// Одна и та же страница встречается в ссылках в разном виде
+// (HTTP://Wiki.OSDev.org:443/./Main_Page#top, относительные пути, %7e/~).
+// url_canonicalize приводит адрес к единому виду:
+//   - схема и хост в нижнем регистре, порт по умолчанию убран;
+//   - userinfo и фрагмент отброшены, пустой путь → "/", пустой "?" убран;
+//   - сегменты "." и ".." раскрыты;
+//   - %XX в верхнем регистре, незарезервированные символы раскодированы,
+//     пробелы и не-ASCII байты закодированы.
+// Поддерживаются только http и https.
+
+#ifndef URL_H
+#define URL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define URL_MAX 2048
+
+// 0 — успех, -1 — не http(s), некорректный адрес или не влезает в out
+int url_canonicalize(const char *url, char *out, size_t out_size);
+
+// href относительно base (base уже канонический); результат канонический
+int url_resolve(const char *base, const char *href, char *out, size_t out_size);
+
+// host[:port] канонического URL; 0 или -1
+int url_host(const char *url, char *host, size_t host_size);
+
+// Путь с запросом ("/a/b?x=1") канонического URL — указатель внутрь url
+const char *url_path(const char *url);
+
+// 64-битный хэш строки для множеств посещённых адресов
+uint64_t url_hash(const char *s, size_t len);
+
+#endif // URL_H
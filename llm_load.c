@@ -0,0 +1,249 @@
+// llm_load.c — холодный старт модели по фазам (см. llm_load.h)
+
+#define _GNU_SOURCE
+#include "llm_load.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#define WARMUP_CTX 512
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+// Доля страниц отображения, уже лежащих в памяти; -1 — mincore недоступен
+static double resident_fraction(void *map, size_t size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t pages = (size + page - 1) / page;
+    unsigned char *vec = malloc(pages);
+    if (!vec) return -1;
+    double frac = -1;
+    if (mincore(map, size, vec) == 0) {
+        size_t in = 0;
+        for (size_t i = 0; i < pages; i++) in += vec[i] & 1;
+        frac = pages ? (double)in / (double)pages : 1.0;
+    }
+    free(vec);
+    return frac;
+}
+
+// Размер явной hugepage из /proc/meminfo, байт; 0 — неизвестен
+static size_t hugepage_size(void) {
+    FILE *f = fopen("/proc/meminfo", "r");
+    if (!f) return 0;
+    char line[256];
+    size_t kb = 0;
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "Hugepagesize:", 13) == 0) {
+            kb = strtoull(line + 13, NULL, 10);
+            break;
+        }
+    }
+    fclose(f);
+    return kb * 1024;
+}
+
+// Копия GGUF в hugetlbfs: на таком файле write() не работает, поэтому
+// размер округляется до hugepage, файл отображается и заполняется read().
+// Хвост из нулей за концом GGUF загрузчику не мешает (смещения тензоров
+// берутся из заголовка). Копия пишется в dst.tmp.<pid> и переименовывается:
+// прерванная копия не выглядит готовой, а процесс, уже отобразивший прежнюю,
+// читает её дальше. 0 — stats->path указывает на копию
+static int stage_hugetlbfs(const char *src, const char *dir, const struct stat *src_st, LlmLoadStats *stats) {
+    size_t hpage = hugepage_size();
+    if (!hpage) {
+        fprintf(stderr, "⚠️ hugetlbfs: размер hugepage неизвестен\n");
+        return -1;
+    }
+    const char *base = strrchr(src, '/');
+    base = base ? base + 1 : src;
+    char dst[sizeof(stats->path)], tmp[sizeof(stats->path) + 32];
+    if (snprintf(dst, sizeof(dst), "%s/%s", dir, base) >= (int)sizeof(dst)) return -1;
+    snprintf(tmp, sizeof(tmp), "%s.tmp.%ld", dst, (long)getpid());
+    size_t size = ((size_t)src_st->st_size + hpage - 1) / hpage * hpage;
+
+    struct stat st;
+    if (stat(dst, &st) == 0 && (size_t)st.st_size == size && st.st_mtime >= src_st->st_mtime) {
+        snprintf(stats->path, sizeof(stats->path), "%s", dst);
+        stats->staged = 1;
+        return 0;
+    }
+
+    int in = open(src, O_RDONLY);
+    if (in < 0) return -1;
+    int out = open(tmp, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (out < 0) {
+        fprintf(stderr, "⚠️ hugetlbfs: %s: %s\n", tmp, strerror(errno));
+        close(in);
+        return -1;
+    }
+    int rc = -1;
+    char *map = MAP_FAILED;
+    if (ftruncate(out, (off_t)size) != 0) {
+        fprintf(stderr, "⚠️ hugetlbfs: не хватает hugepages на %zu МБ (vm.nr_hugepages)\n", size >> 20);
+        goto done;
+    }
+    map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, out, 0);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "⚠️ hugetlbfs: mmap: %s\n", strerror(errno));
+        goto done;
+    }
+    size_t done_bytes = 0;
+    while (done_bytes < (size_t)src_st->st_size) {
+        ssize_t n = read(in, map + done_bytes, (size_t)src_st->st_size - done_bytes);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) goto done;
+        done_bytes += (size_t)n;
+    }
+    if (rename(tmp, dst) != 0) {
+        fprintf(stderr, "⚠️ hugetlbfs: rename %s: %s\n", dst, strerror(errno));
+        goto done;
+    }
+    rc = 0;
+done:
+    if (map != MAP_FAILED) munmap(map, size);
+    close(in);
+    close(out);
+    if (rc != 0) {
+        unlink(tmp);
+        return -1;
+    }
+    snprintf(stats->path, sizeof(stats->path), "%s", dst);
+    stats->staged = 1;
+    return 0;
+}
+
+// Своё отображение только прогревает page cache и закрывается: загрузчик
+// llama отображает файл сам, и его страницы берутся из того же кэша
+static void prefault(const LlmLoadOptions *opt, LlmLoadStats *stats) {
+    int fd = open(stats->path, O_RDONLY);
+    if (fd < 0) return;
+    size_t size = stats->file_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map != MAP_FAILED) {
+        stats->cached_before = resident_fraction(map, size);
+        munmap(map, size);
+    }
+    if (opt->populate || opt->willneed || opt->hugepages) {
+        int flags = MAP_SHARED | (opt->populate ? MAP_POPULATE : 0);
+        map = mmap(NULL, size, PROT_READ, flags, fd, 0);
+        if (map != MAP_FAILED) {
+            if (opt->willneed) madvise(map, size, MADV_WILLNEED);
+#ifdef MADV_HUGEPAGE
+            if (opt->hugepages) stats->thp = madvise(map, size, MADV_HUGEPAGE) == 0;
+#endif
+            stats->cached_after = resident_fraction(map, size);
+            munmap(map, size);
+        }
+    } else {
+        stats->cached_after = stats->cached_before;
+    }
+    close(fd);
+}
+
+static int warmup(struct llama_model *model, const LlmLoadOptions *opt) {
+    struct llama_context_params cp = llama_context_default_params();
+    cp.n_ctx = WARMUP_CTX;
+    cp.n_batch = WARMUP_CTX;
+    cp.n_threads = opt->n_threads;
+    cp.n_threads_batch = opt->n_threads;
+    struct llama_context *ctx = llama_init_from_model(model, cp);
+    if (!ctx) return -1;
+
+    int n = opt->warmup_tokens < WARMUP_CTX - 1 ? opt->warmup_tokens : WARMUP_CTX - 1;
+    llama_token *tokens = malloc((size_t)n * sizeof(*tokens));
+    int rc = -1;
+    if (tokens) {
+        llama_token bos = llama_vocab_bos(llama_model_get_vocab(model));
+        for (int i = 0; i < n; i++) tokens[i] = bos;
+        // пакетный путь (prefill) и одиночный токен (decode) — разные ядра
+        if (llama_decode(ctx, llama_batch_get_one(tokens, n)) == 0 &&
+            llama_decode(ctx, llama_batch_get_one(tokens, 1)) == 0) rc = 0;
+        free(tokens);
+    }
+    llama_free(ctx);
+    return rc;
+}
+
+int llm_load(const char *path, const LlmLoadOptions *opt,
+             struct llama_model **model, struct llama_context **ctx, LlmLoadStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->cached_before = stats->cached_after = -1;
+    *model = NULL;
+    *ctx = NULL;
+
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        fprintf(stderr, "❌ Model %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    stats->file_size = (size_t)st.st_size;
+    snprintf(stats->path, sizeof(stats->path), "%s", path);
+
+    double t = now_ms();
+    if (opt->hugetlbfs_dir && stage_hugetlbfs(path, opt->hugetlbfs_dir, &st, stats) != 0)
+        fprintf(stderr, "⚠️ hugetlbfs недоступен, загрузка с %s\n", path);
+    stats->stage_ms = now_ms() - t;
+
+    t = now_ms();
+    prefault(opt, stats);
+    stats->prefault_ms = now_ms() - t;
+
+    if (opt->mlock) {
+        struct rlimit rl;
+        if (getrlimit(RLIMIT_MEMLOCK, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY && rl.rlim_cur < stats->file_size)
+            fprintf(stderr, "⚠️ RLIMIT_MEMLOCK %llu МБ меньше модели (%zu МБ): mlock не удержит все веса\n",
+                    (unsigned long long)(rl.rlim_cur >> 20), stats->file_size >> 20);
+    }
+
+    struct llama_model_params mp = llama_model_default_params();
+    mp.use_mmap = true;
+    mp.use_mlock = opt->mlock != 0;
+    t = now_ms();
+    *model = llama_model_load_from_file(stats->path, mp);
+    stats->load_ms = now_ms() - t;
+    if (!*model) {
+        fprintf(stderr, "❌ Model load failed: %s\n", stats->path);
+        return -1;
+    }
+
+    if (opt->warmup_tokens > 0) {
+        t = now_ms();
+        if (warmup(*model, opt) != 0) fprintf(stderr, "⚠️ Прогрев не удался\n");
+        stats->warmup_ms = now_ms() - t;
+    }
+
+    struct llama_context_params cp = llama_context_default_params();
+    cp.n_ctx = (uint32_t)opt->n_ctx;
+    cp.n_threads = opt->n_threads;
+    cp.n_threads_batch = opt->n_threads;
+    t = now_ms();
+    *ctx = llama_init_from_model(*model, cp);
+    stats->ctx_ms = now_ms() - t;
+    if (!*ctx) {
+        fprintf(stderr, "❌ Context init failed\n");
+        llama_model_free(*model);
+        *model = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+void llm_load_report(FILE *f, const LlmLoadStats *s) {
+    fprintf(f, "⏱️ Cold start %s (%zu MB%s): stage %.1f ms, prefault %.1f ms, load %.1f ms, "
+               "warmup %.1f ms, ctx %.1f ms; page cache %.0f%% → %.0f%%%s\n",
+            s->path, s->file_size >> 20, s->staged ? ", hugetlbfs" : "",
+            s->stage_ms, s->prefault_ms, s->load_ms, s->warmup_ms, s->ctx_ms,
+            s->cached_before < 0 ? 0 : s->cached_before * 100, s->cached_after < 0 ? 0 : s->cached_after * 100,
+            s->thp ? ", THP" : "");
+}
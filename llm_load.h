@@ -0,0 +1,53 @@
+// llm_load.h — холодный старт модели: предзагрузка GGUF, hugepages, mlock, прогрев
+//
+// Загрузка разбита на фазы, время каждой попадает в LlmLoadStats:
+//   stage    — (--hugetlbfs) копия GGUF в файл на hugetlbfs: веса лежат в
+//              явных hugepages и переживают перезапуск процесса; повторный
+//              старт копирует, только если исходник новее копии
+//   prefault — своё отображение файла: MAP_POPULATE читает его в page cache
+//              синхронно, MADV_WILLNEED — фоновым readahead, MADV_HUGEPAGE
+//              просит THP (для файлов — при READ_ONLY_THP_FOR_FS)
+//   load     — llama_model_load_from_file (use_mmap, use_mlock); после
+//              prefault страницы берутся из page cache без чтения с диска
+//   ctx      — llama_init_from_model
+//   warmup   — короткое декодирование в отдельном маленьком контексте:
+//              касается всех тензоров и поднимает пул потоков бэкенда,
+//              рабочий контекст после этого чистый (без API очистки KV)
+// Доля файла в page cache до и после (mincore) показывает, был ли старт
+// холодным.
+
+#ifndef LLM_LOAD_H
+#define LLM_LOAD_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "llama.cpp/include/llama.h"
+
+typedef struct {
+    int populate;              // MAP_POPULATE
+    int willneed;              // MADV_WILLNEED
+    int hugepages;             // MADV_HUGEPAGE на отображение
+    int mlock;                 // use_mlock: веса не вытесняются
+    const char *hugetlbfs_dir; // NULL — без явных hugepages
+    int warmup_tokens;         // 0 — без прогрева
+    int n_ctx;
+    int n_threads;
+} LlmLoadOptions;
+
+typedef struct {
+    double stage_ms, prefault_ms, load_ms, ctx_ms, warmup_ms;
+    double cached_before, cached_after;   // доля страниц файла в page cache, -1 — неизвестно
+    size_t file_size;
+    int staged;                // грузились из копии на hugetlbfs
+    int thp;                   // MADV_HUGEPAGE принят ядром
+    char path[1024];           // фактически загруженный файл
+} LlmLoadStats;
+
+// 0 — *model и *ctx созданы; -1 — ошибка (сообщение уже в stderr)
+int llm_load(const char *path, const LlmLoadOptions *opt,
+             struct llama_model **model, struct llama_context **ctx, LlmLoadStats *stats);
+
+void llm_load_report(FILE *f, const LlmLoadStats *stats);
+
+#endif // LLM_LOAD_H
@@ -0,0 +1,393 @@
+// llm_sched.c — ограниченная очередь с DRR по пользователям и кооперативной отменой (см. llm_sched.h)
+
+#define _GNU_SOURCE
+#include "llm_sched.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+// Очередь пользователя в одном классе; в кольце класса, пока не пуста
+typedef struct Flow {
+    int64_t user;
+    uint32_t deficit;
+    int visited;               // кредит за текущий проход уже выдан
+    LlmRequest *head, *tail;
+    struct Flow *next;
+} Flow;
+
+typedef struct {
+    Flow *head, *tail;
+} Ring;
+
+struct LlmSched {
+    LlmSchedConfig cfg;
+    pthread_mutex_t mu;
+    pthread_cond_t cv;
+    int stop;
+    Ring rings[2];             // 0 — короткие, 1 — длинные
+    int short_streak;
+    Flow *flows, *free_flows;
+    LlmRequest **running;      // по исполнителю
+    pthread_t *threads;
+    int started_threads;
+    LlmSchedStats st;
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void ring_push(Ring *r, Flow *f) {
+    f->next = NULL;
+    if (r->tail) r->tail->next = f;
+    else r->head = f;
+    r->tail = f;
+}
+
+static void ring_remove(Ring *r, Flow *f) {
+    Flow *prev = NULL;
+    for (Flow *it = r->head; it; prev = it, it = it->next) {
+        if (it != f) continue;
+        if (prev) prev->next = f->next;
+        else r->head = f->next;
+        if (r->tail == f) r->tail = prev;
+        return;
+    }
+}
+
+static void flow_release(LlmSched *s, Ring *r, Flow *f) {
+    ring_remove(r, f);
+    f->next = s->free_flows;
+    s->free_flows = f;
+}
+
+// Убрать из очереди запросы, для которых pred истинен; их список — в *out
+static void queue_extract(LlmSched *s, int (*pred)(LlmRequest *, int64_t, uint64_t),
+                          int64_t user, uint64_t now, LlmRequest **out) {
+    for (int c = 0; c < 2; c++) {
+        Ring *ring = &s->rings[c];
+        Flow *f = ring->head;
+        while (f) {
+            Flow *next = f->next;
+            LlmRequest **pp = &f->head;
+            f->tail = NULL;
+            while (*pp) {
+                LlmRequest *r = *pp;
+                if (pred(r, user, now)) {
+                    *pp = r->next;
+                    r->next = *out;
+                    *out = r;
+                    s->st.queued--;
+                } else {
+                    f->tail = r;
+                    pp = &r->next;
+                }
+            }
+            if (!f->head) flow_release(s, ring, f);
+            f = next;
+        }
+    }
+}
+
+static int is_user(LlmRequest *r, int64_t user, uint64_t now) {
+    (void)now;
+    return r->user == user;
+}
+
+static int is_expired(LlmRequest *r, int64_t user, uint64_t now) {
+    (void)user;
+    return now >= r->deadline_ns;
+}
+
+// Следующий запрос по классам и DRR; под mu
+static LlmRequest *pick(LlmSched *s) {
+    Ring *rs = &s->rings[0], *rl = &s->rings[1];
+    Ring *ring;
+    if (rs->head && (!rl->head || s->short_streak < s->cfg.short_burst)) {
+        ring = rs;
+        s->short_streak++;
+    } else if (rl->head) {
+        ring = rl;
+        s->short_streak = 0;
+    } else {
+        return NULL;
+    }
+    for (;;) {
+        Flow *f = ring->head;
+        if (!f->visited) {
+            f->deficit += s->cfg.quantum;
+            f->visited = 1;
+        }
+        LlmRequest *r = f->head;
+        if (r->cost <= f->deficit) {
+            f->deficit -= r->cost;
+            f->head = r->next;
+            if (!f->head) {
+                f->tail = NULL;
+                flow_release(s, ring, f);
+            }
+            r->next = NULL;
+            s->st.queued--;
+            return r;
+        }
+        // кредита не хватило — в конец кольца до следующего прохода
+        f->visited = 0;
+        if (ring->head != ring->tail) {
+            ring->head = f->next;
+            ring_push(ring, f);
+        }
+    }
+}
+
+static void finish_list(LlmSched *s, LlmRequest *list, LlmEnd end) {
+    while (list) {
+        LlmRequest *next = list->next;
+        s->cfg.end(list, end, s->cfg.ctx);
+        free(list);
+        list = next;
+    }
+}
+
+static void count_end(LlmSched *s, LlmEnd end, uint64_t n) {
+    switch (end) {
+    case LLM_END_DONE:       s->st.done += n; break;
+    case LLM_END_FAILED:     s->st.failed += n; break;
+    case LLM_END_TIMEOUT:    s->st.timeouts += n; break;
+    case LLM_END_SUPERSEDED: s->st.superseded += n; break;
+    case LLM_END_SHUTDOWN:   break;
+    }
+}
+
+static uint64_t list_len(LlmRequest *r) {
+    uint64_t n = 0;
+    for (; r; r = r->next) n++;
+    return n;
+}
+
+typedef struct {
+    LlmSched *s;
+    int idx;
+} WorkerArg;
+
+static void *worker(void *p) {
+    WorkerArg *wa = p;
+    LlmSched *s = wa->s;
+    int idx = wa->idx;
+    free(wa);
+
+    pthread_mutex_lock(&s->mu);
+    while (!s->stop) {
+        LlmRequest *r = pick(s);
+        if (!r) {
+            pthread_cond_wait(&s->cv, &s->mu);
+            continue;
+        }
+        uint64_t now = now_ns();
+        if (now >= r->deadline_ns) {
+            s->st.timeouts++;
+            pthread_mutex_unlock(&s->mu);
+            s->cfg.end(r, LLM_END_TIMEOUT, s->cfg.ctx);
+            free(r);
+            pthread_mutex_lock(&s->mu);
+            continue;
+        }
+        r->started_ns = now;
+        uint64_t wait = now - r->enqueued_ns;
+        s->st.started++;
+        s->st.wait_sum_ns += wait;
+        if (wait > s->st.wait_max_ns) s->st.wait_max_ns = wait;
+        s->running[idx] = r;
+        s->st.running++;
+        pthread_mutex_unlock(&s->mu);
+
+        int rc = s->cfg.run(r, s->cfg.ctx);
+        // Отмена, не успевшая остановить run(): ответ уже ушёл, итог — DONE
+        int reason = __atomic_load_n(&r->cancel, __ATOMIC_ACQUIRE);
+        LlmEnd end = rc == 0 ? LLM_END_DONE : reason ? (LlmEnd)reason : LLM_END_FAILED;
+
+        pthread_mutex_lock(&s->mu);
+        s->running[idx] = NULL;
+        s->st.running--;
+        count_end(s, end, 1);
+        pthread_mutex_unlock(&s->mu);
+        s->cfg.end(r, end, s->cfg.ctx);
+        free(r);
+        pthread_mutex_lock(&s->mu);
+    }
+    pthread_mutex_unlock(&s->mu);
+    return NULL;
+}
+
+LlmSched *llm_sched_create(const LlmSchedConfig *cfg) {
+    if (!cfg->run || !cfg->end) return NULL;
+    LlmSched *s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    s->cfg = *cfg;
+    if (s->cfg.capacity <= 0) s->cfg.capacity = 32;
+    if (s->cfg.workers <= 0) s->cfg.workers = 1;
+    if (!s->cfg.quantum) s->cfg.quantum = 512;
+    if (!s->cfg.short_cost) s->cfg.short_cost = 320;
+    if (s->cfg.short_burst <= 0) s->cfg.short_burst = 4;
+    if (s->cfg.deadline_ms <= 0) s->cfg.deadline_ms = 60000;
+
+    s->flows = calloc((size_t)s->cfg.capacity, sizeof(Flow));
+    s->running = calloc((size_t)s->cfg.workers, sizeof(LlmRequest *));
+    s->threads = calloc((size_t)s->cfg.workers, sizeof(pthread_t));
+    if (!s->flows || !s->running || !s->threads) goto fail;
+    for (int i = s->cfg.capacity - 1; i >= 0; i--) {
+        s->flows[i].next = s->free_flows;
+        s->free_flows = &s->flows[i];
+    }
+    pthread_mutex_init(&s->mu, NULL);
+    pthread_cond_init(&s->cv, NULL);
+    for (int i = 0; i < s->cfg.workers; i++) {
+        WorkerArg *wa = malloc(sizeof(*wa));
+        if (!wa) break;
+        wa->s = s;
+        wa->idx = i;
+        if (pthread_create(&s->threads[i], NULL, worker, wa) != 0) {
+            free(wa);
+            break;
+        }
+        s->started_threads++;
+    }
+    if (s->started_threads == 0) {
+        pthread_mutex_destroy(&s->mu);
+        pthread_cond_destroy(&s->cv);
+        goto fail;
+    }
+    return s;
+fail:
+    free(s->flows);
+    free(s->running);
+    free(s->threads);
+    free(s);
+    return NULL;
+}
+
+// Отметить выполняемые запросы пользователя; под mu
+static int cancel_running(LlmSched *s, int64_t user, LlmEnd reason) {
+    int n = 0;
+    for (int i = 0; i < s->cfg.workers; i++) {
+        LlmRequest *r = s->running[i];
+        if (!r || r->user != user) continue;
+        int expected = 0;
+        if (__atomic_compare_exchange_n(&r->cancel, &expected, (int)reason, 0,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) n++;
+    }
+    return n;
+}
+
+LlmSchedStatus llm_sched_submit(LlmSched *s, int64_t user, uint32_t cost, void *arg) {
+    LlmRequest *r = calloc(1, sizeof(*r));
+    if (!r) return LLM_SCHED_ERROR;
+    uint64_t now = now_ns();
+    r->user = user;
+    r->cost = cost;
+    r->arg = arg;
+    r->enqueued_ns = now;
+    r->deadline_ns = now + (uint64_t)s->cfg.deadline_ms * 1000000ull;
+
+    LlmRequest *superseded = NULL, *expired = NULL;
+    pthread_mutex_lock(&s->mu);
+    s->st.submitted++;
+    if (s->cfg.supersede) {
+        queue_extract(s, is_user, user, now, &superseded);
+        cancel_running(s, user, LLM_END_SUPERSEDED);
+    }
+    if (s->st.queued >= s->cfg.capacity) queue_extract(s, is_expired, 0, now, &expired);
+    if (s->st.queued >= s->cfg.capacity || s->stop) {
+        s->st.busy++;
+        count_end(s, LLM_END_SUPERSEDED, list_len(superseded));
+        count_end(s, LLM_END_TIMEOUT, list_len(expired));
+        pthread_mutex_unlock(&s->mu);
+        finish_list(s, superseded, LLM_END_SUPERSEDED);
+        finish_list(s, expired, LLM_END_TIMEOUT);
+        free(r);
+        return LLM_SCHED_BUSY;
+    }
+
+    Ring *ring = &s->rings[cost <= s->cfg.short_cost ? 0 : 1];
+    Flow *f = ring->head;
+    while (f && f->user != user) f = f->next;
+    if (!f) {
+        // потоков не больше запросов в очереди, а их не больше capacity
+        f = s->free_flows;
+        s->free_flows = f->next;
+        memset(f, 0, sizeof(*f));
+        f->user = user;
+        ring_push(ring, f);
+    }
+    if (f->tail) f->tail->next = r;
+    else f->head = r;
+    f->tail = r;
+    s->st.queued++;
+    count_end(s, LLM_END_SUPERSEDED, list_len(superseded));
+    count_end(s, LLM_END_TIMEOUT, list_len(expired));
+    pthread_cond_signal(&s->cv);
+    pthread_mutex_unlock(&s->mu);
+
+    finish_list(s, superseded, LLM_END_SUPERSEDED);
+    finish_list(s, expired, LLM_END_TIMEOUT);
+    return LLM_SCHED_OK;
+}
+
+int llm_sched_cancelled(LlmRequest *req) {
+    int reason = __atomic_load_n(&req->cancel, __ATOMIC_ACQUIRE);
+    if (reason || now_ns() < req->deadline_ns) return reason;
+    int expected = 0;
+    if (__atomic_compare_exchange_n(&req->cancel, &expected, LLM_END_TIMEOUT, 0,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) return LLM_END_TIMEOUT;
+    return expected;
+}
+
+int llm_sched_cancel_user(LlmSched *s, int64_t user, LlmEnd reason) {
+    LlmRequest *list = NULL;
+    pthread_mutex_lock(&s->mu);
+    queue_extract(s, is_user, user, 0, &list);
+    int n = (int)list_len(list);
+    count_end(s, reason, (uint64_t)n);
+    n += cancel_running(s, user, reason);
+    pthread_mutex_unlock(&s->mu);
+    finish_list(s, list, reason);
+    return n;
+}
+
+void llm_sched_stats(LlmSched *s, LlmSchedStats *out) {
+    pthread_mutex_lock(&s->mu);
+    *out = s->st;
+    pthread_mutex_unlock(&s->mu);
+}
+
+static int is_any(LlmRequest *r, int64_t user, uint64_t now) {
+    (void)r; (void)user; (void)now;
+    return 1;
+}
+
+void llm_sched_destroy(LlmSched *s) {
+    if (!s) return;
+    LlmRequest *list = NULL;
+    pthread_mutex_lock(&s->mu);
+    s->stop = 1;
+    queue_extract(s, is_any, 0, 0, &list);
+    for (int i = 0; i < s->cfg.workers; i++) {
+        LlmRequest *r = s->running[i];
+        int expected = 0;
+        if (r) __atomic_compare_exchange_n(&r->cancel, &expected, LLM_END_SHUTDOWN, 0,
+                                           __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+    }
+    pthread_cond_broadcast(&s->cv);
+    pthread_mutex_unlock(&s->mu);
+    finish_list(s, list, LLM_END_SHUTDOWN);
+    for (int i = 0; i < s->started_threads; i++) pthread_join(s->threads[i], NULL);
+    pthread_mutex_destroy(&s->mu);
+    pthread_cond_destroy(&s->cv);
+    free(s->flows);
+    free(s->running);
+    free(s->threads);
+    free(s);
+}
@@ -0,0 +1,99 @@
+// llm_sched.h — очередь запросов к модели: допуск, справедливость, отмена
+//
+// Перед генерацией стоит ограниченная очередь:
+//   допуск    — очередь полна (capacity) → llm_sched_submit сразу возвращает
+//               LLM_SCHED_BUSY, и вызывающий отвечает «занят», не дожидаясь
+//               модели; просроченные запросы при этом выметаются первыми
+//   классы    — запрос с cost <= short_cost короткий и идёт раньше длинных;
+//               после short_burst коротких подряд берётся длинный, чтобы
+//               длинные не голодали
+//   честность — внутри класса deficit round robin по пользователям: каждый
+//               проход пользователь получает quantum токенов кредита, запрос
+//               уходит, когда кредита хватает на его cost. Пользователь с
+//               длинными промптами не занимает модель чаще других
+//   дедлайн   — deadline_ms от постановки; просроченный в очереди не
+//               запускается, выполняемый отменяется
+//   замена    — (supersede) новое сообщение пользователя вытесняет его
+//               запрос из очереди и отменяет уже выполняемый
+//
+// Отмена кооперативная: run() между шагами декодирования вызывает
+// llm_sched_cancelled() и, получив не 0, сворачивается. Итог каждого
+// принятого запроса приходит в end() ровно один раз, из потока-исполнителя
+// (или из llm_sched_submit для вытесненных из очереди).
+
+#ifndef LLM_SCHED_H
+#define LLM_SCHED_H
+
+#include <stdint.h>
+
+typedef enum {
+    LLM_SCHED_OK = 0,
+    LLM_SCHED_BUSY,            // очередь полна
+    LLM_SCHED_ERROR,
+} LlmSchedStatus;
+
+// Итог запроса; ненулевые, кроме DONE, — причины отмены
+typedef enum {
+    LLM_END_DONE = 0,
+    LLM_END_FAILED,            // run() вернул не 0
+    LLM_END_TIMEOUT,           // дедлайн
+    LLM_END_SUPERSEDED,        // пришло новое сообщение того же пользователя
+    LLM_END_SHUTDOWN,          // llm_sched_destroy
+} LlmEnd;
+
+typedef struct LlmRequest {
+    int64_t user;
+    uint32_t cost;             // оценка в токенах: промпт + генерация
+    uint64_t enqueued_ns;      // CLOCK_MONOTONIC
+    uint64_t started_ns;       // 0 — не запускался
+    uint64_t deadline_ns;
+    void *arg;                 // данные вызывающего; освобождает end()
+    int cancel;                // LlmEnd, атомарно; 0 — не отменён
+    struct LlmRequest *next;
+} LlmRequest;
+
+// Выполнить запрос на потоке-исполнителе; 0 — успех (итог DONE, даже если
+// отмена пришла, когда работа уже закончена)
+typedef int (*LlmRunFn)(LlmRequest *req, void *ctx);
+// Итог запроса; после возврата req освобождается
+typedef void (*LlmEndFn)(LlmRequest *req, LlmEnd end, void *ctx);
+
+typedef struct {
+    int capacity;              // запросов в очереди (32)
+    int workers;               // одновременных генераций (1)
+    uint32_t quantum;          // кредит DRR за проход, токенов (512)
+    uint32_t short_cost;       // порог короткого запроса, токенов (320)
+    int short_burst;           // коротких подряд до принудительного длинного (4)
+    int deadline_ms;           // от постановки в очередь (60000)
+    int supersede;             // новое сообщение отменяет старое (1)
+    LlmRunFn run;
+    LlmEndFn end;
+    void *ctx;
+} LlmSchedConfig;
+
+typedef struct {
+    uint64_t submitted, busy, done, failed, timeouts, superseded;
+    uint64_t wait_max_ns, wait_sum_ns, started;
+    int queued, running;
+} LlmSchedStats;
+
+typedef struct LlmSched LlmSched;
+
+// Нулевые поля cfg берут значения по умолчанию; NULL — ошибка
+LlmSched *llm_sched_create(const LlmSchedConfig *cfg);
+
+// LLM_SCHED_BUSY — запрос не принят, arg остаётся у вызывающего
+LlmSchedStatus llm_sched_submit(LlmSched *s, int64_t user, uint32_t cost, void *arg);
+
+// Причина отмены (LlmEnd) или 0; проверяет и дедлайн. Вызывать между шагами
+int llm_sched_cancelled(LlmRequest *req);
+
+// Отменить запросы пользователя в очереди и в работе; число затронутых
+int llm_sched_cancel_user(LlmSched *s, int64_t user, LlmEnd reason);
+
+void llm_sched_stats(LlmSched *s, LlmSchedStats *out);
+
+// Отменяет всё (LLM_END_SHUTDOWN) и дожидается исполнителей
+void llm_sched_destroy(LlmSched *s);
+
+#endif // LLM_SCHED_H
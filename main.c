@@ -2,12 +2,246 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
 #include "telebot/include/telebot.h"
+#include "trace.h"
+#include "llm_sched.h"
+#include "shard.h"
+#include "alog.h"
+
+#define LLM_MAX_TOKENS 256          // как max_tokens в bot.c
+
+// Запрос к модели: текст сообщения уходит в bot (отдельный процесс)
+typedef struct {
+    long long chat_id;
+    int message_id;
+    uint64_t trace_id;
+    char prompt[];
+} LlmJob;
+
+extern char **environ;
+
+static telebot_handler_t reply_handle;
+static const char *llm_model;
+static const char *llm_bot_bin = "./bot";
+static const char *llm_rag_index;      // OXXYEN_RAG_INDEX: --rag для bot
+static const char *llm_embed_model;    // OXXYEN_EMBED_MODEL: --embed-model
+static const char *llm_rag_k;          // OXXYEN_RAG_K: --rag-k
+static char bot_token[1024];
+static LlmSched *llm_sched;
+static volatile sig_atomic_t shards_reload;
+
+// Запуск bot и ожидание с проверкой отмены: SIGTERM останавливает его
+// между шагами декодирования
+static int llm_run(LlmRequest *req, void *ctx) {
+    (void)ctx;
+    LlmJob *job = req->arg;
+    trace_interval(job->trace_id, "llm", "sched_wait", req->enqueued_ns, req->started_ns, req->user);
+    char chat[32], tid[24];
+    snprintf(chat, sizeof(chat), "%lld", job->chat_id);
+    snprintf(tid, sizeof(tid), "%llu", (unsigned long long)job->trace_id);
+
+    // окружение bot: унаследованное, OXXYEN_TRACE_ID — id апдейта
+    size_t n_env = 0;
+    while (environ[n_env]) n_env++;
+    char **envp = malloc((n_env + 2) * sizeof(char *));
+    if (!envp) return -1;
+    size_t k = 0;
+    for (size_t i = 0; i < n_env; i++)
+        if (strncmp(environ[i], "OXXYEN_TRACE_ID=", 16) != 0) envp[k++] = environ[i];
+    char env_id[48];
+    snprintf(env_id, sizeof(env_id), "OXXYEN_TRACE_ID=%s", tid);
+    envp[k++] = env_id;
+    envp[k] = NULL;
+    char *args[12];
+    size_t n_args = 0;
+    args[n_args++] = (char *)llm_bot_bin;
+    if (llm_rag_index) {
+        args[n_args++] = "--rag";
+        args[n_args++] = (char *)llm_rag_index;
+        args[n_args++] = "--embed-model";
+        args[n_args++] = (char *)llm_embed_model;
+        if (llm_rag_k) {
+            args[n_args++] = "--rag-k";
+            args[n_args++] = (char *)llm_rag_k;
+        }
+    }
+    args[n_args++] = (char *)llm_model;
+    args[n_args++] = chat;
+    args[n_args++] = job->prompt;
+    args[n_args] = NULL;
+    pid_t pid;
+    int rc = posix_spawn(&pid, llm_bot_bin, NULL, NULL, args, envp);
+    free(envp);
+    if (rc != 0) {
+        ALOG(ALOG_ERROR, "llm.spawn_failed", AF_S("bin", llm_bot_bin), AF_S("error", strerror(rc)));
+        return -1;
+    }
+    int status = 0, killed = 0;
+    for (;;) {
+        pid_t w = waitpid(pid, &status, killed ? 0 : WNOHANG);
+        if (w == pid) break;
+        if (w < 0) return -1;
+        if (llm_sched_cancelled(req)) {
+            kill(pid, SIGTERM);
+            killed = 1;
+            continue;
+        }
+        usleep(20000);
+    }
+    trace_span(job->trace_id, "llm", "bot_process", req->started_ns, job->chat_id);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+static void llm_end(LlmRequest *req, LlmEnd end, void *ctx) {
+    (void)ctx;
+    LlmJob *job = req->arg;
+    if (end == LLM_END_TIMEOUT)
+        telebot_send_message(reply_handle, job->chat_id,
+            "⏳ Не успел ответить вовремя. Попробуйте спросить короче.", "", false, false, job->message_id, "");
+    else if (end == LLM_END_FAILED)
+        ALOG(ALOG_ERROR, "llm.failed", AF_I("chat", job->chat_id), AF_U("trace", job->trace_id));
+    free(job);
+}
+
+// Ответ на сообщение (в шардовом режиме команды — в шарде, генерация — в
+// ingress); начало отправки для трассы или 0. Очередь генерации ведёт учёт
+// по отправителю from_id: в группе у каждого своя доля модели, и новое
+// сообщение заменяет только его собственный запрос
+static uint64_t reply_text(uint64_t trace_id, long long chat_id, long long from_id, int message_id,
+                           const char *first_name, const char *text)
+{
+    uint64_t t_send = 0;
+    if (strcmp(text, "/start") == 0)
+    {
+        char reply[2048];
+        snprintf(reply, sizeof(reply),
+            "👋 Привет, %s!\n\n"
+            "Я — <b>OXXYEN Bot</b> 🧠\n"
+            "Бот, написанный полностью на чистом C.\n\n"
+            "⚙️ Команды:\n"
+            "  • /help — справка\n"
+            "  • /dice — бросить кубик 🎲",
+            first_name);
+
+        t_send = trace_now();
+        telebot_send_message(reply_handle, chat_id, reply, "HTML", false, false, message_id, "");
+        trace_span(trace_id, "telegram", "send_message", t_send, chat_id);
+    }
+    else if (strcmp(text, "/help") == 0)
+    {
+        const char *help_msg =
+            "📘 <b>Помощь</b>\n\n"
+            "Мои команды:\n"
+            "  • /start — приветствие\n"
+            "  • /help — показать это сообщение\n"
+            "  • /dice — бросить случайный кубик 🎲\n\n"
+            "👨‍💻 Минимализм и скорость — сила C.";
+
+        t_send = trace_now();
+        telebot_send_message(reply_handle, chat_id, help_msg, "HTML", false, false, message_id, "");
+        trace_span(trace_id, "telegram", "send_message", t_send, chat_id);
+    }
+    else if (strcmp(text, "/dice") == 0)
+    {
+        t_send = trace_now();
+        telebot_send_dice(reply_handle, chat_id, false, 0, "");
+        trace_span(trace_id, "telegram", "send_dice", t_send, chat_id);
+    }
+    else if (llm_sched && text[0] != '/')
+    {
+        // оценка cost: ~4 байта на токен промпта плюс генерация
+        size_t len = strlen(text);
+        LlmJob *job = malloc(sizeof(*job) + len + 1);
+        LlmSchedStatus st = LLM_SCHED_ERROR;
+        if (job) {
+            job->chat_id = chat_id;
+            job->message_id = message_id;
+            job->trace_id = trace_id;
+            memcpy(job->prompt, text, len + 1);
+            st = llm_sched_submit(llm_sched, from_id, (uint32_t)(len / 4) + LLM_MAX_TOKENS, job);
+        }
+        if (st != LLM_SCHED_OK) {
+            free(job);
+            t_send = trace_now();
+            telebot_send_message(reply_handle, chat_id,
+                "🚦 Сейчас много запросов, попробуйте через минуту.",
+                "", false, false, message_id, "");
+            trace_span(trace_id, "telegram", "send_message", t_send, chat_id);
+        }
+    }
+    else
+    {
+        t_send = trace_now();
+        telebot_send_message(reply_handle, chat_id,
+            "🤖 Неизвестная команда.\nВведите /help, чтобы узнать доступные.", 
+            "", false, false, message_id, "");
+        trace_span(trace_id, "telegram", "send_message", t_send, chat_id);
+    }
+    return t_send;
+}
+
+static LlmSched *llm_start(void) {
+    const char *deadline = getenv("OXXYEN_LLM_DEADLINE_MS");
+    LlmSchedConfig cfg = {
+        .deadline_ms = deadline ? atoi(deadline) : 0,
+        .supersede = 1,
+        .run = llm_run,
+        .end = llm_end,
+    };
+    LlmSched *s = llm_sched_create(&cfg);
+    if (!s) fprintf(stderr, "❌ Не удалось запустить очередь генерации\n");
+    return s;
+}
+
+// Шард — отдельный процесс со своим telebot. Очереди генерации у него нет:
+// перезапущенный шард унаследовал бы указатель на очередь ingress без её потоков
+static int shard_init(int shard, void *ctx) {
+    (void)ctx;
+    if (telebot_create(&reply_handle, bot_token) != TELEBOT_ERROR_NONE) {
+        fprintf(stderr, "❌ Шард %d: ошибка инициализации Telebot\n", shard);
+        return -1;
+    }
+    llm_sched = NULL;
+    printf("🧩 Шард %d запущен (pid %d)\n", shard, (int)getpid());
+    return 0;
+}
+
+static void shard_handle(int shard, const ShardUpdate *u, void *ctx) {
+    (void)shard;
+    (void)ctx;
+    trace_poll();
+    uint64_t trace_id = (uint64_t)u->update_id;
+    uint64_t t_req = trace_now();
+    uint64_t t_send = reply_text(trace_id, u->chat_id, u->from_id, (int)u->message_id, u->first_name, u->text);
+    if (t_send) trace_interval(trace_id, "bot", "dispatch", t_req, t_send, u->chat_id);
+    trace_request_end(trace_id, "update", t_req, u->chat_id);
+}
+
+static void on_sighup(int sig) {
+    (void)sig;
+    shards_reload = 1;
+}
+
+// Число шардов из файла (OXXYEN_SHARDS_FILE, по умолчанию .shards); 0 — нет файла
+static int shards_from_file(void) {
+    const char *path = getenv("OXXYEN_SHARDS_FILE");
+    FILE *f = fopen(path && *path ? path : ".shards", "r");
+    if (!f) return 0;
+    int n = 0;
+    if (fscanf(f, "%d", &n) != 1) n = 0;
+    fclose(f);
+    return n;
+}
 
 int main(int argc, char *argv[])
 {
     printf("🚀 OXXYEN Bot v1.1 (C edition)\n");
     printf("─────────────────────────────\n");
+    trace_init("oxxyen-bot");
+    alog_init();
 
     // Загружаем токен
     FILE *fp = fopen(".token", "r");
@@ -16,8 +250,7 @@ int main(int argc, char *argv[])
         return -1;
     }
 
-    char token[1024];
-    if (fscanf(fp, "%1023s", token) != 1) {
+    if (fscanf(fp, "%1023s", bot_token) != 1) {
         fprintf(stderr, "❌ Ошибка чтения токена\n");
         fclose(fp);
         return -1;
@@ -25,7 +258,7 @@ int main(int argc, char *argv[])
     fclose(fp);
 
     telebot_handler_t handle;
-    if (telebot_create(&handle, token) != TELEBOT_ERROR_NONE) {
+    if (telebot_create(&handle, bot_token) != TELEBOT_ERROR_NONE) {
         fprintf(stderr, "❌ Ошибка инициализации Telebot\n");
         return -1;
     }
@@ -40,82 +273,142 @@ int main(int argc, char *argv[])
     printf("✅ Бот запущен: %s (@%s)\n", me.first_name, me.username);
     telebot_put_me(&me);
 
+    // main [--shards N] [модель]; модель — или OXXYEN_MODEL, без неё обычный
+    // текст — неизвестная команда
+    int n_shards = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--shards") == 0 && i + 1 < argc) n_shards = atoi(argv[++i]);
+        else llm_model = argv[i];
+    }
+    if (!llm_model) llm_model = getenv("OXXYEN_MODEL");
+    const char *bin = getenv("OXXYEN_BOT_BIN");
+    if (bin && *bin) llm_bot_bin = bin;
+    // RAG (bot --rag): индекс и модель эмбеддингов задаются только вместе
+    const char *rag = getenv("OXXYEN_RAG_INDEX"), *embed = getenv("OXXYEN_EMBED_MODEL");
+    const char *rag_k = getenv("OXXYEN_RAG_K");
+    if (rag && *rag && embed && *embed) {
+        llm_rag_index = rag;
+        llm_embed_model = embed;
+        if (rag_k && *rag_k) llm_rag_k = rag_k;
+    } else if ((rag && *rag) || (embed && *embed)) {
+        fprintf(stderr, "⚠️ OXXYEN_RAG_INDEX без OXXYEN_EMBED_MODEL (или наоборот): RAG выключен\n");
+    }
+    reply_handle = handle;
+
+    // Шарды: чаты раздаются N процессам (shard.h), этот процесс опрашивает
+    // Telegram и ведёт единственную очередь генерации — модель одна, и
+    // ёмкость, число bot и честность по отправителю общие на весь бот, а не
+    // на шард. SIGHUP перечитывает число шардов из .shards.
+    // fork — до потоков admin и очереди генерации
+    ShardRouter *shards = NULL;
+    if (n_shards > 0) {
+        ShardConfig sc = { .workers = n_shards, .init = shard_init, .handle = shard_handle };
+        shards = shard_start(&sc);
+        if (!shards) {
+            fprintf(stderr, "❌ Не удалось запустить %d шардов\n", n_shards);
+            telebot_destroy(handle);
+            return -1;
+        }
+        signal(SIGHUP, on_sighup);
+        printf("🧩 Шардов: %d\n", n_shards);
+    }
+
     admin_terminal_start(handle);
 
+    if (llm_model) {
+        llm_sched = llm_start();
+        printf("🧠 Модель: %s\n", llm_model);
+        if (llm_rag_index) printf("📚 RAG: %s (%s)\n", llm_rag_index, llm_embed_model);
+    }
+
     int offset = -1;
     telebot_update_t *updates;
     telebot_error_e ret;
     int count;
 
+    // Трасса апдейта (trace.h): id — update_id; интервалы опроса и паузы
+    // общие (id 0) и попадают в выгрузку медленного апдейта по времени
+    int limit = shards ? 100 : 20;
     while (1)
     {
-        ret = telebot_get_updates(handle, offset, 20, 0, NULL, 0, &updates, &count);
+        trace_poll();
+        if (shards_reload) {
+            shards_reload = 0;
+            int n = shards_from_file();
+            if (n > 0 && shard_resize(shards, n) == 0) printf("🧩 Шардов: %d\n", n);
+            else fprintf(stderr, "❌ В .shards нет числа шардов 1..%d\n", SHARD_MAX_WORKERS);
+        }
+        uint64_t t_poll = trace_now();
+        ret = telebot_get_updates(handle, offset, limit, 0, NULL, 0, &updates, &count);
+        trace_span(0, "telegram", "get_updates", t_poll, ret == TELEBOT_ERROR_NONE ? count : -1);
         if (ret != TELEBOT_ERROR_NONE) {
+            uint64_t t_sleep = trace_now();
             sleep(1);
+            trace_span(0, "loop", "sleep", t_sleep, 0);
             continue;
         }
+        uint64_t t_polled = trace_now();
 
         for (int i = 0; i < count; i++)
         {
             telebot_message_t msg = updates[i].message;
             if (msg.text == NULL) continue;
 
+            uint64_t trace_id = (uint64_t)updates[i].update_id;
+            uint64_t t_req = trace_now();
+            // ожидание за предыдущими апдейтами той же пачки
+            trace_span(trace_id, "loop", "queued", t_polled, i);
             long long chat_id = msg.chat->id;
-            printf("📩 [%s]: %s\n", msg.from->first_name, msg.text);
+            uint64_t t_send = 0;
+            ALOG(ALOG_INFO, "message", AF_I("update", updates[i].update_id), AF_I("chat", chat_id),
+                 AF_S("from", msg.from->first_name), AF_S("text", msg.text));
 
             // if(admin_is_admin(msg.chat->id)) {
             //     admin_handle_command(handle, &msg);
             //     continue;
             // }
 
-            if (strcmp(msg.text, "/start") == 0)
-            {
-                char reply[2048];
-                snprintf(reply, sizeof(reply),
-                    "👋 Привет, %s!\n\n"
-                    "Я — <b>OXXYEN Bot</b> 🧠\n"
-                    "Бот, написанный полностью на чистом C.\n\n"
-                    "⚙️ Команды:\n"
-                    "  • /help — справка\n"
-                    "  • /dice — бросить кубик 🎲",
-                    msg.from->first_name);
-
-                telebot_send_message(handle, chat_id, reply, "HTML", false, false, msg.message_id, "");
-            }
-            else if (strcmp(msg.text, "/help") == 0)
-            {
-                const char *help_msg =
-                    "📘 <b>Помощь</b>\n\n"
-                    "Мои команды:\n"
-                    "  • /start — приветствие\n"
-                    "  • /help — показать это сообщение\n"
-                    "  • /dice — бросить случайный кубик 🎲\n\n"
-                    "👨‍💻 Минимализм и скорость — сила C.";
-
-                telebot_send_message(handle, chat_id, help_msg, "HTML", false, false, msg.message_id, "");
-            }
-            else if(msg.text && strcmp(msg.text, "admin_chat") == 0) {
+            if (strcmp(msg.text, "admin_chat") == 0) {
                 admin_notify_incoming(&msg);
+                t_send = trace_now();
                 telebot_send_message(handle, chat_id, "✅ Ваше сообщение доставлено администратору.", "", false, false, msg.message_id, "");
+                trace_span(trace_id, "telegram", "send_message", t_send, chat_id);
             }
-            else if (strcmp(msg.text, "/dice") == 0)
-            {
-                telebot_send_dice(handle, chat_id, false, 0, "");
-            }
-            else
+            else if (shards && !(llm_sched && msg.text[0] != '/'))
             {
-                telebot_send_message(handle, chat_id,
-                    "🤖 Неизвестная команда.\nВведите /help, чтобы узнать доступные.", 
-                    "", false, false, msg.message_id, "");
+                // ответит шард чата; здесь — только постановка в его очередь.
+                // Текст для модели идёт мимо шардов: reply_text ниже лишь
+                // ставит его в общую очередь и не задерживает опрос
+                ShardUpdate u = {
+                    .update_id = updates[i].update_id,
+                    .chat_id = chat_id,
+                    .message_id = msg.message_id,
+                    .from_id = msg.from->id,
+                    .first_name = msg.from->first_name,
+                    .text = msg.text,
+                };
+                if (shard_dispatch(shards, &u) != 0)
+                    ALOG(ALOG_ERROR, "shard.dispatch_failed", AF_I("update", u.update_id), AF_I("chat", chat_id));
+                trace_span(trace_id, "shard", "dispatch", t_req, chat_id);
             }
+            else t_send = reply_text(trace_id, chat_id, msg.from->id, msg.message_id, msg.from->first_name, msg.text);
 
+            // разбор и выбор ответа — всё до отправки
+            if (t_send) trace_interval(trace_id, "bot", "dispatch", t_req, t_send, chat_id);
+            trace_request_end(trace_id, "update", t_req, chat_id);
             offset = updates[i].update_id + 1;
         }
 
         telebot_put_updates(updates, count);
+        // полная пачка у шардов — в очереди ещё апдейты, паузу пропускаем
+        if (shards && count == limit) continue;
+        uint64_t t_sleep = trace_now();
         sleep(1);
+        trace_span(0, "loop", "sleep", t_sleep, 0);
     }
 
+    shard_stop(shards, 5000);
+    llm_sched_destroy(llm_sched);
     admin_terminal_stop();
 
     telebot_destroy(handle);
@@ -0,0 +1,86 @@
+import fs from 'fs';
+import { color } from './chalk-colors.js';
+import { INDEX_SUFFIX, HEADER_SIZE, INDEX_MAGIC, INDEX_VERSION, validRecord, encodeRecord } from './prompt_store.js';
+
+// КОМПАКТИЗАЦИЯ memory.txt
+//
+// node compact.js [путь] [--keep-duplicates]
+// Читает лог в любом виде — JSONL или старые многострочные объекты подряд
+// (JSON.stringify(..., null, 2) из прошлых версий create_prompt.js), —
+// выбрасывает битые записи и точные повторы и атомарно переписывает
+// лог и индекс (tmp + fsync + rename).
+
+const args = process.argv.slice(2);
+const keepDuplicates = args.includes('--keep-duplicates');
+const PATH = args.find(a => !a.startsWith('--')) ?? '../memory.txt';
+
+
+
+// ВСЕ JSON-ОБЪЕКТЫ ВЕРХНЕГО УРОВНЯ ПОДРЯД (с учетом строк и экранирования)
+function* topLevelObjects(text) {
+    let depth = 0, start = -1, inString = false, escaped = false;
+    for (let i = 0; i < text.length; i++) {
+        const c = text[i];
+        if (inString) {
+            if (escaped) escaped = false;
+            else if (c === '\\') escaped = true;
+            else if (c === '"') inString = false;
+            continue;
+        }
+        if (c === '"') inString = depth > 0;
+        else if (c === '{') { if (depth++ === 0) start = i; }
+        else if (c === '}' && depth > 0 && --depth === 0) yield text.slice(start, i + 1);
+    }
+}
+
+
+
+function writeSynced(path, buffers) {
+    const fd = fs.openSync(path, 'w');
+    for (const b of buffers) fs.writeSync(fd, b);
+    fs.fsyncSync(fd);
+    fs.closeSync(fd);
+}
+
+
+
+function main() {
+    const text = fs.existsSync(PATH) ? fs.readFileSync(PATH, 'utf8') : '';
+    const seen = new Set();
+    const lines = [];
+    let total = 0, broken = 0, duplicates = 0, size = 0;
+    const offsets = [];
+
+    for (const chunk of topLevelObjects(text)) {
+        total++;
+        let obj;
+        try { obj = JSON.parse(chunk); } catch { broken++; continue; }
+        if (!validRecord(obj)) { broken++; continue; }
+        const line = encodeRecord(obj);
+        const key = line.toString('utf8');
+        if (!keepDuplicates) {
+            if (seen.has(key)) { duplicates++; continue; }
+            seen.add(key);
+        }
+        offsets.push(size);
+        lines.push(line);
+        size += line.length;
+    }
+
+    const index = Buffer.alloc(HEADER_SIZE + offsets.length * 8);
+    index.write(INDEX_MAGIC, 0, 'latin1');
+    index.writeUInt32LE(INDEX_VERSION, 8);
+    offsets.forEach((off, k) => index.writeBigUInt64LE(BigInt(off), HEADER_SIZE + k * 8));
+
+    // Старый индекс убираем до подмены лога: без .idx читатели перестроят его сами
+    writeSynced(PATH + '.tmp', lines);
+    writeSynced(PATH + INDEX_SUFFIX + '.tmp', [index]);
+    fs.rmSync(PATH + INDEX_SUFFIX, { force: true });
+    fs.renameSync(PATH + '.tmp', PATH);
+    fs.renameSync(PATH + INDEX_SUFFIX + '.tmp', PATH + INDEX_SUFFIX);
+
+    console.log(color.info(`${PATH}: ${offsets.length} записей`) +
+        ` (было ${total}, битых ${broken}, повторов ${duplicates})`);
+}
+
+main();
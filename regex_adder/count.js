@@ -1,21 +1,21 @@
-import fs from 'fs';
+import { PromptStore } from './prompt_store.js';
 
 const PATH = '../memory.txt';
 
+// node count.js            — число промптов (из индекса, без чтения лога)
+// node count.js --sample N — плюс N случайных записей
 async function main() {
-    let regex = /\{\s*"instruction"\s*:\s*".*?"\s*,\s*"output"\s*:\s*".*?"\s*\}/
-    let count = 0;
-    let data;
-
     try {
-        data = fs.readFileSync(PATH, 'utf8');  
-        data = data.split(regex);    // >> разбиваем по блокам (каждый блок = индекс)
+        const store = new PromptStore(PATH, { readOnly: true });
+        console.log(store.count())
 
-        for (let i = 0; i < data.length; i++) {
-            count++;
+        const at = process.argv.indexOf('--sample');
+        if (at > 0) {
+            for (const rec of store.sample(parseInt(process.argv[at + 1] ?? '1', 10))) {
+                console.log(JSON.stringify(rec, null, 2));
+            }
         }
-
-        console.log(count)
+        store.close();
 
     } catch (error) {
         console.error("Не удалось посчитать кол-во промтов: ", error);
@@ -1,7 +1,7 @@
 import readline from 'readline';
-import fs from 'fs';
 import { color } from './chalk-colors.js';
 import { regex_validator } from './sanitizer.js';
+import { PromptStore } from './prompt_store.js';
 
 // СОЗДАЕМ ОБЪЕКТ ИНТЕРФЕЙС
 const rl = readline.createInterface({
@@ -72,6 +72,9 @@ async function get_prompt() {
 
 // ОБЕРТКА
 async function main() {
+    // memory.txt — JSONL с индексом (prompt_store.js); fsync пачкой и при выходе
+    const store = new PromptStore('../memory.txt');
+
     try {
         let exit = false;
         let counter = 0;
@@ -84,11 +87,12 @@ async function main() {
                 console.log(`${counter == 0 ? "" : "    --> ПРИМЕЧАНИЕ: ПОСЛЕДНИЕ изменения не были внесены, все предыдущие промпты были записаны"}`);
 
                 exit = true;      //<<останавливаем цикл
+                store.close();    //<< сбрасываем несинхронизированные записи на диск
                 process.exit(0); //<< завершаем процесс**
             }
 
-            await fs.appendFileSync('../memory.txt', JSON.stringify(result.data_info, null, 2) + "\n");
-            console.log(color.info("данные успешно записаны!\n"))
+            const id = store.append(result.data_info);
+            console.log(color.info(`данные успешно записаны! (#${id})\n`))
 
             counter++
         }
@@ -0,0 +1,217 @@
+import fs from 'fs';
+
+// ХРАНИЛИЩЕ ПРОМПТОВ: append-only JSONL + индекс смещений
+//
+// memory.txt        — по одной записи {"instruction","output"} на строку
+// memory.txt.idx    — заголовок (32 байта) + uint64 LE смещение начала каждой записи
+//
+// Число записей = (размер индекса - 32) / 8, запись i читается одним pread
+// без пересканирования лога. fsync — пачками (каждые syncEvery записей или
+// syncMs миллисекунд) и при закрытии: сначала лог, потом индекс, так что
+// индекс никогда не опережает лог на диске. После сбоя open() отрезает
+// недописанный хвост лога и доиндексирует строки, не попавшие в индекс.
+// Тот же формат читает dataset/prompt_store.c.
+
+export const INDEX_MAGIC = 'OXPSIDX1';
+export const INDEX_VERSION = 1;
+export const HEADER_SIZE = 32;
+export const INDEX_SUFFIX = '.idx';
+
+const LEGACY_HINT = 'старый формат (многострочные объекты) — сначала запусти: node compact.js';
+
+function makeHeader() {
+    const hdr = Buffer.alloc(HEADER_SIZE);
+    hdr.write(INDEX_MAGIC, 0, 'latin1');
+    hdr.writeUInt32LE(INDEX_VERSION, 8);
+    return hdr;
+}
+
+// ПРОВЕРКА ЗАПИСИ: ровно то, что кладём в лог
+export function validRecord(obj) {
+    return obj !== null && typeof obj === 'object' &&
+        typeof obj.instruction === 'string' && typeof obj.output === 'string';
+}
+
+export function encodeRecord(obj) {
+    return Buffer.from(JSON.stringify({ instruction: obj.instruction, output: obj.output }) + '\n', 'utf8');
+}
+
+// СМЕЩЕНИЯ ВСЕХ СТРОК В БУФЕРЕ (base — смещение буфера в логе)
+function scanLines(buf, base, offsets) {
+    let start = 0;
+    while (start < buf.length) {
+        const nl = buf.indexOf(0x0a, start);
+        if (nl < 0) break;
+        if (nl > start) offsets.push(base + start);
+        start = nl + 1;
+    }
+    return start; // конец последней полной строки
+}
+
+export class PromptStore {
+    constructor(path, { syncEvery = 64, syncMs = 1000, readOnly = false } = {}) {
+        this.path = path;
+        this.indexPath = path + INDEX_SUFFIX;
+        this.syncEvery = syncEvery;
+        this.syncMs = syncMs;
+        this.readOnly = readOnly;
+        this.unsynced = 0;
+        this.timer = null;
+        this.open();
+    }
+
+    open() {
+        const flags = this.readOnly ? 'r' : 'a+';
+        if (this.readOnly && !fs.existsSync(this.path)) {
+            this.logFd = this.indexFd = null;
+            this.logSize = 0;
+            this.n = 0;
+            return;
+        }
+        this.logFd = fs.openSync(this.path, flags);
+        this.logSize = fs.fstatSync(this.logFd).size;
+
+        let idxOk = false;
+        if (fs.existsSync(this.indexPath)) {
+            this.indexFd = fs.openSync(this.indexPath, this.readOnly ? 'r' : 'r+');
+            const hdr = Buffer.alloc(HEADER_SIZE);
+            const got = fs.readSync(this.indexFd, hdr, 0, HEADER_SIZE, 0);
+            idxOk = got === HEADER_SIZE && hdr.toString('latin1', 0, 8) === INDEX_MAGIC &&
+                hdr.readUInt32LE(8) === INDEX_VERSION;
+            if (!idxOk) fs.closeSync(this.indexFd);
+        }
+        if (!idxOk) {
+            if (this.readOnly) {
+                this.indexFd = null;
+                this.memOffsets = this.rebuild();
+                this.n = this.memOffsets.length;
+                return;
+            }
+            this.indexFd = fs.openSync(this.indexPath, 'w+');
+            fs.writeSync(this.indexFd, makeHeader(), 0, HEADER_SIZE, 0);
+        }
+        this.n = Math.floor((fs.fstatSync(this.indexFd).size - HEADER_SIZE) / 8);
+        while (this.n > 0 && !this.entryValid(this.n - 1)) this.n--;
+        if (!this.readOnly) this.recover();
+    }
+
+    // ИНДЕКС ЗАНОВО ПО ЛОГУ (нет .idx или он чужой)
+    rebuild() {
+        const buf = this.logSize ? fs.readFileSync(this.path) : Buffer.alloc(0);
+        if (buf.length && buf.toString('utf8', 0, Math.min(buf.length, 2)).trim() === '{') {
+            throw new Error(`${this.path}: ${LEGACY_HINT}`);
+        }
+        const offsets = [];
+        scanLines(buf, 0, offsets);
+        return offsets;
+    }
+
+    readOffset(i) {
+        const b = Buffer.alloc(8);
+        fs.readSync(this.indexFd, b, 0, 8, HEADER_SIZE + i * 8);
+        return Number(b.readBigUInt64LE(0));
+    }
+
+    // Запись i валидна, если начинается внутри лога сразу после '\n'
+    entryValid(i) {
+        const off = this.readOffset(i);
+        if (off >= this.logSize) return false;
+        if (off === 0) return true;
+        const b = Buffer.alloc(1);
+        fs.readSync(this.logFd, b, 0, 1, off - 1);
+        return b[0] === 0x0a;
+    }
+
+    // ВОССТАНОВЛЕНИЕ ПОСЛЕ СБОЯ: лишние записи индекса, рваный хвост лога, недоиндексированные строки
+    recover() {
+        if (this.n === 0) this.rebuild(); // только проверка старого формата
+        const from = this.n ? this.readOffset(this.n - 1) : 0;
+        const len = this.logSize - from;
+        const buf = Buffer.alloc(len);
+        if (len) fs.readSync(this.logFd, buf, 0, len, from);
+        const offsets = [];
+        const end = scanLines(buf, from, offsets);
+        let keep = this.n;
+        if (keep) {
+            // первая строка хвоста — уже проиндексированная запись n-1 (если она дописана)
+            if (offsets.length && offsets[0] === from) offsets.shift();
+            else keep--;
+        }
+        this.truncateIndex(keep);
+        this.appendOffsets(offsets);
+        if (from + end < this.logSize) {
+            fs.ftruncateSync(this.logFd, from + end);
+            this.logSize = from + end;
+        }
+        this.sync();
+    }
+
+    truncateIndex(n) {
+        fs.ftruncateSync(this.indexFd, HEADER_SIZE + n * 8);
+        this.n = n;
+    }
+
+    appendOffsets(offsets) {
+        if (!offsets.length) return;
+        const b = Buffer.alloc(offsets.length * 8);
+        offsets.forEach((off, k) => b.writeBigUInt64LE(BigInt(off), k * 8));
+        fs.writeSync(this.indexFd, b, 0, b.length, HEADER_SIZE + this.n * 8);
+        this.n += offsets.length;
+    }
+
+    count() {
+        return this.n;
+    }
+
+    // ДОБАВЛЕНИЕ: строка в лог, смещение в индекс, fsync пачкой
+    append(obj) {
+        if (this.readOnly) throw new Error('хранилище открыто только для чтения');
+        if (!validRecord(obj)) throw new Error('нужны строковые поля instruction и output');
+        const line = encodeRecord(obj);
+        const off = this.logSize;
+        fs.writeSync(this.logFd, line, 0, line.length, off);
+        this.logSize += line.length;
+        this.appendOffsets([off]);
+
+        if (++this.unsynced >= this.syncEvery) {
+            this.sync();
+        } else if (!this.timer && this.syncMs > 0) {
+            this.timer = setTimeout(() => this.sync(), this.syncMs);
+            this.timer.unref();
+        }
+        return this.n - 1;
+    }
+
+    sync() {
+        if (this.timer) { clearTimeout(this.timer); this.timer = null; }
+        if (this.readOnly || this.logFd === null) return;
+        fs.fdatasyncSync(this.logFd);
+        fs.fdatasyncSync(this.indexFd);
+        this.unsynced = 0;
+    }
+
+    // ЗАПИСЬ ПО НОМЕРУ — один pread по смещениям i и i+1
+    get(i) {
+        if (i < 0 || i >= this.n) throw new RangeError(`нет записи ${i} (всего ${this.n})`);
+        const off = this.memOffsets ? this.memOffsets[i] : this.readOffset(i);
+        const next = i + 1 < this.n ? (this.memOffsets ? this.memOffsets[i + 1] : this.readOffset(i + 1)) : this.logSize;
+        const buf = Buffer.alloc(next - off);
+        fs.readSync(this.logFd, buf, 0, buf.length, off);
+        return JSON.parse(buf.toString('utf8'));
+    }
+
+    // k СЛУЧАЙНЫХ ЗАПИСЕЙ БЕЗ ПОВТОРОВ
+    sample(k) {
+        const picked = new Set();
+        k = Math.min(k, this.n);
+        while (picked.size < k) picked.add(Math.floor(Math.random() * this.n));
+        return [...picked].map(i => this.get(i));
+    }
+
+    close() {
+        this.sync();
+        if (this.logFd !== null) fs.closeSync(this.logFd);
+        if (this.indexFd !== null && this.indexFd !== undefined) fs.closeSync(this.indexFd);
+        this.logFd = this.indexFd = null;
+    }
+}
@@ -0,0 +1,710 @@
+// shard.c — consistent hashing чатов по рабочим процессам (см. shard.h)
+
+#define _GNU_SOURCE
+#include "shard.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#define SHARD_MAX_NAME 256
+#define SHARD_BACKOFF_MIN_MS 1000
+#define SHARD_BACKOFF_MAX_MS 30000
+#define SHARD_TICK_MS 100
+
+enum { MSG_UPDATE = 1, MSG_ACK, MSG_PING, MSG_PONG };
+
+// Заголовок сообщения в сокете; за ним имя и текст без '\0'.
+// Остановка шарда — shutdown(SHUT_WR): он видит EOF и выходит
+typedef struct {
+    uint32_t type;
+    uint32_t name_len;
+    uint32_t text_len;
+    uint32_t pad;
+    int64_t update_id;
+    int64_t chat_id;
+    int64_t message_id;
+    int64_t from_id;
+} Wire;
+
+// Апдейт в очереди шарда до ACK
+typedef struct Pending {
+    struct Pending *next;
+    int64_t update_id;
+    int64_t chat_id;
+    int attempts;
+    size_t len;
+    unsigned char buf[];       // Wire + имя + текст
+} Pending;
+
+typedef struct {
+    Pending *head, *tail;
+} Queue;
+
+enum { SLOT_EMPTY, SLOT_UP, SLOT_DOWN, SLOT_DRAIN };
+
+typedef struct {
+    int state;                 // DOWN — упал и ждёт перезапуска, DRAIN — выводится
+    pid_t pid;
+    int fd;
+    Queue q;
+    Pending *unsent;           // первый ещё не отправленный в q
+    int inflight;
+    int shut;                  // DRAIN: SHUT_WR уже сделан
+    uint64_t ping_at;          // PING без ответа отправлен тогда; 0 — не ждём
+    uint64_t last_ping;
+    uint64_t restart_at;
+    uint32_t backoff_ms;
+} Slot;
+
+typedef struct {
+    uint64_t hash;
+    int slot;
+} Point;
+
+// Чат с неподтверждёнными апдейтами и его шард (-1 — в parked)
+typedef struct {
+    int64_t chat;
+    int slot;
+    int count;                 // 0 — пустая ячейка
+} ChatEnt;
+
+struct ShardRouter {
+    ShardConfig cfg;
+    pthread_mutex_t mu;
+    pthread_cond_t room;
+    int stop;
+    int target;
+    Slot slots[SHARD_MAX_WORKERS];
+    Point *ring;
+    int ring_n;
+    ChatEnt *chats;
+    size_t chats_cap, chats_n;
+    Queue parked;
+    int n_parked;
+    int inflight;
+    int wake[2];
+    pthread_t thread;
+    int started;
+    ShardStats st;
+};
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ull + (uint64_t)ts.tv_nsec / 1000000ull;
+}
+
+static uint64_t mix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+static void queue_push(Queue *q, Pending *p) {
+    p->next = NULL;
+    if (q->tail) q->tail->next = p;
+    else q->head = p;
+    q->tail = p;
+}
+
+static void queue_free(Queue *q) {
+    while (q->head) {
+        Pending *p = q->head;
+        q->head = p->next;
+        free(p);
+    }
+    q->tail = NULL;
+}
+
+// ---- кольцо ----
+
+static int point_cmp(const void *a, const void *b) {
+    uint64_t x = ((const Point *)a)->hash, y = ((const Point *)b)->hash;
+    return x < y ? -1 : x > y;
+}
+
+// Точки шарда зависят только от его номера: перезапуск возвращает ему те же чаты
+static void ring_rebuild(ShardRouter *r) {
+    r->ring_n = 0;
+    for (int i = 0; i < SHARD_MAX_WORKERS; i++) {
+        if (r->slots[i].state != SLOT_UP) continue;
+        for (int v = 0; v < r->cfg.vnodes; v++) {
+            Point *pt = &r->ring[r->ring_n++];
+            pt->hash = mix64(((uint64_t)i << 32 | (uint32_t)v) ^ 0x5348415244ull);
+            pt->slot = i;
+        }
+    }
+    qsort(r->ring, (size_t)r->ring_n, sizeof(Point), point_cmp);
+}
+
+static int ring_lookup(const ShardRouter *r, int64_t chat) {
+    if (r->ring_n == 0) return -1;
+    uint64_t h = mix64((uint64_t)chat);
+    int lo = 0, hi = r->ring_n;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (r->ring[mid].hash < h) lo = mid + 1;
+        else hi = mid;
+    }
+    return r->ring[lo == r->ring_n ? 0 : lo].slot;
+}
+
+// ---- чаты с апдейтами в пути: открытая адресация ----
+
+static ChatEnt *chat_find(ShardRouter *r, int64_t chat) {
+    size_t mask = r->chats_cap - 1;
+    for (size_t i = mix64((uint64_t)chat) & mask;; i = (i + 1) & mask) {
+        ChatEnt *e = &r->chats[i];
+        if (e->count == 0) return NULL;
+        if (e->chat == chat) return e;
+    }
+}
+
+static void chat_place(ChatEnt *tab, size_t cap, ChatEnt e) {
+    size_t mask = cap - 1;
+    size_t i = mix64((uint64_t)e.chat) & mask;
+    while (tab[i].count) i = (i + 1) & mask;
+    tab[i] = e;
+}
+
+static int chat_inc(ShardRouter *r, int64_t chat, int slot) {
+    ChatEnt *e = chat_find(r, chat);
+    if (e) {
+        e->count++;
+        return 0;
+    }
+    if ((r->chats_n + 1) * 2 > r->chats_cap) {
+        size_t cap = r->chats_cap * 2;
+        ChatEnt *tab = calloc(cap, sizeof(ChatEnt));
+        if (!tab) return -1;
+        for (size_t i = 0; i < r->chats_cap; i++)
+            if (r->chats[i].count) chat_place(tab, cap, r->chats[i]);
+        free(r->chats);
+        r->chats = tab;
+        r->chats_cap = cap;
+    }
+    chat_place(r->chats, r->chats_cap, (ChatEnt){ chat, slot, 1 });
+    r->chats_n++;
+    return 0;
+}
+
+// Удаление со сдвигом назад: цепочки проб остаются без дыр
+static void chat_dec(ShardRouter *r, int64_t chat) {
+    ChatEnt *e = chat_find(r, chat);
+    if (!e || --e->count > 0) return;
+    size_t mask = r->chats_cap - 1;
+    size_t hole = (size_t)(e - r->chats);
+    for (size_t i = (hole + 1) & mask; r->chats[i].count; i = (i + 1) & mask) {
+        size_t home = mix64((uint64_t)r->chats[i].chat) & mask;
+        // ячейка i может переехать в hole, если hole лежит между home и i
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            r->chats[hole] = r->chats[i];
+            hole = i;
+        }
+    }
+    r->chats[hole].count = 0;
+    r->chats_n--;
+}
+
+// ---- очереди шардов ----
+
+static void slot_flush(Slot *s) {
+    while (s->unsent) {
+        ssize_t n = send(s->fd, s->unsent->buf, s->unsent->len, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            // EAGAIN — допишет надзиратель по POLLOUT; обрыв он же заметит по EOF
+            return;
+        }
+        s->unsent = s->unsent->next;
+    }
+}
+
+// Чат с апдейтами в пути остаётся у своего шарда; иначе — по кольцу
+static void route(ShardRouter *r, Pending *p) {
+    ChatEnt *e = chat_find(r, p->chat_id);
+    int slot = e ? e->slot : ring_lookup(r, p->chat_id);
+    if (chat_inc(r, p->chat_id, slot) != 0) slot = -1;
+    if (slot < 0) {
+        queue_push(&r->parked, p);
+        r->n_parked++;
+        return;
+    }
+    Slot *s = &r->slots[slot];
+    queue_push(&s->q, p);
+    s->inflight++;
+    if (!s->unsent) s->unsent = p;
+    slot_flush(s);
+}
+
+// Перераспределить список по текущему кольцу, сохраняя порядок
+static void reroute(ShardRouter *r, Pending *list, int redispatch) {
+    for (Pending *p = list; p; p = p->next) chat_dec(r, p->chat_id);
+    while (list) {
+        Pending *p = list;
+        list = p->next;
+        if (redispatch && p->attempts >= SHARD_MAX_ATTEMPTS) {
+            fprintf(stderr, "⚠️ Апдейт %lld (чат %lld) уронил шард %d раза, пропускаем\n",
+                    (long long)p->update_id, (long long)p->chat_id, p->attempts);
+            r->inflight--;
+            r->st.dropped++;
+            free(p);
+            pthread_cond_broadcast(&r->room);
+            continue;
+        }
+        if (redispatch) r->st.redispatched++;
+        route(r, p);
+    }
+}
+
+static void unpark(ShardRouter *r) {
+    if (!r->parked.head || r->ring_n == 0) return;
+    Pending *list = r->parked.head;
+    r->parked.head = r->parked.tail = NULL;
+    r->n_parked = 0;
+    reroute(r, list, 0);
+}
+
+// ---- рабочий процесс ----
+
+static int send_all(int fd, const void *buf, size_t len) {
+    for (;;) {
+        ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+        if (n >= 0) return 0;
+        if (errno != EINTR) return -1;
+    }
+}
+
+static void __attribute__((noreturn)) worker_main(ShardRouter *r, int shard, int fd) {
+    // Ctrl-C и SIGHUP — дело ingress: он дождётся очередей и закроет сокеты
+    sigset_t all;
+    sigemptyset(&all);
+    sigprocmask(SIG_SETMASK, &all, NULL);
+    signal(SIGINT, SIG_IGN);
+    signal(SIGHUP, SIG_IGN);
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGPIPE, SIG_IGN);
+
+    if (r->cfg.init && r->cfg.init(shard, r->cfg.ctx) != 0) {
+        fflush(NULL);
+        _exit(1);
+    }
+    size_t cap = sizeof(Wire) + SHARD_MAX_NAME + SHARD_MAX_TEXT;
+    unsigned char *buf = malloc(cap);
+    char *name = malloc(SHARD_MAX_NAME + 1);
+    char *text = malloc(SHARD_MAX_TEXT + 1);
+    if (!buf || !name || !text) _exit(1);
+
+    for (;;) {
+        ssize_t n = recv(fd, buf, cap, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0 || (size_t)n < sizeof(Wire)) break;
+        Wire w;
+        memcpy(&w, buf, sizeof(w));
+        if (w.type == MSG_PING) {
+            Wire pong = { .type = MSG_PONG };
+            if (send_all(fd, &pong, sizeof(pong)) != 0) break;
+            continue;
+        }
+        if (w.type != MSG_UPDATE || w.name_len > SHARD_MAX_NAME || w.text_len > SHARD_MAX_TEXT
+            || sizeof(Wire) + w.name_len + w.text_len != (size_t)n) continue;
+        memcpy(name, buf + sizeof(Wire), w.name_len);
+        name[w.name_len] = '\0';
+        memcpy(text, buf + sizeof(Wire) + w.name_len, w.text_len);
+        text[w.text_len] = '\0';
+        ShardUpdate u = {
+            .update_id = w.update_id,
+            .chat_id = w.chat_id,
+            .message_id = w.message_id,
+            .from_id = w.from_id,
+            .first_name = name,
+            .text = text,
+        };
+        r->cfg.handle(shard, &u, r->cfg.ctx);
+        Wire ack = { .type = MSG_ACK, .update_id = w.update_id, .chat_id = w.chat_id };
+        if (send_all(fd, &ack, sizeof(ack)) != 0) break;
+    }
+    // exit, а не _exit: обработчики atexit дописывают буферы (stdio, alog)
+    exit(0);
+}
+
+// fork шарда в слот i; после fork ребёнок не трогает мьютекс и очереди ingress
+static int spawn(ShardRouter *r, int i) {
+    Slot *s = &r->slots[i];
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) != 0) return -1;
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(sv[0]);
+        close(sv[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        // чужие сокеты в шарде не дали бы ingress увидеть EOF соседей
+        for (int j = 0; j < SHARD_MAX_WORKERS; j++)
+            if (r->slots[j].fd >= 0) close(r->slots[j].fd);
+        close(r->wake[0]);
+        close(r->wake[1]);
+        close(sv[0]);
+        worker_main(r, i, sv[1]);
+    }
+    close(sv[1]);
+    s->pid = pid;
+    s->fd = sv[0];
+    s->state = SLOT_UP;
+    s->shut = 0;
+    s->ping_at = 0;
+    s->last_ping = now_ms();
+    return 0;
+}
+
+// Шард завершился или убит: его очередь уходит новым владельцам
+static void slot_down(ShardRouter *r, int i, const char *why) {
+    Slot *s = &r->slots[i];
+    kill(s->pid, SIGKILL);
+    int status = 0;
+    while (waitpid(s->pid, &status, 0) < 0 && errno == EINTR) {}
+    close(s->fd);
+    s->fd = -1;
+    Pending *list = s->q.head;
+    // шард обрабатывал первый отправленный апдейт — он и под подозрением
+    if (list && list != s->unsent) list->attempts++;
+    s->q.head = s->q.tail = s->unsent = NULL;
+    s->inflight = 0;
+
+    if (s->state == SLOT_DRAIN) {
+        s->state = SLOT_EMPTY;
+        if (list) fprintf(stderr, "⚠️ Шард %d (pid %d) остановлен с очередью: %s\n", i, (int)s->pid, why);
+    } else {
+        r->st.deaths++;
+        s->state = SLOT_DOWN;
+        s->restart_at = now_ms() + s->backoff_ms;
+        fprintf(stderr, "⚠️ Шард %d (pid %d): %s, перезапуск через %u мс\n",
+                i, (int)s->pid, why, s->backoff_ms);
+        s->backoff_ms = s->backoff_ms * 2 > SHARD_BACKOFF_MAX_MS ? SHARD_BACKOFF_MAX_MS : s->backoff_ms * 2;
+    }
+    s->pid = -1;
+    ring_rebuild(r);
+    reroute(r, list, 1);
+}
+
+static void handle_msg(ShardRouter *r, Slot *s, const Wire *w) {
+    if (w->type == MSG_PONG) {
+        s->ping_at = 0;
+        return;
+    }
+    if (w->type != MSG_ACK) return;
+    // шард обрабатывает очередь по порядку: подтверждённый — обычно первый
+    Pending *prev = NULL, *p = s->q.head;
+    while (p && p->update_id != w->update_id) {
+        prev = p;
+        p = p->next;
+    }
+    if (!p || p == s->unsent) return;
+    if (prev) prev->next = p->next;
+    else s->q.head = p->next;
+    if (s->q.tail == p) s->q.tail = prev;
+    chat_dec(r, p->chat_id);
+    free(p);
+    s->inflight--;
+    s->backoff_ms = SHARD_BACKOFF_MIN_MS;
+    r->inflight--;
+    r->st.acked++;
+    pthread_cond_broadcast(&r->room);
+}
+
+// Число шардов → target: новые запускаются, лишние выводятся с конца
+static void apply_target(ShardRouter *r) {
+    int active = 0, changed = 0;
+    for (int i = 0; i < SHARD_MAX_WORKERS; i++)
+        if (r->slots[i].state == SLOT_UP || r->slots[i].state == SLOT_DOWN) active++;
+    for (int i = 0; i < SHARD_MAX_WORKERS && active < r->target; i++) {
+        Slot *s = &r->slots[i];
+        if (s->state != SLOT_EMPTY) continue;
+        s->backoff_ms = SHARD_BACKOFF_MIN_MS;
+        if (spawn(r, i) != 0) {
+            s->state = SLOT_DOWN;
+            s->restart_at = now_ms() + s->backoff_ms;
+        }
+        active++;
+        changed = 1;
+    }
+    for (int i = SHARD_MAX_WORKERS - 1; i >= 0 && active > r->target; i--) {
+        Slot *s = &r->slots[i];
+        if (s->state == SLOT_DOWN) s->state = SLOT_EMPTY;
+        else if (s->state == SLOT_UP) s->state = SLOT_DRAIN;
+        else continue;
+        active--;
+        changed = 1;
+    }
+    if (changed) {
+        ring_rebuild(r);
+        unpark(r);
+    }
+}
+
+// Перезапуски, пинги, зависания, остановка опустевших выводимых
+static void housekeeping(ShardRouter *r) {
+    uint64_t now = now_ms();
+    apply_target(r);
+    for (int i = 0; i < SHARD_MAX_WORKERS; i++) {
+        Slot *s = &r->slots[i];
+        if (s->state == SLOT_DOWN && now >= s->restart_at) {
+            if (spawn(r, i) == 0) {
+                r->st.restarts++;
+                ring_rebuild(r);
+                unpark(r);
+            } else {
+                s->restart_at = now + s->backoff_ms;
+            }
+            continue;
+        }
+        if (s->state != SLOT_UP && s->state != SLOT_DRAIN) continue;
+        if (s->ping_at && now - s->ping_at > (uint64_t)r->cfg.timeout_ms) {
+            r->st.hung++;
+            slot_down(r, i, "нет ответа на PING");
+            continue;
+        }
+        if (!s->ping_at && now - s->last_ping >= (uint64_t)r->cfg.heartbeat_ms) {
+            Wire ping = { .type = MSG_PING };
+            s->last_ping = now;
+            if (send(s->fd, &ping, sizeof(ping), MSG_DONTWAIT | MSG_NOSIGNAL) == (ssize_t)sizeof(ping))
+                s->ping_at = now;
+        }
+        if (s->state == SLOT_DRAIN && s->inflight == 0 && !s->shut) {
+            shutdown(s->fd, SHUT_WR);
+            s->shut = 1;
+        }
+    }
+}
+
+static void *supervisor(void *arg) {
+    ShardRouter *r = arg;
+    struct pollfd pfd[SHARD_MAX_WORKERS + 1];
+    int idx[SHARD_MAX_WORKERS + 1];
+    Wire w;
+
+    pthread_mutex_lock(&r->mu);
+    while (!r->stop) {
+        housekeeping(r);
+        int n = 0;
+        pfd[n].fd = r->wake[0];
+        pfd[n].events = POLLIN;
+        idx[n++] = -1;
+        for (int i = 0; i < SHARD_MAX_WORKERS; i++) {
+            Slot *s = &r->slots[i];
+            if (s->state != SLOT_UP && s->state != SLOT_DRAIN) continue;
+            pfd[n].fd = s->fd;
+            pfd[n].events = POLLIN | (s->unsent ? POLLOUT : 0);
+            idx[n++] = i;
+        }
+        // сокеты шардов меняет только этот поток: набор валиден и без мьютекса
+        pthread_mutex_unlock(&r->mu);
+        int rc = poll(pfd, (nfds_t)n, SHARD_TICK_MS);
+        pthread_mutex_lock(&r->mu);
+        if (rc <= 0) continue;
+
+        if (pfd[0].revents) {
+            char drain[64];
+            while (read(r->wake[0], drain, sizeof(drain)) > 0) {}
+        }
+        for (int k = 1; k < n; k++) {
+            if (!pfd[k].revents) continue;
+            Slot *s = &r->slots[idx[k]];
+            const char *why = NULL;
+            if (pfd[k].revents & (POLLIN | POLLHUP | POLLERR)) {
+                for (;;) {
+                    ssize_t got = recv(s->fd, &w, sizeof(w), MSG_DONTWAIT);
+                    if (got == (ssize_t)sizeof(w)) {
+                        handle_msg(r, s, &w);
+                        continue;
+                    }
+                    if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+                    if (got < 0 && errno == EINTR) continue;
+                    if (got > 0) continue;
+                    why = got == 0 ? "процесс завершился" : strerror(errno);
+                    break;
+                }
+            }
+            if (why) slot_down(r, idx[k], why);
+            else if (pfd[k].revents & POLLOUT) slot_flush(s);
+        }
+    }
+    pthread_mutex_unlock(&r->mu);
+    return NULL;
+}
+
+static void wake(ShardRouter *r) {
+    char c = 1;
+    ssize_t rc = write(r->wake[1], &c, 1);
+    (void)rc;
+}
+
+// ---- API ----
+
+ShardRouter *shard_start(const ShardConfig *cfg) {
+    if (!cfg->handle || cfg->workers < 1 || cfg->workers > SHARD_MAX_WORKERS) return NULL;
+    ShardRouter *r = calloc(1, sizeof(*r));
+    if (!r) return NULL;
+    r->cfg = *cfg;
+    if (r->cfg.vnodes <= 0) r->cfg.vnodes = 64;
+    if (r->cfg.heartbeat_ms <= 0) r->cfg.heartbeat_ms = 1000;
+    if (r->cfg.timeout_ms <= 0) r->cfg.timeout_ms = 10000;
+    if (r->cfg.max_inflight <= 0) r->cfg.max_inflight = 4096;
+    r->target = cfg->workers;
+    r->wake[0] = r->wake[1] = -1;
+    for (int i = 0; i < SHARD_MAX_WORKERS; i++) {
+        r->slots[i].fd = -1;
+        r->slots[i].pid = -1;
+    }
+    r->chats_cap = 1024;
+    r->ring = malloc((size_t)SHARD_MAX_WORKERS * (size_t)r->cfg.vnodes * sizeof(Point));
+    r->chats = calloc(r->chats_cap, sizeof(ChatEnt));
+    if (!r->ring || !r->chats || pipe2(r->wake, O_NONBLOCK | O_CLOEXEC) != 0) {
+        free(r->ring);
+        free(r->chats);
+        free(r);
+        return NULL;
+    }
+    pthread_mutex_init(&r->mu, NULL);
+    pthread_cond_init(&r->room, NULL);
+
+    // первые шарды — до потока надзирателя: fork из однопоточного состояния модуля
+    apply_target(r);
+    if (pthread_create(&r->thread, NULL, supervisor, r) != 0) {
+        shard_stop(r, 0);
+        return NULL;
+    }
+    r->started = 1;
+    return r;
+}
+
+int shard_dispatch(ShardRouter *r, const ShardUpdate *u) {
+    size_t name_len = u->first_name ? strlen(u->first_name) : 0;
+    size_t text_len = u->text ? strlen(u->text) : 0;
+    if (text_len > SHARD_MAX_TEXT) return -1;
+    // имя — только для приветствия: длинное обрезаем
+    if (name_len > SHARD_MAX_NAME) name_len = SHARD_MAX_NAME;
+    size_t len = sizeof(Wire) + name_len + text_len;
+    Pending *p = malloc(sizeof(*p) + len);
+    if (!p) return -1;
+    p->update_id = u->update_id;
+    p->chat_id = u->chat_id;
+    p->attempts = 0;
+    p->len = len;
+    Wire w = {
+        .type = MSG_UPDATE,
+        .name_len = (uint32_t)name_len,
+        .text_len = (uint32_t)text_len,
+        .update_id = u->update_id,
+        .chat_id = u->chat_id,
+        .message_id = u->message_id,
+        .from_id = u->from_id,
+    };
+    memcpy(p->buf, &w, sizeof(w));
+    if (name_len) memcpy(p->buf + sizeof(w), u->first_name, name_len);
+    if (text_len) memcpy(p->buf + sizeof(w) + name_len, u->text, text_len);
+
+    pthread_mutex_lock(&r->mu);
+    while (r->inflight >= r->cfg.max_inflight && !r->stop)
+        pthread_cond_wait(&r->room, &r->mu);
+    if (r->stop) {
+        pthread_mutex_unlock(&r->mu);
+        free(p);
+        return -1;
+    }
+    r->inflight++;
+    r->st.dispatched++;
+    route(r, p);
+    pthread_mutex_unlock(&r->mu);
+    return 0;
+}
+
+int shard_resize(ShardRouter *r, int workers) {
+    if (workers < 1 || workers > SHARD_MAX_WORKERS) return -1;
+    pthread_mutex_lock(&r->mu);
+    r->target = workers;
+    pthread_mutex_unlock(&r->mu);
+    wake(r);
+    return 0;
+}
+
+void shard_stats(ShardRouter *r, ShardStats *out) {
+    pthread_mutex_lock(&r->mu);
+    *out = r->st;
+    out->workers = 0;
+    for (int i = 0; i < SHARD_MAX_WORKERS; i++)
+        if (r->slots[i].state == SLOT_UP) out->workers++;
+    out->inflight = r->inflight;
+    out->parked = r->n_parked;
+    pthread_mutex_unlock(&r->mu);
+}
+
+pid_t shard_pid(ShardRouter *r, int shard) {
+    if (shard < 0 || shard >= SHARD_MAX_WORKERS) return -1;
+    pthread_mutex_lock(&r->mu);
+    pid_t pid = r->slots[shard].state == SLOT_UP ? r->slots[shard].pid : -1;
+    pthread_mutex_unlock(&r->mu);
+    return pid;
+}
+
+void shard_stop(ShardRouter *r, int drain_ms) {
+    if (!r) return;
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_sec += drain_ms / 1000;
+    until.tv_nsec += (long)(drain_ms % 1000) * 1000000L;
+    if (until.tv_nsec >= 1000000000L) {
+        until.tv_sec++;
+        until.tv_nsec -= 1000000000L;
+    }
+    pthread_mutex_lock(&r->mu);
+    int running = r->started;
+    while (running && r->inflight > 0 && !r->stop)
+        if (pthread_cond_timedwait(&r->room, &r->mu, &until) == ETIMEDOUT) break;
+    r->stop = 1;
+    pthread_cond_broadcast(&r->room);
+    pthread_mutex_unlock(&r->mu);
+    wake(r);
+    if (running) pthread_join(r->thread, NULL);
+
+    // EOF просит шард выйти; кто не вышел за 2 с — SIGKILL
+    for (int i = 0; i < SHARD_MAX_WORKERS; i++)
+        if (r->slots[i].fd >= 0) shutdown(r->slots[i].fd, SHUT_WR);
+    uint64_t deadline = now_ms() + 2000;
+    for (int i = 0; i < SHARD_MAX_WORKERS; i++) {
+        Slot *s = &r->slots[i];
+        if (s->pid > 0) {
+            while (waitpid(s->pid, NULL, WNOHANG) == 0) {
+                if (now_ms() >= deadline) {
+                    kill(s->pid, SIGKILL);
+                    waitpid(s->pid, NULL, 0);
+                    break;
+                }
+                usleep(10000);
+            }
+        }
+        if (s->fd >= 0) close(s->fd);
+        queue_free(&s->q);
+    }
+    queue_free(&r->parked);
+    close(r->wake[0]);
+    close(r->wake[1]);
+    pthread_cond_destroy(&r->room);
+    pthread_mutex_destroy(&r->mu);
+    free(r->ring);
+    free(r->chats);
+    free(r);
+}
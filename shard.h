@@ -0,0 +1,94 @@
+// shard.h — раздача чатов по рабочим процессам (шардам)
+//
+// Один входной процесс (ingress) опрашивает Bot API и раздаёт апдейты N
+// рабочим процессам. Рабочие порождаются fork из ingress и связаны с ним
+// парой сокетов AF_UNIX/SOCK_SEQPACKET: границы сообщений сохраняются, и
+// обрыв процесса виден как EOF.
+//   маршрут      — consistent hashing chat_id по кольцу из vnodes точек на
+//                  шард: при добавлении или потере шарда переезжают только
+//                  его чаты
+//   порядок      — пока у чата есть неподтверждённые апдейты, новые идут
+//                  тому же шарду, даже если кольцо уже изменилось; шард
+//                  обрабатывает свою очередь строго по порядку
+//   подтверждение — шард отвечает ACK на каждый обработанный апдейт;
+//                  неподтверждённые апдейты упавшего шарда по порядку
+//                  уходят новым владельцам (at-least-once: ответ на апдейт,
+//                  обработанный перед самым падением, может повториться);
+//                  апдейт, на котором шард упал SHARD_MAX_ATTEMPTS раз, выбрасывается
+//   здоровье     — PING раз в heartbeat_ms; нет ответа за timeout_ms —
+//                  шард считается зависшим и убивается SIGKILL (PING
+//                  отвечается между апдейтами, так что handle дольше
+//                  timeout_ms — тоже зависание); упавший перезапускается с
+//                  удвоением паузы (до 30 с) и получает свои точки кольца
+//   размер       — shard_resize добавляет шарды сразу, а убираемые
+//                  выводит из кольца и останавливает, когда их очередь пуста
+// Всё это делает поток-надзиратель ingress; shard_dispatch только ставит
+// апдейт в очередь шарда и при переполнении (max_inflight) ждёт.
+//
+// Обработчик (handle) и инициализация (init) выполняются в рабочем
+// процессе. Шард — копия ingress на момент fork: потоки ingress в нём не
+// существуют, поэтому свои потоки и соединения шард создаёт в init.
+// SIGINT и SIGHUP шард игнорирует: завершением управляет ingress.
+
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#define SHARD_MAX_WORKERS 64
+#define SHARD_MAX_TEXT 16384
+#define SHARD_MAX_ATTEMPTS 3
+
+typedef struct {
+    int64_t update_id;
+    int64_t chat_id;
+    int64_t message_id;
+    int64_t from_id;           // отправитель
+    const char *first_name;    // в шарде — строки с '\0'
+    const char *text;
+} ShardUpdate;
+
+// В рабочем процессе после fork; не 0 — шард завершается
+typedef int (*ShardInitFn)(int shard, void *ctx);
+typedef void (*ShardHandleFn)(int shard, const ShardUpdate *u, void *ctx);
+
+typedef struct {
+    int workers;               // начальное число шардов
+    int vnodes;                // точек кольца на шард (64)
+    int heartbeat_ms;          // (1000)
+    int timeout_ms;            // без PONG дольше — зависание (10000)
+    int max_inflight;          // неподтверждённых апдейтов всего (4096)
+    ShardInitFn init;
+    ShardHandleFn handle;
+    void *ctx;
+} ShardConfig;
+
+typedef struct {
+    uint64_t dispatched, acked, redispatched;
+    uint64_t deaths, hung, restarts;
+    uint64_t dropped;          // после SHARD_MAX_ATTEMPTS падений
+    int workers;               // живых шардов в кольце
+    int inflight;
+    int parked;                // ждут появления живого шарда
+} ShardStats;
+
+typedef struct ShardRouter ShardRouter;
+
+ShardRouter *shard_start(const ShardConfig *cfg);
+
+// Ставит апдейт в очередь его шарда; 0 или -1 (слишком длинный текст, остановка)
+int shard_dispatch(ShardRouter *r, const ShardUpdate *u);
+
+// Новое число шардов (1..SHARD_MAX_WORKERS); 0 или -1
+int shard_resize(ShardRouter *r, int workers);
+
+void shard_stats(ShardRouter *r, ShardStats *out);
+
+// pid шарда или -1 (для проверок отказоустойчивости)
+pid_t shard_pid(ShardRouter *r, int shard);
+
+// Ждёт подтверждения очередей не дольше drain_ms, затем останавливает шарды
+void shard_stop(ShardRouter *r, int drain_ms);
+
+#endif // SHARD_H
@@ -5,6 +5,7 @@
 #include <time.h>
 #include <curl/curl.h>
 #include "telebot/include/telebot.h"
+#include "alog.h"
 
 struct memory {
     char *response;
@@ -61,6 +62,7 @@ void get_time(char *buffer, size_t size) {
 int main() {
     printf("🚀 OXXYEN Bot v1.5 — чистый C\n");
     printf("──────────────────────────────\n");
+    alog_init();
 
     // Загружаем токен
     FILE *fp = fopen(".token", "r");
@@ -96,7 +98,8 @@ int main() {
             if (!msg.text) continue;
 
             long long chat_id = msg.chat->id;
-            printf("📩 [%s]: %s\n", msg.from->first_name, msg.text);
+            ALOG(ALOG_INFO, "message", AF_I("update", updates[i].update_id), AF_I("chat", chat_id),
+                 AF_S("from", msg.from->first_name), AF_S("text", msg.text));
 
             if (strcmp(msg.text, "/start") == 0) {
                 char reply[2048];
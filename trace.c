@@ -0,0 +1,192 @@
+// trace.c — кольцевые буферы интервалов и выгрузка в Chrome trace JSON (см. trace.h)
+
+#define _GNU_SOURCE
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#define TRACE_MASK (TRACE_RING_SIZE - 1)
+
+// seq = 2*n+1 пока слот n пишется, 2*n+2 — когда записан
+typedef struct {
+    uint64_t seq;
+    uint64_t trace_id;
+    const char *cat;
+    const char *name;
+    uint64_t start_ns;
+    uint64_t dur_ns;
+    int64_t arg;
+} TraceSlot;
+
+typedef struct TraceRing {
+    struct TraceRing *next;
+    uint32_t tid;
+    const char *thread_name;   // литерал, меняется атомарно
+    uint64_t head;             // число записанных интервалов
+    TraceSlot slots[TRACE_RING_SIZE];
+} TraceRing;
+
+static int enabled = 0;
+static uint64_t slow_ns = 2000ull * 1000000ull;
+static const char *trace_dir = "traces";
+static const char *proc_name = "oxxyen";
+static TraceRing *rings;                 // список всех буферов, только добавление
+static uint64_t next_id;
+static volatile sig_atomic_t dump_requested = 0;
+static __thread TraceRing *my_ring;
+
+uint64_t trace_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+int trace_enabled(void) {
+    return enabled;
+}
+
+static void on_sigusr1(int sig) {
+    (void)sig;
+    dump_requested = 1;
+}
+
+void trace_init(const char *process_name) {
+    const char *env = getenv("OXXYEN_TRACE");
+    enabled = !(env && strcmp(env, "0") == 0);
+    if (!enabled) return;
+    if (process_name) proc_name = process_name;
+    if ((env = getenv("OXXYEN_TRACE_SLOW_MS"))) slow_ns = strtoull(env, NULL, 10) * 1000000ull;
+    if ((env = getenv("OXXYEN_TRACE_DIR")) && *env) trace_dir = env;
+    // id без своего источника не должны совпадать между перезапусками
+    next_id = (uint64_t)time(NULL) << 20;
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_sigusr1;
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &sa, NULL);
+}
+
+uint64_t trace_new_id(void) {
+    return __atomic_add_fetch(&next_id, 1, __ATOMIC_RELAXED);
+}
+
+// Буфер потока создаётся при первом интервале и живёт до конца процесса:
+// выгрузка может читать его и после выхода потока
+static TraceRing *ring_get(void) {
+    if (my_ring) return my_ring;
+    TraceRing *r = calloc(1, sizeof(*r));
+    if (!r) return NULL;
+    r->tid = (uint32_t)syscall(SYS_gettid);
+    r->thread_name = r->tid == (uint32_t)getpid() ? "main" : "worker";
+    r->next = __atomic_load_n(&rings, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&rings, &r->next, r, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {}
+    my_ring = r;
+    return r;
+}
+
+void trace_thread_name(const char *name) {
+    if (!enabled) return;
+    TraceRing *r = ring_get();
+    if (r) __atomic_store_n(&r->thread_name, name, __ATOMIC_RELAXED);
+}
+
+static void ring_put(uint64_t trace_id, const char *cat, const char *name, uint64_t t0, uint64_t t1, int64_t arg) {
+    TraceRing *r = ring_get();
+    if (!r) return;
+    uint64_t h = r->head;
+    TraceSlot *s = &r->slots[h & TRACE_MASK];
+    __atomic_store_n(&s->seq, 2 * h + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&s->trace_id, trace_id, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->cat, cat, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->name, name, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->start_ns, t0, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->dur_ns, t1 > t0 ? t1 - t0 : 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->arg, arg, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->seq, 2 * h + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&r->head, h + 1, __ATOMIC_RELEASE);
+}
+
+void trace_span(uint64_t trace_id, const char *cat, const char *name, uint64_t t0, int64_t arg) {
+    if (!enabled) return;
+    ring_put(trace_id, cat, name, t0, trace_now(), arg);
+}
+
+void trace_interval(uint64_t trace_id, const char *cat, const char *name, uint64_t t0, uint64_t t1, int64_t arg) {
+    if (!enabled) return;
+    ring_put(trace_id, cat, name, t0, t1, arg);
+}
+
+static int ensure_dir(void) {
+    if (mkdir(trace_dir, 0755) == 0 || errno == EEXIST) return 0;
+    return -1;
+}
+
+void trace_request_end(uint64_t trace_id, const char *name, uint64_t t0, int64_t arg) {
+    if (!enabled) return;
+    uint64_t t1 = trace_now();
+    ring_put(trace_id, "request", name, t0, t1, arg);
+    if (!slow_ns || t1 - t0 < slow_ns || ensure_dir() != 0) return;
+    char path[512];
+    snprintf(path, sizeof(path), "%s/slow-%llu-%llums.json", trace_dir,
+             (unsigned long long)trace_id, (unsigned long long)((t1 - t0) / 1000000ull));
+    uint64_t lookback = (uint64_t)TRACE_LOOKBACK_MS * 1000000ull;
+    if (trace_dump(path, trace_id, t0 > lookback ? t0 - lookback : 0, t1) == 0)
+        fprintf(stderr, "🐢 Медленный запрос %llu: %.0f мс → %s\n",
+                (unsigned long long)trace_id, (double)(t1 - t0) / 1e6, path);
+}
+
+void trace_poll(void) {
+    if (!enabled || !dump_requested) return;
+    dump_requested = 0;
+    if (ensure_dir() != 0) return;
+    char path[512];
+    snprintf(path, sizeof(path), "%s/trace-%lld-%d.json", trace_dir, (long long)time(NULL), (int)getpid());
+    if (trace_dump(path, 0, 0, 0) == 0) fprintf(stderr, "🧵 Трасса выгружена → %s\n", path);
+}
+
+int trace_dump(const char *path, uint64_t trace_id, uint64_t from_ns, uint64_t to_ns) {
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+    int pid = (int)getpid();
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+               "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":\"%s\"}}",
+            pid, proc_name);
+    for (TraceRing *r = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); r; r = r->next) {
+        fprintf(f, ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                pid, r->tid, __atomic_load_n(&r->thread_name, __ATOMIC_RELAXED));
+        uint64_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        uint64_t first = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+        for (uint64_t n = first; n < head; n++) {
+            TraceSlot *s = &r->slots[n & TRACE_MASK];
+            uint64_t seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+            if (seq != 2 * n + 2) continue;
+            TraceSlot e;
+            e.trace_id = __atomic_load_n(&s->trace_id, __ATOMIC_RELAXED);
+            e.cat = __atomic_load_n(&s->cat, __ATOMIC_RELAXED);
+            e.name = __atomic_load_n(&s->name, __ATOMIC_RELAXED);
+            e.start_ns = __atomic_load_n(&s->start_ns, __ATOMIC_RELAXED);
+            e.dur_ns = __atomic_load_n(&s->dur_ns, __ATOMIC_RELAXED);
+            e.arg = __atomic_load_n(&s->arg, __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&s->seq, __ATOMIC_RELAXED) != seq) continue;   // перезаписан во время чтения
+            int in_window = e.start_ns + e.dur_ns >= from_ns && (to_ns == 0 || e.start_ns <= to_ns);
+            if (!in_window && !(trace_id && e.trace_id == trace_id)) continue;
+            fprintf(f, ",\n{\"ph\":\"X\",\"cat\":\"%s\",\"name\":\"%s\",\"pid\":%d,\"tid\":%u,"
+                       "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"trace_id\":%llu,\"arg\":%lld}}",
+                    e.cat, e.name, pid, r->tid, (double)e.start_ns / 1e3, (double)e.dur_ns / 1e3,
+                    (unsigned long long)e.trace_id, (long long)e.arg);
+        }
+    }
+    fprintf(f, "\n]}\n");
+    return fclose(f) == 0 ? 0 : -1;
+}
@@ -0,0 +1,56 @@
+// trace.h — трассировка запросов бота в формате Chrome trace-event
+//
+// Каждый поток пишет завершённые интервалы (span) в свой кольцевой буфер
+// без блокировок: писатель один, читатель (выгрузка) проверяет номер
+// записи в слоте до и после копирования и пропускает перезаписанные.
+// Интервал привязан к trace id — для апдейта это update_id, и по нему
+// в выгрузке собираются опрос, разбор, генерация и отправка ответа.
+//
+// Выгрузка — JSON для chrome://tracing / ui.perfetto.dev:
+//   по запросу — SIGUSR1 (файл пишет trace_poll из основного цикла);
+//   медленный запрос — trace_request_end, если запрос дольше порога,
+//   выгружает его интервалы и всё, что шло в потоках за TRACE_LOOKBACK_MS до него.
+//
+// Окружение:
+//   OXXYEN_TRACE=0          — выключить (запись интервала — одна проверка флага)
+//   OXXYEN_TRACE_SLOW_MS=N  — порог медленного запроса (2000; 0 — не выгружать)
+//   OXXYEN_TRACE_DIR=DIR    — каталог выгрузок (traces)
+//
+// Имена интервалов и категорий не копируются — только строковые литералы.
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#define TRACE_RING_SIZE 4096         // степень двойки, интервалов на поток
+#define TRACE_LOOKBACK_MS 2000
+
+void trace_init(const char *process_name);
+int trace_enabled(void);
+
+// CLOCK_MONOTONIC, нс
+uint64_t trace_now(void);
+
+// Уникальный id для запросов без своего (update_id у апдейтов Telegram)
+uint64_t trace_new_id(void);
+
+// Имя потока в выгрузке (строковый литерал)
+void trace_thread_name(const char *name);
+
+// Интервал [t0, сейчас]; arg — произвольное число в args (chat_id, токены)
+void trace_span(uint64_t trace_id, const char *cat, const char *name, uint64_t t0, int64_t arg);
+
+// Интервал [t0, t1], когда конец уже позади
+void trace_interval(uint64_t trace_id, const char *cat, const char *name, uint64_t t0, uint64_t t1, int64_t arg);
+
+// Корневой интервал запроса; медленный запрос выгружается в OXXYEN_TRACE_DIR
+void trace_request_end(uint64_t trace_id, const char *name, uint64_t t0, int64_t arg);
+
+// Выгрузка по SIGUSR1, если она была запрошена; вызывать из основного цикла
+void trace_poll(void);
+
+// Все интервалы (trace_id == 0) или один запрос с окном [from_ns, to_ns]; 0 или -1
+int trace_dump(const char *path, uint64_t trace_id, uint64_t from_ns, uint64_t to_ns);
+
+#endif // TRACE_H